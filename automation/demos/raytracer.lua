@@ -9,6 +9,7 @@ script_author = "jfs"
 script_version = tostring(math.pi)
 
 include("utils.lua")
+local DialogueBatch = require("aegisub.dialogue_batch")
 
 max_iter = 3
 
@@ -18,17 +19,21 @@ function raytrace(subs)
 	
 	aegisub.progress.task("Raytracing...")
 	local curp, totalp = 0, xres*yres
+	-- Pixels are collected in a batch rather than appended one at a time,
+	-- as even a small image is a very large number of lines
+	local pixels = DialogueBatch(xres*yres)
 	for y = 0, yres-1 do
 		aegisub.progress.task(string.format("Raytracing, line %d/%d...", y+1, yres))
 		for x = 0, xres-1 do
 			aegisub.progress.set(curp/totalp*100)
-			local l = trace_point(x, y, (x+0.5)/xres, (y+0.5)/yres, lights, tris, camera)
-			if l then
-				subs.append(l)
+			local text = trace_point(x, y, (x+0.5)/xres, (y+0.5)/yres, lights, tris, camera)
+			if text then
+				pixels:add(0, 3600*1000, 0, "p", text) -- one hour
 			end
 			curp = curp + 1
 		end
 	end
+	pixels:append_to(subs)
 	
 	aegisub.progress.task("Done.")
 	aegisub.progress.set(100)
@@ -46,24 +51,7 @@ function trace_point(px, py, x, y, lights, tris, camera)
 	
 	r, g, b = clamp(r, 0, 255), clamp(g, 0, 255), clamp(b, 0, 255)
 	
-	-- todo, make line
-	local l = {
-		class = "dialogue",
-		section = "Events",
-		comment = false,
-		layer = 0,
-		start_time = 0,
-		end_time = 3600*1000, -- one hour
-		style = "p",
-		actor = "",
-		margin_l = 0,
-		margin_r = 0,
-		margin_t = 0,
-		margin_b = 0,
-		effect = "",
-		text = string.format("{\\pos(%d,%d)\\1c&H%02x%02x%02x&\\p1}m 0 0 l 1 0 1 1 0 1", px, py, r, g, b)
-	}
-	return l
+	return string.format("{\\pos(%d,%d)\\1c&H%02x%02x%02x&\\p1}m 0 0 l 1 0 1 1 0 1", px, py, r, g, b)
 end
 
 
@@ -132,18 +132,13 @@ function karaskel.preproc_line_text(meta, styles, line)
 	line.duration = line.end_time - line.start_time
 	
 	local worksyl = { highlights = {n=0}, furi = {n=0} }
-	local cur_inline_fx = ""
 	for i = 0, #kara do
 		local syl = kara[i]
 		
-		-- Detect any inline-fx tags
-		local inline_fx = syl.text:match("%{.*\\%-([^}\\]+)")
-		if inline_fx then
-			cur_inline_fx = inline_fx
-		end
-		
-		-- Strip spaces (only basic ones, no fullwidth etc.)
-		local prespace, syltext, postspace = syl.text_stripped:match("^([ \t]*)(.-)([ \t]*)$")
+		-- Inline-fx tags and basic (not fullwidth etc.) spaces are picked out
+		-- by parse_karaoke_data
+		local cur_inline_fx = syl.inline_fx
+		local prespace, syltext, postspace = syl.prespace, syl.text_spacestripped, syl.postspace
 		
 		-- See if we've broken a (possible) multi-hl stretch
 		-- If we did it's time for a new worksyl (though never for the zero'th syllable)
@@ -18,6 +18,7 @@
 
 #include "libaegisub/spellchecker.h"
 
+#include <algorithm>
 #include <boost/locale/boundary/index.hpp>
 #include <boost/locale/boundary/segment.hpp>
 #include <boost/locale/boundary/types.hpp>
@@ -33,6 +34,18 @@ class SyntaxHighlighter {
 	TokenVec ranges;
 	std::string const& text;
 	agi::SpellChecker *spellchecker;
+	std::vector<std::string> *unchecked;
+
+	bool IsMisspelled(std::string const& word) {
+		if (!unchecked)
+			return !spellchecker->CheckWord(word);
+
+		bool valid;
+		if (spellchecker->TryCheckWord(word, valid))
+			return !valid;
+		unchecked->push_back(word);
+		return false;
+	}
 
 	void SetStyling(size_t len, int type) {
 		if (ranges.size() && ranges.back().type == type)
@@ -42,9 +55,10 @@ class SyntaxHighlighter {
 	}
 
 public:
-	SyntaxHighlighter(std::string const& text, agi::SpellChecker *spellchecker)
+	SyntaxHighlighter(std::string const& text, agi::SpellChecker *spellchecker, std::vector<std::string> *unchecked)
 	: text(text)
 	, spellchecker(spellchecker)
+	, unchecked(unchecked)
 	{ }
 
 	TokenVec Highlight(TokenVec const& tokens) {
@@ -76,7 +90,7 @@ public:
 						SetStyling(tok.length, ss::NORMAL);
 					break;
 				case dt::WORD:
-					if (spellchecker && !spellchecker->CheckWord(text.substr(pos, tok.length)))
+					if (spellchecker && IsMisspelled(text.substr(pos, tok.length)))
 						SetStyling(tok.length, ss::SPELLING);
 					else
 						SetStyling(tok.length, ss::NORMAL);
@@ -140,8 +154,76 @@ public:
 namespace agi {
 namespace ass {
 
-std::vector<DialogueToken> SyntaxHighlight(std::string const& text, std::vector<DialogueToken> const& tokens, SpellChecker *spellchecker) {
-	return SyntaxHighlighter(text, spellchecker).Highlight(tokens);
+std::vector<DialogueToken> SyntaxHighlight(std::string const& text, std::vector<DialogueToken> const& tokens, SpellChecker *spellchecker, std::vector<std::string> *unchecked) {
+	return SyntaxHighlighter(text, spellchecker, unchecked).Highlight(tokens);
+}
+
+std::pair<size_t, size_t> RetokenizeDialogueBody(std::string const& old_text, std::string const& new_text, std::vector<DialogueToken> &tokens, bool karaoke_templater) {
+	size_t total = 0;
+	for (auto const& tok : tokens) total += tok.length;
+
+	// Karaoke templates can swallow a } depending on what comes after it, so
+	// there's nothing it's safe to resume lexing from. The lexer also gives
+	// up on some invalid input, and then tokens doesn't cover the whole line.
+	if (karaoke_templater || total != old_text.size()) {
+		tokens = TokenizeDialogueBody(new_text, karaoke_templater);
+		return {0, new_text.size()};
+	}
+
+	size_t prefix = 0;
+	size_t common = std::min(old_text.size(), new_text.size());
+	while (prefix < common && old_text[prefix] == new_text[prefix])
+		++prefix;
+	if (prefix == old_text.size() && prefix == new_text.size())
+		return {prefix, prefix};
+
+	size_t suffix = 0;
+	while (suffix < common - prefix && old_text[old_text.size() - suffix - 1] == new_text[new_text.size() - suffix - 1])
+		++suffix;
+
+	// The lexer is always back in its initial state after the end of an
+	// override block and no token can extend past one, so relex from the last
+	// one before the edit to the first one after it
+	size_t first = 0, start = 0, pos = 0, i = 0;
+	for (; i < tokens.size() && pos + tokens[i].length <= prefix; ++i) {
+		pos += tokens[i].length;
+		if (tokens[i].type == dt::OVR_END) {
+			first = i + 1;
+			start = pos;
+		}
+	}
+
+	size_t last = tokens.size(), old_stop = old_text.size();
+	for (; i < tokens.size(); ++i) {
+		pos += tokens[i].length;
+		if (tokens[i].type == dt::OVR_END && pos >= old_text.size() - suffix) {
+			last = i + 1;
+			old_stop = pos;
+			break;
+		}
+	}
+
+	size_t stop = new_text.size() - (old_text.size() - old_stop);
+	auto relexed = TokenizeDialogueBody(new_text.substr(start, stop - start));
+
+	// The edit may have removed the { for the block we stopped at, in which
+	// case the rest of the line has to be relexed
+	if (last != tokens.size() && (relexed.empty() || relexed.back().type != dt::OVR_END)) {
+		last = tokens.size();
+		stop = new_text.size();
+		relexed = TokenizeDialogueBody(new_text.substr(start));
+	}
+
+	size_t relexed_len = 0;
+	for (auto const& tok : relexed) relexed_len += tok.length;
+	if (relexed_len != stop - start) {
+		tokens = TokenizeDialogueBody(new_text);
+		return {0, new_text.size()};
+	}
+
+	tokens.erase(tokens.begin() + first, tokens.begin() + last);
+	tokens.insert(tokens.begin() + first, relexed.begin(), relexed.end());
+	return {start, stop};
 }
 
 void MarkDrawings(std::string const& str, std::vector<DialogueToken> &tokens) {
@@ -22,11 +22,77 @@
 #include <libaegisub/util.h>
 
 #include <algorithm>
+#include <cstdint>
+
+namespace {
+/// Parse a time in one of the layouts which nearly all times are written in:
+/// h:mm:ss.cc (ASS), h:mm:ss.mmm and hh:mm:ss,mmm (SRT and TTXT)
+///
+/// The eight bytes from the colon after the hours to the first decimal digit
+/// are checked at once. The result is always what the general parser would
+/// give for the same text.
+/// @return false if text isn't in one of the layouts
+bool parse_fixed(std::string const& text, int &time) {
+	const size_t len = text.size();
+	if (len < 10 || len > 12) return false;
+	const auto s = reinterpret_cast<const unsigned char *>(text.data());
+
+	const size_t hour_digits = s[1] == ':' ? 1 : 2;
+	const size_t decimals = len - hour_digits - 7;
+	if (decimals < 2 || decimals > 3) return false;
+
+	unsigned hours = s[0] - '0';
+	if (hours > 9) return false;
+	if (hour_digits == 2) {
+		unsigned second = s[1] - '0';
+		if (second > 9) return false;
+		hours = hours * 10 + second;
+	}
+
+	// ":mm:ss.f" with the byte at index i in bits 8i..8i+7
+	uint64_t block = 0;
+	for (size_t i = 0; i < 8; ++i)
+		block |= uint64_t(s[hour_digits + i]) << (8 * i);
+
+	// Clearing bit 1 of the decimal separator makes '.' and ',' the same
+	const uint64_t sep_lanes = UINT64_C(0x00FF0000FF0000FF);
+	const uint64_t separators = UINT64_C(0x002C00003A00003A);
+	if (((block & ~UINT64_C(0x0002000000000000)) & sep_lanes) != separators)
+		return false;
+
+	// Each digit lane holds 0-9 after this only if it was a digit: the high
+	// nibble must be clear both before and after adding 6, which carries into
+	// it for 10-15 but can't carry out of the byte
+	const uint64_t digit_lanes = ~sep_lanes;
+	const uint64_t digits = (block ^ UINT64_C(0x3030303030303030)) & digit_lanes;
+	if ((digits | (digits + UINT64_C(0x0606060606060606))) & UINT64_C(0xF0F0F0F0F0F0F0F0) & digit_lanes)
+		return false;
+
+	auto digit = [&](int lane) { return int(digits >> (8 * lane) & 0xF); };
+	int minutes = digit(1) * 10 + digit(2);
+	int seconds = digit(4) * 10 + digit(5);
+	int fraction = digit(7) * 100;
+
+	for (size_t i = 1; i < decimals; ++i) {
+		unsigned d = s[hour_digits + 7 + i] - '0';
+		if (d > 9) return false;
+		fraction += d * (i == 1 ? 10 : 1);
+	}
+
+	time = ((int(hours) * 60 + minutes) * 60 + seconds) * 1000 + fraction;
+	return true;
+}
+}
 
 namespace agi {
 Time::Time(int time) : time(util::mid(0, time, 10 * 60 * 60 * 1000 - 6)) { }
 
 Time::Time(std::string const& text) {
+	if (parse_fixed(text, time)) {
+		time = util::mid(0, time, 10 * 60 * 60 * 1000 - 6);
+		return;
+	}
+
 	int after_decimal = -1;
 	int current = 0;
 	for (char c : text) {
@@ -60,11 +126,19 @@ Time::Time(std::string const& text) {
 }
 
 std::string Time::GetAssFormatted(bool msPrecision) const {
+	std::string ret;
+	AppendAssFormatted(ret, msPrecision);
+	return ret;
+}
+
+void Time::AppendAssFormatted(std::string &out, bool msPrecision) const {
 	int ass_time = msPrecision ? time : int(*this);
-	std::string ret(10 + msPrecision, ':');
+	char ret[11];
 	ret[0] = '0' + ass_time / 3600000;
+	ret[1] = ':';
 	ret[2] = '0' + (ass_time % (60 * 60 * 1000)) / (60 * 1000 * 10);
 	ret[3] = '0' + (ass_time % (10 * 60 * 1000)) / (60 * 1000);
+	ret[4] = ':';
 	ret[5] = '0' + (ass_time % (60 * 1000)) / (1000 * 10);
 	ret[6] = '0' + (ass_time % (10 * 1000)) / 1000;
 	ret[7] = '.';
@@ -72,7 +146,7 @@ std::string Time::GetAssFormatted(bool msPrecision) const {
 	ret[9] = '0' + (ass_time % 100) / 10;
 	if (msPrecision)
 		ret[10] = '0' + ass_time % 10;
-	return ret;
+	out.append(ret, 10 + msPrecision);
 }
 
 std::string Time::GetSrtFormatted() const {
@@ -17,6 +17,13 @@
 #include <libaegisub/ass/uuencode.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGI_UUENCODE_SSE2
+#endif
 
 // Despite being called uuencoding by ass_specs.doc, the format is actually
 // somewhat different from real uuencoding.  Each 3-byte chunk is split into 4
@@ -24,62 +31,140 @@
 // characters, and files with non-multiple-of-three lengths are padded with
 // zero.
 
+namespace {
+/// Input bytes per line of output when wrapping
+const size_t bytes_per_line = 60;
+
+inline void encode_group(const unsigned char *src, char *dst) {
+	dst[0] = static_cast<char>((src[0] >> 2) + 33);
+	dst[1] = static_cast<char>((((src[0] & 0x3) << 4) | ((src[1] & 0xF0) >> 4)) + 33);
+	dst[2] = static_cast<char>((((src[1] & 0xF) << 2) | ((src[2] & 0xC0) >> 6)) + 33);
+	dst[3] = static_cast<char>((src[2] & 0x3F) + 33);
+}
+
+/// Decode four characters, which have had offset subtracted already
+inline void decode_group(const unsigned char *src, char *dst, unsigned char offset = 0) {
+	unsigned char a = src[0] - offset, b = src[1] - offset, c = src[2] - offset, d = src[3] - offset;
+	dst[0] = static_cast<char>((a << 2) | (b >> 4));
+	dst[1] = static_cast<char>(((b & 0xF) << 4) | (c >> 2));
+	dst[2] = static_cast<char>(((c & 0x3) << 6) | (d));
+}
+
+#ifdef AGI_UUENCODE_SSE2
+/// Characters decoded at a time when there are no line breaks in the way
+const size_t block_chars = 16;
+
+/// Decode block_chars characters if they are all in the range uuencoding
+/// produces, which excludes line breaks
+/// @return false if nothing was decoded
+inline bool decode_block(const unsigned char *src, char *dst) {
+	__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+	x = _mm_sub_epi8(x, _mm_set1_epi8(33));
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(63)), x)) != 0xFFFF)
+		return false;
+
+	// Each 16-bit lane holds two characters, and each 32-bit lane one group
+	__m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(x, _mm_set1_epi16(0xFF)), 6), _mm_srli_epi16(x, 8));
+	__m128i groups = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), 12), _mm_srli_epi32(pairs, 16));
+
+	uint32_t values[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(values), groups);
+	for (auto value : values) {
+		*dst++ = static_cast<char>(value >> 16);
+		*dst++ = static_cast<char>(value >> 8);
+		*dst++ = static_cast<char>(value);
+	}
+	return true;
+}
+#else
+const size_t block_chars = 4;
+
+inline bool decode_block(const unsigned char *src, char *dst) {
+	if (src[0] <= 32 || src[1] <= 32 || src[2] <= 32 || src[3] <= 32)
+		return false;
+	decode_group(src, dst, 33);
+	return true;
+}
+#endif
+
+inline bool is_data(char c) {
+	return c && c != '\n' && c != '\r';
+}
+}
+
 namespace agi { namespace ass {
 
 std::string UUEncode(const char *begin, const char *end, bool insert_linebreaks) {
+	auto src = reinterpret_cast<const unsigned char *>(begin);
 	size_t size = std::distance(begin, end);
-	std::string ret;
-	ret.reserve((size * 4 + 2) / 3 + size / 80 * 2);
-
-	size_t written = 0;
-	for (size_t pos = 0; pos < size; pos += 3) {
-		unsigned char src[3] = { '\0', '\0', '\0' };
-		memcpy(src, begin + pos, std::min<size_t>(3u, size - pos));
-
-		unsigned char dst[4] = {
-			static_cast<unsigned char>(src[0] >> 2),
-			static_cast<unsigned char>(((src[0] & 0x3) << 4) | ((src[1] & 0xF0) >> 4)),
-			static_cast<unsigned char>(((src[1] & 0xF) << 2) | ((src[2] & 0xC0) >> 6)),
-			static_cast<unsigned char>(src[2] & 0x3F)
-		};
-
-		for (size_t i = 0; i < std::min<size_t>(size - pos + 1, 4u); ++i) {
-			ret += dst[i] + 33;
-
-			if (insert_linebreaks && ++written == 80 && pos + 3 < size) {
-				written = 0;
-				ret += "\r\n";
-			}
+	size_t tail = size % 3;
+
+	// A trailing partial group of n bytes is written as n + 1 characters,
+	// and a line break follows every 80 characters except the last ones
+	size_t chars = size / 3 * 4 + (tail ? tail + 1 : 0);
+	size_t breaks = insert_linebreaks && chars ? (chars - 1) / 80 : 0;
+	std::string ret(chars + breaks * 2, '\0');
+	char *dst = &ret[0];
+
+	size_t pos = 0;
+	while (size - pos >= 3) {
+		size_t line_end = pos + std::min((size - pos) / 3 * 3, bytes_per_line);
+		for (; pos < line_end; pos += 3, dst += 4)
+			encode_group(src + pos, dst);
+		if (insert_linebreaks && pos % bytes_per_line == 0 && pos < size) {
+			*dst++ = '\r';
+			*dst++ = '\n';
 		}
 	}
 
+	if (tail) {
+		unsigned char last[3] = { '\0', '\0', '\0' };
+		memcpy(last, src + pos, tail);
+		char group[4];
+		encode_group(last, group);
+		memcpy(dst, group, tail + 1);
+	}
+
 	return ret;
 }
 
 std::vector<char> UUDecode(const char *begin, const char *end) {
-	std::vector<char> ret;
+	auto src = reinterpret_cast<const unsigned char *>(begin);
 	size_t len = end - begin;
-	ret.reserve(len * 3 / 4);
-
-	for (size_t pos = 0; pos + 1 < len; ) {
-		size_t bytes = 0;
-		unsigned char src[4] = { '\0', '\0', '\0', '\0' };
-		for (size_t i = 0; i < 4 && pos < len; ++pos) {
-			char c = begin[pos];
-			if (c && c != '\n' && c != '\r') {
-				src[i++] = c - 33;
-				++bytes;
-			}
+	std::vector<char> ret(len * 3 / 4 + 3);
+	char *dst = ret.data();
+
+	// Groups of four characters may span line breaks, so any group which
+	// isn't four plain characters in a row is collected one at a time
+	unsigned char group[4];
+	size_t group_size = 0;
+
+	for (size_t pos = 0; pos < len; ) {
+		if (group_size == 0 && len - pos >= block_chars && decode_block(src + pos, dst)) {
+			pos += block_chars;
+			dst += block_chars / 4 * 3;
+			continue;
 		}
 
-		if (bytes > 1)
-			ret.push_back((src[0] << 2) | (src[1] >> 4));
-		if (bytes > 2)
-			ret.push_back(((src[1] & 0xF) << 4) | (src[2] >> 2));
-		if (bytes > 3)
-			ret.push_back(((src[2] & 0x3) << 6) | (src[3]));
+		if (is_data(begin[pos]))
+			group[group_size++] = src[pos] - 33;
+		++pos;
+		if (group_size == 4) {
+			decode_group(group, dst);
+			dst += 3;
+			group_size = 0;
+		}
+	}
+
+	if (group_size > 1) {
+		group[group_size] = group[3] = 0;
+		char last[3];
+		decode_group(group, last);
+		memcpy(dst, last, group_size - 1);
+		dst += group_size - 1;
 	}
 
+	ret.resize(dst - ret.data());
 	return ret;
 }
 } }
@@ -0,0 +1,150 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/decode_schedule.h"
+
+#include "libaegisub/audio/provider.h"
+#include "libaegisub/log.h"
+#include "libaegisub/trace.h"
+
+#include <algorithm>
+
+namespace agi {
+const size_t AudioDecodeSchedule::npos;
+
+AudioDecodeSchedule::AudioDecodeSchedule(int64_t num_samples, int64_t chunk_size, std::atomic<int64_t> &decoded_samples)
+: num_samples(num_samples)
+, chunk_size(chunk_size)
+, chunk_count((num_samples + chunk_size - 1) / chunk_size)
+, state(new std::atomic<uint8_t>[chunk_count])
+, requested(npos)
+, decoded_samples(decoded_samples)
+{
+	for (size_t i = 0; i < chunk_count; ++i)
+		state[i] = Pending;
+	decoded_samples = 0;
+}
+
+bool AudioDecodeSchedule::IsDecoded(int64_t start, int64_t count) const {
+	int64_t end = std::min(start + count, num_samples);
+	start = std::max<int64_t>(start, 0);
+	if (start >= end) return true;
+
+	for (size_t i = start / chunk_size, last = (end - 1) / chunk_size; i <= last; ++i) {
+		if (state[i] != Decoded) return false;
+	}
+	return true;
+}
+
+void AudioDecodeSchedule::Request(int64_t start, int64_t count) const {
+	int64_t end = std::min(start + count, num_samples);
+	start = std::max<int64_t>(start, 0);
+	if (start >= end) return;
+
+	for (size_t i = start / chunk_size, last = (end - 1) / chunk_size; i <= last; ++i) {
+		if (state[i] != Decoded) {
+			requested = i;
+			return;
+		}
+	}
+}
+
+size_t AudioDecodeSchedule::Claim(size_t chunk) {
+	state[chunk] = Decoding;
+	return chunk;
+}
+
+size_t AudioDecodeSchedule::Next(size_t finished) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (finished != npos) {
+		state[finished] = Decoded;
+		while (prefix < chunk_count && state[prefix] == Decoded)
+			++prefix;
+		decoded_samples = std::min<int64_t>(prefix * chunk_size, num_samples);
+	}
+
+	// Something which is being read hasn't been decoded yet. If another
+	// decoder is already on it, help out with what comes after it.
+	size_t chunk = requested.exchange(npos);
+	if (chunk != npos) {
+		while (chunk < chunk_count && state[chunk] == Decoding)
+			++chunk;
+		if (chunk < chunk_count && state[chunk] == Pending)
+			return Claim(chunk);
+	}
+
+	// Carry on sequentially if no one else has got there first
+	if (finished != npos && finished + 1 < chunk_count && state[finished + 1] == Pending)
+		return Claim(finished + 1);
+
+	// Look for a gap to work on: the first one which no decoder will reach
+	// by carrying on, or failing that the second half of the largest one
+	size_t largest_start = npos, largest_length = 0;
+	for (size_t i = prefix; i < chunk_count; ) {
+		if (state[i] != Pending) {
+			++i;
+			continue;
+		}
+
+		size_t start = i;
+		while (i < chunk_count && state[i] == Pending)
+			++i;
+		if (start == 0 || state[start - 1] == Decoded)
+			return Claim(start);
+		if (i - start > largest_length) {
+			largest_start = start;
+			largest_length = i - start;
+		}
+	}
+
+	if (largest_start == npos)
+		return npos;
+	return Claim(largest_start + largest_length / 2);
+}
+
+std::vector<std::thread> AudioDecodeSchedule::StartDecoders(AudioProvider const& source, int threads,
+	dispatch::CancellationToken cancel,
+	std::function<void (AudioProvider const&, size_t)> decode)
+{
+	auto run = [=](AudioProvider const& provider) {
+		agi::trace::NameThread("Audio Decoder");
+		for (size_t chunk = Next(); chunk != npos && !cancel.Cancelled(); chunk = Next(chunk)) {
+			agi::trace::Scope scope("decode chunk", "audio");
+			decode(provider, chunk);
+		}
+	};
+
+	std::vector<std::thread> decoders;
+	decoders.emplace_back([=, &source] { run(source); });
+	for (int i = 1; i < threads; ++i) {
+		decoders.emplace_back([=, &source] {
+			// Opening the copy can be slow, so it's done here rather than
+			// holding up the caller
+			std::unique_ptr<AudioProvider> copy;
+			try {
+				copy = source.Reopen();
+			}
+			catch (agi::Exception const& e) {
+				LOG_E("audio_provider") << "Failed to open audio for another decoder: " << e.GetMessage();
+			}
+			if (copy)
+				run(*copy);
+		});
+	}
+	return decoders;
+}
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/audio/energy_envelope.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+const size_t npos = std::numeric_limits<size_t>::max();
+}
+
+namespace agi {
+const uint16_t AudioEnergyEnvelope::unknown;
+
+AudioEnergyEnvelope::AudioEnergyEnvelope(int64_t num_samples, int sample_rate)
+: num_samples(num_samples)
+, bin_bits(6)
+{
+	// The power of two nearest to 10 ms, within reason
+	const int target = std::max(sample_rate / 100, 1);
+	while (bin_bits < 12 && (3 << bin_bits) / 2 < target)
+		++bin_bits;
+
+	bins = static_cast<size_t>((num_samples + BinSize() - 1) >> bin_bits);
+	leaves = 1;
+	while (leaves < bins)
+		leaves *= 2;
+	mins.resize(leaves * 2, unknown);
+	maxes.resize(leaves * 2, unknown);
+}
+
+void AudioEnergyEnvelope::Add(const int16_t *samples, int64_t start, int64_t count) {
+	count = std::min(count, num_samples - start);
+	if (count <= 0) return;
+
+	const int64_t bin_size = BinSize();
+	const size_t first = static_cast<size_t>(start >> bin_bits);
+	const size_t last = static_cast<size_t>((start + count + bin_size - 1) >> bin_bits);
+
+	// Measure without the lock, as this is the expensive part
+	std::vector<uint16_t> levels(last - first);
+	for (size_t i = 0; i < levels.size(); ++i) {
+		const int64_t offset = int64_t(i) << bin_bits;
+		const int64_t n = std::min(bin_size, count - offset);
+		int64_t sum = 0;
+		for (int64_t j = 0; j < n; ++j) {
+			int32_t sample = samples[offset + j];
+			sum += sample * sample;
+		}
+		levels[i] = static_cast<uint16_t>(std::min(32768.0, std::sqrt(double(sum) / n) + 0.5));
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::copy(levels.begin(), levels.end(), mins.begin() + leaves + first);
+	std::copy(levels.begin(), levels.end(), maxes.begin() + leaves + first);
+	for (size_t lo = (leaves + first) / 2, hi = (leaves + last - 1) / 2; lo > 0; lo /= 2, hi /= 2) {
+		for (size_t node = lo; node <= hi; ++node) {
+			mins[node] = std::min(mins[node * 2], mins[node * 2 + 1]);
+			maxes[node] = std::max(maxes[node * 2], maxes[node * 2 + 1]);
+		}
+	}
+}
+
+uint16_t AudioEnergyEnvelope::GetLevel(int64_t sample) const {
+	if (sample < 0 || sample >= num_samples) return unknown;
+	std::lock_guard<std::mutex> lock(mutex);
+	return mins[leaves + static_cast<size_t>(sample >> bin_bits)];
+}
+
+size_t AudioEnergyEnvelope::First(size_t from, size_t to, uint16_t threshold, bool quiet) const {
+	if (from >= to) return to;
+	auto matches = [&](size_t node) { return quiet ? mins[node] < threshold : maxes[node] >= threshold; };
+
+	// Walk right along the tree until a subtree has a match, then find the
+	// leftmost match in it
+	size_t node = leaves + from;
+	while (!matches(node)) {
+		while (node & 1) node /= 2;
+		if (node == 0) return to;
+		++node;
+	}
+	while (node < leaves) {
+		node *= 2;
+		if (!matches(node)) ++node;
+	}
+	return std::min(node - leaves, to);
+}
+
+size_t AudioEnergyEnvelope::Last(size_t from, size_t to, uint16_t threshold, bool quiet) const {
+	if (from >= to) return npos;
+	auto matches = [&](size_t node) { return quiet ? mins[node] < threshold : maxes[node] >= threshold; };
+
+	size_t node = leaves + to - 1;
+	while (!matches(node)) {
+		while (node > 1 && !(node & 1)) node /= 2;
+		if (node == 1) return npos;
+		--node;
+	}
+	while (node < leaves) {
+		node = node * 2 + 1;
+		if (!matches(node)) --node;
+	}
+	return node - leaves >= from ? node - leaves : npos;
+}
+
+int64_t AudioEnergyEnvelope::FindEdge(int64_t sample, int64_t max_distance, uint16_t threshold, bool rising) const {
+	if (bins < 2 || max_distance < 0) return -1;
+
+	// Boundary b is between bins b - 1 and b, at sample b * BinSize()
+	const int64_t bin_size = BinSize();
+	const int64_t lo = std::max<int64_t>(1, (std::max<int64_t>(sample - max_distance, 0) + bin_size - 1) >> bin_bits);
+	const int64_t hi = std::min<int64_t>(bins - 1, std::max<int64_t>(sample + max_distance, 0) >> bin_bits);
+	if (lo > hi) return -1;
+	const int64_t mid = std::min(std::max(lo, (std::max<int64_t>(sample, 0) + bin_size / 2) >> bin_bits), hi + 1);
+
+	// Quiet before a rising edge and loud after it, and the other way
+	// around for a falling one
+	const bool before = rising;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto known = [&](size_t b) { return mins[leaves + b - 1] != unknown && mins[leaves + b] != unknown; };
+
+	// The first boundary at or after mid is the first change after the
+	// first bin which is in the before state
+	int64_t right = -1;
+	if (mid <= hi) {
+		size_t i = First(mid - 1, hi, threshold, before);
+		if (i < (size_t)hi) {
+			size_t j = First(i + 1, hi + 1, threshold, !before);
+			if (j <= (size_t)hi && known(j))
+				right = j;
+		}
+	}
+
+	// The last one before mid is the start of the run containing the last
+	// bin in the after state
+	int64_t left = -1;
+	if (lo < mid) {
+		size_t j = Last(lo, mid, threshold, !before);
+		if (j != npos) {
+			size_t i = Last(lo - 1, j, threshold, before);
+			if (i != npos && known(i + 1))
+				left = i + 1;
+		}
+	}
+
+	if (left < 0 && right < 0) return -1;
+	if (left < 0) return right * bin_size;
+	if (right < 0) return left * bin_size;
+	// The first boundary at or after mid can still be before sample
+	return std::abs(sample - left * bin_size) <= std::abs(right * bin_size - sample) ? left * bin_size : right * bin_size;
+}
+
+uint16_t AudioEnergyEnvelope::LevelFromDecibels(double db) {
+	return static_cast<uint16_t>(std::min(32768.0, 32768.0 * std::pow(10.0, db / 20.0) + 0.5));
+}
+}
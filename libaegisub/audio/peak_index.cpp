@@ -0,0 +1,227 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/peak_index.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGI_PEAK_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AGI_PEAK_NEON
+#endif
+
+namespace {
+/// Samples per vectorised run; small enough that the 32-bit lane sums can't overflow
+const size_t vector_run = 65536;
+
+void AccumulatePeakScalar(agi::AudioPeak &peak, const int16_t *samples, size_t count) {
+	int peak_min = peak.min, peak_max = peak.max;
+	int64_t neg_sum = 0, pos_sum = 0;
+	for (size_t i = 0; i < count; ++i) {
+		int sample = samples[i];
+		if (sample > 0) {
+			peak_max = std::max(peak_max, sample);
+			pos_sum += sample;
+		}
+		else {
+			peak_min = std::min(peak_min, sample);
+			neg_sum += sample;
+		}
+	}
+
+	peak.min = peak_min;
+	peak.max = peak_max;
+	peak.neg_sum += neg_sum;
+	peak.pos_sum += pos_sum;
+}
+
+#ifdef AGI_PEAK_SSE2
+/// Accumulate count samples, which must be a multiple of 8 and no more than vector_run
+void AccumulatePeakVector(agi::AudioPeak &peak, const int16_t *samples, size_t count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i vmin = zero, vmax = zero, neg = zero, pos = zero;
+
+	for (size_t i = 0; i < count; i += 8) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+		__m128i n = _mm_min_epi16(x, zero);
+		__m128i p = _mm_max_epi16(x, zero);
+		vmin = _mm_min_epi16(vmin, n);
+		vmax = _mm_max_epi16(vmax, p);
+		neg = _mm_add_epi32(neg, _mm_madd_epi16(n, ones));
+		pos = _mm_add_epi32(pos, _mm_madd_epi16(p, ones));
+	}
+
+	int16_t mins[8], maxes[8];
+	int32_t negs[4], poss[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(mins), vmin);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(maxes), vmax);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(negs), neg);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(poss), pos);
+
+	for (int i = 0; i < 8; ++i) {
+		peak.min = std::min<int>(peak.min, mins[i]);
+		peak.max = std::max<int>(peak.max, maxes[i]);
+	}
+	for (int i = 0; i < 4; ++i) {
+		peak.neg_sum += negs[i];
+		peak.pos_sum += poss[i];
+	}
+}
+#elif defined(AGI_PEAK_NEON)
+void AccumulatePeakVector(agi::AudioPeak &peak, const int16_t *samples, size_t count) {
+	const int16x8_t zero = vdupq_n_s16(0);
+	int16x8_t vmin = zero, vmax = zero;
+	int32x4_t neg = vdupq_n_s32(0), pos = vdupq_n_s32(0);
+
+	for (size_t i = 0; i < count; i += 8) {
+		int16x8_t x = vld1q_s16(samples + i);
+		int16x8_t n = vminq_s16(x, zero);
+		int16x8_t p = vmaxq_s16(x, zero);
+		vmin = vminq_s16(vmin, n);
+		vmax = vmaxq_s16(vmax, p);
+		neg = vpadalq_s16(neg, n);
+		pos = vpadalq_s16(pos, p);
+	}
+
+	int16_t mins[8], maxes[8];
+	int32_t negs[4], poss[4];
+	vst1q_s16(mins, vmin);
+	vst1q_s16(maxes, vmax);
+	vst1q_s32(negs, neg);
+	vst1q_s32(poss, pos);
+
+	for (int i = 0; i < 8; ++i) {
+		peak.min = std::min<int>(peak.min, mins[i]);
+		peak.max = std::max<int>(peak.max, maxes[i]);
+	}
+	for (int i = 0; i < 4; ++i) {
+		peak.neg_sum += negs[i];
+		peak.pos_sum += poss[i];
+	}
+}
+#endif
+}
+
+namespace agi {
+void AccumulatePeak(AudioPeak &peak, const int16_t *samples, size_t count) {
+#if defined(AGI_PEAK_SSE2) || defined(AGI_PEAK_NEON)
+	while (count >= 8) {
+		size_t run = std::min(count, vector_run) & ~size_t(7);
+		AccumulatePeakVector(peak, samples, run);
+		samples += run;
+		count -= run;
+	}
+#endif
+	AccumulatePeakScalar(peak, samples, count);
+}
+
+AudioPeakIndex::AudioPeakIndex(int64_t num_samples)
+: num_samples(num_samples)
+{
+	for (size_t level = 0; level < levels; ++level)
+		entries[level].resize((num_samples + LevelSize(level) - 1) / LevelSize(level));
+
+	// The coarsest level has one entry per block
+	indexed.reset(new std::atomic<bool>[entries[levels - 1].size()]);
+	for (size_t i = 0; i < entries[levels - 1].size(); ++i)
+		indexed[i] = false;
+}
+
+void AudioPeakIndex::Add(AudioPeak &peak, Entry const& entry) {
+	if (entry.min < peak.min) peak.min = entry.min;
+	if (entry.max > peak.max) peak.max = entry.max;
+	peak.neg_sum += entry.neg_sum;
+	peak.pos_sum += entry.pos_sum;
+}
+
+void AudioPeakIndex::Add(const int16_t *samples, int64_t start, int64_t count) {
+	count = std::min(count, num_samples - start);
+	if (count <= 0) return;
+
+	const int64_t base_size = LevelSize(0);
+	const size_t fanout = size_t(1) << level_bits;
+
+	// Finest level is built directly from the samples
+	size_t first = start / base_size;
+	size_t last = (start + count + base_size - 1) / base_size;
+	for (size_t i = first; i < last; ++i) {
+		AudioPeak peak;
+		auto offset = int64_t(i) * base_size - start;
+		AccumulatePeak(peak, samples + offset, std::min(base_size, count - offset));
+		entries[0][i] = Entry{(int16_t)peak.min, (int16_t)peak.max, (int32_t)peak.neg_sum, (int32_t)peak.pos_sum};
+	}
+
+	// Each coarser level is built from the one below it
+	for (size_t level = 1; level < levels; ++level) {
+		auto const& finer = entries[level - 1];
+		size_t finer_last = last;
+		first >>= level_bits;
+		last = (last + fanout - 1) >> level_bits;
+		for (size_t i = first; i < last; ++i) {
+			AudioPeak peak;
+			size_t end = std::min((i + 1) << level_bits, finer_last);
+			for (size_t j = i << level_bits; j < end; ++j)
+				Add(peak, finer[j]);
+			entries[level][i] = Entry{(int16_t)peak.min, (int16_t)peak.max, (int32_t)peak.neg_sum, (int32_t)peak.pos_sum};
+		}
+	}
+
+	for (size_t i = start / BlockSize(); i < last; ++i)
+		indexed[i] = true;
+}
+
+bool AudioPeakIndex::IsIndexed(int64_t start, int64_t count) const {
+	int64_t end = std::min(start + count, num_samples);
+	start = std::max<int64_t>(start, 0);
+	for (int64_t i = start / BlockSize(); i * BlockSize() < end; ++i) {
+		if (!indexed[i]) return false;
+	}
+	return true;
+}
+
+AudioPeak AudioPeakIndex::Summarize(int64_t start, int64_t end) const {
+	AudioPeak peak;
+	size_t lo = start >> base_bits;
+	size_t hi = end >> base_bits;
+	const size_t mask = (size_t(1) << level_bits) - 1;
+
+	// Walk up the pyramid, consuming entries at each level until both ends
+	// are aligned to an entry of the next coarser level
+	for (size_t level = 0; level + 1 < levels && lo < hi; ++level) {
+		auto const& level_entries = entries[level];
+		for (; lo < hi && (lo & mask); ++lo)
+			Add(peak, level_entries[lo]);
+		for (; lo < hi && (hi & mask); --hi)
+			Add(peak, level_entries[hi - 1]);
+		lo >>= level_bits;
+		hi >>= level_bits;
+	}
+
+	// Whatever is left is covered by whole entries of the coarsest level,
+	// or nothing at all if the loop ended early
+	if (lo < hi) {
+		auto const& coarsest = entries[levels - 1];
+		for (; lo < hi; ++lo)
+			Add(peak, coarsest[lo]);
+	}
+
+	return peak;
+}
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/audio/playback_feed.h"
+
+#include "libaegisub/audio/playback_stats.h"
+#include "libaegisub/audio/provider.h"
+#include "libaegisub/log.h"
+#include "libaegisub/util.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+/// How often the feed thread checks for space when the ring is full
+const std::chrono::milliseconds poll_interval{5};
+}
+
+namespace agi {
+AudioRingBuffer::AudioRingBuffer(size_t capacity, size_t frame_size)
+: data(std::max<size_t>(capacity, 1) * frame_size)
+, frame_size(frame_size)
+, capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+char *AudioRingBuffer::WritePointer(size_t &frames) {
+	size_t w = written.load(std::memory_order_relaxed);
+	size_t r = read.load(std::memory_order_acquire);
+	size_t offset = w % capacity;
+	frames = std::min(capacity - (w - r), capacity - offset);
+	return &data[offset * frame_size];
+}
+
+void AudioRingBuffer::CommitWrite(size_t frames) {
+	written.store(written.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+}
+
+size_t AudioRingBuffer::Read(void *dest, size_t frames) {
+	size_t r = read.load(std::memory_order_relaxed);
+	size_t w = written.load(std::memory_order_acquire);
+	frames = std::min(frames, w - r);
+
+	// Copy in up to two parts as the buffered frames may wrap around the end
+	size_t offset = r % capacity;
+	size_t first = std::min(frames, capacity - offset);
+	memcpy(dest, &data[offset * frame_size], first * frame_size);
+	if (frames > first)
+		memcpy(static_cast<char *>(dest) + first * frame_size, &data[0], (frames - first) * frame_size);
+
+	read.store(r + frames, std::memory_order_release);
+	return frames;
+}
+
+void AudioRingBuffer::Clear() {
+	written = 0;
+	read = 0;
+}
+
+AudioPlaybackFeed::AudioPlaybackFeed(AudioProvider *provider, size_t buffer_frames, AudioPlaybackStats *stats)
+: provider(provider)
+, stats(stats)
+, frame_size(provider->GetChannels() * provider->GetBytesPerSample())
+, ring(buffer_frames, frame_size)
+, chunk_frames(std::max<size_t>(std::min<size_t>(ring.Capacity() / 4, provider->GetSampleRate() / 20), 1))
+, thread(&AudioPlaybackFeed::FeedThread, this)
+{
+}
+
+AudioPlaybackFeed::~AudioPlaybackFeed() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		quit = true;
+		cond.notify_all();
+	}
+	thread.join();
+}
+
+void AudioPlaybackFeed::FeedThread() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!quit) {
+		int64_t remaining = end_position - fill_position;
+		if (remaining <= 0) {
+			cond.wait(lock);
+			continue;
+		}
+
+		size_t frames;
+		char *dest = ring.WritePointer(frames);
+		if (frames == 0) {
+			cond.wait_for(lock, poll_interval);
+			continue;
+		}
+		frames = static_cast<size_t>(std::min<int64_t>(std::min(frames, chunk_frames), remaining));
+
+		// Read without holding the lock so that a slow read doesn't hold up
+		// Start and Stop; if either is called meanwhile the chunk is discarded
+		auto read_generation = generation;
+		auto position = fill_position;
+		lock.unlock();
+		auto read_start = AudioPlaybackStats::Now();
+		try {
+			provider->GetAudio(dest, position, frames);
+			if (stats) stats->AddProviderRead(read_start);
+		}
+		catch (agi::Exception const& e) {
+			LOG_E("audio/player/feed") << "Reading audio failed: " << e.GetMessage();
+			memset(dest, 0, frames * frame_size);
+		}
+		lock.lock();
+
+		if (read_generation != generation) continue;
+		ring.CommitWrite(frames);
+		fill_position += frames;
+		cond.notify_all();
+	}
+}
+
+void AudioPlaybackFeed::Start(int64_t start, int64_t end) {
+	std::unique_lock<std::mutex> lock(mutex);
+	++generation;
+	ring.Clear();
+	fill_position = start;
+	read_position = start;
+	start_position = start;
+	end_position = end;
+	cond.notify_all();
+}
+
+void AudioPlaybackFeed::Stop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	++generation;
+	ring.Clear();
+	fill_position = read_position;
+	end_position = read_position.load();
+	cond.notify_all();
+}
+
+void AudioPlaybackFeed::SetEndPosition(int64_t end) {
+	std::unique_lock<std::mutex> lock(mutex);
+	end_position = end;
+	cond.notify_all();
+}
+
+size_t AudioPlaybackFeed::Available() const {
+	int64_t remaining = end_position - read_position;
+	return static_cast<size_t>(std::max<int64_t>(std::min<int64_t>(ring.Available(), remaining), 0));
+}
+
+size_t AudioPlaybackFeed::Read(void *dest, size_t frames) {
+	int64_t position = read_position;
+	int64_t end = end_position;
+	int64_t remaining = end - position;
+	if (remaining <= 0) return 0;
+
+	size_t wanted = static_cast<size_t>(std::min<int64_t>(frames, remaining));
+	frames = ring.Read(dest, wanted);
+	read_position = position + frames;
+	if (frames < wanted && stats)
+		stats->AddUnderrun();
+
+	double vol = volume;
+	int64_t fade = fade_frames;
+	int64_t start = start_position;
+	bool fading = fade > 0 && (position < start + fade || position + (int64_t)frames > end - fade);
+	if ((vol != 1.0 || fading) && provider->GetBytesPerSample() == 2) {
+		auto buffer = static_cast<int16_t *>(dest);
+		int channels = provider->GetChannels();
+		for (size_t i = 0; i < frames; ++i) {
+			double gain = vol;
+			if (fading) {
+				int64_t edge = std::min(position + (int64_t)i - start, end - position - (int64_t)i);
+				if (edge < fade)
+					gain *= double(edge) / fade;
+			}
+			for (int c = 0; c < channels; ++c) {
+				auto& sample = buffer[i * channels + c];
+				sample = util::mid(-0x8000, static_cast<int>(sample * gain + 0.5), 0x7FFF);
+			}
+		}
+	}
+	return frames;
+}
+
+bool AudioPlaybackFeed::WaitForPrefill(size_t frames, std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	return cond.wait_for(lock, timeout, [&] {
+		int64_t remaining = end_position - read_position;
+		return ring.Available() >= static_cast<size_t>(std::max<int64_t>(std::min<int64_t>(frames, remaining), 0));
+	});
+}
+}
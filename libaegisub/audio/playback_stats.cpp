@@ -0,0 +1,69 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/audio/playback_stats.h"
+
+#include "libaegisub/format.h"
+
+namespace agi {
+void AudioPlaybackStats::Counter::Add(clock::duration elapsed) {
+	int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+	++count;
+	total += us;
+	int64_t prev = max;
+	while (us > prev && !max.compare_exchange_weak(prev, us)) ;
+}
+
+AudioPlaybackStats::Timing AudioPlaybackStats::Counter::Get() const {
+	Timing timing;
+	timing.count = count;
+	timing.total = std::chrono::microseconds{total.load()};
+	timing.max = std::chrono::microseconds{max.load()};
+	return timing;
+}
+
+void AudioPlaybackStats::PlayStarted() {
+	play_started = clock::now().time_since_epoch().count();
+}
+
+void AudioPlaybackStats::AudioWritten() {
+	auto started = play_started.exchange(0);
+	if (started)
+		start_latency.Add(clock::now() - clock::time_point(clock::duration(started)));
+}
+
+AudioPlaybackStats::Totals AudioPlaybackStats::Get() const {
+	Totals totals;
+	totals.start_latency = start_latency.Get();
+	totals.callback = callback.Get();
+	totals.provider_read = provider_read.Get();
+	totals.underruns = underruns;
+	return totals;
+}
+
+std::string AudioPlaybackStats::Summary() const {
+	auto totals = Get();
+	auto ms = [](std::chrono::microseconds us) { return us.count() / 1000.0; };
+	return agi::format("start latency %.1f ms avg / %.1f ms max over %d starts, "
+		"callbacks %.2f ms avg / %.2f ms max, provider reads %.2f ms avg / %.2f ms max, "
+		"%d underruns",
+		ms(totals.start_latency.Average()), ms(totals.start_latency.max), totals.start_latency.count,
+		ms(totals.callback.Average()), ms(totals.callback.max),
+		ms(totals.provider_read.Average()), ms(totals.provider_read.max),
+		totals.underruns);
+}
+}
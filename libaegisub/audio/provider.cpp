@@ -16,6 +16,7 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "libaegisub/background_runner.h"
 #include "libaegisub/fs.h"
 #include "libaegisub/io.h"
 #include "libaegisub/log.h"
@@ -58,6 +59,8 @@ void AudioProvider::GetAudio(void *buf, int64_t start, int64_t count) const {
 
 	if (count <= 0) return;
 
+	RequestDecode(start, count);
+
 	try {
 		FillBuffer(buf, start, count);
 	}
@@ -75,6 +78,101 @@ void AudioProvider::GetAudio(void *buf, int64_t start, int64_t count) const {
 	}
 }
 
+void AudioProvider::VisitCopy(int64_t start, int64_t count, AudioVisitor const& visitor) const {
+	char buffer[16384];
+	const int64_t frame_size = bytes_per_sample * channels;
+	const int64_t piece = sizeof(buffer) / frame_size;
+	while (count > 0) {
+		auto read = std::min(count, piece);
+		GetAudio(buffer, start, read);
+		visitor(buffer, read);
+		start += read;
+		count -= read;
+	}
+}
+
+void AudioProvider::VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const {
+	VisitCopy(start, count, visitor);
+}
+
+void AudioProvider::VisitAudio(int64_t start, int64_t count, AudioVisitor const& visitor) const {
+	if (count <= 0) return;
+
+	if (start < 0) {
+		auto silence = std::min(-start, count);
+		VisitCopy(start, silence, visitor);
+		start += silence;
+		count -= silence;
+	}
+
+	auto inside = std::min(count, std::max<int64_t>(0, num_samples - start));
+	if (inside > 0) {
+		RequestDecode(start, inside);
+		VisitBuffer(start, inside, visitor);
+	}
+
+	if (count > inside)
+		VisitCopy(start + inside, count - inside, visitor);
+}
+
+bool AudioProvider::IsDecoded(int64_t start, int64_t count) const {
+	if (auto schedule = GetDecodeSchedule())
+		return schedule->IsDecoded(start, count);
+	return std::min(start + count, num_samples) <= decoded_samples;
+}
+
+void AudioProvider::RequestDecode(int64_t start, int64_t count) const {
+	if (auto schedule = GetDecodeSchedule())
+		schedule->Request(start, count);
+}
+
+AudioPeak AudioProvider::GetPeaks(int64_t start, int64_t count) const {
+	if (bytes_per_sample != 2 || channels != 1)
+		throw agi::InternalError("GetPeaks called on unconverted audio stream");
+
+	AudioPeak peak;
+	auto accumulate_raw = [&](int64_t start, int64_t count) {
+		VisitAudio(start, count, [&](const void *samples, int64_t count) {
+			AccumulatePeak(peak, static_cast<const int16_t *>(samples), count);
+		});
+	};
+
+	int64_t end = start + count;
+	auto index = GetPeakIndex();
+	if (index) {
+		// Only the aligned middle of the range can be read from the index;
+		// the ragged ends and anything not yet indexed are read directly
+		const int64_t align = AudioPeakIndex::LevelSize(0);
+		int64_t first = std::max<int64_t>(0, (start + align - 1) / align * align);
+		int64_t last = std::min(end, num_samples) / align * align;
+		if (first < last) {
+			accumulate_raw(start, first - start);
+
+			// Split the middle into runs which are and aren't indexed, as the
+			// cache providers don't necessarily decode in order
+			const int64_t block = AudioPeakIndex::BlockSize();
+			for (int64_t run_start = first; run_start < last; ) {
+				bool indexed = index->IsIndexed(run_start, align);
+				int64_t run_end = std::min(last, (run_start / block + 1) * block);
+				while (run_end < last && index->IsIndexed(run_end, align) == indexed)
+					run_end = std::min(last, run_end + block);
+
+				if (indexed)
+					peak.Add(index->Summarize(run_start, run_end));
+				else
+					accumulate_raw(run_start, run_end - run_start);
+				run_start = run_end;
+			}
+
+			accumulate_raw(last, end - last);
+			return peak;
+		}
+	}
+
+	accumulate_raw(start, count);
+	return peak;
+}
+
 namespace {
 class writer {
 	io::Save outfile;
@@ -100,7 +198,7 @@ public:
 };
 }
 
-void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time) {
+void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time, ProgressSink *ps) {
 	const auto max_samples = provider.GetNumSamples();
 	const auto start_sample = std::min(max_samples, ((int64_t)start_time * provider.GetSampleRate() + 999) / 1000);
 	const auto end_sample = util::mid(start_sample, ((int64_t)end_time * provider.GetSampleRate() + 999) / 1000, max_samples);
@@ -108,30 +206,44 @@ void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int star
 	const size_t bytes_per_sample = provider.GetBytesPerSample() * provider.GetChannels();
 	const size_t bufsize = (end_sample - start_sample) * bytes_per_sample;
 
-	writer out{path};
-	out.write("RIFF");
-	out.write<int32_t>(bufsize + 36);
-
-	out.write("WAVEfmt ");
-	out.write<int32_t>(16); // Size of chunk
-	out.write<int16_t>(1);  // compression format (PCM)
-	out.write<int16_t>(provider.GetChannels());
-	out.write<int32_t>(provider.GetSampleRate());
-	out.write<int32_t>(provider.GetSampleRate() * provider.GetChannels() * provider.GetBytesPerSample());
-	out.write<int16_t>(provider.GetChannels() * provider.GetBytesPerSample());
-	out.write<int16_t>(provider.GetBytesPerSample() * 8);
-
-	out.write("data");
-	out.write<int32_t>(bufsize);
-
-	// samples per read
-	size_t spr = 65536 / bytes_per_sample;
-	std::vector<char> buf;
-	for (int64_t i = start_sample; i < end_sample; i += spr) {
-		spr = std::min<size_t>(spr, end_sample - i);
-		buf.resize(spr * bytes_per_sample);
-		provider.GetAudio(&buf[0], i, spr);
-		out.write(buf);
+	bool cancelled = false;
+	{
+		// Scoped so that the file is closed and renamed before it might be removed
+		writer out{path};
+		out.write("RIFF");
+		out.write<int32_t>(bufsize + 36);
+
+		out.write("WAVEfmt ");
+		out.write<int32_t>(16); // Size of chunk
+		out.write<int16_t>(1);  // compression format (PCM)
+		out.write<int16_t>(provider.GetChannels());
+		out.write<int32_t>(provider.GetSampleRate());
+		out.write<int32_t>(provider.GetSampleRate() * provider.GetChannels() * provider.GetBytesPerSample());
+		out.write<int16_t>(provider.GetChannels() * provider.GetBytesPerSample());
+		out.write<int16_t>(provider.GetBytesPerSample() * 8);
+
+		out.write("data");
+		out.write<int32_t>(bufsize);
+
+		// samples per read
+		size_t spr = 65536 / bytes_per_sample;
+		std::vector<char> buf;
+		for (int64_t i = start_sample; i < end_sample; i += spr) {
+			if (ps) {
+				if ((cancelled = ps->IsCancelled())) break;
+				ps->SetProgress(i - start_sample, end_sample - start_sample);
+			}
+
+			spr = std::min<size_t>(spr, end_sample - i);
+			buf.resize(spr * bytes_per_sample);
+			provider.GetAudio(&buf[0], i, spr);
+			out.write(buf);
+		}
 	}
+
+	// The header has already been written with the full size, so a partial
+	// clip would just look corrupt
+	if (cancelled)
+		fs::Remove(path);
 }
 }
@@ -19,154 +19,263 @@
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 
-#include <limits>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGI_CONVERT_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AGI_CONVERT_NEON
+#endif
 
 using namespace agi;
 
-/// Anything integral -> 16 bit signed machine-endian audio converter
 namespace {
-template<class Target>
-class BitdepthConvertAudioProvider final : public AudioProviderWrapper {
-	int src_bytes_per_sample;
-	mutable std::vector<uint8_t> src_buf;
+/// Interleaved samples converted at a time before being downmixed, sized to
+/// stay in L1 cache
+const size_t tile_samples = 2048;
+
+/// Most significant 16 bits of a little-endian integer sample
+///
+/// 8 bits per sample is assumed to be unsigned with a bias of 128, while
+/// everything else is assumed to be signed with zero bias
+inline int16_t IntToS16(const uint8_t *sample, int bytes) {
+	if (bytes == 1)
+		return static_cast<int16_t>((sample[0] - 128) * 256);
+	return static_cast<int16_t>(sample[bytes - 2] | sample[bytes - 1] << 8);
+}
 
-public:
-	BitdepthConvertAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
-		if (bytes_per_sample > 8)
-			throw AudioProviderError("Audio format converter: audio with bitdepths greater than 64 bits/sample is currently unsupported");
+/// Scale a float sample to 16 bits, clamping anything out of range and
+/// turning NaN into silence
+template<typename Float>
+inline int16_t FloatToS16(Float sample) {
+	Float scaled = sample < 0 ? sample * Float(32768) : sample * Float(32767);
+	if (scaled >= Float(32767)) return 32767;
+	if (scaled <= Float(-32768)) return -32768;
+	return scaled == scaled ? static_cast<int16_t>(scaled) : 0;
+}
 
-		src_bytes_per_sample = bytes_per_sample;
-		bytes_per_sample = sizeof(Target);
+/// Convert count floats to S16, returning how many were done
+size_t FloatToS16Vector(const float *src, int16_t *dst, size_t count) {
+	size_t i = 0;
+#ifdef AGI_CONVERT_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 neg_scale = _mm_set1_ps(32768.f), pos_scale = _mm_set1_ps(32767.f);
+	const __m128 lo = _mm_set1_ps(-32768.f), hi = _mm_set1_ps(32767.f);
+	auto convert = [&](__m128 x) {
+		__m128 neg = _mm_cmplt_ps(x, zero);
+		__m128 scale = _mm_or_ps(_mm_and_ps(neg, neg_scale), _mm_andnot_ps(neg, pos_scale));
+		__m128 y = _mm_mul_ps(x, scale);
+		y = _mm_and_ps(y, _mm_cmpord_ps(y, y));
+		return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(y, lo), hi));
+	};
+	for (; i + 8 <= count; i += 8) {
+		__m128i a = convert(_mm_loadu_ps(src + i));
+		__m128i b = convert(_mm_loadu_ps(src + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
 	}
+#elif defined(AGI_CONVERT_NEON)
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	const float32x4_t neg_scale = vdupq_n_f32(32768.f), pos_scale = vdupq_n_f32(32767.f);
+	const float32x4_t lo = vdupq_n_f32(-32768.f), hi = vdupq_n_f32(32767.f);
+	auto convert = [&](float32x4_t x) {
+		float32x4_t scale = vbslq_f32(vcltq_f32(x, zero), neg_scale, pos_scale);
+		float32x4_t y = vminq_f32(vmaxq_f32(vmulq_f32(x, scale), lo), hi);
+		// NaN propagates through min/max and converts to zero
+		return vqmovn_s32(vcvtq_s32_f32(y));
+	};
+	for (; i + 8 <= count; i += 8)
+		vst1q_s16(dst + i, vcombine_s16(convert(vld1q_f32(src + i)), convert(vld1q_f32(src + i + 4))));
+#else
+	(void)src; (void)dst; (void)count;
+#endif
+	return i;
+}
 
-	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
-		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
-
-		src_buf.resize(count * src_bytes_per_sample * channels);
-		source->GetAudio(src_buf.data(), start, count);
-
-		auto dest = static_cast<int16_t*>(buf);
-
-		for (int64_t i = 0; i < count * channels; ++i) {
-			int64_t sample = 0;
-
-			// 8 bits per sample is assumed to be unsigned with a bias of 127,
-			// while everything else is assumed to be signed with zero bias
-			if (src_bytes_per_sample == 1)
-				sample = src_buf[i] - 128;
-			else {
-				for (int j = src_bytes_per_sample; j > 0; --j) {
-					sample <<= 8;
-					sample += src_buf[i * src_bytes_per_sample + j - 1];
-				}
-			}
-
-			if (static_cast<size_t>(src_bytes_per_sample) > sizeof(Target))
-				sample /= 1LL << (src_bytes_per_sample - sizeof(Target)) * 8;
-			else if (static_cast<size_t>(src_bytes_per_sample) < sizeof(Target))
-				sample *=  1LL << (sizeof(Target) - src_bytes_per_sample ) * 8;
-
-			dest[i] = static_cast<Target>(sample);
-		}
+/// Average interleaved stereo frames, returning how many were done
+size_t DownmixStereoVector(const int16_t *src, int16_t *dst, size_t frames) {
+	size_t i = 0;
+#ifdef AGI_CONVERT_SSE2
+	const __m128i ones = _mm_set1_epi16(1);
+	// Divide the 32-bit sums by two, rounding towards zero like the scalar path
+	auto halve = [](__m128i sum) {
+		return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+	};
+	for (; i + 8 <= frames; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 8));
+		__m128i mixed = _mm_packs_epi32(halve(_mm_madd_epi16(a, ones)), halve(_mm_madd_epi16(b, ones)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), mixed);
 	}
-};
-
-/// Floating point -> 16 bit signed machine-endian audio converter
-template<class Source, class Target>
-class FloatConvertAudioProvider final : public AudioProviderWrapper {
-	mutable std::vector<Source> src_buf;
-
-public:
-	FloatConvertAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
-		bytes_per_sample = sizeof(Target);
-		float_samples = false;
+#elif defined(AGI_CONVERT_NEON)
+	auto halve = [](int32x4_t sum) {
+		int32x4_t sign = vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(sum), 31));
+		return vmovn_s32(vshrq_n_s32(vaddq_s32(sum, sign), 1));
+	};
+	for (; i + 8 <= frames; i += 8) {
+		int16x8x2_t lr = vld2q_s16(src + i * 2);
+		int32x4_t low = vaddl_s16(vget_low_s16(lr.val[0]), vget_low_s16(lr.val[1]));
+		int32x4_t high = vaddl_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[1]));
+		vst1q_s16(dst + i, vcombine_s16(halve(low), halve(high)));
 	}
+#else
+	(void)src; (void)dst; (void)frames;
+#endif
+	return i;
+}
 
-	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
-		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
-
-		src_buf.resize(count * channels);
-		source->GetAudio(&src_buf[0], start, count);
+/// Average the channels of interleaved S16 frames together
+void Downmix(const int16_t *src, int16_t *dst, size_t frames, int channels) {
+	size_t i = 0;
+	if (channels == 1) {
+		if (src != dst)
+			memcpy(dst, src, frames * sizeof(int16_t));
+		return;
+	}
+	if (channels == 2)
+		i = DownmixStereoVector(src, dst, frames);
+
+	for (; i < frames; ++i) {
+		int sum = 0;
+		for (int c = 0; c < channels; ++c)
+			sum += src[i * channels + c];
+		dst[i] = static_cast<int16_t>(sum / channels);
+	}
+}
 
-		auto dest = static_cast<Target*>(buf);
+/// Any supported format, channel count and sample rate -> 16 bit signed
+/// machine-endian mono at 32 kHz or more
+///
+/// Every source sample is converted to S16, downmixed and interpolated in a
+/// single pass over reusable buffers rather than by a stack of wrappers each
+/// with their own copy of the audio.
+class ConvertAudioProvider final : public AudioProviderWrapper {
+	int src_bytes_per_sample;
+	bool src_float;
+	int src_channels;
+	/// Number of times the source sample rate is doubled, with linear interpolation
+	int doublings = 0;
 
-		for (size_t i = 0; i < static_cast<size_t>(count * channels); ++i) {
-			Source expanded;
-			if (src_buf[i] < 0)
-				expanded = static_cast<Target>(-src_buf[i] * std::numeric_limits<Target>::min());
-			else
-				expanded = static_cast<Target>(src_buf[i] * std::numeric_limits<Target>::max());
+	mutable std::vector<uint8_t> src_buf;
+	mutable std::vector<int16_t> tile_buf;
+	mutable std::vector<int16_t> mono_buf;
+	mutable std::vector<int16_t> double_buf;
+
+	/// Convert and downmix frames source frames into dst
+	void Convert(const uint8_t *src, int16_t *dst, size_t frames) const {
+		if (!src_float && src_bytes_per_sample == 2) {
+			Downmix(reinterpret_cast<const int16_t *>(src), dst, frames, src_channels);
+			return;
+		}
 
-			dest[i] = expanded < std::numeric_limits<Target>::min() ? std::numeric_limits<Target>::min() :
-			          expanded > std::numeric_limits<Target>::max() ? std::numeric_limits<Target>::max() :
-			                                                          static_cast<Target>(expanded);
+		// Mono audio can be converted straight into the destination
+		size_t tile_frames = src_channels == 1 ? frames : tile_buf.size() / src_channels;
+		size_t frame_bytes = src_bytes_per_sample * src_channels;
+		for (size_t done = 0; done < frames; done += tile_frames) {
+			size_t n = std::min(tile_frames, frames - done);
+			int16_t *tile = src_channels == 1 ? dst + done : tile_buf.data();
+			ToS16(src + done * frame_bytes, tile, n * src_channels);
+			Downmix(tile, dst + done, n, src_channels);
 		}
 	}
-};
 
-/// Non-mono 16-bit signed machine-endian -> mono 16-bit signed machine endian converter
-class DownmixAudioProvider final : public AudioProviderWrapper {
-	int src_channels;
-	mutable std::vector<int16_t> src_buf;
+	/// Convert count interleaved samples in the source format to S16
+	void ToS16(const uint8_t *src, int16_t *dst, size_t count) const {
+		if (!src_float) {
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = IntToS16(src + i * src_bytes_per_sample, src_bytes_per_sample);
+		}
+		else if (src_bytes_per_sample == sizeof(float)) {
+			auto samples = reinterpret_cast<const float *>(src);
+			for (size_t i = FloatToS16Vector(samples, dst, count); i < count; ++i)
+				dst[i] = FloatToS16(samples[i]);
+		}
+		else {
+			auto samples = reinterpret_cast<const double *>(src);
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = FloatToS16(samples[i]);
+		}
+	}
 
 public:
-	DownmixAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
+	ConvertAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
+		if (bytes_per_sample > 8)
+			throw AudioProviderError("Audio format converter: audio with bitdepths greater than 64 bits/sample is currently unsupported");
+		if (float_samples && bytes_per_sample != sizeof(float) && bytes_per_sample != sizeof(double))
+			throw AudioProviderError("Audio format converter: unsupported floating point sample size");
+
+		src_bytes_per_sample = bytes_per_sample;
+		src_float = float_samples;
 		src_channels = channels;
-		channels = 1;
-	}
 
-	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
-		auto count = static_cast<size_t>(count64);
-		assert(count == count64);
-
-		src_buf.resize(count * src_channels);
-		source->GetAudio(&src_buf[0], start, count);
-
-		auto dst = static_cast<int16_t*>(buf);
-		// Just average the channels together
-		while (count-- > 0) {
-			int sum = 0;
-			for (int c = 0; c < src_channels; ++c)
-				sum += src_buf[count * src_channels + c];
-			dst[count] = static_cast<int16_t>(sum / src_channels);
+		// Some players don't like low sample rate audio
+		while (sample_rate > 0 && sample_rate < 32000) {
+			sample_rate *= 2;
+			++doublings;
 		}
-	}
-};
+		num_samples <<= doublings;
+		decoded_samples = decoded_samples << doublings;
 
-/// Sample doubler with linear interpolation for the samples provider
-/// Requires 16-bit mono input
-class SampleDoublingAudioProvider final : public AudioProviderWrapper {
-public:
-	SampleDoublingAudioProvider(std::unique_ptr<AudioProvider> src) : AudioProviderWrapper(std::move(src)) {
-		sample_rate *= 2;
-		num_samples *= 2;
-		decoded_samples = decoded_samples * 2;
+		bytes_per_sample = sizeof(int16_t);
+		float_samples = false;
+		channels = 1;
+		if (src_channels > 1)
+			tile_buf.resize(std::max<size_t>(tile_samples / src_channels, 1) * src_channels);
 	}
 
-	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
-		int16_t *src, *dst = static_cast<int16_t *>(buf);
+	std::unique_ptr<AudioProvider> Reopen() const override {
+		auto copy = source->Reopen();
+		if (!copy) return nullptr;
+		return agi::make_unique<ConvertAudioProvider>(std::move(copy));
+	}
 
-		// We need to always get at least two samples to be able to interpolate
-		int16_t srcbuf[2];
-		if (count == 1) {
-			source->GetAudio(srcbuf, start / 2, 2);
-			src = srcbuf;
+	void FillBuffer(void *buf, int64_t start, int64_t count64) const override {
+		auto dst = static_cast<int16_t *>(buf);
+
+		// Work back from the requested range to the source samples needed,
+		// as each doubling needs one sample past the end to interpolate from
+		int64_t starts[32], counts[32];
+		starts[doublings] = start;
+		counts[doublings] = count64;
+		for (int level = doublings; level > 0; --level) {
+			starts[level - 1] = starts[level] / 2;
+			counts[level - 1] = (starts[level] + counts[level]) / 2 - starts[level - 1] + 1;
 		}
-		else {
-			source->GetAudio(buf, start / 2, (start + count) / 2 - start / 2 + 1);
-			src = dst;
+
+		auto count = static_cast<size_t>(counts[0]);
+		assert(static_cast<int64_t>(count) == counts[0]);
+		src_buf.resize(count * src_bytes_per_sample * src_channels);
+		source->GetAudio(src_buf.data(), starts[0], count);
+
+		if (!doublings) {
+			Convert(src_buf.data(), dst, count);
+			return;
 		}
 
-		// walking backwards so that the conversion can be done in place
-		for (; count > 0; --count) {
-			auto src_index = (start + count - 1) / 2 - start / 2;
-			auto i = count - 1;
-			if ((start + i) & 1)
-				dst[i] = (int16_t)(((int32_t)src[src_index] + src[src_index + 1]) / 2);
-			else
-				dst[i] = src[src_index];
+		mono_buf.resize(count);
+		Convert(src_buf.data(), mono_buf.data(), count);
+
+		for (int level = 1; level <= doublings; ++level) {
+			int16_t *out = dst;
+			if (level < doublings) {
+				double_buf.resize(static_cast<size_t>(counts[level]));
+				out = double_buf.data();
+			}
+
+			const int16_t *in = mono_buf.data();
+			for (int64_t i = 0; i < counts[level]; ++i) {
+				auto pos = starts[level] + i;
+				auto src_index = pos / 2 - starts[level - 1];
+				if (pos & 1)
+					out[i] = (int16_t)(((int32_t)in[src_index] + in[src_index + 1]) / 2);
+				else
+					out[i] = in[src_index];
+			}
+
+			if (level < doublings)
+				mono_buf.swap(double_buf);
 		}
 	}
 };
@@ -174,31 +283,13 @@ public:
 
 namespace agi {
 std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioProvider> provider) {
-	// Ensure 16-bit audio with proper endianness
-	if (provider->AreSamplesFloat()) {
-		LOG_D("audio_provider") << "Converting float to S16";
-		if (provider->GetBytesPerSample() == sizeof(float))
-			provider = agi::make_unique<FloatConvertAudioProvider<float, int16_t>>(std::move(provider));
-		else
-			provider = agi::make_unique<FloatConvertAudioProvider<double, int16_t>>(std::move(provider));
-	}
-	if (provider->GetBytesPerSample() != 2) {
-		LOG_D("audio_provider") << "Converting " << provider->GetBytesPerSample() << " bytes per sample or wrong endian to S16";
-		provider = agi::make_unique<BitdepthConvertAudioProvider<int16_t>>(std::move(provider));
-	}
-
-	// We currently only support mono audio
-	if (provider->GetChannels() != 1) {
-		LOG_D("audio_provider") << "Downmixing to mono from " << provider->GetChannels() << " channels";
-		provider = agi::make_unique<DownmixAudioProvider>(std::move(provider));
-	}
-
-	// Some players don't like low sample rate audio
-	while (provider->GetSampleRate() < 32000) {
-		LOG_D("audio_provider") << "Doubling sample rate";
-		provider = agi::make_unique<SampleDoublingAudioProvider>(std::move(provider));
-	}
-
-	return provider;
+	if (!provider->AreSamplesFloat() && provider->GetBytesPerSample() == 2 &&
+		provider->GetChannels() == 1 && provider->GetSampleRate() >= 32000)
+		return provider;
+
+	LOG_D("audio_provider") << "Converting " << provider->GetChannels() << " channel "
+		<< provider->GetBytesPerSample() << " byte " << (provider->AreSamplesFloat() ? "float" : "integer")
+		<< " audio at " << provider->GetSampleRate() << " Hz to S16 mono";
+	return agi::make_unique<ConvertAudioProvider>(std::move(provider));
 }
 }
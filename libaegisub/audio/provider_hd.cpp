@@ -16,6 +16,7 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include <libaegisub/dispatch.h>
 #include <libaegisub/file_mapping.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
@@ -25,6 +26,7 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/detail/os_thread_functions.hpp>
 #include <ctime>
+#include <mutex>
 #include <thread>
 
 namespace {
@@ -32,23 +34,59 @@ using namespace agi;
 
 class HDAudioProvider final : public AudioProviderWrapper {
 	mutable temp_file_mapping file;
-	std::atomic<bool> cancelled = {false};
-	std::thread decoder;
+	/// The mapping only has one read region, so concurrent readers take turns
+	mutable std::mutex read_mutex;
+	/// Likewise for the write region and the decoders
+	std::mutex write_mutex;
+	std::unique_ptr<AudioPeakIndex> peaks;
+	std::unique_ptr<AudioEnergyEnvelope> envelope;
+	AudioDecodeSchedule schedule;
+	dispatch::CancellationToken cancel;
+	std::vector<std::thread> decoders;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
-		auto missing = std::min(count, start + count - decoded_samples);
-		if (missing > 0) {
-			memset(static_cast<int16_t*>(buf) + count - missing, 0, missing * bytes_per_sample);
-			count -= missing;
+		auto out = static_cast<char *>(buf);
+		const int64_t chunk_size = schedule.ChunkSize();
+		while (count > 0) {
+			// Copy runs of decoded chunks in one go, and zero the rest
+			const bool decoded = schedule.IsDecoded(start, 1);
+			int64_t run = std::min(count, chunk_size - start % chunk_size);
+			while (run < count && schedule.IsDecoded(start + run, 1) == decoded)
+				run = std::min(count, run + chunk_size);
+
+			if (decoded) {
+				std::lock_guard<std::mutex> lock(read_mutex);
+				memcpy(out, file.read(start * bytes_per_sample, run * bytes_per_sample), run * bytes_per_sample);
+			}
+			else
+				memset(out, 0, run * bytes_per_sample);
+
+			out += run * bytes_per_sample;
+			start += run;
+			count -= run;
 		}
+	}
 
-		if (count > 0) {
-			start *= bytes_per_sample;
-			count *= bytes_per_sample;
-			memcpy(buf, file.read(start, count), count);
+	void VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const override {
+		// A chunk at a time, so that the lock isn't held for long by a
+		// visitor with a lot to look at
+		const int64_t chunk_size = schedule.ChunkSize();
+		while (count > 0) {
+			int64_t run = std::min(count, chunk_size - start % chunk_size);
+			if (schedule.IsDecoded(start, 1)) {
+				std::lock_guard<std::mutex> lock(read_mutex);
+				visitor(file.read(start * bytes_per_sample, run * bytes_per_sample), run);
+			}
+			else
+				VisitCopy(start, run, visitor);
+			start += run;
+			count -= run;
 		}
 	}
 
+	const AudioPeakIndex *GetPeakIndex() const override { return peaks.get(); }
+	const AudioDecodeSchedule *GetDecodeSchedule() const override { return &schedule; }
+
 	fs::path CacheFilename(fs::path const& dir) {
 		// Check free space
 		if ((uint64_t)num_samples * bytes_per_sample > fs::FreeSpace(dir))
@@ -59,31 +97,46 @@ class HDAudioProvider final : public AudioProviderWrapper {
 	}
 
 public:
-	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir)
+	HDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir, int threads)
 	: AudioProviderWrapper(std::move(src))
 	, file(dir / CacheFilename(dir), num_samples * bytes_per_sample)
+	, schedule(num_samples, 65536, decoded_samples)
 	{
-		decoded_samples = 0;
-		decoder = std::thread([&] {
-			int64_t block = 65536;
-			for (int64_t i = 0; i < num_samples; i += block) {
-				if (cancelled) break;
-				block = std::min(block, num_samples - i);
-				source->GetAudio(file.write(i * bytes_per_sample, block * bytes_per_sample), i, block);
-				decoded_samples += block;
+		if (bytes_per_sample == 2 && channels == 1) {
+			peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+			envelope = agi::make_unique<AudioEnergyEnvelope>(num_samples, sample_rate);
+		}
+
+		decoders = schedule.StartDecoders(*source, threads, cancel, [&](AudioProvider const& src, size_t i) {
+			const int64_t start = i * schedule.ChunkSize();
+			const int64_t block = std::min(schedule.ChunkSize(), num_samples - start);
+
+			// Decode into a buffer of the decoder's own so that the write
+			// region is only held for the copy
+			std::vector<char> buffer(block * bytes_per_sample);
+			src.GetAudio(buffer.data(), start, block);
+			if (peaks) {
+				peaks->Add(reinterpret_cast<int16_t *>(buffer.data()), start, block);
+				envelope->Add(reinterpret_cast<int16_t *>(buffer.data()), start, block);
 			}
+
+			std::lock_guard<std::mutex> lock(write_mutex);
+			memcpy(file.write(start * bytes_per_sample, buffer.size()), buffer.data(), buffer.size());
 		});
 	}
 
+	const AudioEnergyEnvelope *GetEnergyEnvelope() const override { return envelope.get(); }
+
 	~HDAudioProvider() {
-		cancelled = true;
-		decoder.join();
+		cancel.Cancel();
+		for (auto& decoder : decoders)
+			decoder.join();
 	}
 };
 }
 
 namespace agi {
-std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir) {
-	return agi::make_unique<HDAudioProvider>(std::move(src), dir);
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& dir, int threads) {
+	return agi::make_unique<HDAudioProvider>(std::move(src), dir, threads);
 }
 }
@@ -0,0 +1,368 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/provider.h"
+
+#include <libaegisub/dispatch.h>
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/make_unique.h>
+
+#include <array>
+#include <boost/filesystem/path.hpp>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+using namespace agi;
+
+/// Samples in each independently decodable chunk
+const int64_t chunk_samples = 4096;
+
+/// Chunk header value marking a chunk stored without compression
+const uint8_t raw_chunk = 0xFF;
+
+/// Longest unary quotient written before falling back to the raw value
+const int max_quotient = 24;
+
+class BitWriter {
+	std::vector<uint8_t> &out;
+	uint64_t acc = 0;
+	int bits = 0;
+
+public:
+	BitWriter(std::vector<uint8_t> &out) : out(out) { }
+
+	/// Append the low count bits of value, count <= 32
+	void Put(uint32_t value, int count) {
+		acc |= ((uint64_t)value & ((UINT64_C(1) << count) - 1)) << bits;
+		bits += count;
+		while (bits >= 8) {
+			out.push_back(static_cast<uint8_t>(acc));
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+
+	void Flush() {
+		if (bits)
+			out.push_back(static_cast<uint8_t>(acc));
+		acc = 0;
+		bits = 0;
+	}
+};
+
+class BitReader {
+	const uint8_t *data, *end;
+	uint64_t acc = 0;
+	int bits = 0;
+
+public:
+	BitReader(const uint8_t *data, size_t size) : data(data), end(data + size) { }
+
+	/// Read count bits, count <= 32
+	uint32_t Get(int count) {
+		while (bits < count) {
+			acc |= (uint64_t)(data < end ? *data++ : 0) << bits;
+			bits += 8;
+		}
+		uint32_t value = static_cast<uint32_t>(acc & ((UINT64_C(1) << count) - 1));
+		acc >>= count;
+		bits -= count;
+		return value;
+	}
+};
+
+/// Residual of each sample from a second-order fixed predictor, zigzag
+/// encoded so that small magnitudes of either sign give small values
+uint32_t Residual(const int16_t *samples, int64_t i) {
+	int32_t predicted = i > 1 ? 2 * samples[i - 1] - samples[i - 2] : i > 0 ? samples[i - 1] : 0;
+	int32_t residual = samples[i] - predicted;
+	return (static_cast<uint32_t>(residual) << 1) ^ static_cast<uint32_t>(residual >> 31);
+}
+
+/// Rice code a chunk of samples, falling back to storing them raw if
+/// that would be smaller
+void EncodeChunk(const int16_t *samples, int64_t count, std::vector<uint8_t> &out) {
+	out.clear();
+
+	uint64_t sum = 0;
+	for (int64_t i = 0; i < count; ++i)
+		sum += Residual(samples, i);
+
+	uint8_t k = 0;
+	while (k < 20 && (sum >> (k + 1)) >= static_cast<uint64_t>(count))
+		++k;
+
+	out.push_back(k);
+	BitWriter writer(out);
+	for (int64_t i = 0; i < count; ++i) {
+		uint32_t value = Residual(samples, i);
+		uint32_t quotient = value >> k;
+		if (quotient < max_quotient) {
+			writer.Put((1u << quotient) - 1, quotient + 1);
+			writer.Put(value, k);
+		}
+		else {
+			writer.Put((1u << max_quotient) - 1, max_quotient);
+			writer.Put(value, 32);
+		}
+	}
+	writer.Flush();
+
+	if (out.size() > 1 + count * sizeof(int16_t)) {
+		out.resize(1 + count * sizeof(int16_t));
+		out[0] = raw_chunk;
+		memcpy(&out[1], samples, count * sizeof(int16_t));
+	}
+}
+
+void DecodeChunk(const uint8_t *data, size_t size, int16_t *samples, int64_t count) {
+	if (data[0] == raw_chunk) {
+		memcpy(samples, data + 1, count * sizeof(int16_t));
+		return;
+	}
+
+	const int k = data[0];
+	BitReader reader(data + 1, size - 1);
+	for (int64_t i = 0; i < count; ++i) {
+		uint32_t quotient = 0;
+		while (quotient < max_quotient && reader.Get(1))
+			++quotient;
+		uint32_t value = quotient < max_quotient
+			? (quotient << k) | reader.Get(k)
+			: reader.Get(32);
+
+		int32_t residual = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+		int32_t predicted = i > 1 ? 2 * samples[i - 1] - samples[i - 2] : i > 0 ? samples[i - 1] : 0;
+		samples[i] = static_cast<int16_t>(predicted + residual);
+	}
+}
+
+/// @class CompressedHDAudioProvider
+/// @brief Caches the decoded audio in a losslessly compressed file which is kept between sessions
+///
+/// The file starts with a header describing the audio, followed by a seek
+/// table with the location of each chunk and then the chunks in the order
+/// they were decoded. A table entry is only written after its chunk, so a
+/// file left behind by an interrupted session can be resumed from the
+/// first chunk missing.
+class CompressedHDAudioProvider final : public AudioProviderWrapper {
+	struct Header {
+		char magic[8];
+		int64_t num_samples;
+		int64_t sample_rate;
+		uint64_t chunk_count;
+	};
+
+	struct TableEntry {
+		uint64_t offset;
+		uint32_t size;
+		uint32_t present;
+	};
+
+	struct DecodedChunk {
+		uint64_t index = UINT64_MAX;
+		std::vector<int16_t> samples;
+	};
+
+	/// Guards file, data_end and decoded
+	mutable std::mutex mutex;
+	mutable persistent_file_mapping file;
+	uint64_t chunk_count;
+	/// Offset one past the last chunk stored
+	uint64_t data_end = 0;
+	/// Recently decoded chunks, replaced round-robin
+	mutable std::array<DecodedChunk, 8> decoded;
+	mutable size_t next_decoded = 0;
+
+	std::unique_ptr<AudioPeakIndex> peaks;
+	std::unique_ptr<AudioEnergyEnvelope> envelope;
+	dispatch::CancellationToken cancel;
+	std::thread decoder;
+
+	uint64_t TableOffset(uint64_t i) const { return sizeof(Header) + i * sizeof(TableEntry); }
+	uint64_t DataStart() const { return TableOffset(chunk_count); }
+
+	TableEntry GetEntry(uint64_t i) const {
+		TableEntry entry;
+		memcpy(&entry, file.read(TableOffset(i), sizeof(entry)), sizeof(entry));
+		return entry;
+	}
+
+	/// Get a chunk, decoding it if it isn't one of the recently used ones
+	/// Must be called with the mutex held
+	const int16_t *GetChunk(uint64_t i) const {
+		for (auto const& chunk : decoded) {
+			if (chunk.index == i)
+				return chunk.samples.data();
+		}
+
+		auto &chunk = decoded[next_decoded];
+		next_decoded = (next_decoded + 1) % decoded.size();
+
+		auto entry = GetEntry(i);
+		int64_t count = std::min(chunk_samples, num_samples - (int64_t)i * chunk_samples);
+		chunk.samples.resize(count);
+		DecodeChunk(reinterpret_cast<const uint8_t *>(file.read(entry.offset, entry.size)),
+			entry.size, chunk.samples.data(), count);
+		chunk.index = i;
+		return chunk.samples.data();
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto out = static_cast<int16_t *>(buf);
+		auto missing = std::min(count, start + count - decoded_samples);
+		if (missing > 0) {
+			memset(out + count - missing, 0, missing * bytes_per_sample);
+			count -= missing;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		while (count > 0) {
+			uint64_t index = start / chunk_samples;
+			int64_t offset = start % chunk_samples;
+			int64_t n = std::min(count, chunk_samples - offset);
+			memcpy(out, GetChunk(index) + offset, n * bytes_per_sample);
+			out += n;
+			start += n;
+			count -= n;
+		}
+	}
+
+	const AudioPeakIndex *GetPeakIndex() const override { return peaks.get(); }
+
+	void Store(uint64_t i, std::vector<uint8_t> const& data) {
+		std::lock_guard<std::mutex> lock(mutex);
+		uint64_t end = data_end + data.size();
+		if (end > file.size())
+			// Grow in large steps to keep the number of remappings down
+			file.resize(std::max(end, file.size() + (16 << 20)));
+
+		memcpy(file.write(data_end, data.size()), data.data(), data.size());
+		TableEntry entry{data_end, static_cast<uint32_t>(data.size()), 1};
+		memcpy(file.write(TableOffset(i), sizeof(entry)), &entry, sizeof(entry));
+		data_end = end;
+	}
+
+	/// Open the cache file, discarding it if it's for different audio
+	/// @return Number of samples from the start which are already cached
+	int64_t Open(fs::path const& filename) {
+		Header header;
+		memcpy(header.magic, "AEGIAUC1", sizeof(header.magic));
+		header.num_samples = num_samples;
+		header.sample_rate = sample_rate;
+		header.chunk_count = chunk_count;
+
+		if (file.size() >= DataStart() && !memcmp(file.read(0, sizeof(Header)), &header, sizeof(Header))) {
+			// Resume from the first missing chunk, rounded down to a whole
+			// peak index block so that the index can be built in order
+			const uint64_t chunks_per_block = AudioPeakIndex::BlockSize() / chunk_samples;
+			uint64_t present = 0;
+			while (present < chunk_count && GetEntry(present).present)
+				++present;
+			if (present < chunk_count)
+				present -= present % chunks_per_block;
+
+			data_end = DataStart();
+			for (uint64_t i = 0; i < present; ++i) {
+				auto entry = GetEntry(i);
+				data_end = std::max<uint64_t>(data_end, entry.offset + entry.size);
+			}
+			if (data_end <= file.size()) {
+				for (uint64_t i = present; i < chunk_count; ++i) {
+					TableEntry entry{0, 0, 0};
+					memcpy(file.write(TableOffset(i), sizeof(entry)), &entry, sizeof(entry));
+				}
+				return std::min<int64_t>(present * chunk_samples, num_samples);
+			}
+		}
+
+		// Worst case every chunk is stored raw
+		if ((uint64_t)num_samples * bytes_per_sample > fs::FreeSpace(filename.parent_path()))
+			throw AudioProviderError("Not enough free disk space in " + filename.parent_path().string() + " to cache the audio");
+
+		file.resize(0);
+		file.resize(DataStart());
+		memcpy(file.write(0, sizeof(Header)), &header, sizeof(Header));
+		data_end = DataStart();
+		return 0;
+	}
+
+public:
+	CompressedHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& filename)
+	: AudioProviderWrapper(std::move(src))
+	, file(filename)
+	, chunk_count((num_samples + chunk_samples - 1) / chunk_samples)
+	{
+		if (bytes_per_sample != 2 || channels != 1)
+			throw InternalError("Compressed audio cache requires 16-bit mono audio");
+
+		const int64_t cached = Open(filename);
+		peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+		envelope = agi::make_unique<AudioEnergyEnvelope>(num_samples, sample_rate);
+
+		// Cached audio is available straight away, and the decoder only has
+		// to read it back to build the peak index
+		decoded_samples = cached;
+
+		decoder = std::thread([=] {
+			const int64_t block = AudioPeakIndex::BlockSize();
+			std::vector<int16_t> samples(block);
+			std::vector<uint8_t> encoded;
+
+			for (int64_t i = 0; i < num_samples; i += block) {
+				if (cancel.Cancelled()) break;
+				int64_t count = std::min(block, num_samples - i);
+
+				if (i < cached)
+					FillBuffer(samples.data(), i, count);
+				else {
+					source->GetAudio(samples.data(), i, count);
+					for (int64_t j = 0; j < count; j += chunk_samples) {
+						EncodeChunk(&samples[j], std::min(chunk_samples, count - j), encoded);
+						Store((i + j) / chunk_samples, encoded);
+					}
+					decoded_samples = i + count;
+				}
+
+				peaks->Add(samples.data(), i, count);
+				envelope->Add(samples.data(), i, count);
+			}
+		});
+	}
+
+	const AudioEnergyEnvelope *GetEnergyEnvelope() const override { return envelope.get(); }
+
+	~CompressedHDAudioProvider() {
+		cancel.Cancel();
+		decoder.join();
+
+		// Drop the unused space left over from growing in large steps
+		try {
+			file.resize(data_end);
+		}
+		catch (...) { }
+	}
+};
+}
+
+namespace agi {
+std::unique_ptr<AudioProvider> CreateCompressedHDAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& filename) {
+	return agi::make_unique<CompressedHDAudioProvider>(std::move(src), filename);
+}
+}
@@ -49,7 +49,7 @@ class PCMAudioProvider : public AudioProvider {
 			auto read_offset = start - pos;
 			auto read_count = std::min<size_t>(count, ip.num_samples - read_offset);
 			auto bytes = read_count * bps;
-			memcpy(write_buf, file.read(ip.start_byte + read_offset * bps, bytes), bytes);
+			Copy(write_buf, ip.start_byte + read_offset * bps, bytes);
 
 			write_buf += bytes;
 			count -= read_count;
@@ -59,8 +59,20 @@ class PCMAudioProvider : public AudioProvider {
 		ZeroFill(write_buf, count);
 	}
 
+	/// Copy from the file a window at a time, so that no read needs more
+	/// than one window of the file mapped
+	void Copy(char *dest, uint64_t offset, uint64_t bytes) const {
+		while (bytes) {
+			auto piece = std::min(bytes, file.window() - offset % file.window());
+			memcpy(dest, file.read(offset, piece), static_cast<size_t>(piece));
+			dest += piece;
+			offset += piece;
+			bytes -= piece;
+		}
+	}
+
 protected:
-	mutable read_file_mapping file;
+	mutable windowed_file_mapping file;
 	uint64_t file_pos = 0;
 
 	PCMAudioProvider(fs::path const& filename) : file(filename) { }
@@ -91,6 +103,8 @@ struct FourCC {
 };
 
 // Overview of RIFF WAV: https://docs.microsoft.com/en-us/previous-versions/windows/hardware/design/dn653308(v=vs.85)
+// RF64 and BW64 (EBU Tech 3306, ITU-R BS.2088) are the same thing with
+// 64-bit sizes stored in a 'ds64' chunk for files over 4 GB
 struct RiffWav {
 	using DataSize = uint32_t;
 	using ChunkId = FourCC;
@@ -100,6 +114,9 @@ struct RiffWav {
 	static const char *fmt_id()  { return "fmt "; }
 	static const char *data_id() { return "data"; }
 
+	static bool is_rf64(FourCC const& id) { return id == "RF64" || id == "BW64"; }
+	static bool is_ds64(FourCC const& id) { return id == "ds64"; }
+
 	static const int alignment = 1;
 
 	static uint32_t data_size(uint32_t size) { return size; }
@@ -138,6 +155,9 @@ struct Wave64 {
 	static GUID fmt_id()  { return w64Guidfmt; }
 	static GUID data_id() { return w64Guiddata; }
 
+	static bool is_rf64(GUID const&) { return false; }
+	static bool is_ds64(GUID const&) { return false; }
+
 	static const uint64_t alignment = 7ULL;
 
 	// Wave 64 includes the size of the header in the chunk sizes
@@ -155,8 +175,10 @@ public:
 		using ChunkId = typename Impl::ChunkId;
 
 		try {
-			auto data_left = std::numeric_limits<DataSize>::max();
-			if (Read<ChunkId>(&data_left) != Impl::riff_id())
+			uint64_t data_left = std::numeric_limits<DataSize>::max();
+			auto riff = Read<ChunkId>(&data_left);
+			bool rf64 = Impl::is_rf64(riff);
+			if (!rf64 && riff != Impl::riff_id())
 				throw AudioDataNotFound("File is not a RIFF file");
 
 			data_left = Impl::data_size(Read<DataSize>(&data_left));
@@ -164,15 +186,26 @@ public:
 			if (Read<ChunkId>(&data_left) != Impl::wave_id())
 				throw AudioDataNotFound("File is not a RIFF WAV file");
 
+			uint64_t rf64_data_size = 0;
 			while (data_left) {
 
 				auto chunk_fcc = Read<ChunkId>(&data_left);
-				auto chunk_size = Impl::chunk_size(Read<DataSize>(&data_left));
+				uint64_t chunk_size = Impl::chunk_size(Read<DataSize>(&data_left));
+
+				// RF64 sets the 32-bit size to -1 when the real one is in ds64
+				if (rf64 && chunk_size == 0xFFFFFFFF && chunk_fcc == Impl::data_id())
+					chunk_size = rf64_data_size;
 
 				uint64_t chunk_end = file_pos + chunk_size;
 				data_left -= std::min(chunk_size, data_left);
 
-				if (chunk_fcc == Impl::fmt_id()) {
+				if (rf64 && Impl::is_ds64(chunk_fcc)) {
+					auto riff_size = Read<uint64_t>(&chunk_size);
+					rf64_data_size = Read<uint64_t>(&chunk_size);
+					// The riff size counts everything after the first 8 bytes
+					data_left = riff_size - std::min(riff_size, chunk_end - 8);
+				}
+				else if (chunk_fcc == Impl::fmt_id()) {
 					if (channels || sample_rate || bytes_per_sample)
 						throw AudioProviderError("Multiple 'fmt ' chunks not supported");
 
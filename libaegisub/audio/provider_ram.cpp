@@ -16,7 +16,9 @@
 
 #include "libaegisub/audio/provider.h"
 
+#include "libaegisub/dispatch.h"
 #include "libaegisub/make_unique.h"
+#include "libaegisub/memory_budget.h"
 
 #include <array>
 #include <boost/container/stable_vector.hpp>
@@ -27,6 +29,8 @@ using namespace agi;
 
 #define CacheBits 22
 #define CacheBlockSize (1 << CacheBits)
+/// log2 of the number of decoded chunks in each cache block
+#define DecodeShift 5
 
 class RAMAudioProvider final : public AudioProviderWrapper {
 #ifdef _MSC_VER
@@ -34,17 +38,22 @@ class RAMAudioProvider final : public AudioProviderWrapper {
 #else
 	boost::container::stable_vector<std::array<char, CacheBlockSize>> blockcache;
 #endif
-	std::atomic<bool> cancelled = {false};
-	std::thread decoder;
+	std::unique_ptr<AudioPeakIndex> peaks;
+	std::unique_ptr<AudioEnergyEnvelope> envelope;
+	std::unique_ptr<AudioDecodeSchedule> schedule;
+	dispatch::CancellationToken cancel;
+	std::vector<std::thread> decoders;
+	MemoryBudget::Registration budget_registration;
 
 	void FillBuffer(void *buf, int64_t start, int64_t count) const override;
+	void VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const override;
+	const AudioPeakIndex *GetPeakIndex() const override { return peaks.get(); }
+	const AudioDecodeSchedule *GetDecodeSchedule() const override { return schedule.get(); }
 
 public:
-	RAMAudioProvider(std::unique_ptr<AudioProvider> src)
+	RAMAudioProvider(std::unique_ptr<AudioProvider> src, int threads)
 	: AudioProviderWrapper(std::move(src))
 	{
-		decoded_samples = 0;
-
 		try {
 			blockcache.resize((source->GetNumSamples() * source->GetBytesPerSample() + CacheBlockSize - 1) >> CacheBits);
 		}
@@ -52,45 +61,96 @@ public:
 			throw AudioProviderError("Not enough memory available to cache in RAM");
 		}
 
-		decoder = std::thread([&] {
-			int64_t readsize = CacheBlockSize / source->GetBytesPerSample();
-			for (size_t i = 0; i < blockcache.size(); i++) {
-				if (cancelled) break;
-				auto actual_read = std::min<int64_t>(readsize, num_samples - i * readsize);
-				source->GetAudio(&blockcache[i][0], i * readsize, actual_read);
-				decoded_samples += actual_read;
+		// The decoded audio can't be given back without reloading it, so
+		// it only takes room from the other caches
+		const size_t cache_bytes = blockcache.size() * CacheBlockSize;
+		budget_registration = GlobalMemoryBudget().Register("audio RAM cache", 0, 0,
+			[=] { return cache_bytes; }, nullptr);
+		GlobalMemoryBudget().Rebalance();
+
+		if (bytes_per_sample == 2 && channels == 1) {
+			peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+			envelope = agi::make_unique<AudioEnergyEnvelope>(num_samples, sample_rate);
+		}
+
+		// Decode in pieces much smaller than a cache block so that a request
+		// for somewhere else is picked up quickly
+		schedule = agi::make_unique<AudioDecodeSchedule>(num_samples, (CacheBlockSize >> DecodeShift) / bytes_per_sample, decoded_samples);
+
+		// Chunks never straddle cache blocks, so each decoder can write
+		// straight into them
+		decoders = schedule->StartDecoders(*source, threads, cancel, [&](AudioProvider const& src, size_t i) {
+			const int64_t start = i * schedule->ChunkSize();
+			const int64_t offset = start * bytes_per_sample;
+			auto data = &blockcache[offset >> CacheBits][offset & (CacheBlockSize - 1)];
+			auto actual_read = std::min<int64_t>(schedule->ChunkSize(), num_samples - start);
+			src.GetAudio(data, start, actual_read);
+			if (peaks) {
+				peaks->Add(reinterpret_cast<int16_t *>(data), start, actual_read);
+				envelope->Add(reinterpret_cast<int16_t *>(data), start, actual_read);
 			}
 		});
 	}
 
+	const AudioEnergyEnvelope *GetEnergyEnvelope() const override { return envelope.get(); }
+
 	~RAMAudioProvider() {
-		cancelled = true;
-		decoder.join();
+		cancel.Cancel();
+		for (auto& decoder : decoders)
+			decoder.join();
+		budget_registration.Release();
+		GlobalMemoryBudget().Rebalance();
 	}
 };
 
 void RAMAudioProvider::FillBuffer(void *buf, int64_t start, int64_t count) const {
 	auto charbuf = static_cast<char *>(buf);
+	const int64_t chunk_size = schedule->ChunkSize();
 	for (int64_t bytes_remaining = count * bytes_per_sample; bytes_remaining; ) {
-		if (start >= decoded_samples) {
-			memset(charbuf, 0, bytes_remaining);
-			break;
-		}
-
 		const int i = (start * bytes_per_sample) >> CacheBits;
 		const int start_offset = (start * bytes_per_sample) & (CacheBlockSize-1);
-		const int read_size = std::min<int>(bytes_remaining, CacheBlockSize - start_offset);
+		// Never read past the end of the decoded chunk containing start
+		const int chunk_remaining = (chunk_size - start % chunk_size) * bytes_per_sample;
+		const int read_size = std::min<int64_t>(bytes_remaining, chunk_remaining);
 
-		memcpy(charbuf, &blockcache[i][start_offset], read_size);
+		if (schedule->IsDecoded(start, 1))
+			memcpy(charbuf, &blockcache[i][start_offset], read_size);
+		else
+			memset(charbuf, 0, read_size);
 		charbuf += read_size;
 		bytes_remaining -= read_size;
 		start += read_size / bytes_per_sample;
 	}
 }
+
+void RAMAudioProvider::VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const {
+	const int64_t chunk_size = schedule->ChunkSize();
+	const int64_t block_samples = CacheBlockSize / bytes_per_sample;
+	while (count > 0) {
+		// Runs of decoded chunks within a cache block are contiguous, and
+		// anything else goes through FillBuffer to get silence
+		const bool decoded = schedule->IsDecoded(start, 1);
+		const int64_t block_end = (start / block_samples + 1) * block_samples;
+		int64_t run = std::min(count, chunk_size - start % chunk_size);
+		while (run < count && start + run < block_end && schedule->IsDecoded(start + run, 1) == decoded)
+			run = std::min(count, run + chunk_size);
+		run = std::min(run, block_end - start);
+
+		if (decoded) {
+			const int64_t offset = start * bytes_per_sample;
+			visitor(&blockcache[offset >> CacheBits][offset & (CacheBlockSize - 1)], run);
+		}
+		else
+			VisitCopy(start, run, visitor);
+
+		start += run;
+		count -= run;
+	}
+}
 }
 
 namespace agi {
-std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> src) {
-	return agi::make_unique<RAMAudioProvider>(std::move(src));
+std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> src, int threads) {
+	return agi::make_unique<RAMAudioProvider>(std::move(src), threads);
 }
 }
@@ -0,0 +1,255 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/audio/provider.h"
+
+#include <libaegisub/dispatch.h>
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/format.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/interprocess/detail/os_thread_functions.hpp>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+using namespace agi;
+
+struct Header {
+	char magic[8];
+	int64_t num_samples;
+	int32_t sample_rate;
+	int32_t channels;
+	int32_t bytes_per_sample;
+	int32_t float_samples;
+};
+
+/// Uncompressed audio cache which other processes can read
+///
+/// The cache file is only given its final name once all of the audio has
+/// been written to it, so any file with that name is complete and another
+/// instance opening the same audio maps it rather than decoding anything.
+/// As the mappings are of the same file, the OS keeps a single copy of the
+/// audio in memory for all of them.
+class SharedAudioProvider final : public AudioProviderWrapper {
+	fs::path filename;
+	fs::path partial_filename;
+
+	/// Another instance's finished cache, if there was one
+	mutable std::unique_ptr<windowed_file_mapping> shared;
+	/// The cache being written by this instance otherwise
+	mutable std::unique_ptr<persistent_file_mapping> own;
+	/// Guards the read region of whichever mapping is in use
+	mutable std::mutex read_mutex;
+	std::mutex write_mutex;
+
+	std::unique_ptr<AudioPeakIndex> peaks;
+	std::unique_ptr<AudioEnergyEnvelope> envelope;
+	AudioDecodeSchedule schedule;
+	std::atomic<size_t> chunks_written{0};
+	bool published = false;
+	dispatch::CancellationToken cancel;
+	std::vector<std::thread> decoders;
+
+	Header MakeHeader() const {
+		Header header;
+		memcpy(header.magic, "AEGIPCM1", sizeof(header.magic));
+		header.num_samples = num_samples;
+		header.sample_rate = sample_rate;
+		header.channels = channels;
+		header.bytes_per_sample = bytes_per_sample;
+		header.float_samples = float_samples;
+		return header;
+	}
+
+	uint64_t FileSize() const {
+		return sizeof(Header) + (uint64_t)num_samples * bytes_per_sample;
+	}
+
+	/// Map the cache left by another instance, if there is one for this audio
+	bool Attach() {
+		if (!fs::FileExists(filename)) return false;
+		try {
+			auto file = agi::make_unique<windowed_file_mapping>(filename);
+			auto header = MakeHeader();
+			if (file->size() != FileSize() || memcmp(file->read(0, sizeof(Header)), &header, sizeof(Header)))
+				return false;
+			shared = std::move(file);
+			return true;
+		}
+		catch (fs::FileSystemError const& e) {
+			LOG_W("audio/provider/shared") << "Not using " << filename << ": " << e.GetMessage();
+			return false;
+		}
+	}
+
+	/// Give the finished cache its final name so that other instances find it
+	void Publish() {
+		try {
+			fs::Rename(partial_filename, filename);
+			published = true;
+		}
+		catch (fs::FileSystemError const& e) {
+			// Most likely another instance published the same audio first and
+			// its cache is still open
+			LOG_D("audio/provider/shared") << "Not publishing " << filename << ": " << e.GetMessage();
+		}
+	}
+
+	/// Get a pointer to a range of cached audio, which must not cross a
+	/// window of the shared mapping. Must be called with read_mutex held.
+	const char *Read(int64_t start, int64_t count) const {
+		auto offset = sizeof(Header) + start * bytes_per_sample;
+		if (shared)
+			return shared->read(offset, count * bytes_per_sample);
+		return own->read(offset, count * bytes_per_sample);
+	}
+
+	/// Number of samples from start which can be read in one piece
+	int64_t RunLength(int64_t start, int64_t count) const {
+		if (shared) {
+			auto window = (int64_t)shared->window();
+			auto offset = (int64_t)sizeof(Header) + start * bytes_per_sample;
+			count = std::min(count, (window - offset % window) / bytes_per_sample);
+		}
+		return std::max<int64_t>(1, std::min(count, schedule.ChunkSize() - start % schedule.ChunkSize()));
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto out = static_cast<char *>(buf);
+		while (count > 0) {
+			int64_t run = RunLength(start, count);
+			if (shared || schedule.IsDecoded(start, 1)) {
+				std::lock_guard<std::mutex> lock(read_mutex);
+				memcpy(out, Read(start, run), run * bytes_per_sample);
+			}
+			else
+				memset(out, 0, run * bytes_per_sample);
+
+			out += run * bytes_per_sample;
+			start += run;
+			count -= run;
+		}
+	}
+
+	void VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const override {
+		while (count > 0) {
+			int64_t run = RunLength(start, count);
+			if (shared || schedule.IsDecoded(start, 1)) {
+				std::lock_guard<std::mutex> lock(read_mutex);
+				visitor(Read(start, run), run);
+			}
+			else
+				VisitCopy(start, run, visitor);
+			start += run;
+			count -= run;
+		}
+	}
+
+	const AudioPeakIndex *GetPeakIndex() const override { return peaks.get(); }
+	const AudioDecodeSchedule *GetDecodeSchedule() const override { return shared ? nullptr : &schedule; }
+
+	/// Build the peak index and envelope from another instance's audio
+	void IndexShared() {
+		decoders.emplace_back([=] {
+			const int64_t block = AudioPeakIndex::BlockSize();
+			std::vector<int16_t> samples(block);
+			for (int64_t i = 0; i < num_samples && !cancel.Cancelled(); i += block) {
+				int64_t count = std::min(block, num_samples - i);
+				FillBuffer(samples.data(), i, count);
+				peaks->Add(samples.data(), i, count);
+				envelope->Add(samples.data(), i, count);
+			}
+		});
+	}
+
+	void Decode(int threads) {
+		if ((uint64_t)num_samples * bytes_per_sample > fs::FreeSpace(filename.parent_path()))
+			throw AudioProviderError("Not enough free disk space in " + filename.parent_path().string() + " to cache the audio");
+
+		own = agi::make_unique<persistent_file_mapping>(partial_filename);
+		own->resize(FileSize());
+		auto header = MakeHeader();
+		memcpy(own->write(0, sizeof(Header)), &header, sizeof(Header));
+
+		const size_t chunk_count = (num_samples + schedule.ChunkSize() - 1) / schedule.ChunkSize();
+		decoders = schedule.StartDecoders(*source, threads, cancel, [=](AudioProvider const& src, size_t i) {
+			const int64_t start = i * schedule.ChunkSize();
+			const int64_t block = std::min(schedule.ChunkSize(), num_samples - start);
+
+			std::vector<char> buffer(block * bytes_per_sample);
+			src.GetAudio(buffer.data(), start, block);
+			if (peaks) {
+				peaks->Add(reinterpret_cast<int16_t *>(buffer.data()), start, block);
+				envelope->Add(reinterpret_cast<int16_t *>(buffer.data()), start, block);
+			}
+
+			std::lock_guard<std::mutex> lock(write_mutex);
+			memcpy(own->write(sizeof(Header) + start * bytes_per_sample, buffer.size()), buffer.data(), buffer.size());
+			if (++chunks_written == chunk_count)
+				Publish();
+		});
+	}
+
+public:
+	SharedAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& filename, int threads)
+	: AudioProviderWrapper(std::move(src))
+	, filename(filename)
+	, partial_filename(filename.string() + format(".%d.partial", boost::interprocess::ipcdetail::get_current_process_id()))
+	, schedule(num_samples, 65536, decoded_samples)
+	{
+		if (bytes_per_sample == 2 && channels == 1) {
+			peaks = agi::make_unique<AudioPeakIndex>(num_samples);
+			envelope = agi::make_unique<AudioEnergyEnvelope>(num_samples, sample_rate);
+		}
+
+		if (Attach()) {
+			decoded_samples = num_samples;
+			if (peaks) IndexShared();
+		}
+		else
+			Decode(threads);
+	}
+
+	const AudioEnergyEnvelope *GetEnergyEnvelope() const override { return envelope.get(); }
+
+	~SharedAudioProvider() {
+		cancel.Cancel();
+		for (auto& decoder : decoders)
+			decoder.join();
+
+		if (own && !published) {
+			own.reset();
+			try {
+				fs::Remove(partial_filename);
+			}
+			catch (fs::FileSystemError const& e) {
+				LOG_W("audio/provider/shared") << e.GetMessage();
+			}
+		}
+	}
+};
+}
+
+namespace agi {
+std::unique_ptr<AudioProvider> CreateSharedAudioProvider(std::unique_ptr<AudioProvider> src, agi::fs::path const& filename, int threads) {
+	return agi::make_unique<SharedAudioProvider>(std::move(src), filename, threads);
+}
+}
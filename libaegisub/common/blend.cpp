@@ -0,0 +1,131 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "libaegisub/blend.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGI_BLEND_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AGI_BLEND_NEON
+#endif
+
+namespace {
+/// x / 255 for x in [0, 255 * 255], without the division
+inline unsigned int Div255(unsigned int x) {
+	return (x + 1 + (x >> 8)) >> 8;
+}
+
+void BlendPixels(uint8_t *dst, const uint8_t *mask, int count, const unsigned int color[4], unsigned int opacity) {
+	for (int i = 0; i < count; ++i, dst += 4) {
+		if (!mask[i]) continue;
+		unsigned int k = Div255(mask[i] * opacity);
+		unsigned int ck = 255 - k;
+		for (int c = 0; c < 4; ++c)
+			dst[c] = Div255(k * color[c] + ck * dst[c]);
+	}
+}
+
+#ifdef AGI_BLEND_SSE2
+inline __m128i Div255(__m128i x) {
+	const __m128i one = _mm_set1_epi16(1);
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+}
+
+/// Blend two pixels, unpacked to 16 bits per channel, with the coverage
+/// for each repeated across its four channels
+inline __m128i Blend(__m128i pixels, __m128i k, __m128i color) {
+	const __m128i full = _mm_set1_epi16(255);
+	__m128i src = _mm_mullo_epi16(k, color);
+	__m128i dst = _mm_mullo_epi16(_mm_sub_epi16(full, k), pixels);
+	return Div255(_mm_add_epi16(src, dst));
+}
+
+/// Blend count pixels, which must be a multiple of 8
+void BlendVector(uint8_t *dst, const uint8_t *mask, int count, const unsigned int color[4], unsigned int opacity) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vcolor = _mm_setr_epi16(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+	const __m128i vopacity = _mm_set1_epi16(opacity);
+
+	for (int i = 0; i < count; i += 8, dst += 32) {
+		__m128i m = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(mask + i));
+		if ((_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) & 0xFF) == 0xFF)
+			continue;
+
+		__m128i k = Div255(_mm_mullo_epi16(_mm_unpacklo_epi8(m, zero), vopacity));
+		__m128i k_lo = _mm_unpacklo_epi16(k, k);
+		__m128i k_hi = _mm_unpackhi_epi16(k, k);
+
+		__m128i *out = reinterpret_cast<__m128i *>(dst);
+		__m128i p0 = _mm_loadu_si128(out);
+		__m128i p1 = _mm_loadu_si128(out + 1);
+		p0 = _mm_packus_epi16(
+			Blend(_mm_unpacklo_epi8(p0, zero), _mm_unpacklo_epi32(k_lo, k_lo), vcolor),
+			Blend(_mm_unpackhi_epi8(p0, zero), _mm_unpackhi_epi32(k_lo, k_lo), vcolor));
+		p1 = _mm_packus_epi16(
+			Blend(_mm_unpacklo_epi8(p1, zero), _mm_unpacklo_epi32(k_hi, k_hi), vcolor),
+			Blend(_mm_unpackhi_epi8(p1, zero), _mm_unpackhi_epi32(k_hi, k_hi), vcolor));
+		_mm_storeu_si128(out, p0);
+		_mm_storeu_si128(out + 1, p1);
+	}
+}
+#elif defined(AGI_BLEND_NEON)
+inline uint8x8_t Div255(uint16x8_t x) {
+	return vshrn_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+}
+
+void BlendVector(uint8_t *dst, const uint8_t *mask, int count, const unsigned int color[4], unsigned int opacity) {
+	const uint8x8_t vopacity = vdup_n_u8(opacity);
+	const uint8x8_t full = vdup_n_u8(255);
+	uint8x8_t vcolor[4];
+	for (int c = 0; c < 4; ++c)
+		vcolor[c] = vdup_n_u8(color[c]);
+
+	for (int i = 0; i < count; i += 8, dst += 32) {
+		uint8x8_t m = vld1_u8(mask + i);
+		if (!vget_lane_u64(vreinterpret_u64_u8(m), 0))
+			continue;
+
+		uint8x8_t k = Div255(vmull_u8(m, vopacity));
+		uint8x8_t ck = vsub_u8(full, k);
+		uint8x8x4_t pixels = vld4_u8(dst);
+		for (int c = 0; c < 4; ++c)
+			pixels.val[c] = Div255(vmlal_u8(vmull_u8(k, vcolor[c]), ck, pixels.val[c]));
+		vst4_u8(dst, pixels);
+	}
+}
+#endif
+}
+
+namespace agi {
+void BlendMask(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *mask, ptrdiff_t mask_stride,
+               int width, int height, uint32_t color, unsigned int opacity) {
+	if (!opacity || width <= 0) return;
+
+	// Alpha is blended towards opaque like the other channels
+	const unsigned int channels[4] = {color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, 255};
+
+	for (int y = 0; y < height; ++y, dst += dst_stride, mask += mask_stride) {
+		int x = 0;
+#if defined(AGI_BLEND_SSE2) || defined(AGI_BLEND_NEON)
+		x = width & ~7;
+		BlendVector(dst, mask, x, channels, opacity);
+#endif
+		BlendPixels(dst + x * 4, mask + x, width - x, channels, opacity);
+	}
+}
+}
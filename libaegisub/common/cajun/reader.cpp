@@ -9,6 +9,7 @@ Author: Terry Caton
 #include "libaegisub/cajun/reader.h"
 
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <algorithm>
 #include <cassert>
 
 /*
@@ -56,35 +57,103 @@ public:
 	Location const& GetLocation() const { return m_Location; }
 };
 
+/// Lookahead of one token over the input, scanned as it's needed
 class Reader::TokenStream {
-	Tokens const& m_Tokens;
-	Tokens::const_iterator m_itCurrent;
+	Reader& m_Reader;
+	InputStream& m_InputStream;
+	Token m_Token;
+	bool m_bHaveToken = false;
 
 public:
-	TokenStream(Tokens const& tokens) : m_Tokens(tokens), m_itCurrent(tokens.begin())
+	TokenStream(Reader& reader, InputStream& inputStream)
+	: m_Reader(reader), m_InputStream(inputStream)
 	{ }
 
-	Token const& Peek() {
+	// the returned token is only valid until the next call to any of these
+	Token& Peek() {
 		assert(!EOS());
-		return *m_itCurrent;
+		return m_Token;
 	}
-	Token const& Get() {
+	Token& Get() {
 		assert(!EOS());
-		return *m_itCurrent++;
+		m_bHaveToken = false;
+		return m_Token;
 	}
 
-	bool EOS() const { return m_itCurrent == m_Tokens.end(); }
+	bool EOS() {
+		if (!m_bHaveToken)
+			m_bHaveToken = m_Reader.Scan(m_Token, m_InputStream);
+		return !m_bHaveToken;
+	}
 };
 
+namespace {
+/// Handler which builds the UnknownElement tree for a document
+class ElementBuilder final : public Reader::Handler {
+	struct Container {
+		Object *object;
+		Array *array;
+	};
+
+	UnknownElement m_Root;
+	std::vector<Container> m_Open;
+	std::string m_sMember;
+
+	UnknownElement& Next() {
+		if (m_Open.empty())
+			return m_Root;
+		Container& top = m_Open.back();
+		if (top.array) {
+			top.array->emplace_back();
+			return top.array->back();
+		}
+		return (*top.object)[std::move(m_sMember)];
+	}
+
+	template<typename ElementTypeT>
+	void Add(ElementTypeT&& value) {
+		Next() = std::forward<ElementTypeT>(value);
+	}
+
+public:
+	UnknownElement Root() { return std::move(m_Root); }
+
+	// Object and Array are owned through a pointer by their UnknownElement,
+	// so the containers stay put while their parents grow
+	void ObjectBegin() override {
+		UnknownElement& element = Next();
+		element = Object();
+		m_Open.push_back({&static_cast<Object&>(element), nullptr});
+	}
+	void ArrayBegin() override {
+		UnknownElement& element = Next();
+		element = Array();
+		m_Open.push_back({nullptr, &static_cast<Array&>(element)});
+	}
+	void ObjectEnd() override { m_Open.pop_back(); }
+	void ArrayEnd() override { m_Open.pop_back(); }
+	void Member(std::string const& name) override { m_sMember = name; }
+
+	void Value(Integer number) override { Add(number); }
+	void Value(Double number) override { Add(number); }
+	void Value(String&& string) override { Add(std::move(string)); }
+	void Value(Boolean boolean) override { Add(boolean); }
+	void Value(Null null) override { Add(null); }
+};
+}
+
 void Reader::Read(UnknownElement& unknown, std::istream& istr) {
-	Reader reader;
+	ElementBuilder builder;
+	Read(builder, istr);
+	unknown = builder.Root();
+}
 
-	Tokens tokens;
-	InputStream inputStream(istr);
-	reader.Scan(tokens, inputStream);
+void Reader::Read(Handler& handler, std::istream& istr) {
+	Reader reader(handler);
 
-	TokenStream tokenStream(tokens);
-	unknown = reader.Parse(tokenStream);
+	InputStream inputStream(istr);
+	TokenStream tokenStream(reader, inputStream);
+	reader.Parse(tokenStream);
 
 	if (!tokenStream.EOS()) {
 		Token const& token = tokenStream.Peek();
@@ -92,98 +161,99 @@ void Reader::Read(UnknownElement& unknown, std::istream& istr) {
 	}
 }
 
-void Reader::Scan(Tokens& tokens, InputStream& inputStream) {
-	while (EatWhiteSpace(inputStream), !inputStream.EOS()) {
-		// if all goes well, we'll create a token each pass
-		Token token;
-		token.locBegin = inputStream.GetLocation();
-
-		char c = inputStream.Peek();
-		switch (c) {
-			case '{':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_OBJECT_BEGIN;
-				break;
-
-			case '}':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_OBJECT_END;
-				break;
-
-			case '[':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_ARRAY_BEGIN;
-				break;
-
-			case ']':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_ARRAY_END;
-				break;
-
-			case ',':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_NEXT_ELEMENT;
-				break;
-
-			case ':':
-				token.sValue = c;
-				inputStream.Get();
-				token.nType = Token::TOKEN_MEMBER_ASSIGN;
-				break;
-
-			case '"':
-				MatchString(token.sValue, inputStream);
-				token.nType = Token::TOKEN_STRING;
-				break;
-
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-				MatchNumber(token.sValue, inputStream);
-				token.nType = Token::TOKEN_NUMBER;
-				break;
-
-			case 't':
-				token.sValue = "true";
-				MatchExpectedString(token.sValue, inputStream);
-				token.nType = Token::TOKEN_BOOLEAN;
-				break;
-
-			case 'f':
-				token.sValue = "false";
-				MatchExpectedString(token.sValue, inputStream);
-				token.nType = Token::TOKEN_BOOLEAN;
-				break;
-
-			case 'n':
-				token.sValue = "null";
-				MatchExpectedString(token.sValue, inputStream);
-				token.nType = Token::TOKEN_NULL;
-				break;
-
-			case 0:
-				return;
-
-			default:
-				throw ScanException(std::string("Unexpected character in stream: ") + c, inputStream.GetLocation());
-		}
+bool Reader::Scan(Token& token, InputStream& inputStream) {
+	EatWhiteSpace(inputStream);
+	if (inputStream.EOS())
+		return false;
+
+	token.sValue.clear();
+	token.locBegin = inputStream.GetLocation();
+
+	char c = inputStream.Peek();
+	switch (c) {
+		case '{':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_OBJECT_BEGIN;
+			break;
+
+		case '}':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_OBJECT_END;
+			break;
+
+		case '[':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_ARRAY_BEGIN;
+			break;
+
+		case ']':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_ARRAY_END;
+			break;
+
+		case ',':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_NEXT_ELEMENT;
+			break;
+
+		case ':':
+			token.sValue = c;
+			inputStream.Get();
+			token.nType = Token::TOKEN_MEMBER_ASSIGN;
+			break;
+
+		case '"':
+			MatchString(token.sValue, inputStream);
+			token.nType = Token::TOKEN_STRING;
+			break;
+
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			MatchNumber(token.sValue, inputStream);
+			token.nType = Token::TOKEN_NUMBER;
+			break;
+
+		case 't':
+			token.sValue = "true";
+			MatchExpectedString(token.sValue, inputStream);
+			token.nType = Token::TOKEN_BOOLEAN;
+			break;
+
+		case 'f':
+			token.sValue = "false";
+			MatchExpectedString(token.sValue, inputStream);
+			token.nType = Token::TOKEN_BOOLEAN;
+			break;
+
+		case 'n':
+			token.sValue = "null";
+			MatchExpectedString(token.sValue, inputStream);
+			token.nType = Token::TOKEN_NULL;
+			break;
+
+		case 0:
+			return false;
 
-		token.locEnd = inputStream.GetLocation();
-		tokens.push_back(token);
+		default:
+			throw ScanException(std::string("Unexpected character in stream: ") + c, inputStream.GetLocation());
 	}
+
+	token.locEnd = inputStream.GetLocation();
+	return true;
 }
 
 void Reader::EatWhiteSpace(InputStream& inputStream) {
@@ -236,7 +306,7 @@ void Reader::MatchNumber(std::string& sNumber, InputStream& inputStream) {
 		sNumber.push_back(inputStream.Get());
 }
 
-UnknownElement Reader::Parse(Reader::TokenStream& tokenStream) {
+void Reader::Parse(Reader::TokenStream& tokenStream) {
 	if (tokenStream.EOS())
 		throw ParseException("Unexpected end of token stream", Location(), Location()); // nowhere to point to
 
@@ -253,24 +323,27 @@ UnknownElement Reader::Parse(Reader::TokenStream& tokenStream) {
 	}
 }
 
-UnknownElement Reader::ParseObject(Reader::TokenStream& tokenStream) {
+void Reader::ParseObject(Reader::TokenStream& tokenStream) {
 	MatchExpectedToken(Token::TOKEN_OBJECT_BEGIN, tokenStream);
+	m_Handler.ObjectBegin();
 
-	Object object;
+	size_t firstMember = m_MemberNames.size();
 
 	while (!tokenStream.EOS() && tokenStream.Peek().nType != Token::TOKEN_OBJECT_END) {
-		// first the member name. save the token in case we have to throw an exception
-		Token const& tokenName = tokenStream.Peek();
-		std::string const& name = MatchExpectedToken(Token::TOKEN_STRING, tokenStream);
+		// first the member name. save the location in case we have to throw an exception
+		Location locBegin = tokenStream.Peek().locBegin, locEnd = tokenStream.Peek().locEnd;
+		std::string& name = MatchExpectedToken(Token::TOKEN_STRING, tokenStream);
 
-		if (object.count(name))
-			throw ParseException("Duplicate object member token: " + name, tokenName.locBegin, tokenName.locEnd);
+		if (std::find(m_MemberNames.begin() + firstMember, m_MemberNames.end(), name) != m_MemberNames.end())
+			throw ParseException("Duplicate object member token: " + name, locBegin, locEnd);
+		m_MemberNames.push_back(std::move(name));
 
 		// ...then the key/value separator...
 		MatchExpectedToken(Token::TOKEN_MEMBER_ASSIGN, tokenStream);
 
 		// ...then the value itself (can be anything).
-		object[name] = Parse(tokenStream);
+		m_Handler.Member(m_MemberNames.back());
+		Parse(tokenStream);
 
 		if (!tokenStream.EOS() && tokenStream.Peek().nType != Token::TOKEN_OBJECT_END)
 			MatchExpectedToken(Token::TOKEN_NEXT_ELEMENT, tokenStream);
@@ -278,31 +351,30 @@ UnknownElement Reader::ParseObject(Reader::TokenStream& tokenStream) {
 
 	MatchExpectedToken(Token::TOKEN_OBJECT_END, tokenStream);
 
-	return std::move(object);
+	m_MemberNames.resize(firstMember);
+	m_Handler.ObjectEnd();
 }
 
-UnknownElement Reader::ParseArray(Reader::TokenStream& tokenStream) {
+void Reader::ParseArray(Reader::TokenStream& tokenStream) {
 	MatchExpectedToken(Token::TOKEN_ARRAY_BEGIN, tokenStream);
-
-	Array array;
+	m_Handler.ArrayBegin();
 
 	while (!tokenStream.EOS() && tokenStream.Peek().nType != Token::TOKEN_ARRAY_END) {
-		array.push_back(Parse(tokenStream));
+		Parse(tokenStream);
 
 		if (!tokenStream.EOS() && tokenStream.Peek().nType != Token::TOKEN_ARRAY_END)
 			MatchExpectedToken(Token::TOKEN_NEXT_ELEMENT, tokenStream);
 	}
 
 	MatchExpectedToken(Token::TOKEN_ARRAY_END, tokenStream);
-
-	return std::move(array);
+	m_Handler.ArrayEnd();
 }
 
-UnknownElement Reader::ParseString(Reader::TokenStream& tokenStream) {
-	return MatchExpectedToken(Token::TOKEN_STRING, tokenStream);
+void Reader::ParseString(Reader::TokenStream& tokenStream) {
+	m_Handler.Value(std::move(MatchExpectedToken(Token::TOKEN_STRING, tokenStream)));
 }
 
-UnknownElement Reader::ParseNumber(Reader::TokenStream& tokenStream) {
+void Reader::ParseNumber(Reader::TokenStream& tokenStream) {
 	Token const& currentToken = tokenStream.Peek(); // might need this later for throwing exception
 	std::string const& sValue = MatchExpectedToken(Token::TOKEN_NUMBER, tokenStream);
 
@@ -313,7 +385,7 @@ UnknownElement Reader::ParseNumber(Reader::TokenStream& tokenStream) {
 
 	// If the entire token was consumed then it's not a double
 	if (iStr.eof())
-		return iValue;
+		return m_Handler.Value(iValue);
 
 	// Try again as a double
 	iStr.seekg(0, std::ios::beg);
@@ -325,23 +397,23 @@ UnknownElement Reader::ParseNumber(Reader::TokenStream& tokenStream) {
 		throw ParseException(std::string("Unexpected character in NUMBER token: ") + (char)iStr.peek(),
 			currentToken.locBegin, currentToken.locEnd);
 
-	return dValue;
+	m_Handler.Value(dValue);
 }
 
-UnknownElement Reader::ParseBoolean(Reader::TokenStream& tokenStream) {
-	return MatchExpectedToken(Token::TOKEN_BOOLEAN, tokenStream) == "true";
+void Reader::ParseBoolean(Reader::TokenStream& tokenStream) {
+	m_Handler.Value(MatchExpectedToken(Token::TOKEN_BOOLEAN, tokenStream) == "true");
 }
 
-UnknownElement Reader::ParseNull(Reader::TokenStream& tokenStream) {
+void Reader::ParseNull(Reader::TokenStream& tokenStream) {
 	MatchExpectedToken(Token::TOKEN_NULL, tokenStream);
-	return Null();
+	m_Handler.Value(Null());
 }
 
-std::string const& Reader::MatchExpectedToken(Token::Type nExpected, Reader::TokenStream& tokenStream) {
+std::string& Reader::MatchExpectedToken(Token::Type nExpected, Reader::TokenStream& tokenStream) {
 	if (tokenStream.EOS())
 		throw ParseException("Unexpected End of token stream", Location(), Location()); // nowhere to point to
 
-	Token const& token = tokenStream.Get();
+	Token& token = tokenStream.Get();
 	if (token.nType != nExpected)
 		throw ParseException("Unexpected token: " + token.sValue, token.locBegin, token.locEnd);
 
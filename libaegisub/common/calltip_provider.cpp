@@ -19,6 +19,9 @@
 #include "libaegisub/ass/dialogue_parser.h"
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
 
 namespace {
 struct proto_lit {
@@ -106,19 +109,27 @@ const proto_lit proto_5[] = {
 	{nullptr, nullptr}
 };
 
-const proto_lit *all_protos[] = {proto_1, proto_2, proto_3, proto_4, proto_5};
+/// Prototypes for each length of tag name, not counting the terminator
+const std::pair<const proto_lit *, const proto_lit *> all_protos[] = {
+	{std::begin(proto_1), std::end(proto_1) - 1},
+	{std::begin(proto_2), std::end(proto_2) - 1},
+	{std::begin(proto_3), std::end(proto_3) - 1},
+	{std::begin(proto_4), std::end(proto_4) - 1},
+	{std::begin(proto_5), std::end(proto_5) - 1},
+};
 }
 
 namespace agi {
-Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, std::string const& text, size_t pos) {
+CalltipIndex IndexCalltips(std::vector<ass::DialogueToken> const& tokens) {
 	namespace dt = ass::DialogueTokenType;
 
-	Calltip ret = { nullptr, 0, 0, 0 };
+	CalltipIndex index;
+	index.tokens.reserve(tokens.size());
 
-	size_t idx = 0;
+	size_t end = 0;
 	size_t tag_name_idx = 0;
-	size_t commas = 0;
-	for (; idx < tokens.size() && pos > 0; ++idx) {
+	size_t arg_seps = 0;
+	for (size_t idx = 0; idx < tokens.size(); ++idx) {
 		switch (tokens[idx].type) {
 			case dt::COMMENT:
 			case dt::OVR_END:
@@ -126,24 +137,44 @@ Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, std::string co
 				break;
 			case dt::TAG_NAME:
 				tag_name_idx = idx;
-				commas = 0;
 				break;
 			case dt::ARG_SEP:
-				++commas;
+				++arg_seps;
 				break;
 			default: break;
 		}
-		pos -= std::min(pos, tokens[idx].length);
+		end += tokens[idx].length;
+		index.tokens.push_back({end, tag_name_idx, arg_seps});
 	}
+	return index;
+}
+
+Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, std::string const& text, size_t pos) {
+	return GetCalltip(tokens, IndexCalltips(tokens), text, pos);
+}
+
+Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, CalltipIndex const& index, std::string const& text, size_t pos) {
+	namespace dt = ass::DialogueTokenType;
+
+	Calltip ret = { nullptr, 0, 0, 0 };
+	if (pos == 0 || index.tokens.empty())
+		return ret;
+
+	// The token the cursor is in or just after
+	auto cur = std::lower_bound(index.tokens.begin(), index.tokens.end(), pos,
+		[](CalltipIndex::Token const& tok, size_t pos) { return tok.end < pos; });
+	if (cur == index.tokens.end())
+		--cur;
+	size_t idx = std::distance(index.tokens.begin(), cur) + 1;
 
 	// Either didn't hit a tag or the override block ended before reaching the
 	// current position
+	size_t tag_name_idx = cur->tag_name;
 	if (tag_name_idx == 0)
 		return ret;
 
-	size_t tag_name_start = 0;
-	for (size_t i = 0; i < tag_name_idx; ++i)
-		tag_name_start += tokens[i].length;
+	size_t commas = cur->arg_seps - index.tokens[tag_name_idx].arg_seps;
+	size_t tag_name_start = index.tokens[tag_name_idx - 1].end;
 	size_t tag_name_length = tokens[tag_name_idx].length;
 
 	// No tags exist with length over five
@@ -155,9 +186,9 @@ Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, std::string co
 	};
 
 	// Find the prototype for this tag
-	auto proto = all_protos[tag_name_length - 1];
-	while (proto->name && strncmp(proto->name, &text[tag_name_start], tag_name_length) < 0)
-		++proto;
+	auto const& protos = all_protos[tag_name_length - 1];
+	auto proto = std::lower_bound(protos.first, protos.second, &text[tag_name_start],
+		[&](proto_lit const& lit, const char *name) { return strncmp(lit.name, name, tag_name_length) < 0; });
 
 	if (!valid(proto))
 		return ret;
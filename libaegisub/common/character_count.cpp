@@ -42,9 +42,14 @@ icu::BreakIterator& get_break_iterator(const char *ptr, size_t len) {
 		if (U_FAILURE(status)) throw agi::InternalError("Failed to create character iterator");
 	});
 
+	// The UText is reopened in place for each string rather than allocating
+	// a new one, as counting a file's lines calls this once per line (or
+	// more, when override blocks are skipped)
+	static utext_ptr ut;
 	UErrorCode err = U_ZERO_ERROR;
-	utext_ptr ut(utext_openUTF8(nullptr, ptr, len, &err));
+	UText *text = utext_openUTF8(ut.get(), ptr, len, &err);
 	if (U_FAILURE(err)) throw agi::InternalError("Failed to open utext");
+	if (!ut) ut.reset(text);
 
 	bi->setText(ut.get(), err);
 	if (U_FAILURE(err)) throw agi::InternalError("Failed to set break iterator text");
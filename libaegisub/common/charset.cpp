@@ -21,28 +21,119 @@
 #include "libaegisub/file_mapping.h"
 #include "libaegisub/scoped_ptr.h"
 
+#include <algorithm>
+#include <cstring>
+
 #ifdef WITH_UCHARDET
 #include <uchardet/uchardet.h>
 #endif
 
+namespace {
+/// Bytes at the start of the file which are always sampled
+const uint64_t prefix_size = 64 * 1024;
+/// Size of each chunk sampled from the rest of the file
+const uint64_t chunk_size = 4096;
+/// Number of chunks sampled from the rest of the file
+const uint64_t sample_chunks = 16;
+
+/// Call func with the parts of the file used to guess its encoding: all of
+/// the start of the file, then evenly spaced chunks of the rest
+template<typename Func>
+void for_each_sample(agi::read_file_mapping &fp, Func&& func) {
+	const uint64_t size = fp.size();
+	auto read = [&](uint64_t offset, uint64_t end) {
+		for (; offset < end; offset += chunk_size) {
+			auto len = std::min(chunk_size, end - offset);
+			func(fp.read(offset, len), len);
+		}
+	};
+
+	read(0, std::min(size, prefix_size));
+	if (size <= prefix_size) return;
+
+	uint64_t rest = size - prefix_size;
+	if (rest <= chunk_size * sample_chunks)
+		return read(prefix_size, size);
+
+	for (uint64_t i = 0; i < sample_chunks; ++i) {
+		uint64_t offset = prefix_size + (rest - chunk_size) * i / (sample_chunks - 1);
+		read(offset, offset + chunk_size);
+	}
+}
+
+/// Count the bytes which shouldn't appear in a text file
+uint64_t count_binaryish(const char *buf, size_t len) {
+	uint64_t binaryish = 0;
+	for (size_t i = 0; i < len; ++i) {
+		if ((unsigned char)buf[i] < 32 && (buf[i] != '\r' && buf[i] != '\n' && buf[i] != '\t'))
+			++binaryish;
+	}
+	return binaryish;
+}
+
+/// Is the buffer entirely well-formed UTF-8?
+bool is_utf8(const char *buf, size_t len) {
+	auto str = reinterpret_cast<const unsigned char *>(buf);
+	size_t i = 0;
+	while (i < len) {
+		// Skip over runs of ASCII eight bytes at a time
+		if (len - i >= 8) {
+			uint64_t word;
+			memcpy(&word, str + i, 8);
+			if (!(word & UINT64_C(0x8080808080808080))) {
+				i += 8;
+				continue;
+			}
+		}
+
+		unsigned char c = str[i];
+		if (c < 0x80) {
+			++i;
+			continue;
+		}
+
+		size_t trailing;
+		if (c >= 0xC2 && c <= 0xDF) trailing = 1;
+		else if (c >= 0xE0 && c <= 0xEF) trailing = 2;
+		else if (c >= 0xF0 && c <= 0xF4) trailing = 3;
+		else return false;
+
+		if (len - i <= trailing) return false;
+		for (size_t j = 1; j <= trailing; ++j) {
+			if ((str[i + j] & 0xC0) != 0x80) return false;
+		}
+
+		// Overlong encodings, surrogates and code points past U+10FFFF
+		unsigned char next = str[i + 1];
+		if ((c == 0xE0 && next < 0xA0) || (c == 0xED && next > 0x9F) ||
+			(c == 0xF0 && next < 0x90) || (c == 0xF4 && next > 0x8F))
+			return false;
+
+		i += trailing + 1;
+	}
+	return true;
+}
+}
+
 namespace agi { namespace charset {
 std::string Detect(agi::fs::path const& file) {
-	agi::read_file_mapping fp(file);
+	auto mapping = agi::open_read_mapping(file);
+	auto& fp = *mapping;
 
 	// First check for known magic bytes which identify the file type
 	if (fp.size() >= 4) {
 		const char* header = fp.read(0, 4);
-		if (!strncmp(header, "\xef\xbb\xbf", 3))
+		if (!memcmp(header, "\xef\xbb\xbf", 3))
 			return "utf-8";
-		if (!strncmp(header, "\x00\x00\xfe\xff", 4))
+		if (!memcmp(header, "\x00\x00\xfe\xff", 4))
 			return "utf-32be";
-		if (!strncmp(header, "\xff\xfe\x00\x00", 4))
+		if (!memcmp(header, "\xff\xfe\x00\x00", 4))
 			return "utf-32le";
-		if (!strncmp(header, "\xfe\xff", 2))
+		if (!memcmp(header, "\xfe\xff", 2))
 			return "utf-16be";
-		if (!strncmp(header, "\xff\xfe", 2))
+		if (!memcmp(header, "\xff\xfe", 2))
 			return "utf-16le";
-		if (!strncmp(header, "\x1a\x45\xdf\xa3", 4))
+		if (!memcmp(header, "\x1a\x45\xdf\xa3", 4))
 			return "binary"; // Actually EBML/Matroska
 	}
 
@@ -51,38 +142,28 @@ std::string Detect(agi::fs::path const& file) {
 	if (fp.size() > 100 * 1024 * 1024)
 		return "binary";
 
-	uint64_t binaryish = 0;
+	// A dumb heuristic to detect binary files
+	uint64_t binaryish = 0, sampled = 0;
+	for_each_sample(fp, [&](const char *buf, uint64_t len) {
+		binaryish += count_binaryish(buf, len);
+		sampled += len;
+	});
+	if (binaryish > sampled / 8)
+		return "binary";
+
+	// Most files are UTF-8 and checking that is much faster than asking
+	// uchardet, and unlike it doesn't need to guess
+	if (fp.size() == 0 || is_utf8(fp.read(), fp.size()))
+		return "utf-8";
 
 #ifdef WITH_UCHARDET
 	agi::scoped_holder<uchardet_t> ud(uchardet_new(), uchardet_delete);
-	for (uint64_t offset = 0; offset < fp.size(); ) {
-		auto read = std::min<uint64_t>(4096, fp.size() - offset);
-		auto buf = fp.read(offset, read);
-		uchardet_handle_data(ud, buf, read);
-
-		offset += read;
-
-		// A dumb heuristic to detect binary files
-		for (size_t i = 0; i < read; ++i) {
-			if ((unsigned char)buf[i] < 32 && (buf[i] != '\r' && buf[i] != '\n' && buf[i] != '\t'))
-				++binaryish;
-		}
-
-		if (binaryish > offset / 8)
-			return "binary";
-	}
+	for_each_sample(fp, [&](const char *buf, uint64_t len) {
+		uchardet_handle_data(ud, buf, len);
+	});
 	uchardet_data_end(ud);
 	return uchardet_get_charset(ud);
 #else
-	auto read = std::min<uint64_t>(4096, fp.size());
-	auto buf = fp.read(0, read);
-	for (size_t i = 0; i < read; ++i) {
-		if ((unsigned char)buf[i] < 32 && (buf[i] != '\r' && buf[i] != '\n' && buf[i] != '\t'))
-			++binaryish;
-	}
-
-	if (binaryish > read / 8)
-		return "binary";
 	return "utf-8";
 #endif
 }
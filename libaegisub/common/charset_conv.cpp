@@ -20,6 +20,7 @@
 #include <cstdint>
 
 #include <cassert>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/range/algorithm.hpp>
 
 #include <libaegisub/charset_conv.h>
@@ -27,6 +28,11 @@
 
 #include "charset_6937.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AGI_CHARSET_SSE2
+#endif
+
 // Check if we can use advanced fallback capabilities added in GNU's iconv
 // implementation
 #if !defined(_LIBICONV_VERSION) || _LIBICONV_VERSION < 0x010A || defined(LIBICONV_PLUG)
@@ -259,7 +265,279 @@ namespace {
 	};
 #endif
 
+	enum class Unicode { None, UTF8, UTF16LE };
+
+	Unicode unicode_encoding(const char *name) {
+		name = get_real_encoding_name(name);
+		if (boost::iequals(name, "utf-8") || boost::iequals(name, "utf8"))
+			return Unicode::UTF8;
+		if (boost::iequals(name, "utf-16le") || boost::iequals(name, "utf16le"))
+			return Unicode::UTF16LE;
+		return Unicode::None;
+	}
+
+	/// Number of bytes from the start of src which are ASCII
+	size_t ascii_prefix(const unsigned char *src, size_t len) {
+		size_t i = 0;
+#ifdef AGI_CHARSET_SSE2
+		for (; i + 16 <= len; i += 16) {
+			int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+			if (mask) {
+				while (!(mask & 1)) {
+					mask >>= 1;
+					++i;
+				}
+				return i;
+			}
+		}
+#endif
+		while (i < len && src[i] < 0x80) ++i;
+		return i;
+	}
+
+	/// Decode one UTF-8 character, accepting only what iconv does: no overlong
+	/// forms, surrogates or code points past U+10FFFF
+	/// @return Length of the character, or 0 if it's invalid or incomplete
+	size_t decode_utf8(const unsigned char *src, size_t len, uint32_t &cp) {
+		unsigned char c = src[0];
+		size_t size;
+		unsigned char min = 0x80, max = 0xBF;
+		if (c < 0x80) {
+			cp = c;
+			return 1;
+		}
+		else if (c >= 0xC2 && c <= 0xDF) {
+			size = 2;
+			cp = c & 0x1F;
+		}
+		else if (c >= 0xE0 && c <= 0xEF) {
+			size = 3;
+			cp = c & 0x0F;
+			if (c == 0xE0) min = 0xA0;
+			if (c == 0xED) max = 0x9F;
+		}
+		else if (c >= 0xF0 && c <= 0xF4) {
+			size = 4;
+			cp = c & 0x07;
+			if (c == 0xF0) min = 0x90;
+			if (c == 0xF4) max = 0x8F;
+		}
+		else
+			return 0;
+
+		if (len < size || src[1] < min || src[1] > max)
+			return 0;
+		for (size_t i = 1; i < size; ++i) {
+			if ((src[i] & 0xC0) != 0x80)
+				return 0;
+			cp = (cp << 6) | (src[i] & 0x3F);
+		}
+		return size;
+	}
+
+	/// Converter between UTF-8 and UTF-8 or UTF-16LE which doesn't go through iconv
+	///
+	/// Files and the clipboard are nearly always in one of these, so this is
+	/// most of the conversions done. Valid input is converted directly, and
+	/// anything from the first invalid or incomplete character on is passed
+	/// to iconv, so that errors and substitutions are exactly what they would
+	/// be otherwise. Neither encoding has a BOM inserted by the conversion,
+	/// and one in the input is passed through like any other character.
+	class UnicodeConverter final : public Converter {
+		Unicode from, to;
+		bool subst;
+		std::string src_name, dst_name;
+		std::unique_ptr<Converter> iconv;
+
+		size_t Fallback(const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) {
+			if (!iconv)
+				iconv.reset(new ConverterImpl(subst, src_name.c_str(), dst_name.c_str()));
+			return iconv->Convert(inbuf, inbytesleft, outbuf, outbytesleft);
+		}
+
+		size_t Done(bool invalid, const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) {
+			if (invalid)
+				return Fallback(inbuf, inbytesleft, outbuf, outbytesleft);
+			if (*inbytesleft) {
+				errno = E2BIG;
+				return iconv_failed;
+			}
+			return 0;
+		}
+
+		size_t Copy(const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) {
+			auto src = reinterpret_cast<const unsigned char *>(*inbuf);
+			size_t len = std::min(*inbytesleft, *outbytesleft);
+			size_t valid = 0;
+			bool invalid = false;
+			while (valid < len) {
+				valid += ascii_prefix(src + valid, len - valid);
+				if (valid == len) break;
+
+				uint32_t cp;
+				size_t size = decode_utf8(src + valid, *inbytesleft - valid, cp);
+				if (!size) {
+					invalid = true;
+					break;
+				}
+				if (valid + size > len) break;
+				valid += size;
+			}
+
+			memcpy(*outbuf, *inbuf, valid);
+			*inbuf += valid;
+			*outbuf += valid;
+			*inbytesleft -= valid;
+			*outbytesleft -= valid;
+			return Done(invalid, inbuf, inbytesleft, outbuf, outbytesleft);
+		}
+
+		size_t FromUTF8(const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) {
+			auto src = reinterpret_cast<const unsigned char *>(*inbuf);
+			auto end = src + *inbytesleft;
+			auto dst = reinterpret_cast<unsigned char *>(*outbuf);
+			auto dst_end = dst + *outbytesleft;
+			bool invalid = false;
+
+			while (src < end) {
+#ifdef AGI_CHARSET_SSE2
+				// Widen a block of ASCII at a time
+				while (end - src >= 16 && dst_end - dst >= 32) {
+					__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+					if (_mm_movemask_epi8(chars)) break;
+					__m128i zero = _mm_setzero_si128();
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi8(chars, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_unpackhi_epi8(chars, zero));
+					src += 16;
+					dst += 32;
+				}
+				if (src == end) break;
+#endif
+
+				uint32_t cp;
+				size_t size = decode_utf8(src, end - src, cp);
+				if (!size) {
+					invalid = true;
+					break;
+				}
+				if (cp < 0x10000) {
+					if (dst_end - dst < 2) break;
+					*dst++ = cp & 0xFF;
+					*dst++ = cp >> 8;
+				}
+				else {
+					if (dst_end - dst < 4) break;
+					uint32_t high = 0xD800 + ((cp - 0x10000) >> 10);
+					uint32_t low = 0xDC00 + ((cp - 0x10000) & 0x3FF);
+					*dst++ = high & 0xFF;
+					*dst++ = high >> 8;
+					*dst++ = low & 0xFF;
+					*dst++ = low >> 8;
+				}
+				src += size;
+			}
+
+			*inbytesleft = end - src;
+			*inbuf = reinterpret_cast<const char *>(src);
+			*outbytesleft = dst_end - dst;
+			*outbuf = reinterpret_cast<char *>(dst);
+			return Done(invalid, inbuf, inbytesleft, outbuf, outbytesleft);
+		}
+
+		size_t ToUTF8(const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) {
+			auto src = reinterpret_cast<const unsigned char *>(*inbuf);
+			auto end = src + *inbytesleft;
+			auto dst = reinterpret_cast<unsigned char *>(*outbuf);
+			auto dst_end = dst + *outbytesleft;
+			bool invalid = false;
+
+			while (src < end) {
+#ifdef AGI_CHARSET_SSE2
+				// Narrow a block of ASCII at a time
+				while (end - src >= 16 && dst_end - dst >= 8) {
+					__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+					// Any bit set other than the low seven of each unit
+					if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(units, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128())) != 0xFFFF)
+						break;
+					_mm_storel_epi64(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(units, units));
+					src += 16;
+					dst += 8;
+				}
+				if (src == end) break;
+#endif
+
+				if (end - src < 2) {
+					invalid = true;
+					break;
+				}
+				uint32_t cp = src[0] | src[1] << 8;
+				size_t size = 2;
+				if (cp >= 0xD800 && cp <= 0xDFFF) {
+					uint32_t low = end - src >= 4 ? src[2] | src[3] << 8 : 0;
+					if (cp >= 0xDC00 || low < 0xDC00 || low > 0xDFFF) {
+						invalid = true;
+						break;
+					}
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+					size = 4;
+				}
+
+				if (cp < 0x80) {
+					if (dst_end - dst < 1) break;
+					*dst++ = cp;
+				}
+				else if (cp < 0x800) {
+					if (dst_end - dst < 2) break;
+					*dst++ = 0xC0 | (cp >> 6);
+					*dst++ = 0x80 | (cp & 0x3F);
+				}
+				else if (cp < 0x10000) {
+					if (dst_end - dst < 3) break;
+					*dst++ = 0xE0 | (cp >> 12);
+					*dst++ = 0x80 | ((cp >> 6) & 0x3F);
+					*dst++ = 0x80 | (cp & 0x3F);
+				}
+				else {
+					if (dst_end - dst < 4) break;
+					*dst++ = 0xF0 | (cp >> 18);
+					*dst++ = 0x80 | ((cp >> 12) & 0x3F);
+					*dst++ = 0x80 | ((cp >> 6) & 0x3F);
+					*dst++ = 0x80 | (cp & 0x3F);
+				}
+				src += size;
+			}
+
+			*inbytesleft = end - src;
+			*inbuf = reinterpret_cast<const char *>(src);
+			*outbytesleft = dst_end - dst;
+			*outbuf = reinterpret_cast<char *>(dst);
+			return Done(invalid, inbuf, inbytesleft, outbuf, outbytesleft);
+		}
+
+	public:
+		UnicodeConverter(Unicode from, Unicode to, bool subst, const char *src, const char *dst)
+		: from(from), to(to), subst(subst), src_name(src), dst_name(dst)
+		{
+		}
+
+		size_t Convert(const char **inbuf, size_t *inbytesleft, char **outbuf, size_t *outbytesleft) override {
+			// Neither encoding has any shift state to reset
+			if (!inbuf || !*inbuf)
+				return 0;
+
+			if (from == to)
+				return Copy(inbuf, inbytesleft, outbuf, outbytesleft);
+			if (from == Unicode::UTF8)
+				return FromUTF8(inbuf, inbytesleft, outbuf, outbytesleft);
+			return ToUTF8(inbuf, inbytesleft, outbuf, outbytesleft);
+		}
+	};
+
 	Converter *get_converter(bool subst, const char *src, const char *dst) {
+		auto from = unicode_encoding(src), to = unicode_encoding(dst);
+		if (from != Unicode::None && to != Unicode::None && (from == Unicode::UTF8 || to == Unicode::UTF8))
+			return new UnicodeConverter(from, to, subst, src, dst);
+
 		try {
 			return new ConverterImpl(subst, src, dst);
 		}
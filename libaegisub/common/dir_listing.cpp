@@ -0,0 +1,138 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/dir_listing.h"
+
+#include "libaegisub/fs.h"
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+
+namespace {
+using namespace agi::fs;
+typedef std::shared_ptr<const std::vector<std::string>> Files;
+
+/// A directory's files and its modification time when they were listed
+struct Listing {
+	time_t modified;
+	Files files;
+};
+
+std::mutex cache_lock;
+std::map<std::pair<std::string, std::string>, Listing> cache;
+
+/// Directories modified this recently may be modified again without the
+/// time visibly changing, so listings of them aren't cached
+const time_t settle_time = 2;
+
+/// Names are handed to the main thread once this many have been found, or
+/// once this long has passed since the last batch
+const size_t batch_size = 256;
+const auto batch_interval = std::chrono::milliseconds(100);
+
+/// Get the modification time of a directory, or 0 if it can't be read
+time_t modified_time(path const& dir) {
+	try {
+		return ModifiedTime(dir);
+	}
+	catch (FileSystemError const&) {
+		return 0;
+	}
+}
+
+Files find(path const& dir, std::string const& filter, time_t modified) {
+	if (!modified) return nullptr;
+	std::lock_guard<std::mutex> lock(cache_lock);
+	auto it = cache.find(std::make_pair(dir.string(), filter));
+	if (it == cache.end() || it->second.modified != modified)
+		return nullptr;
+	return it->second.files;
+}
+
+void store(path const& dir, std::string const& filter, time_t modified, Files files) {
+	if (!modified || modified + settle_time > time(nullptr)) return;
+	std::lock_guard<std::mutex> lock(cache_lock);
+	cache[std::make_pair(dir.string(), filter)] = Listing{modified, std::move(files)};
+}
+}
+
+namespace agi { namespace fs {
+std::vector<std::string> ListDirectory(path const& dir, std::string const& filter) {
+	time_t modified = modified_time(dir);
+	if (auto files = find(dir, filter, modified))
+		return *files;
+
+	std::vector<std::string> files;
+	DirectoryIterator(dir, filter).GetAll(files);
+	store(dir, filter, modified, std::make_shared<const std::vector<std::string>>(files));
+	return files;
+}
+
+void ListDirectoryAsync(path const& dir, std::string const& filter,
+	std::function<void (std::vector<std::string>)> on_files,
+	std::function<void ()> on_done,
+	dispatch::CancellationToken token)
+{
+	auto deliver = [=](std::vector<std::string> files) {
+		auto shared = std::make_shared<std::vector<std::string>>(std::move(files));
+		dispatch::Main().Async([=] {
+			if (!token.Cancelled())
+				on_files(std::move(*shared));
+		});
+	};
+
+	dispatch::Background().Async([=] {
+		time_t modified = modified_time(dir);
+		if (auto files = find(dir, filter, modified)) {
+			if (!files->empty())
+				deliver(*files);
+		}
+		else {
+			auto all = std::make_shared<std::vector<std::string>>();
+			std::vector<std::string> batch;
+			auto last_batch = std::chrono::steady_clock::now();
+			for (auto const& file : DirectoryIterator(dir, filter)) {
+				if (token.Cancelled()) return;
+				all->push_back(file);
+				batch.push_back(file);
+
+				auto now = std::chrono::steady_clock::now();
+				if (batch.size() >= batch_size || now - last_batch >= batch_interval) {
+					deliver(std::move(batch));
+					batch.clear();
+					last_batch = now;
+				}
+			}
+			if (!batch.empty())
+				deliver(std::move(batch));
+			store(dir, filter, modified, std::move(all));
+		}
+
+		dispatch::Main().Async([=] {
+			if (!token.Cancelled())
+				on_done();
+		});
+	}, token);
+}
+
+void ClearDirectoryListings() {
+	std::lock_guard<std::mutex> lock(cache_lock);
+	cache.clear();
+}
+} }
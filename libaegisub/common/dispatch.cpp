@@ -16,50 +16,120 @@
 
 #include "libaegisub/dispatch.h"
 
+#include "libaegisub/perf.h"
+#include "libaegisub/trace.h"
 #include "libaegisub/util.h"
 
 #include <atomic>
-#include <boost/asio/io_service.hpp>
-#include <boost/asio/strand.hpp>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <thread>
 
 namespace {
-	boost::asio::io_service *service;
-	std::function<void (agi::dispatch::Thunk)> invoke_main;
+	using agi::dispatch::Priority;
+	using agi::dispatch::Thunk;
+
+	const size_t priority_count = 3;
+
+	std::function<void (Thunk)> invoke_main;
 	std::atomic<uint_fast32_t> threads_running;
 
-	class MainQueue final : public agi::dispatch::Queue {
-		void DoInvoke(agi::dispatch::Thunk thunk) override {
-			invoke_main(thunk);
+	/// Thread pool where each worker has its own task queues, which work
+	/// submitted from that worker goes onto. Workers run their own tasks
+	/// newest first and take the oldest tasks of the others when they run
+	/// out. A higher priority task anywhere is run before any lower priority
+	/// task.
+	class Scheduler {
+		struct Worker {
+			std::mutex lock;
+			std::deque<Thunk> tasks[priority_count];
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread> threads;
+
+		/// Tasks submitted from outside the pool
+		std::mutex lock;
+		std::deque<Thunk> global[priority_count];
+		std::condition_variable wake;
+		bool stop = false;
+
+		/// Number of tasks queued anywhere. Incremented before a task is
+		/// queued, so seeing zero under the lock means there's nothing to do.
+		std::atomic<size_t> pending{0};
+
+		agi::perf::Gauge& queued = agi::perf::GetGauge("dispatch/queued tasks");
+		agi::perf::Counter& run = agi::perf::GetCounter("dispatch/tasks run");
+
+		static thread_local Worker *current;
+
+		bool Take(std::mutex& m, std::deque<Thunk>& tasks, bool newest, Thunk& task) {
+			std::lock_guard<std::mutex> l(m);
+			if (tasks.empty()) return false;
+			if (newest) {
+				task = std::move(tasks.back());
+				tasks.pop_back();
+			}
+			else {
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			--pending;
+			queued.Add(-1);
+			return true;
 		}
-	};
 
-	class BackgroundQueue final : public agi::dispatch::Queue {
-		void DoInvoke(agi::dispatch::Thunk thunk) override {
-			service->post(thunk);
+		bool Next(Worker *self, size_t index, Thunk& task) {
+			for (size_t p = 0; p < priority_count; ++p) {
+				if (Take(self->lock, self->tasks[p], true, task)) return true;
+				if (Take(lock, global[p], false, task)) return true;
+				for (size_t i = 1; i < workers.size(); ++i) {
+					auto& victim = *workers[(index + i) % workers.size()];
+					if (Take(victim.lock, victim.tasks[p], false, task)) return true;
+				}
+			}
+			return false;
 		}
-	};
 
-	class SerialQueue final : public agi::dispatch::Queue {
-		boost::asio::io_service::strand strand;
+		void Run(size_t index) {
+			++threads_running;
+			agi::util::SetThreadName("Dispatch Worker");
+			agi::trace::NameThread("Dispatch Worker");
+			Worker *self = current = workers[index].get();
+
+			Thunk task;
+			for (;;) {
+				if (Next(self, index, task)) {
+					task();
+					task = nullptr;
+					run.Add();
+					continue;
+				}
 
-		void DoInvoke(agi::dispatch::Thunk thunk) override {
-			strand.post(thunk);
+				std::unique_lock<std::mutex> l(lock);
+				wake.wait(l, [&]{ return stop || pending > 0; });
+				if (stop && pending == 0) break;
+			}
+			--threads_running;
 		}
-	public:
-		SerialQueue() : strand(*service) { }
-	};
 
-	struct IOServiceThreadPool {
-		boost::asio::io_service io_service;
-		std::unique_ptr<boost::asio::io_service::work> work;
-		std::vector<std::thread> threads;
+	public:
+		Scheduler(size_t count) {
+			workers.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+				workers.emplace_back(new Worker);
+			threads.reserve(count);
+			for (size_t i = 0; i < count; ++i)
+				threads.emplace_back([=] { Run(i); });
+		}
 
-		IOServiceThreadPool() : work(new boost::asio::io_service::work(io_service)) { }
-		~IOServiceThreadPool() {
-			work.reset();
+		~Scheduler() {
+			{
+				std::lock_guard<std::mutex> l(lock);
+				stop = true;
+			}
+			wake.notify_all();
 #ifndef _WIN32
 			for (auto& thread : threads) thread.join();
 #else
@@ -69,29 +139,99 @@ namespace {
 			while (threads_running) std::this_thread::yield();
 #endif
 		}
+
+		size_t Size() const { return workers.size(); }
+
+		/// Queue a task, which must not throw
+		void Post(Priority priority, Thunk task) {
+			auto p = static_cast<size_t>(priority);
+			++pending;
+			queued.Add(1);
+			if (current) {
+				std::lock_guard<std::mutex> l(current->lock);
+				current->tasks[p].push_back(std::move(task));
+			}
+			else {
+				std::lock_guard<std::mutex> l(lock);
+				global[p].push_back(std::move(task));
+			}
+
+			// Taking the lock orders this with a worker's check of pending
+			// before it goes to sleep
+			{ std::lock_guard<std::mutex> l(lock); }
+			wake.notify_one();
+		}
+	};
+
+	thread_local Scheduler::Worker *Scheduler::current = nullptr;
+
+	Scheduler *scheduler;
+
+	class MainQueue final : public agi::dispatch::Queue {
+		void DoInvoke(Thunk thunk) override {
+			invoke_main(thunk);
+		}
+	};
+
+	class BackgroundQueue final : public agi::dispatch::Queue {
+		Priority priority;
+
+		void DoInvoke(Thunk thunk) override {
+			scheduler->Post(priority, std::move(thunk));
+		}
+	public:
+		BackgroundQueue(Priority priority) : priority(priority) { }
+	};
+
+	class SerialQueue final : public agi::dispatch::Queue {
+		/// Shared with the task running the queue, so that thunks queued
+		/// before the queue is destroyed still run
+		struct State {
+			std::mutex lock;
+			std::deque<Thunk> thunks;
+			bool running = false;
+		};
+		std::shared_ptr<State> state = std::make_shared<State>();
+		Priority priority;
+
+		static void Run(State& state) {
+			std::unique_lock<std::mutex> l(state.lock);
+			while (!state.thunks.empty()) {
+				auto thunk = std::move(state.thunks.front());
+				state.thunks.pop_front();
+				l.unlock();
+				thunk();
+				l.lock();
+			}
+			state.running = false;
+		}
+
+		void DoInvoke(Thunk thunk) override {
+			{
+				std::lock_guard<std::mutex> l(state->lock);
+				state->thunks.push_back(std::move(thunk));
+				if (state->running) return;
+				state->running = true;
+			}
+			auto state = this->state;
+			scheduler->Post(priority, [=] { Run(*state); });
+		}
+	public:
+		SerialQueue(Priority priority) : priority(priority) { }
 	};
 }
 
 namespace agi { namespace dispatch {
 
 void Init(std::function<void (Thunk)> invoke_main) {
-	static IOServiceThreadPool thread_pool;
-	::service = &thread_pool.io_service;
 	::invoke_main = invoke_main;
-
-	thread_pool.threads.reserve(std::max<unsigned>(4, std::thread::hardware_concurrency()));
-	for (size_t i = 0; i < thread_pool.threads.capacity(); ++i) {
-		thread_pool.threads.emplace_back([]{
-			++threads_running;
-			agi::util::SetThreadName("Dispatch Worker");
-			service->run();
-			--threads_running;
-		});
-	}
+	static Scheduler scheduler(std::max<unsigned>(4, std::thread::hardware_concurrency()));
+	::scheduler = &scheduler;
 }
 
 void Queue::Async(Thunk thunk) {
 	DoInvoke([=] {
+		agi::trace::Scope scope("async task", "dispatch");
 		try {
 			thunk();
 		}
@@ -102,6 +242,13 @@ void Queue::Async(Thunk thunk) {
 	});
 }
 
+void Queue::Async(Thunk thunk, CancellationToken token) {
+	Async([=] {
+		if (!token.Cancelled())
+			thunk();
+	});
+}
+
 void Queue::Sync(Thunk thunk) {
 	std::mutex m;
 	std::condition_variable cv;
@@ -109,6 +256,7 @@ void Queue::Sync(Thunk thunk) {
 	std::exception_ptr e;
 	bool done = false;
 	DoInvoke([&]{
+		agi::trace::Scope scope("sync task", "dispatch");
 		std::unique_lock<std::mutex> l(m);
 		try {
 			thunk();
@@ -128,13 +276,95 @@ Queue& Main() {
 	return q;
 }
 
-Queue& Background() {
-	static BackgroundQueue q;
-	return q;
+Queue& Background(Priority priority) {
+	static BackgroundQueue queues[] = {
+		BackgroundQueue(Priority::UI),
+		BackgroundQueue(Priority::Interactive),
+		BackgroundQueue(Priority::Background)
+	};
+	return queues[static_cast<size_t>(priority)];
 }
 
-std::unique_ptr<Queue> Create() {
-	return std::unique_ptr<Queue>(new SerialQueue);
+std::unique_ptr<Queue> Create(Priority priority) {
+	return std::unique_ptr<Queue>(new SerialQueue(priority));
+}
+
+CoalescingQueue::CoalescingQueue(Priority priority) : queue(Create(priority)) { }
+
+void CoalescingQueue::DoInvoke(Thunk thunk) {
+	// Async and Sync have already wrapped the thunk to catch its exceptions
+	queue->Async(std::move(thunk));
+}
+
+void CoalescingQueue::Async(int key, Thunk thunk) {
+	CancellationToken token;
+	{
+		std::lock_guard<std::mutex> l(lock);
+		auto& previous = latest[key];
+		previous.Cancel();
+		previous = token;
+	}
+	Async(std::move(thunk), std::move(token));
+}
+
+size_t ChunkSize(size_t count, size_t min_chunk) {
+	// A few chunks per thread so that uneven chunks balance out
+	size_t max_chunks = (scheduler->Size() + 1) * 4;
+	return std::max<size_t>({1, min_chunk, (count + max_chunks - 1) / max_chunks});
+}
+
+void ParallelFor(size_t begin, size_t end, size_t min_chunk, std::function<void (size_t, size_t)> const& body, Priority priority) {
+	if (begin >= end) return;
+
+	size_t chunk = ChunkSize(end - begin, min_chunk);
+	size_t chunks = (end - begin + chunk - 1) / chunk;
+	if (chunks == 1) return body(begin, end);
+
+	struct State {
+		std::atomic<size_t> next{0};
+		std::atomic<bool> failed{false};
+		size_t remaining;
+		std::mutex lock;
+		std::condition_variable done;
+		std::exception_ptr error;
+	};
+	auto state = std::make_shared<State>();
+	state->remaining = chunks;
+
+	// Chunks are claimed by whoever gets to them first, including the
+	// calling thread, so it only ever waits on chunks which are already
+	// running. Helpers which start after every chunk has been claimed exit
+	// without touching body, which may be gone by then.
+	auto body_ptr = &body;
+	auto run = [=] {
+		size_t i;
+		while ((i = state->next++) < chunks) {
+			size_t chunk_begin = begin + i * chunk;
+			if (!state->failed) {
+				try {
+					(*body_ptr)(chunk_begin, std::min(end, chunk_begin + chunk));
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> l(state->lock);
+					if (!state->error)
+						state->error = std::current_exception();
+					state->failed = true;
+				}
+			}
+
+			std::lock_guard<std::mutex> l(state->lock);
+			if (--state->remaining == 0)
+				state->done.notify_all();
+		}
+	};
+
+	for (size_t i = 0, helpers = std::min(chunks - 1, scheduler->Size()); i < helpers; ++i)
+		scheduler->Post(priority, run);
+	run();
+
+	std::unique_lock<std::mutex> l(state->lock);
+	state->done.wait(l, [&]{ return state->remaining == 0; });
+	if (state->error) std::rethrow_exception(state->error);
 }
 
 } }
@@ -22,6 +22,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
 #include <limits>
 
 #ifdef _WIN32
@@ -71,6 +72,46 @@ char *map(int64_t s_offset, uint64_t length, boost::interprocess::mode_t mode,
 	return static_cast<char *>(region->get_address()) + offset - mapping_start;
 }
 
+/// Innermost shared_read_mapping on this thread
+thread_local agi::shared_read_mapping *shared_mappings = nullptr;
+
+/// Ask the OS to start reading a region in from disk
+void prefetch(mapped_region& region) {
+#ifdef _WIN32
+	// PrefetchVirtualMemory is Windows 8+, so look it up at runtime
+	struct memory_range { void *address; SIZE_T size; };
+	typedef BOOL (WINAPI *prefetch_fn)(HANDLE, ULONG_PTR, memory_range *, ULONG);
+	static auto fn = reinterpret_cast<prefetch_fn>(
+		GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory"));
+	if (fn) {
+		memory_range range{region.get_address(), region.get_size()};
+		fn(GetCurrentProcess(), 1, &range, 0);
+	}
+#else
+	region.advise(mapped_region::advice_willneed);
+#endif
+}
+
+void set_file_size(agi::file_mapping const& file, agi::fs::path const& filename, uint64_t size) {
+	auto handle = file.get_mapping_handle().handle;
+#ifdef _WIN32
+	LARGE_INTEGER li;
+	li.QuadPart = size;
+	SetFilePointerEx(handle, li, nullptr, FILE_BEGIN);
+	SetEndOfFile(handle);
+#else
+	if (ftruncate(handle, size) == -1) {
+		switch (errno) {
+		case EBADF:  throw agi::InternalError("Error opening file " + filename.string() + " not handled");
+		case EFBIG:  throw agi::fs::DriveFull(filename);
+		case EINVAL: throw agi::InternalError("File opened incorrectly: " + filename.string());
+		case EROFS:  throw agi::fs::WriteDenied(filename);
+		default: throw agi::fs::FileSystemUnknownError("Unknown error opening file: " + filename.string());
+		}
+	}
+#endif
+}
+
 }
 
 namespace agi {
@@ -78,7 +119,8 @@ file_mapping::file_mapping(fs::path const& filename, bool temporary)
 #ifdef _WIN32
 : handle(CreateFileW(filename.wstring().c_str(),
 	temporary ? read_write : read_only,
-	temporary ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ,
+	// Writable files may be renamed while open by the shared audio cache
+	temporary ? FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE : FILE_SHARE_READ,
 	nullptr,
 	temporary ? OPEN_ALWAYS : OPEN_EXISTING,
 	0, 0))
@@ -136,28 +178,118 @@ const char *read_file_mapping::read(int64_t offset, uint64_t length) {
 	return map(offset, length, read_only, file_size, file, region, mapping_start);
 }
 
+shared_read_mapping::shared_read_mapping(fs::path filename)
+: filename(std::move(filename))
+, outer(shared_mappings)
+{
+	shared_mappings = this;
+}
+
+shared_read_mapping::~shared_read_mapping() {
+	shared_mappings = outer;
+}
+
+std::shared_ptr<read_file_mapping> open_read_mapping(fs::path const& filename) {
+	shared_read_mapping *found = nullptr;
+	for (auto s = shared_mappings; s; s = s->outer) {
+		if (s->filename != filename) continue;
+		if (s->mapping) return s->mapping;
+		found = s;
+	}
+
+	auto mapping = std::make_shared<read_file_mapping>(filename);
+	if (found)
+		found->mapping = mapping;
+	return mapping;
+}
+
+windowed_file_mapping::windowed_file_mapping(fs::path const& filename, uint64_t window_size, size_t max_windows)
+: file(filename, false)
+, window_size(window_size)
+, max_windows(std::max<size_t>(max_windows, 2))
+{
+	if (window_size == 0 || window_size % 0x100000 || window_size > std::numeric_limits<size_t>::max())
+		throw InternalError("Invalid file mapping window size");
+
+	offset_t size = 0;
+	ipcdetail::get_file_size(file.get_mapping_handle().handle, size);
+	file_size = static_cast<uint64_t>(size);
+}
+
+windowed_file_mapping::~windowed_file_mapping() { }
+
+size_t windowed_file_mapping::get_window(uint64_t start, uint64_t length, bool prefetch_window) {
+	for (size_t i = 0; i < windows.size(); ++i) {
+		auto const& w = windows[i];
+		if (start >= w.start && start + length <= w.start + w.region->get_size())
+			return i;
+	}
+
+	// Map whole windows, so that a read spanning a boundary gets a
+	// mapping big enough for it rather than failing
+	length = (length + window_size - 1) / window_size * window_size;
+	length = std::min(length, file_size - start);
+	if (length > std::numeric_limits<size_t>::max())
+		throw std::bad_alloc();
+
+	size_t slot = windows.size();
+	if (slot >= max_windows) {
+		slot = 0;
+		for (size_t i = 1; i < windows.size(); ++i) {
+			if (windows[i].last_used < windows[slot].last_used)
+				slot = i;
+		}
+		windows[slot].region.reset();
+	}
+	else
+		windows.emplace_back();
+
+	auto& w = windows[slot];
+	try {
+		w.region = agi::make_unique<mapped_region>(file, read_only, start, static_cast<size_t>(length));
+	}
+	catch (interprocess_exception const&) {
+		windows.erase(windows.begin() + slot);
+		throw fs::FileSystemUnknownError("Failed mapping a view of the file");
+	}
+	w.start = start;
+	w.last_used = ++use_count;
+
+	w.region->advise(mapped_region::advice_sequential);
+	if (prefetch_window)
+		prefetch(*w.region);
+	return slot;
+}
+
+const char *windowed_file_mapping::read(int64_t s_offset, uint64_t length) {
+	static char dummy = 0;
+	if (length == 0) return &dummy;
+
+	auto offset = static_cast<uint64_t>(s_offset);
+	if (offset + length > file_size)
+		throw InternalError("Attempted to map beyond end of file");
+
+	auto start = offset / window_size * window_size;
+	auto& w = windows[get_window(start, offset + length - start, false)];
+	w.last_used = ++use_count;
+	auto ret = static_cast<const char *>(w.region->get_address()) + offset - w.start;
+
+	// Past the middle of a window, so get the next one ready
+	uint64_t next = w.start + w.region->get_size();
+	if (offset + length > w.start + window_size / 2 && next < file_size)
+		windows[get_window(next, 1, true)].last_used = use_count;
+
+	return ret;
+}
+
 temp_file_mapping::temp_file_mapping(fs::path const& filename, uint64_t size)
 : file(filename, true)
 , file_size(size)
 {
-	auto handle = file.get_mapping_handle().handle;
-#ifdef _WIN32
-	LARGE_INTEGER li;
-	li.QuadPart = size;
-	SetFilePointerEx(handle, li, nullptr, FILE_BEGIN);
-	SetEndOfFile(handle);
-#else
+#ifndef _WIN32
 	unlink(filename.string().c_str());
-	if (ftruncate(handle, size) == -1) {
-		switch (errno) {
-		case EBADF:  throw InternalError("Error opening file " + filename.string() + " not handled");
-		case EFBIG:  throw fs::DriveFull(filename);
-		case EINVAL: throw InternalError("File opened incorrectly: " + filename.string());
-		case EROFS:  throw fs::WriteDenied(filename);
-		default: throw fs::FileSystemUnknownError("Unknown error opening file: " + filename.string());
-		}
-	}
 #endif
+	set_file_size(file, filename, size);
 }
 
 temp_file_mapping::~temp_file_mapping() { }
@@ -169,4 +301,30 @@ const char *temp_file_mapping::read(int64_t offset, uint64_t length) {
 char *temp_file_mapping::write(int64_t offset, uint64_t length) {
 	return map(offset, length, read_write, file_size, file, write_region, write_mapping_start);
 }
+
+persistent_file_mapping::persistent_file_mapping(fs::path const& filename)
+: filename(filename)
+, file(filename, true)
+{
+	offset_t size = 0;
+	ipcdetail::get_file_size(file.get_mapping_handle().handle, size);
+	file_size = static_cast<uint64_t>(size);
+}
+
+persistent_file_mapping::~persistent_file_mapping() { }
+
+void persistent_file_mapping::resize(uint64_t size) {
+	read_region.reset();
+	write_region.reset();
+	set_file_size(file, filename, size);
+	file_size = size;
+}
+
+const char *persistent_file_mapping::read(int64_t offset, uint64_t length) {
+	return map(offset, length, read_only, file_size, file, read_region, read_mapping_start);
+}
+
+char *persistent_file_mapping::write(int64_t offset, uint64_t length) {
+	return map(offset, length, read_write, file_size, file, write_region, write_mapping_start);
+}
 }
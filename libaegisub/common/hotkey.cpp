@@ -14,6 +14,7 @@
 
 #include "libaegisub/hotkey.h"
 
+#include "libaegisub/cajun/reader.h"
 #include "libaegisub/cajun/writer.h"
 #include "libaegisub/fs.h"
 #include "libaegisub/io.h"
@@ -40,48 +41,159 @@ struct combo_cmp {
 	}
 };
 
-struct hotkey_visitor : json::ConstVisitor {
-	std::string const& context;
-	std::string const& command;
-	Hotkey::HotkeyMap& map;
-	bool needs_backup = false;
+/// Pack a combo string, or return 0 if it can't be packed
+///
+/// Only the modifier order which keypresses are turned into strings with is
+/// accepted, as other orders can't match a keypress when scanning by string.
+uint32_t pack(std::string const& str, KeyCodeLookup const& key_code) {
+	uint32_t modifiers = 0;
+	size_t pos = 0;
+	auto modifier = [&](const char *name, size_t len, uint32_t bit) {
+		if (str.size() > pos + len && str.compare(pos, len, name) == 0) {
+			modifiers |= bit;
+			pos += len;
+		}
+	};
+	modifier("Ctrl-", 5, MOD_CTRL);
+	modifier("Alt-", 4, MOD_ALT);
+	modifier("Shift-", 6, MOD_SHIFT);
+
+	uint32_t code = key_code(str.substr(pos));
+	if (!code || (code & (MOD_CTRL | MOD_ALT | MOD_SHIFT)))
+		return 0;
+	return modifiers | code;
+}
 
-	hotkey_visitor(std::string const& context, std::string const& command, Hotkey::HotkeyMap& map)
-	: context(context), command(command), map(map) { }
+/// Reads a hotkey config, which maps contexts to commands to lists of
+/// hotkeys, straight into combos. Each hotkey is either the combo's string or
+/// an object with the list of modifiers and the key as written by 3.1 and
+/// earlier.
+class hotkey_reader final : public json::Reader::Handler {
+	/// Nesting depth: 1 is the root object, 2 a context, 3 a command's list
+	/// of hotkeys, 4 an old-style hotkey and 5 its list of modifiers
+	int depth = 0;
+	/// Depth within a value which is being ignored
+	int skip = 0;
+
+	std::string context;
+	std::string command;
+	std::string member;
+
+	bool has_modifiers = false;
+	bool has_key = false;
+	std::string key_str;
+	std::string key;
+
+	[[noreturn]] static void Invalid() {
+		throw json::Exception("Invalid hotkey configuration");
+	}
 
-	void Visit(std::string const& string) override {
-		map.insert(make_pair(command, Combo(context, command, string)));
+	void Insert(std::string keys) {
+		map.insert(make_pair(command, Combo(context, command, std::move(keys))));
 	}
 
-	void Visit(json::Object const& hotkey) override {
-		auto mod_it = hotkey.find("modifiers");
-		if (mod_it == end(hotkey)) {
+	void HotkeyEnd() {
+		if (!has_modifiers) {
 			LOG_E("agi/hotkey/load") << "Hotkey for command '" << command << "' is missing modifiers";
 			return;
 		}
-		auto key_it = hotkey.find("key");
-		if (key_it == end(hotkey)) {
+		if (!has_key) {
 			LOG_E("agi/hotkey/load") << "Hotkey for command '" << command << "' is missing the key";
 			return;
 		}
 
-		std::string key_str;
-		json::Array const& arr_mod = mod_it->second;
-		for (std::string const& mod : arr_mod) {
-			key_str += mod;
-			key_str += '-';
+		Insert(key_str + key);
+		needs_backup = true;
+	}
+
+	/// Handle a value which isn't a string or a container
+	void Other() {
+		if (skip || depth == 3) return;
+		if (depth != 4 || member == "modifiers" || member == "key")
+			Invalid();
+	}
+
+public:
+	Hotkey::HotkeyMap map;
+	bool needs_backup = false;
+
+	void ObjectBegin() override {
+		if (skip) { ++skip; return; }
+		switch (depth) {
+			case 0: case 1:
+				++depth;
+				break;
+			case 3:
+				depth = 4;
+				has_modifiers = has_key = false;
+				key_str.clear();
+				break;
+			case 4:
+				if (member == "modifiers" || member == "key")
+					Invalid();
+				skip = 1;
+				break;
+			default:
+				Invalid();
 		}
-		key_str += static_cast<std::string const&>(key_it->second);
+	}
 
-		map.insert(make_pair(command, Combo(context, command, std::move(key_str))));
-		needs_backup = true;
+	void ObjectEnd() override {
+		if (skip) { --skip; return; }
+		if (depth == 4)
+			HotkeyEnd();
+		--depth;
+	}
+
+	void ArrayBegin() override {
+		if (skip) { ++skip; return; }
+		if (depth == 2)
+			depth = 3;
+		else if (depth == 3 || (depth == 4 && member != "modifiers" && member != "key"))
+			skip = 1;
+		else if (depth == 4 && member == "modifiers") {
+			depth = 5;
+			has_modifiers = true;
+		}
+		else
+			Invalid();
+	}
+
+	void ArrayEnd() override {
+		if (skip) { --skip; return; }
+		--depth;
+	}
+
+	void Member(std::string const& name) override {
+		if (skip) return;
+		if (depth == 1)
+			context = name;
+		else if (depth == 2)
+			command = name;
+		else if (depth == 4)
+			member = name;
+	}
+
+	void Value(json::String&& string) override {
+		if (skip) return;
+		if (depth == 3)
+			Insert(std::move(string));
+		else if (depth == 5) {
+			key_str += string;
+			key_str += '-';
+		}
+		else if (depth == 4 && member == "key") {
+			key = std::move(string);
+			has_key = true;
+		}
+		else if (depth != 4 || member == "modifiers")
+			Invalid();
 	}
 
-	void Visit(const json::Array& array) override { }
-	void Visit(int64_t number) override { }
-	void Visit(double number) override { }
-	void Visit(bool boolean) override { }
-	void Visit(const json::Null& null) override { }
+	void Value(json::Integer) override { Other(); }
+	void Value(json::Double) override { Other(); }
+	void Value(json::Boolean) override { Other(); }
+	void Value(json::Null) override { Other(); }
 };
 }
 
@@ -90,23 +202,15 @@ Hotkey::Hotkey(fs::path const& file, std::pair<const char *, size_t> default_con
 {
 	LOG_D("hotkey/init") << "Generating hotkeys.";
 
-	auto root = json_util::file(config_file, default_config);
-	for (auto const& hotkey_context : static_cast<json::Object const&>(root))
-		BuildHotkey(hotkey_context.first, hotkey_context.second);
+	json_util::file(config_file, default_config, [&](std::istream& stream) {
+		hotkey_reader reader;
+		json::Reader::Read(reader, stream);
+		cmd_map = std::move(reader.map);
+		backup_config_file = reader.needs_backup;
+	});
 	UpdateStrMap();
 }
 
-void Hotkey::BuildHotkey(std::string const& context, json::Object const& hotkeys) {
-	for (auto const& command : hotkeys) {
-		json::Array const& command_hotkeys = command.second;
-
-		hotkey_visitor visitor{context, command.first, cmd_map};
-		for (auto const& hotkey : command_hotkeys)
-			hotkey.Accept(visitor);
-		backup_config_file |= visitor.needs_backup;
-	}
-}
-
 std::string Hotkey::Scan(std::string const& context, std::string const& str, bool always) const {
 	const std::string *local = nullptr, *dfault = nullptr;
 
@@ -136,6 +240,21 @@ std::string Hotkey::Scan(std::string const& context, std::string const& str, boo
 	return "";
 }
 
+std::string const& Hotkey::Scan(std::string const& context, uint32_t combo, bool always) const {
+	static const std::string none;
+
+	if (always) {
+		auto it = packed_always.find(combo);
+		if (it != packed_always.end())
+			return *it->second;
+	}
+
+	auto ctx = packed_map.find(context);
+	auto const& combos = ctx != packed_map.end() ? ctx->second : packed_default;
+	auto it = combos.find(combo);
+	return it != combos.end() ? *it->second : none;
+}
+
 bool Hotkey::HasHotkey(std::string const& context, std::string const& str) const {
 	std::vector<const Combo *>::const_iterator index, end;
 	for (std::tie(index, end) = boost::equal_range(str_map, str, combo_cmp()); index != end; ++index) {
@@ -201,6 +320,46 @@ void Hotkey::UpdateStrMap() {
 		str_map.push_back(&combo.second);
 
 	sort(begin(str_map), end(str_map), combo_cmp());
+	UpdatePackedMap();
+}
+
+void Hotkey::UpdatePackedMap() {
+	packed_map.clear();
+	packed_default.clear();
+	packed_always.clear();
+	if (!key_code) return;
+
+	// Scanning by string picks the first match in Always and the last one in
+	// any other context when a combo is bound more than once, so insert in
+	// the same order and keep the same one
+	std::vector<std::pair<uint32_t, const Combo *>> packed;
+	packed.reserve(str_map.size());
+	for (auto combo : str_map) {
+		if (uint32_t key = pack(combo->Str(), key_code))
+			packed.emplace_back(key, combo);
+	}
+
+	for (auto const& combo : packed) {
+		auto const& context = combo.second->Context();
+		if (context == "Always")
+			packed_always.emplace(combo.first, &combo.second->CmdName());
+		if (context == "Default")
+			packed_default[combo.first] = &combo.second->CmdName();
+		packed_map[context];
+	}
+
+	for (auto& context : packed_map)
+		context.second = packed_default;
+	for (auto const& combo : packed) {
+		auto const& context = combo.second->Context();
+		if (context != "Default")
+			packed_map[context][combo.first] = &combo.second->CmdName();
+	}
+}
+
+void Hotkey::SetKeyCodeLookup(KeyCodeLookup lookup) {
+	key_code = std::move(lookup);
+	UpdatePackedMap();
 }
 
 void Hotkey::SetHotkeyMap(HotkeyMap new_map) {
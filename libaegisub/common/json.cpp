@@ -27,11 +27,10 @@
 
 namespace agi { namespace json_util {
 
-json::UnknownElement parse(std::istream &stream) {
+namespace {
+void read_logged(std::istream &stream, std::function<void (std::istream&)> const& read) {
 	try {
-		json::UnknownElement root;
-		json::Reader::Read(root, stream);
-		return root;
+		read(stream);
 	} catch (json::Reader::ParseException& e) {
 		LOG_E("json/parse") << "json::ParseException: " << e.what() << ", Line/offset: " << e.m_locTokenBegin.m_nLine + 1 << '/' << e.m_locTokenBegin.m_nLineOffset + 1;
 		throw;
@@ -40,23 +39,36 @@ json::UnknownElement parse(std::istream &stream) {
 		throw;
 	}
 }
+}
 
-json::UnknownElement file(agi::fs::path const& file, std::pair<const char *, size_t> default_config) {
+json::UnknownElement parse(std::istream &stream) {
+	json::UnknownElement root;
+	read_logged(stream, [&](std::istream& stream) { json::Reader::Read(root, stream); });
+	return root;
+}
+
+void file(agi::fs::path const& file, std::pair<const char *, size_t> default_config, std::function<void (std::istream&)> const& read) {
 	try {
 		if (fs::FileExists(file))
-			return parse(*io::Open(file));
+			return read_logged(*io::Open(file), read);
 	}
 	catch (fs::FileNotFound const&) {
 		// Not an error
 	}
 	catch (json::Exception&) {
-		// Already logged in parse
+		// Already logged in read_logged
 	}
 	catch (agi::Exception& e) {
 		LOG_E("json/file") << "Unexpected error when reading config file " << file << ": " << e.GetMessage();
 	}
 	boost::interprocess::ibufferstream stream(default_config.first, default_config.second);
-	return parse(stream);
+	read_logged(stream, read);
+}
+
+json::UnknownElement file(agi::fs::path const& file, std::pair<const char *, size_t> default_config) {
+	json::UnknownElement root;
+	agi::json_util::file(file, default_config, [&](std::istream& stream) { json::Reader::Read(root, stream); });
+	return root;
 }
 
 } }
@@ -16,7 +16,9 @@
 
 #include "libaegisub/kana_table.h"
 
-#include <boost/range/algorithm.hpp>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
 
 namespace {
 agi::kana_pair kana_to_romaji[] = {
@@ -578,43 +580,50 @@ agi::kana_pair romaji_to_kana[] = {
 	{"\xE3\x83\x85", "zu"},              // ヅ
 };
 
-bool cmp_kana(agi::kana_pair const& kp, std::string const& kana) {
-	return strcmp(kp.kana, kana.c_str()) < 0;
-}
-
-struct cmp_romaji {
-	bool operator()(agi::kana_pair const& kp, std::string const& romaji) const {
-		return strcmp(kp.romaji, romaji.c_str()) < 0;
-	}
-	bool operator()(std::string const& romaji, agi::kana_pair const& kp) const {
-		return strcmp(kp.romaji, romaji.c_str()) > 0;
-	}
+/// Hash indexes of the tables, which are built the first time each is used
+/// since the karaoke matcher looks things up in them a lot
+using kana_index = std::unordered_map<std::string, std::vector<const char *>>;
+using romaji_index = std::unordered_map<std::string, boost::iterator_range<const agi::kana_pair *>>;
 
-#ifdef _MSC_VER // debug iterator stuff needs this overload
-	bool operator()(agi::kana_pair const& a, agi::kana_pair const& b) const {
-		return strcmp(a.romaji, b.romaji) < 0;
-	}
-#endif
-};
+kana_index const& get_kana_index() {
+	static const kana_index index = [] {
+		kana_index index;
+		for (auto const& kp : kana_to_romaji)
+			index[kp.kana].push_back(kp.romaji);
+		return index;
+	}();
+	return index;
+}
 
+romaji_index const& get_romaji_index() {
+	static const romaji_index index = [] {
+		// The table is sorted by romaji, so each romaji's entries are contiguous
+		romaji_index index;
+		for (const agi::kana_pair *it = std::begin(romaji_to_kana), *end = std::end(romaji_to_kana); it != end; ) {
+			auto next = std::find_if(it, end, [&](agi::kana_pair const& kp) { return strcmp(kp.romaji, it->romaji) != 0; });
+			index.emplace(it->romaji, boost::make_iterator_range(it, next));
+			it = next;
+		}
+		return index;
+	}();
+	return index;
+}
 }
 
 namespace agi {
 std::vector<const char *> kana_to_romaji(std::string const& kana) {
-	std::vector<const char *> ret;
-	for (auto pair = boost::lower_bound(::kana_to_romaji, kana, cmp_kana);
-		pair != std::end(::kana_to_romaji) && !strcmp(pair->kana, kana.c_str());
-		++pair)
-		ret.push_back(pair->romaji);
-	return ret;
+	auto const& index = get_kana_index();
+	auto it = index.find(kana);
+	return it == index.end() ? std::vector<const char *>() : it->second;
 }
 
 boost::iterator_range<const kana_pair *> romaji_to_kana(std::string const& romaji) {
+	auto const& index = get_romaji_index();
 	for (size_t len = std::min<size_t>(3, romaji.size()); len > 0; --len) {
-		auto pair = boost::equal_range(::romaji_to_kana, romaji.substr(0, len).c_str(), cmp_romaji());
-		if (pair.first != pair.second)
-			return boost::make_iterator_range(pair.first, pair.second);
+		auto it = index.find(romaji.substr(0, len));
+		if (it != index.end())
+			return it->second;
 	}
-	return boost::make_iterator_range(::romaji_to_kana, ::romaji_to_kana);
+	return boost::make_iterator_range(std::begin(::romaji_to_kana), std::begin(::romaji_to_kana));
 }
 }
@@ -19,11 +19,16 @@
 #include "libaegisub/kana_table.h"
 #include "libaegisub/util.h"
 
+#include <algorithm>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/locale/boundary.hpp>
 #include <boost/locale/collator.hpp>
 #include <boost/range/algorithm/copy.hpp>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <unicode/uchar.h>
 #include <unicode/utf8.h>
 
@@ -53,6 +58,181 @@ int compare(std::string const& a, std::string const& b) {
 	return std::use_facet<collator<char>>(std::locale()).compare(collator_base::primary, a, b);
 }
 
+using agi::kana_to_romaji;
+using agi::karaoke_match_result;
+
+/// Matcher for every syllable of a line at once
+///
+/// Each way of splitting the line into groups of source syllables and
+/// destination characters is scored by how well each group's romaji reads
+/// as its characters, and the best splitting is found with a dynamic
+/// programming search over (syllables used, characters used).
+class line_matcher {
+	/// Source syllables, lowercased with all whitespace removed
+	std::vector<std::string> src;
+	/// Destination characters, lowercased
+	std::vector<std::string> dst;
+	std::vector<bool> dst_space;
+	/// The ASCII character each non-ASCII destination character is
+	/// equivalent to ignoring width and accents, or zero
+	std::vector<char> dst_ascii;
+	/// Romaji readings of each destination character, and of each pair of
+	/// characters starting at each index
+	std::vector<std::vector<const char *>> readings;
+	std::vector<std::vector<const char *>> pair_readings;
+
+	// Limits on the size of a group which isn't the last one on the line
+	static const size_t max_group_syllables = 12;
+	static const size_t max_group_characters = 8;
+
+	/// Can src[offset..] be read as exactly the destination characters
+	/// [first, last), ignoring whitespace in them?
+	bool reads_as(std::string const& romaji, size_t offset, size_t first, size_t last) const {
+		while (first != last && dst_space[first]) ++first;
+		if (first == last) return offset == romaji.size();
+
+		auto const& chr = dst[first];
+		if (romaji.compare(offset, chr.size(), chr) == 0 && reads_as(romaji, offset + chr.size(), first + 1, last))
+			return true;
+
+		// Characters which only differ in width or accents
+		if (offset < romaji.size()) {
+			if (static_cast<unsigned char>(romaji[offset]) < 0x80) {
+				if (dst_ascii[first] == romaji[offset] && reads_as(romaji, offset + 1, first + 1, last))
+					return true;
+			}
+			else {
+				size_t next = offset;
+				next_codepoint(romaji.c_str(), &next);
+				if (compare(romaji.substr(offset, next - offset), chr) == 0 && reads_as(romaji, next, first + 1, last))
+					return true;
+			}
+		}
+
+		auto try_readings = [&](std::vector<const char *> const& kana, size_t width) {
+			for (auto reading : kana) {
+				size_t len = strlen(reading);
+				if (romaji.compare(offset, len, reading) == 0 && reads_as(romaji, offset + len, first + width, last))
+					return true;
+			}
+			return false;
+		};
+		return (first + 1 < last && try_readings(pair_readings[first], 2)) || try_readings(readings[first], 1);
+	}
+
+	/// Cost of matching the syllables whose concatenation is romaji with the
+	/// destination characters [first, last); negative for a group which is
+	/// definitely right and infinite for one which can't be
+	double cost(std::string const& romaji, size_t syllables, size_t first, size_t last) const {
+		size_t kana = 0, other = 0;
+		for (size_t i = first; i < last; ++i) {
+			if (dst_space[i]) continue;
+			if (readings[i].empty()) ++other;
+			else ++kana;
+		}
+
+		if (kana + other == 0)
+			// Empty syllables can go with nothing, but nothing else should
+			// unless the destination has run out
+			return romaji.empty() ? 0 : last == dst.size() ? 10 : std::numeric_limits<double>::infinity();
+		if (romaji.empty())
+			return 5;
+		// Every exact group scores the same, so that splitting a match into
+		// more groups is preferred
+		if (reads_as(romaji, 0, first, last))
+			return -1;
+
+		// Anything else is presumably kanji, which usually have a reading
+		// of one to three syllables
+		double expected = 2.0 * other + kana;
+		double base = other ? 2 : 5;
+		return base + 0.5 * std::abs(static_cast<double>(syllables) - expected);
+	}
+
+public:
+	line_matcher(std::vector<std::string> const& source_strings, std::string const& dest_string) {
+		src.reserve(source_strings.size());
+		for (auto const& syl : source_strings) {
+			std::string stripped;
+			for (size_t i = 0; i < syl.size(); ) {
+				size_t start = i;
+				if (!is_whitespace(next_codepoint(syl.c_str(), &i)))
+					stripped.append(syl, start, i - start);
+			}
+			src.push_back(boost::to_lower_copy(stripped));
+		}
+
+		using namespace boost::locale::boundary;
+		ssegment_index characters(character, begin(dest_string), end(dest_string));
+		for (auto const& chr : characters) {
+			dst.push_back(boost::to_lower_copy(chr.str()));
+			dst_space.push_back(is_whitespace(chr.str()));
+			readings.push_back(kana_to_romaji(chr.str()));
+
+			// Comparing with the collator is slow, so it's done once here
+			// rather than each time the character is tried
+			char ascii = 0;
+			if (static_cast<unsigned char>(chr.str()[0]) >= 0x80 && readings.back().empty()) {
+				for (char c = '0'; c <= 'z' && !ascii; ++c) {
+					if (isalnum(c) && !isupper(c) && compare(std::string(1, c), chr.str()) == 0)
+						ascii = c;
+				}
+			}
+			dst_ascii.push_back(ascii);
+		}
+		for (size_t i = 0; i < dst.size(); ++i)
+			pair_readings.push_back(i + 1 < dst.size() ? kana_to_romaji(dst[i] + dst[i + 1]) : std::vector<const char *>());
+	}
+
+	std::vector<karaoke_match_result> match() const {
+		std::vector<karaoke_match_result> groups;
+		if (src.empty()) return groups;
+
+		const size_t n = src.size(), m = dst.size();
+		const double unreachable = std::numeric_limits<double>::infinity();
+		auto state = [=](size_t i, size_t j) { return i * (m + 1) + j; };
+
+		// best[state(i, j)] is the lowest total cost of matching the first i
+		// syllables to the first j characters, and prev its last group
+		std::vector<double> best((n + 1) * (m + 1), unreachable);
+		std::vector<karaoke_match_result> prev((n + 1) * (m + 1), karaoke_match_result{0, 0});
+		best[0] = 0;
+
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t j = 0; j <= m; ++j) {
+				double here = best[state(i, j)];
+				if (here == unreachable) continue;
+
+				std::string romaji;
+				for (size_t a = 1; a <= max_group_syllables && i + a <= n; ++a) {
+					romaji += src[i + a - 1];
+					// The last group has to take whatever's left over
+					size_t max_b = i + a == n ? m - j : std::min(max_group_characters, m - j);
+					for (size_t b = 0; b <= max_b; ++b) {
+						double c = cost(romaji, a, j, j + b);
+						auto& next = best[state(i + a, j + b)];
+						if (here + c < next) {
+							next = here + c;
+							prev[state(i + a, j + b)] = karaoke_match_result{a, b};
+						}
+					}
+				}
+			}
+		}
+
+		for (size_t i = n, j = m; i > 0; ) {
+			auto group = prev[state(i, j)];
+			// Should never happen as the last group can take everything
+			if (group.source_length == 0) return {karaoke_match_result{n, m}};
+			groups.push_back(group);
+			i -= group.source_length;
+			j -= group.destination_length;
+		}
+		std::reverse(groups.begin(), groups.end());
+		return groups;
+	}
+};
+
 }
 
 namespace agi {
@@ -204,4 +384,8 @@ karaoke_match_result auto_match_karaoke(std::vector<std::string> const& source_s
 
 	return result;
 }
+
+std::vector<karaoke_match_result> auto_match_karaoke_line(std::vector<std::string> const& source_strings, std::string const& dest_string) {
+	return line_matcher(source_strings, dest_string).match();
+}
 }
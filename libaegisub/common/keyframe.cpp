@@ -20,53 +20,41 @@
 #include "libaegisub/keyframe.h"
 
 #include "libaegisub/io.h"
-#include "libaegisub/line_iterator.h"
+#include "line_scanner.h"
 
-#include <boost/algorithm/string/predicate.hpp>
 #include <boost/range/algorithm/copy.hpp>
+#include <cctype>
 
 namespace {
-std::vector<int> agi_keyframes(std::istream &file) {
-	double fps;
-	std::string fps_str;
-	file >> fps_str;
-	file >> fps;
+using agi::line_scanner::for_each_line;
+using agi::line_scanner::starts_with;
 
-	return std::vector<int>(agi::line_iterator<int>(file), agi::line_iterator<int>());
-}
+/// Frame type from a line of a two-pass stats file
+typedef char (*frame_type_fn)(const char *begin, const char *end);
 
-std::vector<int> other_keyframes(std::istream &file, char (*func)(std::string const&)) {
-	int count = 0;
-	std::vector<int> ret;
-	agi::line_iterator<std::string> end;
-	for (auto line : agi::line_iterator<std::string>(file)) {
-		char c = tolower(func(line));
-		if (c == 'i')
-			ret.push_back(count++);
-		else if (c == 'p' || c == 'b')
-			++count;
-	}
-	return ret;
-}
+// Stats files for long encodes can be hundreds of megabytes, so these all
+// look at the lines in place in the mapped file rather than copying them
 
-char xvid(std::string const& line) {
-	return line.empty() ? 0 : line[0];
+char xvid(const char *begin, const char *end) {
+	return begin == end ? 0 : *begin;
 }
 
-char divx(std::string const& line) {
-	char chrs[] = "IPB";
-	for (int i = 0; i < 3; ++i) {
-		std::string::size_type pos = line.find(chrs[i]);
-		if (pos != line.npos)
-			return line[pos];
+char divx(const char *begin, const char *end) {
+	for (char c : {'I', 'P', 'B'}) {
+		if (auto pos = static_cast<const char *>(memchr(begin, c, end - begin)))
+			return *pos;
 	}
 	return 0;
 }
 
-char x264(std::string const& line) {
-	std::string::size_type pos = line.find("type:");
-	if (pos == line.npos || pos + 5 >= line.size()) return 0;
-	return line[pos + 5];
+char x264(const char *begin, const char *end) {
+	for (auto pos = begin; end - pos > 5; ++pos) {
+		pos = static_cast<const char *>(memchr(pos, 't', end - pos - 5));
+		if (!pos) break;
+		if (memcmp(pos, "type:", 5) == 0)
+			return pos[5];
+	}
+	return 0;
 }
 }
 
@@ -80,20 +68,58 @@ void Save(agi::fs::path const& filename, std::vector<int> const& keyframes) {
 }
 
 std::vector<int> Load(agi::fs::path const& filename) {
-	auto file = io::Open(filename);
-	std::istream &is(*file);
-
-	std::string header;
-	getline(is, header);
-
-	if (header == "# keyframe format v1") return agi_keyframes(is);
-	if (boost::starts_with(header, "# XviD 2pass stat file")) return other_keyframes(is, xvid);
-	if (boost::starts_with(header, "# ffmpeg 2-pass log file, using xvid codec")) return other_keyframes(is, xvid);
-	if (boost::starts_with(header, "# avconv 2-pass log file, using xvid codec")) return other_keyframes(is, xvid);
-	if (boost::starts_with(header, "##map version")) return other_keyframes(is, divx);
-	if (boost::starts_with(header, "#options:")) return other_keyframes(is, x264);
+	auto mapping = open_read_mapping(filename);
+	auto& file = *mapping;
+
+	// Keyframe files list the keyframe numbers, while for the stats files
+	// frame_type gets the type of each frame from its line
+	frame_type_fn frame_type = nullptr;
+	bool aegi = false;
+	bool header = true;
+	bool skip_fps = true;
+	int count = 0;
+	std::vector<int> ret;
 
-	throw Error("Unknown keyframe format");
+	for_each_line(file, [&](const char *begin, const char *end) {
+		if (header) {
+			header = false;
+			if (end - begin == 20 && starts_with(begin, end, "# keyframe format v1"))
+				aegi = true;
+			else if (starts_with(begin, end, "# XviD 2pass stat file")
+				|| starts_with(begin, end, "# ffmpeg 2-pass log file, using xvid codec")
+				|| starts_with(begin, end, "# avconv 2-pass log file, using xvid codec"))
+				frame_type = xvid;
+			else if (starts_with(begin, end, "##map version"))
+				frame_type = divx;
+			else if (starts_with(begin, end, "#options:"))
+				frame_type = x264;
+			else
+				throw Error("Unknown keyframe format");
+			return;
+		}
+
+		if (aegi) {
+			// The line after the header gives the FPS, which is unused
+			if (skip_fps) {
+				skip_fps = false;
+				return;
+			}
+			int frame;
+			if (line_scanner::parse_int(begin, end, frame))
+				ret.push_back(frame);
+		}
+		else {
+			char c = tolower(frame_type(begin, end));
+			if (c == 'i')
+				ret.push_back(count++);
+			else if (c == 'p' || c == 'b')
+				++count;
+		}
+	});
+
+	if (header)
+		throw Error("Unknown keyframe format");
+	return ret;
 }
 
 } }
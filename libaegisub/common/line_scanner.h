@@ -0,0 +1,114 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file line_scanner.h
+/// @brief Allocation-free line-by-line reading of ASCII-compatible files
+/// @ingroup libaegisub
+
+#pragma once
+
+#include <libaegisub/file_mapping.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace agi { namespace line_scanner {
+/// @brief Call a function with each line of a memory-mapped file
+/// @param file File to read
+/// @param func Function called with pointers to the start and end of each line
+///
+/// Lines are split on LF with a trailing CR removed. The file is mapped a
+/// chunk at a time, so this works for files larger than the address space.
+template<typename Func>
+void for_each_line(read_file_mapping &file, Func&& func) {
+	const uint64_t chunk_size = 0x1000000;
+	const uint64_t size = file.size();
+	uint64_t pos = 0;
+	uint64_t length = std::min(chunk_size, size);
+
+	auto line_end = [](const char *begin, const char *end) {
+		return end > begin && end[-1] == '\r' ? end - 1 : end;
+	};
+
+	while (pos < size) {
+		const char *data = file.read(pos, length);
+		const char *end = data + length;
+		const char *line = data;
+		while (auto lf = static_cast<const char *>(memchr(line, '\n', end - line))) {
+			func(line, line_end(line, lf));
+			line = lf + 1;
+		}
+
+		if (pos + length == size) {
+			if (line != end)
+				func(line, line_end(line, end));
+			return;
+		}
+
+		if (line == data) {
+			// A single line longer than the chunk, so map more at once
+			length = std::min(length * 2, size - pos);
+			continue;
+		}
+
+		pos += line - data;
+		length = std::min(chunk_size, size - pos);
+	}
+}
+
+/// @brief Parse a decimal integer at the start of a string
+/// @param begin Start of the string
+/// @param end End of the string
+/// @param[out] value Parsed value
+/// @return Was there an integer in range at the start of the string?
+///
+/// Like operator>>, leading whitespace is skipped and parsing stops at the
+/// first character which isn't a digit.
+inline bool parse_int(const char *begin, const char *end, int &value) {
+	while (begin != end && (*begin == ' ' || *begin == '\t' || *begin == '\r' || *begin == '\v' || *begin == '\f'))
+		++begin;
+
+	bool negative = false;
+	if (begin != end && (*begin == '-' || *begin == '+'))
+		negative = *begin++ == '-';
+
+	if (begin == end || *begin < '0' || *begin > '9')
+		return false;
+
+	int64_t ret = 0;
+	for (; begin != end && *begin >= '0' && *begin <= '9'; ++begin) {
+		ret = ret * 10 + (*begin - '0');
+		if (ret > -int64_t(std::numeric_limits<int>::min()))
+			return false;
+	}
+
+	if (negative) ret = -ret;
+	if (ret > std::numeric_limits<int>::max())
+		return false;
+	value = int(ret);
+	return true;
+}
+
+/// Does the string [begin, end) start with prefix?
+inline bool starts_with(const char *begin, const char *end, const char *prefix) {
+	size_t len = strlen(prefix);
+	return size_t(end - begin) >= len && memcmp(begin, prefix, len) == 0;
+}
+
+} }
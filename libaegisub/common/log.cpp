@@ -34,26 +34,60 @@ LogSink *log;
 /// Keep this ordered the same as Severity
 const char *Severity_ID = "EAWID";
 
-LogSink::LogSink() : queue(dispatch::Create()) { }
+struct LogSink::PendingMessage {
+	SinkMessage sm;
+	PendingMessage *next;
+};
+
+LogSink::LogSink() : queue(dispatch::Create(dispatch::Priority::Background)) { }
 
 LogSink::~LogSink() {
 	// The destructor for emitters may try to log messages, so disable all the
 	// emitters before destructing any
 	decltype(emitters) emitters_temp;
 	queue->Sync([&]{ swap(emitters_temp, emitters); });
+
+	for (auto msg = pending.exchange(nullptr); msg; ) {
+		auto next = msg->next;
+		delete msg;
+		msg = next;
+	}
+}
+
+void LogSink::Log(SinkMessage sm) {
+	auto msg = new PendingMessage{std::move(sm), pending.load(std::memory_order_relaxed)};
+	while (!pending.compare_exchange_weak(msg->next, msg, std::memory_order_release, std::memory_order_relaxed)) ;
+
+	// Whoever pushed onto an empty list queues the drain, which picks up
+	// everything pushed before it runs
+	if (!msg->next)
+		queue->Async([=] { Drain(); });
 }
 
-void LogSink::Log(SinkMessage const& sm) {
-	queue->Async([=] {
+void LogSink::Drain() {
+	// Reverse the list to emit the messages in the order they were logged
+	PendingMessage *oldest = nullptr;
+	for (auto msg = pending.exchange(nullptr, std::memory_order_acquire); msg; ) {
+		auto next = msg->next;
+		msg->next = oldest;
+		oldest = msg;
+		msg = next;
+	}
+
+	while (oldest) {
+		std::unique_ptr<PendingMessage> msg(oldest);
+		oldest = msg->next;
+
+		for (auto& em : emitters) em->log(msg->sm);
+
 		if (messages.size() < 250)
-			messages.push_back(sm);
+			messages.push_back(std::move(msg->sm));
 		else {
-			messages[next_idx] = sm;
+			messages[next_idx] = std::move(msg->sm);
 			if (++next_idx == 250)
 				next_idx = 0;
 		}
-		for (auto& em : emitters) em->log(sm);
-	});
+	}
 }
 
 void LogSink::Subscribe(std::unique_ptr<Emitter> em) {
@@ -95,7 +129,7 @@ Message::Message(const char *section, Severity severity, const char *file, const
 
 Message::~Message() {
 	sm.message = std::string(buffer, (std::string::size_type)msg.tellp());
-	agi::log::log->Log(sm);
+	agi::log::log->Log(std::move(sm));
 }
 
 JsonEmitter::JsonEmitter(fs::path const& directory)
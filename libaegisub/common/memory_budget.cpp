@@ -0,0 +1,139 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/memory_budget.h"
+
+#include "libaegisub/log.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace agi {
+MemoryBudget::Registration::Registration(Registration&& other)
+: budget(other.budget)
+, id(other.id)
+{
+	other.budget = nullptr;
+}
+
+MemoryBudget::Registration& MemoryBudget::Registration::operator=(Registration&& other) {
+	if (this != &other) {
+		Release();
+		budget = other.budget;
+		id = other.id;
+		other.budget = nullptr;
+	}
+	return *this;
+}
+
+MemoryBudget::Registration::~Registration() {
+	Release();
+}
+
+void MemoryBudget::Registration::Release() {
+	if (budget)
+		budget->Unregister(id);
+	budget = nullptr;
+}
+
+MemoryBudget::Registration MemoryBudget::Register(std::string name, double weight, int priority, SizeFunc size, EvictFunc evict) {
+	std::lock_guard<std::mutex> l(lock);
+	caches.push_back(Cache{next_id, std::move(name), std::max(weight, 0.0), priority, std::move(size), std::move(evict), SIZE_MAX});
+	return Registration(this, next_id++);
+}
+
+void MemoryBudget::Unregister(size_t id) {
+	std::lock_guard<std::mutex> l(lock);
+	caches.erase(remove_if(begin(caches), end(caches), [=](Cache const& c) { return c.id == id; }), end(caches));
+}
+
+void MemoryBudget::SetLimit(size_t bytes) {
+	std::lock_guard<std::mutex> l(lock);
+	limit = bytes;
+}
+
+void MemoryBudget::Rebalance() {
+	std::lock_guard<std::mutex> l(lock);
+
+	std::vector<size_t> sizes;
+	sizes.reserve(caches.size());
+	size_t fixed = 0, total = 0;
+	double weights = 0;
+	for (auto const& cache : caches) {
+		sizes.push_back(cache.size());
+		if (cache.evict) {
+			total += sizes.back();
+			weights += cache.weight;
+		}
+		else
+			fixed += sizes.back();
+	}
+
+	auto share = [&](size_t bytes, Cache const& cache) -> size_t {
+		return weights > 0 ? size_t(bytes * (cache.weight / weights)) : 0;
+	};
+
+	std::vector<size_t> allowances(caches.size(), SIZE_MAX);
+	size_t room = limit > fixed ? limit - fixed : 0;
+	if (limit != 0 && total <= room) {
+		// Let every cache grow into its share of what's left over
+		for (size_t i = 0; i < caches.size(); ++i)
+			allowances[i] = sizes[i] + share(room - total, caches[i]);
+	}
+	else if (limit != 0) {
+		// Shrink the lowest priority caches which are over their share of
+		// the limit until the total fits, taking the furthest over first
+		std::vector<size_t> order;
+		for (size_t i = 0; i < caches.size(); ++i) {
+			allowances[i] = sizes[i];
+			if (caches[i].evict) order.push_back(i);
+		}
+
+		auto over = [&](size_t i) -> size_t {
+			size_t fair = share(room, caches[i]);
+			return sizes[i] > fair ? sizes[i] - fair : 0;
+		};
+		sort(begin(order), end(order), [&](size_t a, size_t b) {
+			if (caches[a].priority != caches[b].priority)
+				return caches[a].priority < caches[b].priority;
+			return over(a) > over(b);
+		});
+
+		size_t excess = total - room;
+		for (size_t i : order) {
+			if (excess == 0) break;
+			size_t cut = std::min(excess, over(i));
+			allowances[i] -= cut;
+			excess -= cut;
+		}
+	}
+
+	for (size_t i = 0; i < caches.size(); ++i) {
+		auto& cache = caches[i];
+		if (!cache.evict) continue;
+		if (allowances[i] < sizes[i] && allowances[i] != cache.allowance)
+			LOG_D("memory_budget") << "shrinking " << cache.name << " from " << sizes[i] << " to " << allowances[i] << " bytes";
+		cache.allowance = allowances[i];
+		cache.evict(allowances[i]);
+	}
+}
+
+MemoryBudget& GlobalMemoryBudget() {
+	static MemoryBudget budget;
+	return budget;
+}
+}
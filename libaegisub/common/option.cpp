@@ -21,8 +21,8 @@
 #include "libaegisub/cajun/reader.h"
 #include "libaegisub/cajun/writer.h"
 #include "libaegisub/cajun/elements.h"
-#include "libaegisub/cajun/visitor.h"
 
+#include "libaegisub/dispatch.h"
 #include "libaegisub/exception.h"
 #include "libaegisub/fs.h"
 #include "libaegisub/io.h"
@@ -33,6 +33,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <cassert>
+#include <cstring>
 #include <memory>
 
 namespace {
@@ -40,16 +41,44 @@ using namespace agi;
 
 DEFINE_EXCEPTION(OptionJsonValueError, Exception);
 
-class ConfigVisitor final : public json::ConstVisitor {
+/// Builds option values directly from the contents of a config document
+class ConfigReader final : public json::Reader::Handler {
 	std::vector<std::unique_ptr<OptionValue>> values;
 
 	/// Option name prefix to add to read names
 	std::string name;
 
+	/// Length of the name of each object currently open, for restoring the
+	/// prefix when it's closed
+	std::vector<size_t> object_names;
+
 	/// Log errors rather than throwing them, for when loading user config files
 	/// (as a bad user config file shouldn't make the program fail to start)
 	bool ignore_errors;
 
+	/// Array currently being read. Arrays are lists of single-member objects
+	/// whose member name gives the type of the values, which are collected
+	/// until the end of the array so that a malformed array can be skipped as
+	/// a whole
+	struct {
+		bool open = false;
+		/// Nesting depth within the array; 1 is directly inside it and 2 is
+		/// inside one of its member objects
+		int depth = 0;
+		/// Members seen in the current member object
+		int members = 0;
+		std::string type;
+		/// Type of the values in arrays of the current type, or null if the
+		/// type isn't one which can be read
+		const char *value_type = nullptr;
+		const char *error = nullptr;
+
+		std::vector<std::string> strings;
+		std::vector<int64_t> ints;
+		std::vector<double> doubles;
+		std::vector<bool> bools;
+	} array;
+
 	void Error(const char *message) {
 		if (ignore_errors)
 			LOG_E("option/load/config_visitor") << "Error loading option from user configuration: " << message;
@@ -57,64 +86,147 @@ class ConfigVisitor final : public json::ConstVisitor {
 			throw OptionJsonValueError(message);
 	}
 
-	template<class OptionValueType>
-	void ReadArray(json::Array const& src, std::string const& array_type) {
+	void ArrayError(const char *message) {
+		if (!array.error)
+			array.error = message;
+	}
+
+	/// Check that a value in an array is the sole member of a member object
+	/// and is of the array's type
+	bool ArrayValue(const char *type) {
+		if (array.depth != 2)
+			ArrayError("Invalid array member");
+		else if (array.value_type && strcmp(array.value_type, type))
+			ArrayError("Attempt to insert value into array of wrong type");
+		return !array.error && array.value_type;
+	}
+
+	static const char *ValueType(std::string const& array_type) {
+		if (array_type == "string" || array_type == "color") return "string";
+		if (array_type == "int") return "int";
+		if (array_type == "double") return "double";
+		if (array_type == "bool") return "bool";
+		return nullptr;
+	}
+
+	template<class OptionValueType, class Source>
+	void ReadArray(Source& src) {
 		typename OptionValueType::value_type arr;
 		arr.reserve(src.size());
-		for (json::Object const& obj : src)
-			arr.push_back((typename OptionValueType::value_type::value_type)(obj.begin()->second));
-
+		for (auto&& value : src)
+			arr.emplace_back(std::move(value));
 		values.push_back(agi::make_unique<OptionValueType>(name, std::move(arr)));
 	}
 
-	void Visit(const json::Object& object) {
-		auto old_name = name;
-		for (auto const& obj : object) {
-			name = old_name + (old_name.empty() ? "" : "/") + obj.first;
-			obj.second.Accept(*this);
+	void EndArray() {
+		array.open = false;
+		if (array.error)
+			return Error(array.error);
+
+		if (array.type == "string")
+			ReadArray<OptionValueListString>(array.strings);
+		else if (array.type == "int")
+			ReadArray<OptionValueListInt>(array.ints);
+		else if (array.type == "double")
+			ReadArray<OptionValueListDouble>(array.doubles);
+		else if (array.type == "bool")
+			ReadArray<OptionValueListBool>(array.bools);
+		else if (array.type == "color")
+			ReadArray<OptionValueListColor>(array.strings);
+		else if (array.type.empty())
+			Error("Cannot infer the type of an empty array");
+		else
+			Error("Array type not handled");
+	}
+
+public:
+	ConfigReader(bool ignore_errors) : ignore_errors(ignore_errors) { }
+	std::vector<std::unique_ptr<OptionValue>> Values() { return std::move(values); }
+
+	void ObjectBegin() override {
+		if (array.open) {
+			if (++array.depth != 2)
+				ArrayError("Invalid array member");
+			else
+				array.members = 0;
+			return;
 		}
-		name = old_name;
+		object_names.push_back(name.size());
 	}
 
-	void Visit(const json::Array& array) {
-		if (array.empty())
-			return Error("Cannot infer the type of an empty array");
+	void Member(std::string const& member) override {
+		if (array.open) {
+			if (array.depth != 2)
+				return;
+			if (++array.members != 1)
+				ArrayError("Invalid array member");
+			else if (array.type.empty()) {
+				array.type = member;
+				array.value_type = ValueType(member);
+			}
+			else if (member != array.type)
+				ArrayError("Attempt to insert value into array of wrong type");
+			return;
+		}
 
-		json::Object const& front = array.front();
-		if (front.size() != 1)
-			return Error("Invalid array member");
+		name.resize(object_names.back());
+		if (!name.empty())
+			name += '/';
+		name += member;
+	}
 
-		auto const& array_type = front.begin()->first;
-		for (json::Object const& obj : array) {
-			if (obj.size() != 1)
-				return Error("Invalid array member");
-			if (obj.begin()->first != array_type)
-				return Error("Attempt to insert value into array of wrong type");
+	void ObjectEnd() override {
+		if (array.open) {
+			if (array.depth-- == 2 && array.members == 0)
+				ArrayError("Invalid array member");
+			return;
 		}
+		name.resize(object_names.back());
+		object_names.pop_back();
+	}
 
-		if (array_type == "string")
-			ReadArray<OptionValueListString>(array, array_type);
-		else if (array_type == "int")
-			ReadArray<OptionValueListInt>(array, array_type);
-		else if (array_type == "double")
-			ReadArray<OptionValueListDouble>(array, array_type);
-		else if (array_type == "bool")
-			ReadArray<OptionValueListBool>(array, array_type);
-		else if (array_type == "color")
-			ReadArray<OptionValueListColor>(array, array_type);
-		else
-			Error("Array type not handled");
+	void ArrayBegin() override {
+		if (array.open) {
+			++array.depth;
+			return ArrayError("Invalid array member");
+		}
+		array.open = true;
+		array.depth = 1;
+		array.type.clear();
+		array.value_type = nullptr;
+		array.error = nullptr;
+		array.strings.clear();
+		array.ints.clear();
+		array.doubles.clear();
+		array.bools.clear();
 	}
 
-	void Visit(int64_t number) {
-		values.push_back(agi::make_unique<OptionValueInt>(name, number));
+	void ArrayEnd() override {
+		if (--array.depth == 0)
+			EndArray();
 	}
 
-	void Visit(double number) {
-		values.push_back(agi::make_unique<OptionValueDouble>(name, number));
+	void Value(int64_t number) override {
+		if (!array.open)
+			values.push_back(agi::make_unique<OptionValueInt>(name, number));
+		else if (ArrayValue("int"))
+			array.ints.push_back(number);
 	}
 
-	void Visit(const json::String& string) {
+	void Value(double number) override {
+		if (!array.open)
+			values.push_back(agi::make_unique<OptionValueDouble>(name, number));
+		else if (ArrayValue("double"))
+			array.doubles.push_back(number);
+	}
+
+	void Value(json::String&& string) override {
+		if (array.open) {
+			if (ArrayValue("string"))
+				array.strings.push_back(std::move(string));
+			return;
+		}
+
 		size_t size = string.size();
 		if ((size == 4 && string[0] == '#') ||
 			(size == 7 && string[0] == '#') ||
@@ -123,21 +235,23 @@ class ConfigVisitor final : public json::ConstVisitor {
 		{
 			values.push_back(agi::make_unique<OptionValueColor>(name, string));
 		} else {
-			values.push_back(agi::make_unique<OptionValueString>(name, string));
+			values.push_back(agi::make_unique<OptionValueString>(name, std::move(string)));
 		}
 	}
 
-	void Visit(bool boolean) {
-		values.push_back(agi::make_unique<OptionValueBool>(name, boolean));
+	void Value(bool boolean) override {
+		if (!array.open)
+			values.push_back(agi::make_unique<OptionValueBool>(name, boolean));
+		else if (ArrayValue("bool"))
+			array.bools.push_back(boolean);
 	}
 
-	void Visit(const json::Null& null) {
-		Error("Attempt to read null value");
+	void Value(json::Null) override {
+		if (array.open)
+			ArrayError("Attempt to read null value");
+		else
+			Error("Attempt to read null value");
 	}
-
-public:
-	ConfigVisitor(bool ignore_errors) : ignore_errors(ignore_errors) { }
-	std::vector<std::unique_ptr<OptionValue>> Values() { return std::move(values); }
 };
 
 /// @brief Write an option to a json object
@@ -164,6 +278,14 @@ void put_array(json::Object &obj, const std::string &path, const char *element_k
 	put_option(obj, path, std::move(array));
 }
 
+size_t hash_name(const char *name) {
+	// FNV-1a
+	size_t hash = 2166136261u;
+	for (; *name; ++name)
+		hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619u;
+	return hash;
+}
+
 struct option_name_cmp {
 	bool operator()(std::unique_ptr<OptionValue> const& a, std::unique_ptr<OptionValue> const& b) const {
 		return a->GetName() < b->GetName();
@@ -185,6 +307,7 @@ namespace agi {
 Options::Options(agi::fs::path const& file, std::pair<const char *, size_t> default_config, const OptionSetting setting)
 : config_file(file)
 , setting(setting)
+, flush_queue(dispatch::Create(dispatch::Priority::Background))
 {
 	LOG_D("agi/options") << "New Options object";
 	boost::interprocess::ibufferstream stream(default_config.first, default_config.second);
@@ -194,6 +317,7 @@ Options::Options(agi::fs::path const& file, std::pair<const char *, size_t> defa
 Options::~Options() {
 	if ((setting & FLUSH_SKIP) != FLUSH_SKIP)
 		Flush();
+	WaitForFlush();
 }
 
 void Options::ConfigUser() {
@@ -206,10 +330,10 @@ void Options::ConfigUser() {
 }
 
 void Options::LoadConfig(std::istream& stream, bool ignore_errors) {
-	json::UnknownElement config_root;
+	ConfigReader config_reader(ignore_errors);
 
 	try {
-		json::Reader::Read(config_root, stream);
+		json::Reader::Read(config_reader, stream);
 	} catch (json::Reader::ParseException& e) {
 		LOG_E("option/load") << "json::ParseException: " << e.what() << ", Line/offset: " << e.m_locTokenBegin.m_nLine + 1 << '/' << e.m_locTokenBegin.m_nLineOffset + 1;
 		return;
@@ -218,16 +342,14 @@ void Options::LoadConfig(std::istream& stream, bool ignore_errors) {
 		return;
 	}
 
-	ConfigVisitor config_visitor(ignore_errors);
-	config_root.Accept(config_visitor);
-
-	auto new_values = config_visitor.Values();
+	auto new_values = config_reader.Values();
 	if (new_values.empty()) return;
 
 	sort(begin(new_values), end(new_values), option_name_cmp());
 
 	if (values.empty()) {
 		values = std::move(new_values);
+		BuildIndex();
 		return;
 	}
 
@@ -256,12 +378,25 @@ void Options::LoadConfig(std::istream& stream, bool ignore_errors) {
 			++dst_it;
 		}
 	}
+	BuildIndex();
+}
+
+void Options::BuildIndex() {
+	index.clear();
+	index.reserve(values.size());
+	for (auto const& value : values)
+		index.emplace_back(hash_name(value->GetName().c_str()), value.get());
+	sort(begin(index), end(index));
 }
 
 OptionValue *Options::Get(const char *name) {
-	auto index = lower_bound(begin(values), end(values), name, option_name_cmp());
-	if (index != end(values) && (*index)->GetName() == name)
-		return index->get();
+	size_t hash = hash_name(name);
+	auto it = lower_bound(begin(index), end(index), hash,
+		[](std::pair<size_t, OptionValue *> const& a, size_t b) { return a.first < b; });
+	for (; it != end(index) && it->first == hash; ++it) {
+		if (it->second->GetName() == name)
+			return it->second;
+	}
 
 	LOG_E("option/get") << "agi::Options::Get Option not found: (" << name << ")";
 	throw agi::InternalError("Option value not found: " + std::string(name));
@@ -314,7 +449,22 @@ void Options::Flush() const {
 		}
 	}
 
-	agi::JsonWriter::Write(obj_out, io::Save(config_file).Get());
+	// Serializing and writing the file is the slow part, so only copying the
+	// values out is done on the calling thread
+	auto obj = std::make_shared<json::Object>(std::move(obj_out));
+	auto file = config_file;
+	flush_queue->Async([=] {
+		try {
+			agi::JsonWriter::Write(*obj, io::Save(file).Get());
+		}
+		catch (agi::Exception const& e) {
+			LOG_E("option/flush") << "Error writing " << file << ": " << e.GetMessage();
+		}
+	});
+}
+
+void Options::WaitForFlush() const {
+	flush_queue->Sync([]{});
 }
 
 } // namespace agi
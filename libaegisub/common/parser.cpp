@@ -25,6 +25,7 @@
 #include <boost/spirit/include/phoenix_fusion.hpp>
 #include <boost/fusion/include/adapt_struct.hpp>
 #include <boost/spirit/include/lex_lexertl.hpp>
+#include <cstring>
 
 // We have to use the copy of pheonix within spirit if it exists, as the
 // standalone copy has different header guards
@@ -227,6 +228,31 @@ namespace ass {
 
 		return data;
 	}
+
+	bool NextDrawingToken(const char *&pos, const char *end, DrawingToken &token) {
+		while (pos != end) {
+			while (pos != end && *pos == ' ') ++pos;
+			const char *token_end = static_cast<const char *>(memchr(pos, ' ', end - pos));
+			if (!token_end) token_end = end;
+			if (pos == token_end) return false;
+
+			const char *start = pos;
+			pos = token_end;
+
+			double value;
+			const char *num_end = start;
+			if (boost::spirit::qi::parse(num_end, token_end, boost::spirit::qi::double_, value) && num_end == token_end) {
+				token.command = 0;
+				token.value = value;
+				return true;
+			}
+			if (token_end - start == 1) {
+				token.command = *start;
+				return true;
+			}
+		}
+		return false;
+	}
 }
 
 namespace util {
@@ -0,0 +1,102 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/perf.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+using namespace agi::perf;
+
+std::mutex registry_lock;
+
+template<typename T>
+std::map<std::string, std::unique_ptr<T>>& registry() {
+	static std::map<std::string, std::unique_ptr<T>> metrics;
+	return metrics;
+}
+
+template<typename T>
+T& get(std::string const& name) {
+	std::lock_guard<std::mutex> lock(registry_lock);
+	auto& metric = registry<T>()[name];
+	if (!metric)
+		metric.reset(new T);
+	return *metric;
+}
+}
+
+namespace agi { namespace perf {
+Histogram::Histogram() {
+	for (auto& bucket : buckets)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::Record(int64_t value) {
+	size_t bucket = 0;
+	for (uint64_t v = value > 0 ? value : 0; v && bucket + 1 < bucket_count; v >>= 1)
+		++bucket;
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t Histogram::Percentile(double fraction) const {
+	int64_t counts[bucket_count];
+	int64_t total = 0;
+	for (size_t i = 0; i < bucket_count; ++i)
+		total += counts[i] = buckets[i].load(std::memory_order_relaxed);
+	if (total == 0) return 0;
+
+	int64_t target = std::max<int64_t>(1, static_cast<int64_t>(total * fraction + 0.5));
+	int64_t seen = 0;
+	for (size_t i = 0; i < bucket_count; ++i) {
+		seen += counts[i];
+		if (seen >= target)
+			return i == 0 ? 0 : (int64_t(1) << i) - 1;
+	}
+	return (int64_t(1) << (bucket_count - 1)) - 1;
+}
+
+Counter& GetCounter(std::string const& name) { return get<Counter>(name); }
+Gauge& GetGauge(std::string const& name) { return get<Gauge>(name); }
+Histogram& GetHistogram(std::string const& name) { return get<Histogram>(name); }
+
+std::vector<Sample> Snapshot() {
+	std::vector<Sample> samples;
+	{
+		std::lock_guard<std::mutex> lock(registry_lock);
+		for (auto const& counter : registry<Counter>())
+			samples.push_back(Sample{counter.first, Sample::Type::Counter, counter.second->Get(), 0, 0, 0, 0});
+		for (auto const& gauge : registry<Gauge>())
+			samples.push_back(Sample{gauge.first, Sample::Type::Gauge, gauge.second->Get(), 0, 0, 0, 0});
+		for (auto const& histogram : registry<Histogram>()) {
+			auto const& h = *histogram.second;
+			samples.push_back(Sample{histogram.first, Sample::Type::Histogram, h.Count(), h.Sum(),
+				h.Percentile(.5), h.Percentile(.9), h.Percentile(.99)});
+		}
+	}
+
+	std::sort(begin(samples), end(samples), [](Sample const& a, Sample const& b) {
+		return a.name < b.name;
+	});
+	return samples;
+}
+} }
@@ -20,47 +20,178 @@
 
 #include "libaegisub/charset_conv.h"
 #include "libaegisub/file_mapping.h"
+#include "libaegisub/fs.h"
+#include "libaegisub/io.h"
 #include "libaegisub/line_iterator.h"
 #include "libaegisub/make_unique.h"
 #include "libaegisub/split.h"
 
+#include <algorithm>
+#include <boost/container/flat_map.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <cstring>
+
+namespace {
+/// Header of the binary index, which is followed by the entries sorted by
+/// word and then a pool of the UTF-8 words and the data file's encoding
+struct index_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	/// Size and modification time of the idx file the index was built from
+	uint64_t idx_size;
+	int64_t idx_modified;
+	uint32_t encoding_offset;
+	uint32_t encoding_length;
+};
+
+const char index_magic[8] = {'A', 'G', 'I', 'T', 'H', 'I', 'D', 'X'};
+const uint32_t index_version = 1;
+}
 
 namespace agi {
 
 Thesaurus::Thesaurus(agi::fs::path const& dat_path, agi::fs::path const& idx_path)
 : dat(make_unique<read_file_mapping>(dat_path))
 {
-	read_file_mapping idx_file(idx_path);
-	boost::interprocess::ibufferstream idx(idx_file.read(), static_cast<size_t>(idx_file.size()));
+	BuildIndex(idx_path);
+}
+
+Thesaurus::Thesaurus(agi::fs::path const& dat_path, agi::fs::path const& idx_path, agi::fs::path const& cache_path)
+: dat(make_unique<read_file_mapping>(dat_path))
+{
+	if (LoadIndex(cache_path, idx_path)) return;
+
+	BuildIndex(idx_path);
+	try {
+		fs::CreateDirectory(cache_path.parent_path());
+		io::Save out(cache_path, true);
+		out.Get().write(index_buffer.data(), index_buffer.size());
+	}
+	catch (fs::FileSystemError const&) {
+		// Not being able to write the cache just means rebuilding it next time
+	}
+}
+
+Thesaurus::~Thesaurus() { }
+
+bool Thesaurus::LoadIndex(agi::fs::path const& cache_path, agi::fs::path const& idx_path) {
+	try {
+		if (!fs::FileExists(cache_path)) return false;
+
+		index_file = make_unique<read_file_mapping>(cache_path);
+		if (index_file->size() >= sizeof(index_header)) {
+			auto data = index_file->read();
+			index_header header;
+			memcpy(&header, data, sizeof header);
+			if (header.idx_size == fs::Size(idx_path) &&
+				header.idx_modified == static_cast<int64_t>(fs::ModifiedTime(idx_path)) &&
+				UseIndex(data, index_file->size()))
+				return true;
+		}
+	}
+	catch (fs::FileSystemError const&) {
+	}
+
+	index_file.reset();
+	return false;
+}
 
+void Thesaurus::BuildIndex(agi::fs::path const& idx_path) {
+	boost::container::flat_map<std::string, size_t> offsets;
 	std::string encoding_name;
-	getline(idx, encoding_name);
-	std::string unused_entry_count;
-	getline(idx, unused_entry_count);
 
-	conv = make_unique<charset::IconvWrapper>(encoding_name.c_str(), "utf-8");
+	{
+		read_file_mapping idx_file(idx_path);
+		boost::interprocess::ibufferstream idx(idx_file.read(), static_cast<size_t>(idx_file.size()));
 
-	// Read the list of words and file offsets for those words
-	for (auto const& line : line_iterator<std::string>(idx, encoding_name)) {
-		auto pos = line.find('|');
-		if (pos != line.npos && line.find('|', pos + 1) == line.npos)
-			offsets[line.substr(0, pos)] = static_cast<size_t>(atoi(line.c_str() + pos + 1));
+		getline(idx, encoding_name);
+		std::string unused_entry_count;
+		getline(idx, unused_entry_count);
+
+		// Read the list of words and file offsets for those words
+		for (auto const& line : line_iterator<std::string>(idx, encoding_name)) {
+			auto pos = line.find('|');
+			if (pos != line.npos && line.find('|', pos + 1) == line.npos)
+				offsets[line.substr(0, pos)] = static_cast<size_t>(atoi(line.c_str() + pos + 1));
+		}
 	}
+
+	size_t pool_start = sizeof(index_header) + offsets.size() * sizeof(IndexEntry);
+	size_t size = pool_start + encoding_name.size();
+	for (auto const& offset : offsets)
+		size += offset.first.size();
+	index_buffer.resize(size);
+
+	index_header header{};
+	memcpy(header.magic, index_magic, sizeof index_magic);
+	header.version = index_version;
+	header.count = static_cast<uint32_t>(offsets.size());
+	header.idx_size = fs::Size(idx_path);
+	header.idx_modified = static_cast<int64_t>(fs::ModifiedTime(idx_path));
+	header.encoding_offset = static_cast<uint32_t>(pool_start);
+	header.encoding_length = static_cast<uint32_t>(encoding_name.size());
+	memcpy(&index_buffer[0], &header, sizeof header);
+
+	char *entry_out = &index_buffer[sizeof header];
+	char *pool_out = &index_buffer[pool_start];
+	memcpy(pool_out, encoding_name.data(), encoding_name.size());
+	pool_out += encoding_name.size();
+
+	for (auto const& offset : offsets) {
+		IndexEntry entry;
+		entry.word_offset = static_cast<uint32_t>(pool_out - &index_buffer[0]);
+		entry.word_length = static_cast<uint32_t>(offset.first.size());
+		entry.dat_offset = offset.second;
+		memcpy(entry_out, &entry, sizeof entry);
+		entry_out += sizeof entry;
+
+		memcpy(pool_out, offset.first.data(), offset.first.size());
+		pool_out += offset.first.size();
+	}
+
+	UseIndex(index_buffer.data(), index_buffer.size());
 }
 
-Thesaurus::~Thesaurus() { }
+bool Thesaurus::UseIndex(const char *data, uint64_t size) {
+	index_header header;
+	memcpy(&header, data, sizeof header);
+	if (memcmp(header.magic, index_magic, sizeof index_magic) || header.version != index_version)
+		return false;
+	if ((size - sizeof header) / sizeof(IndexEntry) < header.count)
+		return false;
+	if (header.encoding_offset > size || header.encoding_length > size - header.encoding_offset)
+		return false;
+
+	conv = make_unique<charset::IconvWrapper>(std::string(data + header.encoding_offset, header.encoding_length).c_str(), "utf-8");
+	index = data;
+	index_size = size;
+	entries = reinterpret_cast<const IndexEntry *>(data + sizeof header);
+	entry_count = header.count;
+	return true;
+}
 
 std::vector<Thesaurus::Entry> Thesaurus::Lookup(std::string const& word) {
 	std::vector<Entry> out;
 	if (!dat) return out;
 
-	auto it = offsets.find(word);
-	if (it == offsets.end()) return out;
-	if (it->second >= dat->size()) return out;
+	// Words in a corrupt cache which point outside of it compare as empty
+	auto compare = [&](IndexEntry const& entry) {
+		size_t len = entry.word_length;
+		if (entry.word_offset > index_size || len > index_size - entry.word_offset)
+			len = 0;
+		int cmp = memcmp(index + entry.word_offset, word.data(), std::min(len, word.size()));
+		if (cmp != 0) return cmp;
+		return len < word.size() ? -1 : len > word.size() ? 1 : 0;
+	};
+
+	auto it = std::lower_bound(entries, entries + entry_count, word,
+		[&](IndexEntry const& entry, std::string const&) { return compare(entry) < 0; });
+	if (it == entries + entry_count || compare(*it) != 0) return out;
+	if (it->dat_offset >= dat->size()) return out;
 
-	auto len = dat->size() - it->second;
-	auto buff = dat->read(it->second, len);
+	auto len = dat->size() - it->dat_offset;
+	auto buff = dat->read(it->dat_offset, len);
 	auto buff_end = buff + len;
 
 	std::string temp;
@@ -0,0 +1,129 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/trace.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace {
+/// Number of events kept; older ones are overwritten
+const size_t capacity = 1 << 16;
+
+struct Event {
+	const char *name;
+	const char *category;
+	int64_t start;
+	int64_t duration;
+	int thread;
+};
+
+std::mutex lock;
+std::vector<Event> events;
+/// Index the next event is written to once the buffer is full
+size_t next = 0;
+std::map<int, std::string> thread_names;
+
+std::atomic<int> thread_count{0};
+thread_local int thread_id = 0;
+
+int ThreadId() {
+	if (!thread_id)
+		thread_id = ++thread_count;
+	return thread_id;
+}
+
+void WriteString(std::ostream& out, const char *str) {
+	out << '"';
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\')
+			out << '\\';
+		if ((unsigned char)*str >= 0x20)
+			out << *str;
+	}
+	out << '"';
+}
+}
+
+namespace agi { namespace trace {
+namespace detail {
+std::atomic<bool> enabled{false};
+
+int64_t Now() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Record(const char *name, const char *category, int64_t start) {
+	Event event{name, category, start, Now() - start, ThreadId()};
+	std::lock_guard<std::mutex> l(lock);
+	if (events.size() < capacity)
+		events.push_back(event);
+	else {
+		events[next] = event;
+		next = (next + 1) % capacity;
+	}
+}
+}
+
+void SetEnabled(bool enable) {
+	std::lock_guard<std::mutex> l(lock);
+	if (enable && !detail::enabled) {
+		events.clear();
+		next = 0;
+	}
+	detail::enabled = enable;
+}
+
+void NameThread(const char *name) {
+	std::lock_guard<std::mutex> l(lock);
+	thread_names[ThreadId()] = name;
+}
+
+void Write(std::ostream& out) {
+	std::lock_guard<std::mutex> l(lock);
+
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (auto const& name : thread_names) {
+		if (!first) out << ",\n";
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << name.first << ",\"args\":{\"name\":";
+		WriteString(out, name.second.c_str());
+		out << "}}";
+	}
+
+	// Oldest first, which is where the next event would go once it's full
+	for (size_t i = 0; i < events.size(); ++i) {
+		auto const& event = events[(next + i) % events.size()];
+		if (!first) out << ",\n";
+		first = false;
+		out << "{\"name\":";
+		WriteString(out, event.name);
+		out << ",\"cat\":";
+		WriteString(out, event.category);
+		out << ",\"ph\":\"X\",\"ts\":" << event.start
+			<< ",\"dur\":" << event.duration
+			<< ",\"pid\":1,\"tid\":" << event.thread << '}';
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+} }
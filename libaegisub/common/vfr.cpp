@@ -21,8 +21,10 @@
 #include "libaegisub/charset.h"
 #include "libaegisub/io.h"
 #include "libaegisub/line_iterator.h"
+#include "line_scanner.h"
 
 #include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <boost/range/algorithm.hpp>
 #include <cmath>
@@ -61,17 +63,18 @@ struct TimecodeRange {
 };
 
 /// @brief Parse a single line of a v1 timecode file
-/// @param str Line to parse
+/// @param begin Start of the line to parse
+/// @param end End of the line to parse
 /// @return The line in TimecodeRange form, or TimecodeRange() if it's a comment
-TimecodeRange v1_parse_line(std::string const& str) {
-	if (str.empty() || str[0] == '#') return TimecodeRange();
+TimecodeRange v1_parse_line(const char *begin, const char *end) {
+	if (begin == end || *begin == '#') return TimecodeRange();
 
-	boost::interprocess::ibufferstream ss(str.data(), str.size());
+	boost::interprocess::ibufferstream ss(begin, end - begin);
 	TimecodeRange range;
 	char comma1 = 0, comma2 = 0;
 	ss >> range.start >> comma1 >> range.end >> comma2 >> range.fps;
 	if (ss.fail() || comma1 != ',' || comma2 != ',' || !ss.eof())
-		throw MalformedLine(str);
+		throw MalformedLine(std::string(begin, end));
 	if (range.start < 0 || range.end < 0)
 		throw InvalidFramerate("Cannot specify frame rate for negative frames.");
 	if (range.end < range.start)
@@ -85,24 +88,17 @@ TimecodeRange v1_parse_line(std::string const& str) {
 	return range;
 }
 
-/// @brief Parse a v1 timecode file
-/// @param      file      Iterator of lines in the file
+/// @brief Build the frame times for a v1 timecode file
 /// @param      line      Header of file with assumed fps
+/// @param      ranges    Override ranges in the file
 /// @param[out] timecodes Vector filled with frame start times
 /// @param[out] last      Unrounded time of the last frame
 /// @return Assumed fps times one million
-int64_t v1_parse(line_iterator<std::string> file, std::string line, std::vector<int> &timecodes, int64_t &last) {
-	double fps = atof(line.substr(7).c_str());
+int64_t v1_parse(std::string const& line, std::vector<TimecodeRange> ranges, std::vector<int> &timecodes, int64_t &last) {
+	double fps = line.size() > 7 ? atof(line.c_str() + 7) : 0.;
 	if (fps <= 0.) throw InvalidFramerate("Assumed FPS must be greater than zero");
 	if (fps > 1000.) throw InvalidFramerate("Assumed FPS must not be greater than 1000");
 
-	std::vector<TimecodeRange> ranges;
-	for (auto const& line : file) {
-		auto range = v1_parse_line(line);
-		if (range.fps != 0)
-			ranges.push_back(range);
-	}
-
 	std::sort(begin(ranges), end(ranges));
 
 	if (!ranges.empty())
@@ -128,6 +124,56 @@ int64_t v1_parse(line_iterator<std::string> file, std::string line, std::vector<
 	last = int64_t(time * fps * default_denominator);
 	return int64_t(fps * default_denominator);
 }
+
+/// Parser for timecode files which is fed one line at a time
+///
+/// v2 files have a line per frame, so long videos give big files; lines are
+/// passed as pointers into the mapped file and parsed without copying them
+struct timecode_file_parser {
+	enum { HEADER, V1_ASSUME, V1, V2 } state = HEADER;
+	/// The "Assume fps" line of a v1 file
+	std::string assume;
+	/// Override ranges of a v1 file
+	std::vector<TimecodeRange> ranges;
+	/// Frame times of a v2 file
+	std::vector<int> timecodes;
+
+	void operator()(const char *begin, const char *end) {
+		switch (state) {
+		case HEADER:
+			// Skip a UTF-8 BOM
+			if (agi::line_scanner::starts_with(begin, end, "\xEF\xBB\xBF"))
+				begin += 3;
+			if (end - begin == 20 && agi::line_scanner::starts_with(begin, end, "# timecode format v2"))
+				state = V2;
+			else if (end - begin == 20 && agi::line_scanner::starts_with(begin, end, "# timecode format v1"))
+				state = V1_ASSUME;
+			else if (agi::line_scanner::starts_with(begin, end, "Assume ")) {
+				assume.assign(begin, end);
+				state = V1;
+			}
+			else
+				throw UnknownFormat(std::string(begin, end));
+			break;
+		case V1_ASSUME:
+			assume.assign(begin, end);
+			state = V1;
+			break;
+		case V1: {
+			auto range = v1_parse_line(begin, end);
+			if (range.fps != 0)
+				ranges.push_back(range);
+			break;
+		}
+		case V2: {
+			int time;
+			if (agi::line_scanner::parse_int(begin, end, time))
+				timecodes.push_back(time);
+			break;
+		}
+		}
+	}
+};
 }
 
 namespace agi { namespace vfr {
@@ -174,22 +220,31 @@ Framerate::Framerate(std::initializer_list<int> timecodes)
 Framerate::Framerate(fs::path const& filename)
 : denominator(default_denominator)
 {
-	auto file = agi::io::Open(filename);
+	timecode_file_parser parser;
+
 	auto encoding = agi::charset::Detect(filename);
-	auto line = *line_iterator<std::string>(*file, encoding);
-	if (line == "# timecode format v2") {
-		copy(line_iterator<int>(*file, encoding), line_iterator<int>(), back_inserter(timecodes));
-		SetFromTimecodes();
-		return;
+	if (boost::istarts_with(encoding, "utf-16") || boost::istarts_with(encoding, "utf-32")) {
+		// Not ASCII-compatible, so the lines have to be converted first
+		auto file = agi::io::Open(filename);
+		for (auto const& line : line_iterator<std::string>(*file, encoding))
+			parser(line.data(), line.data() + line.size());
 	}
-	if (line == "# timecode format v1" || line.substr(0, 7) == "Assume ") {
-		if (line[0] == '#')
-			line = *line_iterator<std::string>(*file, encoding);
-		numerator = v1_parse(line_iterator<std::string>(*file, encoding), line, timecodes, last);
-		return;
+	else {
+		auto file = agi::open_read_mapping(filename);
+		agi::line_scanner::for_each_line(*file, std::ref(parser));
 	}
 
-	throw UnknownFormat(line);
+	switch (parser.state) {
+	case timecode_file_parser::HEADER:
+		throw UnknownFormat("");
+	case timecode_file_parser::V2:
+		timecodes = std::move(parser.timecodes);
+		SetFromTimecodes();
+		break;
+	default:
+		numerator = v1_parse(parser.assume, std::move(parser.ranges), timecodes, last);
+		break;
+	}
 }
 
 void Framerate::Save(fs::path const& filename, int length) const {
@@ -255,6 +310,79 @@ int Framerate::TimeAtFrame(int frame, Time type) const {
 	return timecodes[frame];
 }
 
+std::vector<int> Framerate::FramesAtTimes(std::vector<int> const& times, Time type) const {
+	std::vector<int> frames;
+	frames.reserve(times.size());
+
+	// Constant frame rates are a closed-form calculation with nothing to
+	// search through
+	if (!IsVFR()) {
+		for (int ms : times)
+			frames.push_back(FrameAtTime(ms, type));
+		return frames;
+	}
+
+	// Index of the frame found for the previous time. Each search gallops
+	// outwards from here, so runs of increasing times walk the timecodes
+	// once rather than doing a full binary search per time.
+	size_t cursor = 0;
+	const size_t size = timecodes.size();
+	for (int ms : times) {
+		// START and END are EXACT shifted by a ms; see FrameAtTime
+		if (type != EXACT) --ms;
+
+		int frame;
+		if (ms < 0 || ms > timecodes.back())
+			frame = FrameAtTime(ms);
+		else if (timecodes[cursor] > ms) {
+			cursor = std::upper_bound(timecodes.begin(), timecodes.begin() + cursor, ms) - timecodes.begin() - 1;
+			frame = (int)cursor;
+		}
+		else {
+			size_t step = 1;
+			while (cursor + step < size && timecodes[cursor + step] <= ms) {
+				cursor += step;
+				step *= 2;
+			}
+			auto hi = timecodes.begin() + std::min(cursor + step, size);
+			cursor = std::upper_bound(timecodes.begin() + cursor + 1, hi, ms) - timecodes.begin() - 1;
+			frame = (int)cursor;
+		}
+
+		frames.push_back(type == START ? frame + 1 : frame);
+	}
+
+	return frames;
+}
+
+std::vector<int> Framerate::TimesAtFrames(std::vector<int> const& frames, Time type) const {
+	std::vector<int> times;
+	times.reserve(frames.size());
+	if (type == EXACT) {
+		for (int frame : frames)
+			times.push_back(TimeAtFrame(frame));
+		return times;
+	}
+
+	// START and END are both halfway between the exact times of two adjacent
+	// frames, so for runs of consecutive frames the time of the second of the
+	// previous pair can be reused as the first of the next
+	bool have_prev = false;
+	int prev_frame = 0, prev_time = 0;
+	for (int frame : frames) {
+		int first = type == START ? frame - 1 : frame;
+		int first_time = have_prev && prev_frame == first ? prev_time : TimeAtFrame(first);
+		int second_time = TimeAtFrame(first + 1);
+		// + 1 as these need to round up for the case of two frames 1 ms apart
+		times.push_back(first_time + (second_time - first_time + 1) / 2);
+
+		have_prev = true;
+		prev_frame = first + 1;
+		prev_time = second_time;
+	}
+	return times;
+}
+
 void Framerate::SmpteAtFrame(int frame, int *h, int *m, int *s, int *f) const {
 	frame = std::max(frame, 0);
 	int ifps = (int)ceil(FPS());
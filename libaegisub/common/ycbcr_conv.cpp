@@ -16,6 +16,8 @@
 
 #include "libaegisub/ycbcr_conv.h"
 
+#include <cmath>
+
 namespace {
 double matrix_coefficients[][3] = {
 	{.299, .587, .114},    // BT.601
@@ -85,14 +87,58 @@ void ycbcr_converter::init_dst(ycbcr_matrix dst_mat, ycbcr_range dst_range) {
 	}
 }
 
+void ycbcr_converter::table::init(std::array<double, 9> const& m, std::array<double, 3> const& shift) {
+	const double scale = 1 << table_bits;
+	for (size_t i = 0; i < 9; ++i) {
+		for (int v = 0; v < 256; ++v)
+			entries[i][v] = static_cast<int32_t>(std::lround(m[i] * v * scale));
+	}
+	for (size_t ch = 0; ch < 3; ++ch)
+		bias[ch] = static_cast<int32_t>(std::lround((shift[ch] + .5) * scale));
+}
+
+void ycbcr_converter::init_tables() {
+	// rgb_to_rgb is from * (to * x + shift_to + shift_from), so the two
+	// matrices and the shifts can be combined into one step
+	std::array<double, 9> combined;
+	for (size_t row = 0; row < 3; ++row) {
+		for (size_t col = 0; col < 3; ++col) {
+			combined[row * 3 + col] =
+				from_ycbcr[row * 3 + 0] * to_ycbcr[0 + col] +
+				from_ycbcr[row * 3 + 1] * to_ycbcr[3 + col] +
+				from_ycbcr[row * 3 + 2] * to_ycbcr[6 + col];
+		}
+	}
+	rgb_table.init(combined, prod(from_ycbcr, add(shift_to, shift_from)));
+	ycbcr_table.init(from_ycbcr, prod(from_ycbcr, shift_from));
+}
+
 ycbcr_converter::ycbcr_converter(ycbcr_matrix mat, ycbcr_range range) {
 	init_src(mat, range);
 	init_dst(mat, range);
+	init_tables();
 }
 
 ycbcr_converter::ycbcr_converter(ycbcr_matrix src_mat, ycbcr_range src_range, ycbcr_matrix dst_mat, ycbcr_range dst_range) {
 	init_src(src_mat, src_range);
 	init_dst(dst_mat, dst_range);
+	init_tables();
+}
+
+void ycbcr_converter::rgb_to_rgb(Color *colors, size_t count) const {
+	for (size_t i = 0; i < count; ++i)
+		colors[i] = rgb_to_rgb(colors[i]);
+}
+
+void ycbcr_converter::ycbcr_to_bgra(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, size_t width) const {
+	auto const& t = ycbcr_table;
+	for (size_t x = 0; x < width; ++x) {
+		auto rgb = t.convert(y[x], cb[x / 2], cr[x / 2]);
+		dst[x * 4 + 0] = rgb[2];
+		dst[x * 4 + 1] = rgb[1];
+		dst[x * 4 + 2] = rgb[0];
+		dst[x * 4 + 3] = 0;
+	}
 }
 }
 
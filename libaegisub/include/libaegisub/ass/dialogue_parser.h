@@ -15,6 +15,7 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #undef ERROR
@@ -71,13 +72,45 @@ namespace agi {
 		/// Tokenize the passed string as the body of a dialogue line
 		std::vector<DialogueToken> TokenizeDialogueBody(std::string const& str, bool karaoke_templater=false);
 
+		/// Update the tokens of a line for an edit to it, relexing only the
+		/// part of the line which the edit could have changed
+		/// @param old_text Text which tokens were generated from
+		/// @param new_text Text after the edit
+		/// @param[in,out] tokens Result of TokenizeDialogueBody(old_text), which
+		///                       is updated to that of new_text
+		/// @return Range of bytes of new_text which were relexed
+		std::pair<size_t, size_t> RetokenizeDialogueBody(std::string const& old_text, std::string const& new_text, std::vector<DialogueToken> &tokens, bool karaoke_templater=false);
+
 		/// Convert the body of drawings to DRAWING tokens
 		void MarkDrawings(std::string const& str, std::vector<DialogueToken> &tokens);
 
+		/// A command or coordinate in the body of a drawing
+		struct DrawingToken {
+			/// Command letter, or 0 for a coordinate
+			char command;
+			/// Value of a coordinate
+			double value;
+		};
+
+		/// @brief Read the next command or coordinate of a drawing
+		/// @param[in,out] pos Position in the drawing, advanced past the token
+		/// @param end End of the drawing
+		/// @param[out] token Token read
+		/// @return Was there another token before the end?
+		///
+		/// Tokens are separated by spaces. Anything which is neither a number
+		/// nor a single character is skipped. Nothing is copied or allocated,
+		/// so this is suitable for drawings with very many points.
+		bool NextDrawingToken(const char *&pos, const char *end, DrawingToken &token);
+
 		/// Split the words in the TEXT tokens of the lexed line into their
 		/// own tokens and convert the body of drawings to DRAWING tokens
 		void SplitWords(std::string const& str, std::vector<DialogueToken> &tokens);
 
-		std::vector<DialogueToken> SyntaxHighlight(std::string const& text, std::vector<DialogueToken> const& tokens, SpellChecker *spellchecker);
+		/// Convert tokens to syntax styles
+		/// @param unchecked If not null, words whose spelling isn't known yet
+		///                  are shown as correct and appended to this rather
+		///                  than checked immediately
+		std::vector<DialogueToken> SyntaxHighlight(std::string const& text, std::vector<DialogueToken> const& tokens, SpellChecker *spellchecker, std::vector<std::string> *unchecked = nullptr);
 	}
 }
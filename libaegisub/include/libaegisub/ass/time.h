@@ -34,6 +34,9 @@ public:
 	/// Return the time as a string
 	/// @param ms Use milliseconds precision, for non-ASS formats
 	std::string GetAssFormatted(bool ms=false) const;
+	/// Append the time as GetAssFormatted would return it to out, which
+	/// doesn't allocate when out already has room
+	void AppendAssFormatted(std::string &out, bool ms=false) const;
 
 	/// Return the time as a string
 	std::string GetSrtFormatted() const;
@@ -0,0 +1,102 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/dispatch.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace agi {
+class AudioProvider;
+
+/// @class AudioDecodeSchedule
+/// @brief Tracks which chunks of a cache provider's audio have been decoded
+///        and hands out the ones to decode next
+///
+/// Each decoder works through the audio front to back from where it
+/// started, as seeking in the source can be slow. A decoder which runs into
+/// audio someone else has already done starts again on the first gap that
+/// no one is working towards, or failing that splits the largest gap with
+/// the decoder working on it, so several decoders end up splitting the
+/// audio into segments between them.
+///
+/// Asking for audio which hasn't been decoded yet moves the next decoder to
+/// finish a chunk to the start of what was asked for, so that seeking far
+/// into a long file doesn't have to wait for everything before it.
+class AudioDecodeSchedule {
+	enum : uint8_t { Pending, Decoding, Decoded };
+
+	int64_t num_samples;
+	int64_t chunk_size;
+	size_t chunk_count;
+	std::unique_ptr<std::atomic<uint8_t>[]> state;
+	/// Chunk which was last asked for, or npos
+	mutable std::atomic<size_t> requested;
+	/// Guards claiming chunks and prefix
+	std::mutex mutex;
+	/// Number of chunks from the start which have all been decoded
+	size_t prefix = 0;
+	/// Updated with the number of samples covered by prefix
+	std::atomic<int64_t> &decoded_samples;
+
+	size_t Claim(size_t chunk);
+
+public:
+	/// Returned by Next once everything has been decoded
+	static const size_t npos = static_cast<size_t>(-1);
+
+	/// Constructor
+	/// @param num_samples Length of the audio
+	/// @param chunk_size Number of samples decoded at a time
+	/// @param decoded_samples Kept up to date with the number of samples from
+	///                        the start of the audio which have all been decoded
+	AudioDecodeSchedule(int64_t num_samples, int64_t chunk_size, std::atomic<int64_t> &decoded_samples);
+
+	int64_t ChunkSize() const { return chunk_size; }
+
+	/// Has every sample in the range been decoded?
+	bool IsDecoded(int64_t start, int64_t count) const;
+
+	/// Have the next decoder to finish a chunk continue from the first chunk
+	/// of the range which hasn't been decoded, if there is one
+	void Request(int64_t start, int64_t count) const;
+
+	/// Mark the chunk a decoder just finished as decoded, and get the one it
+	/// should decode next
+	/// @param finished Chunk the decoder just finished, or npos on its first call
+	/// @return Index of the chunk to decode, or npos if there are none left
+	size_t Next(size_t finished = npos);
+
+	/// Start decoder threads which work through the schedule
+	/// @param source Provider to decode from. Threads other than the first
+	///               decode from a copy made with Reopen, and exit straight
+	///               away if it can't be copied.
+	/// @param threads Number of threads to start
+	/// @param cancel Token to stop decoding
+	/// @param decode Function which decodes a chunk from the given source
+	/// @return The threads, which must be joined before the schedule is destroyed
+	std::vector<std::thread> StartDecoders(AudioProvider const& source, int threads,
+		dispatch::CancellationToken cancel,
+		std::function<void (AudioProvider const&, size_t)> decode);
+};
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace agi {
+/// @class AudioEnergyEnvelope
+/// @brief RMS level of 16-bit mono audio at roughly 10 ms resolution
+///
+/// Filled by the cache providers as they decode, alongside the peak index,
+/// and used by the timing tools to find where speech starts and stops
+/// without reading the audio. Queries walk min/max trees over the bins, so
+/// they take logarithmic time regardless of how far they have to look.
+class AudioEnergyEnvelope {
+public:
+	/// Level of bins which haven't been decoded yet. Louder than anything
+	/// real, so undecoded audio is never taken for silence.
+	static const uint16_t unknown = 0xFFFF;
+
+private:
+	int64_t num_samples;
+	int bin_bits;
+	size_t bins;
+	/// Number of leaves in the trees; bins rounded up to a power of two
+	size_t leaves;
+
+	/// Add is called from several decoder threads at once, and they share
+	/// the upper levels of the trees
+	mutable std::mutex mutex;
+	/// Heap-ordered trees of the quietest and loudest bin under each node,
+	/// with the bins themselves as the leaves
+	std::vector<uint16_t> mins;
+	std::vector<uint16_t> maxes;
+
+	size_t First(size_t from, size_t to, uint16_t threshold, bool quiet) const;
+	size_t Last(size_t from, size_t to, uint16_t threshold, bool quiet) const;
+
+public:
+	/// Constructor
+	/// @param num_samples Length of the audio
+	/// @param sample_rate Sample rate, which picks the size of the bins
+	AudioEnergyEnvelope(int64_t num_samples, int sample_rate);
+
+	/// Number of samples in each bin; always a power of two no larger than
+	/// AudioPeakIndex::BlockSize()
+	int64_t BinSize() const { return int64_t(1) << bin_bits; }
+	/// Number of bins
+	size_t Size() const { return bins; }
+
+	/// Measure a run of decoded samples
+	/// @param samples Sample data
+	/// @param start First sample; must be a multiple of BinSize()
+	/// @param count Number of samples; must be a multiple of BinSize() unless
+	///              the run ends at the end of the audio
+	///
+	/// This has the same requirements as AudioPeakIndex::Add, so the two can
+	/// be fed the same runs.
+	void Add(const int16_t *samples, int64_t start, int64_t count);
+
+	/// Get the RMS level of the bin containing a sample, or unknown
+	uint16_t GetLevel(int64_t sample) const;
+
+	/// @brief Find the nearest boundary between quiet and loud audio
+	/// @param sample Where to search from
+	/// @param max_distance Furthest from sample to look, in samples
+	/// @param threshold Bins with a level below this are quiet
+	/// @param rising Look for the start of sound after quiet rather than the end of it
+	/// @return The sample at the boundary, or -1 if there isn't one in range
+	///
+	/// Audio which hasn't been decoded counts as loud, and boundaries next to
+	/// it are never returned.
+	int64_t FindEdge(int64_t sample, int64_t max_distance, uint16_t threshold, bool rising) const;
+
+	/// Convert a level in dBFS to a threshold for FindEdge
+	static uint16_t LevelFromDecibels(double db);
+};
+}
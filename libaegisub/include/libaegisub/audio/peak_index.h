@@ -0,0 +1,105 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace agi {
+/// Summary of a run of 16-bit samples, as needed to draw a waveform
+///
+/// Positive samples count towards max and pos_sum, everything else towards
+/// min and neg_sum, so that the two halves of the waveform can be drawn
+/// independently.
+struct AudioPeak {
+	int min = 0;
+	int max = 0;
+	int64_t neg_sum = 0;
+	int64_t pos_sum = 0;
+
+	void Add(AudioPeak const& other) {
+		if (other.min < min) min = other.min;
+		if (other.max > max) max = other.max;
+		neg_sum += other.neg_sum;
+		pos_sum += other.pos_sum;
+	}
+};
+
+/// Fold count samples into peak
+void AccumulatePeak(AudioPeak &peak, const int16_t *samples, size_t count);
+
+/// @class AudioPeakIndex
+/// @brief Multi-resolution min/max/sum pyramid over 16-bit mono audio
+///
+/// Filled by the cache providers as they decode, and used by GetPeaks to
+/// summarise long ranges of audio without touching every sample.
+class AudioPeakIndex {
+public:
+	/// Number of levels in the pyramid
+	static const size_t levels = 3;
+	/// log2 of the number of samples covered by each entry in the finest level
+	static const int base_bits = 8;
+	/// log2 of the number of entries of one level covered by an entry of the next
+	static const int level_bits = 4;
+
+	/// Number of samples covered by each entry at the given level
+	static int64_t LevelSize(size_t level) { return int64_t(1) << (base_bits + level_bits * level); }
+
+	/// Alignment required for the start of each range passed to Add
+	static int64_t BlockSize() { return LevelSize(levels - 1); }
+
+private:
+	struct Entry {
+		int16_t min;
+		int16_t max;
+		int32_t neg_sum;
+		int32_t pos_sum;
+	};
+
+	std::array<std::vector<Entry>, levels> entries;
+	int64_t num_samples;
+	/// Which blocks of BlockSize() samples have been indexed
+	std::unique_ptr<std::atomic<bool>[]> indexed;
+
+	static void Add(AudioPeak &peak, Entry const& entry);
+
+public:
+	AudioPeakIndex(int64_t num_samples);
+
+	/// Index a run of decoded samples
+	/// @param samples Sample data
+	/// @param start First sample; must be a multiple of BlockSize()
+	/// @param count Number of samples; must be a multiple of BlockSize() unless
+	///              the run ends at the end of the audio
+	///
+	/// Runs may be added in any order, but not overlap. This may be called
+	/// from a different thread than Summarize.
+	void Add(const int16_t *samples, int64_t start, int64_t count);
+
+	/// Has every sample in the range been indexed?
+	bool IsIndexed(int64_t start, int64_t count) const;
+
+	/// Summarise an indexed range of samples
+	/// @param start First sample; must be a multiple of LevelSize(0)
+	/// @param end One past the last sample; must be a multiple of LevelSize(0)
+	///            and all of the range must have been indexed
+	AudioPeak Summarize(int64_t start, int64_t end) const;
+};
+}
@@ -0,0 +1,152 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace agi {
+class AudioPlaybackStats;
+class AudioProvider;
+
+/// @class AudioRingBuffer
+/// @brief Lock-free queue of audio frames with one writer and one reader
+///
+/// The writer and reader may run on different threads without any other
+/// synchronisation, but Clear must only be called while neither is active.
+class AudioRingBuffer {
+	std::vector<char> data;
+	size_t frame_size;
+	size_t capacity;
+	/// Total number of frames ever written and read; the difference is what's
+	/// currently buffered
+	std::atomic<size_t> written{0};
+	std::atomic<size_t> read{0};
+
+public:
+	/// Constructor
+	/// @param capacity Number of frames which can be buffered
+	/// @param frame_size Bytes per frame
+	AudioRingBuffer(size_t capacity, size_t frame_size);
+
+	size_t Capacity() const { return capacity; }
+
+	/// Number of frames buffered
+	size_t Available() const { return written.load(std::memory_order_acquire) - read.load(std::memory_order_acquire); }
+
+	/// Get the contiguous free space the writer can fill next
+	/// @param[out] frames Number of frames which fit at the returned pointer
+	char *WritePointer(size_t &frames);
+
+	/// Make frames written at WritePointer visible to the reader
+	void CommitWrite(size_t frames);
+
+	/// Copy up to frames frames out of the buffer; never blocks
+	/// @return Number of frames copied
+	size_t Read(void *dest, size_t frames);
+
+	/// Discard everything buffered
+	void Clear();
+};
+
+/// @class AudioPlaybackFeed
+/// @brief Reads audio for a player ahead of time on a thread of its own
+///
+/// Decoding can stall for much longer than a sound device's buffer lasts
+/// when the audio isn't cached yet. Players copy from the feed in their
+/// realtime context instead of reading from the provider, and only run dry
+/// if the feed's whole buffer drains.
+///
+/// Start and Stop must not be called while a Read is in progress.
+class AudioPlaybackFeed {
+	AudioProvider *provider;
+	AudioPlaybackStats *stats;
+	size_t frame_size;
+	AudioRingBuffer ring;
+	/// Number of frames read from the provider at a time
+	size_t chunk_frames;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool quit = false;
+	/// Incremented whenever what's in the ring is thrown away, so that a
+	/// chunk which was being read at the time is discarded too
+	uint64_t generation = 0;
+	/// Next frame the feed thread will read from the provider
+	int64_t fill_position = 0;
+
+	/// Next frame Read will return
+	std::atomic<int64_t> read_position{0};
+	std::atomic<int64_t> start_position{0};
+	std::atomic<int64_t> end_position{0};
+	std::atomic<double> volume{1.0};
+	std::atomic<int64_t> fade_frames{0};
+
+	std::thread thread;
+
+	void FeedThread();
+
+public:
+	/// Constructor
+	/// @param provider Audio to play, which must outlive the feed
+	/// @param buffer_frames Number of frames to read ahead
+	/// @param stats If not null, records provider reads and reads from the
+	///              feed which came up short
+	AudioPlaybackFeed(AudioProvider *provider, size_t buffer_frames, AudioPlaybackStats *stats = nullptr);
+	~AudioPlaybackFeed();
+
+	/// Discard anything buffered and start reading ahead from start
+	void Start(int64_t start, int64_t end);
+	/// Discard anything buffered and stop reading ahead
+	void Stop();
+
+	/// Change where playback ends without interrupting it
+	void SetEndPosition(int64_t end);
+	int64_t GetEndPosition() const { return end_position; }
+
+	/// Volume is applied as frames are read, so changes are heard straight away
+	void SetVolume(double vol) { volume = vol; }
+
+	/// Ramp the volume up over this many frames after the start position and
+	/// down over this many before the end position, so that playing short
+	/// snippets one after another doesn't click; 0 turns this off
+	void SetFade(int64_t frames) { fade_frames = frames; }
+
+	/// Copy up to frames frames of buffered audio to dest; never blocks or
+	/// locks, so may be called from a device callback
+	/// @return Number of frames copied, which is less than asked for at the
+	///         end of playback or if the feed has fallen behind
+	size_t Read(void *dest, size_t frames);
+
+	/// Position of the next frame Read will return
+	int64_t GetReadPosition() const { return read_position; }
+	/// Has everything up to the end position been read?
+	bool AtEnd() const { return read_position >= end_position; }
+	/// Number of frames which can be read right now
+	size_t Available() const;
+
+	/// Wait until frames frames, or everything up to the end, can be read
+	/// @return Whether that happened before the timeout
+	bool WaitForPrefill(size_t frames, std::chrono::milliseconds timeout);
+};
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace agi {
+/// @class AudioPlaybackStats
+/// @brief Timing and underrun counters for an audio player
+///
+/// Everything may be updated from a player's playback thread or device
+/// callback while being read from another thread, and nothing locks.
+class AudioPlaybackStats {
+public:
+	typedef std::chrono::steady_clock clock;
+
+	/// Count, total and worst case of something which was timed
+	struct Timing {
+		int64_t count = 0;
+		std::chrono::microseconds total{0};
+		std::chrono::microseconds max{0};
+
+		std::chrono::microseconds Average() const {
+			return count ? total / count : std::chrono::microseconds{0};
+		}
+	};
+
+	/// Snapshot of all of the counters
+	struct Totals {
+		/// Time from Play being called to the first audio reaching the device
+		Timing start_latency;
+		/// Time spent in each device callback or fill of the device's buffer
+		Timing callback;
+		/// Time spent reading from the audio provider
+		Timing provider_read;
+		/// Times the device was given less audio than it needed, or reported
+		/// that it had run dry
+		int64_t underruns = 0;
+	};
+
+private:
+	struct Counter {
+		std::atomic<int64_t> count{0};
+		std::atomic<int64_t> total{0};
+		std::atomic<int64_t> max{0};
+
+		void Add(clock::duration elapsed);
+		Timing Get() const;
+	};
+
+	Counter start_latency;
+	Counter callback;
+	Counter provider_read;
+	std::atomic<int64_t> underruns{0};
+
+	/// When Play was last called, in clock ticks, or 0 if audio has been
+	/// written since
+	std::atomic<clock::rep> play_started{0};
+
+public:
+	static clock::time_point Now() { return clock::now(); }
+
+	/// Playback has been asked to start
+	void PlayStarted();
+	/// Audio has been handed to the device; only the first call after each
+	/// PlayStarted counts
+	void AudioWritten();
+
+	/// A device callback or buffer fill which began at start has finished
+	void AddCallback(clock::time_point start) { callback.Add(clock::now() - start); }
+	/// A read from the provider which began at start has finished
+	void AddProviderRead(clock::time_point start) { provider_read.Add(clock::now() - start); }
+	void AddUnderrun() { ++underruns; }
+
+	Totals Get() const;
+
+	/// One line summary of the counters for the log
+	std::string Summary() const;
+};
+}
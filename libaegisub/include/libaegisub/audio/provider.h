@@ -16,19 +16,32 @@
 
 #pragma once
 
+#include <libaegisub/audio/decode_schedule.h>
+#include <libaegisub/audio/energy_envelope.h>
+#include <libaegisub/audio/peak_index.h>
 #include <libaegisub/exception.h>
 #include <libaegisub/fs_fwd.h>
 
 #include <atomic>
+#include <functional>
 #include <vector>
 
 namespace agi {
+/// Called by AudioProvider::VisitAudio with each run of samples in turn
+/// @param samples Sample data, in the provider's format; only valid until the function returns
+/// @param count Number of samples
+///
+/// The provider may hold a lock while this runs, so it must not read from
+/// the same provider.
+typedef std::function<void (const void *samples, int64_t count)> AudioVisitor;
+
 class AudioProvider {
 protected:
 	int channels = 0;
 	/// Total number of samples per channel
 	int64_t num_samples = 0;
-	/// Samples per channel which have been decoded and can be fetched with FillBuffer
+	/// Samples per channel from the start which have all been decoded and can
+	/// be fetched with FillBuffer
 	/// Only applicable for the cache providers
 	std::atomic<int64_t> decoded_samples{0};
 	int sample_rate = 0;
@@ -39,12 +52,57 @@ protected:
 
 	void ZeroFill(void *buf, int64_t count) const;
 
+	/// Pass a range of audio to visitor, which must be entirely within the
+	/// audio. The default copies it into a buffer with FillBuffer; providers
+	/// which hold the decoded audio in memory pass pointers to it instead.
+	virtual void VisitBuffer(int64_t start, int64_t count, AudioVisitor const& visitor) const;
+
+	/// Give visitor a copy of a range of audio, in pieces
+	void VisitCopy(int64_t start, int64_t count, AudioVisitor const& visitor) const;
+
+	/// Peak index for the decoded audio, if this provider maintains one
+	virtual const AudioPeakIndex *GetPeakIndex() const { return nullptr; }
+
+	/// Decode schedule, if this provider decodes in the background and
+	/// tracks which parts have been decoded rather than just how far it got
+	virtual const AudioDecodeSchedule *GetDecodeSchedule() const { return nullptr; }
+
 public:
 	virtual ~AudioProvider() = default;
 
 	void GetAudio(void *buf, int64_t start, int64_t count) const;
 	void GetAudioWithVolume(void *buf, int64_t start, int64_t count, double volume) const;
 
+	/// @brief Read a range of audio without copying it where possible
+	///
+	/// visitor is called with consecutive runs of samples which together
+	/// cover the range, with silence outside the audio and wherever it
+	/// hasn't been decoded, just as with GetAudio. For the cache providers
+	/// these point straight at the cached audio, so this is cheaper than
+	/// GetAudio for anything which only needs to look at the samples.
+	void VisitAudio(int64_t start, int64_t count, AudioVisitor const& visitor) const;
+
+	/// Get the min/max/sum summary of a range of 16-bit mono samples
+	///
+	/// Uses the peak index when the provider has one, so the cost depends
+	/// only weakly on the length of the range.
+	AudioPeak GetPeaks(int64_t start, int64_t count) const;
+
+	/// Energy envelope of the decoded audio, if this provider maintains one
+	///
+	/// Only the cache providers do, and only for 16-bit mono audio.
+	virtual const AudioEnergyEnvelope *GetEnergyEnvelope() const { return nullptr; }
+
+	/// Has all of the audio in the range been decoded?
+	bool IsDecoded(int64_t start, int64_t count) const;
+
+	/// Ask for a range of audio to be decoded before anything else which
+	/// hasn't been decoded yet
+	///
+	/// Reading audio which hasn't been decoded does this implicitly; this is
+	/// for callers which want the audio later without reading silence now.
+	void RequestDecode(int64_t start, int64_t count) const;
+
 	int64_t GetNumSamples()     const { return num_samples; }
 	int64_t GetDecodedSamples() const { return decoded_samples; }
 	int     GetSampleRate()     const { return sample_rate; }
@@ -54,6 +112,14 @@ public:
 
 	/// Does this provider benefit from external caching?
 	virtual bool NeedsCache() const { return false; }
+
+	/// @brief Open an independent copy of this provider
+	///
+	/// Used by the cache providers to decode on several threads at once. The
+	/// copy must be usable concurrently with this provider, and this may be
+	/// called from any thread.
+	/// @return The copy, or nullptr if this provider can't be copied
+	virtual std::unique_ptr<AudioProvider> Reopen() const { return nullptr; }
 };
 
 /// Helper base class for an audio provider which wraps another provider
@@ -82,14 +148,29 @@ DEFINE_EXCEPTION(AudioDecodeError, AudioProviderError);
 DEFINE_EXCEPTION(AudioDataNotFound, AudioProviderError);
 
 class BackgroundRunner;
+class ProgressSink;
 
 std::unique_ptr<AudioProvider> CreateDummyAudioProvider(fs::path const& filename, BackgroundRunner *);
 std::unique_ptr<AudioProvider> CreatePCMAudioProvider(fs::path const& filename, BackgroundRunner *);
 
 std::unique_ptr<AudioProvider> CreateConvertAudioProvider(std::unique_ptr<AudioProvider> source_provider);
 std::unique_ptr<AudioProvider> CreateLockAudioProvider(std::unique_ptr<AudioProvider> source_provider);
-std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir);
-std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider);
-
-void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time);
+/// The RAM and HD caches decode on up to threads threads, if the source
+/// provider supports Reopen
+std::unique_ptr<AudioProvider> CreateHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& dir, int threads = 1);
+std::unique_ptr<AudioProvider> CreateCompressedHDAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& filename);
+std::unique_ptr<AudioProvider> CreateRAMAudioProvider(std::unique_ptr<AudioProvider> source_provider, int threads = 1);
+/// Uncompressed cache in filename which other processes caching the same
+/// audio to the same file map rather than decoding it again. filename
+/// should identify the audio, as a finished cache is used if its format
+/// matches.
+std::unique_ptr<AudioProvider> CreateSharedAudioProvider(std::unique_ptr<AudioProvider> source_provider, fs::path const& filename, int threads = 1);
+
+/// @brief Write part of the audio to a WAV file
+/// @param ps Progress sink to report to and check for cancellation, if any
+///
+/// The audio is read and written a chunk at a time, so this needs little
+/// memory however long the clip is. If ps is cancelled the partially
+/// written file is removed.
+void SaveAudioClip(AudioProvider const& provider, fs::path const& path, int start_time, int end_time, ProgressSink *ps = nullptr);
 }
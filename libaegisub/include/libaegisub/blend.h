@@ -0,0 +1,40 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace agi {
+/// @brief Blend a solid colour through an 8-bit coverage mask onto BGRA pixels
+/// @param dst First pixel of the destination; may be negative-strided
+/// @param dst_stride Bytes between destination rows
+/// @param mask Coverage of each pixel, 0 to 255
+/// @param mask_stride Bytes between mask rows
+/// @param width Width of the mask in pixels
+/// @param height Height of the mask in pixels
+/// @param color Blended colour as 0xRRGGBB
+/// @param opacity Opacity of the colour, 0 to 255
+///
+/// Each channel becomes (k * colour + (255 - k) * dst) / 255, with
+/// k = mask * opacity / 255, rounding down exactly as integer division does.
+/// Alpha is blended towards 255 the same way, so blending onto a fully
+/// transparent frame gives a premultiplied overlay. Runs of pixels with no
+/// coverage are skipped without touching the destination.
+void BlendMask(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *mask, ptrdiff_t mask_stride,
+               int width, int height, uint32_t color, unsigned int opacity);
+}
@@ -50,7 +50,27 @@ public:
 		Reader::Location m_locTokenEnd;
 	};
 
+	// receives the parts of a document in order as they are read, for
+	// building something other than an UnknownElement tree from it without
+	// the tree as an intermediate step. member names are checked for
+	// duplicates before being reported
+	struct Handler {
+		virtual ~Handler() = default;
+
+		virtual void ObjectBegin() = 0;
+		virtual void Member(std::string const& name) = 0;
+		virtual void ObjectEnd() = 0;
+		virtual void ArrayBegin() = 0;
+		virtual void ArrayEnd() = 0;
+		virtual void Value(Integer number) = 0;
+		virtual void Value(Double number) = 0;
+		virtual void Value(String&& string) = 0;
+		virtual void Value(Boolean boolean) = 0;
+		virtual void Value(Null null) = 0;
+	};
+
 	static void Read(UnknownElement& elementRoot, std::istream& istr);
+	static void Read(Handler& handler, std::istream& istr);
 
 private:
 	struct Token {
@@ -77,26 +97,33 @@ private:
 
 	class InputStream;
 	class TokenStream;
-	typedef std::vector<Token> Tokens;
 
-	// scanning istream into token sequence
-	void Scan(Tokens& tokens, InputStream& inputStream);
+	Reader(Handler& handler) : m_Handler(handler) { }
+
+	Handler& m_Handler;
+
+	// names of the members of each object currently being parsed, for
+	// detecting duplicates
+	std::vector<std::string> m_MemberNames;
+
+	// scanning istream into the next token. false if there are no more
+	bool Scan(Token& token, InputStream& inputStream);
 
 	void EatWhiteSpace(InputStream& inputStream);
 	void MatchString(std::string& sValue, InputStream& inputStream);
 	void MatchNumber(std::string& sNumber, InputStream& inputStream);
 	void MatchExpectedString(std::string const& sExpected, InputStream& inputStream);
 
-	// parsing token sequence into element structure
-	UnknownElement Parse(TokenStream& tokenStream);
-	UnknownElement ParseObject(TokenStream& tokenStream);
-	UnknownElement ParseArray(TokenStream& tokenStream);
-	UnknownElement ParseString(TokenStream& tokenStream);
-	UnknownElement ParseNumber(TokenStream& tokenStream);
-	UnknownElement ParseBoolean(TokenStream& tokenStream);
-	UnknownElement ParseNull(TokenStream& tokenStream);
+	// parsing token sequence into handler calls
+	void Parse(TokenStream& tokenStream);
+	void ParseObject(TokenStream& tokenStream);
+	void ParseArray(TokenStream& tokenStream);
+	void ParseString(TokenStream& tokenStream);
+	void ParseNumber(TokenStream& tokenStream);
+	void ParseBoolean(TokenStream& tokenStream);
+	void ParseNull(TokenStream& tokenStream);
 
-	std::string const& MatchExpectedToken(Token::Type nExpected, TokenStream& tokenStream);
+	std::string& MatchExpectedToken(Token::Type nExpected, TokenStream& tokenStream);
 };
 
 }
@@ -14,6 +14,8 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#pragma once
+
 #include <string>
 #include <vector>
 
@@ -27,6 +29,23 @@ struct Calltip {
 	size_t tag_position;    ///< Start index of the tag in the input line
 };
 
+/// Where each token of a line is and which tag it belongs to, so that the
+/// calltip for a cursor position can be found without walking the line
+struct CalltipIndex {
+	struct Token {
+		size_t end;      ///< Index in the text just past the end of the token
+		size_t tag_name; ///< Index of the tag name token the token follows, or 0
+		size_t arg_seps; ///< Number of argument separators up to and including the token
+	};
+	std::vector<Token> tokens;
+};
+
+/// Build the index for a tokenized line
+CalltipIndex IndexCalltips(std::vector<ass::DialogueToken> const& tokens);
+
+/// Get the calltip to show for the given cursor position in the text
+Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, CalltipIndex const& index, std::string const& text, size_t pos);
+
 /// Get the calltip to show for the given cursor position in the text
 Calltip GetCalltip(std::vector<ass::DialogueToken> const& tokens, std::string const& text, size_t pos);
 }
@@ -0,0 +1,50 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <libaegisub/dispatch.h>
+#include <libaegisub/fs_fwd.h>
+
+#include <boost/filesystem/path.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace agi { namespace fs {
+/// Get the names of the files in a directory which match filter, as
+/// DirectoryIterator would list them
+///
+/// Listings are cached and reused until the directory's modification time
+/// changes, so a directory which is listed repeatedly is only read again
+/// when files have been added to or removed from it. A missing directory
+/// has no files.
+std::vector<std::string> ListDirectory(path const& dir, std::string const& filter);
+
+/// List a directory as with ListDirectory on a background thread
+///
+/// on_files is called on the main thread with each batch of names as they
+/// are found, and on_done once all of them have been delivered. Neither is
+/// called once the token has been cancelled.
+void ListDirectoryAsync(path const& dir, std::string const& filter,
+	std::function<void (std::vector<std::string>)> on_files,
+	std::function<void ()> on_done,
+	dispatch::CancellationToken token = dispatch::CancellationToken());
+
+/// Drop all cached listings
+void ClearDirectoryListings();
+} }
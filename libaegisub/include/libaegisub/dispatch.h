@@ -14,13 +14,37 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#pragma once
+
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace agi {
 	namespace dispatch {
 		typedef std::function<void()> Thunk;
 
+		/// Priority classes for work run on the background threads. Queued
+		/// work is always started in priority order, regardless of which
+		/// queue it was submitted to.
+		enum class Priority {
+			UI,          ///< Work the UI is blocked on, such as the frame being displayed
+			Interactive, ///< Work the user asked for and is waiting on
+			Background   ///< Work nobody is waiting on, such as caching and saving
+		};
+
+		/// Flag shared by some queued work and whoever queued it, for telling
+		/// the work that its result is no longer wanted. Copies share the flag.
+		class CancellationToken {
+			std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+		public:
+			void Cancel() { *cancelled = true; }
+			bool Cancelled() const { return *cancelled; }
+		};
+
 		class Queue {
 			virtual void DoInvoke(Thunk thunk)=0;
 		public:
@@ -29,11 +53,33 @@ namespace agi {
 			/// Invoke the thunk on this processing queue, returning immediately
 			void Async(Thunk thunk);
 
+			/// Invoke the thunk on this processing queue unless the token is
+			/// cancelled before it starts, returning immediately
+			void Async(Thunk thunk, CancellationToken token);
+
 			/// Invoke the thunk on this processing queue, returning only when
 			/// it's complete
 			void Sync(Thunk thunk);
 		};
 
+		/// A serial queue where thunks can be queued under a key, which drops
+		/// any thunk queued under the same key that hasn't started yet
+		class CoalescingQueue final : public Queue {
+			std::unique_ptr<Queue> queue;
+			std::mutex lock;
+			std::unordered_map<int, CancellationToken> latest;
+
+			void DoInvoke(Thunk thunk) override;
+		public:
+			CoalescingQueue(Priority priority = Priority::Interactive);
+
+			using Queue::Async;
+
+			/// Invoke the thunk on this queue, replacing any thunk queued
+			/// with the same key which hasn't started yet
+			void Async(int key, Thunk thunk);
+		};
+
 		/// Initialize the dispatch thread pools
 		/// @param invoke_main A function which invokes the thunk on the GUI thread
 		void Init(std::function<void (Thunk)> invoke_main);
@@ -42,9 +88,41 @@ namespace agi {
 		Queue& Main();
 
 		/// Get the generic background queue, which runs thunks in parallel
-		Queue& Background();
+		Queue& Background(Priority priority = Priority::Interactive);
 
 		/// Create a new serial queue
-		std::unique_ptr<Queue> Create();
+		std::unique_ptr<Queue> Create(Priority priority = Priority::Interactive);
+
+		/// Get the size of the chunks which ParallelFor splits a range of
+		/// count items into
+		size_t ChunkSize(size_t count, size_t min_chunk);
+
+		/// Run body(chunk_begin, chunk_end) over [begin, end) in chunks of
+		/// ChunkSize(end - begin, min_chunk) items, on both the background
+		/// threads and the calling thread, returning when all have finished.
+		/// Safe to call from within background work. If any chunk throws, the
+		/// chunks not yet started are skipped and the first exception is
+		/// rethrown.
+		void ParallelFor(size_t begin, size_t end, size_t min_chunk,
+			std::function<void (size_t, size_t)> const& body,
+			Priority priority = Priority::Interactive);
+
+		/// Compute func(chunk_begin, chunk_end) for each chunk of [begin, end)
+		/// in parallel as with ParallelFor, and fold the results together in
+		/// order with combine, starting from init
+		template<typename T, typename Func, typename Combine>
+		T ParallelReduce(size_t begin, size_t end, size_t min_chunk, T init, Func func, Combine combine,
+			Priority priority = Priority::Interactive)
+		{
+			if (begin >= end) return init;
+			size_t chunk = ChunkSize(end - begin, min_chunk);
+			std::vector<std::unique_ptr<T>> results((end - begin + chunk - 1) / chunk);
+			ParallelFor(begin, end, min_chunk, [&](size_t chunk_begin, size_t chunk_end) {
+				results[(chunk_begin - begin) / chunk].reset(new T(func(chunk_begin, chunk_end)));
+			}, priority);
+			for (auto& result : results)
+				init = combine(std::move(init), std::move(*result));
+			return init;
+		}
 	}
 }
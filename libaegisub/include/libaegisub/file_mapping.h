@@ -16,8 +16,11 @@
 
 #include <libaegisub/fs_fwd.h>
 
+#include <boost/filesystem/path.hpp>
 #include <boost/interprocess/detail/os_file_functions.hpp>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace agi {
 	// boost::interprocess::file_mapping is awesome and uses CreateFileA on Windows
@@ -47,6 +50,71 @@ namespace agi {
 		const char *read(); // Map the entire file
 	};
 
+	/// @brief Share one mapping of a file between everything on this thread which reads it
+	///
+	/// While one of these exists, open_read_mapping() for the same file on
+	/// the same thread returns the same mapping rather than opening the file
+	/// again, so a file which is sniffed, charset-detected and then parsed is
+	/// only opened and read in once. The file isn't opened until something
+	/// asks for it.
+	class shared_read_mapping {
+		fs::path filename;
+		std::shared_ptr<read_file_mapping> mapping;
+		shared_read_mapping *outer;
+
+		friend std::shared_ptr<read_file_mapping> open_read_mapping(fs::path const& filename);
+
+		shared_read_mapping(shared_read_mapping const&) = delete;
+		shared_read_mapping& operator=(shared_read_mapping const&) = delete;
+	public:
+		shared_read_mapping(fs::path filename);
+		~shared_read_mapping();
+	};
+
+	/// Open a file for reading, using the mapping of a shared_read_mapping for it if there is one
+	std::shared_ptr<read_file_mapping> open_read_mapping(fs::path const& filename);
+
+	/// Read-only mapping of a file through a few fixed-size windows
+	///
+	/// Only a bounded amount of the file is mapped at once, so files far
+	/// larger than the address space can be read. Reading into the second
+	/// half of a window maps the one after it and asks the OS to start
+	/// reading it in, as most reads of big files are sequential.
+	class windowed_file_mapping {
+		struct window {
+			uint64_t start;
+			uint64_t last_used;
+			std::unique_ptr<boost::interprocess::mapped_region> region;
+		};
+
+		file_mapping file;
+		uint64_t file_size = 0;
+		uint64_t window_size;
+		size_t max_windows;
+		uint64_t use_count = 0;
+		std::vector<window> windows;
+
+		size_t get_window(uint64_t start, uint64_t length, bool prefetch);
+
+	public:
+		/// Constructor
+		/// @param window_size Bytes per window; must be a multiple of 1 MB
+		/// @param max_windows Most windows mapped at once, including the prefetched one
+		windowed_file_mapping(fs::path const& filename, uint64_t window_size = default_window_size(), size_t max_windows = 4);
+		~windowed_file_mapping();
+
+		/// 16 MB on 32-bit builds and 256 MB otherwise
+		static uint64_t default_window_size() { return sizeof(size_t) == 4 ? 0x1000000 : 0x10000000; }
+
+		uint64_t size() const { return file_size; }
+		uint64_t window() const { return window_size; }
+
+		/// Get a pointer to part of the file, which is valid until the next
+		/// call to read. Reads which don't cross a multiple of window() never
+		/// need more than one window mapped.
+		const char *read(int64_t offset, uint64_t length);
+	};
+
 	class temp_file_mapping {
 		file_mapping file;
 		uint64_t file_size = 0;
@@ -63,4 +131,28 @@ namespace agi {
 		const char *read(int64_t offset, uint64_t length);
 		char *write(int64_t offset, uint64_t length);
 	};
+
+	/// Read-write mapping of a file which is left in place when closed
+	class persistent_file_mapping {
+		fs::path filename;
+		file_mapping file;
+		uint64_t file_size = 0;
+
+		std::unique_ptr<boost::interprocess::mapped_region> read_region;
+		uint64_t read_mapping_start = 0;
+		std::unique_ptr<boost::interprocess::mapped_region> write_region;
+		uint64_t write_mapping_start = 0;
+
+	public:
+		/// Open a file for reading and writing, creating it if it does not exist
+		persistent_file_mapping(fs::path const& filename);
+		~persistent_file_mapping();
+
+		uint64_t size() const { return file_size; }
+		/// Change the size of the file, invalidating all pointers into it
+		void resize(uint64_t size);
+
+		const char *read(int64_t offset, uint64_t length);
+		char *write(int64_t offset, uint64_t length);
+	};
 }
@@ -0,0 +1,169 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <boost/flyweight.hpp>
+#include <boost/flyweight/no_locking.hpp>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace agi {
+namespace flyweight {
+/// Number of independently locked parts of each factory
+const size_t shard_count = 64;
+
+/// Entry for sharded_refcounted. Mostly the same as boost's refcounted
+/// entries, but the deleter count lives under the factory's shard lock
+/// rather than a global one, and the hash is kept so that it's only
+/// computed once per insertion.
+template<typename Value, typename Key>
+class sharded_value {
+	template<typename, typename> friend class sharded_factory_class;
+	template<typename, typename> friend class sharded_handle;
+
+	Value x;
+	mutable std::atomic<long> ref{0};
+	mutable long del_ref = 0;
+	mutable size_t hash = 0;
+
+	/// Take the first reference to a value just found or inserted by the
+	/// factory. Must be called with the entry's shard locked.
+	void attach() const { if (++ref == 1) ++del_ref; }
+	/// Decide whether the entry can be erased. Must be called with the
+	/// entry's shard locked.
+	bool release_deleter() const { return --del_ref == 0; }
+
+public:
+	explicit sharded_value(Value const& x) : x(x) { }
+	explicit sharded_value(Value&& x) : x(std::move(x)) { }
+	sharded_value(sharded_value const& r) : x(r.x), hash(r.hash) { }
+	sharded_value(sharded_value&& r) : x(std::move(r.x)), hash(r.hash) { }
+
+	operator Value const&() const { return x; }
+	operator Key const&() const { return x; }
+};
+
+/// Handle for sharded_refcounted. The factory has already counted the
+/// reference when a handle is made from a factory handle.
+template<typename Handle, typename TrackingHelper>
+class sharded_handle {
+	Handle h;
+
+	static bool check_erase(sharded_handle const&) { return true; }
+
+public:
+	explicit sharded_handle(Handle const& h) : h(h) { }
+	sharded_handle(sharded_handle const& x) : h(x.h) {
+		++TrackingHelper::entry(*this).ref;
+	}
+	sharded_handle& operator=(sharded_handle x) {
+		swap(x);
+		return *this;
+	}
+	~sharded_handle() {
+		if (--TrackingHelper::entry(*this).ref == 0)
+			TrackingHelper::erase(*this, check_erase);
+	}
+
+	operator Handle const&() const { return h; }
+	void swap(sharded_handle& x) { std::swap(h, x.h); }
+};
+
+/// A hashed factory split into shards with a lock each, so that inserting
+/// and releasing different values from several threads at once rarely
+/// contends. Only works with sharded_refcounted tracking and no_locking,
+/// as the reference counting is done under the shard locks.
+template<typename Entry, typename Key>
+class sharded_factory_class : public boost::flyweights::factory_marker {
+	struct Hash {
+		size_t operator()(Entry const& e) const { return e.hash; }
+	};
+	struct Equal {
+		bool operator()(Entry const& a, Entry const& b) const {
+			return a.hash == b.hash && static_cast<Key const&>(a) == static_cast<Key const&>(b);
+		}
+	};
+	struct Shard {
+		std::mutex lock;
+		std::unordered_set<Entry, Hash, Equal> entries;
+	};
+	std::array<Shard, shard_count> shards;
+
+	Shard& shard(size_t hash) { return shards[hash % shard_count]; }
+
+public:
+	typedef const Entry* handle_type;
+
+	handle_type insert(Entry&& x) {
+		x.hash = std::hash<Key>()(static_cast<Key const&>(x));
+		auto& s = shard(x.hash);
+		std::lock_guard<std::mutex> lock(s.lock);
+		auto it = s.entries.insert(std::move(x)).first;
+		it->attach();
+		return &*it;
+	}
+
+	void erase(handle_type h) {
+		auto& s = shard(h->hash);
+		std::lock_guard<std::mutex> lock(s.lock);
+		if (h->release_deleter())
+			s.entries.erase(s.entries.find(*h));
+	}
+
+	static Entry const& entry(handle_type h) { return *h; }
+};
+
+/// Factory specifier for sharded_factory_class
+struct sharded_factory : boost::flyweights::factory_marker {
+	template<typename Entry, typename Key>
+	struct apply {
+		typedef sharded_factory_class<Entry, Key> type;
+	};
+};
+
+/// Tracking specifier for sharded_factory_class
+struct sharded_refcounted : boost::flyweights::tracking_marker {
+	struct entry_type {
+		template<typename Value, typename Key>
+		struct apply {
+			typedef sharded_value<Value, Key> type;
+		};
+	};
+
+	struct handle_type {
+		template<typename Handle, typename TrackingHelper>
+		struct apply {
+			typedef sharded_handle<Handle, TrackingHelper> type;
+		};
+	};
+};
+}
+
+/// Interned string which can be made and dropped from any number of threads
+/// at once without them waiting on each other, other than when they happen
+/// to use strings which hash to the same shard
+typedef boost::flyweight<std::string,
+	flyweight::sharded_factory,
+	flyweight::sharded_refcounted,
+	boost::flyweights::no_locking> StringFlyweight;
+}
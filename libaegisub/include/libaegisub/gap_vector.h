@@ -0,0 +1,133 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file gap_vector.h
+/// @brief A vector which is cheap to insert into and erase from near the
+///        position of the previous insertion or erasure
+/// @ingroup libaegisub
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace agi {
+
+/// @class gap_vector
+/// @brief An array with a gap of unused elements at the most recently
+///        modified position
+///
+/// Inserting or erasing only has to move the elements between the gap and
+/// the modified position, so runs of nearby edits (such as deleting lines
+/// while iterating over a file in either direction) take constant time per
+/// edit rather than being proportional to the size of the array.
+template<typename T>
+class gap_vector {
+	std::vector<T> data;
+	size_t gap_begin = 0;
+	size_t gap_end = 0;
+
+	size_t gap_size() const { return gap_end - gap_begin; }
+
+	size_t physical(size_t i) const { return i < gap_begin ? i : i + gap_size(); }
+
+	void move_gap(size_t pos) {
+		if (pos < gap_begin) {
+			std::move_backward(data.begin() + pos, data.begin() + gap_begin, data.begin() + gap_end);
+			gap_end -= gap_begin - pos;
+			gap_begin = pos;
+		}
+		else if (pos > gap_begin) {
+			std::move(data.begin() + gap_end, data.begin() + gap_end + (pos - gap_begin), data.begin() + gap_begin);
+			gap_end += pos - gap_begin;
+			gap_begin = pos;
+		}
+	}
+
+	/// Ensure that the gap is at pos and has room for at least count elements
+	void open_gap(size_t pos, size_t count) {
+		move_gap(pos);
+		if (gap_size() >= count) return;
+
+		size_t grow = std::max(count - gap_size(), std::max<size_t>(data.size(), 16));
+		data.insert(data.begin() + gap_end, grow, T());
+		gap_end += grow;
+	}
+
+public:
+	gap_vector() = default;
+	gap_vector(std::vector<T> values) : data(std::move(values)), gap_begin(data.size()), gap_end(data.size()) { }
+
+	size_t size() const { return data.size() - gap_size(); }
+	bool empty() const { return size() == 0; }
+
+	T& operator[](size_t i) { return data[physical(i)]; }
+	T const& operator[](size_t i) const { return data[physical(i)]; }
+
+	void push_back(T value) { insert(size(), std::move(value)); }
+
+	void insert(size_t pos, T value) {
+		open_gap(pos, 1);
+		data[gap_begin++] = std::move(value);
+	}
+
+	template<typename InputIterator>
+	void insert(size_t pos, InputIterator first, InputIterator last) {
+		open_gap(pos, std::distance(first, last));
+		for (; first != last; ++first)
+			data[gap_begin++] = *first;
+	}
+
+	/// Erase the elements in [first, last)
+	void erase(size_t first, size_t last) {
+		if (first >= last) return;
+		move_gap(first);
+		for (size_t i = gap_end; i < gap_end + (last - first); ++i)
+			data[i] = T();
+		gap_end += last - first;
+	}
+
+	void erase(size_t pos) { erase(pos, pos + 1); }
+
+	void clear() {
+		data.clear();
+		gap_begin = gap_end = 0;
+	}
+
+	/// Copy the elements to a vector
+	std::vector<T> to_vector() const {
+		std::vector<T> ret;
+		ret.reserve(size());
+		ret.insert(ret.end(), data.begin(), data.begin() + gap_begin);
+		ret.insert(ret.end(), data.begin() + gap_end, data.end());
+		return ret;
+	}
+
+	/// Move the elements to a vector, leaving this empty
+	std::vector<T> release() {
+		move_gap(size());
+		data.resize(gap_begin);
+		std::vector<T> ret = std::move(data);
+		clear();
+		return ret;
+	}
+};
+
+}
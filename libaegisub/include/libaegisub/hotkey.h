@@ -13,18 +13,16 @@
 // OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <boost/filesystem/path.hpp>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <libaegisub/fs_fwd.h>
 #include <libaegisub/signal.h>
 
-namespace json {
-	class UnknownElement;
-	typedef std::map<std::string, UnknownElement> Object;
-}
-
 namespace agi {
 	namespace hotkey {
 
@@ -57,6 +55,15 @@ public:
 	std::string const& Context() const { return context; }
 };
 
+/// Modifier bits of a packed combo, which is these or'd with the key code
+const uint32_t MOD_CTRL  = 1u << 31;
+const uint32_t MOD_ALT   = 1u << 30;
+const uint32_t MOD_SHIFT = 1u << 29;
+
+/// Maps the name of the last key of a combo (such as "A" or "F1") to the
+/// caller's code for that key, or 0 if it has none
+typedef std::function<uint32_t (std::string const&)> KeyCodeLookup;
+
 /// @class Hotkey
 /// Holds the map of Combo instances and handles searching for matching key sequences.
 class Hotkey {
@@ -64,20 +71,26 @@ public:
 	/// Map to hold Combo instances
 	typedef std::multimap<std::string, Combo> HotkeyMap;
 private:
+	/// Packed combo -> command name
+	typedef std::unordered_map<uint32_t, const std::string *> PackedMap;
+
 	HotkeyMap cmd_map;                  ///< Command name -> Combo
 	std::vector<const Combo *> str_map; ///< Sorted by string representation
 	const agi::fs::path config_file;    ///< Default user config location.
 	bool backup_config_file = false;
 
-	/// Build hotkey map.
-	/// @param context Context being parsed.
-	/// @param object  json::Object holding items for context being parsed.
-	void BuildHotkey(std::string const& context, const json::Object& object);
+	KeyCodeLookup key_code;             ///< Used to pack combos
+	/// Context -> combos in either that context or Default, with the ones
+	/// in the context taking precedence
+	std::unordered_map<std::string, PackedMap> packed_map;
+	PackedMap packed_default;           ///< Combos in Default
+	PackedMap packed_always;            ///< Combos in Always
 
 	/// Write active Hotkey configuration to disk.
 	void Flush();
 
 	void UpdateStrMap();
+	void UpdatePackedMap();
 
 	/// Announce that the loaded hotkeys have been changed
 	agi::signal::Signal<> HotkeysChanged;
@@ -98,6 +111,18 @@ public:
 	/// @return Name of command or "" if none match
 	std::string Scan(const std::string &context, const std::string &str, bool always) const;
 
+	/// Scan for a matching packed combo, which finds the same command as
+	/// scanning for the string form of the combo would
+	/// @param context Context requested.
+	/// @param combo   Modifier bits or'd with the code of the key
+	/// @param always  Enable the "Always" override context
+	/// @return Name of command or "" if none match
+	std::string const& Scan(const std::string &context, uint32_t combo, bool always) const;
+
+	/// Set how key names are turned into the key codes used by packed
+	/// combos. Until this is called no packed combo matches anything.
+	void SetKeyCodeLookup(KeyCodeLookup lookup);
+
 	bool HasHotkey(const std::string &context, const std::string &str) const;
 
 	/// Get the string representation of the hotkeys for the given command
@@ -19,6 +19,9 @@
 #include <libaegisub/cajun/elements.h>
 #include <libaegisub/fs_fwd.h>
 
+#include <functional>
+#include <iosfwd>
+
 namespace agi { namespace json_util {
 
 /// Parse a JSON stream.
@@ -32,4 +35,13 @@ json::UnknownElement parse(std::istream &stream);
 /// @return json::UnknownElement
 json::UnknownElement file(agi::fs::path const& file, std::pair<const char *, size_t> default_config);
 
+/// Read a json file without building a json::UnknownElement for it, falling
+/// back to the default config if the file can't be read.
+/// @param file Path to JSON file.
+/// @param Default config file to load incase of nonexistent file
+/// @param read Called with each stream tried, which it should pass to
+///             json::Reader::Read with a new handler; if it throws
+///             json::Exception the next stream is tried
+void file(agi::fs::path const& file, std::pair<const char *, size_t> default_config, std::function<void (std::istream&)> const& read);
+
 } }
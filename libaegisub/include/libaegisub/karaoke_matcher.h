@@ -27,4 +27,10 @@ namespace agi {
 
 	/// Try to automatically select the portion of dst which corresponds to the first string in src
 	karaoke_match_result auto_match_karaoke(std::vector<std::string> const& src, std::string const& dst);
+
+	/// Split all of src and dst into corresponding groups at once, choosing
+	/// the grouping which best fits the whole line rather than just the
+	/// first syllable
+	/// @return Each group in order; together they cover all of src and dst
+	std::vector<karaoke_match_result> auto_match_karaoke_line(std::vector<std::string> const& src, std::string const& dst);
 }
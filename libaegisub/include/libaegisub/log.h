@@ -15,13 +15,17 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
 // These macros below aren't a perm solution, it will depend on how annoying they are through
 // actual usage, and also depends on msvc support.
-#define LOG_SINK(section, severity) agi::log::Message(section, severity, __FILE__, __FUNCTION__, __LINE__).stream()
+// Messages which won't be logged skip evaluating and formatting their arguments
+#define LOG_SINK(section, severity) \
+	!agi::log::Enabled(severity) ? (void)0 : \
+	agi::log::Voidify() & agi::log::Message(section, severity, __FILE__, __FUNCTION__, __LINE__).stream()
 #define LOG_E(section) LOG_SINK(section, agi::log::Exception)
 #define LOG_A(section) LOG_SINK(section, agi::log::Assert)
 #define LOG_W(section) LOG_SINK(section, agi::log::Warning)
@@ -76,12 +80,33 @@ class LogSink {
 	/// List of pointers to emitters
 	std::vector<std::unique_ptr<Emitter>> emitters;
 
+	/// Messages logged but not yet handed to the emitters, newest first.
+	/// Logging threads push onto this without locking and only queue a task
+	/// to drain it when it was empty, so a burst of messages costs one trip
+	/// through the queue rather than one each
+	struct PendingMessage;
+	std::atomic<PendingMessage *> pending{nullptr};
+
+	/// Least severe messages which are logged
+	std::atomic<int> max_severity{Debug};
+
+	/// Record and emit the pending messages. Must be called on the queue.
+	void Drain();
+
 public:
 	LogSink();
 	~LogSink();
 
 	/// Insert a message into the sink.
-	void Log(SinkMessage const& sm);
+	void Log(SinkMessage sm);
+
+	/// Set the least severe messages which should be logged
+	void SetMaxSeverity(Severity severity) { max_severity = severity; }
+
+	/// Would a message of the given severity be logged?
+	bool Enabled(Severity severity) const {
+		return severity <= max_severity.load(std::memory_order_relaxed);
+	}
 
 	/// @brief Subscribe an emitter
 	/// @param em Emitter to add
@@ -96,6 +121,11 @@ public:
 	std::vector<SinkMessage> GetMessages() const;
 };
 
+/// Should messages of the given severity be generated at all?
+inline bool Enabled(Severity severity) {
+	return log && log->Enabled(severity);
+}
+
 /// An emitter to produce human readable output for a log sink.
 class Emitter {
 public:
@@ -130,6 +160,11 @@ public:
 	std::ostream& stream() { return msg; }
 };
 
+/// Turns a message's stream into void for LOG_SINK's conditional
+struct Voidify {
+	void operator&(std::ostream&) { }
+};
+
 /// Emit log entries to stdout.
 class EmitSTDOUT: public Emitter {
 public:
@@ -0,0 +1,37 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file parallel.h
+/// @brief Running pure Lua functions over arrays on the thread pool
+/// @ingroup libaegisub
+
+#include <libaegisub/fs_fwd.h>
+
+#include <vector>
+
+struct lua_State;
+
+namespace agi { namespace lua {
+	/// Implementation of aegisub.parallel_map(func, items)
+	///
+	/// Calls func on each value in the array items on a set of worker lua
+	/// states, which are set up with the standard modules and include_path,
+	/// and pushes an array of the results in the same order. func can't have
+	/// upvalues, and items and the results can only contain nil, booleans,
+	/// numbers, strings and tables of those.
+	int parallel_map(lua_State *L, std::vector<fs::path> const& include_path);
+} }
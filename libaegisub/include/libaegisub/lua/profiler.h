@@ -0,0 +1,96 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file profiler.h
+/// @brief Sampling profiler for automation scripts
+/// @ingroup libaegisub
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+struct lua_Debug;
+struct lua_State;
+
+namespace agi { namespace lua {
+	/// Where a profiled run of Lua code spent its time
+	struct ProfileData {
+		/// Microseconds spent in each distinct call stack, keyed by the names
+		/// of the stack's frames from outermost to innermost separated by
+		/// semicolons
+		std::map<std::string, int64_t> stacks;
+
+		bool empty() const { return stacks.empty(); }
+
+		/// Human-readable summary of the self and total time of each function
+		std::string Report() const;
+
+		/// The stacks in the folded format read by flamegraph.pl and
+		/// compatible tools, with a count of one per microsecond
+		std::string FoldedStacks() const;
+	};
+
+	/// @class Profiler
+	/// @brief Samples the call stack of a lua state for as long as it exists
+	///
+	/// A count hook records the Lua call stack every few thousand VM
+	/// instructions along with the time since the previous sample. Compiled
+	/// code doesn't run hooks, so the JIT compiler is off while profiling.
+	/// Only one profiler can be active on each thread at a time.
+	class Profiler {
+		friend class ProfileScope;
+
+		lua_State *L;
+		ProfileData data;
+		std::chrono::steady_clock::time_point last;
+		bool running = false;
+
+		/// Nesting depth of C functions currently being timed by ProfileScope
+		int c_depth = 0;
+		/// Lua stack under the outermost timed C function
+		std::string c_stack;
+		/// Frame name to record for the outermost timed C function
+		std::string c_name;
+		const char *c_category = nullptr;
+
+		static void Hook(lua_State *L, lua_Debug *);
+
+		/// Add the time since the last sample to the given stack
+		void Sample(std::string const& stack);
+
+	public:
+		Profiler(lua_State *L);
+		~Profiler();
+
+		/// Stop profiling and get the results
+		ProfileData Finish();
+	};
+
+	/// Attributes the time until the end of the scope to the C function
+	/// currently being called from Lua if there is an active profiler on this
+	/// thread, and does nothing otherwise. Nested scopes are only timed once,
+	/// but the innermost category is used.
+	class ProfileScope {
+		Profiler *profiler;
+
+	public:
+		/// @param category Label for the kind of C function, such as "subs"
+		ProfileScope(lua_State *L, const char *category = nullptr);
+		~ProfileScope();
+	};
+} }
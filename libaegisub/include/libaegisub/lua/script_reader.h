@@ -23,6 +23,8 @@ struct lua_State;
 namespace agi { namespace lua {
 	/// Load a Lua or Moonscript file at the given path
 	bool LoadFile(lua_State *L, agi::fs::path const& filename);
+	/// Cache compiled scripts loaded by LoadFile in the given directory
+	void SetBytecodeCache(lua_State *L, agi::fs::path const& dir);
 	/// Install our module loader and add include_path to the module search
 	/// path of the given lua state
 	bool Install(lua_State *L, std::vector<fs::path> const& include_path);
@@ -0,0 +1,114 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file memory_budget.h
+/// @brief Shared memory limit for all of the caches
+/// @ingroup libaegisub
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace agi {
+/// @class MemoryBudget
+/// @brief Divides one byte limit between the caches registered with it
+///
+/// Each cache keeps its own limit, but also reports its size to the budget
+/// and is told the most it may hold whenever the budget is rebalanced. When
+/// the caches together are over the limit, the ones with the lowest
+/// priority which are over their share of it are shrunk first; a cache's
+/// share is proportional to its weight. When there's room to spare, each
+/// cache is allowed to grow into its share of it.
+///
+/// Caches which can't shrink, such as audio decoded into memory, only take
+/// room away from the others.
+class MemoryBudget {
+public:
+	/// Get the current size of a cache in bytes. Called from whichever
+	/// thread rebalances the budget.
+	typedef std::function<size_t ()> SizeFunc;
+
+	/// Tell a cache the most bytes it may hold, or SIZE_MAX for no limit.
+	/// The cache should evict down to it, either immediately or the next
+	/// time it's used on its own thread. Called from whichever thread
+	/// rebalances the budget, and must not call back into the budget.
+	typedef std::function<void (size_t)> EvictFunc;
+
+	/// A cache's membership in the budget, which ends when destroyed
+	class Registration {
+		friend class MemoryBudget;
+		MemoryBudget *budget = nullptr;
+		size_t id = 0;
+
+		Registration(MemoryBudget *budget, size_t id) : budget(budget), id(id) { }
+
+	public:
+		Registration() = default;
+		Registration(Registration&& other);
+		Registration& operator=(Registration&& other);
+		~Registration();
+
+		/// Stop reporting to the budget. Once this returns, the cache's
+		/// callbacks are no longer running and will never be called again.
+		void Release();
+	};
+
+	/// @brief Add a cache to the budget
+	/// @param name     Name of the cache for the log
+	/// @param weight   Size of the cache's share of the limit relative to the others
+	/// @param priority Caches with lower priorities are shrunk first
+	/// @param size     Callback reporting the cache's size
+	/// @param evict    Callback limiting the cache's size, or empty if it can't shrink
+	Registration Register(std::string name, double weight, int priority, SizeFunc size, EvictFunc evict);
+
+	/// @brief Set the limit for all of the caches together
+	/// @param bytes Limit in bytes, or 0 for none
+	///
+	/// Takes effect at the next rebalance.
+	void SetLimit(size_t bytes);
+
+	/// Recalculate every cache's share and tell them what they may hold.
+	/// Cheap enough to call whenever a cache has grown.
+	void Rebalance();
+
+private:
+	struct Cache {
+		size_t id;
+		std::string name;
+		double weight;
+		int priority;
+		SizeFunc size;
+		EvictFunc evict;
+		/// Limit most recently given to the cache
+		size_t allowance;
+	};
+
+	std::mutex lock;
+	std::vector<Cache> caches;
+	size_t next_id = 1;
+	size_t limit = 0;
+
+	void Unregister(size_t id);
+};
+
+/// The budget shared by all of the caches in the program
+MemoryBudget& GlobalMemoryBudget();
+}
@@ -32,6 +32,7 @@ namespace json {
 }
 
 namespace agi {
+namespace dispatch { class Queue; }
 class OptionValue;
 
 class Options {
@@ -45,17 +46,27 @@ public:
 private:
 	std::vector<std::unique_ptr<OptionValue>> values;
 
+	/// Values by the hash of their name, sorted by hash, so that lookups
+	/// mostly compare integers rather than long shared name prefixes
+	std::vector<std::pair<size_t, OptionValue *>> index;
+
 	/// User config (file that will be written to disk)
 	const agi::fs::path config_file;
 
 	/// Settings.
 	const OptionSetting setting;
 
+	/// Queue which the user config file is written on
+	std::unique_ptr<dispatch::Queue> flush_queue;
+
 	/// @brief Load a config file into the Options object.
 	/// @param config Config to load.
 	/// @param ignore_errors Log invalid entires in the option file and continue rather than throwing an exception
 	void LoadConfig(std::istream& stream, bool ignore_errors = false);
 
+	/// Rebuild index after values has changed
+	void BuildIndex();
+
 public:
 	/// @brief Constructor
 	/// @param file User config that will be loaded from and written back to.
@@ -87,8 +98,13 @@ public:
 	/// possible config file loading and sets the file to write to.
 	void ConfigUser();
 
-	/// Write the user configuration to disk, throws an exception if something goes wrong.
+	/// Write the user configuration to disk. The values are copied when this
+	/// is called, but serializing and writing them is done in the background,
+	/// with any errors logged.
 	void Flush() const;
+
+	/// Wait for any writes queued by Flush to finish
+	void WaitForFlush() const;
 };
 
 } // namespace agi
@@ -0,0 +1,125 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file perf.h
+/// @brief Named performance counters shared by every subsystem
+/// @ingroup libaegisub
+///
+/// Metrics are looked up by name once and then updated with relaxed atomic
+/// operations, so they are cheap enough to leave in hot paths:
+///
+///     static auto& hits = agi::perf::GetCounter("video/cache/hits");
+///     hits.Add();
+///
+/// Snapshot() reads all of them at once for display.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace agi { namespace perf {
+/// A running count of events, such as cache hits
+class Counter {
+	std::atomic<int64_t> value{0};
+public:
+	void Add(int64_t count = 1) { value.fetch_add(count, std::memory_order_relaxed); }
+	int64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/// A current level, such as the bytes in a cache or the tasks in a queue
+class Gauge {
+	std::atomic<int64_t> value{0};
+public:
+	void Set(int64_t level) { value.store(level, std::memory_order_relaxed); }
+	void Add(int64_t delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+	int64_t Get() const { return value.load(std::memory_order_relaxed); }
+};
+
+/// A distribution of values, such as durations, in power-of-two buckets
+class Histogram {
+public:
+	/// Bucket i holds values below 2^i which aren't in a lower bucket
+	static const size_t bucket_count = 48;
+
+private:
+	std::atomic<int64_t> buckets[bucket_count];
+	std::atomic<int64_t> count{0};
+	std::atomic<int64_t> sum{0};
+
+public:
+	Histogram();
+
+	void Record(int64_t value);
+
+	int64_t Count() const { return count.load(std::memory_order_relaxed); }
+	int64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+
+	/// Get an upper bound for the value below which the given fraction of
+	/// the recorded values lie, accurate to within a factor of two
+	int64_t Percentile(double fraction) const;
+};
+
+/// Records the time from construction to destruction in a histogram, in
+/// microseconds
+class ScopedTimer {
+	Histogram &histogram;
+	std::chrono::steady_clock::time_point start;
+public:
+	ScopedTimer(Histogram &histogram)
+	: histogram(histogram)
+	, start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~ScopedTimer() {
+		histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+};
+
+/// Get the metric with the given name, creating it if needed
+///
+/// Metrics are never destroyed, so the reference can be kept for the life
+/// of the program; look each one up once rather than on every update.
+Counter& GetCounter(std::string const& name);
+Gauge& GetGauge(std::string const& name);
+Histogram& GetHistogram(std::string const& name);
+
+/// The state of one metric at the time of a snapshot
+struct Sample {
+	enum class Type { Counter, Gauge, Histogram };
+
+	std::string name;
+	Type type;
+	/// The counter or gauge's value, or the number of values in a histogram
+	int64_t value;
+	/// For histograms, the sum and upper bounds of the 50th, 90th and 99th
+	/// percentiles of the recorded values; zero for everything else
+	int64_t sum;
+	int64_t p50;
+	int64_t p90;
+	int64_t p99;
+};
+
+/// Read every metric, sorted by name
+std::vector<Sample> Snapshot();
+} }
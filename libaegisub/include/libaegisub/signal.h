@@ -15,8 +15,13 @@
 #pragma once
 
 #include <boost/config.hpp>
+#include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace agi { namespace signal {
@@ -124,31 +129,213 @@ namespace detail {
 	}
 }
 
+namespace detail {
+	/// Type-erased slot, like std::function but move-only and with room to
+	/// store the usual slots (a lambda capturing an object pointer and a
+	/// pointer to member function) inline, so that calling one doesn't have
+	/// to chase a pointer to a separate allocation
+	template<typename... Args>
+	class SlotFunction {
+		typedef typename std::aligned_storage<4 * sizeof(void *), alignof(std::max_align_t)>::type Storage;
+
+		Storage storage;
+		void (*invoke)(Storage&, typename std::add_lvalue_reference<const Args>::type...) = nullptr;
+		/// Move the callable in src into dst, or destroy dst's if src is null
+		void (*relocate)(Storage& dst, Storage *src) = nullptr;
+
+		template<typename F>
+		static F& Inline(Storage& s) { return *reinterpret_cast<F *>(&s); }
+		template<typename F>
+		static F*& Heap(Storage& s) { return *reinterpret_cast<F **>(&s); }
+
+		template<typename F>
+		static void InvokeInline(Storage& s, typename std::add_lvalue_reference<const Args>::type... args) {
+			Inline<F>(s)(args...);
+		}
+		template<typename F>
+		static void RelocateInline(Storage& dst, Storage *src) {
+			if (src) {
+				new (&dst) F(std::move(Inline<F>(*src)));
+				Inline<F>(*src).~F();
+			}
+			else
+				Inline<F>(dst).~F();
+		}
+
+		template<typename F>
+		static void InvokeHeap(Storage& s, typename std::add_lvalue_reference<const Args>::type... args) {
+			(*Heap<F>(s))(args...);
+		}
+		template<typename F>
+		static void RelocateHeap(Storage& dst, Storage *src) {
+			if (src)
+				Heap<F>(dst) = Heap<F>(*src);
+			else
+				delete Heap<F>(dst);
+		}
+
+		template<typename F>
+		void Init(F&& func, std::true_type) {
+			typedef typename std::decay<F>::type Func;
+			new (&storage) Func(std::forward<F>(func));
+			invoke = &InvokeInline<Func>;
+			relocate = &RelocateInline<Func>;
+		}
+
+		template<typename F>
+		void Init(F&& func, std::false_type) {
+			typedef typename std::decay<F>::type Func;
+			Heap<Func>(storage) = new Func(std::forward<F>(func));
+			invoke = &InvokeHeap<Func>;
+			relocate = &RelocateHeap<Func>;
+		}
+
+		void Reset() {
+			if (relocate) relocate(storage, nullptr);
+			invoke = nullptr;
+			relocate = nullptr;
+		}
+
+	public:
+		template<typename F>
+		SlotFunction(F&& func) {
+			typedef typename std::decay<F>::type Func;
+			Init(std::forward<F>(func), std::integral_constant<bool,
+				sizeof(Func) <= sizeof(Storage) &&
+				alignof(Func) <= alignof(Storage) &&
+				std::is_nothrow_move_constructible<Func>::value>());
+		}
+
+		SlotFunction(SlotFunction&& that) BOOST_NOEXCEPT
+		: invoke(that.invoke), relocate(that.relocate)
+		{
+			if (relocate) relocate(storage, &that.storage);
+			that.invoke = nullptr;
+			that.relocate = nullptr;
+		}
+
+		SlotFunction& operator=(SlotFunction&& that) BOOST_NOEXCEPT {
+			if (this != &that) {
+				Reset();
+				invoke = that.invoke;
+				relocate = that.relocate;
+				if (relocate) relocate(storage, &that.storage);
+				that.invoke = nullptr;
+				that.relocate = nullptr;
+			}
+			return *this;
+		}
+
+		~SlotFunction() { Reset(); }
+
+		void operator()(typename std::add_lvalue_reference<const Args>::type... args) {
+			invoke(storage, args...);
+		}
+	};
+
+	/// Can F be called with arguments of the given types?
+	template<typename F, typename... Args>
+	class CallableWith {
+		template<typename G, typename = decltype(std::declval<G&>()(std::declval<Args>()...))>
+		static std::true_type test(int);
+		template<typename G>
+		static std::false_type test(...);
+	public:
+		typedef decltype(test<F>(0)) type;
+	};
+}
+
 template<typename... Args>
 class Signal final : private detail::SignalBase {
-	using Slot = std::function<void(Args...)>;
-	std::vector<std::pair<detail::ConnectionToken*, Slot>> slots; /// Signals currently connected to this slot
+	struct Slot {
+		/// Null if the slot was disconnected during emission and hasn't been
+		/// removed yet
+		detail::ConnectionToken *token;
+		detail::SlotFunction<Args...> func;
+
+		template<typename F>
+		Slot(detail::ConnectionToken *token, F&& func) : token(token), func(std::forward<F>(func)) { }
+	};
+
+	/// Slots currently connected to this signal
+	std::vector<Slot> slots;
+	/// Slots connected while the signal is being emitted, which are added to
+	/// slots once it's done so that slots never move while running
+	std::vector<Slot> added;
+	/// Depth of nested emissions of this signal
+	size_t emitting = 0;
+	/// Have any slots been disconnected during emission?
+	bool disconnected = false;
 
 	void Disconnect(detail::ConnectionToken *tok) override {
 		for (auto it = begin(slots), e = end(slots); it != e; ++it) {
-			if (tok == it->first) {
-				slots.erase(it);
+			if (tok == it->token) {
+				if (emitting) {
+					it->token = nullptr;
+					disconnected = true;
+				}
+				else
+					slots.erase(it);
+				return;
+			}
+		}
+		for (auto it = begin(added), e = end(added); it != e; ++it) {
+			if (tok == it->token) {
+				added.erase(it);
 				return;
 			}
 		}
 	}
 
-	UnscopedConnection DoConnect(Slot sig) {
+	template<typename F>
+	UnscopedConnection DoConnect(F&& func) {
 		auto token = MakeToken();
-		slots.emplace_back(token, sig);
+		(emitting ? added : slots).emplace_back(token, std::forward<F>(func));
 		return UnscopedConnection(token);
 	}
 
+	template<typename F>
+	UnscopedConnection ConnectCallable(F&& func, std::true_type) {
+		return DoConnect(std::forward<F>(func));
+	}
+
+	// A callable which does not use any signal args
+	template<typename F>
+	UnscopedConnection ConnectCallable(F&& func, std::false_type) {
+		typename std::decay<F>::type thunk(std::forward<F>(func));
+		return DoConnect([=](typename std::add_lvalue_reference<const Args>::type...) mutable { thunk(); });
+	}
+
+	/// Apply the connection changes made during emission
+	void FinishEmitting() {
+		if (disconnected) {
+			slots.erase(std::remove_if(begin(slots), end(slots), [](Slot const& slot) { return !slot.token; }), end(slots));
+			disconnected = false;
+		}
+		if (!added.empty()) {
+			for (auto& slot : added)
+				slots.push_back(std::move(slot));
+			added.clear();
+		}
+	}
+
+	struct EmitGuard {
+		Signal *signal;
+		EmitGuard(Signal *signal) : signal(signal) { ++signal->emitting; }
+		~EmitGuard() {
+			if (--signal->emitting == 0)
+				signal->FinishEmitting();
+		}
+	};
+
 public:
 	~Signal() {
-		for (auto& slot : slots) {
-			DisconnectToken(slot.first);
-			if (!TokenClaimed(slot.first)) delete slot.first;
+		for (auto list : {&slots, &added}) {
+			for (auto& slot : *list) {
+				if (!slot.token) continue;
+				DisconnectToken(slot.token);
+				if (!TokenClaimed(slot.token)) delete slot.token;
+			}
 		}
 	}
 
@@ -157,17 +344,21 @@ public:
 	/// The order in which connected slots are called is undefined and should
 	/// not be relied on
 	void operator()(Args... args) {
+		EmitGuard guard(this);
 		for (size_t i = slots.size(); i > 0; --i) {
-			if (!Blocked(slots[i - 1].first))
-				slots[i - 1].second(args...);
+			auto& slot = slots[i - 1];
+			if (slot.token && !Blocked(slot.token))
+				slot.func(args...);
 		}
 	}
 
-	/// @brief Connect a signal to this slot
-	/// @param sig Signal to connect
+	/// @brief Connect a callable to this signal. The callable can either
+	///        take the signal's args or no args.
+	/// @param func Callable to connect
 	/// @return The connection object
-	UnscopedConnection Connect(Slot sig) {
-		return DoConnect(sig);
+	template<typename F>
+	UnscopedConnection Connect(F&& func) {
+		return ConnectCallable(std::forward<F>(func), typename detail::CallableWith<F, Args...>::type());
 	}
 
 	// Convenience wrapper for a member function which matches the signal's signature
@@ -176,12 +367,6 @@ public:
 		return DoConnect([=](Args... args) { (a1->*func)(args...); });
 	}
 
-	// Convenience wrapper for a callable which does not use any signal args
-	template<typename Thunk, typename = decltype((*(Thunk *)0)())>
-	UnscopedConnection Connect(Thunk&& func) {
-		return DoConnect([=](Args... args) mutable { func(); });
-	}
-
 	// Convenience wrapper for a member function which does not use any signal
 	// args. The match is overly-broad to avoid having two methods with the
 	// same signature when the signal has no args.
@@ -196,6 +381,13 @@ public:
 	UnscopedConnection Connect(void (T::*func)(Arg1), T* a1) {
 		return DoConnect(std::bind(func, a1, std::placeholders::_1));
 	}
+
+	// Convenience wrapper for a member function which uses only the first two
+	// signal args.
+	template<typename T, typename Arg1, typename Arg2>
+	UnscopedConnection Connect(void (T::*func)(Arg1, Arg2), T* a1) {
+		return DoConnect(std::bind(func, a1, std::placeholders::_1, std::placeholders::_2));
+	}
 };
 
 /// Create a vector of scoped connections from an initializer list
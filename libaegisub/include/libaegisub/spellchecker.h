@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -47,6 +48,21 @@ public:
 	/// @return Whether or not the word is valid
 	virtual bool CheckWord(std::string const& word)=0;
 
+	/// Check a word only if doing so won't have to consult the dictionary
+	/// @param word Word to check
+	/// @param[out] valid Whether or not the word is valid, if it was checked
+	/// @return Whether the result was already known
+	virtual bool TryCheckWord(std::string const& word, bool& valid) {
+		valid = CheckWord(word);
+		return true;
+	}
+
+	/// Check words in the background so that later checks of them are fast
+	/// @param words Words to check
+	/// @param on_done Invoked on the main thread once all of the words have
+	///                been checked; never invoked if nothing had to be done
+	virtual void CheckWordsAsync(std::vector<std::string> words, std::function<void()> on_done) { }
+
 	/// Get possible corrections for a misspelled word
 	/// @param word Word to get suggestions for
 	/// @return List of suggestions, if any
@@ -14,7 +14,7 @@
 
 #include "fs_fwd.h"
 
-#include <boost/container/flat_map.hpp>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -26,8 +26,30 @@ class read_file_mapping;
 namespace charset { class IconvWrapper; }
 
 class Thesaurus {
-	/// Map of word -> byte position in the data file
-	boost::container::flat_map<std::string, size_t> offsets;
+	/// Sorted table of words and their byte positions in the data file
+	struct IndexEntry {
+		uint32_t word_offset;
+		uint32_t word_length;
+		uint64_t dat_offset;
+	};
+
+	/// Binary index, either mapped from the cache file or built in memory
+	std::unique_ptr<read_file_mapping> index_file;
+	std::vector<char> index_buffer;
+	/// Start of the binary index, wherever it lives
+	const char *index = nullptr;
+	uint64_t index_size = 0;
+	/// Entries in the index, sorted by word
+	const IndexEntry *entries = nullptr;
+	size_t entry_count = 0;
+
+	/// Try to use a previously built binary index for the idx file
+	bool LoadIndex(agi::fs::path const& cache_path, agi::fs::path const& idx_path);
+	/// Parse the idx file into an in-memory binary index
+	void BuildIndex(agi::fs::path const& idx_path);
+	/// Point the lookup members at the index in index_buffer or index_file
+	bool UseIndex(const char *data, uint64_t size);
+
 	/// Read handle to the data file
 	std::unique_ptr<read_file_mapping> dat;
 	/// Converter from the data file's charset to UTF-8
@@ -41,6 +63,13 @@ public:
 	/// @param dat_path Path to data file
 	/// @param idx_path Path to index file
 	Thesaurus(agi::fs::path const& dat_path, agi::fs::path const& idx_path);
+
+	/// Constructor
+	/// @param dat_path Path to data file
+	/// @param idx_path Path to index file
+	/// @param cache_path Path to read a prebuilt binary index from if it's
+	///                   up to date, or to write a newly built one to
+	Thesaurus(agi::fs::path const& dat_path, agi::fs::path const& idx_path, agi::fs::path const& cache_path);
 	~Thesaurus();
 
 	/// Look up synonyms for a word
@@ -0,0 +1,79 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file trace.h
+/// @brief Optional recording of what ran on which thread, for trace viewers
+/// @ingroup libaegisub
+///
+/// While enabled, each Scope records one event with its start time,
+/// duration and thread into a ring buffer holding the most recent events.
+/// Write() saves them as Chrome trace-event JSON, which can be loaded into
+/// chrome://tracing or Perfetto:
+///
+///     agi::trace::Scope scope("decode frame", "video");
+///
+/// When disabled, a Scope costs a single relaxed load.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+
+namespace agi { namespace trace {
+namespace detail {
+	extern std::atomic<bool> enabled;
+	int64_t Now();
+	void Record(const char *name, const char *category, int64_t start);
+}
+
+/// Start or stop recording events. Starting discards anything already recorded.
+void SetEnabled(bool enable);
+inline bool IsEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+/// Label the calling thread in traces
+void NameThread(const char *name);
+
+/// Write the recorded events as Chrome trace-event JSON
+void Write(std::ostream& out);
+
+/// Records the time from construction to destruction as an event
+///
+/// The name and category must be string literals, or otherwise outlive the
+/// recorded events, as only the pointers are stored.
+class Scope {
+	const char *name;
+	const char *category;
+	int64_t start;
+
+public:
+	Scope(const char *name, const char *category)
+	: name(name)
+	, category(category)
+	, start(IsEnabled() ? detail::Now() : -1)
+	{
+	}
+
+	~Scope() {
+		if (start >= 0)
+			detail::Record(name, category, start);
+	}
+
+	Scope(Scope const&) = delete;
+	Scope& operator=(Scope const&) = delete;
+};
+} }
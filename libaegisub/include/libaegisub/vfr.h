@@ -134,6 +134,22 @@ public:
 	/// results for all frame numbers
 	int TimeAtFrame(int frame, Time type = EXACT) const;
 
+	/// @brief Get the frame visible at each of a list of times
+	/// @param times Times in milliseconds
+	/// @param type Time mode
+	/// @return The result of FrameAtTime for each time
+	///
+	/// This is much faster than calling FrameAtTime repeatedly when the times
+	/// are mostly in increasing order, as the search through the timecodes
+	/// resumes from where the previous time left off
+	std::vector<int> FramesAtTimes(std::vector<int> const& times, Time type = EXACT) const;
+
+	/// @brief Get the time at each of a list of frames
+	/// @param frames Frame numbers
+	/// @param type Time mode
+	/// @return The result of TimeAtFrame for each frame
+	std::vector<int> TimesAtFrames(std::vector<int> const& frames, Time type = EXACT) const;
+
 	/// @brief Get the components of the SMPTE timecode for the given time
 	/// @param[out] h Hours component
 	/// @param[out] m Minutes component
@@ -15,6 +15,7 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 #include <libaegisub/color.h>
@@ -40,8 +41,41 @@ class ycbcr_converter {
 	std::array<double, 3> shift_from;
 	std::array<double, 3> shift_to;
 
+	/// Fractional bits of the lookup table entries
+	static const int table_bits = 20;
+
+	/// @brief Fixed-point lookup tables for one conversion
+	///
+	/// Each output channel is the sum of one entry per input channel plus a
+	/// bias, with the rounding folded into the bias, so converting a colour
+	/// takes nine lookups rather than a matrix product.
+	struct table {
+		std::array<std::array<int32_t, 256>, 9> entries;
+		std::array<int32_t, 3> bias;
+
+		void init(std::array<double, 9> const& m, std::array<double, 3> const& shift);
+
+		std::array<uint8_t, 3> convert(uint8_t a, uint8_t b, uint8_t c) const {
+			return {{
+				lookup(0, a, b, c),
+				lookup(1, a, b, c),
+				lookup(2, a, b, c),
+			}};
+		}
+
+		uint8_t lookup(size_t ch, uint8_t a, uint8_t b, uint8_t c) const {
+			int32_t v = (entries[ch * 3][a] + entries[ch * 3 + 1][b] + entries[ch * 3 + 2][c] + bias[ch]) >> table_bits;
+			v = v > 255 ? 255 : v;
+			return v < 0 ? 0 : v;
+		}
+	};
+
+	table rgb_table;
+	table ycbcr_table;
+
 	void init_dst(ycbcr_matrix dst_mat, ycbcr_range dst_range);
 	void init_src(ycbcr_matrix src_mat, ycbcr_range src_range);
+	void init_tables();
 
 	template<typename T>
 	static std::array<double, 3> prod(std::array<double, 9> m, std::array<T, 3> v) {
@@ -87,10 +121,26 @@ public:
 			add(add(prod(to_ycbcr, input), shift_to), shift_from)));
 	}
 
+	/// @brief Convert rgb to ycbcr using src_mat and then back using dst_mat
+	///
+	/// This and the other batch conversions go through lookup tables rather
+	/// than doing the math in floating point, and very rarely round to a
+	/// value one away from the std::array versions.
 	Color rgb_to_rgb(Color c) const {
-		auto arr = rgb_to_rgb(std::array<uint8_t, 3>{{c.r, c.g, c.b}});
+		auto arr = rgb_table.convert(c.r, c.g, c.b);
 		return Color{arr[0], arr[1], arr[2], c.a};
 	}
+
+	/// Convert an array of colors in place, as with rgb_to_rgb(Color)
+	void rgb_to_rgb(Color *colors, size_t count) const;
+
+	/// @brief Convert a row of 4:2:0 or 4:2:2 src_mat/src_range pixels to BGRA
+	/// @param y Luma samples, one per pixel
+	/// @param cb Blue chroma samples, one per two pixels
+	/// @param cr Red chroma samples, one per two pixels
+	/// @param dst Output with four bytes per pixel; alpha is set to zero
+	/// @param width Number of pixels
+	void ycbcr_to_bgra(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, size_t width) const;
 };
 }
 
@@ -17,8 +17,50 @@
 #include <libaegisub/lua/ffi.h>
 
 #include <boost/locale/conversion.hpp>
+#include <cstdint>
+#include <cstring>
 
 namespace {
+/// Number of bytes in the character starting with the byte b, with the same
+/// naive handling of invalid UTF-8 as unicode.charwidth
+inline size_t char_width(unsigned char b) {
+	return b < 128 ? 1 : b < 224 ? 2 : b < 240 ? 3 : 4;
+}
+
+int len(const char *str, size_t len) {
+	// Runs of ASCII are counted eight bytes at a time, and everything else is
+	// stepped over by the width of its first byte like unicode.chars does
+	const uint64_t high_bits = 0x8080808080808080ULL;
+	int count = 0;
+	for (size_t i = 0; i < len; ++count) {
+		if (i + 8 <= len) {
+			uint64_t word;
+			memcpy(&word, str + i, sizeof word);
+			if (!(word & high_bits)) {
+				i += 8;
+				count += 7;
+				continue;
+			}
+		}
+		i += char_width(str[i]);
+	}
+	return count;
+}
+
+int codepoint(const char *str, size_t len) {
+	if (!len) return 0;
+
+	auto b = static_cast<unsigned char>(str[0]);
+	size_t width = char_width(b);
+	if (width == 1) return b;
+
+	// Naive decoding which assumes the input is valid, as before
+	int res = b - (width == 2 ? 192 : width == 3 ? 224 : 240);
+	for (size_t i = 1; i < width && i < len; ++i)
+		res = res * 64 + static_cast<unsigned char>(str[i]) - 128;
+	return res;
+}
+
 template<std::string (*func)(const char *, std::locale const&)>
 char *wrap(const char *str, char **err) {
 	try {
@@ -34,6 +76,8 @@ extern "C" int luaopen_unicode_impl(lua_State *L) {
 	agi::lua::register_lib_table(L, {},
 		"to_upper_case", wrap<boost::locale::to_upper<char>>,
 		"to_lower_case", wrap<boost::locale::to_lower<char>>,
-		"to_fold_case", wrap<boost::locale::fold_case<char>>);
+		"to_fold_case", wrap<boost::locale::fold_case<char>>,
+		"len", len,
+		"codepoint", codepoint);
 	return 1;
 }
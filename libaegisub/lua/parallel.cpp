@@ -0,0 +1,165 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/lua/parallel.h"
+
+#include "libaegisub/dispatch.h"
+#include "libaegisub/lua/modules.h"
+#include "libaegisub/lua/script_reader.h"
+#include "libaegisub/lua/utils.h"
+
+#include <memory>
+#include <utility>
+
+namespace {
+using namespace agi::lua;
+
+DEFINE_EXCEPTION(ParallelMapError, agi::Exception);
+
+/// Items per worker state below which it isn't worth creating another one
+const size_t min_items_per_state = 64;
+/// Maximum nesting of tables passed to or returned from workers
+const int max_table_depth = 100;
+
+/// A copy of a Lua value which isn't tied to any lua state
+struct Value {
+	int type = LUA_TNIL;
+	bool boolean = false;
+	double number = 0.;
+	std::string string;
+	std::vector<std::pair<Value, Value>> table;
+};
+
+void read_value(lua_State *L, int idx, Value& out, int depth = 0) {
+	if (depth > max_table_depth)
+		throw ParallelMapError("Tables passed to or returned from parallel_map are nested too deeply");
+
+	out.type = lua_type(L, idx);
+	switch (out.type) {
+		case LUA_TNIL:
+			break;
+		case LUA_TBOOLEAN:
+			out.boolean = !!lua_toboolean(L, idx);
+			break;
+		case LUA_TNUMBER:
+			out.number = lua_tonumber(L, idx);
+			break;
+		case LUA_TSTRING: {
+			size_t len;
+			auto str = lua_tolstring(L, idx, &len);
+			out.string.assign(str, len);
+			break;
+		}
+		case LUA_TTABLE:
+			if (!lua_checkstack(L, 2))
+				throw ParallelMapError("Out of stack space copying a table");
+			lua_pushnil(L);
+			while (lua_next(L, idx)) {
+				out.table.emplace_back();
+				int top = lua_gettop(L);
+				read_value(L, top - 1, out.table.back().first, depth + 1);
+				read_value(L, top, out.table.back().second, depth + 1);
+				lua_pop(L, 1);
+			}
+			break;
+		default:
+			throw ParallelMapError(std::string("parallel_map can't pass values of type ") + lua_typename(L, out.type));
+	}
+}
+
+void push_copy(lua_State *L, Value const& value) {
+	switch (value.type) {
+		case LUA_TBOOLEAN: lua_pushboolean(L, value.boolean); break;
+		case LUA_TNUMBER:  lua_pushnumber(L, value.number); break;
+		case LUA_TSTRING:  lua_pushlstring(L, value.string.data(), value.string.size()); break;
+		case LUA_TTABLE:
+			if (!lua_checkstack(L, 3))
+				throw ParallelMapError("Out of stack space copying a table");
+			lua_createtable(L, 0, value.table.size());
+			for (auto const& field : value.table) {
+				push_copy(L, field.first);
+				push_copy(L, field.second);
+				lua_rawset(L, -3);
+			}
+			break;
+		default: lua_pushnil(L); break;
+	}
+}
+
+int write_bytecode(lua_State *, const void *p, size_t size, void *ud) {
+	static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+	return 0;
+}
+}
+
+namespace agi { namespace lua {
+int parallel_map(lua_State *L, std::vector<fs::path> const& include_path) {
+	argcheck(L, lua_isfunction(L, 1) && !lua_iscfunction(L, 1), 1, "Expected a Lua function");
+	argcheck(L, !lua_getupvalue(L, 1, 1), 1, "Functions passed to parallel_map can't have upvalues");
+	argcheck(L, lua_istable(L, 2), 2, "Expected an array");
+
+	// Everything the workers need is copied out of this state up front, as
+	// it can't be touched from other threads
+	std::string bytecode;
+	lua_pushvalue(L, 1);
+	lua_dump(L, write_bytecode, &bytecode);
+	lua_pop(L, 1);
+
+	size_t count = lua_objlen(L, 2);
+	std::vector<Value> items(count);
+	for (size_t i = 0; i < count; ++i) {
+		lua_rawgeti(L, 2, i + 1);
+		read_value(L, lua_gettop(L), items[i]);
+		lua_pop(L, 1);
+	}
+
+	std::vector<Value> results(count);
+	dispatch::ParallelFor(0, count, min_items_per_state, [&](size_t begin, size_t end) {
+		std::unique_ptr<lua_State, void (*)(lua_State *)> state(luaL_newstate(), lua_close);
+		auto W = state.get();
+		if (!W) throw ParallelMapError("Could not initialize Lua state");
+
+		preload_modules(W);
+		if (!Install(W, include_path))
+			throw ParallelMapError("Error initializing worker: " + get_string_or_default(W, -1));
+
+		lua_createtable(W, 0, 1);
+		set_field(W, "lua_automation_version", 4);
+		lua_setglobal(W, "aegisub");
+
+		lua_pushcclosure(W, add_stack_trace, 0);
+		if (luaL_loadbuffer(W, bytecode.data(), bytecode.size(), "=parallel_map"))
+			throw ParallelMapError("Error loading function: " + get_string_or_default(W, -1));
+
+		for (size_t i = begin; i < end; ++i) {
+			lua_pushvalue(W, 2);
+			push_copy(W, items[i]);
+			if (lua_pcall(W, 1, 1, 1))
+				throw ParallelMapError(get_string_or_default(W, -1));
+			read_value(W, lua_gettop(W), results[i]);
+			lua_pop(W, 1);
+		}
+	});
+
+	lua_createtable(L, count, 0);
+	for (size_t i = 0; i < count; ++i) {
+		push_copy(L, results[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	return 1;
+}
+} }
@@ -0,0 +1,184 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "libaegisub/lua/profiler.h"
+
+#include "libaegisub/format.h"
+
+#include <algorithm>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <set>
+#include <vector>
+
+#include <lua.hpp>
+
+namespace {
+using namespace std::chrono;
+
+/// VM instructions between samples
+const int sample_interval = 1000;
+/// Number of functions listed in each section of the report
+const size_t report_length = 50;
+
+thread_local agi::lua::Profiler *active = nullptr;
+
+std::string frame_name(lua_Debug const& ar) {
+	std::string name;
+	if (*ar.what == 'C')
+		name = std::string("[C] ") + (ar.name ? ar.name : "?");
+	else if (*ar.what == 'm')
+		name = std::string("main chunk (") + ar.short_src + ")";
+	else
+		name = agi::format("%s (%s:%d)", ar.name ? ar.name : "?", ar.short_src, ar.linedefined);
+	// Semicolons separate frames in the folded stacks
+	boost::replace_all(name, ";", ",");
+	return name;
+}
+
+/// Get the folded stack of the given lua state starting at level
+std::string current_stack(lua_State *L, int level) {
+	std::vector<std::string> frames;
+	lua_Debug ar;
+	for (; lua_getstack(L, level, &ar); ++level) {
+		lua_getinfo(L, "Sn", &ar);
+		frames.push_back(frame_name(ar));
+	}
+
+	std::string stack;
+	for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+		if (!stack.empty()) stack += ';';
+		stack += *it;
+	}
+	return stack;
+}
+
+void append_section(std::string& out, const char *title, std::map<std::string, int64_t> const& times, int64_t total) {
+	std::vector<std::pair<std::string, int64_t>> sorted(times.begin(), times.end());
+	std::sort(sorted.begin(), sorted.end(), [](std::pair<std::string, int64_t> const& a, std::pair<std::string, int64_t> const& b) {
+		return a.second > b.second;
+	});
+	if (sorted.size() > report_length)
+		sorted.resize(report_length);
+
+	out += title;
+	out += '\n';
+	for (auto const& func : sorted)
+		out += agi::format("%6.2f%%  %10.3f ms  %s\n", 100.0 * func.second / total, func.second / 1000.0, func.first);
+	out += '\n';
+}
+}
+
+namespace agi { namespace lua {
+std::string ProfileData::Report() const {
+	int64_t total = 0;
+	std::map<std::string, int64_t> self, inclusive;
+	std::vector<std::string> frames;
+	for (auto const& stack : stacks) {
+		total += stack.second;
+
+		boost::split(frames, stack.first, [](char c) { return c == ';'; });
+		self[frames.back()] += stack.second;
+		// Recursive functions only count once per stack
+		for (auto const& frame : std::set<std::string>(frames.begin(), frames.end()))
+			inclusive[frame] += stack.second;
+	}
+
+	if (!total) return "";
+
+	std::string out = agi::format("Total time profiled: %.3f ms\n\n", total / 1000.0);
+	append_section(out, "Self time:", self, total);
+	append_section(out, "Total time including callees:", inclusive, total);
+	return out;
+}
+
+std::string ProfileData::FoldedStacks() const {
+	std::string out;
+	for (auto const& stack : stacks) {
+		if (stack.second > 0)
+			out += agi::format("%s %d\n", stack.first, stack.second);
+	}
+	return out;
+}
+
+Profiler::Profiler(lua_State *L)
+: L(L)
+, last(steady_clock::now())
+{
+	if (active) return;
+	active = this;
+	running = true;
+
+	luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_FLUSH);
+	luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+	lua_sethook(L, Hook, LUA_MASKCOUNT, sample_interval);
+}
+
+Profiler::~Profiler() {
+	Finish();
+}
+
+ProfileData Profiler::Finish() {
+	if (!running) return ProfileData();
+	running = false;
+	active = nullptr;
+
+	lua_sethook(L, nullptr, 0, 0);
+	luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+	return std::move(data);
+}
+
+void Profiler::Hook(lua_State *L, lua_Debug *) {
+	if (active)
+		active->Sample(current_stack(L, 0));
+}
+
+void Profiler::Sample(std::string const& stack) {
+	auto now = steady_clock::now();
+	data.stacks[stack] += duration_cast<microseconds>(now - last).count();
+	last = now;
+}
+
+ProfileScope::ProfileScope(lua_State *L, const char *category)
+: profiler(active)
+{
+	if (!profiler) return;
+
+	if (profiler->c_depth++ == 0) {
+		// Level 0 is the C function itself, so the time up until now belongs
+		// to its caller
+		profiler->c_stack = current_stack(L, 1);
+		profiler->Sample(profiler->c_stack);
+
+		lua_Debug ar;
+		profiler->c_name = "?";
+		if (lua_getstack(L, 0, &ar) && lua_getinfo(L, "n", &ar) && ar.name)
+			profiler->c_name = ar.name;
+		profiler->c_category = "C";
+	}
+	if (category)
+		profiler->c_category = category;
+}
+
+ProfileScope::~ProfileScope() {
+	if (!profiler || --profiler->c_depth > 0) return;
+
+	auto name = agi::format("[%s] %s", profiler->c_category, profiler->c_name);
+	boost::replace_all(name, ";", ",");
+	profiler->Sample(profiler->c_stack.empty() ? name : profiler->c_stack + ";" + name);
+}
+} }
@@ -17,14 +17,171 @@
 #include "libaegisub/lua/script_reader.h"
 
 #include "libaegisub/file_mapping.h"
+#include "libaegisub/io.h"
 #include "libaegisub/log.h"
 #include "libaegisub/lua/utils.h"
 #include "libaegisub/split.h"
 
 #include <boost/algorithm/string/replace.hpp>
+#include <cstring>
 #include <lauxlib.h>
 
+namespace {
+using namespace agi;
+using namespace agi::lua;
+
+/// Header of a cached compiled script, which is followed by the MoonScript
+/// line table as pairs of Lua line numbers and source offsets, the path of
+/// the script, and then the LuaJIT bytecode
+struct bytecode_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t line_count;
+	/// Size, hash and modification time of the source the bytecode was
+	/// compiled from
+	uint64_t source_size;
+	uint64_t source_hash;
+	int64_t source_modified;
+	uint32_t path_length;
+};
+
+const char bytecode_magic[8] = {'A', 'G', 'I', 'L', 'U', 'A', 'B', 'C'};
+const uint32_t bytecode_version = 1;
+const char *cache_dir_key = "bytecode cache directory";
+
+uint64_t hash_bytes(const char *data, size_t size) {
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+	return hash;
+}
+
+/// Path of the cache file for the given script, or an empty path if the
+/// lua state doesn't have a cache directory
+fs::path cache_path(lua_State *L, std::string const& filename) {
+	lua_getfield(L, LUA_REGISTRYINDEX, cache_dir_key);
+	fs::path ret;
+	if (lua_isstring(L, -1))
+		ret = fs::path(lua_tostring(L, -1))/(std::to_string(hash_bytes(filename.data(), filename.size())) + ".luac");
+	lua_pop(L, 1);
+	return ret;
+}
+
+/// Push the table of MoonScript line tables, returning false if it can't be
+/// loaded
+bool push_line_tables(lua_State *L) {
+	if (luaL_dostring(L, "return require 'moonscript.line_tables'")) {
+		lua_pop(L, 1);
+		return false;
+	}
+	return true;
+}
+
+/// Push the function in the cache file if it's up to date
+bool load_cached(lua_State *L, fs::path const& path, std::string const& filename, bytecode_header const& expected) {
+	try {
+		if (!fs::FileExists(path)) return false;
+
+		read_file_mapping file(path);
+		if (file.size() < sizeof(bytecode_header)) return false;
+
+		auto data = file.read();
+		auto size = static_cast<size_t>(file.size());
+		bytecode_header header;
+		memcpy(&header, data, sizeof header);
+		if (memcmp(header.magic, bytecode_magic, sizeof bytecode_magic) || header.version != bytecode_version)
+			return false;
+		if (header.source_size != expected.source_size ||
+			header.source_hash != expected.source_hash ||
+			header.source_modified != expected.source_modified)
+			return false;
+
+		size_t lines_size = header.line_count * 2 * sizeof(uint32_t);
+		size_t bytecode_offset = sizeof header + lines_size + header.path_length;
+		if (lines_size / sizeof(uint32_t) / 2 != header.line_count || bytecode_offset >= size)
+			return false;
+		if (filename.compare(0, filename.size(), data + sizeof header + lines_size, header.path_length) != 0)
+			return false;
+
+		if (luaL_loadbuffer(L, data + bytecode_offset, size - bytecode_offset, filename.c_str())) {
+			// Most likely compiled by a different version of LuaJIT
+			lua_pop(L, 1);
+			return false;
+		}
+
+		// Restore the line table which compiling would have created so that
+		// errors point at the right line of the MoonScript source
+		if (header.line_count && push_line_tables(L)) {
+			lua_createtable(L, 0, header.line_count);
+			auto lines = data + sizeof header;
+			for (uint32_t i = 0; i < header.line_count; ++i) {
+				uint32_t line[2];
+				memcpy(line, lines + i * sizeof line, sizeof line);
+				push_value(L, line[1]);
+				lua_rawseti(L, -2, line[0]);
+			}
+			lua_setfield(L, -2, filename.c_str());
+			lua_pop(L, 1);
+		}
+		return true;
+	}
+	catch (fs::FileSystemError const&) {
+		return false;
+	}
+}
+
+/// Write the function on the top of the stack to the cache
+void save_cached(lua_State *L, fs::path const& path, std::string const& filename, bytecode_header header, bool moon) {
+	std::string bytecode;
+	lua_dump(L, [](lua_State *, const void *p, size_t size, void *ud) {
+		static_cast<std::string *>(ud)->append(static_cast<const char *>(p), size);
+		return 0;
+	}, &bytecode);
+
+	std::vector<uint32_t> lines;
+	if (moon && push_line_tables(L)) {
+		lua_getfield(L, -1, filename.c_str());
+		if (lua_istable(L, -1)) {
+			lua_for_each(L, [&] {
+				if (lua_type(L, -2) == LUA_TNUMBER && lua_type(L, -1) == LUA_TNUMBER) {
+					lines.push_back(static_cast<uint32_t>(lua_tointeger(L, -2)));
+					lines.push_back(static_cast<uint32_t>(lua_tointeger(L, -1)));
+				}
+			});
+		}
+		else
+			lua_pop(L, 1);
+		lua_pop(L, 1);
+	}
+
+	memcpy(header.magic, bytecode_magic, sizeof bytecode_magic);
+	header.version = bytecode_version;
+	header.line_count = static_cast<uint32_t>(lines.size() / 2);
+	header.path_length = static_cast<uint32_t>(filename.size());
+
+	try {
+		fs::CreateDirectory(path.parent_path());
+		io::Save out(path, true);
+		out.Get().write(reinterpret_cast<const char *>(&header), sizeof header);
+		if (!lines.empty())
+			out.Get().write(reinterpret_cast<const char *>(&lines[0]), lines.size() * sizeof(uint32_t));
+		out.Get().write(filename.data(), filename.size());
+		out.Get().write(bytecode.data(), bytecode.size());
+	}
+	catch (agi::Exception const& e) {
+		// Not being able to write the cache just means compiling again next time
+		LOG_D("auto4/lua") << "Error writing bytecode cache: " << e.GetMessage();
+	}
+}
+}
+
 namespace agi { namespace lua {
+	void SetBytecodeCache(lua_State *L, agi::fs::path const& dir) {
+		push_value(L, dir);
+		lua_setfield(L, LUA_REGISTRYINDEX, cache_dir_key);
+	}
+
 	bool LoadFile(lua_State *L, agi::fs::path const& raw_filename) {
 		auto filename = raw_filename;
 		try {
@@ -44,31 +201,53 @@ namespace agi { namespace lua {
 			size -= 3;
 		}
 
-		if (!agi::fs::HasExtension(filename, "moon"))
-			return luaL_loadbuffer(L, buff, size, filename.string().c_str()) == 0;
-
-		// We have a MoonScript file, so we need to load it with that
-		// It might be nice to have a dedicated lua state for compiling
-		// MoonScript to Lua
-		lua_getfield(L, LUA_REGISTRYINDEX, "moonscript");
+		bool moon = agi::fs::HasExtension(filename, "moon");
+		auto chunkname = filename.string();
 
 		// Save the text we'll be loading for the line number rewriting in the
 		// error handling
-		lua_pushlstring(L, buff, size);
-		lua_pushvalue(L, -1);
-		lua_setfield(L, LUA_REGISTRYINDEX, ("raw moonscript: " + filename.string()).c_str());
+		if (moon) {
+			lua_pushlstring(L, buff, size);
+			lua_setfield(L, LUA_REGISTRYINDEX, ("raw moonscript: " + chunkname).c_str());
+		}
+
+		// Compiled scripts are cached by path, and are used only if the
+		// script hasn't been modified since
+		bytecode_header header{};
+		auto cache = cache_path(L, chunkname);
+		if (!cache.empty()) {
+			header.source_size = size;
+			header.source_hash = hash_bytes(buff, size);
+			header.source_modified = static_cast<int64_t>(agi::fs::ModifiedTime(filename));
+			if (load_cached(L, cache, chunkname, header))
+				return true;
+		}
 
-		push_value(L, filename);
-		if (lua_pcall(L, 2, 2, 0))
-			return false; // Leaves error message on stack
+		if (!moon) {
+			if (luaL_loadbuffer(L, buff, size, chunkname.c_str()))
+				return false;
+		}
+		else {
+			// We have a MoonScript file, so we need to load it with that
+			// It might be nice to have a dedicated lua state for compiling
+			// MoonScript to Lua
+			lua_getfield(L, LUA_REGISTRYINDEX, "moonscript");
+			lua_pushlstring(L, buff, size);
+			push_value(L, chunkname);
+			if (lua_pcall(L, 2, 2, 0))
+				return false; // Leaves error message on stack
 
-		// loadstring returns nil, error on error or a function on success
-		if (lua_isnil(L, 1)) {
-			lua_remove(L, 1);
-			return false;
+			// loadstring returns nil, error on error or a function on success
+			if (lua_isnil(L, 1)) {
+				lua_remove(L, 1);
+				return false;
+			}
+
+			lua_pop(L, 1); // Remove the extra nil for the stackchecker
 		}
 
-		lua_pop(L, 1); // Remove the extra nil for the stackchecker
+		if (!cache.empty())
+			save_cached(L, cache, chunkname, header, moon);
 		return true;
 	}
 
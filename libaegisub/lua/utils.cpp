@@ -18,6 +18,7 @@
 
 #include "libaegisub/format.h"
 #include "libaegisub/log.h"
+#include "libaegisub/lua/profiler.h"
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -215,6 +216,7 @@ void argcheck(lua_State *L, bool cond, int narg, const char *msg) {
 
 int exception_wrapper(lua_State *L, int (*func)(lua_State *L)) {
 	try {
+		ProfileScope profile(L);
 		return func(L);
 	}
 	catch (agi::Exception const& e) {
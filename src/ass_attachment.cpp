@@ -21,17 +21,54 @@
 #include <libaegisub/io.h>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <mutex>
+
+struct AssAttachment::DecodedData {
+	std::once_flag once;
+	bool filled = false;
+	std::vector<char> data;
+
+	template<typename Func>
+	void Fill(Func&& func) {
+		std::call_once(once, [&] { func(data); filled = true; });
+	}
+};
 
 // Out-of-line to anchor vtable
 AssEntryGroup AssAttachment::Group() const { return group; }
 
 AssAttachment::AssAttachment(std::string const& header, AssEntryGroup group)
 : entry_data(header + "\r\n")
+, decoded(std::make_shared<DecodedData>())
 , filename(header.substr(10))
 , group(group)
 {
 }
 
+void AssAttachment::AddData(std::string const& data) {
+	pending_data += data;
+	pending_data += "\r\n";
+	if (decoded->filled || decoded.use_count() != 1)
+		decoded = std::make_shared<DecodedData>();
+}
+
+void AssAttachment::FlushData() const {
+	if (pending_data.empty()) return;
+	entry_data = entry_data.get() + pending_data;
+	pending_data.clear();
+	pending_data.shrink_to_fit();
+}
+
+std::vector<char> const& AssAttachment::GetData() const {
+	FlushData();
+	decoded->Fill([&](std::vector<char>& out) {
+		auto const& data = entry_data.get();
+		auto header_end = data.find('\n');
+		out = agi::ass::UUDecode(data.c_str() + header_end + 1, data.c_str() + data.size());
+	});
+	return decoded->data;
+}
+
 AssAttachment::AssAttachment(agi::fs::path const& name, AssEntryGroup group)
 : filename(name.filename().string())
 , group(group)
@@ -45,17 +82,21 @@ AssAttachment::AssAttachment(agi::fs::path const& name, AssEntryGroup group)
 	auto buff = file.read();
 	entry_data = (group == AssEntryGroup::FONT ? "fontname: " : "filename: ") + filename.get() + "\r\n";
 	entry_data = entry_data.get() + agi::ass::UUEncode(buff, buff + file.size());
+
+	// We already have the decoded form, so there's no need to decode it later
+	decoded = std::make_shared<DecodedData>();
+	decoded->Fill([&](std::vector<char>& out) { out.assign(buff, buff + file.size()); });
 }
 
 size_t AssAttachment::GetSize() const {
-	auto header_end = entry_data.get().find('\n');
-	return entry_data.get().size() - header_end - 1;
+	auto const& data = GetEntryData();
+	auto header_end = data.find('\n');
+	return data.size() - header_end - 1;
 }
 
 void AssAttachment::Extract(agi::fs::path const& filename) const {
-	auto header_end = entry_data.get().find('\n');
-	auto decoded = agi::ass::UUDecode(entry_data.get().c_str() + header_end + 1, &entry_data.get().back() + 1);
-	agi::io::Save(filename, true).Get().write(&decoded[0], decoded.size());
+	auto const& data = GetData();
+	agi::io::Save(filename, true).Get().write(data.data(), data.size());
 }
 
 std::string AssAttachment::GetFileName(bool raw) const {
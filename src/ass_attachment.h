@@ -19,11 +19,26 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <boost/flyweight.hpp>
+#include <memory>
+#include <vector>
 
 /// @class AssAttachment
 class AssAttachment final : public AssEntry {
-	/// ASS uuencoded entry data, including header.
-	boost::flyweight<std::string> entry_data;
+	/// ASS uuencoded entry data, including header. Only needed for saving;
+	/// everything which wants the file itself should use GetData().
+	mutable boost::flyweight<std::string> entry_data;
+
+	/// Data lines added since entry_data was last rebuilt, so that reading a
+	/// large attachment doesn't rebuild the flyweight for every line
+	mutable std::string pending_data;
+
+	/// Decoded contents, shared by all copies of this attachment and filled
+	/// in the first time anything asks for them
+	struct DecodedData;
+	std::shared_ptr<DecodedData> decoded;
+
+	/// Fold any pending data lines into entry_data
+	void FlushData() const;
 
 	/// Name of the attached file, with SSA font mangling if it is a ttf
 	boost::flyweight<std::string> filename;
@@ -35,7 +50,10 @@ public:
 	size_t GetSize() const;
 
 	/// Add a line of data (without newline) read from a subtitle file
-	void AddData(std::string const& data) { entry_data = entry_data.get() + data + "\r\n"; }
+	void AddData(std::string const& data);
+
+	/// Get the contents of the attached file, decoding them on first use
+	std::vector<char> const& GetData() const;
 
 	/// Extract the contents of this attachment to a file
 	/// @param filename Path to save the attachment to
@@ -45,7 +63,7 @@ public:
 	/// @param raw If false, remove the SSA filename mangling
 	std::string GetFileName(bool raw=false) const;
 
-	std::string const& GetEntryData() const { return entry_data; }
+	std::string const& GetEntryData() const { FlushData(); return entry_data; }
 	AssEntryGroup Group() const override;
 
 	AssAttachment(AssAttachment const& rgt) = default;
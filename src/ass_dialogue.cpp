@@ -35,7 +35,6 @@
 #include "subtitle_format.h"
 #include "utils.h"
 
-#include <libaegisub/of_type_adaptor.h>
 #include <libaegisub/split.h>
 #include <libaegisub/make_unique.h>
 
@@ -43,13 +42,15 @@
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/range/adaptor/transformed.hpp>
 #include <boost/regex.hpp>
-#include <boost/spirit/include/karma_generate.hpp>
-#include <boost/spirit/include/karma_int.hpp>
+#include <algorithm>
+#include <atomic>
 
 using namespace boost::adaptors;
 
-static int next_id = 0;
+// Lines may be constructed on several threads at once when loading a file
+static std::atomic<int> next_id{0};
 
 AssDialogue::AssDialogue() {
 	Id = ++next_id;
@@ -58,6 +59,10 @@ AssDialogue::AssDialogue() {
 AssDialogue::AssDialogue(AssDialogue const& that)
 : AssDialogueBase(that)
 , AssEntryListHook(that)
+, parsed_text(that.parsed_text)
+, parsed_blocks(that.parsed_blocks)
+, entry_fields(that.entry_fields)
+, entry_data(that.entry_data)
 {
 	Id = ++next_id;
 }
@@ -146,33 +151,48 @@ void AssDialogue::Parse(std::string const& raw) {
 	Text = text;
 }
 
+static void append_uint(std::string &str, unsigned int v) {
+	char buf[10];
+	char *end = buf + sizeof buf, *pos = end;
+	do {
+		*--pos = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	str.append(pos, end);
+}
+
 static void append_int(std::string &str, int v) {
-	boost::spirit::karma::generate(back_inserter(str), boost::spirit::karma::int_, v);
+	if (v < 0) {
+		str += '-';
+		append_uint(str, 0u - static_cast<unsigned int>(v));
+	}
+	else
+		append_uint(str, v);
 	str += ',';
 }
 
-static void append_str(std::string &out, std::string const& str) {
-	out += str;
-	out += ',';
+static void append_time(std::string &str, agi::Time time) {
+	time.AppendAssFormatted(str);
+	str += ',';
 }
 
 static void append_unsafe_str(std::string &out, std::string const& str) {
-	for (auto c : str) {
-		if (c == ',')
-			out += ';';
-		else
-			out += c;
-	}
+	size_t start = out.size();
+	out += str;
+	std::replace(out.begin() + start, out.end(), ',', ';');
 	out += ',';
 }
 
-std::string AssDialogue::GetEntryData() const {
-	std::string str = Comment ? "Comment: " : "Dialogue: ";
-	str.reserve(51 + Style.get().size() + Actor.get().size() + Effect.get().size() + Text.get().size());
+void AssDialogueBase::AppendEntryData(std::string &str) const {
+	// Buffers being appended to grow on their own, and reserving exactly
+	// the space for each line would defeat that
+	if (str.empty())
+		str.reserve(51 + Style.get().size() + Actor.get().size() + Effect.get().size() + Text.get().size());
+	str += Comment ? "Comment: " : "Dialogue: ";
 
 	append_int(str, Layer);
-	append_str(str, Start.GetAssFormatted());
-	append_str(str, End.GetAssFormatted());
+	append_time(str, Start);
+	append_time(str, End);
 	append_unsafe_str(str, Style);
 	append_unsafe_str(str, Actor);
 	for (auto margin : Margin)
@@ -183,17 +203,50 @@ std::string AssDialogue::GetEntryData() const {
 		str += '{';
 		for (auto id : ExtradataIds.get()) {
 			str += '=';
-			boost::spirit::karma::generate(back_inserter(str), boost::spirit::karma::int_, id);
+			append_uint(str, id);
 		}
 		str += '}';
 	}
 
-	for (auto c : Text.get()) {
-		if (c != '\n' && c != '\r')
-			str += c;
+	// Line breaks can't be in the middle of a line, so copy the runs of text
+	// between them
+	auto const& text = Text.get();
+	for (size_t pos = 0; pos < text.size(); ) {
+		size_t brk = text.find_first_of("\r\n", pos);
+		if (brk == std::string::npos) brk = text.size();
+		str.append(text, pos, brk - pos);
+		pos = brk + 1;
 	}
+}
+
+/// Would a and b serialize to the same line?
+///
+/// The flyweights compare by identity, so this is a handful of integer
+/// comparisons no matter how long the line is.
+static bool same_entry(AssDialogueBase const& a, AssDialogueBase const& b) {
+	return a.Comment == b.Comment
+		&& a.Layer == b.Layer
+		&& a.Margin == b.Margin
+		&& (int)a.Start == (int)b.Start
+		&& (int)a.End == (int)b.End
+		&& a.Style == b.Style
+		&& a.Actor == b.Actor
+		&& a.Effect == b.Effect
+		&& a.ExtradataIds == b.ExtradataIds
+		&& a.Text == b.Text;
+}
 
-	return str;
+std::string const& AssDialogue::GetEntryData() const {
+	if (entry_data && same_entry(*this, entry_fields))
+		return *entry_data;
+
+	// Copies of this line may still be holding on to the old string, so
+	// replace it rather than reusing it
+	auto str = std::make_shared<std::string>();
+	AppendEntryData(*str);
+	entry_fields = *this;
+	entry_data = std::move(str);
+	return *entry_data;
 }
 
 std::vector<std::unique_ptr<AssDialogueBlock>> AssDialogue::ParseTags() const {
@@ -207,6 +260,8 @@ std::vector<std::unique_ptr<AssDialogueBlock>> AssDialogue::ParseTags() const {
 
 	int drawingLevel = 0;
 	std::string const& text(Text.get());
+	// Each override block is usually followed by a plain text block
+	Blocks.reserve(std::count(text.begin(), text.end(), '{') * 2 + 1);
 
 	for (size_t len = text.size(), cur = 0; cur < len; ) {
 		// Overrides block
@@ -230,12 +285,12 @@ std::vector<std::unique_ptr<AssDialogueBlock>> AssDialogue::ParseTags() const {
 			}
 			else {
 				// Create block
-				auto block = agi::make_unique<AssDialogueBlockOverride>(work);
+				auto block = agi::make_unique<AssDialogueBlockOverride>(std::move(work));
 				block->ParseTags();
 
 				// Look for \p in block
 				for (auto const& tag : block->Tags) {
-					if (tag.Name == "\\p")
+					if (tag.Id == AssTagId::P)
 						drawingLevel = tag.Params[0].Get<int>(0);
 				}
 				Blocks.push_back(std::move(block));
@@ -258,14 +313,30 @@ plain:
 		}
 
 		if (drawingLevel == 0)
-			Blocks.push_back(agi::make_unique<AssDialogueBlockPlain>(work));
+			Blocks.push_back(agi::make_unique<AssDialogueBlockPlain>(std::move(work)));
 		else
-			Blocks.push_back(agi::make_unique<AssDialogueBlockDrawing>(work, drawingLevel));
+			Blocks.push_back(agi::make_unique<AssDialogueBlockDrawing>(std::move(work), drawingLevel));
 	}
 
 	return Blocks;
 }
 
+std::shared_ptr<const AssDialogueBlockList> AssDialogue::ParsedTags() const {
+	// Flyweights compare by identity, so this is just a pointer comparison
+	if (parsed_blocks && parsed_text == Text)
+		return parsed_blocks;
+
+	auto blocks = ParseTags();
+	auto list = std::make_shared<AssDialogueBlockList>();
+	list->reserve(blocks.size());
+	for (auto& block : blocks)
+		list->emplace_back(std::move(block));
+
+	parsed_text = Text;
+	parsed_blocks = std::move(list);
+	return parsed_blocks;
+}
+
 void AssDialogue::StripTags() {
 	Text = GetStrippedText();
 }
@@ -281,8 +352,59 @@ bool AssDialogue::CollidesWith(const AssDialogue *target) const {
 	return ((Start < target->Start) ? (target->Start < End) : (Start < target->End));
 }
 
-static std::string get_text_p(AssDialogueBlock *d) { return d->GetText(); }
 std::string AssDialogue::GetStrippedText() const {
-	auto blocks = ParseTags();
-	return join(blocks | agi::of_type<AssDialogueBlockPlain>() | transformed(get_text_p), "");
+	std::string ret;
+	AppendStrippedText(ret);
+	return ret;
+}
+
+/// Get the drawing level set by one tag of an override block, if it's \p
+static void update_drawing_level(std::string const& text, size_t start, size_t end, int &level) {
+	// \pos and \pbo are the only other tags starting with \p
+	if (end - start < 2 || text.compare(start, 2, "\\p") != 0) return;
+	if (end - start >= 4 && (!text.compare(start, 4, "\\pos") || !text.compare(start, 4, "\\pbo"))) return;
+
+	AssOverrideTag tag(text.substr(start, end - start));
+	if (tag.Id == AssTagId::P)
+		level = tag.Params[0].Get<int>(0);
+}
+
+void AssDialogue::AppendStrippedText(std::string &out) const {
+	// This has to split the text up exactly as ParseTags and
+	// AssDialogueBlockOverride::ParseTags do
+	std::string const& text = Text.get();
+	int drawing_level = 0;
+	for (size_t len = text.size(), cur = 0; cur < len; ) {
+		if (text[cur] == '{') {
+			size_t end = text.find('}', cur);
+			// Unclosed blocks are plain text
+			if (end != std::string::npos) {
+				// Only \p matters, so the tags are found without parsing
+				// them. Comment blocks have no backslashes and so no tags.
+				int depth = 0;
+				size_t tag_start = cur + 1;
+				for (size_t i = cur + 2; i < end; ++i) {
+					if (depth > 0) {
+						if (text[i] == ')')
+							--depth;
+					}
+					else if (text[i] == '\\') {
+						update_drawing_level(text, tag_start, i, drawing_level);
+						tag_start = i;
+					}
+					else if (text[i] == '(')
+						++depth;
+				}
+				update_drawing_level(text, tag_start, end, drawing_level);
+
+				cur = end + 1;
+				continue;
+			}
+		}
+
+		size_t end = std::min(text.find('{', cur + 1), len);
+		if (drawing_level == 0)
+			out.append(text, cur, end - cur);
+		cur = end;
+	}
 }
@@ -31,9 +31,11 @@
 #include "ass_override.h"
 
 #include <libaegisub/ass/time.h>
+#include <libaegisub/flyweight.h>
 
 #include <array>
 #include <boost/flyweight.hpp>
+#include <memory>
 #include <vector>
 
 enum class AssBlockType {
@@ -72,14 +74,14 @@ public:
 	virtual ~AssDialogueBlock() = default;
 
 	virtual AssBlockType GetType() const = 0;
-	virtual std::string GetText() { return text; }
+	virtual std::string GetText() const { return text; }
 };
 
 class AssDialogueBlockPlain final : public AssDialogueBlock {
 public:
 	using AssDialogueBlock::text;
 	AssBlockType GetType() const override { return AssBlockType::PLAIN; }
-	AssDialogueBlockPlain(std::string const& text = std::string()) : AssDialogueBlock(text) { }
+	AssDialogueBlockPlain(std::string text = std::string()) : AssDialogueBlock(std::move(text)) { }
 };
 
 class AssDialogueBlockComment final : public AssDialogueBlock {
@@ -94,22 +96,22 @@ public:
 	int Scale;
 
 	AssBlockType GetType() const override { return AssBlockType::DRAWING; }
-	AssDialogueBlockDrawing(std::string const& text, int scale) : AssDialogueBlock(text), Scale(scale) { }
+	AssDialogueBlockDrawing(std::string text, int scale) : AssDialogueBlock(std::move(text)), Scale(scale) { }
 };
 
 class AssDialogueBlockOverride final : public AssDialogueBlock {
 public:
-	AssDialogueBlockOverride(std::string const& text = std::string()) : AssDialogueBlock(text) { }
+	AssDialogueBlockOverride(std::string text = std::string()) : AssDialogueBlock(std::move(text)) { }
 
 	std::vector<AssOverrideTag> Tags;
 
 	AssBlockType GetType() const override { return AssBlockType::OVERRIDE; }
-	std::string GetText() override;
+	std::string GetText() const override;
 	void ParseTags();
 	void AddTag(std::string const& tag);
 
 	/// Type of callback function passed to ProcessParameters
-	typedef void (*ProcessParametersCallback)(std::string const&, AssOverrideParameter *, void *);
+	typedef void (*ProcessParametersCallback)(AssTagId, AssOverrideParameter *, void *);
 	/// @brief Process parameters via callback
 	/// @param callback The callback function to call per tag parameter
 	/// @param userData User data to pass to callback function
@@ -135,18 +137,36 @@ struct AssDialogueBase {
 	/// Ending time
 	agi::Time End = 5000;
 	/// Style name
-	boost::flyweight<std::string> Style = boost::flyweight<std::string>("Default");
+	agi::StringFlyweight Style = agi::StringFlyweight("Default");
 	/// Actor name
-	boost::flyweight<std::string> Actor;
+	agi::StringFlyweight Actor;
 	/// Effect name
-	boost::flyweight<std::string> Effect;
+	agi::StringFlyweight Effect;
 	/// IDs of extradata entries for line
 	boost::flyweight<std::vector<uint32_t>> ExtradataIds;
 	/// Raw text data
-	boost::flyweight<std::string> Text;
+	agi::StringFlyweight Text;
+
+	/// Append the line as it appears in an ASS file, without a line break
+	///
+	/// Nothing is allocated when out already has room, so serializers which
+	/// reuse one buffer for every line don't allocate per line.
+	void AppendEntryData(std::string &out) const;
 };
 
+/// Parsed blocks of a line which must not be modified
+typedef std::vector<std::unique_ptr<const AssDialogueBlock>> AssDialogueBlockList;
+
 class AssDialogue final : public AssEntry, public AssDialogueBase, public AssEntryListHook {
+	/// Text which parsed_blocks was generated from
+	mutable agi::StringFlyweight parsed_text;
+	/// Cached result of ParsedTags, or nullptr if it hasn't been called yet
+	mutable std::shared_ptr<const AssDialogueBlockList> parsed_blocks;
+	/// Fields which entry_data was generated from
+	mutable AssDialogueBase entry_fields;
+	/// Cached result of GetEntryData, or nullptr if it hasn't been called yet
+	mutable std::shared_ptr<const std::string> entry_data;
+
 	/// @brief Parse raw ASS data into everything else
 	/// @param data ASS line
 	void Parse(std::string const& data);
@@ -156,15 +176,31 @@ public:
 	/// Parse text as ASS and return block information
 	std::vector<std::unique_ptr<AssDialogueBlock>> ParseTags() const;
 
+	/// Get the parsed blocks of the text, reusing the previous parse if the
+	/// text hasn't changed since then
+	///
+	/// The result is shared with every other caller, so to change the line
+	/// use ParseTags() and UpdateText() instead.
+	std::shared_ptr<const AssDialogueBlockList> ParsedTags() const;
+
 	/// Strip all ASS tags from the text
 	void StripTags();
 	/// Strip a specific ASS tag from the text
 	/// Get text without tags
 	std::string GetStrippedText() const;
+	/// Append the text without tags, comments or drawings to out
+	///
+	/// This gives the same text as GetStrippedText(), but scans the line
+	/// rather than parsing it into blocks. out isn't cleared first, so the
+	/// same buffer can be reused for many lines.
+	void AppendStrippedText(std::string &out) const;
 
 	/// Update the text of the line from parsed blocks
 	void UpdateText(std::vector<std::unique_ptr<AssDialogueBlock>>& blocks);
-	std::string GetEntryData() const;
+
+	/// Get the line as it appears in an ASS file, reusing the previous
+	/// serialization if no field has changed since then
+	std::string const& GetEntryData() const;
 
 	/// Does this line collide with the passed line?
 	bool CollidesWith(const AssDialogue *target) const;
@@ -38,6 +38,7 @@
 #include <memory>
 #include <string>
 
+class AssDialogue;
 class AssFile;
 class AssExportFilterChain;
 class wxWindow;
@@ -71,6 +72,23 @@ public:
 	///                      to open a progress dialog
 	virtual void ProcessSubs(AssFile *subs, wxWindow *parent_window=nullptr)=0;
 
+	/// Prepare to process subtitles one line at a time with ProcessLine
+	/// @param subs Subtitles which are about to be processed
+	/// @return Does this filter support processing single lines?
+	///
+	/// Filters which only ever look at or modify one line at a time can
+	/// implement this and ProcessLine so that the exporter can run several
+	/// of them in a single pass over the lines rather than one pass each.
+	/// Such filters must produce the same results as ProcessSubs, and must not
+	/// modify anything other than the line passed to ProcessLine. When
+	/// grouped with other such filters this is called before any of them have
+	/// processed the lines, so it should only look at the rest of the file.
+	virtual bool BeginLines(AssFile *subs) { return false; }
+
+	/// Process a single line, after BeginLines has returned true
+	/// @param line Line to process
+	virtual void ProcessLine(AssDialogue *line) { }
+
 	/// Draw setup controls
 	/// @param parent Parent window to add controls to
 	/// @param c Project context
@@ -34,6 +34,8 @@
 
 #include "ass_exporter.h"
 
+#include "ass_attachment.h"
+#include "ass_dialogue.h"
 #include "ass_export_filter.h"
 #include "ass_file.h"
 #include "compat.h"
@@ -41,7 +43,14 @@
 #include "project.h"
 #include "subtitle_format.h"
 
+#include <libaegisub/dispatch.h>
+#include <libaegisub/make_unique.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <wx/sizer.h>
 
 AssExporter::AssExporter(agi::Context *c) : c(c) { }
@@ -79,19 +88,110 @@ std::vector<std::string> AssExporter::GetAllFilterNames() const {
 	return names;
 }
 
-void AssExporter::Export(agi::fs::path const& filename, std::string const& charset, wxWindow *export_dialog) {
-	AssFile subs(*c->ass);
+std::unique_ptr<AssFile> AssExporter::RunFilters(wxWindow *export_dialog) {
+	auto subs = agi::make_unique<AssFile>(*c->ass);
 
-	for (auto filter : filters) {
+	for (auto filter : filters)
 		filter->LoadSettings(is_default, c);
-		filter->ProcessSubs(&subs, export_dialog);
+
+	for (size_t i = 0; i < filters.size(); ) {
+		// Run consecutive filters which can work a line at a time in a single
+		// pass over the lines
+		size_t end = i;
+		while (end < filters.size() && filters[end]->BeginLines(subs.get()))
+			++end;
+
+		// A lone filter may well have a faster whole-file version
+		if (end - i < 2) {
+			filters[i]->ProcessSubs(subs.get(), export_dialog);
+			i = std::max(end, i + 1);
+			continue;
+		}
+
+		for (auto& line : subs->Events) {
+			for (size_t j = i; j < end; ++j)
+				filters[j]->ProcessLine(&line);
+		}
+		i = end;
 	}
 
-	const SubtitleFormat *writer = SubtitleFormat::GetWriter(filename);
-	if (!writer)
-		throw agi::InvalidInputException("Unknown file type.");
+	return subs;
+}
+
+void AssExporter::Export(agi::fs::path const& filename, std::string const& charset, wxWindow *export_dialog) {
+	Export(std::vector<agi::fs::path>{filename}, charset, export_dialog);
+}
+
+void AssExporter::Export(std::vector<agi::fs::path> const& filenames, std::string const& charset, wxWindow *export_dialog) {
+	std::vector<const SubtitleFormat *> writers;
+	for (auto const& filename : filenames) {
+		const SubtitleFormat *writer = SubtitleFormat::GetWriter(filename);
+		if (!writer)
+			throw agi::InvalidInputException("Unknown file type.");
+		writers.push_back(writer);
+	}
+
+	// With nothing to change the file can be written out as-is
+	std::unique_ptr<AssFile> filtered;
+	const AssFile *subs = c->ass.get();
+	if (!filters.empty()) {
+		filtered = RunFilters(export_dialog);
+		subs = filtered.get();
+	}
 
-	writer->ExportFile(&subs, filename, c->project->Timecodes(), charset);
+	auto const& fps = c->project->Timecodes();
+	if (writers.size() == 1) {
+		writers[0]->ExportFile(subs, filenames[0], fps, charset);
+		return;
+	}
+
+	// Fill in everything which is computed lazily so that the writers only
+	// ever read from the shared file. The parsed lines are then shared by
+	// all of the writers' copies rather than each writer reparsing them.
+	for (auto const& line : subs->Events)
+		line.ParsedTags();
+	for (auto const& attachment : subs->Attachments)
+		attachment.GetEntryData();
+
+	std::vector<std::exception_ptr> errors(writers.size());
+	std::mutex mutex;
+	std::condition_variable done;
+	size_t pending = 0;
+
+	auto write = [&](size_t i) {
+		try {
+			writers[i]->ExportFile(subs, filenames[i], fps, charset);
+		}
+		catch (...) {
+			errors[i] = std::current_exception();
+		}
+	};
+
+	for (size_t i = 0; i < writers.size(); ++i) {
+		if (writers[i]->NeedsUserInput()) continue;
+		++pending;
+		agi::dispatch::Background().Async([&, i] {
+			write(i);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--pending == 0)
+				done.notify_one();
+		});
+	}
+
+	// Formats which show dialogs have to be written from this thread
+	for (size_t i = 0; i < writers.size(); ++i) {
+		if (writers[i]->NeedsUserInput())
+			write(i);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&] { return pending == 0; });
+	}
+
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
 }
 
 wxSizer *AssExporter::GetSettingsSizer(std::string const& name) {
@@ -35,10 +35,12 @@
 #include <libaegisub/fs_fwd.h>
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 class AssExportFilter;
+class AssFile;
 namespace agi { struct Context; }
 class wxSizer;
 class wxWindow;
@@ -59,6 +61,9 @@ class AssExporter {
 	/// their default settings
 	bool is_default = true;
 
+	/// Copy the subtitles and run the selected filters over the copy
+	std::unique_ptr<AssFile> RunFilters(wxWindow *parent_window);
+
 public:
 	AssExporter(agi::Context *c);
 
@@ -75,6 +80,15 @@ public:
 	/// @param parent_window Parent window the filters should use when opening dialogs
 	void Export(agi::fs::path const& file, std::string const& charset, wxWindow *parent_window= nullptr);
 
+	/// Apply selected export filters once and save to each of several files
+	/// @param files Target filenames; the format of each is picked from its extension
+	/// @param charset Target charset
+	/// @param parent_window Parent window the filters should use when opening dialogs
+	///
+	/// Formats which don't need to ask the user anything are written
+	/// concurrently in the background.
+	void Export(std::vector<agi::fs::path> const& files, std::string const& charset, wxWindow *parent_window= nullptr);
+
 	/// Add configuration panels for all registered filters to the target sizer
 	/// @param parent Parent window for controls
 	/// @param target_sizer Sizer to add configuration panels to
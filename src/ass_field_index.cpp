@@ -0,0 +1,77 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "ass_field_index.h"
+
+#include "ass_dialogue.h"
+
+#include <algorithm>
+
+namespace {
+bool row_less(const AssDialogue *a, const AssDialogue *b) {
+	return a->Row < b->Row;
+}
+}
+
+agi::StringFlyweight const& AssFieldIndex::Get(AssDialogue const& line, IndexedField field) {
+	switch (field) {
+		case IndexedField::ACTOR: return line.Actor;
+		case IndexedField::EFFECT: return line.Effect;
+		default: return line.Style;
+	}
+}
+
+void AssFieldIndex::Add(AssDialogue *line) {
+	auto const& value = Get(*line, field);
+	auto& group = groups[&value.get()];
+	if (group.lines.empty())
+		group.value = value;
+	group.lines.push_back(line);
+	line_keys[line] = &value.get();
+}
+
+const std::vector<AssDialogue *> *AssFieldIndex::Find(std::string const& value) const {
+	// Any line with this value shares the string, so making a flyweight of
+	// it finds the key without comparing strings
+	agi::StringFlyweight key(value);
+	auto it = groups.find(&key.get());
+	return it == groups.end() ? nullptr : &it->second.lines;
+}
+
+bool AssFieldIndex::Update(AssDialogue *line) {
+	auto key = line_keys.find(line);
+	if (key == line_keys.end()) return false;
+
+	auto const& value = Get(*line, field);
+	if (key->second == &value.get()) return true;
+
+	// Groups are in file order, so the line can be found and placed by its row
+	auto old_group = groups.find(key->second);
+	auto& old_lines = old_group->second.lines;
+	auto it = std::lower_bound(old_lines.begin(), old_lines.end(), line, row_less);
+	if (it == old_lines.end() || *it != line) return false;
+	old_lines.erase(it);
+	if (old_lines.empty())
+		groups.erase(old_group);
+
+	auto& group = groups[&value.get()];
+	if (group.lines.empty())
+		group.value = value;
+	group.lines.insert(std::upper_bound(group.lines.begin(), group.lines.end(), line, row_less), line);
+	key->second = &value.get();
+	return true;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <libaegisub/flyweight.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AssDialogue;
+
+/// Dialogue fields which AssFieldIndex can index
+enum class IndexedField {
+	STYLE = 0,
+	ACTOR,
+	EFFECT
+};
+
+/// Lines grouped by the value of one of their flyweight fields
+class AssFieldIndex {
+public:
+	struct Group {
+		/// The value, held so that its address stays valid as a key
+		agi::StringFlyweight value;
+		/// Lines with this value, in file order
+		std::vector<AssDialogue *> lines;
+	};
+	/// Groups keyed by the address of their flyweight's string
+	typedef std::unordered_map<const std::string *, Group> GroupMap;
+
+private:
+	IndexedField field;
+	GroupMap groups;
+	/// The key of the group each line is in
+	std::unordered_map<const AssDialogue *, const std::string *> line_keys;
+
+	void Add(AssDialogue *line);
+
+public:
+	static agi::StringFlyweight const& Get(AssDialogue const& line, IndexedField field);
+
+	/// Index the lines in the range, which must be in file order
+	template<typename Range>
+	AssFieldIndex(Range& lines, IndexedField field) : field(field) {
+		for (auto& line : lines)
+			Add(&line);
+	}
+
+	IndexedField Field() const { return field; }
+	GroupMap const& Groups() const { return groups; }
+
+	/// Get the lines whose field is exactly value, or nullptr if there are none
+	const std::vector<AssDialogue *> *Find(std::string const& value) const;
+
+	/// Move a line to the right group after its field changed, with the
+	/// file's lines still in the same order
+	/// @return false if the line isn't in the index
+	bool Update(AssDialogue *line);
+};
@@ -18,16 +18,23 @@
 
 #include "ass_attachment.h"
 #include "ass_dialogue.h"
+#include "ass_field_index.h"
 #include "ass_info.h"
+#include "ass_overlaps.h"
 #include "ass_style.h"
 #include "ass_style_storage.h"
+#include "ass_time_index.h"
 #include "options.h"
 
+#include <libaegisub/make_unique.h>
+
 #include <algorithm>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem/path.hpp>
 #include <cassert>
+#include <functional>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -85,6 +92,10 @@ void AssFile::swap(AssFile& from) throw() {
 	Extradata.swap(from.Extradata);
 	std::swap(Properties, from.Properties);
 	std::swap(next_extradata_id, from.next_extradata_id);
+	time_index.swap(from.time_index);
+	overlaps.swap(from.overlaps);
+	field_indexes.swap(from.field_indexes);
+	style_index.swap(from.style_index);
 }
 
 AssFile& AssFile::operator=(AssFile from) {
@@ -92,6 +103,58 @@ AssFile& AssFile::operator=(AssFile from) {
 	return *this;
 }
 
+std::vector<const AssDialogue *> AssFile::EventsOverlapping(int start, int end) const {
+	if (!time_index)
+		time_index = agi::make_unique<AssTimeIndex>(Events);
+	return time_index->Overlapping(start, end);
+}
+
+void AssFile::EventsChanged(const AssDialogue *old_line, const AssDialogue *new_line) {
+	if (time_index && (!old_line || !time_index->Replace(old_line, new_line)))
+		time_index.reset();
+	if (old_line)
+		OverlapsChanged({{old_line, new_line}});
+	else
+		OverlapsChanged({});
+}
+
+bool AssFile::IsOverlapping(const AssDialogue *line, OverlapGroup group) const {
+	if (!overlaps || overlaps->Group() != group)
+		overlaps = agi::make_unique<AssOverlaps>(*this, group);
+	return overlaps->Contains(line);
+}
+
+AssFieldIndex const& AssFile::FieldIndex(IndexedField field) {
+	auto& index = field_indexes[static_cast<size_t>(field)];
+	if (!index)
+		index = agi::make_unique<AssFieldIndex>(Events, field);
+	return *index;
+}
+
+std::vector<AssDialogue *> AssFile::EventsWithField(IndexedField field, std::string const& value) {
+	auto lines = FieldIndex(field).Find(value);
+	return lines ? *lines : std::vector<AssDialogue *>();
+}
+
+void AssFile::FieldsChanged(std::vector<AssDialogue *> const& lines) {
+	for (auto& index : field_indexes) {
+		if (lines.empty())
+			index.reset();
+		for (size_t i = 0; index && i < lines.size(); ++i) {
+			if (!index->Update(lines[i]))
+				index.reset();
+		}
+	}
+}
+
+void AssFile::OverlapsChanged(std::vector<std::pair<const AssDialogue *, const AssDialogue *>> const& lines) {
+	if (!overlaps) return;
+	if (lines.empty())
+		overlaps.reset();
+	else
+		overlaps->Replace(*this, lines);
+}
+
 EntryList<AssDialogue>::iterator AssFile::iterator_to(AssDialogue& line) {
 	using l = EntryList<AssDialogue>;
 	bool in_list = !l::node_algorithms::inited(l::value_traits::to_node_ptr(line));
@@ -161,9 +224,19 @@ std::vector<std::string> AssFile::GetStyles() const {
 }
 
 AssStyle *AssFile::GetStyle(std::string const& name) {
+	auto it = style_index.find(boost::to_lower_copy(name));
+	if (it != style_index.end() && boost::iequals(it->second->name, name))
+		return it->second;
+
 	for (auto& style : Styles) {
-		if (boost::iequals(style.name, name))
+		if (boost::iequals(style.name, name)) {
+			// Found a style the index doesn't know about, so it is out of
+			// date; a name which just isn't there leaves it alone
+			style_index.clear();
+			for (auto& s : Styles)
+				style_index.emplace(boost::to_lower_copy(s.name), &s);
 			return &style;
+		}
 	}
 	return nullptr;
 }
@@ -173,11 +246,80 @@ int AssFile::Commit(wxString const& desc, int type, int amend_id, AssDialogue *s
 		int i = 0;
 		for (auto& event : Events)
 			event.Row = i++;
+		EventsChanged();
+		FieldsChanged({});
+	}
+	else {
+		if (type & COMMIT_DIAG_TIME)
+			EventsChanged(single_line, single_line);
+		else if ((type & COMMIT_DIAG_META) && single_line)
+			OverlapsChanged({{single_line, single_line}});
+		else if (type & COMMIT_DIAG_META)
+			OverlapsChanged({});
+
+		if (type & COMMIT_DIAG_META) {
+			if (single_line)
+				FieldsChanged({single_line});
+			else
+				FieldsChanged({});
+		}
+	}
+	if (type == COMMIT_NEW || (type & COMMIT_STYLES))
+		StylesChanged();
+
+	PushState({desc, &amend_id, single_line, type, nullptr});
+
+	AssCommitChanges changes;
+	if (single_line) {
+		changes.known = true;
+		changes.lines.push_back(single_line);
+	}
+	AnnounceCommit(type, single_line, changes);
+
+	return amend_id;
+}
+
+int AssFile::Commit(wxString const& desc, int type, std::vector<AssDialogue *> const& lines, int amend_id) {
+	assert(!(type & ~COMMIT_DIAG_FULL));
+	if (lines.size() == 1)
+		return Commit(desc, type, amend_id, lines[0]);
+
+	// Moving each entry costs a scan of the index, so past a handful it's
+	// cheaper to rebuild it on the next query
+	const size_t max_index_updates = 8;
+	if (type & COMMIT_DIAG_TIME) {
+		if (lines.size() > max_index_updates)
+			time_index.reset();
+		for (size_t i = 0; time_index && i < lines.size(); ++i) {
+			if (!time_index->Replace(lines[i], lines[i]))
+				time_index.reset();
+		}
+	}
+
+	if (type & COMMIT_DIAG_META) {
+		if (lines.size() > max_index_updates)
+			FieldsChanged({});
+		else
+			FieldsChanged(lines);
 	}
 
-	PushState({desc, &amend_id, single_line});
+	// The overlaps are updated only once the index is, and all at once, as
+	// each update looks at the lines near every changed line
+	if (type & (COMMIT_DIAG_TIME | COMMIT_DIAG_META)) {
+		std::vector<std::pair<const AssDialogue *, const AssDialogue *>> changed;
+		if (lines.size() <= max_index_updates) {
+			for (auto line : lines)
+				changed.emplace_back(line, line);
+		}
+		OverlapsChanged(changed);
+	}
 
-	AnnounceCommit(type, single_line);
+	PushState({desc, &amend_id, nullptr, type, &lines});
+
+	AssCommitChanges changes;
+	changes.known = true;
+	changes.lines.assign(lines.begin(), lines.end());
+	AnnounceCommit(type, nullptr, changes);
 
 	return amend_id;
 }
@@ -201,13 +343,120 @@ bool AssFile::CompLayer(AssDialogue const& lft, AssDialogue const& rgt) {
 	return lft.Layer < rgt.Layer;
 }
 
-void AssFile::Sort(CompFunc comp, std::set<AssDialogue*> const& limit) {
+namespace {
+/// Lines per thread below which sorting isn't worth splitting up
+const size_t min_lines_per_thread = 16384;
+
+/// Rank each distinct value of a flyweight field by string order
+template<typename Field>
+std::vector<int> rank_strings(std::vector<AssDialogue *> const& lines, Field field) {
+	// Flyweights share one string per distinct value, so the address is a
+	// cheap stand-in for the value until the distinct values are sorted
+	std::unordered_map<const std::string *, int> ranks;
+	for (auto line : lines)
+		ranks.emplace(&field(*line).get(), 0);
+
+	std::vector<const std::string *> values;
+	values.reserve(ranks.size());
+	for (auto const& rank : ranks)
+		values.push_back(rank.first);
+	std::sort(begin(values), end(values), [](const std::string *a, const std::string *b) { return *a < *b; });
+	for (size_t i = 0; i < values.size(); ++i)
+		ranks[values[i]] = (int)i;
+
+	std::vector<int> keys;
+	keys.reserve(lines.size());
+	for (auto line : lines)
+		keys.push_back(ranks[&field(*line).get()]);
+	return keys;
+}
+
+/// Extract the integer the comparison function orders lines by
+/// @return false if comp isn't one of the built-in comparisons
+bool extract_keys(AssFile::CompFunc comp, std::vector<AssDialogue *> const& lines, std::vector<int>& keys) {
+	if (comp == AssFile::CompStyle)
+		keys = rank_strings(lines, [](AssDialogue const& d) -> agi::StringFlyweight const& { return d.Style; });
+	else if (comp == AssFile::CompActor)
+		keys = rank_strings(lines, [](AssDialogue const& d) -> agi::StringFlyweight const& { return d.Actor; });
+	else if (comp == AssFile::CompEffect)
+		keys = rank_strings(lines, [](AssDialogue const& d) -> agi::StringFlyweight const& { return d.Effect; });
+	else if (comp == AssFile::CompStart || comp == AssFile::CompEnd || comp == AssFile::CompLayer) {
+		keys.reserve(lines.size());
+		for (auto line : lines)
+			keys.push_back(comp == AssFile::CompStart ? (int)line->Start
+			             : comp == AssFile::CompEnd ? (int)line->End
+			             : line->Layer);
+	}
+	else
+		return false;
+	return true;
+}
+
+/// Sort on the given number of threads, then merge pairs of runs in parallel
+void parallel_sort(std::vector<uint64_t>& keys, size_t threads) {
+	std::vector<size_t> bounds;
+	for (size_t t = 0; t <= threads; ++t)
+		bounds.push_back(keys.size() * t / threads);
+
+	auto run = [&](size_t count, std::function<void (size_t)> const& func) {
+		std::vector<std::thread> workers;
+		for (size_t t = 1; t < count; ++t)
+			workers.emplace_back(func, t);
+		func(0);
+		for (auto& worker : workers)
+			worker.join();
+	};
+
+	run(threads, [&](size_t t) {
+		std::sort(keys.begin() + bounds[t], keys.begin() + bounds[t + 1]);
+	});
+
+	for (size_t width = 1; width < threads; width *= 2) {
+		run((threads + 2 * width - 1) / (2 * width), [&](size_t t) {
+			size_t first = t * 2 * width, middle = first + width, last = std::min(middle + width, threads);
+			if (middle < threads)
+				std::inplace_merge(keys.begin() + bounds[first], keys.begin() + bounds[middle], keys.begin() + bounds[last]);
+		});
+	}
+}
+
+/// Stably sort a detached run of lines and append them to lst before pos
+void sort_run(EntryList<AssDialogue> &lst, EntryList<AssDialogue>::iterator pos, EntryList<AssDialogue> &run, AssFile::CompFunc comp) {
+	std::vector<AssDialogue *> lines;
+	for (auto& line : run)
+		lines.push_back(&line);
+
+	std::vector<int> fields;
+	if (!extract_keys(comp, lines, fields)) {
+		run.sort(comp);
+		lst.splice(pos, run);
+		return;
+	}
+
+	// Pack the key above the original position so that every key is unique
+	// and an unstable sort gives the same order as a stable one
+	std::vector<uint64_t> keys(lines.size());
+	for (size_t i = 0; i < lines.size(); ++i)
+		keys[i] = (uint64_t(uint32_t(fields[i]) ^ 0x80000000u) << 32) | i;
+
+	size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), lines.size() / min_lines_per_thread));
+	parallel_sort(keys, threads);
+
+	run.clear();
+	for (auto key : keys)
+		lst.insert(pos, *lines[key & 0xFFFFFFFFu]);
+}
+}
+
+void AssFile::Sort(CompFunc comp, Selection const& limit) {
 	Sort(Events, comp, limit);
 }
 
-void AssFile::Sort(EntryList<AssDialogue> &lst, CompFunc comp, std::set<AssDialogue*> const& limit) {
+void AssFile::Sort(EntryList<AssDialogue> &lst, CompFunc comp, Selection const& limit) {
 	if (limit.empty()) {
-		lst.sort(comp);
+		EntryList<AssDialogue> tmp;
+		tmp.splice(tmp.begin(), lst);
+		sort_run(lst, lst.end(), tmp, comp);
 		return;
 	}
 
@@ -220,8 +469,7 @@ void AssFile::Sort(EntryList<AssDialogue> &lst, CompFunc comp, std::set<AssDialo
 		// sort doesn't support only sorting a sublist, so move them to a temp list
 		EntryList<AssDialogue> tmp;
 		tmp.splice(tmp.begin(), lst, begin, end);
-		tmp.sort(comp);
-		lst.splice(end, tmp);
+		sort_run(lst, end, tmp, comp);
 
 		begin = --end;
 	}
@@ -28,19 +28,28 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include "ass_entry.h"
+#include "selection.h"
 
 #include <libaegisub/fs_fwd.h>
 #include <libaegisub/signal.h>
 
+#include <array>
 #include <boost/intrusive/list.hpp>
 #include <map>
-#include <set>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class AssAttachment;
 class AssDialogue;
+class AssFieldIndex;
 class AssInfo;
+class AssOverlaps;
 class AssStyle;
+class AssTimeIndex;
+enum class IndexedField;
+enum class OverlapGroup;
 class wxString;
 
 template<typename T>
@@ -52,10 +61,23 @@ struct ExtradataEntry {
 	std::string value;
 };
 
+/// Which lines a commit changed, for listeners which can update just those
+struct AssCommitChanges {
+	/// Is lines a complete list? If not, any line may have changed
+	bool known = false;
+	/// Existing lines which were changed in the ways given by the commit type
+	std::vector<const AssDialogue *> lines;
+};
+
 struct AssFileCommit {
 	wxString const& message;
 	int *commit_id;
 	AssDialogue *single_line;
+	/// Bitmask of AssFile::CommitType values describing what changed
+	int type;
+	/// Every existing line which was changed, if they're known and there's
+	/// more than one
+	std::vector<AssDialogue *> const *lines;
 };
 
 struct ProjectProperties {
@@ -80,8 +102,29 @@ struct ProjectProperties {
 
 class AssFile {
 	/// A set of changes has been committed to the file (AssFile::COMMITType)
-	agi::signal::Signal<int, const AssDialogue*> AnnounceCommit;
+	agi::signal::Signal<int, const AssDialogue*, AssCommitChanges const&> AnnounceCommit;
 	agi::signal::Signal<AssFileCommit> PushState;
+	/// Anything holding back changes should commit them now
+	agi::signal::Signal<> AnnounceFlush;
+
+	/// Index of Events by time, built by the first query after it's dropped
+	mutable std::unique_ptr<AssTimeIndex> time_index;
+	/// Lines overlapping other lines, found by the first query after it's dropped
+	mutable std::unique_ptr<AssOverlaps> overlaps;
+	/// Index of Events by style, actor and effect, each built by the first
+	/// query for that field after it's dropped
+	std::array<std::unique_ptr<AssFieldIndex>, 3> field_indexes;
+	/// Styles by lowercased name; entries may be out of date, so each hit is
+	/// checked and a miss falls back to searching Styles
+	std::unordered_map<std::string, AssStyle *> style_index;
+
+	/// Tell the overlap index about lines whose times, style, layer or
+	/// comment flag changed, as pairs of the old line and the line now in
+	/// its place, or nothing if which lines changed isn't known
+	void OverlapsChanged(std::vector<std::pair<const AssDialogue *, const AssDialogue *>> const& lines);
+	/// Tell the field indexes about lines whose style, actor or effect
+	/// changed, or nothing if which lines changed isn't known
+	void FieldsChanged(std::vector<AssDialogue *> const& lines);
 public:
 	/// The lines in the file
 	std::vector<AssInfo> Info;
@@ -112,9 +155,35 @@ public:
 	/// @param name Style name
 	/// @return Pointer to style or nullptr
 	AssStyle *GetStyle(std::string const& name);
+	/// Tell the style index that styles were removed without committing
+	///
+	/// Commit does this itself for COMMIT_STYLES, and added or renamed styles
+	/// are picked up without it.
+	void StylesChanged() { style_index.clear(); }
 
 	void swap(AssFile &) throw();
 
+	/// Get the dialogue lines, including comments, whose times overlap
+	/// [start, end), in file order
+	std::vector<const AssDialogue *> EventsOverlapping(int start, int end) const;
+	/// Get the dialogue lines, including comments, which are active at time
+	std::vector<const AssDialogue *> EventsAt(int time) const { return EventsOverlapping(time, time + 1); }
+	/// Tell the time index about changes to Events which aren't being committed
+	/// @param old_line Line which was retimed or replaced by new_line, or
+	///                 nullptr if lines may have been added, removed or reordered
+	/// @param new_line Line now at old_line's position in the file
+	///
+	/// Commit does this itself.
+	void EventsChanged(const AssDialogue *old_line = nullptr, const AssDialogue *new_line = nullptr);
+	/// Does the line overlap another non-comment line in the same group?
+	/// Comments never overlap anything.
+	bool IsOverlapping(const AssDialogue *line, OverlapGroup group) const;
+	/// Get the index of Events by a field, which is kept up to date by commits
+	AssFieldIndex const& FieldIndex(IndexedField field);
+	/// Get the dialogue lines, including comments, whose field is exactly
+	/// value, in file order
+	std::vector<AssDialogue *> EventsWithField(IndexedField field, std::string const& value);
+
 	/// @brief Get the script resolution
 	/// @param[out] w Width
 	/// @param[in] h Height
@@ -170,6 +239,12 @@ public:
 
 	DEFINE_SIGNAL_ADDERS(AnnounceCommit, AddCommitListener)
 	DEFINE_SIGNAL_ADDERS(PushState, AddUndoManager)
+	DEFINE_SIGNAL_ADDERS(AnnounceFlush, AddFlushListener)
+
+	/// Have anything which has modified lines without committing yet (such
+	/// as the edit box while typing) commit now, so that whatever is about to
+	/// act on the file sees those changes as their own undo step
+	void FlushPendingCommits() { AnnounceFlush(); }
 
 	/// @brief Flag the file as modified and push a copy onto the undo stack
 	/// @param desc        Undo description
@@ -179,6 +254,15 @@ public:
 	/// @return Unique identifier for the new undo group
 	int Commit(wxString const& desc, int type, int commitId = -1, AssDialogue *single_line = nullptr);
 
+	/// @brief Commit changes to a known set of existing lines
+	/// @param desc        Undo description
+	/// @param type        Type of changes made to the lines; must not include
+	///                    anything other than COMMIT_DIAG_FULL
+	/// @param lines       Every line which was changed
+	/// @param commitId    Commit to amend rather than pushing a new commit
+	/// @return Unique identifier for the new undo group
+	int Commit(wxString const& desc, int type, std::vector<AssDialogue *> const& lines, int commitId = -1);
+
 	/// Comparison function for use when sorting
 	typedef bool (*CompFunc)(AssDialogue const& lft, AssDialogue const& rgt);
 
@@ -198,9 +282,9 @@ public:
 	/// @brief Sort the dialogue lines in this file
 	/// @param comp Comparison function to use. Defaults to sorting by start time.
 	/// @param limit If non-empty, only lines in this set are sorted
-	void Sort(CompFunc comp = CompStart, std::set<AssDialogue*> const& limit = std::set<AssDialogue*>());
+	void Sort(CompFunc comp = CompStart, Selection const& limit = Selection());
 	/// @brief Sort the dialogue lines in the given list
 	/// @param comp Comparison function to use. Defaults to sorting by start time.
 	/// @param limit If non-empty, only lines in this set are sorted
-	static void Sort(EntryList<AssDialogue>& lst, CompFunc comp = CompStart, std::set<AssDialogue*> const& limit = std::set<AssDialogue*>());
+	static void Sort(EntryList<AssDialogue>& lst, CompFunc comp = CompStart, Selection const& limit = Selection());
 };
@@ -26,6 +26,11 @@ public:
 
 	AssEntryGroup Group() const override { return AssEntryGroup::INFO; }
 	std::string GetEntryData() const { return key + ": " + value; }
+	void AppendEntryData(std::string &out) const {
+		out += key;
+		out += ": ";
+		out += value;
+	}
 
 	std::string Key() const { return key; }
 	std::string Value() const { return value; }
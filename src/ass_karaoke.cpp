@@ -20,7 +20,6 @@
 
 #include <libaegisub/format.h>
 
-#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
 std::string AssKaraoke::Syllable::GetText(bool k_tag) const {
@@ -88,7 +87,7 @@ void AssKaraoke::SetLine(const AssDialogue *line, bool auto_split, bool normaliz
 }
 
 void AssKaraoke::ParseSyllables(const AssDialogue *line, Syllable &syl) {
-	for (auto& block : line->ParseTags()) {
+	for (auto& block : *line->ParsedTags()) {
 		std::string text = block->GetText();
 
 		switch (block->GetType()) {
@@ -102,19 +101,17 @@ void AssKaraoke::ParseSyllables(const AssDialogue *line, Syllable &syl) {
 			syl.ovr_tags[syl.text.size()] += text;
 			break;
 		case AssBlockType::OVERRIDE:
-			auto ovr = static_cast<AssDialogueBlockOverride*>(block.get());
+			auto ovr = static_cast<const AssDialogueBlockOverride*>(block.get());
 			bool in_tag = false;
-			for (auto& tag : ovr->Tags) {
-				if (tag.IsValid() && boost::istarts_with(tag.Name, "\\k")) {
+			for (auto const& tag : ovr->Tags) {
+				bool karaoke_tag = tag.Id == AssTagId::K || tag.Id == AssTagId::K_UPPER
+					|| tag.Id == AssTagId::KF || tag.Id == AssTagId::KO;
+				if (karaoke_tag) {
 					if (in_tag) {
 						syl.ovr_tags[syl.text.size()] += "}";
 						in_tag = false;
 					}
 
-					// Dealing with both \K and \kf is mildly annoying so just
-					// convert them both to \kf
-					if (tag.Name == "\\K") tag.Name = "\\kf";
-
 					// Don't bother including zero duration zero length syls
 					if (syl.duration > 0 || !syl.text.empty()) {
 						syls.push_back(syl);
@@ -122,7 +119,9 @@ void AssKaraoke::ParseSyllables(const AssDialogue *line, Syllable &syl) {
 						syl.ovr_tags.clear();
 					}
 
-					syl.tag_type = tag.Name;
+					// Dealing with both \K and \kf is mildly annoying so just
+					// convert them both to \kf
+					syl.tag_type = tag.Id == AssTagId::K_UPPER ? "\\kf" : tag.Name;
 					syl.start_time += syl.duration;
 					syl.duration = tag.Params[0].Get(0) * 10;
 				}
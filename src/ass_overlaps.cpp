@@ -0,0 +1,125 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "ass_overlaps.h"
+
+#include "ass_dialogue.h"
+#include "ass_file.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <tuple>
+
+namespace {
+struct SweepEntry {
+	uintptr_t group;
+	int start;
+	int end;
+	const AssDialogue *line;
+
+	bool operator<(SweepEntry const& rgt) const {
+		return std::tie(group, start, end) < std::tie(rgt.group, rgt.start, rgt.end);
+	}
+};
+}
+
+AssOverlaps::AssOverlaps(AssFile const& file, OverlapGroup group)
+: group(group)
+{
+	std::vector<SweepEntry> entries;
+	for (auto const& line : file.Events) {
+		if (line.Comment) continue;
+		uintptr_t key = 0;
+		if (group == OverlapGroup::STYLE)
+			key = reinterpret_cast<uintptr_t>(&line.Style.get());
+		else if (group == OverlapGroup::LAYER)
+			key = static_cast<uintptr_t>(line.Layer);
+		entries.push_back(SweepEntry{key, (int)line.Start, (int)line.End, &line});
+	}
+	sort(begin(entries), end(entries));
+
+	// Within a group sorted by start and then end, a line overlaps one of the
+	// lines before it if it starts before the latest end seen so far, and one
+	// of the lines after it if the next one starts before it ends
+	for (size_t first = 0; first < entries.size(); ) {
+		size_t last = first + 1;
+		while (last < entries.size() && entries[last].group == entries[first].group)
+			++last;
+
+		int max_end = INT_MIN;
+		for (size_t i = first; i < last; ++i) {
+			auto const& e = entries[i];
+			if (e.start < max_end || (i + 1 < last && entries[i + 1].start < e.end))
+				lines[e.line] = Span{e.start, e.end};
+			max_end = std::max(max_end, e.end);
+		}
+		first = last;
+	}
+}
+
+bool AssOverlaps::SameGroup(const AssDialogue *a, const AssDialogue *b) const {
+	switch (group) {
+		case OverlapGroup::STYLE: return a->Style == b->Style;
+		case OverlapGroup::LAYER: return a->Layer == b->Layer;
+		default: return true;
+	}
+}
+
+void AssOverlaps::Check(AssFile const& file, const AssDialogue *line) {
+	lines.erase(line);
+	if (line->Comment) return;
+
+	for (auto other : file.EventsOverlapping(line->Start, line->End)) {
+		if (other != line && !other->Comment && SameGroup(line, other)) {
+			lines[line] = Span{(int)line->Start, (int)line->End};
+			return;
+		}
+	}
+}
+
+void AssOverlaps::Replace(AssFile const& file, std::vector<std::pair<const AssDialogue *, const AssDialogue *>> const& changed) {
+	std::vector<const AssDialogue *> check;
+
+	// Lines which overlapped the old versions may not overlap anything now.
+	// All of the old times have to be looked up before checking anything, as
+	// checking a line records its current times.
+	for (auto const& change : changed) {
+		auto it = lines.find(change.first);
+		if (it == lines.end()) continue;
+		for (auto line : file.EventsOverlapping(it->second.start, it->second.end)) {
+			if (Contains(line))
+				check.push_back(line);
+		}
+		lines.erase(it);
+	}
+
+	// And lines which overlap the new versions may not have before
+	for (auto const& change : changed) {
+		auto line = change.second;
+		check.push_back(line);
+		if (!line->Comment) {
+			auto overlapping = file.EventsOverlapping(line->Start, line->End);
+			check.insert(check.end(), overlapping.begin(), overlapping.end());
+		}
+	}
+
+	sort(begin(check), end(check));
+	check.erase(unique(begin(check), end(check)), end(check));
+	for (auto line : check)
+		Check(file, line);
+}
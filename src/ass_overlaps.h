@@ -0,0 +1,70 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#pragma once
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class AssDialogue;
+class AssFile;
+
+/// Which lines count as overlapping each other
+enum class OverlapGroup {
+	/// Any two lines
+	NONE = 0,
+	/// Lines with the same style
+	STYLE,
+	/// Lines on the same layer
+	LAYER
+};
+
+/// @class AssOverlaps
+/// @brief The non-comment lines of a file whose times overlap another
+///        non-comment line in the same group
+///
+/// The initial set is found by sorting the lines by start time and sweeping
+/// over them once, and after that only the lines near a change are checked
+/// again, using the file's time index.
+class AssOverlaps {
+	struct Span {
+		int start;
+		int end;
+	};
+
+	/// Overlapping lines, with the times they had when last checked so
+	/// that the lines they overlapped can be found after they're retimed
+	std::unordered_map<const AssDialogue *, Span> lines;
+	OverlapGroup group;
+
+	bool SameGroup(const AssDialogue *a, const AssDialogue *b) const;
+	/// Work out from scratch whether a single line overlaps anything
+	void Check(AssFile const& file, const AssDialogue *line);
+
+public:
+	AssOverlaps(AssFile const& file, OverlapGroup group);
+
+	OverlapGroup Group() const { return group; }
+	bool Contains(const AssDialogue *line) const { return lines.count(line) != 0; }
+
+	/// Update the set after the times, style, layer or comment flag of some
+	/// lines changed, once the file's time index has been told about them
+	/// @param changed Pairs of the line which changed and the line now in
+	///                its place, which is usually the same line
+	void Replace(AssFile const& file, std::vector<std::pair<const AssDialogue *, const AssDialogue *>> const& changed);
+};
@@ -39,10 +39,13 @@
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/trim.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/adaptor/transformed.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <functional>
+#include <mutex>
 
 using namespace boost::adaptors;
 
@@ -98,7 +101,7 @@ template<> AssDialogueBlockOverride *AssOverrideParameter::Get<AssDialogueBlockO
 
 template<> void AssOverrideParameter::Set<std::string>(std::string new_value) {
 	omitted = false;
-	value = new_value;
+	value = std::move(new_value);
 	block.reset();
 }
 
@@ -118,6 +121,98 @@ template<> void AssOverrideParameter::Set<bool>(bool new_value) {
 }
 
 namespace {
+/// FNV-1a hash of a tag name. It's usable in case labels, so the compiler
+/// rejects the tag table below if any two known tags hash the same.
+constexpr uint32_t tag_hash(const char *str, size_t len, uint32_t hash = 2166136261u) {
+	return len == 0 ? hash : tag_hash(str + 1, len - 1, (hash ^ static_cast<unsigned char>(*str)) * 16777619u);
+}
+
+template<size_t N>
+constexpr uint32_t tag_hash(const char (&str)[N]) {
+	return tag_hash(str, N - 1);
+}
+
+/// Names of the known tags, indexed by AssTagId
+const char *const tag_names[] = {
+	"",
+	"\\alpha", "\\bord", "\\xbord", "\\ybord", "\\shad", "\\xshad", "\\yshad",
+	"\\fade", "\\move", "\\clip", "\\iclip", "\\fscx", "\\fscy", "\\pos",
+	"\\org", "\\pbo", "\\fad", "\\fsp", "\\frx", "\\fry", "\\frz", "\\fr",
+	"\\fax", "\\fay", "\\1c", "\\2c", "\\3c", "\\4c", "\\1a", "\\2a", "\\3a",
+	"\\4a", "\\fe", "\\ko", "\\kf", "\\be", "\\blur", "\\fn", "\\fs+",
+	"\\fs-", "\\fs", "\\an", "\\c", "\\b", "\\i", "\\u", "\\s", "\\a", "\\k",
+	"\\K", "\\q", "\\p", "\\r", "\\t"
+};
+
+/// Length of the longest known tag name
+const size_t max_tag_length = 6;
+
+/// Look up a tag name of the given length
+AssTagId find_tag(const char *str, size_t len) {
+	AssTagId id;
+	switch (tag_hash(str, len)) {
+		case tag_hash("\\alpha"): id = AssTagId::ALPHA; break;
+		case tag_hash("\\bord"): id = AssTagId::BORD; break;
+		case tag_hash("\\xbord"): id = AssTagId::XBORD; break;
+		case tag_hash("\\ybord"): id = AssTagId::YBORD; break;
+		case tag_hash("\\shad"): id = AssTagId::SHAD; break;
+		case tag_hash("\\xshad"): id = AssTagId::XSHAD; break;
+		case tag_hash("\\yshad"): id = AssTagId::YSHAD; break;
+		case tag_hash("\\fade"): id = AssTagId::FADE; break;
+		case tag_hash("\\move"): id = AssTagId::MOVE; break;
+		case tag_hash("\\clip"): id = AssTagId::CLIP; break;
+		case tag_hash("\\iclip"): id = AssTagId::ICLIP; break;
+		case tag_hash("\\fscx"): id = AssTagId::FSCX; break;
+		case tag_hash("\\fscy"): id = AssTagId::FSCY; break;
+		case tag_hash("\\pos"): id = AssTagId::POS; break;
+		case tag_hash("\\org"): id = AssTagId::ORG; break;
+		case tag_hash("\\pbo"): id = AssTagId::PBO; break;
+		case tag_hash("\\fad"): id = AssTagId::FAD; break;
+		case tag_hash("\\fsp"): id = AssTagId::FSP; break;
+		case tag_hash("\\frx"): id = AssTagId::FRX; break;
+		case tag_hash("\\fry"): id = AssTagId::FRY; break;
+		case tag_hash("\\frz"): id = AssTagId::FRZ; break;
+		case tag_hash("\\fr"): id = AssTagId::FR; break;
+		case tag_hash("\\fax"): id = AssTagId::FAX; break;
+		case tag_hash("\\fay"): id = AssTagId::FAY; break;
+		case tag_hash("\\1c"): id = AssTagId::COLOR1; break;
+		case tag_hash("\\2c"): id = AssTagId::COLOR2; break;
+		case tag_hash("\\3c"): id = AssTagId::COLOR3; break;
+		case tag_hash("\\4c"): id = AssTagId::COLOR4; break;
+		case tag_hash("\\1a"): id = AssTagId::ALPHA1; break;
+		case tag_hash("\\2a"): id = AssTagId::ALPHA2; break;
+		case tag_hash("\\3a"): id = AssTagId::ALPHA3; break;
+		case tag_hash("\\4a"): id = AssTagId::ALPHA4; break;
+		case tag_hash("\\fe"): id = AssTagId::FE; break;
+		case tag_hash("\\ko"): id = AssTagId::KO; break;
+		case tag_hash("\\kf"): id = AssTagId::KF; break;
+		case tag_hash("\\be"): id = AssTagId::BE; break;
+		case tag_hash("\\blur"): id = AssTagId::BLUR; break;
+		case tag_hash("\\fn"): id = AssTagId::FN; break;
+		case tag_hash("\\fs+"): id = AssTagId::FS_PLUS; break;
+		case tag_hash("\\fs-"): id = AssTagId::FS_MINUS; break;
+		case tag_hash("\\fs"): id = AssTagId::FS; break;
+		case tag_hash("\\an"): id = AssTagId::AN; break;
+		case tag_hash("\\c"): id = AssTagId::COLOR; break;
+		case tag_hash("\\b"): id = AssTagId::B; break;
+		case tag_hash("\\i"): id = AssTagId::I; break;
+		case tag_hash("\\u"): id = AssTagId::U; break;
+		case tag_hash("\\s"): id = AssTagId::S; break;
+		case tag_hash("\\a"): id = AssTagId::A; break;
+		case tag_hash("\\k"): id = AssTagId::K; break;
+		case tag_hash("\\K"): id = AssTagId::K_UPPER; break;
+		case tag_hash("\\q"): id = AssTagId::Q; break;
+		case tag_hash("\\p"): id = AssTagId::P; break;
+		case tag_hash("\\r"): id = AssTagId::R; break;
+		case tag_hash("\\t"): id = AssTagId::T; break;
+		default: return AssTagId::UNKNOWN;
+	}
+
+	// Other strings may share a hash with a known tag
+	const char *name = tag_names[static_cast<size_t>(id)];
+	return strlen(name) == len && !memcmp(name, str, len) ? id : AssTagId::UNKNOWN;
+}
+
 /// The parameter is absent unless the total number of parameters is the
 /// indicated number. Note that only arguments not at the end need to be marked
 /// as optional; this is just to know which parameters to skip when there are
@@ -174,9 +269,9 @@ struct AssOverrideTagProto {
 };
 
 static std::vector<AssOverrideTagProto> proto;
-static void load_protos() {
-	if (!proto.empty()) return;
-
+/// Index in proto of the first prototype for each tag
+static size_t proto_index[sizeof(tag_names) / sizeof(tag_names[0])];
+static void fill_protos() {
 	proto.resize(56);
 	int i = 0;
 
@@ -305,25 +400,43 @@ static void load_protos() {
 	proto[i].AddParam(VariableDataType::INT, AssParameterClass::RELATIVE_TIME_START,OPTIONAL_3 | OPTIONAL_4);
 	proto[i].AddParam(VariableDataType::FLOAT, AssParameterClass::NORMAL,OPTIONAL_2 | OPTIONAL_4);
 	proto[i].AddParam(VariableDataType::BLOCK);
+
+	for (size_t j = proto.size(); j > 0; --j)
+		proto_index[static_cast<size_t>(find_tag(proto[j - 1].name.c_str(), proto[j - 1].name.size()))] = j - 1;
+}
+
+// Tags are parsed on several threads at once (e.g. when resampling), so the
+// table must only be built once
+static void load_protos() {
+	static std::once_flag loaded;
+	std::call_once(loaded, fill_protos);
 }
 
-std::vector<std::string> tokenize(const std::string &text) {
+/// Append text[start, end) with surrounding whitespace removed
+void add_trimmed(std::vector<std::string> &list, const std::string &text, size_t start, size_t end) {
+	while (start < end && isspace(static_cast<unsigned char>(text[start]))) ++start;
+	while (end > start && isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+	list.emplace_back(text, start, end - start);
+}
+
+/// Split the parameters of a tag, which start at text[pos]
+std::vector<std::string> tokenize(const std::string &text, size_t pos) {
 	std::vector<std::string> paramList;
-	paramList.reserve(6);
 
-	if (text.empty())
+	size_t i = pos, textlen = text.size();
+	if (i >= textlen)
 		return paramList;
 
-	if (text[0] != '(') {
+	if (text[i] != '(') {
 		// There's just one parameter (because there's no parentheses)
 		// This means text is all our parameters
-		paramList.emplace_back(boost::trim_copy(text));
+		add_trimmed(paramList, text, i, textlen);
 		return paramList;
 	}
 
 	// Ok, so there are parentheses used here, so there may be more than one parameter
 	// Enter fullscale parsing!
-	size_t i = 0, textlen = text.size();
+	paramList.reserve(std::count(text.begin() + i, text.end(), ',') + 2);
 	int parDepth = 1;
 	while (i < textlen && parDepth > 0) {
 		// Just skip until next ',' or ')', whichever comes first
@@ -344,7 +457,7 @@ std::vector<std::string> tokenize(const std::string &text) {
 			i++;
 		}
 		// i now points to the first character not member of this parameter
-		paramList.emplace_back(boost::trim_copy(text.substr(start, i - start)));
+		add_trimmed(paramList, text, start, i);
 	}
 
 	if (i+1 < textlen) {
@@ -355,20 +468,21 @@ std::vector<std::string> tokenize(const std::string &text) {
 	return paramList;
 }
 
-void parse_parameters(AssOverrideTag *tag, const std::string &text, AssOverrideTagProto::iterator proto_it) {
+void parse_parameters(AssOverrideTag *tag, const std::string &text, size_t pos, AssOverrideTagProto::iterator proto_it) {
 	tag->Clear();
 
 	// Tokenize text, attempting to find all parameters
-	std::vector<std::string> paramList = tokenize(text);
+	std::vector<std::string> paramList = tokenize(text, pos);
 	size_t totalPars = paramList.size();
 
 	int parsFlag = 1 << (totalPars - 1); // Get optional parameters flag
 	// vector (i)clip is the second clip proto_ittype in the list
-	if ((tag->Name == "\\clip" || tag->Name == "\\iclip") && totalPars != 4) {
+	if ((tag->Id == AssTagId::CLIP || tag->Id == AssTagId::ICLIP) && totalPars != 4) {
 		++proto_it;
 	}
 
 	unsigned curPar = 0;
+	tag->Params.reserve(proto_it->params.size());
 	for (auto& curproto : proto_it->params) {
 		// Create parameter
 		tag->Params.emplace_back(curproto.type, curproto.classification);
@@ -377,7 +491,7 @@ void parse_parameters(AssOverrideTag *tag, const std::string &text, AssOverrideT
 		if (!(curproto.optional & parsFlag) || curPar >= totalPars)
 			continue;
 
-		tag->Params.back().Set(paramList[curPar++]);
+		tag->Params.back().Set(std::move(paramList[curPar++]));
 	}
 }
 
@@ -386,6 +500,7 @@ void parse_parameters(AssOverrideTag *tag, const std::string &text, AssOverrideT
 // From ass_dialogue.h
 void AssDialogueBlockOverride::ParseTags() {
 	Tags.clear();
+	Tags.reserve(std::count(text.begin(), text.end(), '\\') + 1);
 
 	int depth = 0;
 	size_t start = 0;
@@ -411,9 +526,8 @@ void AssDialogueBlockOverride::AddTag(std::string const& tag) {
 }
 
 static std::string tag_str(AssOverrideTag const& t) { return t; }
-std::string AssDialogueBlockOverride::GetText() {
-	text = "{" + join(Tags | transformed(tag_str), std::string()) + "}";
-	return text;
+std::string AssDialogueBlockOverride::GetText() const {
+	return "{" + join(Tags | transformed(tag_str), std::string()) + "}";
 }
 
 void AssDialogueBlockOverride::ProcessParameters(ProcessParametersCallback callback, void *userData) {
@@ -421,7 +535,7 @@ void AssDialogueBlockOverride::ProcessParameters(ProcessParametersCallback callb
 		for (auto& par : tag.Params) {
 			if (par.omitted) continue;
 
-			callback(tag.Name, &par, userData);
+			callback(tag.Id, &par, userData);
 
 			// Go recursive if it's a block parameter
 			if (par.GetType() == VariableDataType::BLOCK)
@@ -436,26 +550,35 @@ AssOverrideTag::AssOverrideTag(std::string const& text) {
 
 void AssOverrideTag::Clear() {
 	Params.clear();
-	Params.reserve(6);
 	valid = false;
 }
 
 void AssOverrideTag::SetText(const std::string &text) {
 	load_protos();
-	for (auto cur = proto.begin(); cur != proto.end(); ++cur) {
-		if (boost::starts_with(text, cur->name)) {
-			Name = cur->name;
-			parse_parameters(this, text.substr(Name.size()), cur);
-			valid = true;
-			return;
-		}
+
+	// Tag names can be prefixes of other tag names (e.g. \fs and \fscx), so
+	// the longest one which matches is the tag
+	for (size_t len = std::min(text.size(), max_tag_length); len > 1; --len) {
+		auto id = find_tag(text.data(), len);
+		if (id == AssTagId::UNKNOWN) continue;
+
+		Id = id;
+		Name = tag_names[static_cast<size_t>(id)];
+		parse_parameters(this, text, len, proto.begin() + proto_index[static_cast<size_t>(id)]);
+		valid = true;
+		return;
 	}
 
 	// Junk tag
+	Id = AssTagId::UNKNOWN;
 	Name = text;
 	valid = false;
 }
 
+AssTagId AssOverrideTag::IdFromName(std::string const& name) {
+	return find_tag(name.data(), name.size());
+}
+
 static std::string param_str(AssOverrideParameter const& p) { return p.Get<std::string>(); }
 AssOverrideTag::operator std::string() const {
 	std::string result = Name;
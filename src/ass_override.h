@@ -33,6 +33,7 @@
 ///
 
 #include <memory>
+#include <string>
 #include <vector>
 
 class AssDialogueBlockOverride;
@@ -87,6 +88,18 @@ public:
 	}
 };
 
+/// Override tags which the parser knows the parameters of
+enum class AssTagId : unsigned char {
+	UNKNOWN = 0, ///< Not a tag the parser knows, so only its text is kept
+	ALPHA, BORD, XBORD, YBORD, SHAD, XSHAD, YSHAD, FADE, MOVE, CLIP, ICLIP,
+	FSCX, FSCY, POS, ORG, PBO, FAD, FSP, FRX, FRY, FRZ, FR, FAX, FAY,
+	COLOR1, COLOR2, COLOR3, COLOR4, ALPHA1, ALPHA2, ALPHA3, ALPHA4,
+	FE, KO, KF, BE, BLUR, FN, FS_PLUS, FS_MINUS, FS, AN, COLOR,
+	B, I, U, S, A, K,
+	K_UPPER, ///< \K, which is the same as \kf
+	Q, P, R, T
+};
+
 class AssOverrideTag {
 	bool valid = false;
 
@@ -96,9 +109,15 @@ public:
 	AssOverrideTag(AssOverrideTag&&) = default;
 	AssOverrideTag& operator=(AssOverrideTag&&) = default;
 
+	/// Name of the tag with the backslash, or all of the text of a junk tag
 	std::string Name;
+	/// Which tag this is, so that tags can be told apart without comparing names
+	AssTagId Id = AssTagId::UNKNOWN;
 	std::vector<AssOverrideParameter> Params;
 
+	/// Get the id of a tag name, including the backslash
+	static AssTagId IdFromName(std::string const& name);
+
 	bool IsValid() const { return valid; }
 	void Clear();
 	void SetText(const std::string &text);
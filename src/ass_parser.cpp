@@ -33,8 +33,17 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 #include <boost/variant.hpp>
+#include <exception>
+#include <thread>
 #include <unordered_map>
 
+namespace {
+/// Number of dialogue lines to buffer before parsing them
+const size_t event_batch_size = 65536;
+/// Fewest lines worth handing to a separate thread
+const size_t min_lines_per_thread = 2048;
+}
+
 class AssParser::HeaderToProperty {
 	using field = boost::variant<
 		std::string ProjectProperties::*,
@@ -177,8 +186,60 @@ void AssParser::ParseMetadataLine(std::string const& data) {
 }
 
 void AssParser::ParseEventLine(std::string const& data) {
-	if (boost::starts_with(data, "Dialogue:") || boost::starts_with(data, "Comment:"))
-		target->Events.push_back(*new AssDialogue(data));
+	if (boost::starts_with(data, "Dialogue:") || boost::starts_with(data, "Comment:")) {
+		pending_events.push_back(data);
+		if (pending_events.size() >= event_batch_size)
+			ParsePendingEvents();
+	}
+}
+
+void AssParser::ParsePendingEvents() {
+	size_t count = pending_events.size();
+	if (!count) return;
+
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+		count / min_lines_per_thread);
+	threads = std::max<size_t>(threads, 1);
+
+	// Each range of lines is parsed until the first one which fails
+	std::vector<std::unique_ptr<AssDialogue>> lines(count);
+	std::vector<std::exception_ptr> errors(threads);
+	auto parse_range = [&](size_t t) {
+		size_t end = count * (t + 1) / threads;
+		try {
+			for (size_t i = count * t / threads; i < end; ++i)
+				lines[i] = agi::make_unique<AssDialogue>(pending_events[i]);
+		}
+		catch (...) {
+			errors[t] = std::current_exception();
+		}
+	};
+
+	if (threads == 1)
+		parse_range(0);
+	else {
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+		for (size_t t = 0; t < threads; ++t)
+			workers.emplace_back(parse_range, t);
+		for (auto& worker : workers)
+			worker.join();
+	}
+	pending_events.clear();
+
+	// Add everything before the first line which failed to parse, as
+	// parsing serially would have, and then report that failure
+	for (auto& line : lines) {
+		if (!line) break;
+		target->Events.push_back(*line.release());
+	}
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+}
+
+void AssParser::Finish() {
+	ParsePendingEvents();
 }
 
 void AssParser::ParseStyleLine(std::string const& data) {
@@ -13,6 +13,8 @@
 // OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include <memory>
+#include <string>
+#include <vector>
 
 class AssAttachment;
 class AssFile;
@@ -25,6 +27,11 @@ class AssParser {
 	int version;
 	std::unique_ptr<AssAttachment> attach;
 	void (AssParser::*state)(std::string const&);
+	/// Dialogue lines which have been read but not yet parsed
+	std::vector<std::string> pending_events;
+
+	/// Parse pending_events, in parallel if there are enough of them
+	void ParsePendingEvents();
 
 	void ParseAttachmentLine(std::string const& data);
 	void ParseEventLine(std::string const& data);
@@ -40,4 +47,8 @@ public:
 	~AssParser();
 
 	void AddLine(std::string const& data);
+
+	/// Add any lines still buffered to the file; must be called after the
+	/// last call to AddLine
+	void Finish();
 };
@@ -0,0 +1,240 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "ass_snapshot.h"
+
+#include "ass_attachment.h"
+#include "ass_dialogue.h"
+#include "ass_file.h"
+#include "ass_info.h"
+#include "ass_style.h"
+
+#include <algorithm>
+
+namespace {
+bool SameLine(AssDialogueBase const& a, AssDialogueBase const& b) {
+	// The flyweights compare by address, so this is cheap even for long lines
+	return a.Id == b.Id && a.Row == b.Row && a.Comment == b.Comment
+		&& a.Layer == b.Layer && a.Margin == b.Margin
+		&& a.Start == b.Start && a.End == b.End
+		&& a.Style == b.Style && a.Actor == b.Actor && a.Effect == b.Effect
+		&& a.ExtradataIds == b.ExtradataIds && a.Text == b.Text;
+}
+
+/// Reuse the previous copy of a section if nothing in it has changed, as is
+/// usually the case, and copy it otherwise
+template<typename T, typename Range, typename Equal>
+std::shared_ptr<const std::vector<T>> Share(Range const& current, std::shared_ptr<const std::vector<T>> const* previous, Equal equal) {
+	if (previous && *previous && std::equal(current.begin(), current.end(), (*previous)->begin(), (*previous)->end(), equal))
+		return *previous;
+	return std::make_shared<const std::vector<T>>(current.begin(), current.end());
+}
+}
+
+void AssFileSnapshot::CopySections(AssFile const& file, AssFileSnapshot const* previous) {
+	info = Share(file.Info, previous ? &previous->info : nullptr,
+		[](AssInfo const& a, AssInfo const& b) { return a.GetEntryData() == b.GetEntryData(); });
+	styles = Share(file.Styles, previous ? &previous->styles : nullptr,
+		[](AssStyle const& a, AssStyle const& b) { return a.GetEntryData() == b.GetEntryData(); });
+	// Attachment data is a flyweight, so equal data has the same address
+	attachments = Share(file.Attachments, previous ? &previous->attachments : nullptr,
+		[](AssAttachment const& a, AssAttachment const& b) { return &a.GetEntryData() == &b.GetEntryData(); });
+	extradata = Share(file.Extradata, previous ? &previous->extradata : nullptr,
+		[](ExtradataEntry const& a, ExtradataEntry const& b) { return a.id == b.id && a.key == b.key && a.value == b.value; });
+	next_extradata_id = file.next_extradata_id;
+}
+
+AssFileSnapshot::AssFileSnapshot(AssFile const& file, AssFileSnapshot const* previous) {
+	CopySections(file, previous);
+	CopyEvents(file, previous);
+}
+
+void AssFileSnapshot::CopyEvents(AssFile const& file, AssFileSnapshot const* previous) {
+	events.clear();
+	events.reserve((file.Events.size() + chunk_size - 1) / chunk_size);
+
+	auto it = file.Events.begin(), end = file.Events.end();
+	while (it != end) {
+		size_t index = events.size();
+
+		// Reuse the previous snapshot's chunk at this position if it holds
+		// exactly the lines which would have gone into the new one
+		if (previous && index < previous->events.size()) {
+			auto const& old = *previous->events[index];
+			auto cur = it;
+			size_t matched = 0;
+			for (; matched < old.size() && cur != end && SameLine(old[matched], *cur); ++matched, ++cur) ;
+			if (matched == old.size() && (matched == chunk_size || cur == end)) {
+				events.push_back(previous->events[index]);
+				it = cur;
+				continue;
+			}
+		}
+
+		auto chunk = std::make_shared<Chunk>();
+		chunk->reserve(chunk_size);
+		for (; chunk->size() < chunk_size && it != end; ++it)
+			chunk->push_back(*it);
+		events.push_back(std::move(chunk));
+	}
+}
+
+AssFileSnapshot::AssFileSnapshot(AssFile const& file, AssFileSnapshot const& previous, AssDialogueBase const& changed)
+: events(previous.events)
+{
+	CopySections(file, &previous);
+	if (!SetEvent(changed))
+		CopyEvents(file, &previous);
+}
+
+AssFileSnapshot::AssFileSnapshot(AssFile const& file, AssFileSnapshot const& previous, std::vector<AssDialogue *> const& changed)
+: events(previous.events)
+{
+	CopySections(file, &previous);
+	for (auto line : changed) {
+		if (!SetEvent(*line)) {
+			CopyEvents(file, &previous);
+			break;
+		}
+	}
+}
+
+AssFileSnapshot::AssFileSnapshot(AssFileSnapshot const&) = default;
+AssFileSnapshot::AssFileSnapshot(AssFileSnapshot&&) = default;
+AssFileSnapshot::~AssFileSnapshot() = default;
+
+void AssFileSnapshot::Restore(AssFile &file) const {
+	std::vector<AssDialogue *> rows;
+	Update(file, rows, nullptr);
+}
+
+void AssFileSnapshot::Update(AssFile &file, std::vector<AssDialogue *> &rows, AssFileSnapshot const* previous) const {
+	file.Info = *info;
+	file.Styles.clear_and_dispose([](AssStyle *e) { delete e; });
+	file.StylesChanged();
+	for (auto const& style : *styles)
+		file.Styles.push_back(*new AssStyle(style));
+	file.Attachments = *attachments;
+	file.Extradata = *extradata;
+	file.next_extradata_id = next_extradata_id;
+
+	if (!previous) {
+		file.Events.clear_and_dispose([](AssDialogue *e) { delete e; });
+		rows.clear();
+	}
+
+	size_t row = 0;
+	for (size_t i = 0; i < events.size(); ++i) {
+		auto const& chunk = *events[i];
+		if (previous && i < previous->events.size() && previous->events[i] == events[i]) {
+			row += chunk.size();
+			continue;
+		}
+
+		for (auto const& line : chunk) {
+			if (row < rows.size())
+				static_cast<AssDialogueBase&>(*rows[row]) = line;
+			else {
+				auto copy = new AssDialogue(line);
+				file.Events.push_back(*copy);
+				rows.push_back(copy);
+			}
+			++row;
+		}
+	}
+
+	// Anything left over was removed since the previous snapshot
+	for (size_t i = row; i < rows.size(); ++i)
+		delete rows[i];
+	rows.resize(row);
+	file.EventsChanged();
+}
+
+bool AssFileSnapshot::SetEvent(AssDialogueBase const& line) {
+	// Row is normally the index of the line, so look there before searching
+	size_t chunk = events.size(), pos = 0;
+	if (line.Row >= 0) {
+		size_t i = line.Row / chunk_size, j = line.Row % chunk_size;
+		if (i < events.size() && j < events[i]->size() && (*events[i])[j].Id == line.Id) {
+			chunk = i;
+			pos = j;
+		}
+	}
+
+	for (size_t i = 0; chunk == events.size() && i < events.size(); ++i) {
+		for (size_t j = 0; j < events[i]->size(); ++j) {
+			if ((*events[i])[j].Id == line.Id) {
+				chunk = i;
+				pos = j;
+				break;
+			}
+		}
+	}
+
+	if (chunk == events.size()) return false;
+
+	auto copy = std::make_shared<Chunk>(*events[chunk]);
+	(*copy)[pos] = line;
+	events[chunk] = std::move(copy);
+	return true;
+}
+
+size_t AssFileSnapshot::MemoryUsage(AssFileSnapshot const* previous) const {
+	size_t bytes = sizeof(*this) + events.capacity() * sizeof(events[0]);
+
+	if (!previous || previous->info != info) {
+		for (auto const& entry : *info)
+			bytes += sizeof(entry) + entry.GetEntryData().size();
+	}
+	if (!previous || previous->styles != styles) {
+		for (auto const& style : *styles)
+			bytes += sizeof(style) + style.GetEntryData().size();
+	}
+	if (!previous || previous->attachments != attachments) {
+		for (auto const& attachment : *attachments)
+			bytes += sizeof(attachment) + attachment.GetEntryData().size();
+	}
+	if (!previous || previous->extradata != extradata) {
+		for (auto const& entry : *extradata)
+			bytes += sizeof(entry) + entry.key.size() + entry.value.size();
+	}
+
+	for (size_t i = 0; i < events.size(); ++i) {
+		if (previous && i < previous->events.size() && previous->events[i] == events[i])
+			continue;
+		for (auto const& line : *events[i])
+			bytes += sizeof(line) + line.Text.get().size();
+	}
+
+	return bytes;
+}
+
+size_t AssFileSnapshot::EventCount() const {
+	if (events.empty()) return 0;
+	return (events.size() - 1) * chunk_size + events.back()->size();
+}
+
+bool AssFileSnapshot::SameSections(AssFileSnapshot const& other) const {
+	return info == other.info && styles == other.styles && attachments == other.attachments
+		&& extradata == other.extradata && next_extradata_id == other.next_extradata_id;
+}
+
+void AssFileSnapshot::ForEachChangedChunk(AssFileSnapshot const& other, std::function<void (size_t, std::vector<AssDialogueBase> const&)> const& func) const {
+	for (size_t i = 0; i < events.size(); ++i) {
+		if (i >= other.events.size() || other.events[i] != events[i])
+			func(i * chunk_size, *events[i]);
+	}
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class AssAttachment;
+class AssDialogue;
+class AssFile;
+class AssInfo;
+class AssStyle;
+struct AssDialogueBase;
+struct ExtradataEntry;
+
+/// @class AssFileSnapshot
+/// @brief Immutable copy of the contents of an AssFile
+///
+/// The dialogue lines are stored in fixed-size chunks which are never
+/// modified once created, so a snapshot taken relative to an earlier one
+/// shares every chunk in which no line changed, and copying a snapshot
+/// copies only the list of chunks. Chunks are positional, so inserting or
+/// removing a line means that every chunk after it is copied again. The other
+/// sections are shared with the previous snapshot whenever they are unchanged.
+class AssFileSnapshot {
+public:
+	/// Number of lines in each chunk other than the last
+	static const size_t chunk_size = 256;
+
+private:
+	typedef std::vector<AssDialogueBase> Chunk;
+
+	std::shared_ptr<const std::vector<AssInfo>> info;
+	std::shared_ptr<const std::vector<AssStyle>> styles;
+	std::shared_ptr<const std::vector<AssAttachment>> attachments;
+	std::shared_ptr<const std::vector<ExtradataEntry>> extradata;
+	uint32_t next_extradata_id = 0;
+	std::vector<std::shared_ptr<const Chunk>> events;
+
+	/// Copy everything other than the dialogue lines from file
+	void CopySections(AssFile const& file, AssFileSnapshot const* previous);
+	/// Copy the dialogue lines from file
+	void CopyEvents(AssFile const& file, AssFileSnapshot const* previous);
+
+public:
+	/// Take a snapshot of a file
+	/// @param file File to copy
+	/// @param previous Earlier snapshot to share unchanged chunks with, if any
+	AssFileSnapshot(AssFile const& file, AssFileSnapshot const* previous = nullptr);
+	/// Take a snapshot of a file which differs from previous in at most one
+	/// dialogue line, without looking at the other lines
+	/// @param file File to copy
+	/// @param previous Snapshot of the file before the change
+	/// @param changed The line which may have changed; if it isn't in previous
+	///                every line is compared as usual
+	AssFileSnapshot(AssFile const& file, AssFileSnapshot const& previous, AssDialogueBase const& changed);
+	/// Take a snapshot of a file which differs from previous in at most the
+	/// given dialogue lines, without looking at the other lines
+	AssFileSnapshot(AssFile const& file, AssFileSnapshot const& previous, std::vector<AssDialogue *> const& changed);
+	AssFileSnapshot(AssFileSnapshot const&);
+	AssFileSnapshot(AssFileSnapshot&&);
+	~AssFileSnapshot();
+
+	/// Replace the contents of a file with the snapshot
+	void Restore(AssFile &file) const;
+
+	/// Bring a file which matches previous up to date with this snapshot
+	/// @param file File to update
+	/// @param rows The lines of file in order, which is updated along with it
+	/// @param previous Snapshot which file currently matches, or nullptr if
+	///                 the file has to be restored in full
+	///
+	/// Only the lines in chunks which aren't shared with previous are
+	/// touched, and the existing AssDialogue objects are reused for them.
+	void Update(AssFile &file, std::vector<AssDialogue *> &rows, AssFileSnapshot const* previous) const;
+
+	/// Replace the line with the same Id as the given one, copying only the
+	/// chunk which contains it
+	/// @return Was the line found?
+	bool SetEvent(AssDialogueBase const& line);
+
+	/// Estimate the memory used by this snapshot which isn't shared with
+	/// another one
+	/// @param previous Snapshot this one was taken relative to, if any
+	///
+	/// Text is counted in full for every line in an unshared chunk even though
+	/// the flyweight strings may be in use elsewhere, so this errs high.
+	size_t MemoryUsage(AssFileSnapshot const* previous) const;
+
+	/// Number of dialogue lines in the snapshot
+	size_t EventCount() const;
+
+	/// Is everything other than the dialogue lines shared with other?
+	bool SameSections(AssFileSnapshot const& other) const;
+
+	/// Call func with the index of the first line and the lines of each chunk
+	/// which isn't shared with the chunk at the same position in other
+	void ForEachChangedChunk(AssFileSnapshot const& other, std::function<void (size_t, std::vector<AssDialogueBase> const&)> const& func) const;
+};
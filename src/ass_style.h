@@ -74,6 +74,7 @@ public:
 	AssStyle(std::string const& data, int version=1);
 
 	std::string const& GetEntryData() const { return data; }
+	void AppendEntryData(std::string &out) const { out += data; }
 	AssEntryGroup Group() const override;
 
 	/// Convert an ASS alignment to the equivalent SSA alignment
@@ -38,42 +38,114 @@
 #include "ass_style.h"
 #include "options.h"
 
+#include <libaegisub/dir_listing.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/io.h>
 #include <libaegisub/line_iterator.h>
+#include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
 
+#include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+namespace {
+/// Number of fields in a style line
+const size_t style_fields = 23;
+
+/// Get the name of the style on a line, or return false if the line clearly
+/// isn't a style
+bool style_name(std::string const& line, std::string &name) {
+	auto colon = line.find(':');
+	if (colon == std::string::npos) return false;
+	if ((size_t)std::count(line.begin() + colon, line.end(), ',') != style_fields - 1)
+		return false;
+
+	auto end = line.find(',', colon);
+	name = boost::trim_copy(line.substr(colon + 1, end - colon - 1));
+	return true;
+}
+}
+
+AssStyleStorage::Entry::Entry(std::string name, std::string line)
+: name(std::move(name))
+, line(std::move(line))
+{
+}
+
+AssStyleStorage::Entry::Entry(std::unique_ptr<AssStyle> style) : style(std::move(style)) { }
+AssStyleStorage::Entry::Entry(Entry&&) = default;
+AssStyleStorage::Entry& AssStyleStorage::Entry::operator=(Entry&&) = default;
+AssStyleStorage::Entry::~Entry() { }
+
+std::string const& AssStyleStorage::Entry::Name() const {
+	return style ? style->name : name;
+}
 
 AssStyleStorage::~AssStyleStorage() { }
-void AssStyleStorage::clear() { style.clear(); }
-void AssStyleStorage::push_back(std::unique_ptr<AssStyle> new_style) { style.emplace_back(std::move(new_style)); }
+void AssStyleStorage::clear() { style.clear(); modified = true; }
+void AssStyleStorage::push_back(std::unique_ptr<AssStyle> new_style) {
+	style.emplace_back(std::move(new_style));
+	modified = true;
+}
+
+AssStyle *AssStyleStorage::Parse(Entry &entry) const {
+	if (!entry.style) {
+		try {
+			entry.style = agi::make_unique<AssStyle>(entry.line);
+		}
+		catch (...) {
+			// The line looked enough like a style to list it, so keep it
+			// listed rather than shifting every style after it
+			LOG_W("style_storage/load") << "Invalid style in " << file << ": " << entry.line;
+			entry.style = agi::make_unique<AssStyle>();
+			entry.style->name = entry.name;
+			entry.style->UpdateData();
+		}
+	}
+	return entry.style.get();
+}
 
 void AssStyleStorage::Save() const {
 	if (file.empty()) return;
 
+	// Styles which were never parsed can't have been changed, and the ones
+	// which were are compared to the line they came from
+	bool changed = modified || !agi::fs::FileExists(file);
+	for (auto const& entry : style)
+		changed = changed || (entry.style && entry.style->GetEntryData() != entry.line);
+	if (!changed) return;
+
 	agi::fs::CreateDirectory(file.parent_path());
 
-	agi::io::Save out(file);
-	out.Get() << "\xEF\xBB\xBF";
+	{
+		agi::io::Save out(file);
+		out.Get() << "\xEF\xBB\xBF";
 
-	for (auto const& cur : style)
-		out.Get() << cur->GetEntryData() << std::endl;
+		for (auto const& entry : style)
+			out.Get() << (entry.style ? entry.style->GetEntryData() : entry.line) << std::endl;
+	}
+
+	for (auto& entry : style) {
+		if (entry.style)
+			entry.line = entry.style->GetEntryData();
+	}
+	modified = false;
 }
 
 void AssStyleStorage::Load(agi::fs::path const& filename) {
 	file = filename;
-	clear();
+	style.clear();
+	modified = false;
 
 	try {
 		auto in = agi::io::Open(file);
+		std::string name;
 		for (auto const& line : agi::line_iterator<std::string>(*in)) {
-			try {
-				style.emplace_back(agi::make_unique<AssStyle>(line));
-			} catch(...) {
-				/* just ignore invalid lines for now */
-			}
+			// Invalid lines are dropped, as parsing the line would throw
+			if (style_name(line, name))
+				style.emplace_back(name, line);
 		}
 	}
 	catch (agi::fs::FileNotAccessible const&) {
@@ -88,26 +160,28 @@ void AssStyleStorage::LoadCatalog(std::string const& catalogname) {
 
 void AssStyleStorage::Delete(int idx) {
 	style.erase(style.begin() + idx);
+	modified = true;
 }
 
 std::vector<std::string> AssStyleStorage::GetNames() {
 	std::vector<std::string> names;
+	names.reserve(style.size());
 	for (auto const& cur : style)
-		names.emplace_back(cur->name);
+		names.emplace_back(cur.Name());
 	return names;
 }
 
 AssStyle *AssStyleStorage::GetStyle(std::string const& name) {
 	for (auto& cur : style) {
-		if (boost::iequals(cur->name, name))
-			return cur.get();
+		if (boost::iequals(cur.Name(), name))
+			return Parse(cur);
 	}
 	return nullptr;
 }
 
 std::vector<std::string> AssStyleStorage::GetCatalogs() {
 	std::vector<std::string> catalogs;
-	for (auto const& file : agi::fs::DirectoryIterator(config::path->Decode("?user/catalog/"), "*.sty"))
+	for (auto const& file : agi::fs::ListDirectory(config::path->Decode("?user/catalog/"), "*.sty"))
 		catalogs.push_back(agi::fs::path(file).stem().string());
 	return catalogs;
 }
@@ -119,7 +193,8 @@ bool AssStyleStorage::CatalogExists(std::string const& catalogname) {
 }
 
 void AssStyleStorage::ReplaceIntoFile(AssFile &file) {
-	for (auto const& s : style) {
+	for (auto& entry : style) {
+		auto s = Parse(entry);
 		delete file.GetStyle(s->name);
 		file.Styles.push_back(*new AssStyle(*s));
 	}
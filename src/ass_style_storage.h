@@ -43,21 +43,39 @@ class AssFile;
 class AssStyle;
 
 class AssStyleStorage {
+	/// A style in the storage, which is only parsed once something asks for
+	/// more than its name
+	struct Entry {
+		/// Name of the style, used until it's parsed
+		std::string name;
+		/// Line the style was loaded from, or empty if it wasn't loaded
+		std::string line;
+		/// The parsed style, or nullptr if it hasn't been parsed yet
+		std::unique_ptr<AssStyle> style;
+
+		Entry(std::string name, std::string line);
+		Entry(std::unique_ptr<AssStyle> style);
+		Entry(Entry&&);
+		Entry& operator=(Entry&&);
+		~Entry();
+
+		std::string const& Name() const;
+	};
+
 	agi::fs::path file;
-	std::vector<std::unique_ptr<AssStyle>> style;
+	mutable std::vector<Entry> style;
+	/// Have styles been added or removed since the file was last written?
+	mutable bool modified = false;
+
+	/// Get the parsed style for an entry, parsing it if needed
+	AssStyle *Parse(Entry &entry) const;
 
 public:
 	~AssStyleStorage();
 
-	typedef std::vector<std::unique_ptr<AssStyle>>::iterator iterator;
-	typedef std::vector<std::unique_ptr<AssStyle>>::const_iterator const_iterator;
-	iterator begin() { return style.begin(); }
-	iterator end() { return style.end(); }
-	const_iterator begin() const { return style.begin(); }
-	const_iterator end() const { return style.end(); }
 	void push_back(std::unique_ptr<AssStyle> new_style);
-	AssStyle *back() { return style.back().get(); }
-	AssStyle *operator[](size_t idx) const { return style[idx].get(); }
+	AssStyle *back() { return Parse(style.back()); }
+	AssStyle *operator[](size_t idx) const { return Parse(style[idx]); }
 	size_t size() const { return style.size(); }
 	void clear();
 
@@ -72,10 +90,13 @@ public:
 	/// @return Style or nullptr if the requested style is not found
 	AssStyle *GetStyle(std::string const& name);
 
-	/// Save stored styles to a file
+	/// Save stored styles to a file, if they've changed since they were loaded
 	void Save() const;
 
 	/// Load stored styles from a file
+	///
+	/// Only the names of the styles are read here, and each style is parsed
+	/// the first time it's accessed.
 	/// @param filename Catalog filename. Does not have to exist.
 	void Load(agi::fs::path const& filename);
 
@@ -0,0 +1,112 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "ass_time_index.h"
+
+#include "ass_dialogue.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+template<typename Entry>
+bool by_start(Entry const& a, Entry const& b) {
+	return a.start < b.start;
+}
+}
+
+void AssTimeIndex::Build() {
+	std::stable_sort(begin(entries), end(entries), by_start<Entry>);
+
+	leaves = 1;
+	while (leaves < entries.size())
+		leaves *= 2;
+	max_end.assign(leaves * 2, INT_MIN);
+	UpdateTree(0, entries.size());
+}
+
+void AssTimeIndex::UpdateTree(size_t first, size_t last) {
+	for (size_t i = first; i < last; ++i)
+		max_end[leaves + i] = entries[i].end;
+
+	first += leaves;
+	last += leaves;
+	while (first > 1 && first < last) {
+		first /= 2;
+		last = (last + 1) / 2;
+		for (size_t i = first; i < last; ++i)
+			max_end[i] = std::max(max_end[i * 2], max_end[i * 2 + 1]);
+	}
+}
+
+bool AssTimeIndex::Replace(const AssDialogue *old_line, const AssDialogue *new_line) {
+	auto it = find_if(begin(entries), end(entries), [=](Entry const& e) { return e.line == old_line; });
+	if (it == end(entries)) return false;
+
+	Entry entry{(int)new_line->Start, (int)new_line->End, it->row, new_line};
+	size_t from = it - begin(entries);
+
+	// Slide the entries between the old and new positions over by one
+	auto pos = upper_bound(begin(entries), it, entry, by_start<Entry>);
+	if (pos == it)
+		pos = upper_bound(it + 1, end(entries), entry, by_start<Entry>) - 1;
+	size_t to = pos - begin(entries);
+
+	if (to < from)
+		std::move_backward(pos, it, it + 1);
+	else
+		std::move(it + 1, pos + 1, it);
+	entries[to] = entry;
+
+	UpdateTree(std::min(from, to), std::max(from, to) + 1);
+	return true;
+}
+
+std::vector<const AssDialogue *> AssTimeIndex::Overlapping(int start, int end) const {
+	std::vector<const Entry *> found;
+
+	// Only lines starting before the end of the range can overlap it
+	Entry key{end, 0, 0, nullptr};
+	size_t limit = lower_bound(begin(entries), std::end(entries), key, by_start<Entry>) - begin(entries);
+
+	if (limit > 0) {
+		// Depth-first walk of the nodes which cover [0, limit) and have a
+		// line ending after start under them
+		struct Node { size_t index, first, last; };
+		std::vector<Node> stack{{1, 0, leaves}};
+		while (!stack.empty()) {
+			auto node = stack.back();
+			stack.pop_back();
+			if (node.first >= limit || max_end[node.index] <= start)
+				continue;
+			if (node.index >= leaves) {
+				found.push_back(&entries[node.first]);
+				continue;
+			}
+			size_t mid = (node.first + node.last) / 2;
+			stack.push_back({node.index * 2 + 1, mid, node.last});
+			stack.push_back({node.index * 2, node.first, mid});
+		}
+	}
+
+	sort(begin(found), std::end(found), [](const Entry *a, const Entry *b) { return a->row < b->row; });
+
+	std::vector<const AssDialogue *> lines;
+	lines.reserve(found.size());
+	for (auto entry : found)
+		lines.push_back(entry->line);
+	return lines;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class AssDialogue;
+
+/// @class AssTimeIndex
+/// @brief Index of dialogue lines by time, for finding the lines active at a point
+///
+/// The lines are kept sorted by start time, with a tree of the latest end
+/// time of each range of them on top, so a query only descends into ranges
+/// which contain an overlapping line and costs O(log n + k). The index holds
+/// pointers to the lines, so it has to be told about every change to them;
+/// AssFile takes care of that for changes it sees committed.
+class AssTimeIndex {
+	struct Entry {
+		int start;
+		int end;
+		/// Position of the line in the file when the index was built
+		size_t row;
+		const AssDialogue *line;
+	};
+
+	std::vector<Entry> entries;
+	/// Latest end of the entries under each node, with the leaves from leaves on
+	std::vector<int> max_end;
+	size_t leaves = 0;
+
+	/// Recompute the tree above the leaves for entries first through last
+	void UpdateTree(size_t first, size_t last);
+
+public:
+	/// Index the lines in the range, which must be in file order
+	template<typename Range>
+	explicit AssTimeIndex(Range const& lines) {
+		for (auto const& line : lines)
+			entries.push_back(Entry{(int)line.Start, (int)line.End, entries.size(), &line});
+		Build();
+	}
+
+	/// Sort the entries and build the tree from scratch
+	void Build();
+
+	/// Update the index after a line's times changed or it was replaced by a
+	/// copy at the same position in the file
+	/// @return false if old_line isn't in the index
+	bool Replace(const AssDialogue *old_line, const AssDialogue *new_line);
+
+	/// Get the lines which overlap [start, end), in file order
+	std::vector<const AssDialogue *> Overlapping(int start, int end) const;
+};
@@ -18,41 +18,89 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "ass_snapshot.h"
 #include "export_fixstyle.h"
 #include "include/aegisub/subtitles_provider.h"
+#include "mkv_wrap.h"
+#include "options.h"
+#include "utils.h"
 #include "video_frame.h"
 #include "video_provider_manager.h"
+#include "video_thumbnails.h"
 
 #include <libaegisub/dispatch.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+#include <libaegisub/path.h>
+#include <libaegisub/trace.h>
+#include <libaegisub/util.h>
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <cmath>
 
 enum {
 	NEW_SUBS_FILE = -1,
 	SUBS_FILE_ALREADY_LOADED = -2
 };
 
-std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, double time, bool raw) {
-	// Find an unused buffer to use or allocate a new one if needed
+/// Split the time a subtitles provider took to draw into rendering and blending
+static void AddDrawTime(FrameTimings &timings, double elapsed, double blend) {
+	blend = std::min(blend, elapsed);
+	timings.subtitles += elapsed - blend;
+	timings.blend += blend;
+}
+
+std::shared_ptr<VideoFrame> AsyncVideoProvider::PrepareFrame(VideoFramePool &pool, VideoFrame const& source, bool draw_overlay) {
 	std::shared_ptr<VideoFrame> frame;
-	for (auto& buffer : buffers) {
-		if (buffer.use_count() == 1) {
-			frame = buffer;
-			break;
-		}
+	if (draw_overlay) {
+		frame = pool.Get(source.width * source.height * 4);
+		frame->data.assign(source.width * source.height * 4, 0);
+		frame->width = source.width;
+		frame->height = source.height;
+		frame->pitch = source.width * 4;
+		frame->flipped = source.flipped;
+		frame->yuv = false;
+		frame->full_width = source.full_width;
+		frame->full_height = source.full_height;
 	}
-
-	if (!frame) {
-		frame = std::make_shared<VideoFrame>();
-		buffers.push_back(frame);
+	else if (source.yuv) {
+		frame = pool.Get(source.width * source.height * 4);
+		ConvertToBGRA(source, nullptr, *frame);
 	}
+	else {
+		frame = pool.Get(source.data.size());
+		*frame = source;
+	}
+	return frame;
+}
+
+std::shared_ptr<const VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, double time, bool raw, std::shared_ptr<const VideoFrame> *overlay, FrameTimings *timings) {
+	FrameTimings ignored;
+	if (!timings) timings = &ignored;
+	timings->frame = frame_number;
 
+	agi::trace::Scope frame_scope("process frame", "video");
+	StageTimer timer;
+	std::shared_ptr<const VideoFrame> source;
 	try {
-		source_provider->GetFrame(frame_number, *frame);
+		agi::trace::Scope scope("decode", "video");
+		source = source_provider->GetSharedFrame(frame_number, pool);
 	}
 	catch (VideoProviderError const& err) { throw VideoProviderErrorEvent(err); }
+	timings->decode = timer.Restart();
 
-	if (raw || !subs_provider || !subs) return frame;
+	// Frames without subtitles can be handed out as they came from the
+	// provider, which for the cache means without copying them at all
+	if (raw || !subs_provider || !subs) return source;
+
+	// YUV frames which are going to the display keep the subtitles separate
+	// so that the conversion and compositing can both happen on the GPU,
+	// while anything else needs the subtitles drawn onto a BGRA frame
+	bool draw_overlay = source->yuv && overlay && subs_provider->CanDrawOverlay();
 
 	try {
+		agi::trace::Scope scope("load subtitles", "video");
 		if (single_frame != frame_number && single_frame != SUBS_FILE_ALREADY_LOADED) {
 			// Generally edits and seeks come in groups; if the last thing done
 			// was seek it is more likely that the user will seek again and
@@ -65,19 +113,57 @@ std::shared_ptr<VideoFrame> AsyncVideoProvider::ProcFrame(int frame_number, doub
 				single_frame = SUBS_FILE_ALREADY_LOADED;
 			}
 			else {
-				AssFixStylesFilter::ProcessSubs(subs.get());
+				// This changes the lines themselves, so they no longer match
+				// the snapshot they came from
+				if (AssFixStylesFilter::ProcessSubs(subs.get()))
+					subs_loaded.reset();
 				single_frame = frame_number;
 				subs_provider->LoadSubtitles(subs.get(), time);
 			}
 		}
 	}
 	catch (agi::Exception const& err) { throw SubtitlesProviderErrorEvent(err.GetMessage()); }
+	timings->subtitles = timer.Restart();
 
-	try {
-		subs_provider->DrawSubtitles(*frame, time / 1000.);
+	// Edits usually leave most of the subtitles on the frame as they were,
+	// so when the video under the last drawn frame is unchanged the provider
+	// can start from that and redraw only the areas which changed
+	std::shared_ptr<VideoFrame> frame;
+	bool redrawn = false;
+	if (last_drawn && last_drawn_source == source && last_drawn_overlay == draw_overlay && (draw_overlay || !source->yuv)) {
+		frame = pool.Get(last_drawn->data.size());
+		*frame = *last_drawn;
+		timings->blend += timer.Restart();
+		try {
+			agi::trace::Scope scope("redraw subtitles", "video");
+			redrawn = subs_provider->RedrawSubtitles(*frame, draw_overlay ? nullptr : source.get(), time / 1000.);
+		}
+		catch (agi::UserCancelException const&) { }
+		if (redrawn)
+			AddDrawTime(*timings, timer.Restart(), subs_provider->BlendTime());
+	}
+
+	if (!redrawn) {
+		frame = PrepareFrame(pool, *source, draw_overlay);
+		timings->blend += timer.Restart();
+		try {
+			agi::trace::Scope scope("draw subtitles", "video");
+			subs_provider->DrawSubtitles(*frame, time / 1000.);
+		}
+		catch (agi::UserCancelException const&) { }
+		AddDrawTime(*timings, timer.Restart(), subs_provider->BlendTime());
 	}
-	catch (agi::UserCancelException const&) { }
 
+	// Done even if the provider can't redraw, as whatever it last drew has
+	// to be what's in last_drawn when it's asked to
+	last_drawn = frame;
+	last_drawn_source = source;
+	last_drawn_overlay = draw_overlay;
+
+	if (draw_overlay) {
+		*overlay = frame;
+		return source;
+	}
 	return frame;
 }
 
@@ -91,43 +177,118 @@ static std::unique_ptr<SubtitlesProvider> get_subs_provider(wxEvtHandler *evt_ha
 	}
 }
 
-AsyncVideoProvider::AsyncVideoProvider(agi::fs::path const& video_filename, std::string const& colormatrix, wxEvtHandler *parent, agi::BackgroundRunner *br)
-: worker(agi::dispatch::Create())
+AsyncVideoProvider::AsyncVideoProvider(agi::fs::path const& video_filename, std::string const& colormatrix, wxEvtHandler *parent, agi::BackgroundRunner *br, bool build_thumbnails)
+: worker(agi::make_unique<agi::dispatch::CoalescingQueue>(agi::dispatch::Priority::UI))
 , subs_provider(get_subs_provider(parent, br))
 , source_provider(VideoProviderFactory::GetProvider(video_filename, colormatrix, br))
 , parent(parent)
+, br(br)
 {
+	// Typesetting is done against the fonts muxed into the video, so use them
+	// without making the user extract and install them first
+	if (subs_provider) {
+		auto provider = subs_provider.get();
+		worker->Async([=]{
+			try {
+				MatroskaWrapper::GetFonts(video_filename, [=](std::string const& name, const char *data, size_t size) {
+					provider->AddFont(name, data, size);
+				});
+			}
+			catch (agi::Exception const& err) {
+				LOG_D("video/fonts") << "Failed to read fonts attached to the video: " << err.GetMessage();
+			}
+		});
+	}
+
+	if (build_thumbnails && OPT_GET("Video/Slider/Thumbnails")->GetBool()) {
+		try {
+			thumbnails = std::make_shared<VideoThumbnails>(
+				VideoThumbnails::ChooseFrames(GetKeyFrames(), GetFrameCount()),
+				GetWidth(), GetHeight(), config::path->Decode("?temp"));
+			thumbnail_order = thumbnails->BuildOrder();
+			worker->Async([=]{ QueueThumbnail(); });
+		}
+		catch (agi::Exception const& err) {
+			LOG_W("video/thumbnails") << "Failed to create thumbnail cache: " << err.GetMessage();
+			thumbnails.reset();
+		}
+	}
 }
 
 AsyncVideoProvider::~AsyncVideoProvider() {
-	// Block until all currently queued jobs are complete
-	worker->Sync([]{});
+	// Block until all currently queued jobs are complete, including the
+	// ones which frames being drawn ahead will queue once they're done
+	for (;;) {
+		int jobs = 0;
+		worker->Sync([&]{
+			render_ahead = false;
+			thumbnails_stopped = true;
+			jobs = render_ahead_jobs + thumbnail_queued;
+		});
+		if (!jobs) break;
+		agi::util::sleep_for(5);
+	}
 }
 
 void AsyncVideoProvider::LoadSubtitles(const AssFile *new_subs) throw() {
 	uint_fast32_t req_version = ++version;
 
-	auto copy = new AssFile(*new_subs);
+	// Only the lines changed since the last load are copied here, and the
+	// worker then updates just those lines in its copy of the file
+	auto snapshot = std::make_shared<const AssFileSnapshot>(*new_subs, subs_latest.get());
+	subs_latest = snapshot;
 	worker->Async([=]{
-		subs.reset(copy);
+		if (!subs)
+			subs = agi::make_unique<AssFile>();
+		snapshot->Update(*subs, rows, subs_loaded.get());
+		subs_loaded = snapshot;
 		single_frame = NEW_SUBS_FILE;
+		// Styles or anything else may have changed, which the frames don't
+		// record
+		ClearRendered();
+		SubsChanged();
 		ProcAsync(req_version, false);
 	});
 }
 
-void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, const AssDialogue *changed) throw() {
+void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, std::vector<const AssDialogue *> const& changed) throw() {
 	uint_fast32_t req_version = ++version;
 
-	// Copy just the line which were changed, then replace the line at the
-	// same index in the worker's copy of the file with the new entry
-	auto copy = new AssDialogue(*changed);
+	// Copy just the lines which were changed, then replace the line at the
+	// same index in the worker's copy of the file with each new entry
+	auto copies = std::make_shared<std::vector<std::unique_ptr<AssDialogue>>>();
+	copies->reserve(changed.size());
+	for (auto line : changed)
+		copies->emplace_back(new AssDialogue(*line));
+
+	// Keep the snapshot the next load is taken relative to in step with
+	// the worker's copy
+	std::shared_ptr<AssFileSnapshot> snapshot;
+	if (subs_latest) {
+		snapshot = std::make_shared<AssFileSnapshot>(*subs_latest);
+		for (auto line : changed)
+			snapshot->SetEvent(*line);
+		subs_latest = snapshot;
+	}
+
 	worker->Async([=]{
-		int i = 0;
-		auto it = subs->Events.begin();
-		std::advance(it, copy->Row - i);
-		i = copy->Row;
-		subs->Events.insert(it, *copy);
-		delete &*it--;
+		for (auto& copy : *copies) {
+			if (copy->Row < 0 || (size_t)copy->Row >= rows.size()) {
+				subs_loaded.reset();
+				return;
+			}
+		}
+
+		for (auto& copy : *copies) {
+			auto& old = rows[copy->Row];
+			subs->Events.insert(subs->Events.iterator_to(*old), *copy);
+			subs->EventsChanged(old, copy.get());
+			delete old;
+			old = copy.release();
+		}
+		if (subs_loaded)
+			subs_loaded = snapshot;
+		SubsChanged();
 
 		single_frame = NEW_SUBS_FILE;
 		ProcAsync(req_version, true);
@@ -137,13 +298,57 @@ void AsyncVideoProvider::UpdateSubtitles(const AssFile *new_subs, const AssDialo
 void AsyncVideoProvider::RequestFrame(int new_frame, double new_time) throw() {
 	uint_fast32_t req_version = ++version;
 
-	worker->Async([=]{
+	worker->Async(REQUEST_FRAME, [=]{
+		if (new_frame != frame_number)
+			direction = new_frame < frame_number ? -1 : 1;
 		time = new_time;
 		frame_number = new_frame;
 		ProcAsync(req_version, false);
 	});
 }
 
+/// Get the lines which are drawn at time
+static std::vector<AssDialogueBase const*> VisibleLines(AssFile const& subs, double time) {
+	std::vector<AssDialogueBase const*> visible_lines;
+	for (auto line : subs.EventsAt((int)std::floor(time))) {
+		if (!line->Comment)
+			visible_lines.push_back(line);
+	}
+	return visible_lines;
+}
+
+/// Would the two lines render differently?
+static bool RendersDifferently(AssDialogueBase const& last, AssDialogueBase const& cur) {
+	if (last.Layer  != cur.Layer)  return true;
+	if (last.Margin != cur.Margin) return true;
+	if (last.Style  != cur.Style)  return true;
+	if (last.Effect != cur.Effect) return true;
+	if (last.Text   != cur.Text)   return true;
+
+	// Changing the start/end time effects the appearance only if the
+	// line is animated. This is obviously not a very accurate check for
+	// animated lines, but false positives aren't the end of the world
+	return (last.Start != cur.Start || last.End != cur.End) &&
+		(!cur.Effect.get().empty() || cur.Text.get().find('\\') != std::string::npos);
+}
+
+/// Hash of the fields of the lines which RendersDifferently always looks at
+///
+/// Equal flyweights share their value, so hashing the addresses is enough
+/// and doesn't need to look at the text at all.
+static size_t HashLines(std::vector<AssDialogueBase const*> const& lines) {
+	size_t hash = lines.size();
+	for (auto line : lines) {
+		boost::hash_combine(hash, line->Layer);
+		for (int margin : line->Margin)
+			boost::hash_combine(hash, margin);
+		boost::hash_combine(hash, &line->Style.get());
+		boost::hash_combine(hash, &line->Effect.get());
+		boost::hash_combine(hash, &line->Text.get());
+	}
+	return hash;
+}
+
 bool AsyncVideoProvider::NeedUpdate(std::vector<AssDialogueBase const*> const& visible_lines) {
 	// Always need to render after a seek
 	if (single_frame != NEW_SUBS_FILE || frame_number != last_rendered)
@@ -154,34 +359,65 @@ bool AsyncVideoProvider::NeedUpdate(std::vector<AssDialogueBase const*> const& v
 		return true;
 
 	for (size_t i = 0; i < last_lines.size(); ++i) {
-		auto const& last = last_lines[i];
-		auto const& cur = *visible_lines[i];
-		if (last.Layer  != cur.Layer)  return true;
-		if (last.Margin != cur.Margin) return true;
-		if (last.Style  != cur.Style)  return true;
-		if (last.Effect != cur.Effect) return true;
-		if (last.Text   != cur.Text)   return true;
-
-		// Changing the start/end time effects the appearance only if the
-		// line is animated. This is obviously not a very accurate check for
-		// animated lines, but false positives aren't the end of the world
-		if ((last.Start != cur.Start || last.End != cur.End) &&
-			(!cur.Effect.get().empty() || cur.Text.get().find('\\') != std::string::npos))
+		if (RendersDifferently(last_lines[i], *visible_lines[i]))
 			return true;
 	}
 
 	return false;
 }
 
+AsyncVideoProvider::RenderedFrame *AsyncVideoProvider::FindRendered(int frame_number, double time, size_t lines_hash, std::vector<AssDialogueBase const*> const& visible_lines) {
+	auto it = find_if(begin(rendered), end(rendered), [&](RenderedFrame const& r) {
+		if (r.frame_number != frame_number || r.time != time || r.lines_hash != lines_hash)
+			return false;
+		if (r.lines.size() != visible_lines.size())
+			return false;
+		for (size_t i = 0; i < visible_lines.size(); ++i) {
+			if (RendersDifferently(r.lines[i], *visible_lines[i]))
+				return false;
+		}
+		return true;
+	});
+	if (it == end(rendered)) return nullptr;
+
+	rendered.splice(begin(rendered), rendered, it); // Move to front
+	return &rendered.front();
+}
+
+void AsyncVideoProvider::StoreRendered(int frame_number, double time, size_t lines_hash, std::vector<AssDialogueBase> lines, std::shared_ptr<const VideoFrame> const& frame, std::shared_ptr<const VideoFrame> const& overlay, FrameTimings const& timings) {
+	const size_t max_size = OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20;
+	auto frame_size = [](RenderedFrame const& r) {
+		return r.frame->data.size() + (r.overlay ? r.overlay->data.size() : 0);
+	};
+
+	rendered.emplace_front();
+	auto& r = rendered.front();
+	r.frame_number = frame_number;
+	r.time = time;
+	r.lines_hash = lines_hash;
+	r.lines = std::move(lines);
+	r.frame = frame;
+	r.overlay = overlay;
+	r.timings = timings;
+	rendered_size += frame_size(r);
+
+	// Always keep the newest frame, even if it alone is over the limit
+	while (rendered_size > max_size && rendered.size() > 1) {
+		rendered_size -= frame_size(rendered.back());
+		rendered.pop_back();
+	}
+}
+
+void AsyncVideoProvider::ClearRendered() {
+	rendered.clear();
+	rendered_size = 0;
+}
+
 void AsyncVideoProvider::ProcAsync(uint_fast32_t req_version, bool check_updated) {
 	// Only actually produce the frame if there's no queued changes waiting
 	if (req_version < version || frame_number < 0) return;
 
-	std::vector<AssDialogueBase const*> visible_lines;
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && !(line.Start > time || line.End <= time))
-			visible_lines.push_back(&line);
-	}
+	auto visible_lines = VisibleLines(*subs, time);
 
 	if (check_updated && !NeedUpdate(visible_lines)) return;
 
@@ -192,24 +428,256 @@ void AsyncVideoProvider::ProcAsync(uint_fast32_t req_version, bool check_updated
 	last_rendered = frame_number;
 
 	try {
-		FrameReadyEvent *evt = new FrameReadyEvent(ProcFrame(frame_number, time), time);
+		// Scrubbing back and forth over the same frames finds them here with
+		// the subtitles already drawn
+		std::shared_ptr<const VideoFrame> frame, overlay;
+		FrameTimings timings;
+		size_t lines_hash = HashLines(visible_lines);
+		if (auto cached = FindRendered(frame_number, time, lines_hash, visible_lines)) {
+			frame = cached->frame;
+			overlay = cached->overlay;
+			timings = cached->timings;
+		}
+		else {
+			frame = ProcFrame(frame_number, time, false, &overlay, &timings);
+			StoreRendered(frame_number, time, lines_hash, last_lines, frame, overlay, timings);
+		}
+		FrameReadyEvent *evt = new FrameReadyEvent(std::move(frame), std::move(overlay), time, timings);
 		evt->SetEventType(EVT_FRAME_READY);
 		parent->QueueEvent(evt);
 	}
 	catch (wxEvent const& err) {
 		// Pass error back to parent thread
 		parent->QueueEvent(err.Clone());
+		return;
+	}
+
+	// Decoding ahead is only useful if the frames are kept somewhere, and
+	// if they don't push the frames around the current one out of the cache
+	if (source_provider->WantsCaching()) {
+		int64_t frame_size = (int64_t)GetWidth() * GetHeight() * 4;
+		int64_t cache_frames = (OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20) / std::max<int64_t>(frame_size, 1);
+		int count = (int)std::min<int64_t>(OPT_GET("Provider/Video/Prefetch")->GetInt(), cache_frames / 2);
+		Prefetch(req_version, frame_number + direction, count);
 	}
+
+	ScheduleRenderAhead();
+}
+
+void AsyncVideoProvider::PrefetchFrames(std::vector<int> frames) throw() {
+	uint_fast32_t req_version = version;
+	worker->Async([=]{
+		if (!source_provider->WantsCaching()) return;
+		for (int n : frames)
+			Prefetch(req_version, n, 1);
+	});
+}
+
+void AsyncVideoProvider::Prefetch(uint_fast32_t req_version, int n, int remaining) {
+	if (remaining <= 0 || n < 0 || n >= source_provider->GetFrameCount()) return;
+
+	worker->Async([=]{
+		if (req_version != version) return;
+
+		try {
+			source_provider->GetSharedFrame(n, pool);
+		}
+		catch (VideoProviderError const&) {
+			// The frame will be decoded again if it's actually requested, so
+			// the error can be reported then
+			return;
+		}
+
+		Prefetch(req_version, n + direction, remaining - 1);
+	});
+}
+
+struct AsyncVideoProvider::RenderAheadHelper {
+	std::unique_ptr<SubtitlesProvider> provider;
+	/// The copy of the subtitles last loaded into provider
+	std::shared_ptr<const AssFile> loaded;
+	/// Buffers for the frames this helper draws onto
+	VideoFramePool pool;
+	/// Is a frame being drawn right now? Only touched on the worker.
+	bool busy = false;
+};
+
+void AsyncVideoProvider::SubsChanged() {
+	++subs_generation;
+	subs_snapshot.reset();
 }
 
-std::shared_ptr<VideoFrame> AsyncVideoProvider::GetFrame(int frame, double time, bool raw) {
-	std::shared_ptr<VideoFrame> ret;
+void AsyncVideoProvider::RenderAhead(int first, int last, agi::vfr::Framerate const& fps) throw() {
+	worker->Async([=]{
+		size_t count = std::max<int64_t>(OPT_GET("Provider/Video/Render Ahead Threads")->GetInt(), 0);
+		if (helpers.size() != count && !render_ahead_jobs) {
+			helpers.clear();
+			for (size_t i = 0; i < count; ++i) {
+				auto helper = std::make_shared<RenderAheadHelper>();
+				try {
+					helper->provider = SubtitlesProviderFactory::GetProvider(br);
+				}
+				catch (...) {
+					// The error was already reported when the main provider
+					// was created, if it's going to happen every time
+					break;
+				}
+				helpers.push_back(std::move(helper));
+			}
+		}
+
+		render_ahead = true;
+		render_ahead_next = first;
+		render_ahead_last = last;
+		render_ahead_fps = fps;
+		ScheduleRenderAhead();
+	});
+}
+
+void AsyncVideoProvider::StopRenderAhead() throw() {
+	worker->Async([=]{
+		render_ahead = false;
+		QueueThumbnail();
+	});
+}
+
+void AsyncVideoProvider::QueueThumbnail() {
+	if (!thumbnails || thumbnail_queued || thumbnails_stopped || render_ahead) return;
+	if (thumbnail_next >= thumbnail_order.size()) return;
+
+	thumbnail_queued = true;
+	worker->Async([=]{
+		thumbnail_queued = false;
+		if (thumbnails_stopped || render_ahead) return;
+
+		size_t i = thumbnail_order[thumbnail_next++];
+		try {
+			VideoFrame frame;
+			source_provider->GetFrameUncached(thumbnails->Frame(i), frame);
+			thumbnails->Store(i, frame);
+		}
+		catch (VideoProviderError const&) {
+			// A preview is missing a frame which can't be decoded, and that's
+			// reported if the frame itself is requested
+		}
+
+		QueueThumbnail();
+	});
+}
+
+void AsyncVideoProvider::ScheduleRenderAhead() {
+	if (!render_ahead || helpers.empty() || !subs_provider || !subs) return;
+
+	// Frames drawn further ahead than the rendered frame cache can hold
+	// would be thrown away before they're shown
+	int64_t frame_size = (int64_t)GetWidth() * GetHeight() * 4;
+	int64_t cache_frames = (OPT_GET("Provider/Video/Cache/Size")->GetInt() << 20) / std::max<int64_t>(frame_size, 1);
+	int max_ahead = (int)mid<int64_t>(1, cache_frames - 1, helpers.size() * 4);
+	int last = std::min(render_ahead_last, GetFrameCount() - 1);
+	render_ahead_next = std::max(render_ahead_next, frame_number + 1);
+
+	// The helpers draw on other threads while the worker goes on modifying
+	// subs, so they get a copy which is only replaced when subs change
+	if (!subs_snapshot) {
+		subs_snapshot = std::make_shared<const AssFile>(*subs);
+		// Lines cache their serialized form the first time it's asked for,
+		// so fill it in here rather than having the helpers race to do so
+		for (auto const& line : subs_snapshot->Events)
+			line.GetEntryData();
+	}
+
+	for (auto& helper : helpers) {
+		if (helper->busy) continue;
+
+		for (;;) {
+			if (render_ahead_next > last || render_ahead_next - frame_number > max_ahead)
+				return;
+
+			int n = render_ahead_next++;
+			double t = render_ahead_fps.TimeAtFrame(n);
+			auto visible_lines = VisibleLines(*subs, t);
+			size_t lines_hash = HashLines(visible_lines);
+			if (FindRendered(n, t, lines_hash, visible_lines))
+				continue;
+
+			StageTimer timer;
+			std::shared_ptr<const VideoFrame> source;
+			try {
+				source = source_provider->GetSharedFrame(n, pool);
+			}
+			catch (VideoProviderError const&) {
+				// Reported if and when playback actually gets to the frame
+				continue;
+			}
+			double decode_time = timer.Elapsed();
+
+			std::vector<AssDialogueBase> lines;
+			lines.reserve(visible_lines.size());
+			for (auto line : visible_lines)
+				lines.push_back(*line);
+
+			DrawAhead(helper, n, t, lines_hash, std::move(lines), std::move(source), decode_time);
+			break;
+		}
+	}
+}
+
+void AsyncVideoProvider::DrawAhead(std::shared_ptr<RenderAheadHelper> helper, int n, double t, size_t lines_hash, std::vector<AssDialogueBase> lines, std::shared_ptr<const VideoFrame> source, double decode_time) {
+	helper->busy = true;
+	++render_ahead_jobs;
+
+	bool draw_overlay = source->yuv && helper->provider->CanDrawOverlay();
+	auto snapshot = subs_snapshot;
+	auto generation = subs_generation;
+
+	agi::dispatch::Background().Async([=]{
+		std::shared_ptr<const VideoFrame> frame, overlay;
+		FrameTimings timings;
+		timings.frame = n;
+		timings.decode = decode_time;
+		agi::trace::Scope scope("draw ahead", "video");
+		try {
+			StageTimer timer;
+			if (helper->loaded != snapshot) {
+				helper->provider->LoadSubtitles(snapshot.get());
+				helper->loaded = snapshot;
+			}
+			timings.subtitles = timer.Restart();
+			auto drawn = PrepareFrame(helper->pool, *source, draw_overlay);
+			timings.blend = timer.Restart();
+			helper->provider->DrawSubtitles(*drawn, t / 1000.);
+			AddDrawTime(timings, timer.Restart(), helper->provider->BlendTime());
+			frame = draw_overlay ? source : drawn;
+			if (draw_overlay)
+				overlay = drawn;
+		}
+		catch (agi::Exception const&) {
+			// Drawn again when it's shown, which reports the error
+			frame.reset();
+		}
+
+		worker->Async([=]{
+			helper->busy = false;
+			--render_ahead_jobs;
+			if (frame && generation == subs_generation)
+				StoreRendered(n, t, lines_hash, lines, frame, overlay, timings);
+			ScheduleRenderAhead();
+		});
+	});
+}
+
+std::shared_ptr<const VideoFrame> AsyncVideoProvider::GetFrame(int frame, double time, bool raw) {
+	std::shared_ptr<const VideoFrame> ret;
 	worker->Sync([&]{ ret = ProcFrame(frame, time, raw); });
 	return ret;
 }
 
 void AsyncVideoProvider::SetColorSpace(std::string const& matrix) {
-	worker->Async([=] { source_provider->SetColorSpace(matrix); });
+	worker->Async([=] {
+		ClearRendered();
+		SubsChanged();
+		source_provider->SetColorSpace(matrix);
+	});
 }
 
 wxDEFINE_EVENT(EVT_FRAME_READY, FrameReadyEvent);
@@ -14,32 +14,41 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include "frame_timings.h"
 #include "include/aegisub/video_provider.h"
+#include "video_frame.h"
 
 #include <libaegisub/exception.h>
 #include <libaegisub/fs_fwd.h>
 
 #include <atomic>
+#include <list>
 #include <memory>
 #include <set>
+#include <vector>
 #include <wx/event.h>
 
 class AssDialogue;
 class AssFile;
+class AssFileSnapshot;
 class SubtitlesProvider;
 class VideoProvider;
 class VideoProviderError;
+class VideoThumbnails;
 struct AssDialogueBase;
 struct VideoFrame;
 namespace agi {
 	class BackgroundRunner;
-	namespace dispatch { class Queue; }
+	namespace dispatch { class CoalescingQueue; }
 }
 
 /// An asynchronous video decoding and subtitle rendering wrapper
 class AsyncVideoProvider {
-	/// Asynchronous work queue
-	std::unique_ptr<agi::dispatch::Queue> worker;
+	/// Asynchronous work queue. Seeks are queued under a key so that one
+	/// which hasn't started yet is dropped when the next arrives.
+	std::unique_ptr<agi::dispatch::CoalescingQueue> worker;
+	/// Keys for coalesced work on the worker
+	enum { REQUEST_FRAME };
 
 	/// Subtitles provider
 	std::unique_ptr<SubtitlesProvider> subs_provider;
@@ -47,12 +56,25 @@ class AsyncVideoProvider {
 	std::unique_ptr<VideoProvider> source_provider;
 	/// Event handler to send FrameReady events to
 	wxEvtHandler *parent;
+	/// Progress dialog for creating more subtitles providers
+	agi::BackgroundRunner *br;
 
 	int frame_number = -1; ///< Last frame number requested
 	double time = -1.; ///< Time of the frame to pass to the subtitle renderer
+	int direction = 1; ///< Direction of the last seek, for prefetching
 
 	/// Copy of the subtitles file to avoid having to touch the project context
 	std::unique_ptr<AssFile> subs;
+	/// Snapshot which subs currently matches, or nullptr if it has been
+	/// changed since and has to be replaced in full. Only used by the worker.
+	std::shared_ptr<const AssFileSnapshot> subs_loaded;
+	/// Last snapshot sent to the worker, which the next one shares lines
+	/// with. Only used by the main thread.
+	std::shared_ptr<const AssFileSnapshot> subs_latest;
+	/// The lines of subs in order, so that UpdateSubtitles can find a row
+	/// without walking the list. Only UpdateSubtitles changes the lines,
+	/// and anything else reloads the whole file.
+	std::vector<AssDialogue *> rows;
 
 	/// If >= 0, the subtitles provider current has just the lines visible on
 	/// that frame loaded. If -1, the entire file is loaded. If -2, the
@@ -63,20 +85,113 @@ class AsyncVideoProvider {
 	int last_rendered = -1;
 	/// Last rendered subtitles on that frame
 	std::vector<AssDialogueBase> last_lines;
+	/// The frame the subtitles provider last drew onto
+	std::shared_ptr<const VideoFrame> last_drawn;
+	/// The video frame under last_drawn
+	std::shared_ptr<const VideoFrame> last_drawn_source;
+	/// Was last_drawn a transparent overlay rather than the video itself?
+	bool last_drawn_overlay = false;
+
 	/// Check if we actually need to honor a frame request or if no visible
 	/// lines have actually changed
 	bool NeedUpdate(std::vector<AssDialogueBase const*> const& visible_lines);
 
-	std::shared_ptr<VideoFrame> ProcFrame(int frame, double time, bool raw = false);
+	/// A frame with the subtitles drawn on, and what was drawn
+	struct RenderedFrame {
+		int frame_number;
+		double time;
+		/// Hash of the visible lines, to skip comparing them for most entries
+		size_t lines_hash;
+		std::vector<AssDialogueBase> lines;
+		std::shared_ptr<const VideoFrame> frame;
+		std::shared_ptr<const VideoFrame> overlay;
+		/// How long it took to produce the frame when it was drawn
+		FrameTimings timings;
+	};
+
+	/// Recently rendered frames with the most recently used ones at the front
+	std::list<RenderedFrame> rendered;
+	/// Total size in bytes of the frames in rendered
+	size_t rendered_size = 0;
+
+	/// Find a rendered copy of a frame with the given lines on it
+	RenderedFrame *FindRendered(int frame_number, double time, size_t lines_hash, std::vector<AssDialogueBase const*> const& visible_lines);
+	/// Remember a rendered copy of a frame, within the video cache size
+	void StoreRendered(int frame_number, double time, size_t lines_hash, std::vector<AssDialogueBase> lines, std::shared_ptr<const VideoFrame> const& frame, std::shared_ptr<const VideoFrame> const& overlay, FrameTimings const& timings);
+	/// Forget all rendered frames
+	void ClearRendered();
+
+	/// A second subtitles provider which draws upcoming frames during playback
+	struct RenderAheadHelper;
+	std::vector<std::shared_ptr<RenderAheadHelper>> helpers;
+
+	bool render_ahead = false; ///< Is playback running, so upcoming frames should be drawn?
+	int render_ahead_next = 0; ///< Next frame to hand to a helper
+	int render_ahead_last = 0; ///< Last frame which playback will show
+	int render_ahead_jobs = 0; ///< Number of frames the helpers are drawing
+	agi::vfr::Framerate render_ahead_fps; ///< Timecodes to get the time of upcoming frames from
+
+	/// Incremented whenever frames which are being drawn ahead go out of date
+	uint_fast32_t subs_generation = 0;
+	/// Copy of subs which the helpers can read while the worker modifies subs
+	std::shared_ptr<const AssFile> subs_snapshot;
+
+	/// Note that subs or anything else which frames are drawn from changed
+	void SubsChanged();
+	/// Hand upcoming frames to any idle helpers
+	void ScheduleRenderAhead();
+	/// Have a helper draw a frame in the background and then store the result
+	void DrawAhead(std::shared_ptr<RenderAheadHelper> helper, int n, double t, size_t lines_hash, std::vector<AssDialogueBase> lines, std::shared_ptr<const VideoFrame> source, double decode_time);
+
+	/// Get a frame from the pool to draw the subtitles for source onto
+	/// @param draw_overlay Get a transparent frame rather than a copy of
+	///                     source, converted to BGRA if needed
+	static std::shared_ptr<VideoFrame> PrepareFrame(VideoFramePool &pool, VideoFrame const& source, bool draw_overlay);
+
+	/// @brief Get a frame with the subtitles drawn on
+	/// @param frame Frame number
+	/// @param time Time to render the subtitles at
+	/// @param raw Skip the subtitles
+	/// @param[out] overlay If not null and the frame is YUV, the subtitles
+	///                     may be drawn onto a separate transparent frame
+	///                     stored here rather than onto the frame itself
+	/// @param[out] timings If not null, how long each stage took
+	std::shared_ptr<const VideoFrame> ProcFrame(int frame, double time, bool raw = false, std::shared_ptr<const VideoFrame> *overlay = nullptr, FrameTimings *timings = nullptr);
 
 	/// Produce a frame if req_version is still the current version
 	void ProcAsync(uint_fast32_t req_version, bool check_updated);
 
+	/// @brief Decode frames ahead of the last requested one into the cache
+	/// @param req_version Version the prefetch was started for
+	/// @param n Frame to decode next
+	/// @param remaining Number of frames left to decode, including n
+	///
+	/// Each frame is a separate task on the worker queue so that requests
+	/// only ever wait for a single prefetched frame, and the prefetch stops
+	/// as soon as anything else is requested.
+	void Prefetch(uint_fast32_t req_version, int n, int remaining);
+
 	/// Monotonic counter used to drop frames when changes arrive faster than
 	/// they can be rendered
 	std::atomic<uint_fast32_t> version{ 0 };
 
-	std::vector<std::shared_ptr<VideoFrame>> buffers;
+	/// Buffers for decoded frames and frames which subtitles are drawn onto
+	VideoFramePool pool;
+
+	/// Thumbnails for previewing seeks, or nullptr if they're disabled
+	std::shared_ptr<VideoThumbnails> thumbnails;
+	/// Thumbnails left to build, in the order to build them
+	std::vector<size_t> thumbnail_order;
+	size_t thumbnail_next = 0; ///< Index in thumbnail_order of the next one to build
+	bool thumbnail_queued = false; ///< Is a thumbnail waiting on the worker queue?
+	bool thumbnails_stopped = false; ///< Set once the provider is being destroyed
+
+	/// @brief Build the next thumbnail as a task on the worker queue
+	///
+	/// Each task queues the next one once it's done, so that building them
+	/// only ever delays a frame request by one decode. Building pauses while
+	/// frames are being drawn ahead for playback.
+	void QueueThumbnail();
 
 public:
 	/// @brief Load the passed subtitle file
@@ -92,7 +207,7 @@ public:
 	///
 	/// This function only supports changes to existing lines, and not
 	/// insertions or deletions.
-	void UpdateSubtitles(const AssFile *subs, const AssDialogue *changes) throw();
+	void UpdateSubtitles(const AssFile *subs, std::vector<const AssDialogue *> const& changes) throw();
 
 	/// @brief Queue a request for a frame
 	/// @brief frame Frame number
@@ -102,11 +217,37 @@ public:
 	/// is no guarantee that the requested frame will ever actually be produced
 	void RequestFrame(int frame, double time) throw();
 
+	/// @brief Start drawing the subtitles onto upcoming frames in the background
+	/// @param first First frame to draw
+	/// @param last Last frame which will be requested
+	/// @param fps Timecodes to get the time of each frame from
+	///
+	/// Frames are drawn by separate subtitles providers on the background
+	/// thread pool and then kept with the rendered frames until requested.
+	void RenderAhead(int first, int last, agi::vfr::Framerate const& fps) throw();
+
+	/// Stop drawing frames ahead
+	void StopRenderAhead() throw();
+
+	/// @brief Decode some frames into the cache ahead of them being requested
+	/// @param frames Frame numbers, most wanted first
+	///
+	/// This is for places which know where the user is going to seek to
+	/// next. As with the frames decoded after each request, the prefetch
+	/// stops as soon as another frame is requested.
+	void PrefetchFrames(std::vector<int> frames) throw();
+
 	/// @brief Synchronously get a frame
 	/// @brief frame Frame number
 	/// @brief time  Exact start time of the frame in seconds
 	/// @brief raw   Get raw frame without subtitles
-	std::shared_ptr<VideoFrame> GetFrame(int frame, double time, bool raw = false);
+	std::shared_ptr<const VideoFrame> GetFrame(int frame, double time, bool raw = false);
+
+	/// @brief Get the thumbnails for previewing seeks
+	///
+	/// They are built in the background when the worker is otherwise idle,
+	/// so may not all be available yet. nullptr if they're disabled.
+	std::shared_ptr<VideoThumbnails> GetThumbnails() const { return thumbnails; }
 
 	/// Ask the video provider to change YCbCr matricies
 	void SetColorSpace(std::string const& matrix);
@@ -127,19 +268,24 @@ public:
 	/// @brief Constructor
 	/// @param videoFileName File to open
 	/// @param parent Event handler to send FrameReady events to
-	AsyncVideoProvider(agi::fs::path const& filename, std::string const& colormatrix, wxEvtHandler *parent, agi::BackgroundRunner *br);
+	/// @param build_thumbnails Build thumbnails for the seek bar if they're enabled
+	AsyncVideoProvider(agi::fs::path const& filename, std::string const& colormatrix, wxEvtHandler *parent, agi::BackgroundRunner *br, bool build_thumbnails = true);
 	~AsyncVideoProvider();
 };
 
 /// Event which signals that a requested frame is ready
 struct FrameReadyEvent final : public wxEvent {
 	/// Frame which is ready
-	std::shared_ptr<VideoFrame> frame;
+	std::shared_ptr<const VideoFrame> frame;
+	/// Subtitles to composite over a YUV frame, if they weren't drawn onto it
+	std::shared_ptr<const VideoFrame> overlay;
 	/// Time which was used for subtitle rendering
 	double time;
+	/// How long each stage of producing the frame took
+	FrameTimings timings;
 	wxEvent *Clone() const override { return new FrameReadyEvent(*this); };
-	FrameReadyEvent(std::shared_ptr<VideoFrame> frame, double time)
-	: frame(std::move(frame)), time(time) { }
+	FrameReadyEvent(std::shared_ptr<const VideoFrame> frame, std::shared_ptr<const VideoFrame> overlay, double time, FrameTimings const& timings)
+	: frame(std::move(frame)), overlay(std::move(overlay)), time(time), timings(timings) { }
 };
 
 // These exceptions are wxEvents so that they can be passed directly back to
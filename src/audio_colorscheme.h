@@ -34,6 +34,8 @@
 /// Manage colour schemes for the audio display
 
 
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 
 #include <wx/colour.h>
@@ -92,6 +94,30 @@ public:
 		pixel[2] = color[2];
 	}
 
+	/// @brief Map a run of floating point values to RGB
+	/// @param vals  [in] The values to map from
+	/// @param count Number of values
+	/// @param scale Factor to multiply each value by before mapping it
+	/// @param pixel [out] First byte of the pixel for the first value
+	/// @param step  Distance in bytes from each pixel to the next one
+	///
+	/// Does the same as calling map() for each value, but without redoing the
+	/// scaling setup and palette bounds for every pixel.
+	void map(const float *vals, size_t count, float scale, unsigned char *pixel, ptrdiff_t step) const
+	{
+		const float f = scale * factor;
+		const float max_index = static_cast<float>(factor);
+		const unsigned char *pal = palette.data();
+		for (size_t i = 0; i < count; ++i, pixel += step)
+		{
+			float index = std::min(std::max(vals[i] * f, 0.f), max_index);
+			const unsigned char *color = pal + static_cast<size_t>(index) * 3;
+			pixel[0] = color[0];
+			pixel[1] = color[1];
+			pixel[2] = color[2];
+		}
+	}
+
 	/// @brief Get a floating point value's colour as a wxColour
 	/// @param val The value to map from
 	/// @return The corresponding wxColour
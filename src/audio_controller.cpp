@@ -36,15 +36,18 @@
 #include "project.h"
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/log.h>
 
 #include <algorithm>
 
 AudioController::AudioController(agi::Context *context)
 : context(context)
 , playback_timer(this)
+, scrub_timer(this)
 , provider_connection(context->project->AddAudioProviderListener(&AudioController::OnAudioProvider, this))
 {
 	Bind(wxEVT_TIMER, &AudioController::OnPlaybackTimer, this, playback_timer.GetId());
+	Bind(wxEVT_TIMER, &AudioController::OnScrubTimer, this, scrub_timer.GetId());
 
 #ifdef wxHAS_POWER_EVENTS
 	Bind(wxEVT_POWER_SUSPENDED, &AudioController::OnComputerSuspending, this);
@@ -71,12 +74,42 @@ void AudioController::OnPlaybackTimer(wxTimerEvent &)
 		// otherwise a popping artifact can sometimes be heard.
 		Stop();
 	}
-	else
+	else if (playback_mode != PM_Scrub)
 	{
 		AnnouncePlaybackPosition(MillisecondsFromSamples(pos));
 	}
 }
 
+void AudioController::OnScrubTimer(wxTimerEvent &)
+{
+	// Don't cut off anything else which was started since the last grain
+	if (playback_mode == PM_Scrub || playback_mode == PM_NotPlaying)
+		StartScrubGrain();
+}
+
+void AudioController::StartScrubGrain()
+{
+	if (!player || scrub_position == scrub_played) return;
+
+	int grain = OPT_GET("Audio/Scrub/Grain Length")->GetInt();
+	player->SetFade(SamplesFromMilliseconds(grain) / 4);
+	player->Play(SamplesFromMilliseconds(scrub_position), SamplesFromMilliseconds(grain));
+	playback_mode = PM_Scrub;
+	playback_timer.Start(20);
+	scrub_played = scrub_position;
+
+	// Overlap the grains so that there's no gap between them while the
+	// position keeps moving
+	scrub_timer.StartOnce(std::max(grain / 2, 1));
+}
+
+void AudioController::Scrub(int ms)
+{
+	scrub_position = ms;
+	if (!scrub_timer.IsRunning())
+		StartScrubGrain();
+}
+
 #ifdef wxHAS_POWER_EVENTS
 void AudioController::OnComputerSuspending(wxPowerEvent &)
 {
@@ -136,6 +169,7 @@ void AudioController::PlayRange(const TimeRange &range)
 {
 	if (!player) return;
 
+	player->SetFade(0);
 	player->Play(SamplesFromMilliseconds(range.begin()), SamplesFromMilliseconds(range.length()));
 	playback_mode = PM_Range;
 	playback_timer.Start(20);
@@ -143,6 +177,12 @@ void AudioController::PlayRange(const TimeRange &range)
 	AnnouncePlaybackPosition(range.begin());
 }
 
+void AudioController::PrefetchRange(const TimeRange &range)
+{
+	if (!provider) return;
+	provider->RequestDecode(SamplesFromMilliseconds(range.begin()), SamplesFromMilliseconds(range.length()));
+}
+
 void AudioController::PlayPrimaryRange()
 {
 	PlayRange(GetPrimaryPlaybackRange());
@@ -162,6 +202,7 @@ void AudioController::PlayToEnd(int start_ms)
 	if (!player) return;
 
 	int64_t start_sample = SamplesFromMilliseconds(start_ms);
+	player->SetFade(0);
 	player->Play(start_sample, provider->GetNumSamples()-start_sample);
 	playback_mode = PM_ToEnd;
 	playback_timer.Start(20);
@@ -174,6 +215,10 @@ void AudioController::Stop()
 	if (!player) return;
 
 	player->Stop();
+	// A grain which was waiting to start is no longer wanted either
+	scrub_played = scrub_position;
+	if (playback_mode != PM_NotPlaying && playback_mode != PM_Scrub)
+		LOG_I("audio/player") << player->GetName() << ": " << player->GetStats().Summary();
 	playback_mode = PM_NotPlaying;
 	playback_timer.Stop();
 
@@ -212,6 +257,21 @@ void AudioController::SetVolume(double volume)
 	player->SetVolume(volume);
 }
 
+bool AudioController::HasEnergyEnvelope() const
+{
+	return provider && provider->GetEnergyEnvelope();
+}
+
+int AudioController::FindSilenceEdge(int ms, int range, bool speech_start) const
+{
+	auto envelope = provider ? provider->GetEnergyEnvelope() : nullptr;
+	if (!envelope) return -1;
+
+	auto threshold = agi::AudioEnergyEnvelope::LevelFromDecibels(OPT_GET("Audio/Silence Threshold")->GetInt());
+	auto edge = envelope->FindEdge(SamplesFromMilliseconds(ms), SamplesFromMilliseconds(range), threshold, speech_start);
+	return edge < 0 ? -1 : static_cast<int>(MillisecondsFromSamples(edge));
+}
+
 int64_t AudioController::SamplesFromMilliseconds(int64_t ms) const
 {
 	if (!provider) return 0;
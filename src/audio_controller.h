@@ -75,7 +75,8 @@ class AudioController final : public wxEvtHandler {
 		PM_NotPlaying,
 		PM_Range,
 		PM_PrimaryRange,
-		PM_ToEnd
+		PM_ToEnd,
+		PM_Scrub
 	};
 	/// The current playback mode
 	PlaybackMode playback_mode = PM_NotPlaying;
@@ -83,6 +84,18 @@ class AudioController final : public wxEvtHandler {
 	/// Timer used for playback position updates
 	wxTimer playback_timer;
 
+	/// Timer which limits how often scrubbing starts a new grain
+	wxTimer scrub_timer;
+	/// Most recent position asked to be scrubbed, in milliseconds
+	int scrub_position = -1;
+	/// Position the last grain was played from, in milliseconds
+	int scrub_played = -1;
+
+	/// Play a grain from scrub_position if it has moved since the last one
+	void StartScrubGrain();
+	/// Event handler for the scrub timer
+	void OnScrubTimer(wxTimerEvent &event);
+
 	/// The audio provider
 	agi::AudioProvider *provider = nullptr;
 	agi::signal::Connection provider_connection;
@@ -133,6 +146,13 @@ public:
 	/// changed automatically from any other operations.
 	void PlayRange(const TimeRange &range);
 
+	/// @brief Ask for a range of audio to be decoded before it's played
+	/// @param range The range of audio which will be played soon
+	///
+	/// This only does anything for audio which is still being loaded into a
+	/// cache in the background.
+	void PrefetchRange(const TimeRange &range);
+
 	/// @brief Start or restart audio playback, playing the primary playback range
 	///
 	/// If the primary playback range is updated during playback, the end of
@@ -155,6 +175,15 @@ public:
 	/// or restarted.
 	void PlayToEnd(int start_ms);
 
+	/// @brief Play a short snippet of audio at a point which is being dragged around
+	/// @param ms Time in milliseconds to play at
+	///
+	/// This can be called for every mouse event. Snippets are started at most
+	/// twice per snippet length, each from the most recent position, and fade
+	/// in and out so that a run of them doesn't click. Nothing is restarted
+	/// if the position hasn't moved.
+	void Scrub(int ms);
+
 	/// @brief Stop all audio playback
 	void Stop();
 
@@ -176,6 +205,22 @@ public:
 	/// @param volume The new amplification factor for the audio
 	void SetVolume(double volume);
 
+	/// @brief Can FindSilenceEdge be used with the current audio?
+	///
+	/// Only audio which is being cached has an energy envelope to search.
+	bool HasEnergyEnvelope() const;
+
+	/// @brief Find the nearest point where speech starts or stops
+	/// @param ms Time to search around, in milliseconds
+	/// @param range Furthest from ms to look, in milliseconds
+	/// @param speech_start Look for the end of a silence rather than the start of one
+	/// @return Time of the boundary, or -1 if there isn't one in range
+	///
+	/// Silence is anything quieter than the Audio/Silence Threshold option.
+	/// This only looks at the cached energy envelope, so it's cheap enough
+	/// to call for every line in the file.
+	int FindSilenceEdge(int ms, int range, bool speech_start) const;
+
 	/// @brief Return the current timing controller
 	/// @return The current timing controller or 0
 	AudioTimingController *GetTimingController() const { return timing_controller.get(); }
@@ -50,7 +50,8 @@
 
 #include <algorithm>
 
-#include <wx/dcbuffer.h>
+#include <wx/dcclient.h>
+#include <wx/dcmemory.h>
 #include <wx/mousestate.h>
 
 /// @class AudioDisplayInteractionObject
@@ -533,6 +534,8 @@ class AudioMarkerInteractionObject final : public AudioDisplayInteractionObject
 	// Object-pair being interacted with
 	std::vector<AudioMarker*> markers;
 	AudioTimingController *timing_controller;
+	// Controller to scrub the audio with while dragging
+	AudioController *controller;
 	// Audio display drag is happening on
 	AudioDisplay *display;
 	// Mouse button used to initiate the drag
@@ -541,11 +544,14 @@ class AudioMarkerInteractionObject final : public AudioDisplayInteractionObject
 	bool default_snap = OPT_GET("Audio/Snap/Enable")->GetBool();
 	// Range in pixels to snap at
 	int snap_range = OPT_GET("Audio/Snap/Distance")->GetInt();
+	// Play the audio at the markers as they move
+	bool scrub = OPT_GET("Audio/Scrub/Enable")->GetBool();
 
 public:
-	AudioMarkerInteractionObject(std::vector<AudioMarker*> markers, AudioTimingController *timing_controller, AudioDisplay *display, wxMouseButton button_used)
+	AudioMarkerInteractionObject(std::vector<AudioMarker*> markers, AudioTimingController *timing_controller, AudioController *controller, AudioDisplay *display, wxMouseButton button_used)
 	: markers(std::move(markers))
 	, timing_controller(timing_controller)
+	, controller(controller)
 	, display(display)
 	, button_used(button_used)
 	{
@@ -559,6 +565,8 @@ public:
 				markers,
 				display->TimeFromRelativeX(event.GetPosition().x),
 				default_snap != event.ShiftDown() ? display->TimeFromAbsoluteX(snap_range) : 0);
+			if (scrub)
+				controller->Scrub(GetPosition());
 		}
 
 		// We lose the marker drag if the button used to initiate it goes up
@@ -597,6 +605,7 @@ AudioDisplay::AudioDisplay(wxWindow *parent, AudioController *controller, agi::C
 	Bind(wxEVT_LEAVE_WINDOW, &AudioDisplay::OnMouseLeave, this);
 	Bind(wxEVT_PAINT, &AudioDisplay::OnPaint, this);
 	Bind(wxEVT_SIZE, &AudioDisplay::OnSize, this);
+	Bind(wxEVT_IDLE, &AudioDisplay::OnIdle, this);
 	Bind(wxEVT_KILL_FOCUS, &AudioDisplay::OnFocus, this);
 	Bind(wxEVT_SET_FOCUS, &AudioDisplay::OnFocus, this);
 	Bind(wxEVT_CHAR_HOOK, &AudioDisplay::OnKeyDown, this);
@@ -743,7 +752,8 @@ void AudioDisplay::ReloadRenderingSettings()
 	if (OPT_GET("Audio/Spectrum")->GetBool())
 	{
 		colour_scheme_name = OPT_GET("Colour/Audio Display/Spectrum")->GetString();
-		auto audio_spectrum_renderer = agi::make_unique<AudioSpectrumRenderer>(colour_scheme_name);
+		auto audio_spectrum_renderer = agi::make_unique<AudioSpectrumRenderer>(colour_scheme_name,
+			provider ? context->project->AudioName() : agi::fs::path());
 
 		int64_t spectrum_quality = OPT_GET("Audio/Renderer/Spectrum/Quality")->GetInt();
 #ifdef WITH_FFTW3
@@ -760,11 +770,19 @@ void AudioDisplay::ReloadRenderingSettings()
 			spectrum_width[spectrum_quality],
 			spectrum_distance[spectrum_quality]);
 
+		// Missing blocks are drawn as placeholders while they're computed in
+		// the background, so redraw as they arrive
+		blocks_ready_connection = audio_spectrum_renderer->AddBlocksReadyListener([=] {
+			audio_renderer->Invalidate();
+			Refresh();
+		});
+
 		audio_renderer_provider = std::move(audio_spectrum_renderer);
 	}
 	else
 	{
 		colour_scheme_name = OPT_GET("Colour/Audio Display/Waveform")->GetString();
+		blocks_ready_connection = agi::signal::Connection();
 		audio_renderer_provider = agi::make_unique<AudioWaveformRenderer>(colour_scheme_name);
 	}
 
@@ -796,11 +814,18 @@ void AudioDisplay::OnLoadTimer(wxTimerEvent&)
 		const double left = last_sample_decoded * 1000.0 / provider->GetSampleRate() / ms_per_pixel;
 		const double right = new_decoded_count * 1000.0 / provider->GetSampleRate() / ms_per_pixel;
 
-		if (left < scroll_left + pixel_audio_width && right >= scroll_left)
+		// Looking past the decoded part makes the cache decode there first,
+		// so keep redrawing until what's visible has all been filled in
+		const int64_t visible_start = (int64_t)TimeFromAbsoluteX(scroll_left) * provider->GetSampleRate() / 1000;
+		const int64_t visible_end = (int64_t)TimeFromAbsoluteX(scroll_left + pixel_audio_width) * provider->GetSampleRate() / 1000;
+		const bool visible_decoded = provider->IsDecoded(visible_start, visible_end - visible_start);
+
+		if ((left < scroll_left + pixel_audio_width && right >= scroll_left) || !visible_decoded || !last_visible_decoded)
 			Refresh();
 		else
 			RefreshRect(scrollbar->GetBounds());
 		last_sample_decoded = new_decoded_count;
+		last_visible_decoded = visible_decoded;
 	}
 
 	if (!provider || last_sample_decoded == provider->GetNumSamples()) {
@@ -809,17 +834,60 @@ void AudioDisplay::OnLoadTimer(wxTimerEvent&)
 	}
 }
 
+void AudioDisplay::Refresh(bool erase_background, const wxRect *rect)
+{
+	backing_dirty.Union(rect ? *rect : GetClientRect());
+	wxWindow::Refresh(erase_background, rect);
+}
+
+void AudioDisplay::RefreshOverlay(wxRect const& rect)
+{
+	wxWindow::Refresh(false, &rect);
+}
+
 void AudioDisplay::OnPaint(wxPaintEvent&)
 {
+	wxPaintDC dc(this);
 	if (!audio_renderer_provider || !provider) return;
 
-	wxAutoBufferedPaintDC dc(this);
+	const wxSize size = GetClientSize();
+	if (size.x <= 0 || size.y <= 0) return;
+	if (!backing.IsOk() || backing.GetSize() != size)
+	{
+		backing.Create(size);
+		backing_dirty = wxRegion(GetClientRect());
+	}
+
+	wxMemoryDC backing_dc(backing);
+	if (!backing_dirty.IsEmpty())
+	{
+		// Clip so that markers and labels which cross the edge of a dirty
+		// area aren't drawn over their own undamaged copies
+		backing_dc.SetDeviceClippingRegion(backing_dirty);
+		PaintBacking(backing_dc, backing_dirty);
+		backing_dc.DestroyClippingRegion();
+		backing_dirty.Clear();
+	}
+
+	// Cursor movement only damages what it was drawn over, so this is
+	// usually just a couple of narrow strips
+	for (wxRegionIterator region(GetUpdateRegion()); region; ++region)
+	{
+		wxRect updrect = region.GetRect();
+		dc.Blit(updrect.x, updrect.y, updrect.width, updrect.height, &backing_dc, updrect.x, updrect.y);
+	}
+
+	if (track_cursor_pos >= 0)
+		PaintTrackCursor(dc);
+}
 
+void AudioDisplay::PaintBacking(wxDC &dc, wxRegion const& dirty)
+{
 	wxRect audio_bounds(0, audio_top, GetClientSize().GetWidth(), audio_height);
 	bool redraw_scrollbar = false;
 	bool redraw_timeline = false;
 
-	for (wxRegionIterator region(GetUpdateRegion()); region; ++region)
+	for (wxRegionIterator region(dirty); region; ++region)
 	{
 		wxRect updrect = region.GetRect();
 
@@ -838,9 +906,6 @@ void AudioDisplay::OnPaint(wxPaintEvent&)
 		}
 	}
 
-	if (track_cursor_pos >= 0)
-		PaintTrackCursor(dc);
-
 	if (redraw_scrollbar)
 		scrollbar->Paint(dc, HasFocus(), audio_load_position);
 	if (redraw_timeline)
@@ -866,6 +931,42 @@ void AudioDisplay::PaintAudio(wxDC &dc, const TimeRange updtime, const wxRect up
 	}
 }
 
+bool AudioDisplay::PrefetchRange(int start, int length, bool from_end)
+{
+	const int stop = std::min(start + length, pixel_audio_width);
+	start = std::max(start, 0);
+	if (start >= stop) return false;
+
+	struct Segment { int start, end; AudioRenderingStyle style; };
+	std::vector<Segment> segments;
+
+	const int end_time = TimeFromAbsoluteX(stop);
+	auto pt = begin(style_ranges), pe = end(style_ranges);
+	while (pt != pe && pt + 1 != pe && (pt + 1)->first < TimeFromAbsoluteX(start)) ++pt;
+
+	while (pt != pe && pt->first < end_time)
+	{
+		const auto range_style = static_cast<AudioRenderingStyle>(pt->second);
+		const int range_x1 = std::max(start, AbsoluteXFromTime(pt->first));
+		int range_x2 = stop;
+		if (++pt != pe)
+			range_x2 = std::min(range_x2, AbsoluteXFromTime(pt->first));
+
+		if (range_x2 > range_x1)
+			segments.push_back(Segment{range_x1, range_x2, range_style});
+	}
+
+	if (from_end)
+		std::reverse(segments.begin(), segments.end());
+
+	for (auto const& segment : segments)
+	{
+		if (audio_renderer->Prefetch(segment.start, segment.end - segment.start, segment.style, from_end))
+			return true;
+	}
+	return false;
+}
+
 void AudioDisplay::PaintMarkers(wxDC &dc, TimeRange updtime)
 {
 	AudioMarkerVector markers;
@@ -974,7 +1075,7 @@ void AudioDisplay::PaintTrackCursor(wxDC &dc) {
 	track_cursor_label_rect.SetPosition(label_pos);
 	track_cursor_label_rect.SetSize(label_size);
 	if (need_extra_redraw)
-		RefreshRect(track_cursor_label_rect, false);
+		RefreshOverlay(track_cursor_label_rect);
 }
 
 void AudioDisplay::SetDraggedObject(AudioDisplayInteractionObject *new_obj)
@@ -986,8 +1087,12 @@ void AudioDisplay::SetDraggedObject(AudioDisplayInteractionObject *new_obj)
 	else if (!dragged_object && HasCapture())
 		ReleaseMouse();
 
-	if (!dragged_object)
+	if (!dragged_object && audio_marker)
+	{
+		if (AudioTimingController *timing = controller->GetTimingController())
+			timing->OnMarkerDragEnd();
 		audio_marker.reset();
+	}
 }
 
 void AudioDisplay::SetTrackCursor(int new_pos, bool show_time)
@@ -997,18 +1102,18 @@ void AudioDisplay::SetTrackCursor(int new_pos, bool show_time)
 	int old_pos = track_cursor_pos;
 	track_cursor_pos = new_pos;
 
-	RefreshRect(wxRect(old_pos - scroll_left - 1, audio_top, 2, audio_height - 1), false);
-	RefreshRect(wxRect(new_pos - scroll_left - 1, audio_top, 2, audio_height - 1), false);
+	RefreshOverlay(wxRect(old_pos - scroll_left - 1, audio_top, 2, audio_height - 1));
+	RefreshOverlay(wxRect(new_pos - scroll_left - 1, audio_top, 2, audio_height - 1));
 
 	// Make sure the old label gets cleared away
-	RefreshRect(track_cursor_label_rect, false);
+	RefreshOverlay(track_cursor_label_rect);
 
 	if (show_time)
 	{
 		agi::Time new_label_time = TimeFromAbsoluteX(track_cursor_pos);
 		track_cursor_label = to_wx(new_label_time.GetAssFormatted());
 		track_cursor_label_rect.x += new_pos - old_pos;
-		RefreshRect(track_cursor_label_rect, false);
+		RefreshOverlay(track_cursor_label_rect);
 	}
 	else
 	{
@@ -1106,7 +1211,7 @@ void AudioDisplay::OnMouseEvent(wxMouseEvent& event)
 		if (markers.size())
 		{
 			RemoveTrackCursor();
-			audio_marker = agi::make_unique<AudioMarkerInteractionObject>(markers, timing, this, (wxMouseButton)event.GetButton());
+			audio_marker = agi::make_unique<AudioMarkerInteractionObject>(markers, timing, controller, this, (wxMouseButton)event.GetButton());
 			SetDraggedObject(audio_marker.get());
 			return;
 		}
@@ -1181,6 +1286,7 @@ void AudioDisplay::OnSize(wxSizeEvent &)
 	audio_height -= scrollbar->GetBounds().GetHeight();
 	audio_height -= timeline->GetHeight();
 	audio_renderer->SetHeight(audio_height);
+	audio_renderer->SetWidth(size.x);
 
 	audio_top = timeline->GetHeight();
 
@@ -1199,14 +1305,43 @@ int AudioDisplay::GetDuration() const
 	return (provider->GetNumSamples() * 1000 + provider->GetSampleRate() - 1) / provider->GetSampleRate();
 }
 
+void AudioDisplay::OnIdle(wxIdleEvent &event)
+{
+	if (!audio_renderer_provider || !provider) return;
+
+	const int client_width = GetClientSize().GetWidth();
+	if (client_width <= 0) return;
+
+	// During playback the view only ever scrolls forwards, so everything
+	// prefetched goes ahead of it. Otherwise the next scroll could go either
+	// way. Only as many screens as fit in the caches along with the visible
+	// one are prefetched, so that prefetching never evicts what's on screen.
+	const bool playing = controller && controller->IsPlaying();
+	const int spare_screens = audio_renderer->GetCacheCapacity() / client_width - 1;
+	const int screens = std::min(2, playing ? spare_screens : spare_screens / 2);
+
+	// Work outwards from the visible area, one bitmap per idle event
+	for (int screen = 0; screen < screens; ++screen)
+	{
+		if (PrefetchRange(scroll_left + (screen + 1) * client_width, client_width, false) ||
+			(!playing && PrefetchRange(scroll_left - (screen + 1) * client_width, client_width, true)))
+		{
+			event.RequestMore();
+			return;
+		}
+	}
+}
+
 void AudioDisplay::OnAudioOpen(agi::AudioProvider *provider)
 {
 	this->provider = provider;
 
-	if (!audio_renderer_provider)
-		ReloadRenderingSettings();
-
+	// The renderer is recreated for each audio file as the spectrum disk
+	// cache is tied to the file; detach it first so that the new one never
+	// sees the old provider, which has already been destroyed
+	audio_renderer->SetRenderer(nullptr);
 	audio_renderer->SetAudioProvider(provider);
+	ReloadRenderingSettings();
 	audio_renderer->SetCacheMaxSize(OPT_GET("Audio/Renderer/Spectrum/Memory Max")->GetInt() * 1024 * 1024);
 
 	timeline->ChangeAudio(GetDuration());
@@ -1254,6 +1389,7 @@ void AudioDisplay::OnTimingController()
 		timing_controller->AddMarkerMovedListener(&AudioDisplay::OnMarkerMoved, this);
 		timing_controller->AddUpdatedPrimaryRangeListener(&AudioDisplay::OnSelectionChanged, this);
 		timing_controller->AddUpdatedStyleRangesListener(&AudioDisplay::OnStyleRangesChanged, this);
+		timing_controller->AddUpdatedTimeRangeListener(&AudioDisplay::OnTimeRangeChanged, this);
 
 		OnStyleRangesChanged();
 		OnMarkerMoved();
@@ -1345,3 +1481,11 @@ void AudioDisplay::OnMarkerMoved()
 {
 	RefreshRect(wxRect(0, audio_top, GetClientSize().GetWidth(), audio_height), false);
 }
+
+void AudioDisplay::OnTimeRangeChanged(TimeRange range)
+{
+	// Pad by the size of the marker feet, which extend past the marker
+	const int left = RelativeXFromTime(range.begin()) - foot_size;
+	const int right = RelativeXFromTime(range.end()) + foot_size;
+	RefreshRect(wxRect(left, audio_top, right - left + 1, audio_height), false);
+}
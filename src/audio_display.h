@@ -34,7 +34,9 @@
 #include <cstdint>
 #include <memory>
 
+#include <wx/bitmap.h>
 #include <wx/gdicmn.h>
+#include <wx/region.h>
 #include <wx/string.h>
 #include <wx/timer.h>
 #include <wx/window.h>
@@ -64,6 +66,9 @@ class AudioMarkerInteractionObject;
 class AudioDisplay: public wxWindow {
 	agi::signal::Connection audio_open_connection;
 
+	/// Connection to the spectrum renderer's notifications of newly computed blocks
+	agi::signal::Connection blocks_ready_connection;
+
 	std::vector<agi::signal::Connection> connections;
 	agi::Context *context;
 
@@ -99,6 +104,8 @@ class AudioDisplay: public wxWindow {
 
 	wxTimer load_timer;
 	int64_t last_sample_decoded = 0;
+	/// Was all of the visible audio decoded on the last load timer tick?
+	bool last_visible_decoded = true;
 	/// Time at which audio loading began, for calculating loading speed
 	std::chrono::steady_clock::time_point audio_load_start_time;
 	/// Estimated speed of audio decoding in samples per ms
@@ -143,6 +150,15 @@ class AudioDisplay: public wxWindow {
 	/// @brief Remove the tracking cursor from the display
 	void RemoveTrackCursor();
 
+	/// Everything other than the tracking cursor as of the last paint, so
+	/// that moving the cursor only has to copy back what it covered
+	wxBitmap backing;
+	/// Parts of the backing store which are out of date
+	wxRegion backing_dirty;
+	/// Repaint part of the window from the backing store without redrawing
+	/// the audio there, for when only the tracking cursor has changed
+	void RefreshOverlay(wxRect const& rect);
+
 	/// Previous style ranges for optimizing redraw when ranges change
 	std::vector<std::pair<int, int>> style_ranges;
 
@@ -178,6 +194,18 @@ class AudioDisplay: public wxWindow {
 	/// @param dc DC to paint to
 	void PaintTrackCursor(wxDC &dc);
 
+	/// Paint everything other than the track cursor
+	/// @param dc DC to paint to
+	/// @param region Parts of the display to repaint
+	void PaintBacking(wxDC &dc, wxRegion const& region);
+
+	/// Render a bitmap of audio which isn't visible yet but may be soon
+	/// @param start    First absolute pixel of the range to fill
+	/// @param length   Number of pixels in the range
+	/// @param from_end Work from the end of the range towards its start
+	/// @return Whether anything was rendered
+	bool PrefetchRange(int start, int length, bool from_end);
+
 	/// Forward the mouse event to the appropriate child control, if any
 	/// @return Was the mouse event forwarded somewhere?
 	bool ForwardMouseEvent(wxMouseEvent &event);
@@ -199,17 +227,23 @@ class AudioDisplay: public wxWindow {
 
 	int GetDuration() const;
 
+	void OnIdle(wxIdleEvent &event);
 	void OnAudioOpen(agi::AudioProvider *provider);
 	void OnPlaybackPosition(int ms_position);
 	void OnSelectionChanged();
 	void OnStyleRangesChanged();
 	void OnTimingController();
 	void OnMarkerMoved();
+	void OnTimeRangeChanged(TimeRange range);
 
 public:
 	AudioDisplay(wxWindow *parent, AudioController *controller, agi::Context *context);
 	~AudioDisplay();
 
+	/// Invalidating any part of the display also marks it out of date in the
+	/// backing store
+	void Refresh(bool erase_background = true, const wxRect *rect = nullptr) override;
+
 	/// @brief Scroll the audio display
 	/// @param pixel_amount Number of pixels to scroll the view
 	///
@@ -213,13 +213,26 @@ void AudioKaraoke::RenderText() {
 	dc.SetPen(*wxTRANSPARENT_PEN);
 	dc.DrawRectangle(wxPoint(), bmp_size);
 
-	dc.SetFont(split_font);
-	dc.SetTextForeground(wxColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT)));
-
-	// Draw each character in the line
+	// Draw each syllable, reusing the ones which haven't changed
 	int y = (bmp_size.GetHeight() - char_height) / 2;
-	for (size_t i = 0; i < spaced_text.size(); ++i)
-		dc.DrawText(spaced_text[i], char_x[i], y);
+	if (strip_char_width != char_width || strip_height != bmp_size.GetHeight() || strip_y != y) {
+		syl_strips.clear();
+		strip_char_width = char_width;
+		strip_height = bmp_size.GetHeight();
+		strip_y = y;
+	}
+
+	decltype(syl_strips) strips;
+	for (size_t i = 0; i < syl_texts.size(); ++i) {
+		size_t begin = syl_start_points[i];
+		size_t end = i + 1 < syl_start_points.size() ? syl_start_points[i + 1] : spaced_text.size();
+
+		auto it = syl_strips.find(syl_texts[i]);
+		wxBitmap strip = it != syl_strips.end() ? it->second : RenderSyllable(begin, end, bmp_size.GetHeight(), y);
+		dc.DrawBitmap(strip, begin * char_width, 0);
+		strips.emplace(syl_texts[i], strip);
+	}
+	syl_strips = std::move(strips);
 
 	// Draw the lines between each syllable
 	dc.SetPen(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHT));
@@ -227,6 +240,24 @@ void AudioKaraoke::RenderText() {
 		dc.DrawLine(syl_line, 0, syl_line, bmp_size.GetHeight());
 }
 
+wxBitmap AudioKaraoke::RenderSyllable(size_t begin, size_t end, int height, int y) const {
+	wxBitmap strip((end - begin) * char_width, height);
+	wxMemoryDC dc(strip);
+
+	dc.SetBrush(wxBrush(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW)));
+	dc.SetPen(*wxTRANSPARENT_PEN);
+	dc.DrawRectangle(wxPoint(), strip.GetSize());
+
+	dc.SetFont(split_font);
+	dc.SetTextForeground(wxColour(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT)));
+
+	const int offset = begin * char_width;
+	for (size_t i = begin; i < end; ++i)
+		dc.DrawText(spaced_text[i], char_x[i] - offset, y);
+
+	return strip;
+}
+
 void AudioKaraoke::AddMenuItem(wxMenu &menu, std::string const& tag, wxString const& help, std::string const& selected) {
 	wxMenuItem *item = menu.AppendCheckItem(-1, to_wx(tag), help);
 	menu.Bind(wxEVT_MENU, std::bind(&AudioKaraoke::SetTagType, this, tag), item->GetId());
@@ -366,6 +397,7 @@ void AudioKaraoke::SetDisplayText() {
 	spaced_text.clear();
 	char_to_byte.clear();
 	syl_start_points.clear();
+	syl_texts.clear();
 	for (auto const& syl : *kara) {
 		// The last (and only the last) syllable needs the width of the final
 		// character in the syllable, so we unconditionally add it at the end
@@ -374,6 +406,7 @@ void AudioKaraoke::SetDisplayText() {
 			char_to_byte.pop_back();
 
 		syl_start_points.push_back(spaced_text.size());
+		syl_texts.push_back(syl.text);
 
 		// Add a space between each syllable to avoid crowding
 		spaced_text.emplace_back(wxS(" "));
@@ -82,6 +82,22 @@ class AudioKaraoke final : public wxWindow {
 	/// Indexes in spaced_text which are the beginning of syllables
 	std::vector<int> syl_start_points;
 
+	/// Text of each syllable, used to look up its rendered strip
+	std::vector<std::string> syl_texts;
+
+	/// Each syllable of the line rendered on its own, keyed by its text
+	///
+	/// Adding or removing a split only changes the syllables either side of
+	/// it, so the rest are copied from here rather than drawn again. Only
+	/// strips for the current syllables are kept.
+	std::unordered_map<std::string, wxBitmap> syl_strips;
+
+	/// Cell width, bitmap height and text offset the strips were rendered
+	/// for; if any of these change they all need redrawing
+	int strip_char_width = 0;
+	int strip_height = 0;
+	int strip_y = 0;
+
 	/// x coordinate in pixels of the separator lines of each syllable
 	std::vector<int> syl_lines;
 
@@ -125,6 +141,9 @@ class AudioKaraoke final : public wxWindow {
 	/// Prerender the current line along with syllable split lines
 	void RenderText();
 
+	/// Render the characters [begin, end) of spaced_text to their own bitmap
+	wxBitmap RenderSyllable(size_t begin, size_t end, int height, int y) const;
+
 	/// Refresh the area of the display around a single character
 	/// @param pos Index in spaced_text
 	void LimitedRefresh(int pos);
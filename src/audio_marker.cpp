@@ -69,8 +69,8 @@ void AudioMarkerProviderKeyframes::Update() {
 
 	markers.clear();
 	markers.reserve(keyframes.size());
-	for (int frame : keyframes)
-		markers.emplace_back(style.get(), timecodes.TimeAtFrame(frame, agi::vfr::START));
+	for (int time : timecodes.TimesAtFrames(keyframes, agi::vfr::START))
+		markers.emplace_back(style.get(), time);
 	AnnounceMarkerMoved();
 }
 
@@ -38,6 +38,8 @@
 #include "factory_manager.h"
 #include "options.h"
 
+#include <libaegisub/audio/provider.h>
+
 #include <boost/range/iterator_range.hpp>
 
 std::unique_ptr<AudioPlayer> CreateAlsaPlayer(agi::AudioProvider *providers, wxWindow *window);
@@ -47,6 +49,7 @@ std::unique_ptr<AudioPlayer> CreateOpenALPlayer(agi::AudioProvider *providers, w
 std::unique_ptr<AudioPlayer> CreatePortAudioPlayer(agi::AudioProvider *providers, wxWindow *window);
 std::unique_ptr<AudioPlayer> CreatePulseAudioPlayer(agi::AudioProvider *providers, wxWindow *window);
 std::unique_ptr<AudioPlayer> CreateOSSPlayer(agi::AudioProvider *providers, wxWindow *window);
+std::unique_ptr<AudioPlayer> CreateWasapiPlayer(agi::AudioProvider *providers, wxWindow *window);
 
 namespace {
 	struct factory {
@@ -63,6 +66,9 @@ namespace {
 		{"DirectSound-old", CreateDirectSoundPlayer, false},
 		{"DirectSound", CreateDirectSound2Player, false},
 #endif
+#ifdef WITH_WASAPI
+		{"WASAPI", CreateWasapiPlayer, false},
+#endif
 #ifdef WITH_OPENAL
 		{"OpenAL", CreateOpenALPlayer, false},
 #endif
@@ -78,6 +84,14 @@ namespace {
 	};
 }
 
+size_t AudioPlayer::GetReadAheadFrames() const {
+	return static_cast<size_t>(OPT_GET("Player/Audio/Read Ahead")->GetInt() * provider->GetSampleRate() / 1000);
+}
+
+bool AudioPlayer::IsLowLatency() {
+	return OPT_GET("Player/Audio/Low Latency")->GetBool();
+}
+
 std::vector<std::string> AudioPlayerFactory::GetClasses() {
 	return ::GetClasses(boost::make_iterator_range(std::begin(factories), std::end(factories)));
 }
@@ -92,7 +106,9 @@ std::unique_ptr<AudioPlayer> AudioPlayerFactory::GetAudioPlayer(agi::AudioProvid
 	std::string error;
 	for (auto factory : sorted) {
 		try {
-			return factory->create(provider, window);
+			auto player = factory->create(provider, window);
+			player->name = factory->name;
+			return player;
 		}
 		catch (AudioPlayerOpenError const& err) {
 			error += std::string(factory->name) + " factory: " + err.GetMessage() + "\n";
@@ -40,6 +40,7 @@
 #include "frame_main.h"
 #include "options.h"
 
+#include <libaegisub/audio/playback_feed.h>
 #include <libaegisub/audio/provider.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
@@ -73,12 +74,12 @@ class AlsaPlayer final : public AudioPlayer {
 
 	std::string device_name = OPT_GET("Player/Audio/ALSA/Device")->GetString();
 
+	/// Requested device buffer length in microseconds
+	unsigned int latency = IsLowLatency() ? 20*1000 : 100*1000;
+
 	Message message = Message::None;
 
 	std::atomic<bool> playing{false};
-	std::atomic<double> volume{1.0};
-	int64_t start_position = 0;
-	std::atomic<int64_t> end_position{0};
 
 	std::mutex position_mutex;
 	int64_t last_position = 0;
@@ -86,10 +87,17 @@ class AlsaPlayer final : public AudioPlayer {
 
 	std::vector<char> decode_buffer;
 
+	/// Reads ahead of the device so that slow decoding doesn't cause underruns
+	agi::AudioPlaybackFeed feed{provider, GetReadAheadFrames(), &stats};
+
 	std::thread thread;
 
 	void PlaybackThread();
 
+	/// Copy up to frames frames from the feed to the device
+	/// @return false if the device has failed
+	bool WriteFrames(snd_pcm_t *pcm, snd_pcm_sframes_t frames, size_t framesize);
+
 	void UpdatePlaybackPosition(snd_pcm_t *pcm, int64_t position)
 	{
 		snd_pcm_sframes_t delay;
@@ -109,12 +117,48 @@ public:
 	void Stop() override;
 	bool IsPlaying() override { return playing; }
 
-	void SetVolume(double vol) override { volume = vol; }
-	int64_t GetEndPosition() override { return end_position; }
+	void SetVolume(double vol) override { feed.SetVolume(vol); }
+	void SetFade(int64_t frames) override { feed.SetFade(frames); }
+	int64_t GetEndPosition() override { return feed.GetEndPosition(); }
 	int64_t GetCurrentPosition() override;
 	void SetEndPosition(int64_t pos) override;
 };
 
+bool AlsaPlayer::WriteFrames(snd_pcm_t *pcm, snd_pcm_sframes_t frames, size_t framesize)
+{
+	if (frames <= 0) return true;
+
+	decode_buffer.resize(frames * framesize);
+	frames = feed.Read(decode_buffer.data(), frames);
+
+	const char *data = decode_buffer.data();
+	while (frames > 0)
+	{
+		snd_pcm_sframes_t written = snd_pcm_writei(pcm, data, frames);
+		if (written == -ESTRPIPE || written == -EPIPE)
+		{
+			if (written == -EPIPE)
+				stats.AddUnderrun();
+			if (snd_pcm_recover(pcm, written, 0) < 0)
+				return false;
+		}
+		else if (written == 0)
+			break;
+		else if (written < 0)
+		{
+			LOG_D("audio/player/alsa") << "error filling buffer, written=" << written;
+			return false;
+		}
+		else
+		{
+			stats.AudioWritten();
+			data += written * framesize;
+			frames -= written;
+		}
+	}
+	return true;
+}
+
 void AlsaPlayer::PlaybackThread()
 {
 	std::unique_lock<std::mutex> lock(mutex);
@@ -146,12 +190,14 @@ do_setup:
 	                       provider->GetChannels(),
 	                       provider->GetSampleRate(),
 	                       1, // allow resample
-	                       100*1000 // 100 milliseconds latency
+	                       latency
 	                      ) != 0)
 		return;
 	LOG_D("audio/player/alsa") << "set pcm params";
 
 	size_t framesize = provider->GetChannels() * provider->GetBytesPerSample();
+	// Wake up four times per device buffer to top it up
+	auto period = std::chrono::microseconds{latency / 4};
 
 	while (true)
 	{
@@ -161,7 +207,7 @@ do_setup:
 			cond.wait(lock, [&] { return message != Message::None; });
 			if (message == Message::Close)
 				return;
-			if (message == Message::Start && end_position > start_position)
+			if (message == Message::Start && !feed.AtEnd())
 				break;
 			// Not playing, so don't need to stop...
 			message = Message::None;
@@ -169,40 +215,34 @@ do_setup:
 		message = Message::None;
 
 		LOG_D("audio/player/alsa") << "starting playback";
-		int64_t position = start_position;
+
+		// Give the feed a chance to get ahead before starting the device, but
+		// without holding up any further messages
+		auto avail = snd_pcm_avail(pcm);
+		lock.unlock();
+		feed.WaitForPrefill(std::max<snd_pcm_sframes_t>(avail, 0), std::chrono::milliseconds{500});
+		lock.lock();
+		if (message != Message::None)
+			continue;
 
 		// Initial buffer-fill
+		if (!WriteFrames(pcm, snd_pcm_avail(pcm), framesize))
 		{
-			auto avail = std::min(snd_pcm_avail(pcm), (snd_pcm_sframes_t)(end_position-position));
-			decode_buffer.resize(avail * framesize);
-			provider->GetAudioWithVolume(decode_buffer.data(), position, avail, volume);
-
-			snd_pcm_sframes_t written = 0;
-			while (written <= 0)
-			{
-				written = snd_pcm_writei(pcm, decode_buffer.data(), avail);
-				if (written == -ESTRPIPE)
-					snd_pcm_recover(pcm, written, 0);
-				else if (written <= 0)
-				{
-					LOG_D("audio/player/alsa") << "error filling buffer";
-					return;
-				}
-			}
-			position += written;
+			LOG_D("audio/player/alsa") << "error filling buffer";
+			return;
 		}
 
 		// Start playback
 		LOG_D("audio/player/alsa") << "initial buffer filled, hitting start";
 		snd_pcm_start(pcm);
 
-		UpdatePlaybackPosition(pcm, position);
+		UpdatePlaybackPosition(pcm, feed.GetReadPosition());
 		playing = true;
 		BOOST_SCOPE_EXIT_ALL(&) { playing = false; };
 		while (true)
 		{
 			// Sleep a bit, or until an event
-			cond.wait_for(lock, std::chrono::milliseconds{25});
+			cond.wait_for(lock, period);
 
 			if (message == Message::Close)
 			{
@@ -219,9 +259,11 @@ do_setup:
 			}
 
 			// Fill buffer
+			auto fill_start = agi::AudioPlaybackStats::Now();
 			snd_pcm_sframes_t tmp_pcm_avail = snd_pcm_avail(pcm);
 			if (tmp_pcm_avail == -EPIPE)
 			{
+				stats.AddUnderrun();
 				if (snd_pcm_recover(pcm, -EPIPE, 1) < 0)
 				{
 					LOG_D("audio/player/alsa") << "failed to recover from underrun";
@@ -229,34 +271,19 @@ do_setup:
 				}
 				tmp_pcm_avail = snd_pcm_avail(pcm);
 			}
-			auto avail = std::min(tmp_pcm_avail, (snd_pcm_sframes_t)(end_position-position));
-			if (avail < 0)
+			if (tmp_pcm_avail < 0)
 				continue;
 
-			{
-				decode_buffer.resize(avail * framesize);
-				provider->GetAudioWithVolume(decode_buffer.data(), position, avail, volume);
-				snd_pcm_sframes_t written = 0;
-				while (written <= 0)
-				{
-					written = snd_pcm_writei(pcm, decode_buffer.data(), avail);
-					if (written == -ESTRPIPE || written == -EPIPE)
-						snd_pcm_recover(pcm, written, 0);
-					else if (written == 0)
-						break;
-					else if (written < 0)
-					{
-						LOG_D("audio/player/alsa") << "error filling buffer, written=" << written;
-						return;
-					}
-				}
-				position += written;
-			}
+			// If the feed has fallen behind this writes what it has rather
+			// than waiting on the provider
+			if (!WriteFrames(pcm, tmp_pcm_avail, framesize))
+				return;
+			stats.AddCallback(fill_start);
 
-			UpdatePlaybackPosition(pcm, position);
+			UpdatePlaybackPosition(pcm, feed.GetReadPosition());
 
 			// Check for end of playback
-			if (position >= end_position)
+			if (feed.AtEnd())
 			{
 				LOG_D("audio/player/alsa") << "playback loop, past end, draining";
 				snd_pcm_drain(pcm);
@@ -311,10 +338,11 @@ AlsaPlayer::~AlsaPlayer()
 
 void AlsaPlayer::Play(int64_t start, int64_t count)
 {
+	// The playback thread only reads from the feed while holding the mutex
 	std::unique_lock<std::mutex> lock(mutex);
 	message = Message::Start;
-	start_position = start;
-	end_position = start + count;
+	stats.PlayStarted();
+	feed.Start(start, start + count);
 	cond.notify_all();
 }
 
@@ -322,13 +350,13 @@ void AlsaPlayer::Stop()
 {
 	std::unique_lock<std::mutex> lock(mutex);
 	message = Message::Stop;
+	feed.Stop();
 	cond.notify_all();
 }
 
 void AlsaPlayer::SetEndPosition(int64_t pos)
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	end_position = pos;
+	feed.SetEndPosition(pos);
 }
 
 int64_t AlsaPlayer::GetCurrentPosition()
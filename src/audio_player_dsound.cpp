@@ -155,6 +155,7 @@ DirectSoundPlayer::~DirectSoundPlayer() {
 
 bool DirectSoundPlayer::FillBuffer(bool fill) {
 	if (playPos >= endPos) return false;
+	auto fill_start = agi::AudioPlaybackStats::Now();
 
 	// Variables
 	HRESULT res;
@@ -223,11 +224,17 @@ RetryLock:
 	LOG_D_IF(!count1 && !count2, "audio/player/dsound1") << "DS fill: nothing";
 
 	// Get source wave
+	auto read_start = agi::AudioPlaybackStats::Now();
 	if (count1) provider->GetAudioWithVolume(ptr1, playPos, count1, volume);
 	if (count2) provider->GetAudioWithVolume(ptr2, playPos+count1, count2, volume);
 	playPos += count1+count2;
+	if (count1 + count2) {
+		stats.AddProviderRead(read_start);
+		stats.AudioWritten();
+	}
 
 	buffer->Unlock(ptr1,count1*bytesps,ptr2,count2*bytesps);
+	stats.AddCallback(fill_start);
 
 	offset = (offset + count1*bytesps + count2*bytesps) % bufSize;
 
@@ -245,6 +252,7 @@ void DirectSoundPlayer::Play(int64_t start,int64_t count) {
 	assert(buffer);
 
 	// Set variables
+	stats.PlayStarted();
 	startPos = start;
 	endPos = start+count;
 	playPos = start;
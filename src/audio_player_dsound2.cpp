@@ -238,12 +238,16 @@ class DirectSoundPlayer2Thread {
 	/// Audio provider to take sample data from
 	agi::AudioProvider *provider;
 
+	/// Owning player's timing counters
+	agi::AudioPlaybackStats *stats;
+
 public:
 	/// @brief Constructor, creates and starts playback thread
 	/// @param provider       Audio provider to take sample data from
 	/// @param WantedLatency Desired length in milliseconds to write ahead of the playback cursor
 	/// @param BufferLength  Multiplier for WantedLatency to get total buffer length
-	DirectSoundPlayer2Thread(agi::AudioProvider *provider, int WantedLatency, int BufferLength, wxWindow *parent);
+	/// @param stats         Timing counters to update while playing
+	DirectSoundPlayer2Thread(agi::AudioProvider *provider, int WantedLatency, int BufferLength, wxWindow *parent, agi::AudioPlaybackStats *stats);
 	/// @brief Destructor, waits for thread to have died
 	~DirectSoundPlayer2Thread();
 
@@ -580,6 +584,7 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 	DWORD bytes_per_frame = provider->GetChannels() * provider->GetBytesPerSample();
 	DWORD buf1szf = buf1sz / bytes_per_frame;
 	DWORD buf2szf = buf2sz / bytes_per_frame;
+	auto fill_start = agi::AudioPlaybackStats::Now();
 
 	if (input_frame >= end_frame)
 	{
@@ -608,7 +613,9 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 			buf2sz = 0;
 		}
 
+		auto read_start = agi::AudioPlaybackStats::Now();
 		provider->GetAudioWithVolume(buf1, input_frame, buf1szf, volume);
+		stats->AddProviderRead(read_start);
 
 		input_frame += buf1szf;
 	}
@@ -621,12 +628,17 @@ DWORD DirectSoundPlayer2Thread::FillAndUnlockBuffers(void *buf1, DWORD buf1sz, v
 			buf2sz = buf2szf * bytes_per_frame;
 		}
 
+		auto read_start = agi::AudioPlaybackStats::Now();
 		provider->GetAudioWithVolume(buf2, input_frame, buf2szf, volume);
+		stats->AddProviderRead(read_start);
 
 		input_frame += buf2szf;
 	}
 
 	bfr->Unlock(buf1, buf1sz, buf2, buf2sz); // bad? should check for success
+	if (buf1sz + buf2sz)
+		stats->AudioWritten();
+	stats->AddCallback(fill_start);
 
 	return buf1sz + buf2sz;
 }
@@ -659,7 +671,7 @@ void DirectSoundPlayer2Thread::CheckError()
 	}
 }
 
-DirectSoundPlayer2Thread::DirectSoundPlayer2Thread(agi::AudioProvider *provider, int WantedLatency, int BufferLength, wxWindow *parent)
+DirectSoundPlayer2Thread::DirectSoundPlayer2Thread(agi::AudioProvider *provider, int WantedLatency, int BufferLength, wxWindow *parent, agi::AudioPlaybackStats *stats)
 : parent((HWND)parent->GetHandle())
 , event_start_playback  (CreateEvent(0, FALSE, FALSE, 0))
 , event_stop_playback   (CreateEvent(0, FALSE, FALSE, 0))
@@ -672,6 +684,7 @@ DirectSoundPlayer2Thread::DirectSoundPlayer2Thread(agi::AudioProvider *provider,
 , wanted_latency(WantedLatency)
 , buffer_length(BufferLength)
 , provider(provider)
+, stats(stats)
 {
 	thread_handle = (HANDLE)_beginthreadex(0, 0, ThreadProc, this, 0, 0);
 
@@ -814,7 +827,7 @@ DirectSoundPlayer2::DirectSoundPlayer2(agi::AudioProvider *provider, wxWindow *p
 
 	try
 	{
-		thread = agi::make_unique<DirectSoundPlayer2Thread>(provider, WantedLatency, BufferLength, parent);
+		thread = agi::make_unique<DirectSoundPlayer2Thread>(provider, WantedLatency, BufferLength, parent, &stats);
 	}
 	catch (const char *msg)
 	{
@@ -841,6 +854,7 @@ void DirectSoundPlayer2::Play(int64_t start,int64_t count)
 {
 	try
 	{
+		stats.PlayStarted();
 		thread->Play(start, count);
 	}
 	catch (const char *msg)
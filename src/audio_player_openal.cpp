@@ -199,6 +199,7 @@ void OpenALPlayer::Play(int64_t start, int64_t count)
 	cur_frame = start;
 	end_frame = start + count;
 	playing = true;
+	stats.PlayStarted();
 
 	// Prepare buffers
 	buffers_free = num_buffers;
@@ -235,13 +236,17 @@ void OpenALPlayer::Stop()
 void OpenALPlayer::FillBuffers(ALsizei count)
 {
 	InitContext();
+	auto fill_start = agi::AudioPlaybackStats::Now();
 	// Do the actual filling/queueing
 	for (count = mid(1, count, buffers_free); count > 0; --count) {
 		ALsizei fill_len = mid<ALsizei>(0, decode_buffer.size() / bpf, end_frame - cur_frame);
 
-		if (fill_len > 0)
+		if (fill_len > 0) {
 			// Get fill_len frames of audio
+			auto read_start = agi::AudioPlaybackStats::Now();
 			provider->GetAudioWithVolume(&decode_buffer[0], cur_frame, fill_len, volume);
+			stats.AddProviderRead(read_start);
+		}
 		if ((size_t)fill_len * bpf < decode_buffer.size())
 			// And zerofill the rest
 			memset(&decode_buffer[fill_len * bpf], 0, decode_buffer.size() - fill_len * bpf);
@@ -252,7 +257,10 @@ void OpenALPlayer::FillBuffers(ALsizei count)
 		alSourceQueueBuffers(source, 1, &buffers[buf_first_free]); // FIXME: collect buffer handles and queue all at once instead of one at a time?
 		buf_first_free = (buf_first_free + 1) % num_buffers;
 		--buffers_free;
+		if (fill_len > 0)
+			stats.AudioWritten();
 	}
+	stats.AddCallback(fill_start);
 }
 
 void OpenALPlayer::Notify()
@@ -264,6 +272,10 @@ void OpenALPlayer::Notify()
 
 	LOG_D("player/audio/openal") << "buffers_played=" << buffers_played << " newplayed=" << newplayed;
 
+	// Every buffer finished before this got to refill any of them
+	if (newplayed == num_buffers && cur_frame < end_frame)
+		stats.AddUnderrun();
+
 	if (newplayed > 0) {
 		// Reclaim buffers
 		ALuint bufs[num_buffers];
@@ -38,6 +38,7 @@
 #include "options.h"
 #include "utils.h"
 
+#include <libaegisub/audio/playback_feed.h>
 #include <libaegisub/audio/provider.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
@@ -68,17 +69,14 @@ class OSSPlayer final : public AudioPlayer {
     /// Is the player currently playing?
     volatile bool playing = false;
 
-    /// Current volume level
-    volatile float volume = 1.f;
-
     /// first frame of playback
     volatile unsigned long start_frame = 0;
 
     /// last written frame + 1
     volatile unsigned long cur_frame = 0;
 
-    /// last frame to play
-    volatile unsigned long end_frame = 0;
+    /// Reads ahead of the worker thread so that it isn't held up by decoding
+    agi::AudioPlaybackFeed feed{provider, GetReadAheadFrames(), &stats};
 
     /// bytes per frame
     unsigned long bpf = 0;
@@ -104,12 +102,13 @@ public:
     void Stop();
     bool IsPlaying() { return playing; }
 
-    int64_t GetEndPosition() { return end_frame; }
+    int64_t GetEndPosition() { return feed.GetEndPosition(); }
     void SetEndPosition(int64_t pos);
 
     int64_t GetCurrentPosition();
 
-    void SetVolume(double vol) { volume = vol; }
+    void SetVolume(double vol) { feed.SetVolume(vol); }
+    void SetFade(int64_t frames) { feed.SetFade(frames); }
 };
 
 /// Worker thread to asynchronously write audio data to the output device
@@ -126,18 +125,28 @@ public:
     wxThread::ExitCode Entry() {
         // Use small enough writes for good timing accuracy with all
         // timing methods.
-        const unsigned long wsize = parent->rate / 25;
+        const unsigned long wsize = parent->rate / (OSSPlayer::IsLowLatency() ? 100 : 25);
         void *buf = malloc(wsize * parent->bpf);
 
-        while (!TestDestroy() && parent->cur_frame < parent->end_frame) {
-            int rsize = std::min(wsize, parent->end_frame - parent->cur_frame);
-            parent->provider->GetAudioWithVolume(buf, parent->cur_frame,
-                                                 rsize, parent->volume);
+        auto &feed = parent->feed;
+        while (!TestDestroy() && !feed.AtEnd()) {
+            // write() blocks until the device has room, so only the time
+            // spent getting the audio counts as the callback
+            auto callback_start = agi::AudioPlaybackStats::Now();
+            size_t rsize = feed.Read(buf, wsize);
+            parent->stats.AddCallback(callback_start);
+            if (rsize == 0) {
+                // Fallen behind, so wait for the feed rather than the provider
+                feed.WaitForPrefill(wsize, std::chrono::milliseconds{10});
+                continue;
+            }
             int written = ::write(parent->dspdev, buf, rsize * parent->bpf);
+            if (written > 0)
+                parent->stats.AudioWritten();
             parent->cur_frame += written / parent->bpf;
         }
         free(buf);
-        parent->cur_frame = parent->end_frame;
+        parent->cur_frame = feed.GetEndPosition();
 
         LOG_D("player/audio/oss") << "Thread dead";
         return 0;
@@ -157,7 +166,7 @@ void OSSPlayer::OpenStream()
 
     // Use a reasonable buffer policy for low latency (OSS4)
 #ifdef SNDCTL_DSP_POLICY
-    int policy = 3;
+    int policy = IsLowLatency() ? 1 : 3;
     ioctl(dspdev, SNDCTL_DSP_POLICY, &policy);
 #endif
 
@@ -196,7 +205,8 @@ void OSSPlayer::Play(int64_t start, int64_t count)
     Stop();
 
     start_frame = cur_frame = start;
-    end_frame = start + count;
+    stats.PlayStarted();
+    feed.Start(start, start + count);
 
     thread = agi::make_unique<OSSPlayerThread>(this);
     thread->Create();
@@ -225,12 +235,12 @@ void OSSPlayer::Stop()
     playing = false;
     start_frame = 0;
     cur_frame = 0;
-    end_frame = 0;
+    feed.Stop();
 }
 
 void OSSPlayer::SetEndPosition(int64_t pos)
 {
-    end_frame = pos;
+    feed.SetEndPosition(pos);
 
     if (pos <= GetCurrentPosition()) {
         ioctl(dspdev, SNDCTL_DSP_RESET, nullptr);
@@ -267,7 +277,7 @@ int64_t OSSPlayer::GetCurrentPosition()
 
         LOG_D("player/audio/oss") << "cur_frame: " << cur_frame << " delay " << delay;
         // delay can jitter a bit at the end, detect that
-        if (cur_frame == end_frame && delay < rate / 20) {
+        if (cur_frame == (unsigned long)feed.GetEndPosition() && delay < rate / 20) {
             return cur_frame;
         }
         return MAX(0, (long) cur_frame - delay);
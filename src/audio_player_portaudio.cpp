@@ -174,6 +174,7 @@ void PortAudioPlayer::paStreamFinishedCallback(void *) {
 }
 
 void PortAudioPlayer::Play(int64_t start_sample, int64_t count) {
+	stats.PlayStarted();
 	current = start_sample;
 	start = start_sample;
 	end = start_sample + count;
@@ -204,6 +205,9 @@ int PortAudioPlayer::paCallback(const void *inputBuffer, void *outputBuffer,
 	PaStreamCallbackFlags statusFlags, void *userData)
 {
 	PortAudioPlayer *player = (PortAudioPlayer *)userData;
+	auto callback_start = agi::AudioPlaybackStats::Now();
+	if (statusFlags & paOutputUnderflow)
+		player->stats.AddUnderrun();
 
 #ifdef PORTAUDIO_DEBUG
 	LOG_D("audio/player/portaudio") << "psCallback:"
@@ -223,9 +227,12 @@ int PortAudioPlayer::paCallback(const void *inputBuffer, void *outputBuffer,
 	// Play something
 	if (lenAvailable > 0) {
 		player->provider->GetAudioWithVolume(outputBuffer, player->current, lenAvailable, player->GetVolume());
+		player->stats.AddProviderRead(callback_start);
+		player->stats.AudioWritten();
 
 		// Set play position
 		player->current += lenAvailable;
+		player->stats.AddCallback(callback_start);
 
 		// Continue as normal
 		return 0;
@@ -38,22 +38,30 @@
 #include "audio_controller.h"
 #include "utils.h"
 
+#include <libaegisub/audio/playback_feed.h>
 #include <libaegisub/audio/provider.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <pulse/pulseaudio.h>
 #include <wx/thread.h>
 
 namespace {
 class PulseAudioPlayer final : public AudioPlayer {
-	float volume = 1.f;
 	bool is_playing = false;
 
 	volatile unsigned long start_frame = 0;
+	/// Frames of audio (or silence after the end) written to the stream
 	volatile unsigned long cur_frame = 0;
-	volatile unsigned long end_frame = 0;
+	/// Frames of silence written because the feed had fallen behind, which
+	/// don't count towards the playback position
+	volatile unsigned long underrun_frames = 0;
+
+	/// Reads ahead so that the write callback never waits on decoding
+	agi::AudioPlaybackFeed feed{provider, GetReadAheadFrames(), &stats};
 
 	unsigned long bpf = 0; // bytes per frame
 
@@ -90,11 +98,12 @@ public:
 	void Stop();
 	bool IsPlaying() { return is_playing; }
 
-	int64_t GetEndPosition() { return end_frame; }
+	int64_t GetEndPosition() { return feed.GetEndPosition(); }
 	int64_t GetCurrentPosition();
 	void SetEndPosition(int64_t pos);
 
-	void SetVolume(double vol) { volume = vol; }
+	void SetVolume(double vol) { feed.SetVolume(vol); }
+	void SetFade(int64_t frames) { feed.SetFade(frames); }
 };
 
 PulseAudioPlayer::PulseAudioPlayer(agi::AudioProvider *provider) : AudioPlayer(provider) {
@@ -153,8 +162,17 @@ PulseAudioPlayer::PulseAudioPlayer(agi::AudioProvider *provider) : AudioPlayer(p
 	pa_stream_set_state_callback(stream, (pa_stream_notify_cb_t)pa_stream_notify, this);
 	pa_stream_set_write_callback(stream, (pa_stream_request_cb_t)pa_stream_write, this);
 
-	// Connect stream
-	paerror = pa_stream_connect_playback(stream, nullptr, nullptr, (pa_stream_flags_t)(PA_STREAM_INTERPOLATE_TIMING|PA_STREAM_NOT_MONOTONOUS|PA_STREAM_AUTO_TIMING_UPDATE), nullptr, nullptr);
+	// Connect stream, asking for a short server-side buffer in low latency mode
+	int flags = PA_STREAM_INTERPOLATE_TIMING|PA_STREAM_NOT_MONOTONOUS|PA_STREAM_AUTO_TIMING_UPDATE;
+	pa_buffer_attr attr;
+	attr.maxlength = (uint32_t)-1;
+	attr.tlength = pa_usec_to_bytes(20*1000, &ss);
+	attr.prebuf = (uint32_t)-1;
+	attr.minreq = (uint32_t)-1;
+	attr.fragsize = (uint32_t)-1;
+	if (IsLowLatency())
+		flags |= PA_STREAM_ADJUST_LATENCY;
+	paerror = pa_stream_connect_playback(stream, nullptr, IsLowLatency() ? &attr : nullptr, (pa_stream_flags_t)flags, nullptr, nullptr);
 	if (paerror) {
 		LOG_E("audio/player/pulse") << "Stream connection failed: " << pa_strerror(paerror) << "(" << paerror << ")";
 		throw AudioPlayerOpenError(std::string("PulseAudio reported error: ") + pa_strerror(paerror));
@@ -203,7 +221,14 @@ void PulseAudioPlayer::Play(int64_t start,int64_t count)
 
 	start_frame = start;
 	cur_frame = start;
-	end_frame = start + count;
+	underrun_frames = 0;
+
+	// The write callback runs with the mainloop locked, so this keeps it from
+	// reading from the feed while it's restarted
+	stats.PlayStarted();
+	pa_threaded_mainloop_lock(mainloop);
+	feed.Start(start, start + count);
+	pa_threaded_mainloop_unlock(mainloop);
 
 	is_playing = true;
 
@@ -214,7 +239,11 @@ void PulseAudioPlayer::Play(int64_t start,int64_t count)
 	if (paerror)
 		LOG_E("audio/player/pulse") << "Error getting stream time: " << pa_strerror(paerror) << "(" << paerror << ")";
 
+	// Give the feed a chance to get ahead before the initial write
+	feed.WaitForPrefill(pa_stream_writable_size(stream) / bpf, std::chrono::milliseconds{500});
+	pa_threaded_mainloop_lock(mainloop);
 	PulseAudioPlayer::pa_stream_write(stream, pa_stream_writable_size(stream), this);
+	pa_threaded_mainloop_unlock(mainloop);
 
 	pa_threaded_mainloop_lock(mainloop);
 	pa_operation *op = pa_stream_trigger(stream, (pa_stream_success_cb_t)pa_stream_success, this);
@@ -235,7 +264,10 @@ void PulseAudioPlayer::Stop()
 
 	start_frame = 0;
 	cur_frame = 0;
-	end_frame = 0;
+
+	pa_threaded_mainloop_lock(mainloop);
+	feed.Stop();
+	pa_threaded_mainloop_unlock(mainloop);
 
 	// Flush the stream of data
 	pa_threaded_mainloop_lock(mainloop);
@@ -251,7 +283,7 @@ void PulseAudioPlayer::Stop()
 
 void PulseAudioPlayer::SetEndPosition(int64_t pos)
 {
-	end_frame = pos;
+	feed.SetEndPosition(pos);
 }
 
 int64_t PulseAudioPlayer::GetCurrentPosition()
@@ -266,7 +298,7 @@ int64_t PulseAudioPlayer::GetCurrentPosition()
 	pa_stream_get_time(stream, &play_cur_time);
 	pa_usec_t playtime = play_cur_time - play_start_time;
 
-	return start_frame + playtime * provider->GetSampleRate() / (1000*1000);
+	return start_frame + playtime * provider->GetSampleRate() / (1000*1000) - underrun_frames;
 }
 
 /// @brief Called by PA to notify about other context-related stuff
@@ -288,14 +320,15 @@ void PulseAudioPlayer::pa_stream_write(pa_stream *p, size_t length, PulseAudioPl
 {
 	if (!thread->is_playing) return;
 
-	if (thread->cur_frame >= thread->end_frame + thread->provider->GetSampleRate()) {
+	auto &feed = thread->feed;
+	if ((int64_t)thread->cur_frame >= feed.GetEndPosition() + thread->provider->GetSampleRate()) {
 		// More than a second past end of stream
 		thread->is_playing = false;
 		pa_operation *op = pa_stream_drain(p, nullptr, nullptr);
 		pa_operation_unref(op);
 		return;
 
-	} else if (thread->cur_frame >= thread->end_frame) {
+	} else if (feed.AtEnd()) {
 		// Past end of stream, but not a full second, add some silence
 		void *buf = calloc(length, 1);
 		::pa_stream_write(p, buf, length, free, 0, PA_SEEK_RELATIVE);
@@ -303,14 +336,24 @@ void PulseAudioPlayer::pa_stream_write(pa_stream *p, size_t length, PulseAudioPl
 		return;
 	}
 
+	auto callback_start = agi::AudioPlaybackStats::Now();
 	unsigned long bpf = thread->bpf;
 	unsigned long frames = length / thread->bpf;
-	unsigned long maxframes = thread->end_frame - thread->cur_frame;
-	if (frames > maxframes) frames = maxframes;
 	void *buf = malloc(frames * bpf);
-	thread->provider->GetAudioWithVolume(buf, thread->cur_frame, frames, thread->volume);
-	::pa_stream_write(p, buf, frames*bpf, free, 0, PA_SEEK_RELATIVE);
-	thread->cur_frame += frames;
+	unsigned long read = feed.Read(buf, frames);
+	if (read == 0) {
+		// The feed has fallen behind, so play a little silence rather than
+		// letting the stream stall
+		read = std::min<unsigned long>(frames, thread->provider->GetSampleRate() / 100);
+		memset(buf, 0, read * bpf);
+		thread->underrun_frames += read;
+	}
+	else {
+		thread->cur_frame += read;
+		thread->stats.AudioWritten();
+	}
+	::pa_stream_write(p, buf, read * bpf, free, 0, PA_SEEK_RELATIVE);
+	thread->stats.AddCallback(callback_start);
 }
 
 /// @brief Called by PA to notify about other stuff
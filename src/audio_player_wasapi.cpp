@@ -0,0 +1,448 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+/// @file audio_player_wasapi.cpp
+/// @brief Event-driven WASAPI audio output
+/// @ingroup audio_output
+///
+
+#ifdef WITH_WASAPI
+#include "include/aegisub/audio_player.h"
+
+#include "options.h"
+
+#include <libaegisub/audio/playback_feed.h>
+#include <libaegisub/audio/provider.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <windows.h>
+#include <audioclient.h>
+#include <avrt.h>
+#include <mmdeviceapi.h>
+
+namespace {
+using clock = std::chrono::steady_clock;
+
+enum class Message {
+	None,
+	Start,
+	Stop,
+	Close
+};
+
+struct ReleaseCOMObject {
+	void operator()(IUnknown *obj) {
+		if (obj) obj->Release();
+	}
+};
+
+template<typename T>
+using COMObjectRetainer = std::unique_ptr<T, ReleaseCOMObject>;
+
+/// RAII wrapper for an event handle
+struct Win32Event {
+	HANDLE handle = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	~Win32Event() { if (handle) CloseHandle(handle); }
+	operator HANDLE() const { return handle; }
+};
+
+/// 100ns units used for WASAPI durations
+const REFERENCE_TIME hns_per_ms = 10000;
+
+/// @class WasapiPlayer
+/// @brief Audio player which is woken by the device each time it wants more audio
+///
+/// As with the ALSA player, a thread of its own owns the device and the main
+/// thread only passes messages to it. The thread copies from the playback
+/// feed each time the device signals that there's room in its buffer, so
+/// the amount buffered can be a single device period, and the position comes
+/// from the device's clock so it includes the output latency.
+class WasapiPlayer final : public AudioPlayer {
+	std::mutex mutex;
+	/// Signalled along with a message being set
+	Win32Event wake;
+	Message message = Message::None;
+
+	bool exclusive = OPT_GET("Player/Audio/WASAPI/Exclusive Mode")->GetBool();
+
+	/// Set by the playback thread once the device is open or has failed to open
+	std::condition_variable init_cond;
+	bool init_done = false;
+	std::string init_error;
+
+	std::atomic<bool> playing{false};
+
+	std::mutex position_mutex;
+	int64_t last_position = 0;
+	clock::time_point last_position_time;
+
+	/// Reads ahead of the device so that slow decoding doesn't cause underruns
+	agi::AudioPlaybackFeed feed{provider, GetReadAheadFrames(), &stats};
+
+	std::thread thread;
+
+	void PlaybackThread();
+	/// Open and run the device until told to close
+	/// @return Why the device couldn't be opened, or empty if it closed normally
+	std::string RunDevice(std::unique_lock<std::mutex>& lock);
+	void InitDone(std::string error);
+
+	/// Fill up to frames frames of the device's buffer from the feed
+	/// @return false if the device has failed
+	bool WriteFrames(IAudioRenderClient *render, UINT32 frames, size_t framesize);
+
+	void UpdatePlaybackPosition(IAudioClock *audio_clock, UINT64 frequency, int64_t start);
+
+public:
+	WasapiPlayer(agi::AudioProvider *provider);
+	~WasapiPlayer();
+
+	void Play(int64_t start, int64_t count) override;
+	void Stop() override;
+	bool IsPlaying() override { return playing; }
+
+	void SetVolume(double vol) override { feed.SetVolume(vol); }
+	void SetFade(int64_t frames) override { feed.SetFade(frames); }
+	int64_t GetEndPosition() override { return feed.GetEndPosition(); }
+	int64_t GetCurrentPosition() override;
+	void SetEndPosition(int64_t pos) override { feed.SetEndPosition(pos); }
+};
+
+bool WasapiPlayer::WriteFrames(IAudioRenderClient *render, UINT32 frames, size_t framesize) {
+	if (frames == 0) return true;
+
+	BYTE *data;
+	if (FAILED(render->GetBuffer(frames, &data)))
+		return false;
+
+	size_t read = feed.Read(data, frames);
+	if (read < frames) {
+		if (!feed.AtEnd())
+			stats.AddUnderrun();
+		// Unsigned 8-bit samples are centered on 128 rather than 0
+		memset(data + read * framesize, provider->GetBytesPerSample() == 1 ? 0x80 : 0, (frames - read) * framesize);
+	}
+	if (read > 0)
+		stats.AudioWritten();
+
+	return SUCCEEDED(render->ReleaseBuffer(frames, read == 0 ? AUDCLNT_BUFFERFLAGS_SILENT : 0));
+}
+
+void WasapiPlayer::UpdatePlaybackPosition(IAudioClock *audio_clock, UINT64 frequency, int64_t start) {
+	UINT64 played;
+	if (FAILED(audio_clock->GetPosition(&played, nullptr)) || frequency == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(position_mutex);
+	last_position = start + static_cast<int64_t>(played * provider->GetSampleRate() / frequency);
+	last_position_time = clock::now();
+}
+
+void WasapiPlayer::InitDone(std::string error) {
+	init_error = std::move(error);
+	init_done = true;
+	init_cond.notify_all();
+}
+
+std::string WasapiPlayer::RunDevice(std::unique_lock<std::mutex>& lock) {
+	IMMDeviceEnumerator *enumerator_raw = nullptr;
+	if (FAILED(CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+		__uuidof(IMMDeviceEnumerator), reinterpret_cast<void **>(&enumerator_raw))))
+		return "Could not create the device enumerator";
+	COMObjectRetainer<IMMDeviceEnumerator> enumerator(enumerator_raw);
+
+	IMMDevice *device_raw = nullptr;
+	if (FAILED(enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &device_raw)))
+		return "Could not find an output device";
+	COMObjectRetainer<IMMDevice> device(device_raw);
+
+	WAVEFORMATEX wfx = {};
+	wfx.wFormatTag = WAVE_FORMAT_PCM;
+	wfx.nChannels = provider->GetChannels();
+	wfx.nSamplesPerSec = provider->GetSampleRate();
+	wfx.wBitsPerSample = provider->GetBytesPerSample() * 8;
+	wfx.nBlockAlign = wfx.nChannels * provider->GetBytesPerSample();
+	wfx.nAvgBytesPerSec = wfx.nSamplesPerSec * wfx.nBlockAlign;
+	size_t framesize = wfx.nBlockAlign;
+
+	auto activate = [&]() -> COMObjectRetainer<IAudioClient> {
+		IAudioClient *client_raw = nullptr;
+		if (FAILED(device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, reinterpret_cast<void **>(&client_raw))))
+			client_raw = nullptr;
+		return COMObjectRetainer<IAudioClient>(client_raw);
+	};
+
+	auto client = activate();
+	if (!client)
+		return "Could not activate the output device";
+
+	HRESULT hr;
+	if (exclusive) {
+		if (client->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &wfx, nullptr) != S_OK)
+			return "The output device does not support the audio's format in exclusive mode";
+
+		REFERENCE_TIME default_period, min_period;
+		if (FAILED(client->GetDevicePeriod(&default_period, &min_period)))
+			return "Could not get the output device's period";
+		REFERENCE_TIME period = IsLowLatency() ? min_period : default_period;
+
+		hr = client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+			period, period, &wfx, nullptr);
+		if (hr == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+			// The period has to be a whole number of the device's frames, and
+			// the only way to find out how many is to ask the failed client
+			UINT32 aligned_frames;
+			if (FAILED(client->GetBufferSize(&aligned_frames)))
+				return "Could not get the output device's buffer size";
+			period = static_cast<REFERENCE_TIME>(10000.0 * 1000 * aligned_frames / wfx.nSamplesPerSec + 0.5);
+			client = activate();
+			if (!client)
+				return "Could not activate the output device";
+			hr = client->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+				period, period, &wfx, nullptr);
+		}
+	}
+	else {
+		REFERENCE_TIME duration = (IsLowLatency() ? 20 : 100) * hns_per_ms;
+		hr = client->Initialize(AUDCLNT_SHAREMODE_SHARED,
+			AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM | AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+			duration, 0, &wfx, nullptr);
+	}
+	if (FAILED(hr))
+		return "Could not initialise the output device";
+
+	Win32Event buffer_event;
+	if (!buffer_event || FAILED(client->SetEventHandle(buffer_event)))
+		return "Could not set the output device's event";
+
+	UINT32 buffer_frames;
+	if (FAILED(client->GetBufferSize(&buffer_frames)))
+		return "Could not get the output device's buffer size";
+
+	IAudioRenderClient *render_raw = nullptr;
+	if (FAILED(client->GetService(__uuidof(IAudioRenderClient), reinterpret_cast<void **>(&render_raw))))
+		return "Could not get the render client";
+	COMObjectRetainer<IAudioRenderClient> render(render_raw);
+
+	IAudioClock *audio_clock_raw = nullptr;
+	if (FAILED(client->GetService(__uuidof(IAudioClock), reinterpret_cast<void **>(&audio_clock_raw))))
+		return "Could not get the audio clock";
+	COMObjectRetainer<IAudioClock> audio_clock(audio_clock_raw);
+	UINT64 frequency = 0;
+	audio_clock->GetFrequency(&frequency);
+
+	REFERENCE_TIME latency = 0;
+	client->GetStreamLatency(&latency);
+	LOG_D("audio/player/wasapi") << "opened " << (exclusive ? "exclusive" : "shared")
+		<< " stream, buffer " << buffer_frames << " frames, stream latency "
+		<< latency / hns_per_ms << " ms";
+
+	InitDone("");
+
+	// Every frame in the buffer has to be ours each time in exclusive mode,
+	// while shared mode only wants whatever the engine has consumed
+	auto room = [&]() -> UINT32 {
+		if (exclusive) return buffer_frames;
+		UINT32 padding;
+		if (FAILED(client->GetCurrentPadding(&padding)))
+			return 0;
+		return buffer_frames - padding;
+	};
+
+	HANDLE events[] = {wake, buffer_event};
+	while (true) {
+		while (message != Message::Start) {
+			if (message == Message::Close)
+				return "";
+			message = Message::None;
+			lock.unlock();
+			WaitForSingleObject(wake, INFINITE);
+			lock.lock();
+		}
+		message = Message::None;
+		if (feed.AtEnd())
+			continue;
+
+		LOG_D("audio/player/wasapi") << "starting playback";
+		int64_t start = feed.GetReadPosition();
+
+		// Give the feed a chance to get ahead before starting the device, but
+		// without holding up any further messages
+		lock.unlock();
+		feed.WaitForPrefill(buffer_frames, std::chrono::milliseconds{500});
+		lock.lock();
+		if (message != Message::None)
+			continue;
+
+		if (!WriteFrames(render.get(), room(), framesize) || FAILED(client->Start())) {
+			LOG_D("audio/player/wasapi") << "error starting playback";
+			return "";
+		}
+
+		UpdatePlaybackPosition(audio_clock.get(), frequency, start);
+		playing = true;
+		bool failed = false;
+		while (true) {
+			lock.unlock();
+			DWORD signal = WaitForMultipleObjects(2, events, FALSE, 2000);
+			lock.lock();
+
+			if (message != Message::None)
+				break;
+
+			if (signal == WAIT_TIMEOUT) {
+				LOG_D("audio/player/wasapi") << "device stopped asking for audio";
+				failed = true;
+				break;
+			}
+
+			auto fill_start = agi::AudioPlaybackStats::Now();
+			// Once the feed has run out this pads with silence while what was
+			// already written plays out
+			if (!WriteFrames(render.get(), room(), framesize)) {
+				LOG_D("audio/player/wasapi") << "error filling buffer";
+				failed = true;
+				break;
+			}
+			stats.AddCallback(fill_start);
+
+			UpdatePlaybackPosition(audio_clock.get(), frequency, start);
+			if (feed.AtEnd() && GetCurrentPosition() >= feed.GetEndPosition()) {
+				LOG_D("audio/player/wasapi") << "playback loop, past end";
+				break;
+			}
+		}
+
+		client->Stop();
+		client->Reset();
+		playing = false;
+		LOG_D("audio/player/wasapi") << "out of playback loop";
+		if (failed)
+			return "";
+	}
+}
+
+void WasapiPlayer::PlaybackThread() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED))) {
+		InitDone("Could not initialise COM");
+		return;
+	}
+
+	// Ask the scheduler to treat this as an audio thread so that it's woken
+	// promptly when the device wants more
+	DWORD task_index = 0;
+	HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+
+	auto error = RunDevice(lock);
+	if (!init_done)
+		InitDone(error);
+	else if (!error.empty())
+		LOG_D("audio/player/wasapi") << error;
+	playing = false;
+
+	if (task)
+		AvRevertMmThreadCharacteristics(task);
+	CoUninitialize();
+}
+
+WasapiPlayer::WasapiPlayer(agi::AudioProvider *provider)
+: AudioPlayer(provider)
+{
+	if (!wake)
+		throw AudioPlayerOpenError("WasapiPlayer: Could not create an event");
+
+	try {
+		thread = std::thread(&WasapiPlayer::PlaybackThread, this);
+	}
+	catch (std::system_error const&) {
+		throw AudioPlayerOpenError("WasapiPlayer: Creating the playback thread failed");
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	init_cond.wait(lock, [&] { return init_done; });
+	if (!init_error.empty()) {
+		lock.unlock();
+		thread.join();
+		throw AudioPlayerOpenError("WasapiPlayer: " + init_error);
+	}
+}
+
+WasapiPlayer::~WasapiPlayer() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		message = Message::Close;
+		SetEvent(wake);
+	}
+
+	thread.join();
+}
+
+void WasapiPlayer::Play(int64_t start, int64_t count) {
+	// The playback thread only reads from the feed while holding the mutex
+	std::unique_lock<std::mutex> lock(mutex);
+	message = Message::Start;
+	stats.PlayStarted();
+	feed.Start(start, start + count);
+	{
+		std::lock_guard<std::mutex> position_lock(position_mutex);
+		last_position = start;
+		last_position_time = clock::now();
+	}
+	SetEvent(wake);
+}
+
+void WasapiPlayer::Stop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	message = Message::Stop;
+	feed.Stop();
+	SetEvent(wake);
+}
+
+int64_t WasapiPlayer::GetCurrentPosition() {
+	int64_t lastpos;
+	clock::time_point lasttime;
+
+	{
+		std::lock_guard<std::mutex> lock(position_mutex);
+		lastpos = last_position;
+		lasttime = last_position_time;
+	}
+
+	// The device clock is only read once per period, so fill in between
+	if (!playing) return lastpos;
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - lasttime).count();
+	return lastpos + ms * provider->GetSampleRate() / 1000;
+}
+}
+
+std::unique_ptr<AudioPlayer> CreateWasapiPlayer(agi::AudioProvider *provider, wxWindow *) {
+	return agi::make_unique<WasapiPlayer>(provider);
+}
+
+#endif // WITH_WASAPI
@@ -21,11 +21,14 @@
 #include "utils.h"
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/format.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/log.h>
 #include <libaegisub/path.h>
 
+#include <boost/crc.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <thread>
 
 using namespace agi;
 
@@ -112,17 +115,48 @@ std::unique_ptr<agi::AudioProvider> GetAudioProvider(fs::path const& filename,
 	if (!cache || !needs_cache)
 		return CreateLockAudioProvider(std::move(provider));
 
+	// Decode on several threads if asked to, leaving some cores free for
+	// everything else which happens while audio is loading
+	int threads = OPT_GET("Audio/Cache/Threads")->GetInt();
+	if (threads <= 0)
+		threads = std::max<int>(1, std::thread::hardware_concurrency() / 2);
+
+	if (cache != 1 && cache != 2)
+		throw InternalError("Invalid audio caching method");
+
+	auto path = OPT_GET("Audio/Cache/HD/Location")->GetString();
+	if (path == "default")
+		path = "?temp";
+	auto cache_dir = path_helper.MakeAbsolute(path_helper.Decode(path), "?temp");
+
+	// Name the cache after the audio so that it can be found the next time
+	// the same file is opened, or by another instance which has it open
+	auto cache_name = [&](const char *extension) {
+		auto const& name = filename.string();
+		boost::crc_32_type hash;
+		hash.process_bytes(name.c_str(), name.size());
+		return cache_dir / agi::format("%u_%d_%d.%s", hash.checksum(),
+			fs::Size(filename), fs::ModifiedTime(filename), extension);
+	};
+
+	bool compress = cache == 2 && OPT_GET("Audio/Cache/HD/Compress")->GetBool();
+	if (!compress && OPT_GET("Audio/Cache/Share")->GetBool() && fs::FileExists(filename)) {
+		// Both cache types become a file mapping when shared, as memory
+		// mapped from the same file is only held once by the OS
+		CleanCache(cache_dir, "*.pcmcache", OPT_GET("Audio/Cache/HD/Size")->GetInt(),
+			OPT_GET("Audio/Cache/HD/Files")->GetInt());
+		return CreateSharedAudioProvider(std::move(provider), cache_name("pcmcache"), threads);
+	}
+
 	// Convert to RAM
-	if (cache == 1) return CreateRAMAudioProvider(std::move(provider));
+	if (cache == 1) return CreateRAMAudioProvider(std::move(provider), threads);
 
 	// Convert to HD
-	if (cache == 2) {
-		auto path = OPT_GET("Audio/Cache/HD/Location")->GetString();
-		if (path == "default")
-			path = "?temp";
-		auto cache_dir = path_helper.MakeAbsolute(path_helper.Decode(path), "?temp");
-		return CreateHDAudioProvider(std::move(provider), cache_dir);
+	if (compress && fs::FileExists(filename)) {
+		CleanCache(cache_dir, "*.audiocache", OPT_GET("Audio/Cache/HD/Size")->GetInt(),
+			OPT_GET("Audio/Cache/HD/Files")->GetInt());
+		return CreateCompressedHDAudioProvider(std::move(provider), cache_name("audiocache"));
 	}
 
-	throw InternalError("Invalid audio caching method");
+	return CreateHDAudioProvider(std::move(provider), cache_dir, threads);
 }
@@ -51,16 +51,27 @@ class FFmpegSourceAudioProvider final : public agi::AudioProvider, FFmpegSourceP
 	mutable char FFMSErrMsg[1024];			///< FFMS error message
 	mutable FFMS_ErrorInfo ErrInfo;			///< FFMS error codes/messages
 
+	/// What was opened, kept so that Reopen can open it again without
+	/// asking for a track or indexing
+	agi::fs::path FileName;
+	int TrackNumber = -1;
+	std::shared_ptr<FFMS_Index> Index;
+
 	void LoadAudio(agi::fs::path const& filename);
+	void OpenAudioSource();
 	void FillBuffer(void *Buf, int64_t Start, int64_t Count) const override {
 		if (FFMS_GetAudio(AudioSource, Buf, Start, Count, &ErrInfo))
 			throw agi::AudioDecodeError(std::string("Failed to get audio samples: ") + ErrInfo.Buffer);
 	}
 
+	/// Open another source for the same track as other
+	FFmpegSourceAudioProvider(FFmpegSourceAudioProvider const& other);
+
 public:
 	FFmpegSourceAudioProvider(agi::fs::path const& filename, agi::BackgroundRunner *br);
 
 	bool NeedsCache() const override { return true; }
+	std::unique_ptr<agi::AudioProvider> Reopen() const override;
 };
 
 /// @brief Constructor
@@ -81,6 +92,25 @@ catch (agi::EnvironmentError const& err) {
 	throw agi::AudioProviderError(err.GetMessage());
 }
 
+FFmpegSourceAudioProvider::FFmpegSourceAudioProvider(FFmpegSourceAudioProvider const& other)
+: FFmpegSourceProvider(nullptr)
+, AudioSource(nullptr, FFMS_DestroyAudioSource)
+, FileName(other.FileName)
+, TrackNumber(other.TrackNumber)
+, Index(other.Index)
+{
+	ErrInfo.Buffer		= FFMSErrMsg;
+	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
+	ErrInfo.ErrorType	= FFMS_ERROR_SUCCESS;
+	ErrInfo.SubType		= FFMS_ERROR_SUCCESS;
+
+	OpenAudioSource();
+}
+
+std::unique_ptr<agi::AudioProvider> FFmpegSourceAudioProvider::Reopen() const {
+	return std::unique_ptr<agi::AudioProvider>(new FFmpegSourceAudioProvider(*this));
+}
+
 void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	FFMS_Indexer *Indexer = FFMS_CreateIndexer(filename.string().c_str(), &ErrInfo);
 	if (!Indexer) {
@@ -92,9 +122,8 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 
 	std::map<int, std::string> TrackList = GetTracksOfType(Indexer, FFMS_TYPE_AUDIO);
 
-	// initialize the track number to an invalid value so we can detect later on
-	// whether the user actually had to choose a track or not
-	int TrackNumber = -1;
+	// the track number starts out as an invalid value so we can detect later
+	// on whether the user actually had to choose a track or not
 	if (TrackList.size() > 1) {
 		auto Selection = AskForTrackSelection(TrackList, FFMS_TYPE_AUDIO);
 		if (Selection == TrackSelection::None)
@@ -110,16 +139,12 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	agi::fs::path CacheName = GetCacheFilename(filename);
 
 	// try to read index
-	agi::scoped_holder<FFMS_Index*, void (FFMS_CC*)(FFMS_Index*)>
-		Index(FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo), FFMS_DestroyIndex);
-
-	if (Index && FFMS_IndexBelongsToFile(Index, filename.string().c_str(), &ErrInfo))
-		Index = nullptr;
+	Index = ReadCachedIndex(filename, CacheName);
 
 	if (Index) {
 		// we already have an index, but the desired track may not have been
 		// indexed, and if it wasn't we need to reindex
-		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index, TrackNumber);
+		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index.get(), TrackNumber);
 		if (FFMS_GetNumFrames(TempTrackData) <= 0)
 			Index = nullptr;
 	}
@@ -127,7 +152,7 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	// reindex if the error handling mode has changed
 	FFMS_IndexErrorHandling ErrorHandling = GetErrorHandlingMode();
 #if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (2 << 8) | 0)
-	if (Index && FFMS_GetErrorHandling(Index) != ErrorHandling)
+	if (Index && FFMS_GetErrorHandling(Index.get()) != ErrorHandling)
 		Index = nullptr;
 #endif
 
@@ -144,7 +169,12 @@ void FFmpegSourceAudioProvider::LoadAudio(agi::fs::path const& filename) {
 	// update access time of index file so it won't get cleaned away
 	agi::fs::Touch(CacheName);
 
-	AudioSource = FFMS_CreateAudioSource(filename.string().c_str(), TrackNumber, Index, FFMS_DELAY_FIRST_VIDEO_TRACK, &ErrInfo);
+	FileName = filename;
+	OpenAudioSource();
+}
+
+void FFmpegSourceAudioProvider::OpenAudioSource() {
+	AudioSource = FFMS_CreateAudioSource(FileName.string().c_str(), TrackNumber, Index.get(), FFMS_DELAY_FIRST_VIDEO_TRACK, &ErrInfo);
 	if (!AudioSource)
 		throw agi::AudioProviderError(std::string("Failed to open audio track: ") + ErrInfo.Buffer);
 
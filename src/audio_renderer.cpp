@@ -37,9 +37,17 @@
 #include <libaegisub/make_unique.h>
 
 #include <algorithm>
+#include <climits>
 #include <wx/dc.h>
 
 namespace {
+	/// Narrowest bitmap to cache. Narrower ones mean more blits per paint,
+	/// and more system bitmap objects for the same memory.
+	const int min_bitmap_width = 256;
+	/// Widest bitmap to cache, so that rendering a bitmap which is needed
+	/// right away or prefetching one doesn't hold up the UI for long
+	const int max_bitmap_width = 1024;
+
 	template<typename T>
 	bool compare_and_set(T &var, const T new_value)
 	{
@@ -62,18 +70,29 @@ std::unique_ptr<wxBitmap> AudioRendererBitmapCacheBitmapFactory::ProduceBlock(in
 
 size_t AudioRendererBitmapCacheBitmapFactory::GetBlockSize() const
 {
-	return sizeof(wxBitmap) + renderer->cache_bitmap_width * renderer->pixel_height * 3;
+	return renderer->BitmapSize();
 }
 
 AudioRenderer::AudioRenderer()
 {
 	bitmaps.reserve(AudioStyle_MAX);
 	for (int i = 0; i < AudioStyle_MAX; ++i)
+	{
 		bitmaps.emplace_back(256, AudioRendererBitmapCacheBitmapFactory(this));
+		bitmaps.back().SetMetricsName("audio/bitmap cache");
+	}
+	tail_bitmaps.resize(AudioStyle_MAX);
 
 	// Make sure there's *some* values for those fields, and in the caches
 	SetMillisecondsPerPixel(1);
 	SetHeight(1);
+
+	// Scrolling fills the caches up to their limit, so that's reported as
+	// their size rather than tracking it exactly. Called from other
+	// threads, so the new limit is only applied at the next render.
+	budget_registration = agi::GlobalMemoryBudget().Register("audio display", 1, 1,
+		[=] { return std::min(cache_max_size.load(), budget_max_size.load()); },
+		[=](size_t limit) { budget_max_size = limit; });
 }
 
 void AudioRenderer::SetMillisecondsPerPixel(const double new_pixel_ms)
@@ -93,6 +112,22 @@ void AudioRenderer::SetHeight(const int _pixel_height)
 		Invalidate();
 }
 
+void AudioRenderer::SetWidth(const int display_width)
+{
+	// A quarter of the display, rounded up to a power of two, so that a
+	// paint draws about five bitmaps and resizing the window only
+	// occasionally changes the width of them
+	int width = min_bitmap_width;
+	while (width < max_bitmap_width && width * 4 < display_width)
+		width *= 2;
+
+	if (compare_and_set(cache_bitmap_width, width))
+	{
+		Invalidate();
+		ResetBlockCount();
+	}
+}
+
 void AudioRenderer::SetAmplitudeScale(const float _amplitude_scale)
 {
 	if (compare_and_set(amplitude_scale, _amplitude_scale))
@@ -135,16 +170,30 @@ void AudioRenderer::SetAudioProvider(agi::AudioProvider *const _provider)
 
 void AudioRenderer::SetCacheMaxSize(const size_t max_size)
 {
+	cache_max_size = max_size;
+	ApplyCacheMaxSize();
+	agi::GlobalMemoryBudget().Rebalance();
+}
+
+bool AudioRenderer::ApplyCacheMaxSize()
+{
+	const size_t max_size = std::min(cache_max_size.load(), budget_max_size.load());
+	if (max_size == applied_max_size) return false;
+	const bool shrunk = max_size < applied_max_size;
+	applied_max_size = max_size;
+
 	// Limit the bitmap cache sizes to 16 MB hard, to avoid the risk of exhausting
 	// system bitmap object resources and similar. Experimenting shows that 16 MB
 	// bitmap cache should be plenty even if working with a one hour audio clip.
 	cache_bitmap_maxsize = std::min<size_t>(max_size/8, 0x1000000);
 	// The renderer gets whatever is left.
 	cache_renderer_maxsize = max_size - 4*cache_bitmap_maxsize;
+	return shrunk;
 }
 
 void AudioRenderer::ResetBlockCount()
 {
+	for (auto& bmp : tail_bitmaps) bmp = wxBitmap();
 	if (provider)
 	{
 		const size_t total_blocks = NumBlocks(provider->GetNumSamples());
@@ -158,6 +207,30 @@ size_t AudioRenderer::NumBlocks(const int64_t samples) const
 	return static_cast<size_t>(duration / pixel_ms / cache_bitmap_width);
 }
 
+int AudioRenderer::TailWidth() const
+{
+	const double duration = provider->GetNumSamples() * 1000.0 / provider->GetSampleRate();
+	const int pixels = static_cast<int>(duration / pixel_ms);
+	return std::max(0, pixels - static_cast<int>(NumBlocks(provider->GetNumSamples())) * cache_bitmap_width);
+}
+
+size_t AudioRenderer::BitmapSize() const
+{
+	return sizeof(wxBitmap) + cache_bitmap_width * pixel_height * 3;
+}
+
+bool AudioRenderer::IsBitmapDecoded(const int i, const bool request) const
+{
+	const double pixel_samples = pixel_ms * provider->GetSampleRate() / 1000.0;
+	const int64_t first = static_cast<int64_t>(i * cache_bitmap_width * pixel_samples);
+	const int64_t count = static_cast<int64_t>(cache_bitmap_width * pixel_samples) + 1;
+	if (provider->IsDecoded(first, count))
+		return true;
+	if (request)
+		provider->RequestDecode(first, count);
+	return false;
+}
+
 wxBitmap const& AudioRenderer::GetCachedBitmap(const int i, const AudioRenderingStyle style)
 {
 	assert(provider);
@@ -175,6 +248,17 @@ wxBitmap const& AudioRenderer::GetCachedBitmap(const int i, const AudioRendering
 	return bmp;
 }
 
+wxBitmap const& AudioRenderer::GetTailBitmap(const AudioRenderingStyle style)
+{
+	auto& bmp = tail_bitmaps[style];
+	if (!bmp.IsOk())
+	{
+		bmp = wxBitmap(TailWidth(), pixel_height, 24);
+		renderer->Render(bmp, NumBlocks(provider->GetNumSamples()) * cache_bitmap_width, style);
+	}
+	return bmp;
+}
+
 void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int length, const AudioRenderingStyle style)
 {
 	assert(start >= 0);
@@ -183,6 +267,10 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 	if (!renderer) return;
 	if (length <= 0) return;
 
+	// The memory budget may have cut the caches down since the last render
+	if (ApplyCacheMaxSize())
+		needs_age = true;
+
 	// One past last absolute pixel strip to render
 	const int end = start + length;
 	// One past last X coordinate to render on
@@ -192,7 +280,7 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 	// And the offset in it to start its use at
 	const int firstbitmapoffset = start % cache_bitmap_width;
 	// The last bitmap required
-	const int lastbitmap = std::min<int>(end / cache_bitmap_width, NumBlocks(provider->GetDecodedSamples()) - 1);
+	const int lastbitmap = std::min<int>(end / cache_bitmap_width, NumBlocks(provider->GetNumSamples()) - 1);
 
 	// Set a clipping region so that the first and last bitmaps don't draw
 	// outside the requested range
@@ -201,10 +289,29 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 
 	for (int i = firstbitmap; i <= lastbitmap; ++i)
 	{
-		dc.DrawBitmap(GetCachedBitmap(i, style), origin);
+		// The audio may not be decoded in order, so only bitmaps whose audio
+		// is all there are cached, and the rest are put at the front of the
+		// decoding queue
+		if (IsBitmapDecoded(i, true))
+			dc.DrawBitmap(GetCachedBitmap(i, style), origin);
+		else
+			renderer->RenderBlank(dc, wxRect(origin, wxSize(cache_bitmap_width, pixel_height)), style);
 		origin.x += cache_bitmap_width;
 	}
 
+	// The audio after the last whole bitmap is narrower than a cached one
+	// would be, and the bitmap providers can't render past the end of it
+	const bool draw_tail = firstbitmap <= lastbitmap + 1 && lastbitmap + 1 == (int)NumBlocks(provider->GetNumSamples());
+	const int tail_width = draw_tail ? TailWidth() : 0;
+	if (tail_width > 0 && origin.x < lastx && pixel_height > 0)
+	{
+		if (IsBitmapDecoded(lastbitmap + 1, true))
+			dc.DrawBitmap(GetTailBitmap(style), origin);
+		else
+			renderer->RenderBlank(dc, wxRect(origin, wxSize(tail_width, pixel_height)), style);
+		origin.x += tail_width;
+	}
+
 	// Now render blank audio from origin to end
 	if (origin.x < lastx)
 		renderer->RenderBlank(dc, wxRect(origin.x-1, origin.y, lastx-origin.x+1, pixel_height), style);
@@ -220,9 +327,44 @@ void AudioRenderer::Render(wxDC &dc, wxPoint origin, const int start, const int
 void AudioRenderer::Invalidate()
 {
 	for (auto& bmp : bitmaps) bmp.Age(0);
+	for (auto& bmp : tail_bitmaps) bmp = wxBitmap();
 	needs_age = false;
 }
 
+bool AudioRenderer::Prefetch(const int start, const int length, const AudioRenderingStyle style, const bool from_end)
+{
+	if (!provider) return false;
+	if (!renderer) return false;
+	if (length <= 0) return false;
+
+	const int firstbitmap = std::max(start, 0) / cache_bitmap_width;
+	const int lastbitmap = std::min<int>((start + length - 1) / cache_bitmap_width, NumBlocks(provider->GetNumSamples()) - 1);
+	if (lastbitmap < firstbitmap) return false;
+
+	const int step = from_end ? -1 : 1;
+	for (int i = from_end ? lastbitmap : firstbitmap; i >= firstbitmap && i <= lastbitmap; i += step)
+	{
+		if (!bitmaps[style].Find(i) && IsBitmapDecoded(i, false))
+		{
+			GetCachedBitmap(i, style);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int AudioRenderer::GetCacheCapacity() const
+{
+	size_t pixels = cache_bitmap_maxsize / BitmapSize() * cache_bitmap_width;
+	if (renderer)
+	{
+		if (size_t bytes_per_pixel = renderer->GetCacheBytesPerPixel())
+			pixels = std::min(pixels, cache_renderer_maxsize / bytes_per_pixel);
+	}
+	return static_cast<int>(std::min<size_t>(pixels, INT_MAX));
+}
+
 void AudioRendererBitmapProvider::SetProvider(agi::AudioProvider *const _provider)
 {
 	if (compare_and_set(provider, _provider))
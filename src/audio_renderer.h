@@ -29,9 +29,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include <libaegisub/memory_budget.h>
+
+#include <wx/bitmap.h>
 #include <wx/gdicmn.h>
 
 #include "audio_rendering_style.h"
@@ -86,11 +91,14 @@ class AudioRenderer {
 	/// Vertical zoom level/amplitude scale
 	float amplitude_scale = 0.f;
 
-	/// Width of bitmaps to store in cache
-	const int cache_bitmap_width = 32; // Completely arbitrary value
+	/// Width of bitmaps to store in cache, picked from the display width by SetWidth
+	int cache_bitmap_width = 256;
 
 	/// Cached bitmaps for audio ranges
 	std::vector<AudioRendererBitmapCache> bitmaps;
+	/// Bitmaps for the audio after the last whole cached bitmap, for each
+	/// style, or empty if they haven't been rendered
+	std::vector<wxBitmap> tail_bitmaps;
 	/// The maximum allowed size of each bitmap cache, in bytes
 	size_t cache_bitmap_maxsize = 0;
 	/// The maximum allowed size of the renderer's cache, in bytes
@@ -98,6 +106,14 @@ class AudioRenderer {
 	/// Do the caches need to be aged?
 	bool needs_age = false;
 
+	/// Size passed to SetCacheMaxSize
+	std::atomic<size_t> cache_max_size{0};
+	/// Most the caches may hold according to the memory budget
+	std::atomic<size_t> budget_max_size{SIZE_MAX};
+	/// Size which the cache limits were last divided up from
+	size_t applied_max_size = 0;
+	agi::MemoryBudget::Registration budget_registration;
+
 	/// Actual renderer for bitmaps
 	AudioRendererBitmapProvider *renderer = nullptr;
 
@@ -123,6 +139,25 @@ class AudioRenderer {
 	/// Calculate the number of cache blocks needed for a given number of samples
 	size_t NumBlocks(int64_t samples) const;
 
+	/// Width in pixels of the audio after the last whole cache block
+	int TailWidth() const;
+
+	/// @brief Get the bitmap of the audio after the last whole cache block
+	/// @param style Rendering style required for bitmap
+	wxBitmap const& GetTailBitmap(AudioRenderingStyle style);
+
+	/// Size in bytes of each cached bitmap
+	size_t BitmapSize() const;
+
+	/// @brief Divide the smaller of the set maximum and the budget between the caches
+	/// @return Did the limits shrink?
+	bool ApplyCacheMaxSize();
+
+	/// @brief Check whether all of the audio drawn in a bitmap has been decoded
+	/// @param i       Index of the bitmap
+	/// @param request Ask for the audio to be decoded next if it hasn't been
+	bool IsBitmapDecoded(int i, bool request) const;
+
 public:
 	/// @brief Constructor
 	///
@@ -142,6 +177,14 @@ public:
 	/// Changing the rendering height invalidates all cached bitmaps.
 	void SetHeight(int pixel_height);
 
+	/// @brief Set the width of the display the audio is drawn in
+	/// @param display_width Width in pixels
+	///
+	/// The cached bitmaps are made a fraction of this wide, so that a paint
+	/// draws a handful of them rather than many narrow ones. Changing the
+	/// width of the cached bitmaps invalidates them.
+	void SetWidth(int display_width);
+
 	/// @brief Set vertical zoom
 	/// @param amplitude_scale Scaling factor
 	///
@@ -213,6 +256,25 @@ public:
 	/// that will affect the rendered images, it should call this function to ensure
 	/// the cache is kept consistent.
 	void Invalidate();
+
+	/// @brief Render a bitmap which will be needed soon, without drawing it
+	/// @param start    First pixel from beginning of the audio stream of the range to fill
+	/// @param length   Number of pixels in the range
+	/// @param style    Style the range will be drawn in
+	/// @param from_end Work from the end of the range towards its start
+	/// @return Whether a bitmap was rendered
+	///
+	/// At most one bitmap is rendered per call, so that the caller can get
+	/// back to handling events between them. Once everything in the range
+	/// is in the cache this does nothing and returns false.
+	bool Prefetch(int start, int length, AudioRenderingStyle style, bool from_end);
+
+	/// @brief Get the number of pixels of audio which fit in the caches
+	///
+	/// This is per rendering style, and takes both the bitmap caches and
+	/// the bitmap provider's cache into account. Prefetching more than this
+	/// would push the visible bitmaps out of the cache.
+	int GetCacheCapacity() const;
 };
 
 
@@ -287,4 +349,8 @@ public:
 	/// Deriving classes should override this method if they implement any
 	/// kind of caching.
 	virtual void AgeCache(size_t max_size) { }
+
+	/// @brief Get the amount of cache used per pixel rendered
+	/// @return Bytes of the renderer's cache used, or 0 if it doesn't cache per pixel
+	virtual size_t GetCacheBytesPerPixel() const { return 0; }
 };
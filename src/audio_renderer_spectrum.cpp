@@ -38,53 +38,328 @@
 #ifndef WITH_FFTW3
 #include "fft.h"
 #endif
+#include "options.h"
+#include "utils.h"
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/dispatch.h>
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/format.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
+#include <libaegisub/path.h>
 
 #include <algorithm>
+#include <atomic>
+#include <boost/crc.hpp>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 
+#include <wx/dc.h>
 #include <wx/image.h>
-#include <wx/dcmemory.h>
 
-/// Allocates blocks of derived data for the audio spectrum
-struct AudioSpectrumCacheBlockFactory {
-	typedef std::unique_ptr<float, std::default_delete<float[]>> BlockType;
+/// Stored spectrum values, which are fixed point with 15 fractional bits
+///
+/// The values are the log of the power, mostly in [0;1], so this keeps more
+/// precision than the 2^12 entry palette (even at the maximum amplitude
+/// scale) in half the space of a float.
+typedef uint16_t SpectrumValue;
+
+/// Multiplier from spectrum values to SpectrumValue
+static const float spectrum_value_scale = 32768.f;
+
+/// Convert a spectrum value to its stored form
+static SpectrumValue quantize_spectrum(float value)
+{
+	return (SpectrumValue)std::min(value * spectrum_value_scale + .5f, 65535.f);
+}
+
+/// @class AudioSpectrumDiskCache
+/// @brief Spectrum blocks saved to disk so that reopening the same audio is fast
+///
+/// The file starts with a header identifying the audio and the derivation
+/// parameters, followed by a table with the slot number of each stored block
+/// (plus one, so that zero means missing), followed by the slots themselves
+/// in the order they were computed. A block's table entry is only written
+/// after its data, so a file which was not closed cleanly is still valid.
+///
+/// Blocks are read on the GUI thread and written by the background tasks,
+/// so all access to the file is locked.
+class AudioSpectrumDiskCache {
+	struct Header {
+		char magic[8];
+		uint32_t derivation_size;
+		uint32_t derivation_dist;
+		int64_t num_samples;
+		int64_t sample_rate;
+		uint64_t block_count;
+		uint64_t used_slots;
+	};
+
+	std::mutex mutex;
+	agi::persistent_file_mapping file;
+	Header header;
+	size_t block_size;
+	uint64_t max_size;
+
+	uint64_t TableOffset(size_t i) const { return sizeof(Header) + i * sizeof(uint32_t); }
+	uint64_t SlotOffset(uint64_t slot) const { return TableOffset(header.block_count) + slot * block_size; }
+
+public:
+	AudioSpectrumDiskCache(agi::fs::path const& filename, Header const& expected, uint64_t max_size)
+	: file(filename)
+	, header(expected)
+	, block_size(sizeof(SpectrumValue) << expected.derivation_size)
+	, max_size(max_size)
+	{
+		if (file.size() >= sizeof(Header)) {
+			Header existing;
+			memcpy(&existing, file.write(0, sizeof(Header)), sizeof(Header));
+			header.used_slots = existing.used_slots;
+			if (!memcmp(&existing, &header, sizeof(Header)) && file.size() >= SlotOffset(existing.used_slots))
+				return;
+		}
+
+		// Missing, stale or truncated, so start over
+		header.used_slots = 0;
+		file.resize(0);
+		file.resize(SlotOffset(0));
+		memcpy(file.write(0, sizeof(Header)), &header, sizeof(Header));
+	}
+
+	static Header MakeHeader(size_t derivation_size, size_t derivation_dist, agi::AudioProvider *provider, size_t block_count) {
+		Header header;
+		memcpy(header.magic, "AEGISPC2", sizeof(header.magic));
+		header.derivation_size = derivation_size;
+		header.derivation_dist = derivation_dist;
+		header.num_samples = provider->GetNumSamples();
+		header.sample_rate = provider->GetSampleRate();
+		header.block_count = block_count;
+		header.used_slots = 0;
+		return header;
+	}
+
+	/// Copy block i into out if it has been stored
+	bool Read(size_t i, SpectrumValue *out) {
+		std::lock_guard<std::mutex> lock(mutex);
+		uint32_t slot;
+		memcpy(&slot, file.write(TableOffset(i), sizeof(slot)), sizeof(slot));
+		if (!slot) return false;
+		memcpy(out, file.write(SlotOffset(slot - 1), block_size), block_size);
+		return true;
+	}
+
+	/// Store block i
+	void Write(size_t i, const SpectrumValue *data) {
+		std::lock_guard<std::mutex> lock(mutex);
+		uint64_t slot = header.used_slots;
+		uint64_t end = SlotOffset(slot + 1);
+		if (end > file.size()) {
+			if (end > max_size) return;
+			// Grow in large steps to keep the number of remappings down
+			file.resize(std::min(max_size, std::max(end, file.size() + (16 << 20))));
+		}
+
+		memcpy(file.write(SlotOffset(slot), block_size), data, block_size);
+		uint32_t entry = static_cast<uint32_t>(slot + 1);
+		memcpy(file.write(TableOffset(i), sizeof(entry)), &entry, sizeof(entry));
+		++header.used_slots;
+		memcpy(file.write(0, sizeof(Header)), &header, sizeof(Header));
+	}
+};
+
+/// @class AudioSpectrumDerivation
+/// @brief Scratch space for deriving frequency-power data from audio
+///
+/// An instance may only be used by one thread at a time, so each background
+/// task creates its own. The FFTW plan is shared, as executing a plan on new
+/// arrays is thread-safe.
+class AudioSpectrumDerivation {
+	size_t derivation_size;
+	size_t derivation_dist;
 
-	/// Pointer back to the owning spectrum renderer
-	AudioSpectrumRenderer *spectrum;
+#ifdef WITH_FFTW3
+	/// FFTW plan data
+	fftw_plan plan;
+	/// Input array for FFTW
+	double *dft_input;
+	/// Output array for FFTW
+	fftw_complex *dft_output;
+#else
+	/// Scratch area for doing FFT derivations
+	std::vector<float> fft_scratch;
+	/// Transform, which keeps its tables between blocks
+	FFT fft;
+#endif
+
+	/// @brief Read audio as floats in the range [-1;+1)
+	/// @param provider Audio to read, which is converted straight from its cache
+	/// @param start First sample to read
+	/// @param count Samples to read
+	/// @param dest Buffer to fill
+	template<class T>
+	static void ReadAsFloat(agi::AudioProvider *provider, int64_t start, int64_t count, T *dest) {
+		provider->VisitAudio(start, count, [&](const void *data, int64_t n) {
+			auto samples = static_cast<const int16_t *>(data);
+			for (int64_t si = 0; si < n; ++si)
+				*dest++ = (T)(samples[si]) / 32768.0;
+		});
+	}
+
+	AudioSpectrumDerivation(AudioSpectrumDerivation const&) = delete;
+	AudioSpectrumDerivation& operator=(AudioSpectrumDerivation const&) = delete;
+
+public:
+#ifdef WITH_FFTW3
+	AudioSpectrumDerivation(size_t derivation_size, size_t derivation_dist, fftw_plan plan)
+	: derivation_size(derivation_size)
+	, derivation_dist(derivation_dist)
+	, plan(plan)
+	, dft_input(fftw_alloc_real(2 << derivation_size))
+	, dft_output(fftw_alloc_complex(2 << derivation_size))
+	{
+	}
+
+	~AudioSpectrumDerivation()
+	{
+		fftw_free(dft_input);
+		fftw_free(dft_output);
+	}
+#else
+	AudioSpectrumDerivation(size_t derivation_size, size_t derivation_dist)
+	: derivation_size(derivation_size)
+	, derivation_dist(derivation_dist)
+	// 2x for the input sample data
+	// 2x for the real part of the output
+	// 2x for the imaginary part of the output
+	, fft_scratch(6 << derivation_size)
+	{
+	}
+#endif
 
-	/// @brief Allocate and fill a data block
-	/// @param i Index of the block to produce data for
-	/// @return Newly allocated and filled block
-	///
-	/// The filling is delegated to the spectrum renderer
-	BlockType ProduceBlock(size_t i)
+	/// @brief Fill a block with frequency-power data for a time range
+	/// @param      provider    Audio to derive the data from
+	/// @param      block_index Index of the block to fill data for
+	/// @param[out] block       Address to write the data to
+	/// @return Whether all of the audio used had already been decoded
+	bool Compute(agi::AudioProvider *provider, size_t block_index, SpectrumValue *block)
 	{
-		auto res = new float[((size_t)1)<<spectrum->derivation_size];
-		spectrum->FillBlock(i, res);
-		return BlockType(res);
+		int64_t first_sample = (((int64_t)block_index) << derivation_dist) - ((int64_t)1 << derivation_size);
+
+		// Checked before reading, as the decoder may get further while we do
+		bool complete = provider->IsDecoded(first_sample, 2 << derivation_size);
+
+#ifdef WITH_FFTW3
+		ReadAsFloat(provider, first_sample, 2 << derivation_size, dft_input);
+
+		fftw_execute_dft_r2c(plan, dft_input, dft_output);
+
+		double scale_factor = 9 / sqrt(2 << (derivation_size + 1));
+
+		fftw_complex *o = dft_output;
+		for (size_t si = (size_t)1<<derivation_size; si > 0; --si)
+		{
+			*block++ = quantize_spectrum(log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 ));
+			o++;
+		}
+#else
+		ReadAsFloat(provider, first_sample, 2 << derivation_size, &fft_scratch[0]);
+
+		float *fft_input = &fft_scratch[0];
+		float *fft_real = &fft_scratch[0] + (2 << derivation_size);
+		float *fft_imag = &fft_scratch[0] + (4 << derivation_size);
+
+		fft.Transform(2<<derivation_size, fft_input, fft_real, fft_imag);
+
+		float scale_factor = 9 / sqrt(2 * (float)(2<<derivation_size));
+
+		for (size_t si = 1<<derivation_size; si > 0; --si)
+		{
+			// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
+			// although the FFT output can apparently get greater magnitudes than 1
+			// despite the input being limited to [-1;+1).
+			*block++ = quantize_spectrum(log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 ));
+			fft_real++; fft_imag++;
+		}
+#endif
+
+		return complete;
 	}
+};
+
+/// State shared between a spectrum renderer and its background tasks
+///
+/// The tasks keep this alive, so that results which arrive after the
+/// renderer has moved on to other audio or been destroyed can be dropped.
+struct AudioSpectrumJobs {
+	/// What the tasks need to know about one level of detail
+	struct Level {
+		AudioSpectrumCache *cache;
+		size_t derivation_size;
+		size_t derivation_dist;
+#ifdef WITH_FFTW3
+		fftw_plan plan;
+#endif
+	};
+
+	agi::AudioProvider *provider;
+	/// Only used for level 0
+	AudioSpectrumDiskCache *disk_cache;
+	std::vector<Level> levels;
+
+	/// Set on the GUI thread once the results are no longer wanted
+	std::atomic<bool> cancelled{false};
+
+	std::mutex mutex;
+	/// Signalled when running drops to zero
+	std::condition_variable idle;
+	/// Number of tasks queued which haven't finished yet
+	size_t running = 0;
+};
+
+/// Number of blocks computed by each background task
+static const size_t blocks_per_job = 16;
+
+/// Maximum number of levels of detail, including the full resolution one
+static const size_t max_levels = 8;
+
+/// Binary logarithm of the smallest derivation size used by the coarser levels
+static const size_t min_level_derivation_size = 8;
+
+/// Describes blocks of derived data for the audio spectrum
+///
+/// Blocks are always computed by the background tasks and inserted into
+/// the cache, so this never has to produce any itself.
+struct AudioSpectrumCacheBlockFactory {
+	typedef std::unique_ptr<SpectrumValue, std::default_delete<SpectrumValue[]>> BlockType;
+
+	/// Binary logarithm of the number of values in a block
+	size_t derivation_size;
 
 	/// @brief Calculate the in-memory size of a spec
 	/// @return The size in bytes of a spectrum cache block
 	size_t GetBlockSize() const
 	{
-		return sizeof(float) << spectrum->derivation_size;
+		return sizeof(SpectrumValue) << derivation_size;
 	}
 };
 
 /// @brief Cache for audio spectrum frequency-power data
+///
+/// Filled by the background tasks and read on the GUI thread.
 class AudioSpectrumCache
-: public DataBlockCache<float, 10, AudioSpectrumCacheBlockFactory> {
+: public ShardedDataBlockCache<SpectrumValue, 10, AudioSpectrumCacheBlockFactory> {
 public:
-	AudioSpectrumCache(size_t block_count, AudioSpectrumRenderer *renderer)
-	: DataBlockCache(block_count, AudioSpectrumCacheBlockFactory{renderer})
+	AudioSpectrumCache(size_t block_count, size_t derivation_size)
+	: ShardedDataBlockCache(block_count, AudioSpectrumCacheBlockFactory{derivation_size})
 	{
 	}
 };
 
-AudioSpectrumRenderer::AudioSpectrumRenderer(std::string const& color_scheme_name)
+AudioSpectrumRenderer::AudioSpectrumRenderer(std::string const& color_scheme_name, agi::fs::path const& audio_file)
+: audio_file(audio_file)
 {
 	colors.reserve(AudioStyle_MAX);
 	for (int i = 0; i < AudioStyle_MAX; ++i)
@@ -98,120 +373,197 @@ AudioSpectrumRenderer::~AudioSpectrumRenderer()
 	RecreateCache();
 }
 
+void AudioSpectrumRenderer::CancelJobs()
+{
+	if (!jobs) return;
+
+	jobs->cancelled = true;
+	{
+		std::unique_lock<std::mutex> lock(jobs->mutex);
+		jobs->idle.wait(lock, [&] { return jobs->running == 0; });
+	}
+	jobs.reset();
+}
+
 void AudioSpectrumRenderer::RecreateCache()
 {
+	// The background tasks use the caches, plan and provider, so they have
+	// to be stopped before any of them go away
+	CancelJobs();
+
 #ifdef WITH_FFTW3
-	if (dft_plan)
+	for (auto& level : levels)
 	{
-		fftw_destroy_plan(dft_plan);
-		fftw_free(dft_input);
-		fftw_free(dft_output);
-		dft_plan = nullptr;
-		dft_input = nullptr;
-		dft_output = nullptr;
+		if (level.plan)
+			fftw_destroy_plan(level.plan);
 	}
 #endif
 
+	disk_cache.reset();
+	levels.clear();
+
 	if (provider)
 	{
-		size_t block_count = (size_t)((provider->GetNumSamples() + ((size_t)1<<derivation_dist) - 1) >> derivation_dist);
-		cache = agi::make_unique<AudioSpectrumCache>(block_count, this);
+		jobs = std::make_shared<AudioSpectrumJobs>();
+		jobs->provider = provider;
+
+		// Each level halves the number of blocks of the one before it, so
+		// stop once there would be too few for the level to be useful
+		int64_t num_samples = provider->GetNumSamples();
+		for (size_t i = 0; i < max_levels; ++i)
+		{
+			size_t dist = derivation_dist + i;
+			size_t block_count = (size_t)((num_samples + ((int64_t)1<<dist) - 1) >> dist);
+			if (i > 0 && block_count < 2)
+				break;
+
+			Level level;
+			level.derivation_dist = dist;
+			level.derivation_size = std::max(derivation_size - std::min(i, derivation_size),
+				std::min(derivation_size, min_level_derivation_size));
+			level.cache = agi::make_unique<AudioSpectrumCache>(block_count, level.derivation_size);
+			level.cache->SetMetricsName("audio/spectrum cache");
+			level.block_pending.resize(block_count);
 
 #ifdef WITH_FFTW3
-		dft_input = fftw_alloc_real(2<<derivation_size);
-		dft_output = fftw_alloc_complex(2<<derivation_size);
-		dft_plan = fftw_plan_dft_r2c_1d(
-			2<<derivation_size,
-			dft_input,
-			dft_output,
-			FFTW_MEASURE);
+			// Measuring overwrites the arrays, and each derivation executes the
+			// plan on its own arrays anyway, so plan with temporary ones
+			double *dft_input = fftw_alloc_real(2<<level.derivation_size);
+			fftw_complex *dft_output = fftw_alloc_complex(2<<level.derivation_size);
+			level.plan = fftw_plan_dft_r2c_1d(
+				2<<level.derivation_size,
+				dft_input,
+				dft_output,
+				FFTW_MEASURE);
+			fftw_free(dft_input);
+			fftw_free(dft_output);
+
+			jobs->levels.push_back({level.cache.get(), level.derivation_size, level.derivation_dist, level.plan});
 #else
-		// Allocate scratch for 6x the derivation size:
-		// 2x for the input sample data
-		// 2x for the real part of the output
-		// 2x for the imaginary part of the output
-		fft_scratch.resize(6 << derivation_size);
+			jobs->levels.push_back({level.cache.get(), level.derivation_size, level.derivation_dist});
 #endif
-		audio_scratch.resize(2 << derivation_size);
+			levels.push_back(std::move(level));
+		}
+
+		OpenDiskCache(levels[0].block_pending.size());
+		jobs->disk_cache = disk_cache.get();
 	}
 }
 
-void AudioSpectrumRenderer::OnSetProvider()
+size_t AudioSpectrumRenderer::CurrentLevel() const
 {
-	RecreateCache();
+	// Use the first level which has no more than about one block per pixel,
+	// as anything finer would be computed only to be skipped over
+	double samples_per_pixel = pixel_ms * provider->GetSampleRate() / 1000;
+	size_t level = 0;
+	while (level + 1 < levels.size() && samples_per_pixel >= (double)((int64_t)2 << levels[level].derivation_dist))
+		++level;
+	return level;
 }
 
-void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _derivation_dist)
+void AudioSpectrumRenderer::QueueBlocks(size_t level_index, std::vector<size_t> blocks)
 {
-	if (derivation_dist != _derivation_dist)
+	auto jobs = this->jobs;
 	{
-		derivation_dist = _derivation_dist;
-		if (cache)
-			cache->Age(0);
+		std::lock_guard<std::mutex> lock(jobs->mutex);
+		++jobs->running;
 	}
 
-	if (derivation_size != _derivation_size)
-	{
-		derivation_size = _derivation_size;
-		RecreateCache();
-	}
-}
+	agi::dispatch::Background().Async([=] {
+		if (!jobs->cancelled)
+		{
+			auto const& level = jobs->levels[level_index];
+			auto disk_cache = level_index == 0 ? jobs->disk_cache : nullptr;
+#ifdef WITH_FFTW3
+			AudioSpectrumDerivation derivation(level.derivation_size, level.derivation_dist, level.plan);
+#else
+			AudioSpectrumDerivation derivation(level.derivation_size, level.derivation_dist);
+#endif
+			for (size_t block_index : blocks)
+			{
+				if (jobs->cancelled) break;
+				AudioSpectrumCacheBlockFactory::BlockType block(new SpectrumValue[(size_t)1 << level.derivation_size]);
+				// Blocks computed from audio which hasn't finished decoding yet
+				// would be wrong once it has, so only those fully covered by
+				// decoded audio are kept on disk
+				if (derivation.Compute(jobs->provider, block_index, block.get()) && disk_cache)
+					disk_cache->Write(block_index, block.get());
+				level.cache->Insert(block_index, std::move(block));
+			}
+		}
 
-template<class T>
-void AudioSpectrumRenderer::ConvertToFloat(size_t count, T *dest) {
-	for (size_t si = 0; si < count; ++si)
-	{
-		dest[si] = (T)(audio_scratch[si]) / 32768.0;
-	}
+		agi::dispatch::Main().Async([=] {
+			// Cancellation happens on the GUI thread before the renderer
+			// changes or goes away, so this is all that's needed to know
+			// that it's still safe to use
+			if (jobs->cancelled) return;
+
+			auto& block_pending = levels[level_index].block_pending;
+			for (size_t block_index : blocks)
+				block_pending[block_index] = false;
+			AnnounceBlocksReady();
+		});
+
+		std::lock_guard<std::mutex> lock(jobs->mutex);
+		if (--jobs->running == 0)
+			jobs->idle.notify_all();
+	});
 }
 
-void AudioSpectrumRenderer::FillBlock(size_t block_index, float *block)
+void AudioSpectrumRenderer::OpenDiskCache(size_t block_count)
 {
-	assert(cache);
-	assert(block);
-
-	int64_t first_sample = (((int64_t)block_index) << derivation_dist) - ((int64_t)1 << derivation_size);
-	provider->GetAudio(&audio_scratch[0], first_sample, 2 << derivation_size);
-
-#ifdef WITH_FFTW3
-	ConvertToFloat(2 << derivation_size, dft_input);
-
-	fftw_execute(dft_plan);
-
-	double scale_factor = 9 / sqrt(2 << (derivation_size + 1));
+	if (audio_file.empty() || !OPT_GET("Audio/Renderer/Spectrum/Disk Cache/Enable")->GetBool())
+		return;
 
-	fftw_complex *o = dft_output;
-	for (size_t si = (size_t)1<<derivation_size; si > 0; --si)
+	try
 	{
-		*block++ = log10( sqrt(o[0][0] * o[0][0] + o[0][1] * o[0][1]) * scale_factor + 1 );
-		o++;
+		if (!agi::fs::FileExists(audio_file))
+			return;
+
+		// Identify the audio the same way the FFMS2 index cache does
+		auto const& name = audio_file.string();
+		boost::crc_32_type hash;
+		hash.process_bytes(name.c_str(), name.size());
+
+		auto dir = config::path->Decode("?local/spectrumcache/");
+		agi::fs::CreateDirectory(dir);
+		auto filename = dir / agi::format("%u_%d_%d_%d_%d.spectrum", hash.checksum(),
+			agi::fs::Size(audio_file), agi::fs::ModifiedTime(audio_file),
+			derivation_size, derivation_dist);
+
+		auto max_size = (uint64_t)OPT_GET("Audio/Renderer/Spectrum/Disk Cache/Size")->GetInt() << 20;
+		disk_cache = agi::make_unique<AudioSpectrumDiskCache>(filename,
+			AudioSpectrumDiskCache::MakeHeader(derivation_size, derivation_dist, provider, block_count),
+			max_size);
+
+		CleanCache(dir, "*.spectrum", OPT_GET("Audio/Renderer/Spectrum/Disk Cache/Size")->GetInt(),
+			OPT_GET("Audio/Renderer/Spectrum/Disk Cache/Files")->GetInt());
 	}
-#else
-	ConvertToFloat(2 << derivation_size, &fft_scratch[0]);
-
-	float *fft_input = &fft_scratch[0];
-	float *fft_real = &fft_scratch[0] + (2 << derivation_size);
-	float *fft_imag = &fft_scratch[0] + (4 << derivation_size);
-
-	FFT fft;
-	fft.Transform(2<<derivation_size, fft_input, fft_real, fft_imag);
+	catch (agi::Exception const& e)
+	{
+		LOG_E("audio/renderer/spectrum") << "Failed to open spectrum disk cache: " << e.GetMessage();
+		disk_cache.reset();
+	}
+}
 
-	float scale_factor = 9 / sqrt(2 * (float)(2<<derivation_size));
+void AudioSpectrumRenderer::OnSetProvider()
+{
+	RecreateCache();
+}
 
-	for (size_t si = 1<<derivation_size; si > 0; --si)
+void AudioSpectrumRenderer::SetResolution(size_t _derivation_size, size_t _derivation_dist)
+{
+	if (derivation_dist != _derivation_dist || derivation_size != _derivation_size)
 	{
-		// With x in range [0;1], log10(x*9+1) will also be in range [0;1],
-		// although the FFT output can apparently get greater magnitudes than 1
-		// despite the input being limited to [-1;+1).
-		*block++ = log10( sqrt(*fft_real * *fft_real + *fft_imag * *fft_imag) * scale_factor + 1 );
-		fft_real++; fft_imag++;
+		derivation_dist = _derivation_dist;
+		derivation_size = _derivation_size;
+		RecreateCache();
 	}
-#endif
 }
 
 void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle style)
 {
-	if (!cache)
+	if (levels.empty())
 		return;
 
 	assert(bmp.IsOk());
@@ -223,64 +575,123 @@ void AudioSpectrumRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 	assert(end >= 0);
 	assert(end >= start);
 
-	// Prepare an image buffer to write
-	wxImage img(bmp.GetSize());
+	// Prepare an image buffer to write. Every pixel gets written, so it
+	// doesn't need clearing first.
+	wxImage img(bmp.GetWidth(), bmp.GetHeight(), false);
 	unsigned char *imgdata = img.GetData();
 	ptrdiff_t stride = img.GetWidth()*3;
 	int imgheight = img.GetHeight();
 
 	const AudioColorScheme *pal = &colors[style];
 
+	size_t level_index = CurrentLevel();
+	Level& level = levels[level_index];
+	auto& cache = level.cache;
+	auto& block_pending = level.block_pending;
+	const int bands = 1 << level.derivation_size;
+
 	/// @todo Make minband and maxband configurable
 	int minband = 0;
-	int maxband = 1 << derivation_size;
+	int maxband = bands;
+
+	// Blocks which aren't available yet are computed in the background and
+	// drawn as silence until they arrive
+	std::vector<size_t> missing;
+
+	// Which bands each row of the image is drawn from. This is the same for
+	// every column, so work it out once rather than for every pixel.
+	struct RowSource {
+		int first;  ///< First band
+		int last;   ///< Last band
+		float frac; ///< When interpolating, how much of last to use
+	};
+	// Scale up or down vertically?
+	const bool interpolate = imgheight > bands;
+	std::vector<RowSource> rows(imgheight);
+	for (int y = 0; y < imgheight; ++y)
+	{
+		if (interpolate)
+		{
+			auto ideal = (double)(y+1.)/imgheight * (maxband-minband) + minband;
+			rows[y].first = std::min(bands-1, (int)floor(ideal)+minband);
+			rows[y].last = std::min(bands-1, (int)ceil(ideal)+minband);
+			rows[y].frac = ideal - floor(ideal);
+		}
+		else
+		{
+			// Pick greatest
+			rows[y].first = std::max(0, maxband * y/imgheight + minband);
+			rows[y].last = std::min(bands-1, maxband * (y+1)/imgheight + minband);
+			rows[y].frac = 0;
+		}
+	}
+
+	// Values of the column being drawn, from the bottom up, which are then
+	// mapped to colours in one go. They're left in the units of the stored
+	// values, and scaled back as part of the mapping.
+	std::vector<float> column(imgheight);
+	const std::vector<float> silence(imgheight);
+
+	// Draw one column of the image from a block of derived audio data
+	auto draw_column = [&](const SpectrumValue *power, unsigned char *px)
+	{
+		if (interpolate)
+		{
+			for (int y = 0; y < imgheight; ++y)
+			{
+				auto const& row = rows[y];
+				column[y] = (1-row.frac)*power[row.first] + row.frac*power[row.last];
+			}
+		}
+		else
+		{
+			for (int y = 0; y < imgheight; ++y)
+				column[y] = *std::max_element(&power[rows[y].first], &power[rows[y].last + 1]);
+		}
+		pal->map(column.data(), imgheight, amplitude_scale / spectrum_value_scale, px, -stride);
+	};
 
 	// ax = absolute x, absolute to the virtual spectrum bitmap
 	for (int ax = start; ax < end; ++ax)
 	{
 		// Derived audio data
-		size_t block_index = (size_t)(ax * pixel_ms * provider->GetSampleRate() / 1000) >> derivation_dist;
-		float *power = &cache->Get(block_index);
+		size_t block_index = (size_t)(ax * pixel_ms * provider->GetSampleRate() / 1000) >> level.derivation_dist;
 
 		// Prepare bitmap writing
 		unsigned char *px = imgdata + (imgheight-1) * stride + (ax - start) * 3;
 
-		// Scale up or down vertically?
-		if (imgheight > 1<<derivation_size)
+		if (cache->Find(block_index, [&](SpectrumValue& power) { draw_column(&power, px); }))
+			continue;
+
+		if (level_index == 0 && disk_cache && !block_pending[block_index])
 		{
-			// Interpolate
-			for (int y = 0; y < imgheight; ++y)
+			AudioSpectrumCacheBlockFactory::BlockType block(new SpectrumValue[(size_t)bands]);
+			if (disk_cache->Read(block_index, block.get()))
 			{
-				assert(px >= imgdata);
-				assert(px < imgdata + imgheight*stride);
-				auto ideal = (double)(y+1.)/imgheight * (maxband-minband) + minband;
-				float sample1 = power[(int)floor(ideal)+minband];
-				float sample2 = power[(int)ceil(ideal)+minband];
-				float frac = ideal - floor(ideal);
-				float val = (1-frac)*sample1 + frac*sample2;
-				pal->map(val*amplitude_scale, px);
-				px -= stride;
+				draw_column(block.get(), px);
+				cache->Insert(block_index, std::move(block));
+				continue;
 			}
 		}
-		else
+
+		if (!block_pending[block_index])
 		{
-			// Pick greatest
-			for (int y = 0; y < imgheight; ++y)
-			{
-				assert(px >= imgdata);
-				assert(px < imgdata + imgheight*stride);
-				int sample1 = std::max(0, maxband * y/imgheight + minband);
-				int sample2 = std::min((1<<derivation_size)-1, maxband * (y+1)/imgheight + minband);
-				float maxval = *std::max_element(&power[sample1], &power[sample2 + 1]);
-				pal->map(maxval*amplitude_scale, px);
-				px -= stride;
-			}
+			block_pending[block_index] = true;
+			missing.push_back(block_index);
 		}
+
+		pal->map(silence.data(), imgheight, 1.f, px, -stride);
+	}
+
+	for (size_t i = 0; i < missing.size(); i += blocks_per_job)
+	{
+		auto first = begin(missing) + i;
+		QueueBlocks(level_index, std::vector<size_t>(first, first + std::min(blocks_per_job, missing.size() - i)));
 	}
 
-	wxBitmap tmpbmp(img);
-	wxMemoryDC targetdc(bmp);
-	targetdc.DrawBitmap(tmpbmp, 0, 0);
+	// Converting the image is the only copy of the pixels into the bitmap,
+	// rather than converting it to a second bitmap and drawing that
+	bmp = wxBitmap(img, 24);
 }
 
 void AudioSpectrumRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style)
@@ -294,6 +705,30 @@ void AudioSpectrumRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRende
 
 void AudioSpectrumRenderer::AgeCache(size_t max_size)
 {
-	if (cache)
-		cache->Age(max_size);
+	if (levels.empty())
+		return;
+
+	// The level being displayed gets most of the budget, and the rest is
+	// kept around so that zooming back in or out doesn't start from nothing
+	size_t current = CurrentLevel();
+	if (levels.size() == 1)
+	{
+		levels[0].cache->Age(max_size);
+		return;
+	}
+
+	size_t other_size = max_size / 4 / (levels.size() - 1);
+	for (size_t i = 0; i < levels.size(); ++i)
+		levels[i].cache->Age(i == current ? max_size - max_size / 4 : other_size);
+}
+
+size_t AudioSpectrumRenderer::GetCacheBytesPerPixel() const
+{
+	if (levels.empty()) return 0;
+
+	// Each column uses a single block, which is shared with its neighbours
+	// when zoomed in far enough
+	auto const& level = levels[CurrentLevel()];
+	double blocks_per_pixel = pixel_ms * provider->GetSampleRate() / 1000 / ((size_t)1 << level.derivation_dist);
+	return (size_t)ceil(std::min(1.0, blocks_per_pixel) * (sizeof(SpectrumValue) << level.derivation_size));
 }
@@ -39,13 +39,19 @@
 
 #include "audio_renderer.h"
 
+#include <libaegisub/fs_fwd.h>
+#include <libaegisub/signal.h>
+
+#include <boost/filesystem/path.hpp>
+
 #ifdef WITH_FFTW3
 #include <fftw3.h>
 #endif
 
 class AudioColorScheme;
 class AudioSpectrumCache;
-struct AudioSpectrumCacheBlockFactory;
+class AudioSpectrumDiskCache;
+struct AudioSpectrumJobs;
 
 /// @class AudioSpectrumRenderer
 /// @brief Render frequency-power spectrum graphs for audio data.
@@ -53,10 +59,39 @@ struct AudioSpectrumCacheBlockFactory;
 /// Renders frequency-power spectrum graphs of PCM audio data using a derivation function
 /// such as the fast fourier transform.
 class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
-	friend struct AudioSpectrumCacheBlockFactory;
+	/// @brief One level of detail of the spectrum
+	///
+	/// Level 0 is the resolution set with SetResolution. Each level after it
+	/// has twice the distance between derivations and, down to a minimum,
+	/// half the derivation size, and is used when zoomed out far enough that
+	/// the finer levels would have more than one block per pixel.
+	struct Level {
+		/// Computed blocks for this level
+		std::unique_ptr<AudioSpectrumCache> cache;
+
+		/// Binary logarithm of number of samples used in each derivation
+		size_t derivation_size;
+
+		/// Binary logarithm of number of samples between derivations
+		size_t derivation_dist;
+
+		/// Blocks which have been queued for computation but haven't arrived yet
+		std::vector<bool> block_pending;
+
+#ifdef WITH_FFTW3
+		/// FFTW plan for derivations of this size
+		fftw_plan plan = nullptr;
+#endif
+	};
 
-	/// Internal cache management for the spectrum
-	std::unique_ptr<AudioSpectrumCache> cache;
+	/// Levels of detail, finest first
+	std::vector<Level> levels;
+
+	/// Persistent copy of the computed blocks of level 0, if enabled
+	std::unique_ptr<AudioSpectrumDiskCache> disk_cache;
+
+	/// File the audio was loaded from, used to identify the disk cache
+	agi::fs::path audio_file;
 
 	/// Colour tables used for rendering
 	std::vector<AudioColorScheme> colors;
@@ -67,6 +102,11 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// Binary logarithm of number of samples between the start of derivations
 	size_t derivation_dist = 0;
 
+	/// State shared with the background tasks computing blocks
+	std::shared_ptr<AudioSpectrumJobs> jobs;
+
+	agi::signal::Signal<> AnnounceBlocksReady;
+
 	/// @brief Reset in response to changing audio provider
 	///
 	/// Overrides the OnSetProvider event handler in the base class, to reset things
@@ -79,36 +119,30 @@ class AudioSpectrumRenderer final : public AudioRendererBitmapProvider {
 	/// e.g. new audio provider or new resolution.
 	void RecreateCache();
 
-	/// @brief Fill a block with frequency-power data for a time range
-	/// @param      block_index Index of the block to fill data for
-	/// @param[out] block       Address to write the data to
-	void FillBlock(size_t block_index, float *block);
+	/// @brief Open the disk cache for the current audio and resolution
+	/// @param block_count Number of blocks in the in-memory cache
+	void OpenDiskCache(size_t block_count);
 
-	/// @brief Convert audio data to float range [-1;+1)
-	/// @param count Samples to convert
-	/// @param dest Buffer to fill
-	template<class T>
-	void ConvertToFloat(size_t count, T *dest);
+	/// @brief Stop all outstanding background computation and wait for it to finish
+	void CancelJobs();
 
-#ifdef WITH_FFTW3
-	/// FFTW plan data
-	fftw_plan dft_plan = nullptr;
-	/// Pre-allocated input array for FFTW
-	double *dft_input = nullptr;
-	/// Pre-allocated output array for FFTW
-	fftw_complex *dft_output = nullptr;
-#else
-	/// Pre-allocated scratch area for doing FFT derivations
-	std::vector<float> fft_scratch;
-#endif
+	/// @brief Compute blocks on the background queue
+	/// @param level Level of detail the blocks are for
+	/// @param blocks Indices of the blocks to compute
+	///
+	/// The blocks are added to the cache as they are finished, and
+	/// AnnounceBlocksReady is signalled once the whole batch is done.
+	void QueueBlocks(size_t level, std::vector<size_t> blocks);
 
-	/// Pre-allocated scratch area for storing raw audio data
-	std::vector<int16_t> audio_scratch;
+	/// Get the level of detail to use at the current zoom
+	size_t CurrentLevel() const;
 
 public:
 	/// @brief Constructor
 	/// @param color_scheme_name Name of the color scheme to use
-	AudioSpectrumRenderer(std::string const& color_scheme_name);
+	/// @param audio_file File the audio which will be rendered came from, or
+	///                   empty to disable the disk cache
+	AudioSpectrumRenderer(std::string const& color_scheme_name, agi::fs::path const& audio_file);
 
 	/// @brief Destructor
 	~AudioSpectrumRenderer();
@@ -136,4 +170,11 @@ public:
 	/// @brief Cleans up the cache
 	/// @param max_size Maximum size in bytes for the cache
 	void AgeCache(size_t max_size) override;
+
+	/// @brief Get the amount of cache used per pixel rendered
+	size_t GetCacheBytesPerPixel() const override;
+
+	/// Blocks computed in the background have been added to the cache, so
+	/// anything rendered with placeholders should be rendered again
+	DEFINE_SIGNAL_ADDERS(AnnounceBlocksReady, AddBlocksReadyListener)
 };
@@ -35,7 +35,10 @@
 #include <libaegisub/audio/provider.h>
 
 #include <algorithm>
-#include <wx/dcmemory.h>
+#include <cstring>
+
+#include <wx/dc.h>
+#include <wx/image.h>
 
 enum {
 	/// Only render the peaks
@@ -57,56 +60,50 @@ AudioWaveformRenderer::~AudioWaveformRenderer() { }
 
 void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle style)
 {
-	wxMemoryDC dc(bmp);
-	wxRect rect(wxPoint(0, 0), bmp.GetSize());
-	int midpoint = rect.height / 2;
+	// Drawing each column with a wxDC is slow on some platforms, so the
+	// waveform is written straight into an image like the spectrum is
+	wxImage img(bmp.GetSize());
+	unsigned char *imgdata = img.GetData();
+	const ptrdiff_t stride = img.GetWidth() * 3;
+	const int width = img.GetWidth();
+	const int height = img.GetHeight();
+	const int midpoint = height / 2;
 
 	const AudioColorScheme *pal = &colors[style];
 
-	double pixel_samples = pixel_ms * provider->GetSampleRate() / 1000.0;
+	unsigned char bg_colour[3], peak_colour[3], avg_colour[3];
+	pal->map(0.0f, bg_colour);
+	pal->map(0.4f, peak_colour);
+	pal->map(0.7f, avg_colour);
 
-	// Fill the background
-	dc.SetBrush(wxBrush(pal->get(0.0f)));
-	dc.SetPen(*wxTRANSPARENT_PEN);
-	dc.DrawRectangle(rect);
+	// Fill rows [top, bottom) of column x with a colour
+	auto fill = [&](int x, int top, int bottom, const unsigned char *colour) {
+		top = std::max(top, 0);
+		bottom = std::min(bottom, height);
+		unsigned char *px = imgdata + x * 3;
+		for (int y = top; y < bottom; ++y)
+			memcpy(px + y * stride, colour, 3);
+	};
 
-	// Make sure we've got a buffer to fill with audio data
-	if (!audio_buffer)
+	// Fill the background
+	if (height > 0)
 	{
-		// Buffer for one pixel strip of audio
-		size_t buffer_needed = pixel_samples * provider->GetChannels() * provider->GetBytesPerSample();
-		audio_buffer.reset(new char[buffer_needed]);
+		for (int x = 0; x < width; ++x)
+			memcpy(imgdata + x * 3, bg_colour, 3);
+		for (int y = 1; y < height; ++y)
+			memcpy(imgdata + y * stride, imgdata, stride);
 	}
 
+	double pixel_samples = pixel_ms * provider->GetSampleRate() / 1000.0;
 	double cur_sample = start * pixel_samples;
 
-	assert(provider->GetBytesPerSample() == 2);
-	assert(provider->GetChannels() == 1);
-
-	wxPen pen_peaks(wxPen(pal->get(0.4f)));
-	wxPen pen_avgs(wxPen(pal->get(0.7f)));
-
-	for (int x = 0; x < rect.width; ++x)
+	for (int x = 0; x < width; ++x)
 	{
-		provider->GetAudio(audio_buffer.get(), (int64_t)cur_sample, (int64_t)pixel_samples);
+		auto peak = provider->GetPeaks((int64_t)cur_sample, (int64_t)pixel_samples);
 		cur_sample += pixel_samples;
 
-		int peak_min = 0, peak_max = 0;
-		int64_t avg_min_accum = 0, avg_max_accum = 0;
-		auto aud = reinterpret_cast<const int16_t *>(audio_buffer.get());
-		for (int si = pixel_samples; si > 0; --si, ++aud)
-		{
-			if (*aud > 0)
-			{
-				peak_max = std::max(peak_max, (int)*aud);
-				avg_max_accum += *aud;
-			}
-			else
-			{
-				peak_min = std::min(peak_min, (int)*aud);
-				avg_min_accum += *aud;
-			}
-		}
+		int peak_min = peak.min, peak_max = peak.max;
+		int64_t avg_min_accum = peak.neg_sum, avg_max_accum = peak.pos_sum;
 
 		// midpoint is half height
 		peak_min = std::max((int)(peak_min * amplitude_scale * midpoint) / 0x8000, -midpoint);
@@ -114,21 +111,27 @@ void AudioWaveformRenderer::Render(wxBitmap &bmp, int start, AudioRenderingStyle
 		int avg_min = std::max((int)(avg_min_accum * amplitude_scale * midpoint / pixel_samples) / 0x8000, -midpoint);
 		int avg_max = std::min((int)(avg_max_accum * amplitude_scale * midpoint / pixel_samples) / 0x8000, midpoint);
 
-		dc.SetPen(pen_peaks);
-		dc.DrawLine(x, midpoint - peak_max, x, midpoint - peak_min);
-		if (render_averages) {
-			dc.SetPen(pen_avgs);
-			dc.DrawLine(x, midpoint - avg_max, x, midpoint - avg_min);
-		}
+		// Like DrawLine, these leave out the last pixel
+		fill(x, midpoint - peak_max, midpoint - peak_min, peak_colour);
+		if (render_averages)
+			fill(x, midpoint - avg_max, midpoint - avg_min, avg_colour);
 	}
 
 	// Horizontal zero-point line
-	if (render_averages)
-		dc.SetPen(wxPen(pal->get(1.0f)));
-	else
-		dc.SetPen(pen_peaks);
+	if (midpoint < height)
+	{
+		unsigned char zero_colour[3];
+		if (render_averages)
+			pal->map(1.0f, zero_colour);
+		else
+			memcpy(zero_colour, peak_colour, 3);
+		for (int x = 0; x < width; ++x)
+			memcpy(imgdata + midpoint * stride + x * 3, zero_colour, 3);
+	}
 
-	dc.DrawLine(0, midpoint, rect.width, midpoint);
+	// Converting the image is the only copy of the pixels into the bitmap,
+	// rather than converting it to a second bitmap and drawing that
+	bmp = wxBitmap(img, 24);
 }
 
 void AudioWaveformRenderer::RenderBlank(wxDC &dc, const wxRect &rect, AudioRenderingStyle style)
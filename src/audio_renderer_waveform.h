@@ -40,15 +40,9 @@ class AudioWaveformRenderer final : public AudioRendererBitmapProvider {
 	/// Colour tables used for rendering
 	std::vector<AudioColorScheme> colors;
 
-	/// Pre-allocated buffer for audio fetched from provider
-	std::unique_ptr<char[]> audio_buffer;
-
 	/// Whether to render max+avg or just max
 	bool render_averages;
 
-	void OnSetProvider() override { audio_buffer.reset(); }
-	void OnSetMillisecondsPerPixel() override { audio_buffer.reset(); }
-
 public:
 	/// @brief Constructor
 	/// @param color_scheme_name Name of the color scheme to use
@@ -57,6 +57,10 @@ protected:
 	/// One or more rendering style ranges have changed in the timing controller.
 	agi::signal::Signal<> AnnounceUpdatedStyleRanges;
 
+	/// Markers or labels have moved only within the given time range, so
+	/// the rest of the display does not need to be redrawn.
+	agi::signal::Signal<TimeRange> AnnounceUpdatedTimeRange;
+
 public:
 	/// @brief Get any warning message to show in the audio display
 	/// @return The warning message to show, may be empty if there is none
@@ -172,11 +176,15 @@ public:
 	/// @param snap_range   Maximum snapping range in milliseconds
 	virtual void OnMarkerDrag(std::vector<AudioMarker*> const& marker, int new_position, int snap_range) = 0;
 
+	/// @brief The user released the markers being dragged
+	virtual void OnMarkerDragEnd() { }
+
 	/// @brief Destructor
 	virtual ~AudioTimingController() = default;
 
 	DEFINE_SIGNAL_ADDERS(AnnounceUpdatedPrimaryRange, AddUpdatedPrimaryRangeListener)
 	DEFINE_SIGNAL_ADDERS(AnnounceUpdatedStyleRanges, AddUpdatedStyleRangesListener)
+	DEFINE_SIGNAL_ADDERS(AnnounceUpdatedTimeRange, AddUpdatedTimeRangeListener)
 };
 
 /// @brief Create a standard dialogue audio timing controller
@@ -29,6 +29,7 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "audio_controller.h"
 #include "audio_marker.h"
 #include "audio_rendering_style.h"
 #include "audio_timing.h"
@@ -43,6 +44,7 @@
 #include <libaegisub/make_unique.h>
 
 #include <boost/range/algorithm.hpp>
+#include <set>
 #include <wx/pen.h>
 
 namespace {
@@ -332,6 +334,7 @@ class AudioTimingControllerDialogue final : public AudioTimingController {
 	const agi::OptionValue *inactive_line_mode = OPT_GET("Audio/Inactive Lines Display Mode");
 	const agi::OptionValue *inactive_line_comments = OPT_GET("Audio/Display/Draw/Inactive Comments");
 	const agi::OptionValue *drag_timing = OPT_GET("Audio/Drag Timing");
+	const agi::OptionValue *snap_to_silence = OPT_GET("Audio/Snap/Silence");
 
 	agi::signal::Connection commit_connection;
 	agi::signal::Connection audio_open_connection;
@@ -379,7 +382,7 @@ class AudioTimingControllerDialogue final : public AudioTimingController {
 	void OnSelectedSetChanged();
 
 	// AssFile events
-	void OnFileChanged(int type);
+	void OnFileChanged(int type, const AssDialogue *changed, AssCommitChanges const& changes);
 
 public:
 	// AudioMarkerProvider interface
@@ -453,9 +456,22 @@ void AudioTimingControllerDialogue::OnSelectedSetChanged()
 	RegenerateInactiveLines();
 }
 
-void AudioTimingControllerDialogue::OnFileChanged(int type) {
-	if (type & AssFile::COMMIT_DIAG_TIME)
-		Revert();
+void AudioTimingControllerDialogue::OnFileChanged(int type, const AssDialogue *, AssCommitChanges const& changes) {
+	if (type & AssFile::COMMIT_DIAG_TIME) {
+		// The markers for the active and selected lines only need resetting
+		// if one of them was among the lines changed
+		auto active = context->selectionController->GetActiveLine();
+		auto const& sel = context->selectionController->GetSelectedSet();
+		bool selection_changed = !changes.known || any_of(begin(changes.lines), end(changes.lines), [&](const AssDialogue *line) {
+			return line == active || sel.count(const_cast<AssDialogue *>(line));
+		});
+		if (selection_changed)
+			Revert();
+		else {
+			commit_id = -1;
+			RegenerateInactiveLines();
+		}
+	}
 	else if (type & AssFile::COMMIT_DIAG_ADDREM)
 		RegenerateInactiveLines();
 }
@@ -506,17 +522,19 @@ void AudioTimingControllerDialogue::DoCommit(bool user_triggered)
 		for (auto line : modified_lines)
 			line->Apply();
 
+		std::vector<AssDialogue *> lines;
+		lines.reserve(modified_lines.size());
+		for (auto line : modified_lines)
+			lines.push_back(line->GetLine());
+
 		commit_connection.Block();
 		if (user_triggered)
 		{
-			context->ass->Commit(_("timing"), AssFile::COMMIT_DIAG_TIME);
+			context->ass->Commit(_("timing"), AssFile::COMMIT_DIAG_TIME, lines);
 			commit_id = -1; // never coalesce with a manually triggered commit
 		}
 		else
-		{
-			AssDialogue *amend = modified_lines.size() == 1 ? (*modified_lines.begin())->GetLine() : nullptr;
-			commit_id = context->ass->Commit(_("timing"), AssFile::COMMIT_DIAG_TIME, commit_id, amend);
-		}
+			commit_id = context->ass->Commit(_("timing"), AssFile::COMMIT_DIAG_TIME, lines, commit_id);
 
 		commit_connection.Unblock();
 		modified_lines.clear();
@@ -661,7 +679,7 @@ void AudioTimingControllerDialogue::SetMarkers(std::vector<AudioMarker*> const&
 
 	// Since we're moving markers, the sorted list of markers will need to be
 	// resorted. To avoid resorting the entire thing, find the subrange that
-	// is effected.
+	// is effected, including anywhere snapping could move them to.
 	int min_ms = ms;
 	int max_ms = ms;
 	for (AudioMarker *upd_marker : upd_markers)
@@ -677,8 +695,8 @@ void AudioTimingControllerDialogue::SetMarkers(std::vector<AudioMarker*> const&
 		}
 	}
 
-	auto begin = boost::lower_bound(markers, min_ms, marker_ptr_cmp());
-	auto end = upper_bound(begin, markers.end(), max_ms, marker_ptr_cmp());
+	auto begin = boost::lower_bound(markers, min_ms - std::max(snap_range, 0), marker_ptr_cmp());
+	auto end = upper_bound(begin, markers.end(), max_ms + std::max(snap_range, 0), marker_ptr_cmp());
 
 	// Update the markers
 	for (auto upd_marker : upd_markers)
@@ -688,12 +706,14 @@ void AudioTimingControllerDialogue::SetMarkers(std::vector<AudioMarker*> const&
 		modified_lines.insert(marker->GetLine());
 	}
 
+	// Snapping looks up the markers to snap to in the sorted list, so it has
+	// to be sorted both before and after
+	sort(begin, end, marker_ptr_cmp());
 	int snap = SnapMarkers(snap_range, upd_markers);
 	if (clicked_ms != INT_MIN)
 		clicked_ms += snap;
-
-	// Resort the range
-	sort(begin, end, marker_ptr_cmp());
+	if (snap)
+		sort(begin, end, marker_ptr_cmp());
 
 	if (auto_commit->GetBool()) DoCommit(false);
 	UpdateSelection();
@@ -842,40 +862,21 @@ int AudioTimingControllerDialogue::SnapMarkers(int snap_range, std::vector<Audio
 		return TimeRange{min - snap_range, max + snap_range};
 	}();
 
-	std::vector<int> inactive_markers;
-	inactive_markers.reserve(inactive_lines.size() * 2 + selected_lines.size() * 2 + 2 - active.size());
-
-	// Add a marker to the set to check for snaps if it's in the right time
-	// range, isn't at the same place as a marker already in the set, and isn't
-	// one of the markers being moved
-	auto add_inactive = [&](const DialogueTimingMarker *m, bool check)
-	{
-		if (!marker_range.contains(*m)) return;
-		if (!inactive_markers.empty() && inactive_markers.back() == *m) return;
-		if (check && boost::find(active, m) != end(active)) return;
-		inactive_markers.push_back(*m);
-	};
+	// The markers being moved, sorted by address for lookup
+	std::vector<const AudioMarker *> moving(active.begin(), active.end());
+	boost::sort(moving);
 
-	bool moving_entire_selection = clicked_ms != INT_MIN;
-	for (auto const& line : inactive_lines)
+	// Collect the positions of the markers in the snapping range which aren't
+	// being moved, using the sorted list of markers so that only the ones in
+	// the range have to be looked at
+	std::vector<int> inactive_markers;
+	auto range_end = boost::upper_bound(markers, marker_range.end(), marker_ptr_cmp());
+	for (auto it = boost::lower_bound(markers, marker_range.begin(), marker_ptr_cmp()); it != range_end; ++it)
 	{
-		// If we're alt-dragging the entire selection, there can't be any
-		// markers from inactive lines in the active set, so no need to check
-		// for them
-		add_inactive(line.GetLeftMarker(), !moving_entire_selection);
-		add_inactive(line.GetRightMarker(), !moving_entire_selection);
-	}
-
-	// And similarly, there can't be any inactive markers from selected lines
-	if (!moving_entire_selection)
-	{
-		for (auto const& line : selected_lines)
-		{
-			add_inactive(line.GetLeftMarker(), true);
-			add_inactive(line.GetRightMarker(), true);
-		}
-		add_inactive(active_line.GetLeftMarker(), true);
-		add_inactive(active_line.GetRightMarker(), true);
+		int pos = **it;
+		if (!inactive_markers.empty() && inactive_markers.back() == pos) continue;
+		if (boost::binary_search(moving, static_cast<const AudioMarker *>(*it))) continue;
+		inactive_markers.push_back(pos);
 	}
 
 	int snap_distance = INT_MAX;
@@ -904,6 +905,17 @@ int AudioTimingControllerDialogue::SnapMarkers(int snap_range, std::vector<Audio
 			if (snap_distance == 0) return 0;
 		}
 
+		// Start markers snap to where speech starts and end markers to where it stops
+		if (snap_to_silence->GetBool())
+		{
+			int edge = context->audioController->FindSilenceEdge(pos, snap_range, active_marker->GetFeet() == AudioMarker::Feet_Right);
+			if (edge >= 0)
+			{
+				check(edge, pos);
+				if (snap_distance == 0) return 0;
+			}
+		}
+
 		for (auto it = boost::lower_bound(inactive_markers, range.begin()); it != end(inactive_markers); ++it)
 		{
 			check(*it, pos);
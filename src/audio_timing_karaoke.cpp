@@ -108,6 +108,7 @@ class AudioTimingControllerKaraoke final : public AudioTimingController {
 	bool auto_commit = OPT_GET("Audio/Auto/Commit")->GetBool();
 	int commit_id = -1;   ///< Last commit id used for an autocommit
 	bool pending_changes; ///< Are there any pending changes to be committed?
+	bool dragging = false; ///< Is an autocommit being held back until the drag ends?
 
 	void DoCommit();
 	void ApplyLead(bool announce_primary);
@@ -135,6 +136,7 @@ public:
 	std::vector<AudioMarker*> OnLeftClick(int ms, bool, bool, int sensitivity, int) override;
 	std::vector<AudioMarker*> OnRightClick(int ms, bool, int, int) override;
 	void OnMarkerDrag(std::vector<AudioMarker*> const& marker, int new_position, int) override;
+	void OnMarkerDragEnd() override;
 
 	AudioTimingControllerKaraoke(agi::Context *c, AssKaraoke *kara, agi::signal::Connection& file_changed);
 };
@@ -254,6 +256,7 @@ void AudioTimingControllerKaraoke::Revert() {
 	cur_syl = 0;
 	commit_id = -1;
 	pending_changes = false;
+	dragging = false;
 
 	start_marker.Move(active_line->Start);
 	end_marker.Move(active_line->End);
@@ -410,14 +413,36 @@ void AudioTimingControllerKaraoke::OnMarkerDrag(std::vector<AudioMarker*> const&
 	int syl = MoveMarker(static_cast<KaraokeMarker *>(m[0]), new_position);
 	if (syl < 0) return;
 
+	// Only the labels on either side of the moved markers change
+	TimeRange changed(labels[syl - 1].range.begin(), labels[syl].range.end());
+
 	if (m.size() > 1) {
 		int delta = m[0]->GetPosition() - old_position;
 		for (AudioMarker *marker : m | boost::adaptors::sliced(1, m.size()))
 			MoveMarker(static_cast<KaraokeMarker *>(marker), marker->GetPosition() + delta);
+		changed = TimeRange(changed.begin(), end_marker);
 		syl = cur_syl;
 	}
 
-	AnnounceChanges(syl);
+	if (syl == cur_syl || syl == cur_syl + 1) {
+		AnnounceUpdatedPrimaryRange();
+		AnnounceUpdatedStyleRanges();
+	}
+	AnnounceUpdatedTimeRange(changed);
+
+	// Committing on every mouse move would reparse and redraw the line
+	// everywhere else it's shown, so wait for the drag to end
+	pending_changes = true;
+	if (auto_commit)
+		dragging = true;
+	else
+		commit_id = -1;
+}
+
+void AudioTimingControllerKaraoke::OnMarkerDragEnd() {
+	if (dragging && pending_changes)
+		DoCommit();
+	dragging = false;
 }
 
 void AudioTimingControllerKaraoke::GetLabels(TimeRange const& range, std::vector<AudioLabel> &out) const {
@@ -38,9 +38,15 @@
 #include "string_codec.h"
 #include "subs_controller.h"
 
+#include <libaegisub/cajun/elements.h>
+#include <libaegisub/cajun/reader.h>
+#include <libaegisub/cajun/writer.h>
+#include <libaegisub/dir_listing.h>
 #include <libaegisub/dispatch.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/io.h>
+#include <libaegisub/log.h>
 #include <libaegisub/path.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/split.h>
@@ -48,6 +54,9 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <future>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include <wx/dcmemory.h>
 #include <wx/log.h>
@@ -60,112 +69,206 @@
 #include <libaegisub/charset_conv_win.h>
 #endif
 
-namespace Automation4 {
-	bool CalculateTextExtents(AssStyle *style, std::string const& text, double &width, double &height, double &descent, double &extlead)
-	{
-		width = height = descent = extlead = 0;
+namespace {
+	/// The style properties which determine which font text is measured with
+	struct FontKey {
+		std::string face;
+		double size;
+		bool bold, italic, underline, strikeout;
+		int encoding;
+
+		bool operator<(FontKey const& rgt) const {
+			return std::tie(face, size, bold, italic, underline, strikeout, encoding) <
+				std::tie(rgt.face, rgt.size, rgt.bold, rgt.italic, rgt.underline, rgt.strikeout, rgt.encoding);
+		}
+	};
 
-		double fontsize = style->fontsize * 64;
-		double spacing = style->spacing * 64;
+	/// Extents of some text before the style's scaling is applied
+	struct TextExtents {
+		double width, height, descent, extlead;
+	};
+
+	/// Fonts and measurements for text_extents, which scripts such as
+	/// karaskel call for every syllable of every line, mostly with the same
+	/// few styles and often with the same text
+	class TextExtentsCache {
+		/// Limits on the number of cached fonts and measurements, past which
+		/// the cache is simply emptied
+		static const size_t max_fonts = 64;
+		static const size_t max_extents = 65536;
+
+		std::mutex mutex;
+		std::map<std::tuple<FontKey, double, std::string>, TextExtents> extents;
 
 #ifdef WIN32
-		// This is almost copypasta from TextSub
-		auto dc = CreateCompatibleDC(nullptr);
-		if (!dc) return false;
-
-		SetMapMode(dc, MM_TEXT);
-
-		LOGFONTW lf = {0};
-		lf.lfHeight = (LONG)fontsize;
-		lf.lfWeight = style->bold ? FW_BOLD : FW_NORMAL;
-		lf.lfItalic = style->italic;
-		lf.lfUnderline = style->underline;
-		lf.lfStrikeOut = style->strikeout;
-		lf.lfCharSet = style->encoding;
-		lf.lfOutPrecision = OUT_TT_PRECIS;
-		lf.lfClipPrecision = CLIP_DEFAULT_PRECIS;
-		lf.lfQuality = ANTIALIASED_QUALITY;
-		lf.lfPitchAndFamily = DEFAULT_PITCH|FF_DONTCARE;
-		wcsncpy(lf.lfFaceName, agi::charset::ConvertW(style->font).c_str(), 31);
-
-		auto font = CreateFontIndirect(&lf);
-		if (!font) return false;
-
-		auto old_font = SelectObject(dc, font);
-
-		std::wstring wtext(agi::charset::ConvertW(text));
-		if (spacing != 0 ) {
-			width = 0;
-			for (auto c : wtext) {
+		HDC dc = nullptr;
+		std::map<FontKey, HFONT> fonts;
+
+		void ClearFonts() {
+			for (auto const& font : fonts)
+				DeleteObject(font.second);
+			fonts.clear();
+		}
+
+		bool Measure(FontKey const& key, double spacing, std::string const& text, TextExtents& out) {
+			if (!dc) {
+				dc = CreateCompatibleDC(nullptr);
+				if (!dc) return false;
+				SetMapMode(dc, MM_TEXT);
+			}
+
+			auto& font = fonts[key];
+			if (!font) {
+				// This is almost copypasta from TextSub
+				LOGFONTW lf = {0};
+				lf.lfHeight = (LONG)key.size;
+				lf.lfWeight = key.bold ? FW_BOLD : FW_NORMAL;
+				lf.lfItalic = key.italic;
+				lf.lfUnderline = key.underline;
+				lf.lfStrikeOut = key.strikeout;
+				lf.lfCharSet = key.encoding;
+				lf.lfOutPrecision = OUT_TT_PRECIS;
+				lf.lfClipPrecision = CLIP_DEFAULT_PRECIS;
+				lf.lfQuality = ANTIALIASED_QUALITY;
+				lf.lfPitchAndFamily = DEFAULT_PITCH|FF_DONTCARE;
+				wcsncpy(lf.lfFaceName, agi::charset::ConvertW(key.face).c_str(), 31);
+
+				font = CreateFontIndirect(&lf);
+				if (!font) {
+					fonts.erase(key);
+					return false;
+				}
+			}
+
+			auto old_font = SelectObject(dc, font);
+
+			out = TextExtents{};
+			std::wstring wtext(agi::charset::ConvertW(text));
+			if (spacing != 0 ) {
+				for (auto c : wtext) {
+					SIZE sz;
+					GetTextExtentPoint32(dc, &c, 1, &sz);
+					out.width += sz.cx + spacing;
+					out.height = sz.cy;
+				}
+			}
+			else {
 				SIZE sz;
-				GetTextExtentPoint32(dc, &c, 1, &sz);
-				width += sz.cx + spacing;
-				height = sz.cy;
+				GetTextExtentPoint32(dc, &wtext[0], (int)wtext.size(), &sz);
+				out.width = sz.cx;
+				out.height = sz.cy;
 			}
-		}
-		else {
-			SIZE sz;
-			GetTextExtentPoint32(dc, &wtext[0], (int)wtext.size(), &sz);
-			width = sz.cx;
-			height = sz.cy;
-		}
 
-		TEXTMETRIC tm;
-		GetTextMetrics(dc, &tm);
-		descent = tm.tmDescent;
-		extlead = tm.tmExternalLeading;
+			TEXTMETRIC tm;
+			GetTextMetrics(dc, &tm);
+			out.descent = tm.tmDescent;
+			out.extlead = tm.tmExternalLeading;
 
-		SelectObject(dc, old_font);
-		DeleteObject(font);
-		DeleteObject(dc);
+			SelectObject(dc, old_font);
+			return true;
+		}
 
+	public:
+		~TextExtentsCache() {
+			ClearFonts();
+			if (dc) DeleteObject(dc);
+		}
 #else // not WIN32
-		wxMemoryDC thedc;
-
-		// fix fontsize to be 72 DPI
-		//fontsize = -FT_MulDiv((int)(fontsize+0.5), 72, thedc.GetPPI().y);
-
-		// now try to get a font!
-		// use the font list to get some caching... (chance is the script will need the same font very often)
-		// USING wxTheFontList SEEMS TO CAUSE BAD LEAKS!
-		//wxFont *thefont = wxTheFontList->FindOrCreateFont(
-		wxFont thefont(
-			(int)fontsize,
-			wxFONTFAMILY_DEFAULT,
-			style->italic ? wxFONTSTYLE_ITALIC : wxFONTSTYLE_NORMAL,
-			style->bold ? wxFONTWEIGHT_BOLD : wxFONTWEIGHT_NORMAL,
-			style->underline,
-			to_wx(style->font),
-			wxFONTENCODING_SYSTEM); // FIXME! make sure to get the right encoding here, make some translation table between windows and wx encodings
-		thedc.SetFont(thefont);
-
-		wxString wtext(to_wx(text));
-		if (spacing) {
-			// If there's inter-character spacing, kerning info must not be used, so calculate width per character
-			// NOTE: Is kerning actually done either way?!
-			for (auto const& wc : wtext) {
-				int a, b, c, d;
-				thedc.GetTextExtent(wc, &a, &b, &c, &d);
-				double scaling = fontsize / (double)(b > 0 ? b : 1); // semi-workaround for missing OS/2 table data for scaling
-				width += (a + spacing)*scaling;
-				height = b > height ? b*scaling : height;
-				descent = c > descent ? c*scaling : descent;
-				extlead = d > extlead ? d*scaling : extlead;
+		std::unique_ptr<wxMemoryDC> dc;
+		std::map<FontKey, wxFont> fonts;
+
+		void ClearFonts() { fonts.clear(); }
+
+		bool Measure(FontKey const& key, double spacing, std::string const& text, TextExtents& out) {
+			if (!dc) dc = agi::make_unique<wxMemoryDC>();
+
+			// fix fontsize to be 72 DPI
+			//fontsize = -FT_MulDiv((int)(fontsize+0.5), 72, thedc.GetPPI().y);
+
+			// wxTheFontList seems to cause bad leaks, so fonts are cached here
+			// instead
+			auto it = fonts.find(key);
+			if (it == fonts.end()) {
+				it = fonts.emplace(key, wxFont(
+					(int)key.size,
+					wxFONTFAMILY_DEFAULT,
+					key.italic ? wxFONTSTYLE_ITALIC : wxFONTSTYLE_NORMAL,
+					key.bold ? wxFONTWEIGHT_BOLD : wxFONTWEIGHT_NORMAL,
+					key.underline,
+					to_wx(key.face),
+					wxFONTENCODING_SYSTEM)).first; // FIXME! make sure to get the right encoding here, make some translation table between windows and wx encodings
 			}
-		} else {
-			// If the inter-character spacing should be zero, kerning info can (and must) be used, so calculate everything in one go
-			wxCoord lwidth, lheight, ldescent, lextlead;
-			thedc.GetTextExtent(wtext, &lwidth, &lheight, &ldescent, &lextlead);
-			double scaling = fontsize / (double)(lheight > 0 ? lheight : 1); // semi-workaround for missing OS/2 table data for scaling
-			width = lwidth*scaling; height = lheight*scaling; descent = ldescent*scaling; extlead = lextlead*scaling;
+			dc->SetFont(it->second);
+
+			out = TextExtents{};
+			double fontsize = key.size;
+			wxString wtext(to_wx(text));
+			if (spacing) {
+				// If there's inter-character spacing, kerning info must not be used, so calculate width per character
+				// NOTE: Is kerning actually done either way?!
+				for (auto const& wc : wtext) {
+					int a, b, c, d;
+					dc->GetTextExtent(wc, &a, &b, &c, &d);
+					double scaling = fontsize / (double)(b > 0 ? b : 1); // semi-workaround for missing OS/2 table data for scaling
+					out.width += (a + spacing)*scaling;
+					out.height = b > out.height ? b*scaling : out.height;
+					out.descent = c > out.descent ? c*scaling : out.descent;
+					out.extlead = d > out.extlead ? d*scaling : out.extlead;
+				}
+			} else {
+				// If the inter-character spacing should be zero, kerning info can (and must) be used, so calculate everything in one go
+				wxCoord lwidth, lheight, ldescent, lextlead;
+				dc->GetTextExtent(wtext, &lwidth, &lheight, &ldescent, &lextlead);
+				double scaling = fontsize / (double)(lheight > 0 ? lheight : 1); // semi-workaround for missing OS/2 table data for scaling
+				out.width = lwidth*scaling; out.height = lheight*scaling; out.descent = ldescent*scaling; out.extlead = lextlead*scaling;
+			}
+			return true;
 		}
+
+	public:
 #endif
 
+		bool Get(FontKey const& font, double spacing, std::string const& text, TextExtents& out) {
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto key = std::make_tuple(font, spacing, text);
+			auto it = extents.find(key);
+			if (it != extents.end()) {
+				out = it->second;
+				return true;
+			}
+
+			if (fonts.size() >= max_fonts)
+				ClearFonts();
+			if (!Measure(font, spacing, text, out))
+				return false;
+
+			if (extents.size() >= max_extents)
+				extents.clear();
+			extents.emplace(std::move(key), out);
+			return true;
+		}
+	};
+
+	TextExtentsCache text_extents_cache;
+}
+
+namespace Automation4 {
+	bool CalculateTextExtents(AssStyle *style, std::string const& text, double &width, double &height, double &descent, double &extlead)
+	{
+		width = height = descent = extlead = 0;
+
+		FontKey font{style->font, style->fontsize * 64, style->bold, style->italic,
+			style->underline, style->strikeout, style->encoding};
+		TextExtents extents;
+		if (!text_extents_cache.Get(font, style->spacing * 64, text, extents))
+			return false;
+
 		// Compensate for scaling
-		width = style->scalex / 100 * width / 64;
-		height = style->scaley / 100 * height / 64;
-		descent = style->scaley / 100 * descent / 64;
-		extlead = style->scaley / 100 * extlead / 64;
+		width = style->scalex / 100 * extents.width / 64;
+		height = style->scaley / 100 * extents.height / 64;
+		descent = style->scaley / 100 * extents.descent / 64;
+		extlead = style->scaley / 100 * extents.extlead / 64;
 
 		return true;
 	}
@@ -310,37 +413,168 @@ namespace Automation4 {
 	}
 
 	// AutoloadScriptManager
+	namespace {
+		/// A script's manifest along with the modification time of the script
+		/// when it was recorded, so that stale entries can be spotted
+		struct cached_manifest {
+			json::Integer modified;
+			ScriptManifest manifest;
+		};
+
+		using manifest_cache = std::map<std::string, cached_manifest>;
+
+		manifest_cache load_manifest_cache(agi::fs::path const& filename) {
+			manifest_cache cache;
+			try {
+				json::UnknownElement root;
+				json::Reader::Read(root, *agi::io::Open(filename));
+				for (json::Object& entry : static_cast<json::Array&>(root)) {
+					std::string const& path = entry["path"];
+					cached_manifest& cached = cache[path];
+					cached.modified = entry["modified"];
+
+					auto& manifest = cached.manifest;
+					manifest.name = static_cast<std::string const&>(entry["name"]);
+					manifest.description = static_cast<std::string const&>(entry["description"]);
+					manifest.author = static_cast<std::string const&>(entry["author"]);
+					manifest.version = static_cast<std::string const&>(entry["version"]);
+					for (json::Object& macro : static_cast<json::Array&>(entry["macros"])) {
+						std::string const& name = macro["name"];
+						std::string const& display = macro["display"];
+						std::string const& help = macro["help"];
+						json::Integer type = macro["type"];
+						manifest.macros.push_back(ScriptManifest::Macro{name, display, help, static_cast<int>(type)});
+					}
+				}
+			}
+			catch (agi::fs::FileSystemError const& e) {
+				LOG_D("automation/load_manifests") << "Cannot load autoload manifests: " << e.GetMessage();
+			}
+			catch (json::Exception const& e) {
+				LOG_D("automation/load_manifests") << "Cannot load autoload manifests: " << e.what();
+				cache.clear();
+			}
+			return cache;
+		}
+
+		void save_manifest_cache(agi::fs::path const& filename, manifest_cache const& cache) {
+			json::Array root;
+			root.reserve(cache.size());
+			for (auto const& script : cache) {
+				auto const& manifest = script.second.manifest;
+				json::Array macros;
+				macros.reserve(manifest.macros.size());
+				for (auto const& macro : manifest.macros) {
+					json::Object m;
+					m["name"] = macro.name;
+					m["display"] = macro.display;
+					m["help"] = macro.help;
+					m["type"] = (json::Integer)macro.type;
+					macros.push_back(std::move(m));
+				}
+
+				json::Object entry;
+				entry["path"] = script.first;
+				entry["modified"] = script.second.modified;
+				entry["name"] = manifest.name;
+				entry["description"] = manifest.description;
+				entry["author"] = manifest.author;
+				entry["version"] = manifest.version;
+				entry["macros"] = std::move(macros);
+				root.push_back(std::move(entry));
+			}
+
+			try {
+				agi::JsonWriter::Write(root, agi::io::Save(filename).Get());
+			}
+			catch (agi::fs::FileSystemError const& e) {
+				LOG_E("automation/save_manifests") << "Cannot save autoload manifests: " << e.GetMessage();
+			}
+		}
+	}
+
 	AutoloadScriptManager::AutoloadScriptManager(std::string path)
 	: path(std::move(path))
 	{
-		Reload();
 	}
 
 	void AutoloadScriptManager::Reload()
 	{
 		scripts.clear();
 
-		std::vector<std::future<std::unique_ptr<Script>>> script_futures;
+		// Running every script just to find out what macros it registers
+		// is slow with large script collections, so scripts which haven't
+		// changed since they were last loaded are created from what they
+		// registered then, and actually loaded when first used
+		auto cache_filename = config::path->Decode("?local/autoload_manifest.json");
+		auto old_cache = load_manifest_cache(cache_filename);
+		manifest_cache new_cache;
+		bool changed = false;
+
+		struct pending_script {
+			agi::fs::path filename;
+			json::Integer modified;
+			/// The cached manifest, if it's up to date
+			const ScriptManifest *manifest;
+			/// The script being loaded, if there's no usable manifest
+			std::future<std::unique_ptr<Script>> future;
+		};
+		std::vector<pending_script> pending;
 
 		for (auto tok : agi::Split(path, '|')) {
 			auto dirname = config::path->Decode(agi::str(tok));
 			if (!agi::fs::DirectoryExists(dirname)) continue;
 
-			for (auto filename : agi::fs::DirectoryIterator(dirname, "*.*"))
-				script_futures.emplace_back(std::async(std::launch::async, [=] {
-					return ScriptFactory::CreateFromFile(dirname/filename, false, false);
-				}));
+			for (auto const& filename : agi::fs::ListDirectory(dirname, "*.*")) {
+				auto full_path = dirname/filename;
+				json::Integer modified = 0;
+				try {
+					modified = agi::fs::ModifiedTime(full_path);
+				}
+				catch (agi::fs::FileSystemError const&) { }
+
+				auto cached = old_cache.find(full_path.string());
+				if (modified && cached != old_cache.end() && cached->second.modified == modified)
+					pending.push_back(pending_script{full_path, modified, &cached->second.manifest, {}});
+				else
+					pending.push_back(pending_script{full_path, modified, nullptr, std::async(std::launch::async, [=] {
+						return ScriptFactory::CreateFromFile(full_path, false, false);
+					})});
+			}
+		}
+
+		// Deferred scripts register their macros on this thread, so they
+		// have to wait for the scripts being loaded on other threads
+		for (auto& script : pending) {
+			if (script.future.valid())
+				script.future.wait();
 		}
 
 		int error_count = 0;
-		for (auto& future : script_futures) {
-			auto s = future.get();
-			if (s) {
-				if (!s->GetLoadedState()) ++error_count;
-				scripts.emplace_back(std::move(s));
-			}
+		for (auto& script : pending) {
+			std::unique_ptr<Script> s;
+			if (script.manifest)
+				s = ScriptFactory::CreateFromManifest(script.filename, *script.manifest);
+			if (!s && script.future.valid())
+				s = script.future.get();
+			else if (!s)
+				s = ScriptFactory::CreateFromFile(script.filename, false, false);
+			if (!s) continue;
+
+			if (!s->GetLoadedState()) ++error_count;
+
+			cached_manifest cached{script.modified, {}};
+			if (script.modified && s->GetManifest(cached.manifest))
+				new_cache[script.filename.string()] = std::move(cached);
+			if (!script.manifest)
+				changed = true;
+
+			scripts.emplace_back(std::move(s));
 		}
 
+		if (changed || new_cache.size() != old_cache.size())
+			save_manifest_cache(cache_filename, new_cache);
+
 		if (error_count == 1) {
 			wxLogWarning("A script in the Automation autoload directory failed to load.\nPlease review the errors, fix them and use the Rescan Autoload Dir button in Automation Manager to load the scripts again.");
 		}
@@ -467,6 +701,15 @@ namespace Automation4 {
 		return create_unknown ? agi::make_unique<UnknownScript>(filename) : nullptr;
 	}
 
+	std::unique_ptr<Script> ScriptFactory::CreateFromManifest(agi::fs::path const& filename, ScriptManifest const& manifest)
+	{
+		for (auto& factory : Factories()) {
+			if (auto s = factory->ProduceDeferred(filename, manifest))
+				return s;
+		}
+		return nullptr;
+	}
+
 	std::vector<std::unique_ptr<ScriptFactory>>& ScriptFactory::Factories()
 	{
 		static std::vector<std::unique_ptr<ScriptFactory>> factories;
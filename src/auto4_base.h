@@ -141,6 +141,23 @@ namespace Automation4 {
 		ProgressSink(agi::ProgressSink *impl, BackgroundScriptRunner *bsr);
 	};
 
+	/// What a script registered when it was last loaded, which is enough to
+	/// list it and its macros without loading it again
+	struct ScriptManifest {
+		struct Macro {
+			std::string name;
+			std::string display;
+			std::string help;
+			int type;
+		};
+
+		std::string name;
+		std::string description;
+		std::string author;
+		std::string version;
+		std::vector<Macro> macros;
+	};
+
 	class Script {
 		agi::fs::path filename;
 
@@ -175,6 +192,17 @@ namespace Automation4 {
 		virtual std::vector<cmd::Command*> GetMacros() const=0;
 		/// Get a list of export filters provided by this script
 		virtual std::vector<ExportFilter*> GetFilters() const=0;
+
+		/// Summary of where the last profiled run of one of this script's
+		/// features spent its time, or empty if none has been profiled
+		virtual std::string GetProfileReport() const { return ""; }
+		/// The last profile in the folded stack format used by flame graph tools
+		virtual std::string GetProfileStacks() const { return ""; }
+
+		/// Get the manifest to recreate this script from with
+		/// ScriptFactory::CreateFromManifest
+		/// @return false if the script can't be created without loading it
+		virtual bool GetManifest(ScriptManifest &) const { return false; }
 	};
 
 	/// A manager of loaded automation scripts
@@ -221,9 +249,15 @@ namespace Automation4 {
 	};
 
 	/// Manager for scripts in the autoload directory
+	///
+	/// The manifest of each script is cached along with the script's
+	/// modification time, and unmodified scripts are only loaded when one of
+	/// their macros is first used.
 	class AutoloadScriptManager final : public ScriptManager {
 		std::string path;
 	public:
+		/// Scripts aren't loaded until the first call to Reload, so that
+		/// creating this doesn't hold up startup
 		AutoloadScriptManager(std::string path);
 		void Reload() override;
 	};
@@ -243,6 +277,11 @@ namespace Automation4 {
 		/// CreateFromFile
 		virtual std::unique_ptr<Script> Produce(agi::fs::path const& filename) const = 0;
 
+		/// Create a script which registers the macros in its manifest but
+		/// isn't loaded until one of them is used, or return nullptr if this
+		/// engine can't do that for the file
+		virtual std::unique_ptr<Script> ProduceDeferred(agi::fs::path const&, ScriptManifest const&) const { return nullptr; }
+
 		static std::vector<std::unique_ptr<ScriptFactory>>& Factories();
 
 	protected:
@@ -268,6 +307,11 @@ namespace Automation4 {
 		/// @param create_unknown Create a placeholder rather than returning nullptr if no script engine supports the file
 		static std::unique_ptr<Script> CreateFromFile(agi::fs::path const& filename, bool complain_about_unrecognised, bool create_unknown=true);
 
+		/// Create a script from the manifest saved when it was last loaded,
+		/// deferring loading it until it's used
+		/// @return nullptr if no script engine can defer loading the file
+		static std::unique_ptr<Script> CreateFromManifest(agi::fs::path const& filename, ScriptManifest const& manifest);
+
 		static const std::vector<std::unique_ptr<ScriptFactory>>& GetFactories();
 	};
 
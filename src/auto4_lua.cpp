@@ -57,10 +57,13 @@
 #include <libaegisub/format.h>
 #include <libaegisub/lua/ffi.h>
 #include <libaegisub/lua/modules.h>
+#include <libaegisub/lua/parallel.h>
+#include <libaegisub/lua/profiler.h>
 #include <libaegisub/lua/script_reader.h>
 #include <libaegisub/lua/utils.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
+#include <libaegisub/trace.h>
 
 #include <algorithm>
 #include <boost/algorithm/string/case_conv.hpp>
@@ -383,34 +386,116 @@ namespace {
 		std::vector<cmd::Command*> macros;
 		std::vector<std::unique_ptr<ExportFilter>> filters;
 
+		/// Manifest the script was created from, if it was
+		ScriptManifest manifest;
+		/// Has the script been created from its manifest but not loaded yet?
+		bool deferred = false;
+		/// Placeholders for the macros in the manifest, which are registered
+		/// in place of the script's real macros and forward to them
+		std::vector<cmd::Command*> stubs;
+		/// The real macros of a script with stubs, which are owned by the
+		/// script rather than being registered
+		std::vector<std::unique_ptr<cmd::Command>> stubbed_macros;
+
+		/// Profile of the last profiled feature run
+		agi::lua::ProfileData profile;
+
 		/// load script and create internal structures etc.
 		void Create();
 		/// destroy internal structures, unreg features and delete environment
 		void Destroy();
 
 		static int LuaInclude(lua_State *L);
+		static int LuaParallelMap(lua_State *L);
+
+		/// Unregister the stubs, so that the real macros are registered
+		/// when the script is next loaded
+		void RemoveStubs();
 
 	public:
 		LuaScript(agi::fs::path const& filename);
-		~LuaScript() { Destroy(); }
+		/// Create a deferred script from its manifest
+		LuaScript(agi::fs::path const& filename, ScriptManifest manifest);
+		~LuaScript() { Destroy(); RemoveStubs(); }
 
 		void RegisterCommand(LuaCommand *command);
 		void UnregisterCommand(LuaCommand *command);
 		void RegisterFilter(LuaExportFilter *filter);
+		void SetProfile(agi::lua::ProfileData data) { profile = std::move(data); }
+
+		/// Take ownership of a newly created macro, returning it if it should
+		/// be registered as a command instead
+		std::unique_ptr<cmd::Command> AdoptCommand(std::unique_ptr<cmd::Command> command);
+		/// Get the real macro with the given name, loading a deferred script
+		/// first if load is true
+		cmd::Command *GetMacro(std::string const& name, bool load);
 
 		static LuaScript* GetScriptObject(lua_State *L);
 
 		// Script implementation
-		void Reload() override { Create(); }
+		void Reload() override { RemoveStubs(); Create(); }
 
 		std::string GetName() const override { return name; }
 		std::string GetDescription() const override { return description; }
 		std::string GetAuthor() const override { return author; }
 		std::string GetVersion() const override { return version; }
-		bool GetLoadedState() const override { return L != nullptr; }
+		bool GetLoadedState() const override { return L != nullptr || deferred; }
 
-		std::vector<cmd::Command*> GetMacros() const override { return macros; }
+		std::vector<cmd::Command*> GetMacros() const override { return stubs.empty() ? macros : stubs; }
 		std::vector<ExportFilter*> GetFilters() const override;
+
+		std::string GetProfileReport() const override { return profile.Report(); }
+		std::string GetProfileStacks() const override { return profile.FoldedStacks(); }
+
+		bool GetManifest(ScriptManifest &manifest) const override;
+	};
+
+	/// A macro from a script which is registered before the script is loaded,
+	/// and loads the script the first time it's validated or run
+	class LuaStubCommand final : public cmd::Command {
+		LuaScript *script;
+		ScriptManifest::Macro macro;
+		wxString display;
+		wxString help;
+
+	public:
+		LuaStubCommand(LuaScript *script, ScriptManifest::Macro macro)
+		: script(script)
+		, macro(std::move(macro))
+		, display(to_wx(this->macro.display))
+		, help(to_wx(this->macro.help))
+		{
+		}
+
+		const char* name() const override { return macro.name.c_str(); }
+		wxString StrMenu(const agi::Context *) const override { return display; }
+		wxString StrDisplay(const agi::Context *) const override { return display; }
+		wxString StrHelp() const override {
+			auto real = script->GetMacro(macro.name, false);
+			return real ? real->StrHelp() : help;
+		}
+
+		int Type() const override {
+			auto real = script->GetMacro(macro.name, false);
+			return real ? real->Type() : macro.type;
+		}
+
+		void operator()(agi::Context *c) override {
+			if (auto real = script->GetMacro(macro.name, true))
+				(*real)(c);
+		}
+
+		bool Validate(const agi::Context *c) override {
+			if (!(macro.type & cmd::COMMAND_VALIDATE)) return true;
+			auto real = script->GetMacro(macro.name, true);
+			return real && real->Validate(c);
+		}
+
+		bool IsActive(const agi::Context *c) override {
+			if (!(macro.type & cmd::COMMAND_TOGGLE)) return false;
+			auto real = script->GetMacro(macro.name, true);
+			return real && real->IsActive(c);
+		}
 	};
 
 	LuaScript::LuaScript(agi::fs::path const& filename)
@@ -419,6 +504,81 @@ namespace {
 		Create();
 	}
 
+	LuaScript::LuaScript(agi::fs::path const& filename, ScriptManifest manifest)
+	: Script(filename)
+	, name(manifest.name)
+	, description(manifest.description)
+	, author(manifest.author)
+	, version(manifest.version)
+	, manifest(std::move(manifest))
+	, deferred(true)
+	{
+		for (auto const& macro : this->manifest.macros) {
+			auto stub = agi::make_unique<LuaStubCommand>(this, macro);
+			stubs.push_back(stub.get());
+			cmd::reg(std::move(stub));
+		}
+	}
+
+	void LuaScript::RemoveStubs()
+	{
+		for (auto stub : stubs)
+			cmd::unreg(stub->name());
+		stubs.clear();
+		deferred = false;
+	}
+
+	std::unique_ptr<cmd::Command> LuaScript::AdoptCommand(std::unique_ptr<cmd::Command> command)
+	{
+		if (stubs.empty())
+			return command;
+		stubbed_macros.push_back(std::move(command));
+		return nullptr;
+	}
+
+	cmd::Command *LuaScript::GetMacro(std::string const& name, bool load)
+	{
+		if (deferred) {
+			if (!load) return nullptr;
+			deferred = false;
+			Create();
+			if (!L)
+				wxLogError(_("Failed to load Automation script '%s':\n%s"), GetFilename().wstring(), to_wx(description));
+		}
+
+		for (auto macro : macros) {
+			if (macro->name() == name)
+				return macro;
+		}
+		return nullptr;
+	}
+
+	bool LuaScript::GetManifest(ScriptManifest &ret) const
+	{
+		if (!stubs.empty()) {
+			ret = manifest;
+			return true;
+		}
+
+		// Export filters are registered with the export filter chain rather
+		// than as commands, so there's nothing which could stand in for them
+		if (!L || !filters.empty())
+			return false;
+
+		ret.name = name;
+		ret.description = description;
+		ret.author = author;
+		ret.version = version;
+		ret.macros.clear();
+		for (auto macro : macros) {
+			auto command = static_cast<LuaCommand *>(macro);
+			ret.macros.push_back(ScriptManifest::Macro{command->name(),
+				from_wx(command->StrDisplay(nullptr)), from_wx(command->StrHelp()),
+				command->Type() & ~cmd::COMMAND_DYNAMIC_HELP});
+		}
+		return true;
+	}
+
 	void LuaScript::Create()
 	{
 		Destroy();
@@ -456,6 +616,7 @@ namespace {
 			return;
 		}
 		stackcheck.check_stack(0);
+		SetBytecodeCache(L, config::path->Decode("?local/automation/cache"));
 
 		// prepare stuff in the registry
 
@@ -489,6 +650,7 @@ namespace {
 		set_field<project_properties>(L, "project_properties");
 		set_field<lua_get_audio_selection>(L, "get_audio_selection");
 		set_field<lua_set_status_text>(L, "set_status_text");
+		set_field<LuaParallelMap>(L, "parallel_map");
 
 		// store aegisub table to globals
 		lua_settable(L, LUA_GLOBALSINDEX);
@@ -544,6 +706,7 @@ namespace {
 
 		// loops backwards because commands remove themselves from macros when
 		// they're unregistered
+		stubbed_macros.clear();
 		for (int i = macros.size() - 1; i >= 0; --i)
 			cmd::unreg(macros[i]->name());
 
@@ -620,13 +783,23 @@ namespace {
 		return lua_gettop(L) - pretop;
 	}
 
+	int LuaScript::LuaParallelMap(lua_State *L)
+	{
+		return agi::lua::parallel_map(L, GetScriptObject(L)->include_path);
+	}
+
 	void LuaThreadedCall(lua_State *L, int nargs, int nresults, std::string const& title, wxWindow *parent, bool can_open_config)
 	{
 		bool failed = false;
 		BackgroundScriptRunner bsr(parent, title);
 		bsr.Run([&](ProgressSink *ps) {
+			agi::trace::Scope scope("run script", "automation");
 			LuaProgressSink lps(L, ps, can_open_config);
 
+			std::unique_ptr<agi::lua::Profiler> profiler;
+			if (OPT_GET("Automation/Profile")->GetBool())
+				profiler = agi::make_unique<agi::lua::Profiler>(L);
+
 			// Insert our error handler under the function to call
 			lua_pushcclosure(L, add_stack_trace, 0);
 			lua_insert(L, -nargs - 2);
@@ -643,6 +816,9 @@ namespace {
 			else
 				lua_remove(L, -nresults - 1);
 
+			if (profiler)
+				LuaScript::GetScriptObject(L)->SetProfile(profiler->Finish());
+
 			lua_gc(L, LUA_GCCOLLECT, 0);
 		});
 		if (failed)
@@ -676,8 +852,8 @@ namespace {
 	int LuaCommand::LuaRegister(lua_State *L)
 	{
 		static std::mutex mutex;
-		auto command = agi::make_unique<LuaCommand>(L);
-		{
+		auto command = LuaScript::GetScriptObject(L)->AdoptCommand(agi::make_unique<LuaCommand>(L));
+		if (command) {
 			std::lock_guard<std::mutex> lock(mutex);
 			cmd::reg(std::move(command));
 		}
@@ -748,6 +924,7 @@ namespace {
 	{
 		if (!(cmd_type & cmd::COMMAND_VALIDATE)) return true;
 
+		agi::trace::Scope scope("validate macro", "automation");
 		set_context(L, c);
 
 		// Error handler goes under the function to call
@@ -786,6 +963,7 @@ namespace {
 
 	void LuaCommand::operator()(agi::Context *c)
 	{
+		agi::trace::Scope scope("macro", "automation");
 		LuaStackcheck stackcheck(L);
 		set_context(L, c);
 		stackcheck.check_stack(0);
@@ -830,7 +1008,7 @@ namespace {
 
 		// top of stack will be selected lines array, if any was returned
 		if (lua_istable(L, -1)) {
-			std::set<AssDialogue*> sel;
+			Selection sel;
 			lua_for_each(L, [&] {
 				if (!lua_isnumber(L, -1))
 					return;
@@ -959,6 +1137,7 @@ namespace {
 
 	void LuaExportFilter::ProcessSubs(AssFile *subs, wxWindow *export_dialog)
 	{
+		agi::trace::Scope scope("export filter", "automation");
 		LuaStackcheck stackcheck(L);
 
 		GetFeatureFunction("run");
@@ -1036,4 +1215,11 @@ namespace Automation4 {
 			return agi::make_unique<LuaScript>(filename);
 		return nullptr;
 	}
+
+	std::unique_ptr<Script> LuaScriptFactory::ProduceDeferred(agi::fs::path const& filename, ScriptManifest const& manifest) const
+	{
+		if (agi::fs::HasExtension(filename, "lua") || agi::fs::HasExtension(filename, "moon"))
+			return agi::make_unique<LuaScript>(filename, manifest);
+		return nullptr;
+	}
 }
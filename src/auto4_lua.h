@@ -29,10 +29,17 @@
 
 #include "auto4_base.h"
 
+#include <libaegisub/gap_vector.h>
+
+#include <chrono>
 #include <deque>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <wx/string.h>
 
+class AssDialogue;
 class AssEntry;
 class wxControl;
 class wxWindow;
@@ -45,7 +52,12 @@ namespace Automation4 {
 		struct PendingCommit {
 			wxString mesage;
 			int modification_type;
+			/// Were the only changes dialogue lines being replaced in place?
+			bool in_place;
+			/// All of the lines, if not in_place
 			std::vector<AssEntry*> lines;
+			/// Each replaced line in the file and its replacement, if in_place
+			std::vector<std::pair<AssDialogue*, AssDialogue*>> replaced;
 		};
 
 		/// Pointer to file being modified
@@ -71,14 +83,39 @@ namespace Automation4 {
 		int references = 2;
 
 		/// Set of subtitle lines being modified; initially a shallow copy of ass->Line
-		std::vector<AssEntry*> lines;
+		agi::gap_vector<AssEntry*> lines;
 		bool script_info_copied = false;
 
+		/// Dialogue lines replaced since the last undo point, by index, with
+		/// the line which was there at the undo point
+		std::map<size_t, AssDialogue*> replaced_dialogue;
+		/// Have any changes other than replacing dialogue lines with other
+		/// dialogue lines been made since the last undo point? If not, only the
+		/// lines in replaced_dialogue need to be written back to the file.
+		bool lines_rearranged = false;
+
 		/// Commits to apply once processing completes successfully
 		std::deque<PendingCommit> pending_commits;
 		/// Lines to delete once processing complete successfully
 		std::vector<std::unique_ptr<AssEntry>> lines_to_delete;
 
+		/// A lazily-read view of a subtitle line, which reads fields from the
+		/// line when they're indexed and writes assignments back to the file
+		struct LineProxy {
+			LuaAssFile *file;
+			/// The line this proxy refers to
+			AssEntry *entry;
+			/// Index of the line when it was last looked up
+			size_t idx;
+		};
+
+		/// Copies made by writes through line proxies since the last undo
+		/// point, which further writes can modify in place
+		std::unordered_set<const AssEntry *> proxy_copies;
+		/// The copy each line written to through a proxy was replaced with,
+		/// so that other proxies to the same line see the write
+		std::unordered_map<const AssEntry *, AssEntry *> proxy_replaced;
+
 		/// Create copies of all of the lines in the script info section if it
 		/// hasn't already happened. This is done lazily, since it only needs
 		/// to happen when the user modifies the headers in some way, which
@@ -88,9 +125,23 @@ namespace Automation4 {
 		/// when the script completes, unless it's an AssInfo, since those are
 		/// owned by the container.
 		void QueueLineForDeletion(size_t idx);
+		/// Take ownership of a new line, returning the pointer to store in lines
+		AssEntry *TakeLine(std::unique_ptr<AssEntry> e);
 		/// Set the line at the index to the given value
 		void AssignLine(size_t idx, std::unique_ptr<AssEntry> e);
-		void InsertLine(std::vector<AssEntry *> &vec, size_t idx, std::unique_ptr<AssEntry> e);
+		/// Note that the line at the index is about to be replaced by e
+		void NoteReplacement(size_t idx, const AssEntry *e);
+		/// Pairs of each line in the file replaced since the last undo point
+		/// and its replacement
+		std::vector<std::pair<AssDialogue*, AssDialogue*>> GetReplacements();
+		void InsertLine(size_t idx, std::unique_ptr<AssEntry> e);
+		/// Add a line after the last existing line of the same type
+		void AppendLine(std::unique_ptr<AssEntry> e);
+		/// Convert an array of lines at the given stack index to AssEntries
+		std::vector<std::unique_ptr<AssEntry>> LinesFromTable(lua_State *L, int idx);
+		/// Get the line at the given index, including unmodified script info
+		/// lines which aren't in the lines vector
+		AssEntry *GetLine(size_t idx);
 
 		int ObjectIndexRead(lua_State *L);
 		void ObjectIndexWrite(lua_State *L);
@@ -99,10 +150,26 @@ namespace Automation4 {
 		void ObjectDeleteRange(lua_State *L);
 		void ObjectAppend(lua_State *L);
 		void ObjectInsert(lua_State *L);
+		int ObjectGetRange(lua_State *L);
+		void ObjectSetRange(lua_State *L);
+		void ObjectAppendMany(lua_State *L);
+		/// Append the lines in an agi_dialogue_batch from aegisub.dialogue_batch
+		void ObjectAppendBatch(lua_State *L);
+		void ObjectDeleteMany(lua_State *L);
 		void ObjectGarbageCollect(lua_State *L);
 		int ObjectIPairs(lua_State *L);
 		int IterNext(lua_State *L);
 
+		/// Push a proxy for the line at idx, for a closure with the file
+		/// userdata as its first upvalue
+		void PushProxy(lua_State *L, size_t idx);
+		int ObjectProxy(lua_State *L);
+		int ObjectProxies(lua_State *L);
+		int ProxyIterNext(lua_State *L);
+		static LineProxy& GetProxy(lua_State *L, int idx);
+		static int ProxyIndexRead(lua_State *L);
+		static int ProxyIndexWrite(lua_State *L);
+
 		int LuaParseKaraokeData(lua_State *L);
 		int LuaGetScriptResolution(lua_State *L);
 
@@ -117,6 +184,8 @@ namespace Automation4 {
 		void AssEntryToLua(lua_State *L, size_t idx);
 		/// assumes a Lua representation of AssEntry on the top of the stack, and creates an AssEntry object of it
 		static std::unique_ptr<AssEntry> LuaToAssEntry(lua_State *L, AssFile *ass=nullptr);
+		/// get the line referred to by the line proxy at idx
+		static const AssEntry *GetProxyLine(lua_State *L, int idx);
 
 		/// @brief Signal that the script using this file is now done running
 		/// @param set_undo If there's any uncommitted changes to the file,
@@ -137,6 +206,23 @@ namespace Automation4 {
 
 	class LuaProgressSink {
 		lua_State *L;
+		ProgressSink *ps;
+
+		/// Progress and task updates are coalesced so that scripts which
+		/// report them for every line don't flood the GUI thread. Only the
+		/// latest value of each is sent, at most once per update interval.
+		std::chrono::steady_clock::time_point next_update;
+		double pending_progress = 0;
+		std::string pending_task;
+		bool has_pending_progress = false;
+		bool has_pending_task = false;
+
+		/// Send any pending updates if the update interval has passed
+		void Update();
+		/// Send any pending updates now
+		void Flush();
+
+		static LuaProgressSink *GetSink(lua_State *L);
 
 		static int LuaSetProgress(lua_State *L);
 		static int LuaSetTask(lua_State *L);
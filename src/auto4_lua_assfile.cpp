@@ -43,11 +43,13 @@
 
 #include <libaegisub/exception.h>
 #include <libaegisub/log.h>
+#include <libaegisub/lua/profiler.h>
 #include <libaegisub/lua/utils.h>
 #include <libaegisub/make_unique.h>
 
 #include <algorithm>
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <cassert>
 #include <memory>
 
@@ -60,12 +62,38 @@ namespace {
 		return BadField(std::string("Invalid or missing field '") + name + "' in '" + line_clasee + "' class subtitle line (expected " + expected_type + ")");
 	}
 
-	std::string get_string_field(lua_State *L, const char *name, const char *line_class)
+	std::string string_value(lua_State *L, const char *name, const char *line_class)
 	{
-		lua_getfield(L, -1, name);
 		if (!lua_isstring(L, -1))
 			throw bad_field("string", name, line_class);
-		std::string ret(lua_tostring(L, -1));
+		return lua_tostring(L, -1);
+	}
+
+	double double_value(lua_State *L, const char *name, const char *line_class)
+	{
+		if (!lua_isnumber(L, -1))
+			throw bad_field("number", name, line_class);
+		return lua_tonumber(L, -1);
+	}
+
+	int int_value(lua_State *L, const char *name, const char *line_class)
+	{
+		if (!lua_isnumber(L, -1))
+			throw bad_field("number", name, line_class);
+		return lua_tointeger(L, -1);
+	}
+
+	bool bool_value(lua_State *L, const char *name, const char *line_class)
+	{
+		if (!lua_isboolean(L, -1))
+			throw bad_field("boolean", name, line_class);
+		return !!lua_toboolean(L, -1);
+	}
+
+	std::string get_string_field(lua_State *L, const char *name, const char *line_class)
+	{
+		lua_getfield(L, -1, name);
+		auto ret = string_value(L, name, line_class);
 		lua_pop(L, 1);
 		return ret;
 	}
@@ -73,9 +101,7 @@ namespace {
 	double get_double_field(lua_State *L, const char *name, const char *line_class)
 	{
 		lua_getfield(L, -1, name);
-		if (!lua_isnumber(L, -1))
-			throw bad_field("number", name, line_class);
-		double ret = lua_tonumber(L, -1);
+		double ret = double_value(L, name, line_class);
 		lua_pop(L, 1);
 		return ret;
 	}
@@ -83,9 +109,7 @@ namespace {
 	int get_int_field(lua_State *L, const char *name, const char *line_class)
 	{
 		lua_getfield(L, -1, name);
-		if (!lua_isnumber(L, -1))
-			throw bad_field("number", name, line_class);
-		int ret = lua_tointeger(L, -1);
+		int ret = int_value(L, name, line_class);
 		lua_pop(L, 1);
 		return ret;
 	}
@@ -93,23 +117,239 @@ namespace {
 	bool get_bool_field(lua_State *L, const char *name, const char *line_class)
 	{
 		lua_getfield(L, -1, name);
-		if (!lua_isboolean(L, -1))
-			throw bad_field("boolean", name, line_class);
-		bool ret = !!lua_toboolean(L, -1);
+		bool ret = bool_value(L, name, line_class);
 		lua_pop(L, 1);
 		return ret;
 	}
 
+	/// Set a dialogue line's extradata from the table (or nil) on the top of
+	/// the stack
+	void set_extradata(lua_State *L, AssDialogue *dia, AssFile *ass)
+	{
+		auto type = lua_type(L, -1);
+		if (type == LUA_TTABLE) {
+			std::vector<uint32_t> new_ids;
+			lua_for_each(L, [&] {
+				if (lua_type(L, -2) != LUA_TSTRING) return;
+				new_ids.push_back(ass->AddExtradata(
+					get_string_or_default(L, -2),
+					get_string_or_default(L, -1)));
+			});
+			std::sort(begin(new_ids), end(new_ids));
+			dia->ExtradataIds = std::move(new_ids);
+		}
+		else if (type != LUA_TNIL) {
+			error(L, "dialogue extradata must be a table");
+		}
+	}
+
+	template<typename T>
+	T *as(AssEntry *e) { return static_cast<T *>(e); }
+	template<typename T>
+	const T *as(const AssEntry *e) { return static_cast<const T *>(e); }
+
+	/// Accessors for a single field of a subtitle line, used both to build
+	/// line tables and by line proxies
+	struct LineField {
+		const char *name;
+		/// Push the field's value
+		void (*get)(lua_State *L, const AssEntry *e, const AssFile *ass);
+		/// Set the field from the value on the top of the stack, or null if
+		/// the field can't be assigned to
+		void (*set)(lua_State *L, AssEntry *e, AssFile *ass);
+	};
+
+	void get_section(lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, e->GroupHeader()); }
+
+	const LineField info_fields[] = {
+		{"section", get_section, nullptr},
+		{"class", [](lua_State *L, const AssEntry *, const AssFile *) { push_value(L, "info"); }, nullptr},
+		{"raw", [](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssInfo>(e)->GetEntryData()); }, nullptr},
+		{"key",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssInfo>(e)->Key()); },
+			[](lua_State *L, AssEntry *e, AssFile *) {
+				auto info = as<AssInfo>(e);
+				*info = AssInfo(string_value(L, "key", "info"), info->Value());
+			}},
+		{"value",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssInfo>(e)->Value()); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssInfo>(e)->SetValue(string_value(L, "value", "info")); }},
+	};
+
+	const LineField dialogue_fields[] = {
+		{"section", get_section, nullptr},
+		{"class", [](lua_State *L, const AssEntry *, const AssFile *) { push_value(L, "dialogue"); }, nullptr},
+		{"raw", [](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->GetEntryData()); }, nullptr},
+		{"comment",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Comment); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Comment = bool_value(L, "comment", "dialogue"); }},
+		{"layer",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Layer); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Layer = int_value(L, "layer", "dialogue"); }},
+		{"start_time",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, (int)as<AssDialogue>(e)->Start); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Start = int_value(L, "start_time", "dialogue"); }},
+		{"end_time",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, (int)as<AssDialogue>(e)->End); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->End = int_value(L, "end_time", "dialogue"); }},
+		{"style",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Style.get()); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Style = string_value(L, "style", "dialogue"); }},
+		{"actor",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Actor.get()); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Actor = string_value(L, "actor", "dialogue"); }},
+		{"effect",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Effect.get()); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Effect = string_value(L, "effect", "dialogue"); }},
+		{"margin_l",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Margin[0]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Margin[0] = int_value(L, "margin_l", "dialogue"); }},
+		{"margin_r",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Margin[1]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Margin[1] = int_value(L, "margin_r", "dialogue"); }},
+		{"margin_t",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Margin[2]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Margin[2] = int_value(L, "margin_t", "dialogue"); }},
+		{"margin_b",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Margin[2]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Margin[2] = int_value(L, "margin_b", "dialogue"); }},
+		{"text",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssDialogue>(e)->Text.get()); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssDialogue>(e)->Text = string_value(L, "text", "dialogue"); }},
+		{"extra",
+			[](lua_State *L, const AssEntry *e, const AssFile *ass) {
+				lua_newtable(L);
+				for (auto const& ed : ass->GetExtradata(as<AssDialogue>(e)->ExtradataIds)) {
+					push_value(L, ed.key);
+					push_value(L, ed.value);
+					lua_settable(L, -3);
+				}
+			},
+			[](lua_State *L, AssEntry *e, AssFile *ass) { set_extradata(L, as<AssDialogue>(e), ass); }},
+	};
+
+	const LineField style_fields[] = {
+		{"section", get_section, nullptr},
+		{"class", [](lua_State *L, const AssEntry *, const AssFile *) { push_value(L, "style"); }, nullptr},
+		{"raw", [](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->GetEntryData()); }, nullptr},
+		{"name",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->name); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->name = string_value(L, "name", "style"); }},
+		{"fontname",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->font); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->font = string_value(L, "fontname", "style"); }},
+		{"fontsize",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->fontsize); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->fontsize = double_value(L, "fontsize", "style"); }},
+		{"color1",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->primary.GetAssStyleFormatted() + "&"); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->primary = string_value(L, "color1", "style"); }},
+		{"color2",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->secondary.GetAssStyleFormatted() + "&"); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->secondary = string_value(L, "color2", "style"); }},
+		{"color3",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->outline.GetAssStyleFormatted() + "&"); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->outline = string_value(L, "color3", "style"); }},
+		{"color4",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->shadow.GetAssStyleFormatted() + "&"); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->shadow = string_value(L, "color4", "style"); }},
+		{"bold",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->bold); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->bold = bool_value(L, "bold", "style"); }},
+		{"italic",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->italic); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->italic = bool_value(L, "italic", "style"); }},
+		{"underline",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->underline); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->underline = bool_value(L, "underline", "style"); }},
+		{"strikeout",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->strikeout); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->strikeout = bool_value(L, "strikeout", "style"); }},
+		{"scale_x",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->scalex); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->scalex = double_value(L, "scale_x", "style"); }},
+		{"scale_y",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->scaley); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->scaley = double_value(L, "scale_y", "style"); }},
+		{"spacing",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->spacing); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->spacing = double_value(L, "spacing", "style"); }},
+		{"angle",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->angle); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->angle = double_value(L, "angle", "style"); }},
+		{"borderstyle",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->borderstyle); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->borderstyle = int_value(L, "borderstyle", "style"); }},
+		{"outline",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->outline_w); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->outline_w = double_value(L, "outline", "style"); }},
+		{"shadow",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->shadow_w); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->shadow_w = double_value(L, "shadow", "style"); }},
+		{"align",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->alignment); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->alignment = int_value(L, "align", "style"); }},
+		{"margin_l",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->Margin[0]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->Margin[0] = int_value(L, "margin_l", "style"); }},
+		{"margin_r",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->Margin[1]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->Margin[1] = int_value(L, "margin_r", "style"); }},
+		{"margin_t",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->Margin[2]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->Margin[2] = int_value(L, "margin_t", "style"); }},
+		{"margin_b",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->Margin[2]); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->Margin[2] = int_value(L, "margin_b", "style"); }},
+		{"encoding",
+			[](lua_State *L, const AssEntry *e, const AssFile *) { push_value(L, as<AssStyle>(e)->encoding); },
+			[](lua_State *L, AssEntry *e, AssFile *) { as<AssStyle>(e)->encoding = int_value(L, "encoding", "style"); }},
+		// From STS.h: "0: window, 1: video, 2: undefined (~window)"
+		{"relative_to", [](lua_State *L, const AssEntry *, const AssFile *) { push_value(L, 2); }, nullptr},
+	};
+
+	boost::iterator_range<const LineField *> line_fields(const AssEntry *e)
+	{
+		switch (e->Group()) {
+			case AssEntryGroup::INFO:     return boost::make_iterator_range(std::begin(info_fields), std::end(info_fields));
+			case AssEntryGroup::DIALOGUE: return boost::make_iterator_range(std::begin(dialogue_fields), std::end(dialogue_fields));
+			case AssEntryGroup::STYLE:    return boost::make_iterator_range(std::begin(style_fields), std::end(style_fields));
+			default: assert(false);       return boost::make_iterator_range(std::end(info_fields), std::end(info_fields));
+		}
+	}
+
+	const LineField *find_field(const AssEntry *e, const char *name)
+	{
+		for (auto const& field : line_fields(e)) {
+			if (strcmp(field.name, name) == 0)
+				return &field;
+		}
+		return nullptr;
+	}
+
+	std::unique_ptr<AssEntry> copy_entry(const AssEntry *e)
+	{
+		switch (e->Group()) {
+			case AssEntryGroup::INFO:  return agi::make_unique<AssInfo>(*as<AssInfo>(e));
+			case AssEntryGroup::STYLE: return agi::make_unique<AssStyle>(*as<AssStyle>(e));
+			default:                   return agi::make_unique<AssDialogue>(*as<AssDialogue>(e));
+		}
+	}
+
+	const char *proxy_mt = "aegisub.line_proxy";
+
 	using namespace Automation4;
 	template<int (LuaAssFile::*closure)(lua_State *)>
 	int closure_wrapper(lua_State *L)
 	{
+		ProfileScope profile(L, "subs");
 		return (LuaAssFile::GetObjPointer(L, lua_upvalueindex(1), false)->*closure)(L);
 	}
 
 	template<void (LuaAssFile::*closure)(lua_State *), bool allow_expired>
 	int closure_wrapper_v(lua_State *L)
 	{
+		ProfileScope profile(L, "subs");
 		(LuaAssFile::GetObjPointer(L, lua_upvalueindex(1), allow_expired)->*closure)(L);
 		return 0;
 	}
@@ -128,6 +368,46 @@ namespace {
 	const T *check_cast_constptr(const U *value) {
 		return typeid(const T) == typeid(*value) ? static_cast<const T *>(value) : nullptr;
 	}
+
+	/// Find the name of the last inline-fx tag (\-name) in a syllable's text,
+	/// matching the way karaskel has always looked for them
+	std::string find_inline_fx(std::string const& text) {
+		size_t first_ovr = text.find('{');
+		if (first_ovr == std::string::npos) return "";
+
+		for (size_t pos = text.rfind("\\-"); pos != std::string::npos && pos > first_ovr; pos = text.rfind("\\-", pos - 1)) {
+			size_t end = text.find_first_of("}\\", pos + 2);
+			if (end == std::string::npos) end = text.size();
+			if (end > pos + 2)
+				return text.substr(pos + 2, end - pos - 2);
+		}
+		return "";
+	}
+
+	// Dialogue lines packed into flat arrays by aegisub.dialogue_batch. These
+	// must match the declarations given to ffi.cdef there.
+	struct agi_dialogue_row {
+		int start_time;
+		int end_time;
+		int layer;
+		/// Index into the batch's styles array
+		int style;
+		/// Byte range of the line's text in the batch's text arena
+		size_t text_start;
+		size_t text_len;
+	};
+
+	struct agi_dialogue_batch {
+		const agi_dialogue_row *rows;
+		size_t count;
+		const char *text;
+		size_t text_len;
+		const char **styles;
+		size_t style_count;
+	};
+
+	/// LuaJIT's type tag for FFI cdata, which isn't in lua.h
+	const int lua_tcdata = LUA_TTHREAD + 2;
 }
 
 namespace Automation4 {
@@ -145,96 +425,19 @@ namespace Automation4 {
 			error(L, "Requested out-of-range line from subtitle file: %d", idx);
 	}
 
-	void LuaAssFile::AssEntryToLua(lua_State *L, size_t idx)
+	AssEntry *LuaAssFile::GetLine(size_t idx)
 	{
-		lua_newtable(L);
-
-		const AssEntry *e = lines[idx];
-		if (!e)
-			e = &ass->Info[idx];
-
-		set_field(L, "section", e->GroupHeader());
-
-		if (auto info = check_cast_constptr<AssInfo>(e)) {
-			set_field(L, "raw", info->GetEntryData());
-			set_field(L, "key", info->Key());
-			set_field(L, "value", info->Value());
-			set_field(L, "class", "info");
-		}
-		else if (auto dia = check_cast_constptr<AssDialogue>(e)) {
-			set_field(L, "raw", dia->GetEntryData());
-			set_field(L, "comment", dia->Comment);
-
-			set_field(L, "layer", dia->Layer);
-
-			set_field(L, "start_time", dia->Start);
-			set_field(L, "end_time", dia->End);
-
-			set_field(L, "style", dia->Style);
-			set_field(L, "actor", dia->Actor);
-			set_field(L, "effect", dia->Effect);
-
-			set_field(L, "margin_l", dia->Margin[0]);
-			set_field(L, "margin_r", dia->Margin[1]);
-			set_field(L, "margin_t", dia->Margin[2]);
-			set_field(L, "margin_b", dia->Margin[2]);
-
-			set_field(L, "text", dia->Text);
-
-			// create extradata table
-			lua_newtable(L);
-			for (auto const& ed : ass->GetExtradata(dia->ExtradataIds)) {
-				push_value(L, ed.key);
-				push_value(L, ed.value);
-				lua_settable(L, -3);
-			}
-			lua_setfield(L, -2, "extra");
-
-			set_field(L, "class", "dialogue");
-		}
-		else if (auto sty = check_cast_constptr<AssStyle>(e)) {
-			set_field(L, "raw", sty->GetEntryData());
-			set_field(L, "name", sty->name);
-
-			set_field(L, "fontname", sty->font);
-			set_field(L, "fontsize", sty->fontsize);
-
-			set_field(L, "color1", sty->primary.GetAssStyleFormatted() + "&");
-			set_field(L, "color2", sty->secondary.GetAssStyleFormatted() + "&");
-			set_field(L, "color3", sty->outline.GetAssStyleFormatted() + "&");
-			set_field(L, "color4", sty->shadow.GetAssStyleFormatted() + "&");
-
-			set_field(L, "bold", sty->bold);
-			set_field(L, "italic", sty->italic);
-			set_field(L, "underline", sty->underline);
-			set_field(L, "strikeout", sty->strikeout);
-
-			set_field(L, "scale_x", sty->scalex);
-			set_field(L, "scale_y", sty->scaley);
-
-			set_field(L, "spacing", sty->spacing);
-
-			set_field(L, "angle", sty->angle);
-
-			set_field(L, "borderstyle", sty->borderstyle);
-			set_field(L, "outline", sty->outline_w);
-			set_field(L, "shadow", sty->shadow_w);
-
-			set_field(L, "align", sty->alignment);
-
-			set_field(L, "margin_l", sty->Margin[0]);
-			set_field(L, "margin_r", sty->Margin[1]);
-			set_field(L, "margin_t", sty->Margin[2]);
-			set_field(L, "margin_b", sty->Margin[2]);
-
-			set_field(L, "encoding", sty->encoding);
-
-			set_field(L, "relative_to", 2);// From STS.h: "0: window, 1: video, 2: undefined (~window)"
+		return lines[idx] ? lines[idx] : &ass->Info[idx];
+	}
 
-			set_field(L, "class", "style");
-		}
-		else {
-			assert(false);
+	void LuaAssFile::AssEntryToLua(lua_State *L, size_t idx)
+	{
+		const AssEntry *e = GetLine(idx);
+		auto fields = line_fields(e);
+		lua_createtable(L, 0, fields.size());
+		for (auto const& field : fields) {
+			field.get(L, e, ass);
+			lua_setfield(L, -2, field.name);
 		}
 	}
 
@@ -243,6 +446,9 @@ namespace Automation4 {
 		// assume an assentry table is on the top of the stack
 		// convert it to a real AssEntry object, and pop the table from the stack
 
+		if (lua_type(L, -1) == LUA_TUSERDATA)
+			return copy_entry(GetProxyLine(L, -1));
+
 		if (!lua_istable(L, -1))
 			error(L, "Can't convert a non-table value to AssEntry");
 
@@ -302,23 +508,9 @@ namespace Automation4 {
 			dia->Effect = get_string_field(L, "effect", "dialogue");
 			dia->Text = get_string_field(L, "text", "dialogue");
 
-			std::vector<uint32_t> new_ids;
-
 			lua_getfield(L, -1, "extra");
-			auto type = lua_type(L, -1);
-			if (type == LUA_TTABLE) {
-				lua_for_each(L, [&] {
-					if (lua_type(L, -2) != LUA_TSTRING) return;
-					new_ids.push_back(ass->AddExtradata(
-						get_string_or_default(L, -2),
-						get_string_or_default(L, -1)));
-				});
-				std::sort(begin(new_ids), end(new_ids));
-				dia->ExtradataIds = std::move(new_ids);
-			}
-			else if (type != LUA_TNIL) {
-				error(L, "dialogue extradata must be a table");
-			}
+			set_extradata(L, dia, ass);
+			lua_pop(L, 1);
 		}
 		else {
 			error(L, "Found line with unknown class: %s", lclass.c_str());
@@ -360,8 +552,22 @@ namespace Automation4 {
 					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectInsert, false>, 1);
 				else if (strcmp(idx, "append") == 0)
 					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectAppend, false>, 1);
+				else if (strcmp(idx, "get_range") == 0)
+					lua_pushcclosure(L, closure_wrapper<&LuaAssFile::ObjectGetRange>, 1);
+				else if (strcmp(idx, "set_range") == 0)
+					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectSetRange, false>, 1);
+				else if (strcmp(idx, "append_many") == 0)
+					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectAppendMany, false>, 1);
+				else if (strcmp(idx, "append_batch") == 0)
+					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectAppendBatch, false>, 1);
+				else if (strcmp(idx, "delete_many") == 0)
+					lua_pushcclosure(L, closure_wrapper_v<&LuaAssFile::ObjectDeleteMany, false>, 1);
 				else if (strcmp(idx, "script_resolution") == 0)
 					lua_pushcclosure(L, closure_wrapper<&LuaAssFile::LuaGetScriptResolution>, 1);
+				else if (strcmp(idx, "proxy") == 0)
+					lua_pushcclosure(L, closure_wrapper<&LuaAssFile::ObjectProxy>, 1);
+				else if (strcmp(idx, "proxies") == 0)
+					lua_pushcclosure(L, closure_wrapper<&LuaAssFile::ObjectProxies>, 1);
 				else {
 					// idiot
 					lua_pop(L, 1);
@@ -402,28 +608,44 @@ namespace Automation4 {
 			lines_to_delete.emplace_back(lines[idx]);
 	}
 
-	void LuaAssFile::AssignLine(size_t idx, std::unique_ptr<AssEntry> e)
+	AssEntry *LuaAssFile::TakeLine(std::unique_ptr<AssEntry> e)
 	{
-		auto group = e->Group();
-		if (group == AssEntryGroup::INFO)
+		auto ret = e.get();
+		if (e->Group() == AssEntryGroup::INFO) {
 			InitScriptInfoIfNeeded();
-		lines[idx] = e.get();
-		if (group == AssEntryGroup::INFO)
 			lines_to_delete.emplace_back(std::move(e));
+		}
 		else
 			e.release();
+		return ret;
 	}
 
-	void LuaAssFile::InsertLine(std::vector<AssEntry *> &vec, size_t idx, std::unique_ptr<AssEntry> e)
+	void LuaAssFile::AssignLine(size_t idx, std::unique_ptr<AssEntry> e)
 	{
-		auto group = e->Group();
-		if (group == AssEntryGroup::INFO)
-			InitScriptInfoIfNeeded();
-		vec.insert(vec.begin() + idx, e.get());
-		if (group == AssEntryGroup::INFO)
-			lines_to_delete.emplace_back(std::move(e));
+		lines[idx] = TakeLine(std::move(e));
+	}
+
+	void LuaAssFile::NoteReplacement(size_t idx, const AssEntry *e)
+	{
+		auto current = lines[idx];
+		if (current && current->Group() == AssEntryGroup::DIALOGUE && e->Group() == AssEntryGroup::DIALOGUE)
+			replaced_dialogue.emplace(idx, static_cast<AssDialogue *>(current));
 		else
-			e.release();
+			lines_rearranged = true;
+	}
+
+	std::vector<std::pair<AssDialogue*, AssDialogue*>> LuaAssFile::GetReplacements()
+	{
+		std::vector<std::pair<AssDialogue*, AssDialogue*>> ret;
+		ret.reserve(replaced_dialogue.size());
+		for (auto const& replaced : replaced_dialogue)
+			ret.emplace_back(replaced.second, static_cast<AssDialogue *>(lines[replaced.first]));
+		return ret;
+	}
+
+	void LuaAssFile::InsertLine(size_t idx, std::unique_ptr<AssEntry> e)
+	{
+		lines.insert(idx, TakeLine(std::move(e)));
 	}
 
 	void LuaAssFile::ObjectIndexWrite(lua_State *L)
@@ -455,6 +677,7 @@ namespace Automation4 {
 
 				auto e = LuaToAssEntry(L, ass);
 				modification_type |= modification_mask(e.get());
+				NoteReplacement(n - 1, e.get());
 				QueueLineForDeletion(n - 1);
 				AssignLine(n - 1, std::move(e));
 			}
@@ -501,20 +724,18 @@ namespace Automation4 {
 		}
 
 		sort(ids.begin(), ids.end());
+		ids.erase(unique(ids.begin(), ids.end()), ids.end());
 
-		size_t id_idx = 0, out = 0;
-		for (size_t i = 0; i < lines.size(); ++i) {
-			if (id_idx < ids.size() && ids[id_idx] == i) {
-				modification_type |= modification_mask(lines[i]);
-				QueueLineForDeletion(i);
-				++id_idx;
-			}
-			else {
-				lines[out++] = lines[i];
-			}
-		}
+		if (!ids.empty())
+			lines_rearranged = true;
 
-		lines.erase(lines.begin() + out, lines.end());
+		// Erasing from the back means the lines vector's gap only has to
+		// move across each deleted line once
+		for (auto it = ids.rbegin(); it != ids.rend(); ++it) {
+			modification_type |= modification_mask(lines[*it]);
+			QueueLineForDeletion(*it);
+			lines.erase(*it);
+		}
 	}
 
 	void LuaAssFile::ObjectDeleteRange(lua_State *L)
@@ -526,12 +747,37 @@ namespace Automation4 {
 
 		if (a >= b) return;
 
+		lines_rearranged = true;
 		for (size_t i = a; i < b; ++i) {
 			modification_type |= modification_mask(lines[i]);
 			QueueLineForDeletion(i);
 		}
 
-		lines.erase(lines.begin() + a, lines.begin() + b);
+		lines.erase(a, b);
+	}
+
+	void LuaAssFile::AppendLine(std::unique_ptr<AssEntry> e)
+	{
+		modification_type |= modification_mask(e.get());
+		lines_rearranged = true;
+
+		if (lines.empty()) {
+			InsertLine(0, std::move(e));
+			return;
+		}
+
+		// Find the appropriate place to put it
+		auto group = e->Group();
+		for (size_t i = lines.size(); i > 0; --i) {
+			auto cur_group = lines[i - 1] ? lines[i - 1]->Group() : AssEntryGroup::INFO;
+			if (cur_group == group) {
+				InsertLine(i, std::move(e));
+				return;
+			}
+		}
+
+		// No lines of this type exist already, so just append it to the end
+		InsertLine(lines.size(), std::move(e));
 	}
 
 	void LuaAssFile::ObjectAppend(lua_State *L)
@@ -542,27 +788,109 @@ namespace Automation4 {
 
 		for (int i = 1; i <= n; i++) {
 			lua_pushvalue(L, i);
-			auto e = LuaToAssEntry(L, ass);
-			modification_type |= modification_mask(e.get());
+			AppendLine(LuaToAssEntry(L, ass));
+			lua_pop(L, 1);
+		}
+	}
 
-			if (lines.empty()) {
-				InsertLine(lines, 0, std::move(e));
-				continue;
-			}
+	std::vector<std::unique_ptr<AssEntry>> LuaAssFile::LinesFromTable(lua_State *L, int idx)
+	{
+		argcheck(L, lua_istable(L, idx), idx, "Expected an array of subtitle lines");
+
+		// Convert all of the lines before making any changes so that an
+		// invalid line doesn't leave the file half-modified
+		size_t n = lua_objlen(L, idx);
+		std::vector<std::unique_ptr<AssEntry>> ret;
+		ret.reserve(n);
+		for (size_t i = 1; i <= n; ++i) {
+			lua_rawgeti(L, idx, i);
+			ret.push_back(LuaToAssEntry(L, ass));
+			lua_pop(L, 1);
+		}
+		return ret;
+	}
 
-			// Find the appropriate place to put it
-			auto group = e->Group();
-			for (size_t i = lines.size(); i > 0; --i) {
-				auto cur_group = lines[i - 1] ? lines[i - 1]->Group() : AssEntryGroup::INFO;
-				if (cur_group == group) {
-					InsertLine(lines, i, std::move(e));
-					break;
-				}
-			}
+	int LuaAssFile::ObjectGetRange(lua_State *L)
+	{
+		size_t a = std::max<size_t>(check_uint(L, 1), 1) - 1;
+		size_t b = std::min<size_t>(check_uint(L, 2), lines.size());
 
-			// No lines of this type exist already, so just append it to the end
-			if (e) InsertLine(lines, lines.size(), std::move(e));
+		lua_createtable(L, a < b ? b - a : 0, 0);
+		for (size_t i = a; i < b; ++i) {
+			AssEntryToLua(L, i);
+			lua_rawseti(L, -2, i - a + 1);
+		}
+		return 1;
+	}
+
+	void LuaAssFile::ObjectSetRange(lua_State *L)
+	{
+		CheckAllowModify();
+
+		int first = check_int(L, 1);
+		auto new_lines = LinesFromTable(L, 2);
+		if (new_lines.empty()) return;
+
+		CheckBounds(first);
+		CheckBounds(first + new_lines.size() - 1);
+
+		for (size_t i = 0; i < new_lines.size(); ++i) {
+			modification_type |= modification_mask(new_lines[i].get());
+			NoteReplacement(first - 1 + i, new_lines[i].get());
+			QueueLineForDeletion(first - 1 + i);
+			AssignLine(first - 1 + i, std::move(new_lines[i]));
+		}
+	}
+
+	void LuaAssFile::ObjectAppendMany(lua_State *L)
+	{
+		CheckAllowModify();
+
+		for (auto& e : LinesFromTable(L, 1))
+			AppendLine(std::move(e));
+	}
+
+	void LuaAssFile::ObjectAppendBatch(lua_State *L)
+	{
+		CheckAllowModify();
+
+		// There's no way to check the ctype of cdata from here, so this relies
+		// on aegisub.dialogue_batch being the only thing which calls it
+		argcheck(L, lua_type(L, 1) == lua_tcdata, 1, "Expected a dialogue batch");
+		auto batch = static_cast<const agi_dialogue_batch *>(lua_topointer(L, 1));
+
+		std::vector<agi::StringFlyweight> styles;
+		styles.reserve(batch->style_count);
+		for (size_t i = 0; i < batch->style_count; ++i)
+			styles.emplace_back(batch->styles[i]);
+
+		// As with append_many, every row is checked before the file is touched
+		std::vector<std::unique_ptr<AssEntry>> new_lines;
+		new_lines.reserve(batch->count);
+		for (size_t i = 0; i < batch->count; ++i) {
+			auto const& row = batch->rows[i];
+			if (row.style < 0 || static_cast<size_t>(row.style) >= styles.size())
+				error(L, "Dialogue batch row %d has an invalid style index", static_cast<int>(i + 1));
+			if (row.text_start > batch->text_len || row.text_len > batch->text_len - row.text_start)
+				error(L, "Dialogue batch row %d has text outside of the batch's text", static_cast<int>(i + 1));
+
+			auto dia = agi::make_unique<AssDialogue>();
+			dia->Start = row.start_time;
+			dia->End = row.end_time;
+			dia->Layer = row.layer;
+			dia->Style = styles[row.style];
+			dia->Text = std::string(batch->text + row.text_start, row.text_len);
+			new_lines.push_back(std::move(dia));
 		}
+
+		for (auto& e : new_lines)
+			AppendLine(std::move(e));
+	}
+
+	void LuaAssFile::ObjectDeleteMany(lua_State *L)
+	{
+		argcheck(L, lua_gettop(L) == 1 && lua_istable(L, 1), 1, "Expected an array of line indices");
+		ObjectDelete(L);
 	}
 
 	void LuaAssFile::ObjectInsert(lua_State *L)
@@ -588,10 +916,12 @@ namespace Automation4 {
 			lua_pushvalue(L, i);
 			auto e = LuaToAssEntry(L, ass);
 			modification_type |= modification_mask(e.get());
-			InsertLine(new_entries, i - 2, std::move(e));
+			new_entries.push_back(TakeLine(std::move(e)));
 			lua_pop(L, 1);
 		}
-		lines.insert(lines.begin() + before - 1, new_entries.begin(), new_entries.end());
+		lines.insert(before - 1, new_entries.begin(), new_entries.end());
+		if (!new_entries.empty())
+			lines_rearranged = true;
 	}
 
 	void LuaAssFile::ObjectGarbageCollect(lua_State *L)
@@ -623,6 +953,129 @@ namespace Automation4 {
 		return 2;
 	}
 
+	void LuaAssFile::PushProxy(lua_State *L, size_t idx)
+	{
+		make<LineProxy>(L, proxy_mt, LineProxy{this, GetLine(idx), idx});
+
+		// Keep the subtitles object alive for as long as any of its lines
+		// are, as the proxy doesn't own the line it refers to
+		lua_createtable(L, 1, 0);
+		lua_pushvalue(L, lua_upvalueindex(1));
+		lua_rawseti(L, -2, 1);
+		lua_setfenv(L, -2);
+	}
+
+	int LuaAssFile::ObjectProxy(lua_State *L)
+	{
+		int idx = check_int(L, 1);
+		CheckBounds(idx);
+		PushProxy(L, idx - 1);
+		return 1;
+	}
+
+	int LuaAssFile::ObjectProxies(lua_State *L)
+	{
+		lua_pushvalue(L, lua_upvalueindex(1));
+		lua_pushcclosure(L, closure_wrapper<&LuaAssFile::ProxyIterNext>, 1);
+		lua_pushnil(L);
+		push_value(L, 0);
+		return 3;
+	}
+
+	int LuaAssFile::ProxyIterNext(lua_State *L)
+	{
+		size_t i = check_uint(L, 2);
+		if (i >= lines.size()) {
+			lua_pushnil(L);
+			return 1;
+		}
+
+		push_value(L, i + 1);
+		PushProxy(L, i);
+		return 2;
+	}
+
+	LuaAssFile::LineProxy& LuaAssFile::GetProxy(lua_State *L, int idx)
+	{
+		auto& proxy = get<LineProxy>(L, idx, proxy_mt);
+		if (proxy.file->references < 2)
+			error(L, "Subtitles object is no longer valid");
+
+		// Follow the line through any copies made by writes via other
+		// proxies to it
+		auto& replaced = proxy.file->proxy_replaced;
+		for (auto it = replaced.find(proxy.entry); it != replaced.end(); it = replaced.find(proxy.entry))
+			proxy.entry = it->second;
+		return proxy;
+	}
+
+	const AssEntry *LuaAssFile::GetProxyLine(lua_State *L, int idx)
+	{
+		return GetProxy(L, idx).entry;
+	}
+
+	int LuaAssFile::ProxyIndexRead(lua_State *L)
+	{
+		auto& proxy = GetProxy(L, 1);
+		auto field = lua_type(L, 2) == LUA_TSTRING ? find_field(proxy.entry, lua_tostring(L, 2)) : nullptr;
+		if (field)
+			field->get(L, proxy.entry, proxy.file->ass);
+		else
+			lua_pushnil(L);
+		return 1;
+	}
+
+	int LuaAssFile::ProxyIndexWrite(lua_State *L)
+	{
+		auto& proxy = GetProxy(L, 1);
+		auto file = proxy.file;
+		file->CheckAllowModify();
+
+		auto name = check_string(L, 2);
+		auto field = find_field(proxy.entry, name.c_str());
+		if (!field)
+			error(L, "Subtitle line has no field named '%s'", name.c_str());
+		if (!field->set)
+			error(L, "Field '%s' of a subtitle line can't be assigned to", name.c_str());
+
+		// Find where the line currently is, as lines may have been inserted
+		// or deleted since the proxy was created
+		size_t idx = proxy.idx;
+		auto& lines = file->lines;
+		if (idx >= lines.size() || file->GetLine(idx) != proxy.entry) {
+			idx = 0;
+			while (idx < lines.size() && lines[idx] != proxy.entry) ++idx;
+			if (idx == lines.size())
+				error(L, "Attempt to modify a subtitle line which has been deleted or replaced");
+		}
+
+		// Lines from the file, and copies which are part of a pending undo
+		// point, are copied on the first write rather than modified
+		AssEntry *target = proxy.entry;
+		std::unique_ptr<AssEntry> copy;
+		if (!file->proxy_copies.count(target)) {
+			copy = copy_entry(target);
+			target = copy.get();
+		}
+
+		lua_settop(L, 3);
+		field->set(L, target, file->ass);
+		if (target->Group() == AssEntryGroup::STYLE)
+			as<AssStyle>(target)->UpdateData();
+		file->modification_type |= modification_mask(target);
+
+		if (copy) {
+			file->proxy_copies.insert(target);
+			file->proxy_replaced[proxy.entry] = target;
+			file->NoteReplacement(idx, target);
+			file->QueueLineForDeletion(idx);
+			file->AssignLine(idx, std::move(copy));
+		}
+		proxy.entry = target;
+		proxy.idx = idx;
+		return 0;
+	}
+
 	int LuaAssFile::LuaParseKaraokeData(lua_State *L)
 	{
 		auto e = LuaToAssEntry(L, ass);
@@ -634,24 +1087,47 @@ namespace Automation4 {
 		// 2.1.x stored everything before the first syllable at index zero
 		// There's no longer any such thing with the new parser, but scripts
 		// may rely on kara[0] existing so add an empty syllable
-		lua_createtable(L, 0, 6);
+		lua_createtable(L, 0, 11);
 		set_field(L, "duration", 0);
+		set_field(L, "kdur", 0);
 		set_field(L, "start_time", 0);
 		set_field(L, "end_time", 0);
 		set_field(L, "tag", "");
 		set_field(L, "text", "");
 		set_field(L, "text_stripped", "");
+		set_field(L, "text_spacestripped", "");
+		set_field(L, "prespace", "");
+		set_field(L, "postspace", "");
+		set_field(L, "inline_fx", "");
 		lua_rawseti(L, -2, idx++);
 
+		// Everything karaskel needs per syllable is computed here so that
+		// templates don't have to pattern match every syllable in Lua
+		std::string inline_fx;
 		AssKaraoke kara(dia, false, false);
 		for (auto const& syl : kara) {
-			lua_createtable(L, 0, 6);
+			auto text = syl.GetText(false);
+			auto fx = find_inline_fx(text);
+			if (!fx.empty())
+				inline_fx = std::move(fx);
+
+			auto const& stripped = syl.text;
+			size_t pre = std::min(stripped.find_first_not_of(" \t"), stripped.size());
+			size_t post = stripped.find_last_not_of(" \t");
+			post = post == std::string::npos || post < pre ? pre : post + 1;
+
+			lua_createtable(L, 0, 11);
 			set_field(L, "duration", syl.duration);
+			set_field(L, "kdur", syl.duration / 10.0);
 			set_field(L, "start_time", syl.start_time - dia->Start);
 			set_field(L, "end_time", syl.start_time + syl.duration - dia->Start);
 			set_field(L, "tag", syl.tag_type);
-			set_field(L, "text", syl.GetText(false));
-			set_field(L, "text_stripped", syl.text);
+			set_field(L, "text", text);
+			set_field(L, "text_stripped", stripped);
+			set_field(L, "text_spacestripped", stripped.substr(pre, post - pre));
+			set_field(L, "prespace", stripped.substr(0, pre));
+			set_field(L, "postspace", stripped.substr(post));
+			set_field(L, "inline_fx", inline_fx);
 			lua_rawseti(L, -2, idx++);
 		}
 
@@ -678,8 +1154,15 @@ namespace Automation4 {
 
 			back.modification_type = modification_type;
 			back.mesage = to_wx(check_string(L, 1));
-			back.lines = lines;
+			back.in_place = !lines_rearranged;
+			if (back.in_place)
+				back.replaced = GetReplacements();
+			else
+				back.lines = lines.to_vector();
 			modification_type = 0;
+			proxy_copies.clear();
+			replaced_dialogue.clear();
+			lines_rearranged = false;
 		}
 	}
 
@@ -700,6 +1183,8 @@ namespace Automation4 {
 				ass->Info.clear();
 			ass->Styles.clear();
 			ass->Events.clear();
+			ass->StylesChanged();
+			ass->EventsChanged();
 
 			for (auto line : lines) {
 				if (!line) continue;
@@ -711,21 +1196,52 @@ namespace Automation4 {
 				}
 			}
 		};
+		// Lines which were only replaced are swapped into the file in place,
+		// so that the commit can tell everything else listening to the file
+		// exactly which lines changed
+		auto apply_replacements = [&](std::vector<std::pair<AssDialogue*, AssDialogue*>> const& replaced) {
+			std::vector<AssDialogue *> changed;
+			changed.reserve(replaced.size());
+			for (auto const& line : replaced) {
+				line.second->Id = line.first->Id;
+				line.second->Row = line.first->Row;
+				ass->Events.insert(ass->Events.iterator_to(*line.first), *line.second);
+				ass->Events.erase(ass->Events.iterator_to(*line.first));
+				changed.push_back(line.second);
+			}
+			return changed;
+		};
+		auto commit = [&](wxString const& desc, int type, std::vector<AssDialogue *> const& changed) {
+			if (changed.empty())
+				ass->Commit(desc, type);
+			else
+				ass->Commit(desc, AssFile::COMMIT_DIAG_FULL, changed);
+		};
+
 		// Apply any pending commits
 		for (auto const& pc : pending_commits) {
-			apply_lines(pc.lines);
-			ass->Commit(pc.mesage, pc.modification_type);
+			if (pc.in_place)
+				commit(pc.mesage, pc.modification_type, apply_replacements(pc.replaced));
+			else {
+				apply_lines(pc.lines);
+				ass->Commit(pc.mesage, pc.modification_type);
+			}
 		}
 
+		std::vector<AssDialogue *> changed;
+		if (modification_type && !lines_rearranged)
+			changed = apply_replacements(GetReplacements());
+
+		auto ret = lines.release();
+
 		// Commit any changes after the last undo point was set
-		if (modification_type)
-			apply_lines(lines);
+		if (modification_type && lines_rearranged)
+			apply_lines(ret);
 		if (modification_type && can_set_undo && !undo_description.empty())
-			ass->Commit(undo_description, modification_type);
+			commit(undo_description, modification_type, changed);
 
 		lines_to_delete.clear();
 
-		auto ret = std::move(lines);
 		references--;
 		if (!references) delete this;
 		return ret;
@@ -763,6 +1279,12 @@ namespace Automation4 {
 		set_field<closure_wrapper<&LuaAssFile::ObjectIPairs>>(L, "__ipairs");
 		lua_setmetatable(L, -2);
 
+		if (luaL_newmetatable(L, proxy_mt)) {
+			set_field<ProxyIndexRead>(L, "__index");
+			set_field<ProxyIndexWrite>(L, "__newindex");
+		}
+		lua_pop(L, 1);
+
 		// register misc functions
 		// assume the "aegisub" global table exists
 		lua_getglobal(L, "aegisub");
@@ -37,6 +37,7 @@
 namespace Automation4 {
 	class LuaScriptFactory final : public ScriptFactory {
 		std::unique_ptr<Script> Produce(agi::fs::path const& filename) const override;
+		std::unique_ptr<Script> ProduceDeferred(agi::fs::path const& filename, ScriptManifest const& manifest) const override;
 	public:
 		LuaScriptFactory();
 	};
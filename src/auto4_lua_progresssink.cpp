@@ -36,6 +36,7 @@
 
 #include "compat.h"
 
+#include <libaegisub/lua/profiler.h>
 #include <libaegisub/lua/utils.h>
 
 #include <wx/filedlg.h>
@@ -43,11 +44,21 @@
 using namespace agi::lua;
 
 namespace {
+	/// Minimum time between progress dialog updates
+	const std::chrono::milliseconds update_interval(1000 / 30);
+
+	template<lua_CFunction fn>
+	int profiled(lua_State *L)
+	{
+		ProfileScope profile(L, "progress");
+		return fn(L);
+	}
+
 	template<lua_CFunction fn>
 	void set_field_to_closure(lua_State *L, const char *name, int ps_idx = -3)
 	{
 		lua_pushvalue(L, ps_idx);
-		lua_pushcclosure(L, exception_wrapper<fn>, 1);
+		lua_pushcclosure(L, exception_wrapper<profiled<fn>>, 1);
 		lua_setfield(L, -2, name);
 	}
 
@@ -66,9 +77,10 @@ namespace {
 namespace Automation4 {
 	LuaProgressSink::LuaProgressSink(lua_State *L, ProgressSink *ps, bool allow_config_dialog)
 	: L(L)
+	, ps(ps)
 	{
-		auto ud = (ProgressSink**)lua_newuserdata(L, sizeof(ProgressSink*));
-		*ud = ps;
+		auto ud = (LuaProgressSink**)lua_newuserdata(L, sizeof(LuaProgressSink*));
+		*ud = this;
 
 		// register progress reporting stuff
 		lua_getglobal(L, "aegisub");
@@ -106,6 +118,8 @@ namespace Automation4 {
 
 	LuaProgressSink::~LuaProgressSink()
 	{
+		Flush();
+
 		// remove progress reporting stuff
 		lua_getglobal(L, "aegisub");
 		set_field_to_nil(L, -2, "progress");
@@ -118,18 +132,47 @@ namespace Automation4 {
 	ProgressSink* LuaProgressSink::GetObjPointer(lua_State *L, int idx)
 	{
 		assert(lua_type(L, idx) == LUA_TUSERDATA);
-		return *((ProgressSink**)lua_touserdata(L, idx));
+		return (*((LuaProgressSink**)lua_touserdata(L, idx)))->ps;
+	}
+
+	LuaProgressSink *LuaProgressSink::GetSink(lua_State *L)
+	{
+		assert(lua_type(L, lua_upvalueindex(1)) == LUA_TUSERDATA);
+		return *((LuaProgressSink**)lua_touserdata(L, lua_upvalueindex(1)));
+	}
+
+	void LuaProgressSink::Update()
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (now < next_update) return;
+		next_update = now + update_interval;
+		Flush();
+	}
+
+	void LuaProgressSink::Flush()
+	{
+		if (has_pending_progress)
+			ps->SetProgress(pending_progress, 100);
+		if (has_pending_task)
+			ps->SetMessage(pending_task);
+		has_pending_progress = has_pending_task = false;
 	}
 
 	int LuaProgressSink::LuaSetProgress(lua_State *L)
 	{
-		GetObjPointer(L, lua_upvalueindex(1))->SetProgress(lua_tonumber(L, 1), 100);
+		auto sink = GetSink(L);
+		sink->pending_progress = lua_tonumber(L, 1);
+		sink->has_pending_progress = true;
+		sink->Update();
 		return 0;
 	}
 
 	int LuaProgressSink::LuaSetTask(lua_State *L)
 	{
-		GetObjPointer(L, lua_upvalueindex(1))->SetMessage(check_string(L, 1));
+		auto sink = GetSink(L);
+		sink->pending_task = check_string(L, 1);
+		sink->has_pending_task = true;
+		sink->Update();
 		return 0;
 	}
 
@@ -141,7 +184,11 @@ namespace Automation4 {
 
 	int LuaProgressSink::LuaGetCancelled(lua_State *L)
 	{
-		lua_pushboolean(L, GetObjPointer(L, lua_upvalueindex(1))->IsCancelled());
+		// Scripts which update their progress only occasionally usually check
+		// for cancellation often, so use that to send the latest update
+		auto sink = GetSink(L);
+		sink->Update();
+		lua_pushboolean(L, sink->ps->IsCancelled());
 		return 1;
 	}
 
@@ -186,6 +233,7 @@ namespace Automation4 {
 
 	int LuaProgressSink::LuaDisplayDialog(lua_State *L)
 	{
+		GetSink(L)->Flush();
 		ProgressSink *ps = GetObjPointer(L, lua_upvalueindex(1));
 
 		LuaDialog dlg(L, true); // magically creates the config dialog structure etc
@@ -197,6 +245,7 @@ namespace Automation4 {
 
 	int LuaProgressSink::LuaDisplayOpenDialog(lua_State *L)
 	{
+		GetSink(L)->Flush();
 		ProgressSink *ps = GetObjPointer(L, lua_upvalueindex(1));
 		wxString message(check_wxstring(L, 1));
 		wxString dir(check_wxstring(L, 2));
@@ -236,6 +285,7 @@ namespace Automation4 {
 
 	int LuaProgressSink::LuaDisplaySaveDialog(lua_State *L)
 	{
+		GetSink(L)->Flush();
 		ProgressSink *ps = GetObjPointer(L, lua_upvalueindex(1));
 		wxString message(check_wxstring(L, 1));
 		wxString dir(check_wxstring(L, 2));
@@ -0,0 +1,172 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "autosave_journal.h"
+
+#include "ass_dialogue.h"
+#include "ass_file.h"
+#include "ass_snapshot.h"
+#include "subtitle_format.h"
+#include "text_file_reader.h"
+
+#include <libaegisub/exception.h>
+#include <libaegisub/format.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/make_unique.h>
+#include <libaegisub/util.h>
+#include <libaegisub/vfr.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+namespace {
+const char header[] = "[Aegisub Autosave Journal]";
+
+DEFINE_EXCEPTION(JournalError, agi::Exception);
+
+/// Read "<prefix><a> <b>" from a journal line
+bool ParseCounts(std::string const& line, const char *prefix, size_t &a, size_t &b) {
+	if (!boost::starts_with(line, prefix)) return false;
+	return sscanf(line.c_str() + strlen(prefix), "%zu %zu", &a, &b) == 2;
+}
+}
+
+const char *const AutosaveJournal::extension = ".journal";
+
+AutosaveJournal::AutosaveJournal(agi::fs::path directory, std::string name)
+: directory(std::move(directory))
+, name(std::move(name))
+{
+}
+
+AutosaveJournal::~AutosaveJournal() = default;
+
+void AutosaveJournal::Compact(std::shared_ptr<const AssFileSnapshot> const& snapshot) {
+	AssFile subs;
+	snapshot->Restore(subs);
+
+	agi::fs::CreateDirectory(directory);
+	base = directory / agi::format("%s.%s.AUTOSAVE.ass", name, agi::util::strftime("%Y-%m-%d-%H-%M-%S"));
+	SubtitleFormat::GetWriter(base)->WriteFile(&subs, base, 0, "UTF-8");
+
+	journal = base;
+	journal += extension;
+	boost::filesystem::ofstream out(journal, std::ios::binary | std::ios::trunc);
+	out << header << "\n" << "Base: " << base.filename().string() << "\n";
+	if (!out)
+		throw JournalError("Could not write to " + journal.string());
+
+	last = snapshot;
+	entries = 0;
+}
+
+agi::fs::path AutosaveJournal::Write(std::shared_ptr<const AssFileSnapshot> const& snapshot) {
+	if (!last || entries >= compact_interval || !snapshot->SameSections(*last)) {
+		Compact(snapshot);
+		return base;
+	}
+
+	// Build the whole entry first so that it goes out in a single write
+	std::string entry;
+	size_t chunks = 0;
+	snapshot->ForEachChangedChunk(*last, [&](size_t first, std::vector<AssDialogueBase> const& lines) {
+		entry += agi::format("Chunk: %zu %zu\n", first, lines.size());
+		for (auto const& line : lines) {
+			line.AppendEntryData(entry);
+			entry += '\n';
+		}
+		++chunks;
+	});
+
+	std::string commit = agi::format("Commit: %zu %zu\n", snapshot->EventCount(), chunks);
+	boost::filesystem::ofstream out(journal, std::ios::binary | std::ios::app);
+	out << commit << entry;
+	out.flush();
+	if (!out)
+		throw JournalError("Could not write to " + journal.string());
+
+	last = snapshot;
+	++entries;
+	return journal;
+}
+
+void AutosaveJournal::Recover(agi::fs::path const& journal, agi::fs::path const& output) {
+	TextFileReader file(journal, "UTF-8", false);
+	if (!file.HasMoreLines() || file.ReadLineFromFile() != header)
+		throw JournalError(journal.string() + " is not an autosave journal");
+
+	std::string base_line = file.HasMoreLines() ? file.ReadLineFromFile() : "";
+	if (!boost::starts_with(base_line, "Base: "))
+		throw JournalError(journal.string() + " does not name its base file");
+	auto base = journal.parent_path() / base_line.substr(6);
+
+	AssFile subs;
+	SubtitleFormat::GetReader(base, "UTF-8")->ReadFile(&subs, base, 0, "UTF-8");
+
+	std::vector<AssDialogue *> rows;
+	for (auto& line : subs.Events)
+		rows.push_back(&line);
+
+	while (file.HasMoreLines()) {
+		size_t count, chunks;
+		if (!ParseCounts(file.ReadLineFromFile(), "Commit: ", count, chunks))
+			break;
+
+		// Read the whole entry before applying any of it, so that one cut off
+		// by a crash while it was being written is skipped
+		std::vector<std::pair<size_t, std::vector<std::unique_ptr<AssDialogue>>>> changes;
+		bool complete = true;
+		for (size_t i = 0; complete && i < chunks; ++i) {
+			size_t first, lines;
+			if (!file.HasMoreLines() || !ParseCounts(file.ReadLineFromFile(), "Chunk: ", first, lines)) {
+				complete = false;
+				break;
+			}
+
+			changes.emplace_back(first, std::vector<std::unique_ptr<AssDialogue>>());
+			for (size_t j = 0; j < lines; ++j) {
+				if (!file.HasMoreLines()) {
+					complete = false;
+					break;
+				}
+				try {
+					changes.back().second.push_back(agi::make_unique<AssDialogue>(file.ReadLineFromFile()));
+				}
+				catch (SubtitleFormatParseError const&) {
+					complete = false;
+					break;
+				}
+			}
+		}
+		if (!complete) break;
+
+		for (size_t i = count; i < rows.size(); ++i)
+			delete rows[i];
+		rows.resize(std::min(count, rows.size()));
+		while (rows.size() < count) {
+			auto line = new AssDialogue;
+			subs.Events.push_back(*line);
+			rows.push_back(line);
+		}
+
+		for (auto const& change : changes) {
+			for (size_t j = 0; j < change.second.size() && change.first + j < count; ++j)
+				static_cast<AssDialogueBase&>(*rows[change.first + j]) = *change.second[j];
+		}
+	}
+
+	SubtitleFormat::GetWriter(output)->WriteFile(&subs, output, 0, "UTF-8");
+}
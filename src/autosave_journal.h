@@ -0,0 +1,72 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/fs_fwd.h>
+
+#include <boost/filesystem/path.hpp>
+#include <memory>
+#include <string>
+
+class AssFileSnapshot;
+
+/// @class AutosaveJournal
+/// @brief Autosave which only writes the lines changed since the last one
+///
+/// A full copy of the file is written when the journal is started, and again
+/// after every compact_interval entries or whenever something other than the
+/// dialogue lines changes. In between, each autosave appends the chunks of
+/// lines which changed to a journal next to the full copy, so the cost of an
+/// autosave is proportional to how much was edited.
+class AutosaveJournal {
+	agi::fs::path directory;
+	std::string name;
+
+	/// Most recent full copy of the file
+	agi::fs::path base;
+	/// Journal being appended to
+	agi::fs::path journal;
+	/// Version of the file which base plus journal currently reproduce
+	std::shared_ptr<const AssFileSnapshot> last;
+	/// Number of entries in the journal
+	int entries = 0;
+
+	void Compact(std::shared_ptr<const AssFileSnapshot> const& snapshot);
+
+public:
+	/// Number of entries appended before a new full copy is written
+	static const int compact_interval = 100;
+
+	/// Extension appended to the full copy's filename to get the journal's
+	static const char *const extension;
+
+	/// @param directory Directory to write to
+	/// @param name Name of the file being autosaved
+	AutosaveJournal(agi::fs::path directory, std::string name);
+	~AutosaveJournal();
+
+	/// Autosave a new version of the file
+	/// @return The file which was written to
+	///
+	/// Not thread-safe, but need not be called from the main thread.
+	agi::fs::path Write(std::shared_ptr<const AssFileSnapshot> const& snapshot);
+
+	/// Rebuild the newest version of a file from a journal and its full copy
+	/// @param journal Journal to replay; an incomplete final entry is ignored
+	/// @param output File to write the result to
+	static void Recover(agi::fs::path const& journal, agi::fs::path const& output);
+};
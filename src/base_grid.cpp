@@ -41,6 +41,7 @@
 #include "options.h"
 #include "project.h"
 #include "utils.h"
+#include "search_match_index.h"
 #include "selection_controller.h"
 #include "subs_controller.h"
 #include "video_controller.h"
@@ -49,6 +50,8 @@
 #include <libaegisub/util.h>
 
 #include <algorithm>
+#include <cstdlib>
+#include <iterator>
 
 #include <wx/dcbuffer.h>
 #include <wx/menu.h>
@@ -90,7 +93,8 @@ BaseGrid::BaseGrid(wxWindow* parent, agi::Context *context)
 		context->ass->AddCommitListener(&BaseGrid::OnSubtitlesCommit, this),
 
 		context->selectionController->AddActiveLineListener(&BaseGrid::OnActiveLineChanged, this),
-		context->selectionController->AddSelectionListener([&]{ Refresh(false); }),
+		context->selectionController->AddSelectionListener(&BaseGrid::OnSelectedSetChanged, this),
+		context->searchMatches->AddChangeListener([&]{ Refresh(false); }),
 
 		OPT_SUB("Subtitle/Grid/Font Face", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Subtitle/Grid/Font Size", &BaseGrid::UpdateStyle, this),
@@ -98,6 +102,7 @@ BaseGrid::BaseGrid(wxWindow* parent, agi::Context *context)
 		OPT_SUB("Colour/Subtitle Grid/Background/Background", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Colour/Subtitle Grid/Background/Comment", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Colour/Subtitle Grid/Background/Inframe", &BaseGrid::UpdateStyle, this),
+		OPT_SUB("Colour/Subtitle Grid/Background/Search Match", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Colour/Subtitle Grid/Background/Selected Comment", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Colour/Subtitle Grid/Background/Selection", &BaseGrid::UpdateStyle, this),
 		OPT_SUB("Colour/Subtitle Grid/Collision", &BaseGrid::UpdateStyle, this),
@@ -108,7 +113,11 @@ BaseGrid::BaseGrid(wxWindow* parent, agi::Context *context)
 		OPT_SUB("Colour/Subtitle Grid/Standard", &BaseGrid::UpdateStyle, this),
 
 		OPT_SUB("Subtitle/Grid/Highlight Subtitles in Frame", &BaseGrid::OnHighlightVisibleChange, this),
-		OPT_SUB("Subtitle/Grid/Hide Overrides", [&](agi::OptionValue const&) { Refresh(false); }),
+		OPT_SUB("Subtitle/Grid/Hide Overrides", [&](agi::OptionValue const&) {
+			InvalidateCells();
+			Refresh(false);
+		}),
+		OPT_SUB("Subtitle/Overlap Grouping", [&](agi::OptionValue const&) { Refresh(false); }),
 	});
 
 	Bind(wxEVT_CONTEXT_MENU, &BaseGrid::OnContextMenu, this);
@@ -126,19 +135,63 @@ BEGIN_EVENT_TABLE(BaseGrid,wxWindow)
 	EVT_MENU_RANGE(MENU_SHOW_COL,MENU_SHOW_COL+15,BaseGrid::OnShowColMenu)
 END_EVENT_TABLE()
 
-void BaseGrid::OnSubtitlesCommit(int type) {
+void BaseGrid::OnSubtitlesCommit(int type, const AssDialogue *, AssCommitChanges const& changes) {
 	if (type == AssFile::COMMIT_NEW || type & AssFile::COMMIT_ORDER || type & AssFile::COMMIT_DIAG_ADDREM)
-		UpdateMaps();
+		UpdateMaps(type == AssFile::COMMIT_NEW);
+	else if (type & (AssFile::COMMIT_DIAG_META | AssFile::COMMIT_DIAG_TIME | AssFile::COMMIT_DIAG_TEXT)) {
+		if (changes.known) {
+			for (auto line : changes.lines)
+				InvalidateCells(line);
+		}
+		else
+			InvalidateCells();
+	}
+
+	if (type & (AssFile::COMMIT_DIAG_META | AssFile::COMMIT_DIAG_TIME)) {
+		if (changes.known) {
+			GridLineChanges width_changes;
+			width_changes.changed.assign(changes.lines.begin(), changes.lines.end());
+			SetColumnWidths(&width_changes);
+		}
+		else
+			SetColumnWidths();
+	}
 
 	if (type & AssFile::COMMIT_DIAG_META) {
-		SetColumnWidths();
 		Refresh(false);
 		return;
 	}
-	if (type & AssFile::COMMIT_DIAG_TIME)
-		Refresh(false);
-	else if (type & AssFile::COMMIT_DIAG_TEXT) {
-		for (auto const& rect : text_refresh_rects)
+
+	if (!(type & (AssFile::COMMIT_DIAG_TIME | AssFile::COMMIT_DIAG_TEXT)))
+		return;
+
+	if (!changes.known) {
+		if (type & AssFile::COMMIT_DIAG_TIME)
+			Refresh(false);
+		else {
+			for (auto const& rect : text_refresh_rects)
+				RefreshRect(rect, false);
+		}
+		return;
+	}
+
+	// Only redraw the rows of the changed lines which are on screen
+	int w, h;
+	GetClientSize(&w, &h);
+	int rows = h / lineHeight + 1;
+	for (auto line : changes.lines) {
+		if (line->Row < yPos || line->Row >= yPos + rows) continue;
+		int y = (line->Row - yPos + 1) * lineHeight;
+		if (type & AssFile::COMMIT_DIAG_TIME)
+			RefreshRect(wxRect(0, y, w, lineHeight), false);
+		else {
+			for (auto const& rect : text_refresh_rects)
+				RefreshRect(wxRect(rect.x, y, rect.width, lineHeight), false);
+		}
+	}
+
+	if (type & AssFile::COMMIT_DIAG_TIME) {
+		for (auto const& rect : time_refresh_rects)
 			RefreshRect(rect, false);
 	}
 }
@@ -184,21 +237,50 @@ void BaseGrid::UpdateStyle() {
 	row_colors.Comment.SetColour(to_wx(OPT_GET("Colour/Subtitle Grid/Background/Comment")->GetColor()));
 	row_colors.Visible.SetColour(to_wx(OPT_GET("Colour/Subtitle Grid/Background/Inframe")->GetColor()));
 	row_colors.SelectedComment.SetColour(to_wx(OPT_GET("Colour/Subtitle Grid/Background/Selected Comment")->GetColor()));
+	row_colors.SearchMatch.SetColour(to_wx(OPT_GET("Colour/Subtitle Grid/Background/Search Match")->GetColor()));
 	row_colors.LeftCol.SetColour(to_wx(OPT_GET("Colour/Subtitle Grid/Left Column")->GetColor()));
 
+	// Cached centering offsets are measured in the old font
+	InvalidateCells();
 	SetColumnWidths();
 
 	AdjustScrollbar();
 	Refresh(false);
 }
 
-void BaseGrid::UpdateMaps() {
+void BaseGrid::UpdateMaps(bool new_file) {
 	index_line_map.clear();
 
 	for (auto& curdiag : context->ass->Events)
 		index_line_map.push_back(&curdiag);
 
-	SetColumnWidths();
+	// Row numbers have changed and lines may have been deleted, which would
+	// let their addresses be reused by new ones
+	InvalidateCells();
+
+	std::vector<std::pair<const AssDialogue *, int>> lines;
+	lines.reserve(index_line_map.size());
+	for (auto line : index_line_map)
+		lines.emplace_back(line, line->Id);
+	sort(begin(lines), end(lines));
+
+	if (new_file || width_lines.empty())
+		SetColumnWidths();
+	else {
+		// Comparing ids as well catches a new line reusing a removed one's address
+		std::vector<std::pair<const AssDialogue *, int>> removed, added;
+		set_difference(begin(width_lines), end(width_lines), begin(lines), end(lines), back_inserter(removed));
+		set_difference(begin(lines), end(lines), begin(width_lines), end(width_lines), back_inserter(added));
+
+		GridLineChanges changes;
+		for (auto const& line : removed)
+			changes.removed.push_back(line.first);
+		for (auto const& line : added)
+			changes.changed.push_back(line.first);
+		SetColumnWidths(&changes);
+	}
+	width_lines = std::move(lines);
+
 	AdjustScrollbar();
 	Refresh(false);
 }
@@ -214,6 +296,18 @@ void BaseGrid::OnActiveLineChanged(AssDialogue *new_active) {
 		active_row = -1;
 }
 
+void BaseGrid::OnSelectedSetChanged(Selection const& added, Selection const& removed) {
+	// Only the on-screen rows whose selection state flipped need redrawing
+	int w, h;
+	GetClientSize(&w, &h);
+	int rows = std::min<int>(h / lineHeight + 1, GetRows() - yPos);
+	for (int i = 0; i < rows; ++i) {
+		auto line = index_line_map[i + yPos];
+		if (added.count(line) || removed.count(line))
+			RefreshRect(wxRect(0, (i + 1) * lineHeight, w, lineHeight), false);
+	}
+}
+
 void BaseGrid::MakeRowVisible(int row) {
 	int h = GetClientSize().GetHeight();
 
@@ -343,9 +437,25 @@ void BaseGrid::OnPaint(wxPaintEvent &) {
 
 	const auto active_line = context->selectionController->GetActiveLine();
 	auto const& selection = context->selectionController->GetSelectedSet();
+
+	// OnSeek compares against every displayed row, not just the repainted ones
+	bool highlight_visible = OPT_GET("Subtitle/Grid/Highlight Subtitles in Frame")->GetBool();
 	visible_rows.clear();
+	if (highlight_visible) {
+		for (int i : agi::util::range(nDraw)) {
+			if (IsDisplayed(index_line_map[i + yPos]))
+				visible_rows.push_back(i + yPos);
+		}
+	}
 
-	for (int i : agi::util::range(nDraw)) {
+	// Only the rows overlapping the update region need to be drawn, which
+	// after scrolling is just the newly exposed ones. Row i covers from
+	// (i + 1) * lineHeight to its bottom border at (i + 2) * lineHeight.
+	wxRect update_box = GetUpdateRegion().GetBox();
+	const int first_row = std::max(0, update_box.GetTop() / lineHeight - 2);
+	const int last_row = std::min(nDraw, update_box.GetBottom() / lineHeight + 1);
+
+	for (int i = first_row; i < last_row; ++i) {
 		wxBrush color = row_colors.Default;
 		AssDialogue *curDiag = index_line_map[i + yPos];
 
@@ -357,11 +467,12 @@ void BaseGrid::OnPaint(wxPaintEvent &) {
 		else if (curDiag->Comment)
 			color = row_colors.Comment;
 
-		if (OPT_GET("Subtitle/Grid/Highlight Subtitles in Frame")->GetBool() && IsDisplayed(curDiag)) {
+		if (highlight_visible && std::binary_search(begin(visible_rows), end(visible_rows), i + yPos)) {
 			if (color == row_colors.Default)
 				color = row_colors.Visible;
-			visible_rows.push_back(i + yPos);
 		}
+		if ((color == row_colors.Default || color == row_colors.Visible) && context->searchMatches->Matches(curDiag))
+			color = row_colors.SearchMatch;
 		dc.SetBrush(color);
 
 		// Draw row background color
@@ -421,8 +532,9 @@ void BaseGrid::OnSize(wxSizeEvent &) {
 void BaseGrid::OnScroll(wxScrollEvent &event) {
 	int newPos = event.GetPosition();
 	if (yPos != newPos) {
+		int old_pos = yPos;
 		context->ass->Properties.scroll_position = yPos = newPos;
-		Refresh(false);
+		ScrollRows(old_pos);
 	}
 }
 
@@ -557,10 +669,32 @@ void BaseGrid::OnContextMenu(wxContextMenuEvent &evt) {
 void BaseGrid::ScrollTo(int y) {
 	int nextY = mid(0, y, GetRows() - 1);
 	if (yPos != nextY) {
+		int old_pos = yPos;
 		context->ass->Properties.scroll_position = yPos = nextY;
 		scrollBar->SetThumbPosition(yPos);
+		ScrollRows(old_pos);
+	}
+}
+
+void BaseGrid::ScrollRows(int old_pos) {
+	int w, h;
+	GetClientSize(&w, &h);
+	w -= scrollBar->GetSize().GetWidth();
+
+	int delta = old_pos - yPos;
+	if (std::abs(delta) >= h / lineHeight) {
 		Refresh(false);
+		return;
 	}
+
+	// Move the rows which are still on screen rather than repainting them,
+	// which leaves only the newly exposed rows to be painted
+	wxRect body(0, lineHeight + 1, w, h - lineHeight - 1);
+	ScrollWindow(0, delta * lineHeight, &body);
+
+	// The header's bottom border doesn't move, but the active line's border
+	// may have been drawn over it
+	RefreshRect(wxRect(0, 0, w, lineHeight + 1), false);
 }
 
 void BaseGrid::AdjustScrollbar() {
@@ -589,7 +723,7 @@ void BaseGrid::AdjustScrollbar() {
 	scrollBar->Thaw();
 }
 
-void BaseGrid::SetColumnWidths() {
+void BaseGrid::SetColumnWidths(GridLineChanges const* changes) {
 	int w, h;
 	GetClientSize(&w, &h);
 
@@ -598,6 +732,7 @@ void BaseGrid::SetColumnWidths() {
 	dc.SetFont(font);
 
 	text_refresh_rects.clear();
+	time_refresh_rects.clear();
 	int x = 0;
 
 	if (!width_helper)
@@ -605,12 +740,21 @@ void BaseGrid::SetColumnWidths() {
 	width_helper->SetDC(&dc);
 
 	for (auto const& column : columns) {
-		column->UpdateWidth(context, *width_helper);
+		if (changes)
+			column->UpdateWidth(context, *width_helper, *changes);
+		else
+			column->UpdateWidth(context, *width_helper);
 		if (column->Width() && column->RefreshOnTextChange())
 			text_refresh_rects.emplace_back(x, 0, column->Width(), h);
+		if (column->Width() && column->RefreshOnTimeChange())
+			time_refresh_rects.emplace_back(x, 0, column->Width(), h);
 		x += column->Width();
 	}
-	width_helper->Age();
+
+	// Partial updates only measure the changed lines, so aging then would
+	// throw out the widths of everything else
+	if (!changes)
+		width_helper->Age();
 }
 
 AssDialogue *BaseGrid::GetDialogue(int n) const {
@@ -618,6 +762,15 @@ AssDialogue *BaseGrid::GetDialogue(int n) const {
 	return index_line_map[n];
 }
 
+void BaseGrid::InvalidateCells(const AssDialogue *line) {
+	for (auto& column : columns) {
+		if (line)
+			column->Invalidate(line);
+		else
+			column->InvalidateAll();
+	}
+}
+
 bool BaseGrid::IsDisplayed(const AssDialogue *line) const {
 	if (!context->project->VideoProvider()) return false;
 	int frame = context->videoController->GetFrameN();
@@ -714,7 +867,18 @@ void BaseGrid::OnKeyDown(wxKeyEvent &event) {
 }
 
 void BaseGrid::SetByFrame(bool state) {
-	if (byFrame == state) return;
+	// This is also how the grid hears about the timecodes changing, which
+	// changes what frame numbers are shown even when state doesn't change
+	InvalidateCells();
+	if (byFrame == state) {
+		if (byFrame) {
+			// The frame numbers of the latest times may have changed too
+			GridLineChanges no_changes;
+			SetColumnWidths(&no_changes);
+			Refresh(false);
+		}
+		return;
+	}
 	byFrame = state;
 	for (auto& column : columns)
 		column->SetByFrame(byFrame);
@@ -38,8 +38,11 @@ namespace agi {
 	struct Context;
 	class OptionValue;
 }
+struct AssCommitChanges;
 class AssDialogue;
 class GridColumn;
+struct GridLineChanges;
+class Selection;
 class WidthHelper;
 
 class BaseGrid final : public wxWindow {
@@ -70,6 +73,8 @@ class BaseGrid final : public wxWindow {
 	std::vector<bool> columns_visible;
 
 	std::vector<wxRect> text_refresh_rects;
+	/// Columns to repaint in full whenever any line's times change
+	std::vector<wxRect> time_refresh_rects;
 
 	/// Cached brushes used for row backgrounds
 	struct {
@@ -79,11 +84,16 @@ class BaseGrid final : public wxWindow {
 		wxBrush Comment;
 		wxBrush Visible;
 		wxBrush SelectedComment;
+		wxBrush SearchMatch;
 		wxBrush LeftCol;
 	} row_colors;
 
 	std::vector<AssDialogue*> index_line_map;  ///< Row number -> dialogue line
 
+	/// Lines the column widths were last computed for and their ids, sorted
+	/// by address, for working out what was added and removed by a commit
+	std::vector<std::pair<const AssDialogue *, int>> width_lines;
+
 	/// Connection for video seek event. Stored explicitly so that it can be
 	/// blocked if the relevant option is disabled
 	agi::signal::Connection seek_listener;
@@ -100,16 +110,24 @@ class BaseGrid final : public wxWindow {
 	void OnScroll(wxScrollEvent &event);
 	void OnShowColMenu(wxCommandEvent &event);
 	void OnSize(wxSizeEvent &event);
-	void OnSubtitlesCommit(int type);
+	void OnSubtitlesCommit(int type, const AssDialogue *changed, AssCommitChanges const& changes);
 	void OnActiveLineChanged(AssDialogue *);
+	void OnSelectedSetChanged(Selection const& added, Selection const& removed);
 	void OnSeek();
 
 	void AdjustScrollbar();
-	void SetColumnWidths();
+	/// Recompute the column widths, looking at only the given lines if the
+	/// file hasn't otherwise changed since the last time
+	void SetColumnWidths(GridLineChanges const* changes = nullptr);
+	/// Repaint after yPos has changed from old_pos, scrolling the rows
+	/// which are still visible rather than repainting everything
+	void ScrollRows(int old_pos);
+	/// Discard the columns' cached values for a line, or for all lines
+	void InvalidateCells(const AssDialogue *line = nullptr);
 
 	bool IsDisplayed(const AssDialogue *line) const;
 
-	void UpdateMaps();
+	void UpdateMaps(bool new_file);
 	void UpdateStyle();
 
 	void SelectRow(int row, bool addToSelected = false, bool select=true);
@@ -0,0 +1,616 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file batch.cpp
+/// @brief Headless processing of subtitle files from the command line
+/// @ingroup main
+
+#include "batch.h"
+
+#include "ass_export_filter.h"
+#include "ass_file.h"
+#include "async_video_provider.h"
+#include "compat.h"
+#include "font_file_lister.h"
+#include "include/aegisub/subtitles_provider.h"
+#include "resolution_resampler.h"
+#include "subtitle_format.h"
+#include "subtitles_provider_libass.h"
+#include "video_frame.h"
+
+#include <libaegisub/background_runner.h>
+#include <libaegisub/charset.h>
+#include <libaegisub/exception.h>
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/format.h>
+#include <libaegisub/format_path.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/io.h>
+#include <libaegisub/make_unique.h>
+#include <libaegisub/split.h>
+#include <libaegisub/util.h>
+#include <libaegisub/vfr.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string/predicate.hpp>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <wx/app.h>
+#include <wx/image.h>
+
+namespace {
+DEFINE_EXCEPTION(BatchUsageError, agi::InvalidInputException);
+
+const char usage[] =
+	"Usage: aegisub-cli [options] files...\n"
+	"\n"
+	"Options:\n"
+	"  -o, --output DIR        Write the results to DIR rather than next to each input\n"
+	"  -f, --format EXT        Convert to the format with the file extension EXT\n"
+	"  -e, --filter NAME       Run the named export filter; may be repeated\n"
+	"  -r, --resample WxH      Resample the files to a script resolution of W by H\n"
+	"      --fps FPS|FILE      Frame rate or timecodes file for frame-based formats\n"
+	"      --charset NAME      Character set to read files with when it can't be detected\n"
+	"      --fonts             List the fonts used by each file\n"
+	"      --collect-fonts DIR Copy the fonts used by each file to DIR\n"
+	"      --video FILE        Video to render the subtitles over\n"
+	"      --render FRAMES     Render the frames FRAMES of the video with each file's\n"
+	"                          subtitles, given as a list such as 10,100-200\n"
+	"      --render-format FMT Write rendered frames as png stills or a y4m clip per\n"
+	"                          range of frames; defaults to png\n"
+	"  -j, --jobs N            Process up to N files, or render N frames, at once\n"
+	"  -h, --help              Show this message\n";
+
+struct Settings {
+	agi::fs::path output_dir;
+	/// Extension of the format to convert to, or empty to keep each file's own
+	std::string format;
+	std::vector<AssExportFilter *> filters;
+	int resample_x = 0;
+	int resample_y = 0;
+	agi::vfr::Framerate fps;
+	std::string charset;
+	bool list_fonts = false;
+	agi::fs::path fonts_dir;
+	agi::fs::path video;
+	/// Inclusive ranges of frames to render
+	std::vector<std::pair<int, int>> render;
+	bool render_y4m = false;
+	/// Number of files to process or frames to render at once, or 0 for one
+	/// per core
+	int jobs = 0;
+	bool help = false;
+	std::vector<agi::fs::path> files;
+
+	/// Is a new version of each file going to be written? Just giving an
+	/// output directory asks for a copy, unless it's for rendered frames.
+	bool Writes() const {
+		return !format.empty() || !filters.empty() || resample_x || (!output_dir.empty() && render.empty());
+	}
+};
+
+Settings ParseArgs(std::vector<std::string> const& args) {
+	Settings s;
+	for (size_t i = 1; i < args.size(); ++i) {
+		auto const& arg = args[i];
+		auto value = [&]() -> std::string const& {
+			if (i + 1 >= args.size())
+				throw BatchUsageError(arg + " needs a value");
+			return args[++i];
+		};
+
+		if (arg == "--cli")
+			continue;
+		if (arg == "-h" || arg == "--help")
+			s.help = true;
+		else if (arg == "-o" || arg == "--output")
+			s.output_dir = value();
+		else if (arg == "-f" || arg == "--format") {
+			s.format = value();
+			if (!s.format.empty() && s.format[0] == '.')
+				s.format.erase(0, 1);
+			if (s.format.empty())
+				throw BatchUsageError("No format given");
+		}
+		else if (arg == "-e" || arg == "--filter") {
+			auto const& name = value();
+			auto filter = AssExportFilterChain::GetFilter(name);
+			if (!filter)
+				throw BatchUsageError("Unknown export filter: " + name);
+			s.filters.push_back(filter);
+		}
+		else if (arg == "-r" || arg == "--resample") {
+			auto const& res = value();
+			auto x = res.find('x');
+			if (x == std::string::npos
+				|| !agi::util::try_parse(res.substr(0, x), &s.resample_x)
+				|| !agi::util::try_parse(res.substr(x + 1), &s.resample_y)
+				|| s.resample_x <= 0 || s.resample_y <= 0)
+				throw BatchUsageError("Invalid resolution: " + res);
+		}
+		else if (arg == "--fps") {
+			auto const& fps = value();
+			double cfr;
+			if (agi::util::try_parse(fps, &cfr))
+				s.fps = agi::vfr::Framerate(cfr);
+			else
+				s.fps = agi::vfr::Framerate(agi::fs::path(fps));
+		}
+		else if (arg == "--charset")
+			s.charset = value();
+		else if (arg == "--fonts")
+			s.list_fonts = true;
+		else if (arg == "--collect-fonts")
+			s.fonts_dir = value();
+		else if (arg == "--video")
+			s.video = value();
+		else if (arg == "--render") {
+			auto const& frames = value();
+			for (auto range : agi::Split(frames, ',')) {
+				auto str = agi::str(range);
+				auto dash = str.find('-');
+				int first = -1, last = -1;
+				bool valid = agi::util::try_parse(str.substr(0, dash), &first);
+				if (dash == std::string::npos)
+					last = first;
+				else
+					valid = valid && agi::util::try_parse(str.substr(dash + 1), &last);
+				if (!valid || first < 0 || last < first)
+					throw BatchUsageError("Invalid frames: " + frames);
+				s.render.emplace_back(first, last);
+			}
+		}
+		else if (arg == "--render-format") {
+			auto const& format = value();
+			if (format != "png" && format != "y4m")
+				throw BatchUsageError("Unknown render format: " + format);
+			s.render_y4m = format == "y4m";
+		}
+		else if (arg == "-j" || arg == "--jobs") {
+			auto const& jobs = value();
+			if (!agi::util::try_parse(jobs, &s.jobs) || s.jobs < 1)
+				throw BatchUsageError("Invalid number of jobs: " + jobs);
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+			throw BatchUsageError("Unknown option: " + arg);
+		else
+			s.files.emplace_back(arg);
+	}
+	return s;
+}
+
+/// Copies fonts into the collection directory, once each no matter how many
+/// of the files being processed use them
+class FontCopier {
+	agi::fs::path dir;
+	std::mutex mutex;
+	std::set<agi::fs::path> copied;
+
+public:
+	FontCopier(agi::fs::path dir) : dir(std::move(dir)) { }
+
+	void Copy(agi::fs::path const& font) {
+		if (dir.empty()) return;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (copied.insert(font).second)
+			agi::fs::Copy(font, dir/font.filename());
+	}
+};
+
+agi::fs::path OutputPath(Settings const& s, agi::fs::path const& input) {
+	auto name = input.filename();
+	if (!s.format.empty())
+		name.replace_extension("." + s.format);
+	return (s.output_dir.empty() ? input.parent_path() : s.output_dir)/name;
+}
+
+/// Process one file
+/// @param[out] subs The file's subtitles after processing
+/// @return Messages to print for the file
+std::string ProcessFile(Settings const& s, agi::fs::path const& filename, FontCopier& fonts, AssFile& subs) {
+	std::string report;
+
+	// Look for the writer first so that unwritable files fail before doing
+	// any of the work
+	const SubtitleFormat *writer = nullptr;
+	agi::fs::path output;
+	if (s.Writes()) {
+		output = OutputPath(s, filename);
+		if (output == filename)
+			throw agi::InvalidInputException("Refusing to overwrite the input file; use --output or --format");
+		writer = SubtitleFormat::GetWriter(output);
+		if (writer->NeedsUserInput())
+			throw agi::InvalidInputException(writer->GetName() + " files can only be written from the GUI");
+	}
+
+	agi::shared_read_mapping shared_file(filename);
+	auto charset = agi::charset::Detect(filename);
+	if (charset.empty()) {
+		if (s.charset.empty())
+			throw agi::InvalidInputException("Could not detect the character set; use --charset");
+		charset = s.charset;
+	}
+
+	auto reader = SubtitleFormat::GetReader(filename, charset);
+	if (reader->NeedsUserInputToRead(s.fps))
+		throw agi::InvalidInputException(reader->GetName() + " files can't be read without " + (s.fps.IsLoaded() ? "the GUI" : "--fps"));
+
+	reader->ReadFile(&subs, filename, s.fps, charset);
+
+	for (auto filter : s.filters)
+		filter->ProcessSubs(&subs);
+
+	if (s.resample_x) {
+		ResampleSettings settings{};
+		subs.GetResolution(settings.source_x, settings.source_y);
+		settings.dest_x = s.resample_x;
+		settings.dest_y = s.resample_y;
+		settings.ar_mode = ResampleARMode::Stretch;
+		settings.source_matrix = settings.dest_matrix = MatrixFromString(subs.GetScriptInfo("YCbCr Matrix"));
+		ResampleResolution(&subs, settings);
+	}
+
+	if (s.list_fonts || !s.fonts_dir.empty()) {
+		// Only the problems and the summary are worth printing; the progress
+		// messages just say what it's doing
+		FontCollector collector([&](wxString text, int level) {
+			if (level != 0)
+				report += from_wx(text);
+		});
+		auto paths = collector.GetFontPaths(&subs);
+		for (auto const& path : paths) {
+			if (s.list_fonts)
+				report += path.string() + "\n";
+			fonts.Copy(path);
+		}
+	}
+
+	if (writer) {
+		writer->ExportFile(&subs, output, s.fps, "UTF-8");
+		report += "Wrote " + output.string() + "\n";
+	}
+
+	return report;
+}
+
+/// Progress sink which prints the titles of tasks rather than showing a dialog
+class ConsoleProgressSink final : public agi::ProgressSink {
+public:
+	void SetIndeterminate() override { }
+	void SetTitle(std::string const& title) override { std::cerr << title << std::endl; }
+	void SetMessage(std::string const&) override { }
+	void SetProgress(int64_t, int64_t) override { }
+	void Log(std::string const& str) override { std::cerr << str << std::flush; }
+	bool IsCancelled() override { return false; }
+};
+
+/// Runs tasks such as indexing video on the calling thread
+class ConsoleRunner final : public agi::BackgroundRunner {
+public:
+	void Run(std::function<void(agi::ProgressSink *)> task) override {
+		ConsoleProgressSink ps;
+		task(&ps);
+	}
+};
+
+/// @brief Run work on count threads and wait for them to finish
+///
+/// There's no event loop in batch mode, so anything the workers need done on
+/// the main thread, such as libass waiting for its font cache, is run from
+/// here while waiting. work must not throw.
+void RunWorkers(size_t count, std::function<void()> const& work) {
+	std::mutex mutex;
+	std::condition_variable done;
+	size_t running = count;
+
+	std::vector<std::thread> workers;
+	workers.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		workers.emplace_back([&] {
+			work();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0)
+				done.notify_one();
+		});
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (running) {
+		lock.unlock();
+		wxTheApp->ProcessPendingEvents();
+		lock.lock();
+		done.wait_for(lock, std::chrono::milliseconds(10), [&] { return running == 0; });
+	}
+	lock.unlock();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+/// A video decoder and subtitles renderer belonging to one worker, which
+/// draws frames exactly as the video display does
+struct Renderer {
+	/// Frame and error events from the provider, which are never looked at
+	/// as GetFrame throws the errors as well
+	wxEvtHandler events;
+	std::unique_ptr<AsyncVideoProvider> video;
+	/// Colour matrix the video is currently being converted with
+	std::string matrix;
+};
+
+/// Convert a BGRA frame to planar 8-bit 4:4:4 YUV
+/// @param frame Frame to convert
+/// @param coefficients Frame with the matrix to convert with
+/// @param[out] out Y, U and V planes, one after another
+void ToYUV444(VideoFrame const& frame, VideoFrame const& coefficients, std::vector<unsigned char>& out) {
+	size_t w = frame.width, h = frame.height;
+	out.resize(w * h * 3);
+	auto y_plane = out.data(), u_plane = y_plane + w * h, v_plane = u_plane + w * h;
+
+	float kr = coefficients.kr, kb = coefficients.kb, kg = 1.f - kr - kb;
+	float y_scale = coefficients.full_range ? 255.f : 219.f;
+	float c_scale = coefficients.full_range ? 255.f : 224.f;
+	float y_offset = coefficients.full_range ? 0.f : 16.f;
+	auto to_byte = [](float v) { return static_cast<unsigned char>(std::max(0.f, std::min(v + .5f, 255.f))); };
+
+	for (size_t row = 0; row < h; ++row) {
+		auto src = &frame.data[(frame.flipped ? h - row - 1 : row) * frame.pitch];
+		for (size_t x = 0; x < w; ++x, src += 4) {
+			float b = src[0] / 255.f, g = src[1] / 255.f, r = src[2] / 255.f;
+			float luma = kr * r + kg * g + kb * b;
+			size_t i = row * w + x;
+			y_plane[i] = to_byte(y_offset + y_scale * luma);
+			u_plane[i] = to_byte(128.f + c_scale * (b - luma) / (2.f * (1.f - kb)));
+			v_plane[i] = to_byte(128.f + c_scale * (r - luma) / (2.f * (1.f - kr)));
+		}
+	}
+}
+
+std::shared_ptr<const VideoFrame> RenderFrame(AsyncVideoProvider& video, agi::vfr::Framerate const& fps, int n) {
+	auto frame = video.GetFrame(n, fps.TimeAtFrame(n));
+	if (!frame->yuv) return frame;
+
+	auto converted = std::make_shared<VideoFrame>();
+	ConvertToBGRA(*frame, nullptr, *converted);
+	return converted;
+}
+
+void WriteStill(AsyncVideoProvider& video, agi::vfr::Framerate const& fps, int n, std::string const& path) {
+	if (!GetImage(*RenderFrame(video, fps, n)).SaveFile(to_wx(path), wxBITMAP_TYPE_PNG))
+		throw agi::fs::WriteDenied(path);
+}
+
+void WriteClip(AsyncVideoProvider& video, agi::vfr::Framerate const& fps, int first, int last, std::string const& path) {
+	VideoFrame coefficients;
+	SetYUVMatrix(coefficients, video.GetColorSpace());
+
+	agi::io::Save file(path, true);
+	auto& out = file.Get();
+	std::vector<unsigned char> planes;
+	for (int n = first; n <= last; ++n) {
+		auto frame = RenderFrame(video, fps, n);
+		if (n == first) {
+			// y4m only has a single frame rate, so variable frame rate video
+			// gets its average
+			auto rate = std::lround(fps.FPS() * 1001);
+			out << "YUV4MPEG2 W" << frame->width << " H" << frame->height << " F";
+			if (rate % 1001)
+				out << rate << ":1001";
+			else
+				out << rate / 1001 << ":1";
+			out << " Ip A1:1 C444 XCOLORRANGE=" << (coefficients.full_range ? "FULL" : "LIMITED") << "\n";
+		}
+
+		ToYUV444(*frame, coefficients, planes);
+		out << "FRAME\n";
+		out.write(reinterpret_cast<const char *>(planes.data()), planes.size());
+	}
+}
+
+/// Render the requested frames of the video with a file's subtitles
+/// @return Messages to print for the file
+std::string RenderFile(Settings const& s, agi::fs::path const& filename, AssFile const& subs, std::vector<std::unique_ptr<Renderer>>& renderers) {
+	auto& first_video = *renderers[0]->video;
+	for (auto const& range : s.render) {
+		if (range.second >= first_video.GetFrameCount())
+			throw agi::InvalidInputException(agi::format("Frame %d is past the end of the video", range.second));
+	}
+	auto fps = s.fps.IsLoaded() ? s.fps : first_video.GetFPS();
+
+	auto matrix = subs.GetScriptInfo("YCbCr Matrix");
+	for (auto& renderer : renderers) {
+		if (!matrix.empty() && matrix != renderer->matrix) {
+			renderer->matrix = matrix;
+			renderer->video->SetColorSpace(matrix);
+		}
+		renderer->video->LoadSubtitles(&subs);
+	}
+
+	// Each clip has to be written in order by a single worker, while stills
+	// are split into runs of frames so that the workers mostly decode
+	// sequentially rather than seeking
+	std::vector<std::pair<int, int>> tasks;
+	for (auto const& range : s.render) {
+		int count = range.second - range.first + 1;
+		int pieces = s.render_y4m ? 1 : std::min<int>(count, renderers.size());
+		for (int i = 0; i < pieces; ++i)
+			tasks.emplace_back(range.first + count * i / pieces, range.first + count * (i + 1) / pieces - 1);
+	}
+
+	auto base = ((s.output_dir.empty() ? filename.parent_path() : s.output_dir)/filename.stem()).string();
+
+	std::atomic<size_t> next{0};
+	std::atomic<size_t> next_renderer{0};
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	RunWorkers(std::min(renderers.size(), tasks.size()), [&] {
+		auto& video = *renderers[next_renderer++]->video;
+		for (size_t i; (i = next++) < tasks.size(); ) {
+			auto const& task = tasks[i];
+			try {
+				if (s.render_y4m)
+					WriteClip(video, fps, task.first, task.second, agi::format("%s_%06d-%06d.y4m", base, task.first, task.second));
+				else {
+					for (int n = task.first; n <= task.second; ++n)
+						WriteStill(video, fps, n, agi::format("%s_%06d.png", base, n));
+				}
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+	});
+	if (error)
+		std::rethrow_exception(error);
+
+	int frames = 0;
+	for (auto const& range : s.render)
+		frames += range.second - range.first + 1;
+	return agi::format("Rendered %d frames of %s\n", frames, filename.string());
+}
+}
+
+namespace batch {
+bool IsBatchCommandLine(std::vector<std::string> const& args) {
+	if (!args.empty() && boost::ends_with(agi::fs::path(args[0]).stem().string(), "-cli"))
+		return true;
+	return args.size() > 1 && args[1] == "--cli";
+}
+
+int Run(std::vector<std::string> const& args) {
+	Settings s;
+	try {
+		s = ParseArgs(args);
+	}
+	catch (BatchUsageError const& e) {
+		std::cerr << e.GetMessage() << "\n\n" << usage;
+		return 2;
+	}
+	catch (agi::Exception const& e) {
+		std::cerr << e.GetMessage() << "\n";
+		return 2;
+	}
+
+	if (s.help) {
+		std::cout << usage << "\nExport filters:\n";
+		for (auto& filter : *AssExportFilterChain::GetFilterList())
+			std::cout << "  " << filter.GetName() << "\n";
+		return 0;
+	}
+	if (s.files.empty() || (!s.Writes() && !s.list_fonts && s.fonts_dir.empty() && s.render.empty())) {
+		std::cerr << usage;
+		return 2;
+	}
+	if (!s.render.empty() && s.video.empty()) {
+		std::cerr << "--render needs a --video to render over\n";
+		return 2;
+	}
+
+	try {
+		if (!s.output_dir.empty())
+			agi::fs::CreateDirectory(s.output_dir);
+		if (!s.fonts_dir.empty())
+			agi::fs::CreateDirectory(s.fonts_dir);
+	}
+	catch (agi::Exception const& e) {
+		std::cerr << e.GetMessage() << "\n";
+		return 1;
+	}
+
+	// The filters are shared by all of the files, so they're set up once
+	// here and then only ever run on the workers
+	for (auto filter : s.filters)
+		filter->LoadSettings(true, nullptr);
+
+	size_t jobs = s.jobs ? s.jobs : std::max(1u, std::thread::hardware_concurrency());
+
+	ConsoleRunner runner;
+	std::vector<std::unique_ptr<Renderer>> renderers;
+	if (!s.render.empty()) {
+		try {
+			libass::CacheFonts();
+			wxImage::AddHandler(new wxPNGHandler);
+
+			// Subtitles providers which fail to load are otherwise just
+			// reported with an event, leaving the frames without subtitles
+			SubtitlesProviderFactory::GetProvider(&runner);
+
+			// Opened one at a time so that only the first has to index the
+			// video, and the rest then find the index in the cache
+			for (size_t i = 0; i < jobs; ++i) {
+				auto renderer = agi::make_unique<Renderer>();
+				renderer->video = agi::make_unique<AsyncVideoProvider>(s.video, "", &renderer->events, &runner, false);
+				renderers.push_back(std::move(renderer));
+			}
+		}
+		catch (agi::Exception const& e) {
+			std::cerr << s.video.string() << ": " << e.GetMessage() << "\n";
+			return 1;
+		}
+	}
+
+	FontCopier fonts(s.fonts_dir);
+	std::atomic<int> failures{0};
+	std::mutex output_mutex;
+
+	auto process = [&](agi::fs::path const& filename) {
+		std::string report, error;
+		try {
+			AssFile subs;
+			report = ProcessFile(s, filename, fonts, subs);
+			if (!renderers.empty())
+				report += RenderFile(s, filename, subs, renderers);
+		}
+		catch (agi::Exception const& e) { error = e.GetMessage(); }
+		catch (std::exception const& e) { error = e.what(); }
+		catch (...) { error = "Unknown error"; }
+
+		std::lock_guard<std::mutex> lock(output_mutex);
+		if (error.empty())
+			std::cout << report << std::flush;
+		else {
+			std::cerr << filename.string() << ": " << error << std::endl;
+			++failures;
+		}
+	};
+
+	if (renderers.empty()) {
+		std::atomic<size_t> next{0};
+		RunWorkers(std::min(jobs, s.files.size()), [&] {
+			for (size_t i; (i = next++) < s.files.size(); )
+				process(s.files[i]);
+		});
+	}
+	else {
+		// Each file's frames are shared out between the renderers, so the
+		// files themselves are done one at a time
+		for (auto const& filename : s.files)
+			process(filename);
+	}
+
+	return failures ? 1 : 0;
+}
+}
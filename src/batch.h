@@ -0,0 +1,35 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file batch.h
+/// @see batch.cpp
+/// @ingroup main
+
+#include <string>
+#include <vector>
+
+namespace batch {
+	/// Should Aegisub be run as a command line batch processor rather than
+	/// opening a window, either due to being run as aegisub-cli or with --cli first?
+	/// @param args Command line arguments, including the program name
+	bool IsBatchCommandLine(std::vector<std::string> const& args);
+
+	/// Process the files named on the command line
+	/// @param args Command line arguments, including the program name
+	/// @return Exit code for the process
+	int Run(std::vector<std::string> const& args);
+}
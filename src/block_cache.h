@@ -33,24 +33,97 @@
 
 #pragma once
 
+#include <libaegisub/perf.h>
+
 #include <algorithm>
-#include <list>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+/// @class BlockCacheMetrics
+/// @brief Reports a cache's hits, misses and size to the performance counters
+///
+/// Every cache reporting under the same name adds to the same counters, and
+/// a cache's bytes are taken back out of the size when it is destroyed.
+class BlockCacheMetrics {
+	agi::perf::Counter *hits = nullptr;
+	agi::perf::Counter *misses = nullptr;
+	agi::perf::Gauge *bytes = nullptr;
+
+	/// Size last added to the bytes gauge
+	size_t reported = 0;
+
+public:
+	BlockCacheMetrics() = default;
+
+	/// @param name Prefix for the names of the counters
+	explicit BlockCacheMetrics(std::string const& name)
+	: hits(&agi::perf::GetCounter(name + "/hits"))
+	, misses(&agi::perf::GetCounter(name + "/misses"))
+	, bytes(&agi::perf::GetGauge(name + "/bytes"))
+	{
+	}
+
+	BlockCacheMetrics(BlockCacheMetrics&& other) { *this = std::move(other); }
+
+	BlockCacheMetrics& operator=(BlockCacheMetrics&& other)
+	{
+		if (this != &other)
+		{
+			SetSize(0);
+			hits = other.hits;
+			misses = other.misses;
+			bytes = other.bytes;
+			reported = other.reported;
+			other.bytes = nullptr;
+			other.reported = 0;
+		}
+		return *this;
+	}
+
+	~BlockCacheMetrics() { SetSize(0); }
+
+	void Hit() { if (hits) hits->Add(); }
+	void Miss() { if (misses) misses->Add(); }
+
+	/// @brief Report the current size of the cache
+	void SetSize(size_t size)
+	{
+		if (bytes) bytes->Add((int64_t)size - (int64_t)reported);
+		reported = size;
+	}
+};
+
 /// @class DataBlockCache
 /// @brief Cache for blocks of data in a stream or similar
 /// @tparam BlockT             Type of blocks to store
 /// @tparam MacroblockExponent Controls the number of blocks per macroblock, for tuning memory usage
 /// @tparam BlockFactoryT      Type of block factory, see BasicDataBlockFactory class for detail on these
+///
+/// The age of each macroblock is tracked with a list threaded through the
+/// macroblocks themselves, so using the cache never allocates anything other
+/// than the blocks and the macroblocks' block arrays.
 template <typename BlockT, int MacroblockExponent, typename BlockFactoryT>
 class DataBlockCache {
 	/// Type of an array of blocks
 	typedef std::vector<typename BlockFactoryT::BlockType> BlockArray;
 
+	/// Marks the ends of the age list
+	static const size_t npos = (size_t)-1;
+
 	struct MacroBlock {
-		/// This macroblock's position in the age list
+		/// Index of the next more recently used macroblock, or npos
+		/// Is valid iff blocks.size() > 0
+		size_t newer = npos;
+
+		/// Index of the next less recently used macroblock, or npos
 		/// Is valid iff blocks.size() > 0
-		typename std::list<MacroBlock*>::iterator position;
+		size_t older = npos;
+
+		/// Number of blocks in the macroblock which have been produced
+		size_t used = 0;
 
 		/// The blocks contained in the macroblock
 		BlockArray blocks;
@@ -62,11 +135,11 @@ class DataBlockCache {
 	/// The data in the cache
 	MacroBlockArray data;
 
-	/// Type of a list of macro blocks
-	typedef std::list<MacroBlock*> AgeList;
+	/// Most recently used macroblock, or npos if the cache is empty
+	size_t newest = npos;
 
-	/// The data sorted by how long it's been since they were used
-	AgeList age;
+	/// Least recently used macroblock, or npos if the cache is empty
+	size_t oldest = npos;
 
 	/// Number of blocks per macroblock
 	size_t macroblock_size;
@@ -80,18 +153,73 @@ class DataBlockCache {
 	/// Factory object for blocks
 	BlockFactoryT factory;
 
+	/// Performance counters to report to, if any
+	BlockCacheMetrics metrics;
+
+	/// @brief Remove a macroblock from the age list
+	/// @param mbi Index of the macroblock
+	void Unlink(size_t mbi)
+	{
+		auto &mb = data[mbi];
+		if (mb.newer != npos) data[mb.newer].older = mb.older;
+		else newest = mb.older;
+		if (mb.older != npos) data[mb.older].newer = mb.newer;
+		else oldest = mb.newer;
+		mb.newer = mb.older = npos;
+	}
+
+	/// @brief Add a macroblock to the front of the age list
+	/// @param mbi Index of the macroblock, which must not be in the list
+	void PushFront(size_t mbi)
+	{
+		auto &mb = data[mbi];
+		mb.older = newest;
+		mb.newer = npos;
+		if (newest != npos) data[newest].newer = mbi;
+		else oldest = mbi;
+		newest = mbi;
+	}
+
 	/// @brief Dispose of all blocks in a macroblock and mark it empty
-	/// @param mb_index Index of macroblock to clear
-	void KillMacroBlock(MacroBlock &mb)
+	/// @param mbi Index of macroblock to clear
+	void KillMacroBlock(size_t mbi)
 	{
+		auto &mb = data[mbi];
 		if (mb.blocks.empty())
 			return;
 
-		auto& ba = mb.blocks;
-		size -= (ba.size() - std::count(ba.begin(), ba.end(), nullptr)) * factory.GetBlockSize();
+		size -= mb.used * factory.GetBlockSize();
+		metrics.SetSize(size);
+		mb.used = 0;
+		mb.blocks.clear();
+		Unlink(mbi);
+	}
+
+	/// @brief Mark a block as recently used
+	/// @param i Index of the block
+	/// @return The storage for the block, which may be empty
+	typename BlockFactoryT::BlockType& Touch(size_t i)
+	{
+		size_t mbi = i >> MacroblockExponent;
+		assert(mbi < data.size());
+
+		auto &mb = data[mbi];
+
+		// Move this macroblock to the front of the age list
+		if (mb.blocks.empty())
+		{
+			mb.blocks.resize(macroblock_size);
+			PushFront(mbi);
+		}
+		else if (newest != mbi)
+		{
+			Unlink(mbi);
+			PushFront(mbi);
+		}
 
-		ba.clear();
-		age.erase(mb.position);
+		size_t block_index = i & macroblock_index_mask;
+		assert(block_index < mb.blocks.size());
+		return mb.blocks[block_index];
 	}
 
 public:
@@ -126,6 +254,15 @@ public:
 
 		data.resize((block_count + macroblock_size - 1) >> MacroblockExponent);
 		size = 0;
+		metrics.SetSize(size);
+	}
+
+	/// @brief Report the cache's hits, misses and size to performance counters
+	/// @param name Prefix for the counters' names, which may be shared with other caches
+	void SetMetricsName(std::string const& name)
+	{
+		metrics = BlockCacheMetrics(name);
+		metrics.SetSize(size);
 	}
 
 	/// @brief Clean up the cache
@@ -144,16 +281,17 @@ public:
 			size_t block_count = data.size();
 			data.clear();
 			data.resize(block_count);
-			age.clear();
+			newest = oldest = npos;
 			size = 0;
+			metrics.SetSize(size);
 			return;
 		}
 
 		// Remove old entries until we're under the max size
 		while (size > max_size) {
 			// When size > 0, age should never be empty
-			assert(!age.empty());
-			KillMacroBlock(**age.rbegin());
+			assert(oldest != npos);
+			KillMacroBlock(oldest);
 		}
 	}
 
@@ -164,40 +302,164 @@ public:
 	///
 	/// It is legal to pass 0 (null) for created, in this case nothing is returned in it.
 	BlockT& Get(size_t i, bool *created = nullptr)
+	{
+		auto& slot = Touch(i);
+		BlockT *b = slot.get();
+
+		if (!b)
+		{
+			slot = factory.ProduceBlock(i);
+			b = slot.get();
+			assert(b != nullptr);
+			size += factory.GetBlockSize();
+			metrics.SetSize(size);
+			++data[i >> MacroblockExponent].used;
+			metrics.Miss();
+
+			if (created) *created = true;
+		}
+		else
+		{
+			metrics.Hit();
+			if (created) *created = false;
+		}
+
+		return *b;
+	}
+
+	/// @brief Obtain a data block from the cache only if it has already been produced
+	/// @param i Index of the block to retrieve
+	/// @return A pointer to the block in cache, or nullptr if it is not in the cache
+	BlockT *Find(size_t i)
 	{
 		size_t mbi = i >> MacroblockExponent;
 		assert(mbi < data.size());
+		BlockT *block = data[mbi].blocks.empty() ? nullptr : Touch(i).get();
+		if (block) metrics.Hit();
+		else metrics.Miss();
+		return block;
+	}
 
-		auto &mb = data[mbi];
+	/// @brief Store a block which was produced outside of the cache
+	/// @param i     Index of the block to store
+	/// @param block The block, which replaces any block already stored at i
+	void Insert(size_t i, typename BlockFactoryT::BlockType block)
+	{
+		assert(block);
+		auto& slot = Touch(i);
+		if (!slot)
+		{
+			size += factory.GetBlockSize();
+			metrics.SetSize(size);
+			++data[i >> MacroblockExponent].used;
+		}
+		slot = std::move(block);
+	}
+};
 
-		// Move this macroblock to the front of the age list
-		if (mb.blocks.empty())
+/// @class ShardedDataBlockCache
+/// @brief DataBlockCache which can be used from several threads at once
+/// @tparam ShardBits Binary logarithm of the number of independently locked shards
+///
+/// Macroblocks are spread over the shards round-robin, so that threads
+/// working on nearby blocks rarely wait for each other. As a block could be
+/// aged out by another thread at any time, blocks are only ever accessed
+/// while their shard is locked, by the function passed to Find.
+///
+/// Blocks are produced outside of the cache and stored with Insert, so the
+/// factory is only used for its block size.
+template <typename BlockT, int MacroblockExponent, typename BlockFactoryT, int ShardBits = 3>
+class ShardedDataBlockCache {
+	typedef DataBlockCache<BlockT, MacroblockExponent, BlockFactoryT> Cache;
+
+	struct Shard {
+		std::mutex mutex;
+		Cache cache;
+
+		Shard(size_t block_count, BlockFactoryT const& factory)
+		: cache(block_count, factory)
 		{
-			mb.blocks.resize(macroblock_size);
-			age.push_front(&mb);
 		}
-		else if (mb.position != begin(age))
-			age.splice(begin(age), age, mb.position);
+	};
 
-		mb.position = age.begin();
+	static const size_t shard_count = (size_t)1 << ShardBits;
 
-		size_t block_index = i & macroblock_index_mask;
-		assert(block_index < mb.blocks.size());
+	std::vector<std::unique_ptr<Shard>> shards;
 
-		BlockT *b = mb.blocks[block_index].get();
+	Shard &ShardFor(size_t i)
+	{
+		return *shards[(i >> MacroblockExponent) & (shard_count - 1)];
+	}
 
-		if (!b)
+	/// Index of block i within its shard
+	static size_t LocalIndex(size_t i)
+	{
+		const size_t mask = ((size_t)1 << MacroblockExponent) - 1;
+		return (((i >> MacroblockExponent) >> ShardBits) << MacroblockExponent) | (i & mask);
+	}
+
+public:
+	/// @brief Constructor
+	/// @param block_count Total number of blocks the cache will manage
+	/// @param factory     Factory object to use for producing blocks
+	///
+	/// Each shard gets its own copy of the factory.
+	ShardedDataBlockCache(size_t block_count, BlockFactoryT factory = BlockFactoryT())
+	{
+		size_t macroblocks = (block_count + ((size_t)1 << MacroblockExponent) - 1) >> MacroblockExponent;
+		size_t shard_blocks = ((macroblocks + shard_count - 1) >> ShardBits) << MacroblockExponent;
+
+		shards.reserve(shard_count);
+		for (size_t i = 0; i < shard_count; ++i)
+			shards.emplace_back(new Shard(shard_blocks, factory));
+	}
+
+	/// @brief Report every shard's hits, misses and size under one name
+	/// @param name Prefix for the counters' names
+	void SetMetricsName(std::string const& name)
+	{
+		for (auto& shard : shards)
 		{
-			mb.blocks[block_index] = factory.ProduceBlock(i);
-			b = mb.blocks[block_index].get();
-			assert(b != nullptr);
-			size += factory.GetBlockSize();
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			shard->cache.SetMetricsName(name);
+		}
+	}
 
-			if (created) *created = true;
+	/// @brief Clean up the cache
+	/// @param max_size Target maximum size of the whole cache in bytes
+	void Age(size_t max_size)
+	{
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			shard->cache.Age(max_size / shard_count);
 		}
-		else
-			if (created) *created = false;
+	}
 
-		return *b;
+	/// @brief Use a data block if it has already been produced
+	/// @param i   Index of the block to retrieve
+	/// @param use Function called with the block while it is locked
+	/// @return Whether the block was in the cache
+	template<typename Func>
+	bool Find(size_t i, Func&& use)
+	{
+		auto& shard = ShardFor(i);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if (BlockT *block = shard.cache.Find(LocalIndex(i)))
+		{
+			use(*block);
+			return true;
+		}
+		return false;
+	}
+
+	/// @brief Store a block which was produced outside of the cache
+	/// @param i     Index of the block to store
+	/// @param block The block, which replaces any block already stored at i
+	void Insert(size_t i, typename BlockFactoryT::BlockType block)
+	{
+		auto& shard = ShardFor(i);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.cache.Insert(LocalIndex(i), std::move(block));
 	}
 };
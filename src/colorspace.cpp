@@ -345,3 +345,48 @@ void hsl_to_hsv(int iH, int iS, int iL, unsigned char *oH, unsigned char *oS, un
 		*oS = 2 * 255 * iS * (255 - iL) / (iL*255 + iS*255 - iL*iS);
 	}
 }
+
+// The row functions below are used to generate whole spectrum images at a
+// time, so they're written as straight-line integer loops (all values are
+// non-negative, so shifts are exact divisions by 256) which the compiler can
+// turn into SIMD code.
+
+void rgb_ramp_row(unsigned char r, unsigned char g, unsigned char b, int ramp, unsigned char *rgb)
+{
+	unsigned char fixed[3] = {r, g, b};
+	for (int i = 0; i < 256; ++i) {
+		rgb[i * 3 + 0] = fixed[0];
+		rgb[i * 3 + 1] = fixed[1];
+		rgb[i * 3 + 2] = fixed[2];
+	}
+	for (int i = 0; i < 256; ++i)
+		rgb[i * 3 + ramp] = i;
+}
+
+void hsl_saturation_row(int H, int L, unsigned char *rgb)
+{
+	unsigned char maxr, maxg, maxb;
+	hsl_to_rgb(H, 255, L, &maxr, &maxg, &maxb);
+
+	for (int s = 0; s < 256; ++s) {
+		int grey = ((255 - s) * L) >> 8;
+		rgb[s * 3 + 0] = ((maxr * s) >> 8) + grey;
+		rgb[s * 3 + 1] = ((maxg * s) >> 8) + grey;
+		rgb[s * 3 + 2] = ((maxb * s) >> 8) + grey;
+	}
+}
+
+void hsv_saturation_row(int H, int V, unsigned char *rgb)
+{
+	unsigned char maxr, maxg, maxb;
+	hsv_to_rgb(H, 255, 255, &maxr, &maxg, &maxb);
+
+	int rr = (255 - maxr) * V >> 8;
+	int rg = (255 - maxg) * V >> 8;
+	int rb = (255 - maxb) * V >> 8;
+	for (int s = 0; s < 256; ++s) {
+		rgb[s * 3 + 0] = V - ((rr * s) >> 8);
+		rgb[s * 3 + 1] = V - ((rg * s) >> 8);
+		rgb[s * 3 + 2] = V - ((rb * s) >> 8);
+	}
+}
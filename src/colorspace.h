@@ -47,3 +47,15 @@ void rgb_to_hsv(int R, int G, int B, unsigned char *H, unsigned char *S, unsigne
 void hsv_to_hsl(int iH, int iS, int iV, unsigned char *oH, unsigned char *oS, unsigned char *oL);
 
 void hsl_to_hsv(int iH, int iS, int iL, unsigned char *oH, unsigned char *oS, unsigned char *oV);
+
+/// Fill 256 RGB pixels with a colour whose component `ramp` (0 = R, 1 = G,
+/// 2 = B) runs from 0 to 255 and whose other components are taken from r, g, b
+void rgb_ramp_row(unsigned char r, unsigned char g, unsigned char b, int ramp, unsigned char *rgb);
+
+/// Fill 256 RGB pixels with hue H and lightness L at saturations 0..255,
+/// approximated by blending the fully saturated colour with grey
+void hsl_saturation_row(int H, int L, unsigned char *rgb);
+
+/// Fill 256 RGB pixels with hue H and value V at saturations 0..255,
+/// approximated by blending the fully saturated colour with grey
+void hsv_saturation_row(int H, int V, unsigned char *rgb);
@@ -33,8 +33,10 @@
 
 #include "command.h"
 
+#include <libaegisub/io.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
+#include <libaegisub/trace.h>
 
 #include "../compat.h"
 #include "../dialog_detached_video.h"
@@ -187,6 +189,47 @@ struct app_log final : public Command {
 	}
 };
 
+struct app_perf final : public Command {
+	CMD_NAME("app/perf")
+	STR_MENU("&Performance counters")
+	STR_DISP("Performance counters")
+	STR_HELP("View the cache, queue and undo performance counters")
+
+	void operator()(agi::Context *c) override {
+		ShowPerfWindow(c);
+	}
+};
+
+struct app_trace final : public Command {
+	CMD_NAME("app/trace")
+	STR_MENU("&Record trace")
+	STR_DISP("Record trace")
+	STR_HELP("Record which tasks run on which threads, to be saved for a trace viewer")
+	CMD_TYPE(COMMAND_TOGGLE)
+
+	bool IsActive(const agi::Context *) override {
+		return agi::trace::IsEnabled();
+	}
+
+	void operator()(agi::Context *) override {
+		agi::trace::SetEnabled(!agi::trace::IsEnabled());
+	}
+};
+
+struct app_trace_save final : public Command {
+	CMD_NAME("app/trace/save")
+	STR_MENU("&Save trace...")
+	STR_DISP("Save trace")
+	STR_HELP("Save the most recently recorded tasks as Chrome trace-event JSON")
+
+	void operator()(agi::Context *c) override {
+		auto filename = SaveFileSelector(_("Save trace"), "", "aegisub-trace.json", "json", "JSON files (*.json)|*.json", c->parent);
+		if (filename.empty()) return;
+
+		agi::trace::Write(agi::io::Save(filename).Get());
+	}
+};
+
 struct app_new_window final : public Command {
 	CMD_NAME("app/new_window")
 	CMD_ICON(new_window_menu)
@@ -314,6 +357,9 @@ namespace cmd {
 		reg(agi::make_unique<app_log>());
 		reg(agi::make_unique<app_new_window>());
 		reg(agi::make_unique<app_options>());
+		reg(agi::make_unique<app_perf>());
+		reg(agi::make_unique<app_trace>());
+		reg(agi::make_unique<app_trace_save>());
 		reg(agi::make_unique<app_toggle_global_hotkeys>());
 		reg(agi::make_unique<app_toggle_toolbar>());
 #ifdef __WXMAC__
@@ -38,6 +38,7 @@
 #include "../audio_karaoke.h"
 #include "../audio_timing.h"
 #include "../compat.h"
+#include "../dialog_progress.h"
 #include "../include/aegisub/context.h"
 #include "../libresrc/libresrc.h"
 #include "../options.h"
@@ -184,7 +185,15 @@ struct audio_save_clip final : public Command {
 			end = std::max(end, line->End);
 		}
 
-		agi::SaveAudioClip(*c->project->AudioProvider(), filename, start, end);
+		// Written on a background thread so that long clips don't freeze the UI
+		auto provider = c->project->AudioProvider();
+		DialogProgress progress(c->parent, _("Save audio clip"), _("Writing audio clip..."));
+		try {
+			progress.Run([&](agi::ProgressSink *ps) {
+				agi::SaveAudioClip(*provider, filename, start, end, ps);
+			});
+		}
+		catch (agi::UserCancelException const&) { }
 	}
 };
 
@@ -14,8 +14,10 @@
 
 #include "command.h"
 
+#include "../ass_file.h"
 #include "../compat.h"
 #include "../format.h"
+#include "../include/aegisub/context.h"
 
 #include <libaegisub/log.h>
 
@@ -46,6 +48,7 @@ namespace cmd {
 
 	void call(std::string const& name, agi::Context*c) {
 		Command &cmd = *find_command(name)->second;
+		c->ass->FlushPendingCommits();
 		if (cmd.Validate(c))
 			cmd(c);
 	}
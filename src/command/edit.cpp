@@ -51,6 +51,7 @@
 #include "../video_controller.h"
 
 #include <libaegisub/address_of_adaptor.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/of_type_adaptor.h>
 #include <libaegisub/make_unique.h>
 
@@ -94,48 +95,82 @@ struct validate_sel_multiple : public Command {
 	}
 };
 
+/// Fewest pasted lines worth parsing on a separate thread
+const size_t min_paste_lines_per_chunk = 1024;
+
 template<typename String>
 AssDialogue *get_dialogue(String data) {
 	boost::trim(data);
-	try {
-		// Try to interpret the line as an ASS line
-		return new AssDialogue(data);
+	// Text which isn't a dialogue line at all is common, so don't go through
+	// an exception for every line of it
+	if (boost::starts_with(data, "Dialogue:") || boost::starts_with(data, "Comment:")) {
+		try {
+			// Try to interpret the line as an ASS line
+			return new AssDialogue(data);
+		}
+		catch (...) { }
 	}
-	catch (...) {
-		// Line didn't parse correctly, assume it's plain text that
-		// should be pasted in the Text field only
-		auto d = new AssDialogue;
-		d->End = 0;
-		d->Text = data;
-		return d;
+
+	// Line didn't parse correctly, assume it's plain text that
+	// should be pasted in the Text field only
+	auto d = new AssDialogue;
+	d->End = 0;
+	d->Text = data;
+	return d;
+}
+
+/// Parse each line of the clipboard contents with parse, in parallel chunks
+/// for big pastes; if parse throws, the first exception is rethrown
+template<typename Parser>
+std::vector<std::unique_ptr<AssDialogue>> parse_clipboard(std::string const& data, Parser parse) {
+	std::vector<std::string> rows;
+	boost::char_separator<char> sep("\r\n");
+	for (auto const& row : boost::tokenizer<boost::char_separator<char>>(data, sep))
+		rows.push_back(row);
+
+	std::vector<std::unique_ptr<AssDialogue>> lines(rows.size());
+	agi::dispatch::ParallelFor(0, rows.size(), min_paste_lines_per_chunk, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			lines[i].reset(parse(std::move(rows[i])));
+	});
+	return lines;
+}
+
+/// Insert pasted lines before pos in one splice and commit, and select them
+void insert_lines(agi::Context *c, EntryList<AssDialogue>::iterator pos, std::vector<std::unique_ptr<AssDialogue>> lines) {
+	if (lines.empty()) return;
+
+	EntryList<AssDialogue> pasted;
+	Selection new_selection;
+	new_selection.reserve(lines.size());
+	for (auto& line : lines) {
+		new_selection.insert(line.get());
+		pasted.push_back(*line.release());
 	}
+
+	AssDialogue *new_active = &pasted.front();
+	c->ass->Events.splice(pos, pasted);
+	c->ass->Commit(_("paste"), AssFile::COMMIT_DIAG_ADDREM);
+	c->selectionController->SetSelectionAndActive(std::move(new_selection), new_active);
 }
 
+/// Paste the lines of the clipboard over existing lines
+/// @param paste_line Function which pastes a line and returns the line it was
+///                   pasted over, or nullptr to stop
 template<typename Paster>
-void paste_lines(agi::Context *c, bool paste_over, Paster&& paste_line) {
+void paste_lines_over(agi::Context *c, Paster&& paste_line) {
 	std::string data = GetClipboard();
 	if (data.empty()) return;
 
-	AssDialogue *first = nullptr;
-	Selection newsel;
-
-	boost::char_separator<char> sep("\r\n");
-	for (auto curdata : boost::tokenizer<boost::char_separator<char>>(data, sep)) {
-		AssDialogue *inserted = paste_line(get_dialogue(curdata));
-		if (!inserted)
+	bool pasted = false;
+	for (auto& line : parse_clipboard(data, get_dialogue<std::string>)) {
+		if (!paste_line(line.get()))
 			break;
-
-		newsel.insert(inserted);
-		if (!first)
-			first = inserted;
+		pasted = true;
 	}
 
-	if (first) {
-		c->ass->Commit(_("paste"), paste_over ? AssFile::COMMIT_DIAG_FULL : AssFile::COMMIT_DIAG_ADDREM);
-
-		if (!paste_over)
-			c->selectionController->SetSelectionAndActive(std::move(newsel), first);
-	}
+	if (pasted)
+		c->ass->Commit(_("paste"), AssFile::COMMIT_DIAG_FULL);
 }
 
 AssDialogue *paste_over(wxWindow *parent, std::vector<bool>& pasteOverOptions, AssDialogue *new_line, AssDialogue *old_line) {
@@ -167,9 +202,11 @@ struct parsed_line {
 	parsed_line(parsed_line&& r) = default;
 
 	const AssOverrideTag *find_tag(int blockn, std::string const& tag_name, std::string const& alt) const {
+		auto id = AssOverrideTag::IdFromName(tag_name);
+		auto alt_id = AssOverrideTag::IdFromName(alt);
 		for (auto ovr : blocks | sliced(0, blockn + 1) | reversed | agi::of_type<AssDialogueBlockOverride>()) {
 			for (auto const& tag : ovr->Tags | reversed) {
-				if (tag.Name == tag_name || tag.Name == alt)
+				if (tag.Id != AssTagId::UNKNOWN && (tag.Id == id || tag.Id == alt_id))
 					return &tag;
 			}
 		}
@@ -247,13 +284,13 @@ struct parsed_line {
 			blocks = line->ParseTags();
 		}
 		else if (ovr) {
-			std::string alt;
-			if (tag == "\\c") alt = "\\1c";
+			auto id = AssOverrideTag::IdFromName(tag);
+			auto alt_id = id == AssTagId::COLOR ? AssTagId::COLOR1 : AssTagId::UNKNOWN;
 			// Remove old of same
 			bool found = false;
 			for (size_t i = 0; i < ovr->Tags.size(); i++) {
-				std::string const& name = ovr->Tags[i].Name;
-				if (tag == name || alt == name) {
+				auto tag_id = ovr->Tags[i].Id;
+				if (tag_id != AssTagId::UNKNOWN && (tag_id == id || tag_id == alt_id)) {
 					shift -= ((std::string)ovr->Tags[i]).size();
 					if (found) {
 						ovr->Tags.erase(ovr->Tags.begin() + i);
@@ -819,29 +856,18 @@ static bool try_paste_lines(agi::Context *c) {
 	boost::trim_left(data);
 	if (!boost::starts_with(data, "Dialogue:")) return false;
 
-	EntryList<AssDialogue> parsed;
-	boost::char_separator<char> sep("\r\n");
-	for (auto curdata : boost::tokenizer<boost::char_separator<char>>(data, sep)) {
-		boost::trim(curdata);
-		try {
-			parsed.push_back(*new AssDialogue(curdata));
-		}
-		catch (...) {
-			parsed.clear_and_dispose([](AssDialogue *e) { delete e; });
-			return false;
-		}
+	std::vector<std::unique_ptr<AssDialogue>> lines;
+	try {
+		lines = parse_clipboard(data, [](std::string line) {
+			boost::trim(line);
+			return new AssDialogue(line);
+		});
+	}
+	catch (...) {
+		return false;
 	}
 
-	AssDialogue *new_active = &*parsed.begin();
-	Selection new_selection;
-	for (auto& line : parsed)
-		new_selection.insert(&line);
-
-	auto pos = c->ass->iterator_to(*c->selectionController->GetActiveLine());
-	c->ass->Events.splice(pos, parsed, parsed.begin(), parsed.end());
-	c->ass->Commit(_("paste"), AssFile::COMMIT_DIAG_ADDREM);
-	c->selectionController->SetSelectionAndActive(std::move(new_selection), new_active);
-
+	insert_lines(c, c->ass->iterator_to(*c->selectionController->GetActiveLine()), std::move(lines));
 	return true;
 }
 
@@ -868,11 +894,10 @@ struct edit_line_paste final : public Command {
 				ctrl->Paste();
 		}
 		else {
-			auto pos = c->ass->iterator_to(*c->selectionController->GetActiveLine());
-			paste_lines(c, false, [=](AssDialogue *new_line) -> AssDialogue * {
-				c->ass->Events.insert(pos, *new_line);
-				return new_line;
-			});
+			std::string data = GetClipboard();
+			if (data.empty()) return;
+			insert_lines(c, c->ass->iterator_to(*c->selectionController->GetActiveLine()),
+				parse_clipboard(data, get_dialogue<std::string>));
 		}
 	}
 };
@@ -901,8 +926,7 @@ struct edit_line_paste_over final : public Command {
 		if (sel.size() < 2) {
 			auto pos = c->ass->iterator_to(*c->selectionController->GetActiveLine());
 
-			paste_lines(c, true, [&](AssDialogue *new_line) -> AssDialogue * {
-				std::unique_ptr<AssDialogue> deleter(new_line);
+			paste_lines_over(c, [&](AssDialogue *new_line) -> AssDialogue * {
 				if (pos == c->ass->Events.end()) return nullptr;
 
 				AssDialogue *ret = paste_over(c->parent, pasteOverOptions, new_line, &*pos);
@@ -915,8 +939,7 @@ struct edit_line_paste_over final : public Command {
 			// Multiple lines selected, so paste over the selection
 			auto sorted_selection = c->selectionController->GetSortedSelection();
 			auto pos = begin(sorted_selection);
-			paste_lines(c, true, [&](AssDialogue *new_line) -> AssDialogue * {
-				std::unique_ptr<AssDialogue> deleter(new_line);
+			paste_lines_over(c, [&](AssDialogue *new_line) -> AssDialogue * {
 				if (pos == end(sorted_selection)) return nullptr;
 
 				AssDialogue *ret = paste_over(c->parent, pasteOverOptions, new_line, *pos);
@@ -1024,9 +1047,9 @@ struct edit_line_recombine final : public validate_sel_multiple {
 		}
 
 		// Remove now non-existent lines from the selection
-		Selection lines, new_sel;
-		boost::copy(c->ass->Events | agi::address_of, inserter(lines, lines.begin()));
-		boost::set_intersection(lines, sel_set, inserter(new_sel, new_sel.begin()));
+		auto events = c->ass->Events | agi::address_of;
+		Selection lines(boost::begin(events), boost::end(events));
+		auto new_sel = lines.Intersection(sel_set);
 
 		if (new_sel.empty())
 			new_sel.insert(*lines.begin());
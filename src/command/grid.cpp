@@ -33,6 +33,7 @@
 
 #include "../ass_dialogue.h"
 #include "../ass_file.h"
+#include "../ass_overlaps.h"
 #include "../audio_controller.h"
 #include "../audio_timing.h"
 #include "../frame_main.h"
@@ -85,6 +86,46 @@ struct grid_line_next_create final : public Command {
 	}
 };
 
+/// Make the first line in [begin, end) which overlaps another line active
+template<typename Iterator>
+void select_overlap(agi::Context *c, Iterator begin, Iterator end) {
+	auto group = static_cast<OverlapGroup>(OPT_GET("Subtitle/Overlap Grouping")->GetInt());
+	for (auto it = begin; it != end; ++it) {
+		if (c->ass->IsOverlapping(&*it, group)) {
+			c->selectionController->SetSelectionAndActive({&*it}, &*it);
+			return;
+		}
+	}
+}
+
+struct grid_line_next_overlap final : public Command {
+	CMD_NAME("grid/line/next/overlap")
+	STR_MENU("Next Overlapping Line")
+	STR_DISP("Next Overlapping Line")
+	STR_HELP("Move to the next line which overlaps another line")
+
+	void operator()(agi::Context *c) override {
+		auto it = c->ass->Events.begin();
+		if (auto active = c->selectionController->GetActiveLine())
+			it = ++c->ass->iterator_to(*active);
+		select_overlap(c, it, c->ass->Events.end());
+	}
+};
+
+struct grid_line_prev_overlap final : public Command {
+	CMD_NAME("grid/line/prev/overlap")
+	STR_MENU("Previous Overlapping Line")
+	STR_DISP("Previous Overlapping Line")
+	STR_HELP("Move to the previous line which overlaps another line")
+
+	void operator()(agi::Context *c) override {
+		auto it = c->ass->Events.end();
+		if (auto active = c->selectionController->GetActiveLine())
+			it = c->ass->iterator_to(*active);
+		select_overlap(c, EntryList<AssDialogue>::reverse_iterator(it), c->ass->Events.rend());
+	}
+};
+
 struct grid_line_prev final : public Command {
 	CMD_NAME("grid/line/prev")
 	STR_MENU("Previous Line")
@@ -404,7 +445,9 @@ namespace cmd {
 	void init_grid() {
 		reg(agi::make_unique<grid_line_next>());
 		reg(agi::make_unique<grid_line_next_create>());
+		reg(agi::make_unique<grid_line_next_overlap>());
 		reg(agi::make_unique<grid_line_prev>());
+		reg(agi::make_unique<grid_line_prev_overlap>());
 		reg(agi::make_unique<grid_sort_actor>());
 		reg(agi::make_unique<grid_sort_effect>());
 		reg(agi::make_unique<grid_sort_end>());
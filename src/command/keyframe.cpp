@@ -73,7 +73,7 @@ struct keyframe_open final : public Command {
 			_("Open keyframes file"),
 			"Path/Last/Keyframes", "" ,".txt",
 			from_wx(_("All Supported Formats") +
-				" (*.txt, *.pass, *.stats, *.log)|*.txt;*.pass;*.stats;*.log|" +
+				" (*.txt, *.pass, *.stats, *.log, *.mkv, *.webm)|*.txt;*.pass;*.stats;*.log;*.mkv;*.webm|" +
 				_("All Files") + " (*.*)|*.*"),
 			c->parent);
 
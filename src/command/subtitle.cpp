@@ -33,6 +33,7 @@
 
 #include "../ass_dialogue.h"
 #include "../ass_file.h"
+#include "../ass_overlaps.h"
 #include "../compat.h"
 #include "../dialog_search_replace.h"
 #include "../dialogs.h"
@@ -53,7 +54,8 @@
 #include <libaegisub/charset_conv.h>
 #include <libaegisub/make_unique.h>
 
-#include <boost/range/algorithm/copy.hpp>
+#include <boost/range/begin.hpp>
+#include <boost/range/end.hpp>
 #include <wx/msgdlg.h>
 #include <wx/choicdlg.h>
 
@@ -352,7 +354,7 @@ static void save_subtitles(agi::Context *c, agi::fs::path filename) {
 	}
 
 	try {
-		c->subsController->Save(filename);
+		c->subsController->SaveInBackground(filename);
 	}
 	catch (const agi::Exception& err) {
 		wxMessageBox(to_wx(err.GetMessage()), "Error", wxOK | wxICON_ERROR | wxCENTER, c->parent);
@@ -398,9 +400,30 @@ struct subtitle_select_all final : public Command {
 	STR_HELP("Select all dialogue lines")
 
 	void operator()(agi::Context *c) override {
-		Selection sel;
-		boost::copy(c->ass->Events | agi::address_of, inserter(sel, sel.end()));
-		c->selectionController->SetSelectedSet(std::move(sel));
+		auto events = c->ass->Events | agi::address_of;
+		c->selectionController->SetSelectedSet(Selection(boost::begin(events), boost::end(events)));
+	}
+};
+
+struct subtitle_select_overlaps final : public Command {
+	CMD_NAME("subtitle/select/overlaps")
+	STR_MENU("Select &Overlapping")
+	STR_DISP("Select Overlapping")
+	STR_HELP("Select all dialogue lines which overlap another non-comment line")
+
+	void operator()(agi::Context *c) override {
+		auto group = static_cast<OverlapGroup>(OPT_GET("Subtitle/Overlap Grouping")->GetInt());
+
+		Selection new_selection;
+		for (auto& diag : c->ass->Events) {
+			if (c->ass->IsOverlapping(&diag, group)) {
+				if (new_selection.empty())
+					c->selectionController->SetActiveLine(&diag);
+				new_selection.insert(&diag);
+			}
+		}
+
+		c->selectionController->SetSelectedSet(std::move(new_selection));
 	}
 };
 
@@ -418,14 +441,25 @@ struct subtitle_select_visible final : public Command {
 		Selection new_selection;
 		int frame = c->videoController->GetFrameN();
 
+		std::vector<int> starts, ends;
+		starts.reserve(c->ass->Events.size());
+		ends.reserve(c->ass->Events.size());
+		for (auto const& diag : c->ass->Events) {
+			starts.push_back(diag.Start);
+			ends.push_back(diag.End);
+		}
+		auto const& fps = c->project->Timecodes();
+		starts = fps.FramesAtTimes(starts, agi::vfr::START);
+		ends = fps.FramesAtTimes(ends, agi::vfr::END);
+
+		size_t i = 0;
 		for (auto& diag : c->ass->Events) {
-			if (c->videoController->FrameAtTime(diag.Start, agi::vfr::START) <= frame &&
-				c->videoController->FrameAtTime(diag.End, agi::vfr::END) >= frame)
-			{
+			if (starts[i] <= frame && ends[i] >= frame) {
 				if (new_selection.empty())
 					c->selectionController->SetActiveLine(&diag);
 				new_selection.insert(&diag);
 			}
+			++i;
 		}
 
 		c->selectionController->SetSelectedSet(std::move(new_selection));
@@ -469,6 +503,7 @@ namespace cmd {
 		reg(agi::make_unique<subtitle_save>());
 		reg(agi::make_unique<subtitle_save_as>());
 		reg(agi::make_unique<subtitle_select_all>());
+		reg(agi::make_unique<subtitle_select_overlaps>());
 		reg(agi::make_unique<subtitle_select_visible>());
 		reg(agi::make_unique<subtitle_spellcheck>());
 	}
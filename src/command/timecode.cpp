@@ -71,7 +71,7 @@ struct timecode_open final : public Command {
 	STR_HELP("Open a VFR timecodes v1 or v2 file")
 
 	void operator()(agi::Context *c) override {
-		auto str = from_wx(_("All Supported Formats") + " (*.txt)|*.txt|" + _("All Files") + " (*.*)|*.*");
+		auto str = from_wx(_("All Supported Formats") + " (*.txt, *.mkv, *.webm)|*.txt;*.mkv;*.webm|" + _("All Files") + " (*.*)|*.*");
 		auto filename = OpenFileSelector(_("Open Timecodes File"), "Path/Last/Timecodes", "", "", str, c->parent);
 		if (!filename.empty())
 			c->project->LoadTimecodes(filename);
@@ -644,6 +644,42 @@ struct video_show_overscan final : public validator_video_loaded {
 	}
 };
 
+struct video_show_timings final : public validator_video_loaded {
+	CMD_NAME("video/show_timings")
+	STR_MENU("Show Frame &Timings")
+	STR_DISP("Show Frame Timings")
+	STR_HELP("Show how long decoding, rendering subtitles, blending and uploading recent frames took")
+	CMD_TYPE(COMMAND_VALIDATE | COMMAND_TOGGLE)
+
+	bool IsActive(const agi::Context *) override {
+		return OPT_GET("Video/Show Timings")->GetBool();
+	}
+
+	void operator()(agi::Context *c) override {
+		OPT_SET("Video/Show Timings")->SetBool(!OPT_GET("Video/Show Timings")->GetBool());
+		c->videoDisplay->Render();
+	}
+};
+
+struct video_timings_export final : public Command {
+	CMD_NAME("video/timings/export")
+	STR_MENU("Export Frame Timings...")
+	STR_DISP("Export Frame Timings")
+	STR_HELP("Save how long each stage of drawing the most recently displayed frames took to a CSV file")
+	CMD_TYPE(COMMAND_VALIDATE)
+
+	bool Validate(const agi::Context *c) override {
+		return c->videoDisplay->GetFrameTimings().size() > 0;
+	}
+
+	void operator()(agi::Context *c) override {
+		auto filename = SaveFileSelector(_("Save frame timings"), "", "timings.csv", "csv", "CSV files (*.csv)|*.csv", c->parent);
+		if (filename.empty()) return;
+
+		c->videoDisplay->GetFrameTimings().WriteCSV(filename);
+	}
+};
+
 class video_zoom_100: public validator_video_attached {
 public:
 	CMD_NAME("video/zoom/100")
@@ -770,7 +806,9 @@ namespace cmd {
 		reg(agi::make_unique<video_play>());
 		reg(agi::make_unique<video_play_line>());
 		reg(agi::make_unique<video_show_overscan>());
+		reg(agi::make_unique<video_show_timings>());
 		reg(agi::make_unique<video_stop>());
+		reg(agi::make_unique<video_timings_export>());
 		reg(agi::make_unique<video_zoom_100>());
 		reg(agi::make_unique<video_zoom_200>());
 		reg(agi::make_unique<video_zoom_50>());
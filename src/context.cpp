@@ -23,6 +23,7 @@
 #include "initial_line_state.h"
 #include "options.h"
 #include "project.h"
+#include "search_match_index.h"
 #include "search_replace_engine.h"
 #include "selection_controller.h"
 #include "subs_controller.h"
@@ -44,6 +45,7 @@ Context::Context()
 , audioController(make_unique<AudioController>(this))
 , initialLineState(make_unique<InitialLineState>(this))
 , search(make_unique<SearchReplaceEngine>(this))
+, searchMatches(make_unique<SearchMatchIndex>(this))
 , path(make_unique<Path>(*config::path))
 , dialog(make_unique<DialogManager>())
 {
@@ -36,7 +36,9 @@
 #include "include/aegisub/context.h"
 #include "libresrc/libresrc.h"
 #include "options.h"
+#include "utils.h"
 
+#include <libaegisub/io.h>
 #include <libaegisub/signal.h>
 
 #include <algorithm>
@@ -44,12 +46,14 @@
 #include <vector>
 
 #include <wx/button.h>
+#include <wx/checkbox.h>
 #include <wx/dialog.h>
 #include <wx/filedlg.h>
 #include <wx/listctrl.h>
 #include <wx/log.h>
 #include <wx/msgdlg.h>
 #include <wx/sizer.h>
+#include <wx/textctrl.h>
 
 namespace {
 /// Struct to attach a flag for global/local to scripts
@@ -86,6 +90,9 @@ class DialogAutomation final : public wxDialog {
 	/// Reload a script
 	wxButton *reload_button;
 
+	/// Show the last profile of a script
+	wxButton *profile_button;
+
 	void RebuildList();
 	void AddScript(Automation4::Script *script, bool is_global);
 	void SetScriptInfo(int i, Automation4::Script *script);
@@ -96,6 +103,7 @@ class DialogAutomation final : public wxDialog {
 	void OnReload(wxCommandEvent &);
 
 	void OnInfo(wxCommandEvent &);
+	void OnProfile(wxCommandEvent &);
 	void OnReloadAutoload(wxCommandEvent &);
 
 public:
@@ -118,8 +126,11 @@ DialogAutomation::DialogAutomation(agi::Context *c)
 	remove_button = new wxButton(this, -1, _("&Remove"));
 	reload_button = new wxButton(this, -1, _("Re&load"));
 	wxButton *info_button = new wxButton(this, -1, _("Show &Info"));
+	profile_button = new wxButton(this, -1, _("Show &Profile"));
 	wxButton *reload_autoload_button = new wxButton(this, -1, _("Re&scan Autoload Dir"));
 	wxButton *close_button = new wxButton(this, wxID_CANCEL, _("&Close"));
+	wxCheckBox *profile_check = new wxCheckBox(this, -1, _("Profile &macros and export filters when they are run"));
+	profile_check->SetValue(OPT_GET("Automation/Profile")->GetBool());
 
 	list->Bind(wxEVT_LIST_ITEM_SELECTED, std::bind(&DialogAutomation::UpdateDisplay, this));
 	list->Bind(wxEVT_LIST_ITEM_DESELECTED, std::bind(&DialogAutomation::UpdateDisplay, this));
@@ -127,6 +138,10 @@ DialogAutomation::DialogAutomation(agi::Context *c)
 	remove_button->Bind(wxEVT_BUTTON, &DialogAutomation::OnRemove, this);
 	reload_button->Bind(wxEVT_BUTTON, &DialogAutomation::OnReload, this);
 	info_button->Bind(wxEVT_BUTTON, &DialogAutomation::OnInfo, this);
+	profile_button->Bind(wxEVT_BUTTON, &DialogAutomation::OnProfile, this);
+	profile_check->Bind(wxEVT_CHECKBOX, [](wxCommandEvent& evt) {
+		OPT_SET("Automation/Profile")->SetBool(evt.IsChecked());
+	});
 	reload_autoload_button->Bind(wxEVT_BUTTON, &DialogAutomation::OnReloadAutoload, this);
 
 	// add headers to list view
@@ -143,6 +158,7 @@ DialogAutomation::DialogAutomation(agi::Context *c)
 	button_box->AddSpacer(10);
 	button_box->Add(reload_button, 0);
 	button_box->Add(info_button, 0);
+	button_box->Add(profile_button, 0);
 	button_box->AddSpacer(10);
 	button_box->Add(reload_autoload_button, 0);
 	button_box->AddSpacer(10);
@@ -153,6 +169,7 @@ DialogAutomation::DialogAutomation(agi::Context *c)
 	// main layout
 	wxSizer *main_box = new wxBoxSizer(wxVERTICAL);
 	main_box->Add(list, wxSizerFlags(1).Expand().Border());
+	main_box->Add(profile_check, wxSizerFlags().Border(wxALL & ~wxTOP));
 	main_box->Add(button_box, wxSizerFlags().Expand().Border(wxALL & ~wxTOP));
 	SetSizerAndFit(main_box);
 	Center();
@@ -207,6 +224,7 @@ void DialogAutomation::UpdateDisplay()
 	bool local = selected && !script_info[list->GetItemData(i)].is_global;
 	remove_button->Enable(local);
 	reload_button->Enable(selected);
+	profile_button->Enable(selected);
 }
 
 template<class Container>
@@ -305,6 +323,47 @@ void DialogAutomation::OnInfo(wxCommandEvent &)
 	wxMessageBox(wxJoin(info, '\n', 0), _("Automation Script Info"));
 }
 
+void DialogAutomation::OnProfile(wxCommandEvent &)
+{
+	int i = list->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+	if (i < 0) return;
+	Automation4::Script *script = script_info[list->GetItemData(i)].script;
+
+	std::string report = script->GetProfileReport();
+	if (report.empty()) {
+		wxMessageBox(_("None of this script's macros or export filters have been run with profiling enabled."),
+			_("Automation Script Profile"), wxOK | wxCENTRE, this);
+		return;
+	}
+
+	wxDialog d(this, -1, fmt_tl("Profile of %s", script->GetName()), wxDefaultPosition, wxDefaultSize, wxCAPTION | wxCLOSE_BOX | wxRESIZE_BORDER);
+	wxTextCtrl *text_ctrl = new wxTextCtrl(&d, -1, "", wxDefaultPosition, wxSize(700, 400), wxTE_MULTILINE | wxTE_READONLY | wxTE_DONTWRAP);
+	text_ctrl->SetDefaultStyle(wxTextAttr(wxNullColour, wxNullColour, wxFont(8, wxFONTFAMILY_MODERN, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL)));
+	text_ctrl->AppendText(to_wx(report));
+	text_ctrl->SetInsertionPoint(0);
+
+	wxButton *save_button = new wxButton(&d, -1, _("&Save Flame Graph Stacks..."));
+	save_button->Bind(wxEVT_BUTTON, [&](wxCommandEvent &) {
+		auto path = SaveFileSelector(_("Save profile"), "Path/Last/Automation",
+			script->GetPrettyFilename().replace_extension("folded").string(), ".folded",
+			"Folded stacks (*.folded)|*.folded|All Files (*.*)|*.*", &d);
+		if (!path.empty())
+			agi::io::Save(path).Get() << script->GetProfileStacks();
+	});
+
+	wxSizer *button_sizer = new wxBoxSizer(wxHORIZONTAL);
+	button_sizer->Add(save_button, wxSizerFlags());
+	button_sizer->AddStretchSpacer(1);
+	button_sizer->Add(new wxButton(&d, wxID_OK), wxSizerFlags());
+
+	wxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(text_ctrl, wxSizerFlags(1).Expand().Border());
+	sizer->Add(button_sizer, wxSizerFlags().Expand().Border(wxALL & ~wxTOP));
+	d.SetSizerAndFit(sizer);
+	d.CentreOnParent();
+	d.ShowModal();
+}
+
 void DialogAutomation::OnReloadAutoload(wxCommandEvent &)
 {
 	global_manager->Reload();
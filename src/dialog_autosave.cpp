@@ -14,12 +14,19 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include "autosave_journal.h"
 #include "compat.h"
 #include "format.h"
 #include "libresrc/libresrc.h"
 #include "options.h"
 
+#include <libaegisub/dir_listing.h>
+#include <libaegisub/format.h>
+#include <libaegisub/fs.h>
 #include <libaegisub/path.h>
+#include <libaegisub/util.h>
+
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <boost/range/adaptor/map.hpp>
 #include <map>
@@ -27,9 +34,9 @@
 #include <vector>
 #include <wx/button.h>
 #include <wx/dialog.h>
-#include <wx/dir.h>
 #include <wx/filename.h>
 #include <wx/listbox.h>
+#include <wx/msgdlg.h>
 #include <wx/sizer.h>
 #include <wx/string.h>
 
@@ -49,14 +56,24 @@ class DialogAutosave {
 	wxDialog d;
 	std::vector<AutosaveFile> files;
 
+	/// Files found so far, by name
+	std::map<wxString, AutosaveFile> files_map;
+	/// Cancelled when the dialog goes away, as the directories are listed
+	/// in the background and may still be coming in
+	agi::dispatch::CancellationToken listing;
+
 	wxListBox *file_list;
 	wxListBox *version_list;
+	wxButton *open_button;
 
-	void Populate(std::map<wxString, AutosaveFile> &files_map, std::string const& path, wxString const& filter, wxString const& name_fmt);
+	void Populate(std::string const& path, wxString const& filter, wxString const& name_fmt, bool use_mtime = false);
+	void AddVersion(wxString const& directory, wxString const& fn, wxString const& filter, wxString const& name_fmt, bool use_mtime);
+	void UpdateFileList();
 	void OnSelectFile(wxCommandEvent&);
 
 public:
 	DialogAutosave(wxWindow *parent);
+	~DialogAutosave() { listing.Cancel(); }
 	std::string ChosenFile() const;
 
 	int ShowModal() { return d.ShowModal(); }
@@ -82,20 +99,69 @@ DialogAutosave::DialogAutosave(wxWindow *parent)
 	boxes_sizer->Add(versions_box, wxSizerFlags(1).Expand().Border());
 
 	auto *btn_sizer = d.CreateStdDialogButtonSizer(wxOK | wxCANCEL);
-	btn_sizer->GetAffirmativeButton()->SetLabelText(_("Open"));
+	open_button = btn_sizer->GetAffirmativeButton();
+	open_button->SetLabelText(_("Open"));
+	open_button->Disable();
 
 	wxSizer *main_sizer = new wxBoxSizer(wxVERTICAL);
 	main_sizer->Add(boxes_sizer, wxSizerFlags(1).Expand().Border());
 	main_sizer->Add(btn_sizer, wxSizerFlags().Expand().Border(wxALL & ~wxTOP));
 	d.SetSizer(main_sizer);
 
-	std::map<wxString, AutosaveFile> files_map;
-	Populate(files_map, OPT_GET("Path/Auto/Save")->GetString(), ".AUTOSAVE.ass", "%s");
-	Populate(files_map, OPT_GET("Path/Auto/Backup")->GetString(), ".ORIGINAL.ass", _("%s [ORIGINAL BACKUP]"));
-	Populate(files_map, "?user/recovered", ".ass", _("%s [RECOVERED]"));
+	Populate(OPT_GET("Path/Auto/Save")->GetString(), ".AUTOSAVE.ass", "%s");
+	// The date in a journal's name is when it was started, not last written
+	Populate(OPT_GET("Path/Auto/Save")->GetString(), ".AUTOSAVE.ass" + wxString(AutosaveJournal::extension), _("%s [JOURNAL]"), true);
+	Populate(OPT_GET("Path/Auto/Backup")->GetString(), ".ORIGINAL.ass", _("%s [ORIGINAL BACKUP]"));
+	Populate("?user/recovered", ".ass", _("%s [RECOVERED]"));
+}
+
+void DialogAutosave::Populate(std::string const& path, wxString const& filter, wxString const& name_fmt, bool use_mtime) {
+	auto directory = config::path->Decode(path);
+	agi::fs::ListDirectoryAsync(directory, from_wx("*" + filter),
+		[=](std::vector<std::string> names) {
+			wxString dir(directory.wstring());
+			for (auto const& fn : names)
+				AddVersion(dir, to_wx(fn), filter, name_fmt, use_mtime);
+			UpdateFileList();
+		},
+		[] { },
+		listing);
+}
 
-	for (auto& file : files_map | boost::adaptors::map_values)
-		files.emplace_back(std::move(file));
+void DialogAutosave::AddVersion(wxString const& directory, wxString const& fn, wxString const& filter, wxString const& name_fmt, bool use_mtime) {
+	wxDateTime date;
+
+	wxString date_str;
+	wxString name = fn.Left(fn.size() - filter.size()).BeforeLast('.', &date_str);
+	if (!name)
+		name = date_str;
+	else {
+		if (!date.ParseFormat(date_str, "%Y-%m-%d-%H-%M-%S"))
+			name += "." + date_str;
+	}
+	if (use_mtime || !date.IsValid())
+		date = wxFileName(directory, fn).GetModificationTime();
+
+	auto it = files_map.find(name);
+	if (it == files_map.end())
+		it = files_map.insert({name, AutosaveFile{name}}).first;
+	it->second.versions.push_back(Version{wxFileName(directory, fn).GetFullPath(), date, agi::wxformat(name_fmt, date.Format())});
+}
+
+void DialogAutosave::UpdateFileList() {
+	// Keep whatever was selected selected as more files come in
+	wxString selected_file, selected_version;
+	int sel_file = file_list->GetSelection();
+	int sel_version = version_list->GetSelection();
+	if (sel_file >= 0) {
+		selected_file = files[sel_file].name;
+		if (sel_version >= 0)
+			selected_version = files[sel_file].versions[sel_version].filename;
+	}
+
+	files.clear();
+	for (auto const& file : files_map | boost::adaptors::map_values)
+		files.push_back(file);
 
 	for (auto& file : files) {
 		sort(begin(file.versions), end(file.versions),
@@ -105,47 +171,25 @@ DialogAutosave::DialogAutosave(wxWindow *parent)
 	sort(begin(files), end(files),
 		[](AutosaveFile const& a, AutosaveFile const& b) { return a.versions[0].date > b.versions[0].date; });
 
+	file_list->Clear();
 	for (auto const& file : files)
 		file_list->Append(file.name);
 
-	if (file_list->IsEmpty())
-		btn_sizer->GetAffirmativeButton()->Disable();
-	else {
-		file_list->SetSelection(0);
-		wxCommandEvent evt;
-		OnSelectFile(evt);
-	}
-}
+	if (file_list->IsEmpty()) return;
+	open_button->Enable();
 
-void DialogAutosave::Populate(std::map<wxString, AutosaveFile> &files_map, std::string const& path, wxString const& filter, wxString const& name_fmt) {
-	wxString directory(config::path->Decode(path).wstring());
+	int file = selected_file.empty() ? wxNOT_FOUND : file_list->FindString(selected_file, true);
+	file_list->SetSelection(file == wxNOT_FOUND ? 0 : file);
+	wxCommandEvent evt;
+	OnSelectFile(evt);
 
-	wxDir dir;
-	if (!dir.Open(directory)) return;
-
-	wxString fn;
-	if (!dir.GetFirst(&fn, "*" + filter, wxDIR_FILES))
-		return;
-
-	do {
-		wxDateTime date;
-
-		wxString date_str;
-		wxString name = fn.Left(fn.size() - filter.size()).BeforeLast('.', &date_str);
-		if (!name)
-			name = date_str;
-		else {
-			if (!date.ParseFormat(date_str, "%Y-%m-%d-%H-%M-%S"))
-				name += "." + date_str;
+	if (file != wxNOT_FOUND && !selected_version.empty()) {
+		auto const& versions = files[file].versions;
+		for (size_t i = 0; i < versions.size(); ++i) {
+			if (versions[i].filename == selected_version)
+				version_list->SetSelection(i);
 		}
-		if (!date.IsValid())
-			date = wxFileName(directory, fn).GetModificationTime();
-
-		auto it = files_map.find(name);
-		if (it == files_map.end())
-			it = files_map.insert({name, AutosaveFile{name}}).first;
-		it->second.versions.push_back(Version{wxFileName(directory, fn).GetFullPath(), date, agi::wxformat(name_fmt, date.Format())});
-	} while (dir.GetNext(&fn));
+	}
 }
 
 void DialogAutosave::OnSelectFile(wxCommandEvent&) {
@@ -165,7 +209,23 @@ std::string DialogAutosave::ChosenFile() const {
 	int sel_version = version_list->GetSelection();
 	if (sel_version < 0) return "";
 
-	return from_wx(files[sel_file].versions[sel_version].filename);
+	auto const& file = files[sel_file];
+	auto filename = from_wx(file.versions[sel_version].filename);
+	if (!boost::ends_with(filename, AutosaveJournal::extension))
+		return filename;
+
+	// Journals can't be opened directly, so replay it into a recovered file
+	try {
+		auto path = config::path->Decode("?user/recovered");
+		agi::fs::CreateDirectory(path);
+		path /= agi::format("%s.%s.ass", from_wx(file.name), agi::util::strftime("%Y-%m-%d-%H-%M-%S"));
+		AutosaveJournal::Recover(filename, path);
+		return path.string();
+	}
+	catch (agi::Exception const& e) {
+		wxMessageBox(to_wx(e.GetMessage()), _("Error recovering autosave"), wxOK | wxICON_ERROR | wxCENTER, d.GetParent());
+		return "";
+	}
 }
 }
 
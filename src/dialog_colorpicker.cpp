@@ -36,6 +36,7 @@
 #include "utils.h"
 #include "value_event.h"
 
+#include <libaegisub/dispatch.h>
 #include <libaegisub/scoped_ptr.h>
 #include <libaegisub/make_unique.h>
 
@@ -425,6 +426,11 @@ class DialogColorPicker final : public wxDialog {
 	agi::Color cur_color; ///< Currently selected colour
 
 	bool spectrum_dirty; ///< Does the spectrum image need to be regenerated?
+	bool spectrum_generating = false; ///< Is a spectrum image being generated in the background?
+	bool spectrum_stale = false; ///< Did the colour change while the spectrum was being generated?
+	/// Expires when the dialog is destroyed, so that spectrum generation
+	/// which finishes afterwards knows to discard its result
+	std::shared_ptr<bool> alive = std::make_shared<bool>(true);
 	ColorPickerSpectrum *spectrum; ///< The 2D color spectrum
 	ColorPickerSpectrum *slider; ///< The 1D slider for the color component not in the slider
 	ColorPickerSpectrum *alpha_slider;
@@ -483,11 +489,9 @@ class DialogColorPicker final : public wxDialog {
 	/// Redraw the spectrum display
 	void UpdateSpectrumDisplay();
 
-	wxBitmap *MakeGBSpectrum();
-	wxBitmap *MakeRBSpectrum();
-	wxBitmap *MakeRGSpectrum();
-	wxBitmap *MakeHSSpectrum();
-	wxBitmap *MakeSVSpectrum();
+	/// Generate the spectrum image for the current colour in the background
+	/// and show it once it's ready
+	void RegenerateSpectrum();
 
 	/// Constructor helper function for making the color input box sizers
 	template<int N, class Control>
@@ -830,15 +834,8 @@ void DialogColorPicker::UpdateFromAlpha() {
 
 void DialogColorPicker::UpdateSpectrumDisplay() {
 	int i = colorspace_choice->GetSelection();
-	if (spectrum_dirty) {
-		switch (i) {
-			case 0: spectrum->SetBackground(MakeGBSpectrum(), true); break;
-			case 1: spectrum->SetBackground(MakeRBSpectrum(), true); break;
-			case 2: spectrum->SetBackground(MakeRGSpectrum(), true); break;
-			case 3: spectrum->SetBackground(MakeHSSpectrum(), true); break;
-			case 4: spectrum->SetBackground(MakeSVSpectrum(), true); break;
-		}
-	}
+	if (spectrum_dirty)
+		RegenerateSpectrum();
 
 	switch (i) {
 		case 0: case 1: case 2:
@@ -902,82 +899,56 @@ void DialogColorPicker::UpdateSpectrumDisplay() {
 	callback(cur_color);
 }
 
-template<typename Func>
-static wxBitmap *make_spectrum(wxBitmap *bitmap, Func func) {
-	wxImage spectrum_image(256, 256);
-	func(spectrum_image.GetData());
-	*bitmap = wxBitmap(spectrum_image);
-	return bitmap;
-}
-
-wxBitmap *DialogColorPicker::MakeGBSpectrum() {
-	return make_spectrum(&rgb_spectrum[0], [=](unsigned char *spec) {
-		for (int g = 0; g < 256; g++) {
-			for (int b = 0; b < 256; b++) {
-				*spec++ = cur_color.r;
-				*spec++ = g;
-				*spec++ = b;
-			}
+/// Fill a 256x256 RGB image with the spectrum for the given mode
+static void fill_spectrum(int mode, agi::Color color, int hsl_l, int hsv_h, unsigned char *spec) {
+	for (int y = 0; y < 256; ++y, spec += 256 * 3) {
+		switch (mode) {
+			case 0: rgb_ramp_row(color.r, y, 0, 2, spec); break;
+			case 1: rgb_ramp_row(y, color.g, 0, 2, spec); break;
+			case 2: rgb_ramp_row(y, 0, color.b, 1, spec); break;
+			case 3: hsl_saturation_row(y, hsl_l, spec); break;
+			case 4: hsv_saturation_row(hsv_h, y, spec); break;
 		}
-	});
-}
-
-wxBitmap *DialogColorPicker::MakeRBSpectrum() {
-	return make_spectrum(&rgb_spectrum[1], [=](unsigned char *spec) {
-		for (int r = 0; r < 256; r++) {
-			for (int b = 0; b < 256; b++) {
-				*spec++ = r;
-				*spec++ = cur_color.g;
-				*spec++ = b;
-			}
-		}
-	});
+	}
 }
 
-wxBitmap *DialogColorPicker::MakeRGSpectrum() {
-	return make_spectrum(&rgb_spectrum[2], [=](unsigned char *spec) {
-		for (int r = 0; r < 256; r++) {
-			for (int g = 0; g < 256; g++) {
-				*spec++ = r;
-				*spec++ = g;
-				*spec++ = cur_color.b;
+void DialogColorPicker::RegenerateSpectrum() {
+	// Only one image is generated at a time; if the colour changes while
+	// one is in progress, another is started with the latest values once
+	// it finishes rather than queueing one for every intermediate colour
+	if (spectrum_generating) {
+		spectrum_stale = true;
+		return;
+	}
+	spectrum_generating = true;
+	spectrum_stale = false;
+
+	int mode = colorspace_choice->GetSelection();
+	agi::Color color = cur_color;
+	int hsl_l = hsl_input[2]->GetValue();
+	int hsv_h = hsv_input[0]->GetValue();
+	std::weak_ptr<bool> weak_alive = alive;
+
+	agi::dispatch::Background().Async([=] {
+		// Ownership of the buffer passes to the wxImage made from it
+		auto data = static_cast<unsigned char *>(malloc(256 * 256 * 3));
+		fill_spectrum(mode, color, hsl_l, hsv_h, data);
+
+		agi::dispatch::Main().Async([=] {
+			if (weak_alive.expired()) {
+				free(data);
+				return;
 			}
-		}
-	});
-}
 
-wxBitmap *DialogColorPicker::MakeHSSpectrum() {
-	int l = hsl_input[2]->GetValue();
-	return make_spectrum(&hsl_spectrum, [=](unsigned char *spec) {
-		for (int h = 0; h < 256; h++) {
-			unsigned char maxr, maxg, maxb;
-			hsl_to_rgb(h, 255, l, &maxr, &maxg, &maxb);
-
-			for (int s = 0; s < 256; s++) {
-				*spec++ = maxr * s / 256 + (255-s) * l / 256;
-				*spec++ = maxg * s / 256 + (255-s) * l / 256;
-				*spec++ = maxb * s / 256 + (255-s) * l / 256;
-			}
-		}
-	});
-}
+			wxBitmap *bitmap = mode < 3 ? &rgb_spectrum[mode] : mode == 3 ? &hsl_spectrum : &hsv_spectrum;
+			*bitmap = wxBitmap(wxImage(256, 256, data));
+			if (colorspace_choice->GetSelection() == mode)
+				spectrum->SetBackground(bitmap, true);
 
-wxBitmap *DialogColorPicker::MakeSVSpectrum() {
-	int h = hsv_input[0]->GetValue();
-	unsigned char maxr, maxg, maxb;
-	hsv_to_rgb(h, 255, 255, &maxr, &maxg, &maxb);
-
-	return make_spectrum(&hsv_spectrum, [=](unsigned char *spec) {
-		for (int v = 0; v < 256; v++) {
-			int rr = (255-maxr) * v / 256;
-			int rg = (255-maxg) * v / 256;
-			int rb = (255-maxb) * v / 256;
-			for (int s = 0; s < 256; s++) {
-				*spec++ = 255 - rr * s / 256 - (255-v);
-				*spec++ = 255 - rg * s / 256 - (255-v);
-				*spec++ = 255 - rb * s / 256 - (255-v);
-			}
-		}
+			spectrum_generating = false;
+			if (spectrum_stale)
+				RegenerateSpectrum();
+		});
 	});
 }
 
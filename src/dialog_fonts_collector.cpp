@@ -32,12 +32,17 @@
 #include <libaegisub/path.h>
 #include <libaegisub/make_unique.h>
 
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+
 #include <wx/button.h>
 #include <wx/dialog.h>
 #include <wx/dirdlg.h>
 #include <wx/filedlg.h>
 #include <wx/filename.h>
 #include <wx/msgdlg.h>
+#include <wx/mstream.h>
 #include <wx/radiobox.h>
 #include <wx/sizer.h>
 #include <wx/statbox.h>
@@ -84,6 +89,41 @@ public:
 	DialogFontsCollector(agi::Context *c);
 };
 
+/// Number of fonts copied or compressed at once. Fonts are often copied to
+/// network drives, where more transfers than this just compete with each
+/// other.
+const size_t max_parallel_copies = 4;
+
+/// Call func(i) for each i in [0, count) on up to max_parallel_copies threads
+template<typename Func>
+void for_each_parallel(size_t count, Func const& func) {
+	std::atomic<size_t> next{0};
+	auto worker = [&] {
+		for (size_t i; (i = next++) < count; )
+			func(i);
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < std::min(count, max_parallel_copies); ++t)
+		workers.emplace_back(worker);
+	worker();
+	for (auto& thread : workers)
+		thread.join();
+}
+
+/// Is dest already a copy of src? Copies are made after the fonts were last
+/// modified, so one which is the same size and no older is taken to be.
+bool unchanged(agi::fs::path const& src, agi::fs::path const& dest) {
+	try {
+		return agi::fs::FileExists(dest)
+			&& agi::fs::Size(dest) == agi::fs::Size(src)
+			&& agi::fs::ModifiedTime(dest) >= agi::fs::ModifiedTime(src);
+	}
+	catch (agi::fs::FileSystemError const&) {
+		return false;
+	}
+}
+
 using color_str_pair = std::pair<int, wxString>;
 wxDEFINE_EVENT(EVT_ADD_TEXT, ValueEvent<color_str_pair>);
 wxDEFINE_EVENT(EVT_COLLECTION_DONE, wxThreadEvent);
@@ -143,53 +183,13 @@ void FontsCollectorThread(AssFile *subs, agi::fs::path const& destination, FcMod
 		}
 
 		int64_t total_size = 0;
-		bool allOk = true;
-		for (auto path : paths) {
+		for (auto& path : paths) {
 			path.make_preferred();
-
-			int ret = 0;
 			total_size += agi::fs::Size(path);
+		}
 
-			switch (oper) {
-				case FcMode::SymlinkToFolder:
-				case FcMode::CopyToScriptFolder:
-				case FcMode::CopyToFolder: {
-					auto dest = destination/path.filename();
-					if (agi::fs::FileExists(dest))
-						ret = 2;
-#ifndef _WIN32
-					else if (oper == FcMode::SymlinkToFolder) {
-						// returns 0 on success, -1 on error...
-						if (symlink(path.c_str(), dest.c_str()))
-							ret = 0;
-						else
-							ret = 3;
-					}
-#endif
-					else {
-						try {
-							agi::fs::Copy(path, dest);
-							ret = true;
-						}
-						catch (...) {
-							ret = false;
-						}
-					}
-				}
-				break;
-
-				case FcMode::CopyToZip: {
-					wxFFileInputStream in(path.wstring());
-					if (!in.IsOk())
-						ret = false;
-					else {
-						ret = zip->PutNextEntry(path.filename().wstring());
-						zip->Write(in);
-					}
-				}
-				default: break;
-			}
-
+		std::atomic<bool> allOk{true};
+		auto report = [&](agi::fs::path const& path, int ret) {
 			if (ret == 1)
 				AppendText(fmt_tl("* Copied %s.\n", path), 1);
 			else if (ret == 2)
@@ -200,6 +200,83 @@ void FontsCollectorThread(AssFile *subs, agi::fs::path const& destination, FcMod
 				AppendText(fmt_tl("* Failed to copy %s.\n", path), 2);
 				allOk = false;
 			}
+		};
+
+		if (oper == FcMode::CopyToZip) {
+			// Entries are compressed a batch at a time on separate threads,
+			// then copied into the archive in order without recompressing
+			for (size_t batch = 0; batch < paths.size(); batch += max_parallel_copies) {
+				size_t count = std::min(max_parallel_copies, paths.size() - batch);
+				std::vector<std::unique_ptr<wxMemoryOutputStream>> compressed(count);
+				for_each_parallel(count, [&](size_t i) {
+					auto const& path = paths[batch + i];
+					wxFFileInputStream in(path.wstring());
+					if (!in.IsOk()) return;
+
+					auto buffer = agi::make_unique<wxMemoryOutputStream>();
+					wxZipOutputStream entry_zip(*buffer);
+					if (entry_zip.PutNextEntry(path.filename().wstring()) && entry_zip.Write(in).IsOk() && entry_zip.Close())
+						compressed[i] = std::move(buffer);
+				});
+
+				for (size_t i = 0; i < count; ++i) {
+					int ret = 0;
+					if (compressed[i]) {
+						wxMemoryInputStream in(*compressed[i]);
+						wxZipInputStream entry_zip(in);
+						if (wxZipEntry *entry = entry_zip.GetNextEntry())
+							ret = zip->CopyEntry(entry, entry_zip);
+					}
+					report(paths[batch + i], ret);
+				}
+			}
+		}
+		else {
+			try {
+				agi::fs::CreateDirectory(destination);
+			}
+			catch (agi::fs::FileSystemError const&) {
+				// Reported as a failure for each font below
+			}
+
+			// Fonts with the same file name would be copied to the same
+			// place, so only the first of them is
+			std::vector<bool> duplicate(paths.size());
+			std::unordered_set<agi::fs::path::string_type> names;
+			for (size_t i = 0; i < paths.size(); ++i)
+				duplicate[i] = !names.insert(paths[i].filename().native()).second;
+
+			for_each_parallel(paths.size(), [&](size_t i) {
+				auto const& path = paths[i];
+				auto dest = destination/path.filename();
+
+				int ret = 0;
+				if (duplicate[i])
+					ret = 2;
+#ifndef _WIN32
+				else if (oper == FcMode::SymlinkToFolder) {
+					if (agi::fs::FileExists(dest))
+						ret = 2;
+					// returns 0 on success, -1 on error...
+					else if (symlink(path.c_str(), dest.c_str()))
+						ret = 0;
+					else
+						ret = 3;
+				}
+#endif
+				else if (unchanged(path, dest))
+					ret = 2;
+				else {
+					try {
+						agi::fs::Copy(path, dest);
+						ret = 1;
+					}
+					catch (...) {
+						ret = 0;
+					}
+				}
+				report(path, ret);
+			});
 		}
 
 		if (allOk)
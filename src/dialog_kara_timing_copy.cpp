@@ -76,6 +76,11 @@ class KaraokeLineMatchDisplay final : public wxControl {
 
 	size_t source_sel_length;
 
+	/// Remaining groups of the automatic match for the whole line
+	std::deque<agi::karaoke_match_result> match_plan;
+	/// Remaining source syllables and destination offset the plan applies to
+	std::pair<size_t, size_t> match_plan_state;
+
 	void OnPaint(wxPaintEvent &event);
 
 	wxString const& label_source = TEXT_LABEL_SOURCE;
@@ -314,6 +319,7 @@ void KaraokeLineMatchDisplay::SetInputData(AssDialogue *src, AssDialogue *dst)
 	last_total_matchgroup_render_width = 0;
 
 	matched_groups.clear();
+	match_plan.clear();
 
 	unmatched_source.clear();
 	source_sel_length = 0;
@@ -379,12 +385,29 @@ void KaraokeLineMatchDisplay::DecreaseDestinationMatch()
 
 void KaraokeLineMatchDisplay::AutoMatchJapanese()
 {
-	std::vector<std::string> source;
-	for (auto const& syl : unmatched_source)
-		source.emplace_back(syl.text);
-	auto result = agi::auto_match_karaoke(source, match_begin == destination.end() ? "" : &*match_begin->begin());
+	// Matching the whole rest of the line at once gives better groups than
+	// matching one group at a time, so the plan is reused for as long as the
+	// user accepts its groups unmodified
+	auto state = std::make_pair(unmatched_source.size(), static_cast<size_t>(distance(destination.begin(), match_begin)));
+	if (match_plan.empty() || state != match_plan_state) {
+		std::vector<std::string> source;
+		for (auto const& syl : unmatched_source)
+			source.emplace_back(syl.text);
+		auto plan = agi::auto_match_karaoke_line(source, match_begin == destination.end() ? "" : &*match_begin->begin());
+		match_plan.assign(plan.begin(), plan.end());
+	}
+
+	if (match_plan.empty()) {
+		source_sel_length = 0;
+		match_end = match_begin;
+		return;
+	}
+
+	auto const& result = match_plan.front();
 	source_sel_length = result.source_length;
 	match_end = std::next(match_begin, result.destination_length);
+	match_plan_state = std::make_pair(state.first - result.source_length, state.second + result.destination_length);
+	match_plan.pop_front();
 }
 
 bool KaraokeLineMatchDisplay::AcceptMatch()
@@ -0,0 +1,102 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file dialog_perf.cpp
+/// @brief Live view of the performance counters
+/// @ingroup utility
+
+#include "compat.h"
+#include "dialog_manager.h"
+#include "include/aegisub/context.h"
+
+#include <libaegisub/perf.h>
+
+#include <string>
+#include <wx/button.h>
+#include <wx/dialog.h>
+#include <wx/listctrl.h>
+#include <wx/sizer.h>
+#include <wx/timer.h>
+
+namespace {
+/// How often the counters are read again, in milliseconds
+const int refresh_interval = 500;
+
+class PerfWindow final : public wxDialog {
+	wxListCtrl *list;
+	wxTimer refresh_timer;
+
+	void UpdateCounters();
+
+public:
+	PerfWindow(agi::Context *c);
+};
+
+PerfWindow::PerfWindow(agi::Context *c)
+: wxDialog(c->parent, -1, _("Performance counters"), wxDefaultPosition, wxDefaultSize, wxCAPTION | wxCLOSE_BOX | wxRESIZE_BORDER)
+, refresh_timer(this)
+{
+	list = new wxListCtrl(this, -1, wxDefaultPosition, wxSize(600, 400), wxLC_REPORT | wxLC_SINGLE_SEL);
+	list->InsertColumn(0, _("Name"), wxLIST_FORMAT_LEFT, 240);
+	list->InsertColumn(1, _("Value"), wxLIST_FORMAT_RIGHT, 100);
+	list->InsertColumn(2, _("Median"), wxLIST_FORMAT_RIGHT, 80);
+	list->InsertColumn(3, _("90%"), wxLIST_FORMAT_RIGHT, 80);
+	list->InsertColumn(4, _("99%"), wxLIST_FORMAT_RIGHT, 80);
+
+	wxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(list, wxSizerFlags(1).Expand().Border());
+	sizer->Add(new wxButton(this, wxID_OK), wxSizerFlags(0).Border().Right());
+	SetSizerAndFit(sizer);
+
+	UpdateCounters();
+	Bind(wxEVT_TIMER, [=](wxTimerEvent&) { UpdateCounters(); });
+	refresh_timer.Start(refresh_interval);
+}
+
+void PerfWindow::UpdateCounters() {
+	auto samples = agi::perf::Snapshot();
+
+	// Metrics are never removed and the snapshot is sorted, so the rows only
+	// need rebuilding when a new metric has been registered
+	bool rebuild = (size_t)list->GetItemCount() != samples.size();
+	if (rebuild) {
+		list->Freeze();
+		list->DeleteAllItems();
+	}
+
+	for (size_t i = 0; i < samples.size(); ++i) {
+		auto const& sample = samples[i];
+		long row = (long)i;
+		if (rebuild)
+			list->InsertItem(row, to_wx(sample.name));
+
+		list->SetItem(row, 1, std::to_wstring(sample.value));
+		if (sample.type == agi::perf::Sample::Type::Histogram) {
+			list->SetItem(row, 2, std::to_wstring(sample.p50));
+			list->SetItem(row, 3, std::to_wstring(sample.p90));
+			list->SetItem(row, 4, std::to_wstring(sample.p99));
+		}
+	}
+
+	if (rebuild)
+		list->Thaw();
+}
+}
+
+void ShowPerfWindow(agi::Context *c) {
+	c->dialog->Show<PerfWindow>(c);
+}
@@ -21,10 +21,15 @@
 
 #include "dialog_search_replace.h"
 
+#include "ass_dialogue.h"
 #include "compat.h"
+#include "format.h"
 #include "include/aegisub/context.h"
 #include "options.h"
+#include "search_match_index.h"
 #include "search_replace_engine.h"
+#include "selection_controller.h"
+#include "text_selection_controller.h"
 #include "utils.h"
 #include "validators.h"
 
@@ -78,7 +83,12 @@ DialogSearchReplace::DialogSearchReplace(agi::Context* c, bool replace)
 	options_sizer->Add(new wxCheckBox(this, -1, _("&Match case"), wxDefaultPosition, wxDefaultSize, 0, wxGenericValidator(&settings->match_case)), wxSizerFlags().Border(wxBOTTOM));
 	options_sizer->Add(new wxCheckBox(this, -1, _("&Use regular expressions"), wxDefaultPosition, wxDefaultSize, 0, wxGenericValidator(&settings->use_regex)), wxSizerFlags().Border(wxBOTTOM));
 	options_sizer->Add(new wxCheckBox(this, -1, _("&Skip Comments"), wxDefaultPosition, wxDefaultSize, 0, wxGenericValidator(&settings->ignore_comments)), wxSizerFlags().Border(wxBOTTOM));
-	options_sizer->Add(new wxCheckBox(this, -1, _("S&kip Override Tags"), wxDefaultPosition, wxDefaultSize, 0, wxGenericValidator(&settings->skip_tags)));
+	options_sizer->Add(new wxCheckBox(this, -1, _("S&kip Override Tags"), wxDefaultPosition, wxDefaultSize, 0, wxGenericValidator(&settings->skip_tags)), wxSizerFlags().Border(wxBOTTOM));
+	incremental = new wxCheckBox(this, -1, _("Find as you &type"));
+	incremental->SetValue(OPT_GET("Tool/Search Replace/Incremental")->GetBool());
+	options_sizer->Add(incremental, wxSizerFlags().Border(wxBOTTOM));
+	match_count = new wxStaticText(this, -1, "");
+	options_sizer->Add(match_count, wxSizerFlags().Expand());
 
 	auto left_sizer = new wxBoxSizer(wxVERTICAL);
 	left_sizer->Add(find_sizer, wxSizerFlags().DoubleBorder(wxBOTTOM));
@@ -91,12 +101,14 @@ DialogSearchReplace::DialogSearchReplace(agi::Context* c, bool replace)
 	limit_sizer->Add(new wxRadioBox(this, -1, _("Limit to"), wxDefaultPosition, wxDefaultSize, countof(affect), affect, 0, wxRA_SPECIFY_COLS, MakeEnumBinder(&settings->limit_to)));
 
 	auto find_next = new wxButton(this, -1, _("&Find next"));
+	auto find_prev = new wxButton(this, -1, _("Find &previous"));
 	auto replace_next = new wxButton(this, -1, _("Replace &next"));
 	auto replace_all = new wxButton(this, -1, _("Replace &all"));
 	find_next->SetDefault();
 
 	auto button_sizer = new wxBoxSizer(wxVERTICAL);
 	button_sizer->Add(find_next, wxSizerFlags().Border(wxBOTTOM));
+	button_sizer->Add(find_prev, wxSizerFlags().Border(wxBOTTOM));
 	button_sizer->Add(replace_next, wxSizerFlags().Border(wxBOTTOM));
 	button_sizer->Add(replace_all, wxSizerFlags().Border(wxBOTTOM));
 	button_sizer->Add(new wxButton(this, wxID_CANCEL));
@@ -126,9 +138,85 @@ DialogSearchReplace::DialogSearchReplace(agi::Context* c, bool replace)
 	find_next->Bind(wxEVT_BUTTON, std::bind(&DialogSearchReplace::FindReplace, this, &SearchReplaceEngine::FindNext));
 	replace_next->Bind(wxEVT_BUTTON, std::bind(&DialogSearchReplace::FindReplace, this, &SearchReplaceEngine::ReplaceNext));
 	replace_all->Bind(wxEVT_BUTTON, std::bind(&DialogSearchReplace::FindReplace, this, &SearchReplaceEngine::ReplaceAll));
+	find_prev->Bind(wxEVT_BUTTON, [=](wxCommandEvent&) { JumpToMatch(true); });
+	find_prev->Bind(wxEVT_UPDATE_UI, [=](wxUpdateUIEvent& e) { e.Enable(c->searchMatches->Active()); });
+
+	// Any change to the search restarts the live count
+	auto restart = [=](wxCommandEvent& e) { UpdateIncremental(); e.Skip(); };
+	find_edit->Bind(wxEVT_TEXT, restart);
+	find_edit->Bind(wxEVT_COMBOBOX, restart);
+	Bind(wxEVT_CHECKBOX, restart);
+	Bind(wxEVT_RADIOBOX, restart);
+	Bind(wxEVT_SHOW, [=](wxShowEvent& e) {
+		if (e.IsShown())
+			UpdateIncremental();
+		else
+			c->searchMatches->Clear();
+		e.Skip();
+	});
+
+	match_connection = c->searchMatches->AddChangeListener(&DialogSearchReplace::UpdateMatchCount, this);
+	UpdateIncremental();
 }
 
 DialogSearchReplace::~DialogSearchReplace() {
+	c->searchMatches->Clear();
+}
+
+void DialogSearchReplace::UpdateIncremental() {
+	OPT_SET("Tool/Search Replace/Incremental")->SetBool(incremental->GetValue());
+	if (!incremental->GetValue()) {
+		c->searchMatches->Clear();
+		return;
+	}
+
+	TransferDataFromWindow();
+	try {
+		c->searchMatches->Configure(*settings);
+	}
+	catch (std::exception const&) {
+		// Most likely a regex which hasn't been finished being typed yet
+		c->searchMatches->Clear();
+		match_count->SetLabel(_("Invalid search"));
+	}
+}
+
+void DialogSearchReplace::UpdateMatchCount() {
+	auto const& index = *c->searchMatches;
+	if (!index.Active())
+		match_count->SetLabel("");
+	else if (index.Building())
+		match_count->SetLabel(_("Searching..."));
+	else if (!index.TotalMatches())
+		match_count->SetLabel(_("No matches"));
+	else
+		match_count->SetLabel(fmt_tl("%d matches in %d lines", index.TotalMatches(), index.MatchingLines()));
+}
+
+void DialogSearchReplace::JumpToMatch(bool backwards) {
+	auto& index = *c->searchMatches;
+	if (!index.Active() || index.Building()) return;
+
+	auto active = c->selectionController->GetActiveLine();
+	auto matches = SearchReplaceEngine::GetMatcher(*settings);
+	bool text = settings->field == SearchReplaceSettings::Field::TEXT;
+
+	// Later matches in the active line come before the next line
+	if (!backwards && text && index.Matches(active)) {
+		if (MatchState ms = matches(active, c->textSelectionController->GetSelectionEnd())) {
+			c->textSelectionController->SetSelection(ms.start, ms.end);
+			return;
+		}
+	}
+
+	auto line = index.Next(active, backwards);
+	if (!line) return;
+
+	c->selectionController->SetSelectionAndActive({ line }, line);
+	if (text) {
+		if (MatchState ms = matches(line, 0))
+			c->textSelectionController->SetSelection(ms.start, ms.end);
+	}
 }
 
 void DialogSearchReplace::FindReplace(bool (SearchReplaceEngine::*func)()) {
@@ -137,6 +225,14 @@ void DialogSearchReplace::FindReplace(bool (SearchReplaceEngine::*func)()) {
 	if (settings->find.empty())
 		return;
 
+	// The live count already knows which lines match, so use it to step
+	// between them rather than searching from the active line
+	if (func == &SearchReplaceEngine::FindNext && c->searchMatches->Active() && !c->searchMatches->Building()) {
+		JumpToMatch(false);
+		config::mru->Add("Find", settings->find);
+		return;
+	}
+
 	c->search->Configure(*settings);
 	try {
 		((*c->search).*func)();
@@ -19,6 +19,8 @@
 /// @ingroup secondary_ui
 ///
 
+#include <libaegisub/signal.h>
+
 #include <memory>
 
 #include <wx/dialog.h>
@@ -26,7 +28,9 @@
 namespace agi { struct Context; }
 class SearchReplaceEngine;
 struct SearchReplaceSettings;
+class wxCheckBox;
 class wxComboBox;
+class wxStaticText;
 
 class DialogSearchReplace final : public wxDialog {
 	agi::Context *c;
@@ -34,9 +38,18 @@ class DialogSearchReplace final : public wxDialog {
 	bool has_replace;
 	wxComboBox *find_edit;
 	wxComboBox *replace_edit;
+	wxCheckBox *incremental;
+	wxStaticText *match_count;
+	agi::signal::Connection match_connection;
 
 	void UpdateDropDowns();
 	void FindReplace(bool (SearchReplaceEngine::*func)());
+	/// Restart the live count of matches for the current settings
+	void UpdateIncremental();
+	/// Show the live count of matches
+	void UpdateMatchCount();
+	/// Select the next or previous line with a match using the live count
+	void JumpToMatch(bool backwards);
 
 public:
 	static void Show(agi::Context *context, bool with_replace);
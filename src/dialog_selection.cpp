@@ -15,6 +15,7 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include "ass_dialogue.h"
+#include "ass_field_index.h"
 #include "ass_file.h"
 #include "compat.h"
 #include "dialog_manager.h"
@@ -27,8 +28,6 @@
 #include "search_replace_engine.h"
 #include "selection_controller.h"
 
-#include <boost/range/algorithm/set_algorithm.hpp>
-
 #include <wx/checkbox.h>
 #include <wx/combobox.h>
 #include <wx/dialog.h>
@@ -75,7 +74,7 @@ enum Mode {
 	REGEXP
 };
 
-std::set<AssDialogue*> process(std::string const& match_text, bool match_case, Mode mode, bool invert, bool comments, bool dialogue, int field_n, AssFile *ass) {
+Selection process(std::string const& match_text, bool match_case, Mode mode, bool invert, bool comments, bool dialogue, int field_n, AssFile *ass) {
 	SearchReplaceSettings settings = {
 		match_text,
 		std::string(),
@@ -88,9 +87,32 @@ std::set<AssDialogue*> process(std::string const& match_text, bool match_case, M
 		mode == Mode::EXACT
 	};
 
+	Selection matches;
+	auto add_lines = [&](std::vector<AssDialogue *> const& lines) {
+		for (auto diag : lines) {
+			if (diag->Comment ? comments : dialogue)
+				matches.insert(diag);
+		}
+	};
+
+	// An exact match on an indexed field is just a lookup
+	if (settings.field != SearchReplaceSettings::Field::TEXT && mode == Mode::EXACT && match_case && !invert) {
+		add_lines(ass->EventsWithField(static_cast<IndexedField>(field_n - 1), match_text));
+		return matches;
+	}
+
 	auto predicate = SearchReplaceEngine::GetMatcher(settings);
 
-	std::set<AssDialogue*> matches;
+	// Lines with the same style, actor or effect all match or don't match
+	// together, so only one line with each distinct value is checked
+	if (settings.field != SearchReplaceSettings::Field::TEXT) {
+		for (auto const& group : ass->FieldIndex(static_cast<IndexedField>(field_n - 1)).Groups()) {
+			if (invert != predicate(group.second.lines.front(), 0))
+				add_lines(group.second.lines);
+		}
+		return matches;
+	}
+
 	for (auto& diag : ass->Events) {
 		if (diag.Comment && !comments) continue;
 		if (!diag.Comment && !dialogue) continue;
@@ -182,7 +204,7 @@ DialogSelection::~DialogSelection() {
 }
 
 void DialogSelection::Process(wxCommandEvent&) {
-	std::set<AssDialogue*> matches;
+	Selection matches;
 
 	try {
 		matches = process(
@@ -213,18 +235,18 @@ void DialogSelection::Process(wxCommandEvent&) {
 			break;
 
 		case Action::ADD:
-			boost::set_union(old_sel, matches, inserter(new_sel, new_sel.begin()));
+			new_sel = old_sel.Union(matches);
 			message = (count = new_sel.size() - old_sel.size())
 				? fmt_plural(count, "One line was added to selection", "%u lines were added to selection", count)
 				: _("No lines were added to selection");
 			break;
 
 		case Action::SUB:
-			boost::set_difference(old_sel, matches, inserter(new_sel, new_sel.begin()));
+			new_sel = old_sel.Difference(matches);
 			goto sub_message;
 
 		case Action::INTERSECT:
-			boost::set_intersection(old_sel, matches, inserter(new_sel, new_sel.begin()));
+			new_sel = old_sel.Intersection(matches);
 			sub_message:
 			message = (count = old_sel.size() - new_sel.size())
 				? fmt_plural(count, "One line was removed from selection", "%u lines were removed from selection", count)
@@ -71,7 +71,7 @@ class DialogShiftTimes final : public wxDialog {
 	void SaveHistory(json::Array shifted_blocks);
 	void LoadHistory();
 	void Process(wxCommandEvent&);
-	int Shift(int initial_time, int shift, bool by_time, agi::vfr::Time type);
+	void Shift(std::vector<int> &times, int shift, bool by_time, agi::vfr::Time type);
 
 	void OnClear(wxCommandEvent&);
 	void OnByTime(wxCommandEvent&);
@@ -385,6 +385,7 @@ void DialogShiftTimes::Process(wxCommandEvent &) {
 	// Track which rows were shifted for the log
 	int block_start = 0;
 	json::Array shifted_blocks;
+	std::vector<AssDialogue *> lines;
 
 	for (auto& line : context->ass->Events) {
 		if (!sel.count(&line)) {
@@ -401,10 +402,25 @@ void DialogShiftTimes::Process(wxCommandEvent &) {
 		else if (!block_start)
 			block_start = line.Row + 1;
 
-		if (start)
-			line.Start = Shift(line.Start, shift, by_time, agi::vfr::START);
-		if (end)
-			line.End = Shift(line.End, shift, by_time, agi::vfr::END);
+		lines.push_back(&line);
+	}
+
+	// Shift all of the times at once so that converting them to and from
+	// frames is a single pass over the timecodes
+	std::vector<int> times(lines.size());
+	if (start) {
+		for (size_t i = 0; i < lines.size(); ++i)
+			times[i] = lines[i]->Start;
+		Shift(times, shift, by_time, agi::vfr::START);
+		for (size_t i = 0; i < lines.size(); ++i)
+			lines[i]->Start = times[i];
+	}
+	if (end) {
+		for (size_t i = 0; i < lines.size(); ++i)
+			times[i] = lines[i]->End;
+		Shift(times, shift, by_time, agi::vfr::END);
+		for (size_t i = 0; i < lines.size(); ++i)
+			lines[i]->End = times[i];
 	}
 
 	context->ass->Commit(_("shifting"), AssFile::COMMIT_DIAG_TIME);
@@ -420,11 +436,17 @@ void DialogShiftTimes::Process(wxCommandEvent &) {
 	Close();
 }
 
-int DialogShiftTimes::Shift(int initial_time, int shift, bool by_time, agi::vfr::Time type) {
-	if (by_time)
-		return initial_time + shift;
-	else
-		return fps.TimeAtFrame(shift + fps.FrameAtTime(initial_time, type), type);
+void DialogShiftTimes::Shift(std::vector<int> &times, int shift, bool by_time, agi::vfr::Time type) {
+	if (by_time) {
+		for (int &time : times)
+			time += shift;
+		return;
+	}
+
+	times = fps.FramesAtTimes(times, type);
+	for (int &frame : times)
+		frame += shift;
+	times = fps.TimesAtFrames(times, type);
 }
 }
 
@@ -85,6 +85,10 @@ class DialogSpellChecker final : public wxDialog {
 	/// @return Was a misspelling found?
 	bool CheckLine(AssDialogue *active_line, int start_pos, int *commit_id);
 
+	/// Start checking every word in the file in the background, beginning
+	/// from the active line, so that FindNext mostly hits cached results
+	void PrefetchWords();
+
 	/// Set the current word to be corrected
 	void SetWord(std::string const& word);
 	/// Correct the currently selected word
@@ -223,6 +227,7 @@ DialogSpellChecker::DialogSpellChecker(agi::Context *context)
 	SetSizerAndFit(main_sizer);
 	CenterOnParent();
 
+	PrefetchWords();
 	if (FindNext())
 		Show();
 }
@@ -236,6 +241,7 @@ void DialogSpellChecker::OnChangeLanguage(wxCommandEvent&) {
 	wxString code = dictionary_lang_codes[language->GetSelection()];
 	OPT_SET("Tool/Spell Checker/Language")->SetString(from_wx(code));
 
+	PrefetchWords();
 	FindNext();
 }
 
@@ -287,6 +293,36 @@ bool DialogSpellChecker::FindNext() {
 	return false;
 }
 
+void DialogSpellChecker::PrefetchWords() {
+	bool skip_comments = OPT_GET("Tool/Spell Checker/Skip Comments")->GetBool();
+	std::vector<std::string> words;
+	auto add_line = [&](AssDialogue const& line) {
+		if (line.Comment && skip_comments) return;
+
+		std::string const& text = line.Text;
+		auto tokens = agi::ass::TokenizeDialogueBody(text);
+		agi::ass::SplitWords(text, tokens);
+
+		size_t pos = 0;
+		for (auto const& tok : tokens) {
+			if (tok.type == agi::ass::DialogueTokenType::WORD)
+				words.push_back(text.substr(pos, tok.length));
+			pos += tok.length;
+		}
+	};
+
+	auto& events = context->ass->Events;
+	auto first = events.begin();
+	if (auto line = context->selectionController->GetActiveLine())
+		first = context->ass->iterator_to(*line);
+	for (auto it = first; it != events.end(); ++it)
+		add_line(*it);
+	for (auto it = events.begin(); it != first; ++it)
+		add_line(*it);
+
+	spellchecker->CheckWordsAsync(std::move(words), nullptr);
+}
+
 bool DialogSpellChecker::CheckLine(AssDialogue *active_line, int start_pos, int *commit_id) {
 	if (active_line->Comment && OPT_GET("Tool/Spell Checker/Skip Comments")->GetBool()) return false;
 
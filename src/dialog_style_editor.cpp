@@ -72,9 +72,9 @@ class StyleRenamer {
 	std::string new_name;
 
 	/// Process a single override parameter to check if it's \r with this style name
-	static void ProcessTag(std::string const& tag, AssOverrideParameter* param, void *userData) {
+	static void ProcessTag(AssTagId tag, AssOverrideParameter* param, void *userData) {
 		StyleRenamer *self = static_cast<StyleRenamer*>(userData);
-		if (tag == "\\r" && param->GetType() == VariableDataType::TEXT && param->Get<std::string>() == self->source_name) {
+		if (tag == AssTagId::R && param->GetType() == VariableDataType::TEXT && param->Get<std::string>() == self->source_name) {
 			if (self->do_replace)
 				param->Set(self->new_name);
 			else
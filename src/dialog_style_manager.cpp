@@ -45,6 +45,7 @@
 #include "selection_controller.h"
 #include "subtitle_format.h"
 
+#include <libaegisub/file_mapping.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
@@ -669,6 +670,7 @@ void DialogStyleManager::OnCurrentImport() {
 	auto filename = OpenFileSelector(_("Open subtitles file"), "Path/Last/Subtitles", "", "", SubtitleFormat::GetWildcards(0), this);
 	if (filename.empty()) return;
 
+	agi::shared_read_mapping shared_file(filename);
 	std::string charset;
 	try {
 		charset = CharSetDetect::GetEncoding(filename);
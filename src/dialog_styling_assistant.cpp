@@ -166,6 +166,8 @@ void DialogStyling::OnActiveLineChanged(AssDialogue *new_line) {
 
 	if (auto_seek->IsChecked() && IsActive())
 		c->videoController->JumpToTime(active_line->Start);
+	if (IsActive())
+		c->videoController->PrefetchLinesAfter(active_line);
 }
 
 void DialogStyling::Commit(bool next) {
@@ -187,6 +189,7 @@ void DialogStyling::OnActivate(wxActivateEvent &) {
 
 	if (auto_seek->IsChecked())
 		c->videoController->JumpToTime(active_line->Start);
+	c->videoController->PrefetchLinesAfter(active_line);
 
 	style_name->SetFocus();
 }
@@ -30,6 +30,7 @@
 #include "ass_dialogue.h"
 #include "ass_file.h"
 #include "async_video_provider.h"
+#include "audio_controller.h"
 #include "compat.h"
 #include "format.h"
 #include "help_button.h"
@@ -48,6 +49,8 @@
 #include <boost/range/algorithm.hpp>
 #include <boost/range/algorithm_ext/push_back.hpp>
 #include <functional>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <wx/button.h>
 #include <wx/checkbox.h>
@@ -78,12 +81,14 @@ struct DialogTimingProcessor {
 	int afterEnd;    ///< Maximum time in milliseconds to move end time of line forwards to land on a keyframe
 	int adjGap;      ///< Maximum gap in milliseconds to snap adjacent lines to each other
 	int adjOverlap;  ///< Maximum overlap in milliseconds to snap adjacent lines to each other
+	int silenceRange; ///< Maximum time in milliseconds to move start or end time of line to land on the edge of a silence
 
 	wxCheckBox *onlySelection; ///< Only process selected lines of the selected styles
 	wxCheckBox *hasLeadIn;     ///< Enable adding lead-in
 	wxCheckBox *hasLeadOut;    ///< Enable adding lead-out
 	wxCheckBox *keysEnable;    ///< Enable snapping to keyframes
 	wxCheckBox *adjsEnable;    ///< Enable snapping adjacent lines to each other
+	wxCheckBox *silenceEnable; ///< Enable snapping to the edges of silences in the audio
 	wxSlider *adjacentBias;    ///< Bias between shifting start and end times when snapping adjacent lines
 	wxCheckListBox *StyleList; ///< List of styles to process
 	wxButton *ApplyButton;     ///< Button to apply the processing
@@ -152,6 +157,7 @@ DialogTimingProcessor::DialogTimingProcessor(agi::Context *c)
 	afterEnd = OPT_GET("Tool/Timing Post Processor/Threshold/Key End After")->GetInt();
 	adjGap = OPT_GET("Tool/Timing Post Processor/Threshold/Adjacent Gap")->GetInt();
 	adjOverlap = OPT_GET("Tool/Timing Post Processor/Threshold/Adjacent Overlap")->GetInt();
+	silenceRange = OPT_GET("Tool/Timing Post Processor/Threshold/Silence")->GetInt();
 
 	// Styles box
 	auto LeftSizer = new wxStaticBoxSizer(wxVERTICAL,&d,_("Apply to styles"));
@@ -185,6 +191,22 @@ DialogTimingProcessor::DialogTimingProcessor(agi::Context *c)
 
 	LeadSizer->AddStretchSpacer(1);
 
+	// Silence snapping sizer
+	auto SilenceSizer = new wxStaticBoxSizer(wxHORIZONTAL, &d, _("Snap to silence"));
+	silenceEnable = make_check(SilenceSizer, _("Ena&ble"),
+		"Tool/Timing Post Processor/Enable/Silence",
+		_("Move start times to where speech starts and end times to where it stops, before adding lead-in and lead-out"));
+
+	// The audio has to be loaded and cached to find the silences
+	if (!c->audioController->HasEnergyEnvelope()) {
+		silenceEnable->SetValue(false);
+		silenceEnable->Enable(false);
+	}
+
+	make_ctrl(SilenceSizer, _("Max distance:"), &silenceRange, silenceEnable,
+		_("Maximum distance to move the start or end time of a line to snap it to the edge of a silence, in milliseconds"));
+	SilenceSizer->AddStretchSpacer(1);
+
 	// Adjacent subs sizer
 	auto AdjacentSizer = new wxStaticBoxSizer(wxHORIZONTAL, &d, _("Make adjacent subtitles continuous"));
 	adjsEnable = make_check(AdjacentSizer, _("&Enable"),
@@ -251,6 +273,7 @@ DialogTimingProcessor::DialogTimingProcessor(agi::Context *c)
 	// Right Sizer
 	auto RightSizer = new wxBoxSizer(wxVERTICAL);
 	RightSizer->Add(optionsSizer,0,wxBOTTOM|wxEXPAND,5);
+	RightSizer->Add(SilenceSizer,0,wxBOTTOM|wxEXPAND,5);
 	RightSizer->Add(LeadSizer,0,wxBOTTOM|wxEXPAND,5);
 	RightSizer->Add(AdjacentSizer,0,wxBOTTOM|wxEXPAND,5);
 	RightSizer->Add(KeyframesSizer,0,wxBOTTOM|wxEXPAND,5);
@@ -299,7 +322,7 @@ void DialogTimingProcessor::UpdateControls() {
 	size_t len = StyleList->GetCount();
 	for (size_t i = 0; !any_checked && i < len; ++i)
 		any_checked = StyleList->IsChecked(i);
-	ApplyButton->Enable(any_checked && (hasLeadIn->IsChecked() || hasLeadOut->IsChecked() || keysEnable->IsChecked() || adjsEnable->IsChecked()));
+	ApplyButton->Enable(any_checked && (hasLeadIn->IsChecked() || hasLeadOut->IsChecked() || silenceEnable->IsChecked() || keysEnable->IsChecked() || adjsEnable->IsChecked()));
 }
 
 void DialogTimingProcessor::OnApply(wxCommandEvent &) {
@@ -313,22 +336,28 @@ void DialogTimingProcessor::OnApply(wxCommandEvent &) {
 	OPT_SET("Tool/Timing Post Processor/Threshold/Key End After")->SetInt(afterEnd);
 	OPT_SET("Tool/Timing Post Processor/Threshold/Adjacent Gap")->SetInt(adjGap);
 	OPT_SET("Tool/Timing Post Processor/Threshold/Adjacent Overlap")->SetInt(adjOverlap);
+	OPT_SET("Tool/Timing Post Processor/Threshold/Silence")->SetInt(silenceRange);
 	OPT_SET("Tool/Timing Post Processor/Adjacent Bias")->SetDouble(adjacentBias->GetValue() / 100.0);
 	OPT_SET("Tool/Timing Post Processor/Enable/Lead/IN")->SetBool(hasLeadIn->IsChecked());
 	OPT_SET("Tool/Timing Post Processor/Enable/Lead/OUT")->SetBool(hasLeadOut->IsChecked());
 	if (keysEnable->IsEnabled()) OPT_SET("Tool/Timing Post Processor/Enable/Keyframe")->SetBool(keysEnable->IsChecked());
 	OPT_SET("Tool/Timing Post Processor/Enable/Adjacent")->SetBool(adjsEnable->IsChecked());
+	if (silenceEnable->IsEnabled()) OPT_SET("Tool/Timing Post Processor/Enable/Silence")->SetBool(silenceEnable->IsChecked());
 	OPT_SET("Tool/Timing Post Processor/Only Selection")->SetBool(onlySelection->IsChecked());
 
 	Process();
 	d.EndModal(0);
 }
 
+static bool start_less(const AssDialogue *a, const AssDialogue *b) {
+	return a->Start < b->Start;
+}
+
 std::vector<AssDialogue*> DialogTimingProcessor::SortDialogues() {
-	std::set<boost::flyweight<std::string>> styles;
+	std::set<agi::StringFlyweight> styles;
 	for (size_t i = 0; i < StyleList->GetCount(); ++i) {
 		if (StyleList->IsChecked(i))
-			styles.insert(boost::flyweight<std::string>(from_wx(StyleList->GetString(i))));
+			styles.insert(agi::StringFlyweight(from_wx(StyleList->GetString(i))));
 	}
 
 	std::vector<AssDialogue*> sorted;
@@ -354,49 +383,107 @@ std::vector<AssDialogue*> DialogTimingProcessor::SortDialogues() {
 		}
 	}
 
-	boost::sort(sorted, [](const AssDialogue *a, const AssDialogue *b) {
-		return a->Start < b->Start;
-	});
+	boost::sort(sorted, start_less);
 	return sorted;
 }
 
-static int get_closest_kf(std::vector<int> const& kf, int frame) {
-	const auto pos = boost::upper_bound(kf, frame);
-	// Return last keyframe if this is after the last one
-	if (pos == end(kf)) return kf.back();
-	// *pos is greater than frame, and *(pos - 1) is less than or equal to frame
-	return (pos == begin(kf) || *pos - frame < frame - *(pos - 1)) ? *pos : *(pos - 1);
-}
+/// Finds the keyframe closest to each of a series of frames
+///
+/// The lines are sorted by start time, so the frames looked up are mostly
+/// increasing and each search continues from where the previous one ended,
+/// making snapping all of the lines a single merge over them and the
+/// keyframes. Frames before the previous one fall back to a binary search.
+class closest_kf_finder {
+	std::vector<int> const& kf;
+	/// Index of the first keyframe after the previous frame
+	size_t pos = 0;
+
+public:
+	closest_kf_finder(std::vector<int> const& kf) : kf(kf) { }
+
+	size_t operator()(int frame) {
+		if (pos > 0 && kf[pos - 1] > frame)
+			pos = std::upper_bound(begin(kf), begin(kf) + pos, frame) - begin(kf);
+		else {
+			while (pos < kf.size() && kf[pos] <= frame)
+				++pos;
+		}
 
-template<class Iter, class Field>
-static int safe_time(Iter begin, Iter end, AssDialogue *comp, int initial, Field field, int const& (*cmp)(int const&, int const&)) {
-	// Compare to every previous line (yay for O(n^2)!) to see if it's OK to add lead-in
-	for (; begin != end; ++begin) {
-		// If the line doesn't already collide with this line, extend it only
-		// to the edge of the line
-		if (!comp->CollidesWith(*begin))
-			initial = cmp(initial, (*begin)->*field);
+		// Return last keyframe if this is after the last one
+		if (pos == kf.size()) return kf.size() - 1;
+		// kf[pos] is greater than frame, and kf[pos - 1] is less than or equal to frame
+		if (pos == 0 || kf[pos] - frame < frame - kf[pos - 1])
+			return pos;
+		return pos - 1;
 	}
-	return initial;
-}
+};
 
 void DialogTimingProcessor::Process() {
 	std::vector<AssDialogue*> sorted = SortDialogues();
 	if (sorted.empty()) return;
 
-	// Add lead-in/out
+	// Snap to the edges of silences, so that the lead-in/out is added to
+	// where the speech actually is
+	if (silenceEnable->IsChecked()) {
+		for (AssDialogue *cur : sorted) {
+			int start = c->audioController->FindSilenceEdge(cur->Start, silenceRange, true);
+			int end = c->audioController->FindSilenceEdge(cur->End, silenceRange, false);
+			if (start < 0) start = cur->Start;
+			if (end < 0) end = cur->End;
+			if (start < end) {
+				cur->Start = start;
+				cur->End = end;
+			}
+		}
+
+		// Snapping can reorder lines, and the lead-in below relies on
+		// every earlier line starting no later than the current one
+		boost::stable_sort(sorted, start_less);
+	}
+
+	// Add lead-in/out, but only up to the edge of lines which don't
+	// already overlap the line being extended
 	if (hasLeadIn->IsChecked() && leadIn) {
-		for (size_t i = 0; i < sorted.size(); ++i)
-			sorted[i]->Start = safe_time(sorted.rend() - i, sorted.rend(),
-				sorted[i], sorted[i]->Start - leadIn,
-				&AssDialogue::End, &std::max<int>);
+		// Earlier lines start no later than this one, so the only ones
+		// which don't collide with it are those ending at or before its start
+		std::set<int> ends;
+		for (AssDialogue *cur : sorted) {
+			int start = cur->Start;
+			cur->Start = start - leadIn;
+			auto prev = ends.upper_bound(start);
+			if (prev != begin(ends) && *--prev > cur->Start)
+				cur->Start = *prev;
+			ends.insert(cur->End);
+		}
 	}
 
 	if (hasLeadOut->IsChecked() && leadOut) {
+		// Walk backwards so that the sets hold exactly the later lines. Those
+		// lines can't collide if they start after this one ends, or if they
+		// are zero-length lines which ended up starting before this line
+		// and end exactly where it starts.
+		std::vector<int> ends(sorted.size());
+		std::set<int> starts;
+		std::unordered_map<int, int> first_start_by_end;
+		for (size_t i = sorted.size(); i-- > 0; ) {
+			AssDialogue *cur = sorted[i];
+			int start = cur->Start, end = cur->End;
+
+			ends[i] = end + leadOut;
+			auto next = starts.lower_bound(std::max(end, start + 1));
+			if (next != starts.end())
+				ends[i] = std::min(ends[i], *next);
+			auto touching = first_start_by_end.find(start);
+			if (touching != first_start_by_end.end())
+				ends[i] = std::min(ends[i], touching->second);
+
+			starts.insert(start);
+			auto& first = first_start_by_end.emplace(end, start).first->second;
+			first = std::min(first, start);
+		}
+
 		for (size_t i = 0; i < sorted.size(); ++i)
-			sorted[i]->End = safe_time(sorted.begin() + i + 1, sorted.end(),
-				sorted[i], sorted[i]->End + leadOut,
-				&AssDialogue::Start, &std::min<int>);
+			sorted[i]->End = ends[i];
 	}
 
 	// Make adjacent
@@ -423,20 +510,40 @@ void DialogTimingProcessor::Process() {
 		if (auto provider = c->project->VideoProvider())
 			kf.push_back(provider->GetFrameCount() - 1);
 
+		// Look up the times of each keyframe once rather than once per line
+		std::vector<int> kf_start = fps.TimesAtFrames(kf, agi::vfr::START);
+		std::vector<int> kf_before(kf);
+		for (int& frame : kf_before) --frame;
+		std::vector<int> kf_end = fps.TimesAtFrames(kf_before, agi::vfr::END);
+
+		// Get start/end frames
+		std::vector<int> starts, ends;
+		starts.reserve(sorted.size());
+		ends.reserve(sorted.size());
 		for (AssDialogue *cur : sorted) {
-			// Get start/end frames
-			int startF = fps.FrameAtTime(cur->Start, agi::vfr::START);
-			int endF = fps.FrameAtTime(cur->End, agi::vfr::END);
+			starts.push_back(cur->Start);
+			ends.push_back(cur->End);
+		}
+		starts = fps.FramesAtTimes(starts, agi::vfr::START);
+		ends = fps.FramesAtTimes(ends, agi::vfr::END);
+
+		closest_kf_finder closest_start(kf), closest_end(kf);
+		for (size_t i = 0; i < sorted.size(); ++i) {
+			AssDialogue *cur = sorted[i];
+			int startF = starts[i];
+			int endF = ends[i];
 
 			// Get closest for start
-			int closest = get_closest_kf(kf, startF);
-			int time = fps.TimeAtFrame(closest, agi::vfr::START);
+			size_t idx = closest_start(startF);
+			int closest = kf[idx];
+			int time = kf_start[idx];
 			if ((closest > startF && time - cur->Start <= beforeStart) || (closest < startF && cur->Start - time <= afterStart))
 				cur->Start = time;
 
 			// Get closest for end
-			closest = get_closest_kf(kf, endF) - 1;
-			time = fps.TimeAtFrame(closest, agi::vfr::END);
+			idx = closest_end(endF);
+			closest = kf[idx] - 1;
+			time = kf_end[idx];
 			if ((closest > endF && time - cur->End <= beforeEnd) || (closest < endF && cur->End - time <= afterEnd))
 				cur->End = time;
 		}
@@ -262,6 +262,7 @@ void DialogTranslation::UpdateDisplay() {
 	original_text->SetReadOnly(true);
 
 	if (seek_video->IsChecked()) c->videoController->JumpToTime(active_line->Start);
+	c->videoController->PrefetchLinesAfter(active_line);
 
 	translated_text->ClearAll();
 	translated_text->SetFocus();
@@ -352,7 +352,8 @@ void DoCheck(bool interactive) {
 }
 
 void PerformVersionCheck(bool interactive) {
-	agi::dispatch::Background().Async([=]{
+	using agi::dispatch::Priority;
+	agi::dispatch::Background(interactive ? Priority::Interactive : Priority::Background).Async([=]{
 		if (!interactive) {
 			// Automatic checking enabled?
 			if (!OPT_GET("App/Auto/Check For Updates")->GetBool())
@@ -66,6 +66,7 @@ void ShowFontsCollectorDialog(agi::Context *c);
 void ShowJumpToDialog(agi::Context *c);
 void ShowKanjiTimerDialog(agi::Context *c);
 void ShowLogWindow(agi::Context *c);
+void ShowPerfWindow(agi::Context *c);
 void ShowPreferences(wxWindow *parent);
 void ShowPropertiesDialog(agi::Context *c);
 void ShowSelectLinesDialog(agi::Context *c);
@@ -47,13 +47,30 @@ AssFixStylesFilter::AssFixStylesFilter()
 {
 }
 
-void AssFixStylesFilter::ProcessSubs(AssFile *subs) {
+std::vector<std::string> AssFixStylesFilter::GetStyleNames(AssFile *subs) {
 	auto styles = subs->GetStyles();
 	for (auto& str : styles) boost::to_lower(str);
 	sort(begin(styles), end(styles));
+	return styles;
+}
+
+bool AssFixStylesFilter::FixLine(AssDialogue *line, std::vector<std::string> const& styles) {
+	if (binary_search(begin(styles), end(styles), boost::to_lower_copy(line->Style.get())))
+		return false;
+	line->Style = "Default";
+	return true;
+}
+
+bool AssFixStylesFilter::ProcessSubs(AssFile *subs) {
+	auto styles = GetStyleNames(subs);
+
+	bool changed = false;
+	for (auto& diag : subs->Events)
+		changed = FixLine(&diag, styles) || changed;
+	return changed;
+}
 
-	for (auto& diag : subs->Events) {
-		if (!binary_search(begin(styles), end(styles), boost::to_lower_copy(diag.Style.get())))
-			diag.Style = "Default";
-	}
+bool AssFixStylesFilter::BeginLines(AssFile *subs) {
+	styles = GetStyleNames(subs);
+	return true;
 }
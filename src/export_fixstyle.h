@@ -34,11 +34,26 @@
 
 #include "ass_export_filter.h"
 
+#include <string>
+#include <vector>
+
 /// @class AssFixStylesFilter
 /// @brief Fixes styles by replacing any style that isn't available on file with Default
 class AssFixStylesFilter final : public AssExportFilter {
+	/// Lowercased names of the styles in the file being processed, sorted
+	std::vector<std::string> styles;
+
+	/// Replace the line's style with Default if it doesn't exist
+	/// @return Was the line changed?
+	static bool FixLine(AssDialogue *line, std::vector<std::string> const& styles);
+
+	/// Get the sorted lowercased names of the styles in the file
+	static std::vector<std::string> GetStyleNames(AssFile *subs);
 public:
-	static void ProcessSubs(AssFile *subs);
+	/// @return Were any lines changed?
+	static bool ProcessSubs(AssFile *subs);
 	void ProcessSubs(AssFile *subs, wxWindow *) override { ProcessSubs(subs); }
+	bool BeginLines(AssFile *subs) override;
+	void ProcessLine(AssDialogue *line) override { FixLine(line, styles); }
 	AssFixStylesFilter();
 };
@@ -37,9 +37,11 @@
 #include "include/aegisub/context.h"
 #include "project.h"
 
+#include <libaegisub/dispatch.h>
 #include <libaegisub/of_type_adaptor.h>
 
 #include <utility>
+#include <vector>
 #include <wx/button.h>
 #include <wx/checkbox.h>
 #include <wx/panel.h>
@@ -59,6 +61,15 @@ void AssTransformFramerateFilter::ProcessSubs(AssFile *subs, wxWindow *) {
 	TransformFrameRate(subs);
 }
 
+bool AssTransformFramerateFilter::BeginLines(AssFile *) {
+	return true;
+}
+
+void AssTransformFramerateFilter::ProcessLine(AssDialogue *diag) {
+	if (Input.IsLoaded() && Output.IsLoaded())
+		TransformLine(diag, Output.FrameAtTime(diag->Start), Output.FrameAtTime(diag->End));
+}
+
 wxWindow *AssTransformFramerateFilter::GetConfigDialogWindow(wxWindow *parent, agi::Context *c) {
 	LoadSettings(true, c);
 
@@ -147,23 +158,27 @@ void AssTransformFramerateFilter::LoadSettings(bool is_default, agi::Context *c)
 	}
 }
 
+/// Lines below which transforming them isn't worth splitting up
+static const size_t min_lines_per_chunk = 256;
+
 /// Truncate a time to centisecond precision
 static int trunc_cs(int time) {
 	return (time / 10) * 10;
 }
 
-void AssTransformFramerateFilter::TransformTimeTags(std::string const& name, AssOverrideParameter *curParam, void *curData) {
+void AssTransformFramerateFilter::TransformTimeTags(AssTagId, AssOverrideParameter *curParam, void *curData) {
 	VariableDataType type = curParam->GetType();
 	if (type != VariableDataType::INT && type != VariableDataType::FLOAT) return;
 
-	AssTransformFramerateFilter *instance = static_cast<AssTransformFramerateFilter*>(curData);
-	AssDialogue *curDiag = instance->line;
+	auto state = static_cast<LineState *>(curData);
+	auto instance = state->filter;
+	AssDialogue *curDiag = state->line;
 
 	int parVal = curParam->Get<int>();
 
 	switch (curParam->classification) {
 		case AssParameterClass::RELATIVE_TIME_START: {
-			int value = instance->ConvertTime(trunc_cs(curDiag->Start) + parVal) - instance->newStart;
+			int value = instance->ConvertTime(trunc_cs(curDiag->Start) + parVal) - state->newStart;
 
 			// An end time of 0 is actually the end time of the line, so ensure
 			// nonzero is never converted to 0
@@ -175,13 +190,13 @@ void AssTransformFramerateFilter::TransformTimeTags(std::string const& name, Ass
 			break;
 		}
 		case AssParameterClass::RELATIVE_TIME_END:
-			curParam->Set(instance->newEnd - instance->ConvertTime(trunc_cs(curDiag->End) - parVal));
+			curParam->Set(state->newEnd - instance->ConvertTime(trunc_cs(curDiag->End) - parVal));
 			break;
 		case AssParameterClass::KARAOKE: {
-			int start = curDiag->Start / 10 + instance->oldK + parVal;
-			int value = (instance->ConvertTime(start * 10) - instance->newStart) / 10 - instance->newK;
-			instance->oldK += parVal;
-			instance->newK += value;
+			int start = curDiag->Start / 10 + state->oldK + parVal;
+			int value = (instance->ConvertTime(start * 10) - state->newStart) / 10 - state->newK;
+			state->oldK += parVal;
+			state->newK += value;
 			curParam->Set(value);
 			break;
 		}
@@ -192,25 +207,49 @@ void AssTransformFramerateFilter::TransformTimeTags(std::string const& name, Ass
 
 void AssTransformFramerateFilter::TransformFrameRate(AssFile *subs) {
 	if (!Input.IsLoaded() || !Output.IsLoaded()) return;
-	for (auto& curDialogue : subs->Events) {
-		line = &curDialogue;
-		newK = 0;
-		oldK = 0;
-		newStart = trunc_cs(ConvertTime(curDialogue.Start));
-		newEnd = trunc_cs(ConvertTime(curDialogue.End) + 9);
-
-		// Process stuff
-		auto blocks = line->ParseTags();
-		for (auto block : blocks | agi::of_type<AssDialogueBlockOverride>())
-			block->ProcessParameters(TransformTimeTags, this);
-		curDialogue.Start = newStart;
-		curDialogue.End = newEnd;
-		curDialogue.UpdateText(blocks);
+
+	// Look up the frames of all of the line start and end times in one go,
+	// as lines are mostly in order and so can share a walk over the timecodes
+	std::vector<int> times;
+	times.reserve(subs->Events.size() * 2);
+	for (auto const& diag : subs->Events) {
+		times.push_back(diag.Start);
+		times.push_back(diag.End);
 	}
+	auto frames = Output.FramesAtTimes(times);
+
+	std::vector<AssDialogue *> lines;
+	lines.reserve(subs->Events.size());
+	for (auto& diag : subs->Events)
+		lines.push_back(&diag);
+
+	// Lines are transformed independently of each other, and parsing and
+	// rebuilding their tags is most of the work, so split them up
+	agi::dispatch::ParallelFor(0, lines.size(), min_lines_per_chunk, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			TransformLine(lines[i], frames[i * 2], frames[i * 2 + 1]);
+	});
+}
+
+void AssTransformFramerateFilter::TransformLine(AssDialogue *diag, int start_frame, int end_frame) const {
+	LineState state{this, diag, 0, 0, 0, 0};
+	state.newStart = trunc_cs(ConvertTime(diag->Start, start_frame));
+	state.newEnd = trunc_cs(ConvertTime(diag->End, end_frame) + 9);
+
+	// Process stuff
+	auto blocks = diag->ParseTags();
+	for (auto block : blocks | agi::of_type<AssDialogueBlockOverride>())
+		block->ProcessParameters(TransformTimeTags, &state);
+	diag->Start = state.newStart;
+	diag->End = state.newEnd;
+	diag->UpdateText(blocks);
+}
+
+int AssTransformFramerateFilter::ConvertTime(int time) const {
+	return ConvertTime(time, Output.FrameAtTime(time));
 }
 
-int AssTransformFramerateFilter::ConvertTime(int time) {
-	int frame = Output.FrameAtTime(time);
+int AssTransformFramerateFilter::ConvertTime(int time, int frame) const {
 	int frameStart = Output.TimeAtFrame(frame);
 	int frameEnd = Output.TimeAtFrame(frame + 1);
 	int frameDur = frameEnd - frameStart;
@@ -33,6 +33,7 @@
 
 class AssDialogue;
 class AssOverrideParameter;
+enum class AssTagId : unsigned char;
 class wxCheckBox;
 class wxRadioButton;
 class wxTextCtrl;
@@ -41,11 +42,17 @@ class wxTextCtrl;
 /// @brief Transform subtitle times, including those in override tags, from an input framerate to an output framerate
 class AssTransformFramerateFilter final : public AssExportFilter {
 	agi::Context *c = nullptr;
-	AssDialogue *line = nullptr;
-	int newStart = 0;
-	int newEnd = 0;
-	int newK = 0;
-	int oldK = 0;
+
+	/// State of the transformation of one line, so that lines can be
+	/// transformed on several threads at once
+	struct LineState {
+		const AssTransformFramerateFilter *filter;
+		AssDialogue *line;
+		int newStart;
+		int newEnd;
+		int newK;
+		int oldK;
+	};
 
 	// Yes, these are backwards. It sort of makes sense if you think about what it's doing.
 	agi::vfr::Framerate Input;  ///< Destination frame rate
@@ -62,11 +69,16 @@ class AssTransformFramerateFilter final : public AssExportFilter {
 	/// @brief Apply the transformation to a file
 	/// @param subs File to process
 	void TransformFrameRate(AssFile *subs);
+	/// @brief Apply the transformation to a single line
+	/// @param diag Line to process
+	/// @param start_frame Frame of the line's start time in the source frame rate
+	/// @param end_frame Frame of the line's end time in the source frame rate
+	void TransformLine(AssDialogue *diag, int start_frame, int end_frame) const;
 	/// @brief Transform a single tag
 	/// @param name Name of the tag
 	/// @param curParam Current parameter being processed
-	/// @param userdata Filter instance
-	static void TransformTimeTags(std::string const& name, AssOverrideParameter *curParam, void *userdata);
+	/// @param userdata LineState of the line being transformed
+	static void TransformTimeTags(AssTagId, AssOverrideParameter *curParam, void *userdata);
 
 	/// @brief Convert a time from the input frame rate to the output frame rate
 	/// @param time Time in ms to convert
@@ -76,10 +88,15 @@ class AssTransformFramerateFilter final : public AssExportFilter {
 	///   1. The frame number
 	///   2. The relative distance between the beginning of the frame which time
 	///      is in and the beginning of the next frame
-	int ConvertTime(int time);
+	int ConvertTime(int time) const;
+
+	/// ConvertTime for a time whose frame in the output frame rate is already known
+	int ConvertTime(int time, int frame) const;
 public:
 	AssTransformFramerateFilter();
 	void ProcessSubs(AssFile *subs, wxWindow *) override;
+	bool BeginLines(AssFile *subs) override;
+	void ProcessLine(AssDialogue *line) override;
 	wxWindow *GetConfigDialogWindow(wxWindow *parent, agi::Context *c) override;
 	void LoadSettings(bool is_default, agi::Context *c) override;
 };
@@ -42,11 +42,14 @@
 
 #include <libaegisub/background_runner.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/log.h>
 #include <libaegisub/path.h>
+#include <libaegisub/perf.h>
 
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/crc.hpp>
 #include <boost/filesystem/path.hpp>
+#include <mutex>
 #include <wx/intl.h>
 #include <wx/choicdlg.h>
 
@@ -70,11 +73,26 @@ FFmpegSourceProvider::FFmpegSourceProvider(agi::BackgroundRunner *br)
 	FFMS_Init(0, 0);
 }
 
+namespace {
+/// The index most recently read or created, and the cache file it belongs to
+std::mutex last_index_mutex;
+agi::fs::path last_index_name;
+std::shared_ptr<FFMS_Index> last_index;
+
+std::shared_ptr<FFMS_Index> RememberIndex(agi::fs::path const& CacheName, FFMS_Index *Index) {
+	std::shared_ptr<FFMS_Index> shared(Index, [](FFMS_Index *index) { FFMS_DestroyIndex(index); });
+	std::lock_guard<std::mutex> lock(last_index_mutex);
+	last_index_name = CacheName;
+	last_index = shared;
+	return shared;
+}
+}
+
 /// @brief Does indexing of a source file
 /// @param Indexer		A pointer to the indexer object representing the file to be indexed
 /// @param CacheName    The filename of the output index file
 /// @param Trackmask    A binary mask of the track numbers to index
-FFMS_Index *FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
+std::shared_ptr<FFMS_Index> FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
 	                                         agi::fs::path const& CacheName,
 	                                         TrackSelection Track,
 	                                         FFMS_IndexErrorHandling IndexEH) {
@@ -119,7 +137,7 @@ FFMS_Index *FFmpegSourceProvider::DoIndexing(FFMS_Indexer *Indexer,
 	// write index to disk for later use
 	FFMS_WriteIndex(CacheName.string().c_str(), Index, &ErrInfo);
 
-	return Index;
+	return RememberIndex(CacheName, Index);
 }
 
 /// @brief Finds all tracks of the given type and return their track numbers and respective codec names
@@ -204,6 +222,25 @@ FFMS_IndexErrorHandling FFmpegSourceProvider::GetErrorHandlingMode() {
 	return FFMS_IEH_STOP_TRACK; // questionable default?
 }
 
+namespace {
+agi::perf::Counter& memory_hits = agi::perf::GetCounter("ffms/index cache/memory hits");
+agi::perf::Counter& cache_hits = agi::perf::GetCounter("ffms/index cache/hits");
+agi::perf::Counter& cache_misses = agi::perf::GetCounter("ffms/index cache/misses");
+
+/// Is the index cache in a directory chosen by the user, which may be shared
+/// with other machines, rather than the per-user default?
+bool SharedCache() {
+	return OPT_GET("Provider/FFmpegSource/Cache/Location")->GetString() != "default";
+}
+
+agi::fs::path CacheDirectory() {
+	auto location = OPT_GET("Provider/FFmpegSource/Cache/Location")->GetString();
+	if (location == "default")
+		return config::path->Decode("?local/ffms2cache/");
+	return config::path->MakeAbsolute(config::path->Decode(location), "?user");
+}
+}
+
 /// @brief	Generates an unique name for the ffms2 index file and prepares the cache folder if it doesn't exist
 /// @param filename	The name of the source file
 /// @return			Returns the generated filename.
@@ -211,12 +248,15 @@ agi::fs::path FFmpegSourceProvider::GetCacheFilename(agi::fs::path const& filena
 	// Get the size of the file to be hashed
 	uintmax_t len = agi::fs::Size(filename);
 
-	// Get the hash of the filename
+	// Get the hash of the filename. A shared cache is reached through
+	// different paths on each machine, so only the name of the file itself
+	// can be used there.
+	auto name = SharedCache() ? filename.filename().string() : filename.string();
 	boost::crc_32_type hash;
-	hash.process_bytes(filename.string().c_str(), filename.string().size());
+	hash.process_bytes(name.c_str(), name.size());
 
 	// Generate the filename
-	auto result = config::path->Decode("?local/ffms2cache/" + std::to_string(hash.checksum()) + "_" + std::to_string(len) + "_" + std::to_string(agi::fs::ModifiedTime(filename)) + ".ffindex");
+	auto result = CacheDirectory() / (std::to_string(hash.checksum()) + "_" + std::to_string(len) + "_" + std::to_string(agi::fs::ModifiedTime(filename)) + ".ffindex");
 
 	// Ensure that folder exists
 	agi::fs::CreateDirectory(result.parent_path());
@@ -224,8 +264,46 @@ agi::fs::path FFmpegSourceProvider::GetCacheFilename(agi::fs::path const& filena
 	return result;
 }
 
+std::shared_ptr<FFMS_Index> FFmpegSourceProvider::ReadCachedIndex(agi::fs::path const& filename, agi::fs::path const& CacheName) {
+	{
+		std::lock_guard<std::mutex> lock(last_index_mutex);
+		if (last_index && last_index_name == CacheName) {
+			LOG_I("ffms/cache") << "memory hit " << CacheName;
+			memory_hits.Add();
+			return last_index;
+		}
+	}
+
+	char FFMSErrMsg[1024];
+	FFMS_ErrorInfo ErrInfo;
+	ErrInfo.Buffer		= FFMSErrMsg;
+	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
+	ErrInfo.ErrorType	= FFMS_ERROR_SUCCESS;
+	ErrInfo.SubType		= FFMS_ERROR_SUCCESS;
+
+	FFMS_Index *Index = FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo);
+
+	// The name of the index already includes the full path, size and
+	// modification time of the file, so it only needs to be checked against
+	// the file's contents when other files could have the same name, which
+	// saves reading the file (possibly over the network) on every open
+	if (Index && SharedCache() && FFMS_IndexBelongsToFile(Index, filename.string().c_str(), &ErrInfo)) {
+		FFMS_DestroyIndex(Index);
+		Index = nullptr;
+	}
+
+	(Index ? cache_hits : cache_misses).Add();
+	LOG_I("ffms/cache") << (Index ? "hit " : "miss ") << CacheName
+		<< " (" << cache_hits.Get() << " hits, " << cache_misses.Get() << " misses)";
+
+	if (!Index) return nullptr;
+	return RememberIndex(CacheName, Index);
+}
+
 void FFmpegSourceProvider::CleanCache() {
-	::CleanCache(config::path->Decode("?local/ffms2cache/"),
+	// Opening a file touches its index, so removing the oldest files first
+	// drops the least recently used indexes
+	::CleanCache(CacheDirectory(),
 		"*.ffindex",
 		OPT_GET("Provider/FFmpegSource/Cache/Size")->GetInt(),
 		OPT_GET("Provider/FFmpegSource/Cache/Files")->GetInt());
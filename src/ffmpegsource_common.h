@@ -34,6 +34,7 @@
 
 #ifdef WITH_FFMS2
 #include <map>
+#include <memory>
 
 #include <ffms.h>
 
@@ -61,12 +62,19 @@ public:
 
 	void CleanCache();
 
-	FFMS_Index *DoIndexing(FFMS_Indexer *Indexer, agi::fs::path const& Cachename,
+	std::shared_ptr<FFMS_Index> DoIndexing(FFMS_Indexer *Indexer, agi::fs::path const& Cachename,
 		                   TrackSelection Track,
 		                   FFMS_IndexErrorHandling IndexEH);
 	std::map<int, std::string> GetTracksOfType(FFMS_Indexer *Indexer, FFMS_TrackType Type);
 	TrackSelection AskForTrackSelection(const std::map<int, std::string>& TrackList, FFMS_TrackType Type);
 	agi::fs::path GetCacheFilename(agi::fs::path const& filename);
+	/// Read the cached index for a file, if there is a usable one
+	///
+	/// The most recently read or created index is also kept in memory, so
+	/// that opening the audio from a video which was just opened reuses the
+	/// video's index rather than reading it back from the cache.
+	/// @return The index, or nullptr on a cache miss
+	std::shared_ptr<FFMS_Index> ReadCachedIndex(agi::fs::path const& filename, agi::fs::path const& CacheName);
 	void SetLogLevel();
 	FFMS_IndexErrorHandling GetErrorHandlingMode();
 };
@@ -41,6 +41,87 @@
 
 #include <cmath>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AGI_FFT_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AGI_FFT_NEON
+#endif
+
+namespace {
+/// Radix-2 butterflies between a and b for one group of a pass
+/// @param count Number of butterflies, which is the span of the pass
+void Butterflies(float *ar, float *ai, float *br, float *bi, const float *wr, const float *wi, size_t count) {
+	size_t n = 0;
+#if defined(AGI_FFT_SSE)
+	for (; n + 4 <= count; n += 4) {
+		__m128 vwr = _mm_loadu_ps(wr + n), vwi = _mm_loadu_ps(wi + n);
+		__m128 vbr = _mm_loadu_ps(br + n), vbi = _mm_loadu_ps(bi + n);
+		__m128 var = _mm_loadu_ps(ar + n), vai = _mm_loadu_ps(ai + n);
+		__m128 tr = _mm_sub_ps(_mm_mul_ps(vwr, vbr), _mm_mul_ps(vwi, vbi));
+		__m128 ti = _mm_add_ps(_mm_mul_ps(vwr, vbi), _mm_mul_ps(vwi, vbr));
+		_mm_storeu_ps(br + n, _mm_sub_ps(var, tr));
+		_mm_storeu_ps(bi + n, _mm_sub_ps(vai, ti));
+		_mm_storeu_ps(ar + n, _mm_add_ps(var, tr));
+		_mm_storeu_ps(ai + n, _mm_add_ps(vai, ti));
+	}
+#elif defined(AGI_FFT_NEON)
+	for (; n + 4 <= count; n += 4) {
+		float32x4_t vwr = vld1q_f32(wr + n), vwi = vld1q_f32(wi + n);
+		float32x4_t vbr = vld1q_f32(br + n), vbi = vld1q_f32(bi + n);
+		float32x4_t var = vld1q_f32(ar + n), vai = vld1q_f32(ai + n);
+		float32x4_t tr = vsubq_f32(vmulq_f32(vwr, vbr), vmulq_f32(vwi, vbi));
+		float32x4_t ti = vaddq_f32(vmulq_f32(vwr, vbi), vmulq_f32(vwi, vbr));
+		vst1q_f32(br + n, vsubq_f32(var, tr));
+		vst1q_f32(bi + n, vsubq_f32(vai, ti));
+		vst1q_f32(ar + n, vaddq_f32(var, tr));
+		vst1q_f32(ai + n, vaddq_f32(vai, ti));
+	}
+#endif
+	for (; n < count; ++n) {
+		float tr = wr[n] * br[n] - wi[n] * bi[n];
+		float ti = wr[n] * bi[n] + wi[n] * br[n];
+		br[n] = ar[n] - tr;
+		bi[n] = ai[n] - ti;
+		ar[n] += tr;
+		ai[n] += ti;
+	}
+}
+}
+
+void FFT::PrepareTables(size_t n_samples) {
+	if (table_size == n_samples) return;
+
+	const double pi = 3.1415926535897932384626433832795;
+	const size_t half = n_samples / 2;
+	const unsigned int bits = NumberOfBitsNeeded(half);
+
+	bit_reverse.resize(half);
+	for (size_t i = 0; i < half; ++i)
+		bit_reverse[i] = ReverseBits(i, bits);
+
+	twiddle_r.resize(half);
+	twiddle_i.resize(half);
+	for (size_t span = 1; span < half; span <<= 1) {
+		for (size_t n = 0; n < span; ++n) {
+			double angle = -pi * n / span;
+			twiddle_r[span - 1 + n] = (float)cos(angle);
+			twiddle_i[span - 1 + n] = (float)sin(angle);
+		}
+	}
+
+	split_r.resize(half / 2 + 1);
+	split_i.resize(half / 2 + 1);
+	for (size_t k = 0; k <= half / 2; ++k) {
+		double angle = -2 * pi * k / n_samples;
+		split_r[k] = (float)cos(angle);
+		split_i[k] = (float)sin(angle);
+	}
+
+	table_size = n_samples;
+}
+
 void FFT::DoTransform (size_t n_samples,float *input,float *output_r,float *output_i,bool inverse) {
 	if (!IsPowerOfTwo(n_samples))
 		throw agi::InternalError("FFT requires power of two input.");
@@ -119,7 +200,60 @@ void FFT::DoTransform (size_t n_samples,float *input,float *output_r,float *outp
 }
 
 void FFT::Transform(size_t n_samples,float *input,float *output_r,float *output_i) {
-	DoTransform(n_samples,input,output_r,output_i,false);
+	if (!IsPowerOfTwo(n_samples))
+		throw agi::InternalError("FFT requires power of two input.");
+	if (n_samples < 4)
+		return DoTransform(n_samples,input,output_r,output_i,false);
+
+	PrepareTables(n_samples);
+
+	// The even samples are treated as the real part and the odd samples as the
+	// imaginary part of a complex signal of half the length, which is
+	// transformed in the first half of the output buffers
+	const size_t half = n_samples / 2;
+	for (size_t i = 0; i < half; ++i) {
+		output_r[bit_reverse[i]] = input[2 * i];
+		output_i[bit_reverse[i]] = input[2 * i + 1];
+	}
+
+	for (size_t span = 1; span < half; span <<= 1) {
+		const float *wr = &twiddle_r[span - 1];
+		const float *wi = &twiddle_i[span - 1];
+		for (size_t i = 0; i < half; i += 2 * span)
+			Butterflies(output_r + i, output_i + i, output_r + i + span, output_i + i + span, wr, wi, span);
+	}
+
+	// Separate the transforms of the even and odd samples and combine them
+	// into the transform of the whole input, working inwards from both ends
+	float z0r = output_r[0], z0i = output_i[0];
+	output_r[0] = z0r + z0i;
+	output_i[0] = 0;
+	output_r[half] = z0r - z0i;
+	output_i[half] = 0;
+
+	for (size_t k = 1; k <= half / 2; ++k) {
+		float ar = output_r[k], ai = output_i[k];
+		float br = output_r[half - k], bi = -output_i[half - k];
+
+		float er = (ar + br) / 2, ei = (ai + bi) / 2;
+		float or_ = (ai - bi) / 2, oi = (br - ar) / 2;
+		float tr = split_r[k] * or_ - split_i[k] * oi;
+		float ti = split_r[k] * oi + split_i[k] * or_;
+
+		output_r[k] = er + tr;
+		output_i[k] = ei + ti;
+		output_r[half - k] = er - tr;
+		output_i[half - k] = ti - ei;
+	}
+
+	// Fill in the upper half from the symmetry of the transform of real
+	// input, and conjugate the lower half to keep the sign convention of the
+	// complex transform
+	for (size_t k = 1; k < half; ++k) {
+		output_r[n_samples - k] = output_r[k];
+		output_i[n_samples - k] = output_i[k];
+		output_i[k] = -output_i[k];
+	}
 }
 
 void FFT::InverseTransform(size_t n_samples,float *input,float *output_r,float *output_i) {
@@ -28,11 +28,31 @@
 // Aegisub Project http://www.aegisub.org/
 
 #include <cstdlib>
+#include <vector>
 
 class FFT {
+	/// Number of real samples the tables below were built for
+	size_t table_size = 0;
+	/// Bit-reversal permutation for the half-size complex transform
+	std::vector<unsigned int> bit_reverse;
+	/// Twiddle factors for each pass of the complex transform, with the
+	/// factors for the pass with butterflies of span h starting at h-1
+	std::vector<float> twiddle_r, twiddle_i;
+	/// Twiddle factors for splitting the complex transform into the real one
+	std::vector<float> split_r, split_i;
+
+	void PrepareTables(size_t n_samples);
 	void DoTransform(size_t n_samples,float *input,float *output_r,float *output_i,bool inverse);
 
 public:
+	/// @brief Transform real input to the frequency domain
+	/// @param n_samples Number of samples, which must be a power of two
+	/// @param input     Samples to transform
+	/// @param output_r  Real part of the n_samples outputs
+	/// @param output_i  Imaginary part of the n_samples outputs
+	///
+	/// Tables are computed for the first use of each size, so reuse an FFT
+	/// object for repeated transforms of the same size.
 	void Transform(size_t n_samples,float *input,float *output_r,float *output_i);
 	void InverseTransform(size_t n_samples,float *input,float *output_r,float *output_i);
 	bool IsPowerOfTwo(unsigned int x);
@@ -19,9 +19,9 @@
 #include <boost/flyweight.hpp>
 
 namespace std {
-	template <typename T>
-	struct hash<boost::flyweight<T>> {
-		size_t operator()(boost::flyweight<T> const& ss) const {
+	template <typename T, typename... Args>
+	struct hash<boost::flyweight<T, Args...>> {
+		size_t operator()(boost::flyweight<T, Args...> const& ss) const {
 			return hash<const void*>()(&ss.get());
 		}
 	};
@@ -26,11 +26,17 @@
 #include <libaegisub/format_path.h>
 
 #include <algorithm>
+#include <exception>
+#include <iterator>
+#include <thread>
 #include <tuple>
 #include <unicode/uchar.h>
 #include <wx/intl.h>
 
 namespace {
+/// Lines per thread below which scanning isn't worth splitting up
+const size_t min_lines_per_thread = 1024;
+
 wxString format_missing(wxString const& str) {
 	wxString printable;
 	wxString unprintable;
@@ -59,13 +65,12 @@ FontCollector::FontCollector(FontCollectorStatusCallback status_callback)
 {
 }
 
-void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index) {
+void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index, LineScan &scan) const {
 	if (line->Comment) return;
 
 	auto style_it = styles.find(line->Style);
 	if (style_it == end(styles)) {
-		status_callback(fmt_tl("Style '%s' does not exist\n", line->Style), 2);
-		++missing;
+		scan.missing_styles.push_back(line->Style);
 		return;
 	}
 
@@ -74,25 +79,31 @@ void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index) {
 
 	bool overriden = false;
 
-	for (auto& block : line->ParseTags()) {
+	for (auto& block : *line->ParsedTags()) {
 		switch (block->GetType()) {
 		case AssBlockType::OVERRIDE:
-			for (auto const& tag : static_cast<AssDialogueBlockOverride&>(*block).Tags) {
-				if (tag.Name == "\\r") {
-					style = styles[tag.Params[0].Get(line->Style.get())];
-					overriden = false;
-				}
-				else if (tag.Name == "\\b") {
-					style.bold = tag.Params[0].Get(initial.bold);
-					overriden = true;
-				}
-				else if (tag.Name == "\\i") {
-					style.italic = tag.Params[0].Get(initial.italic);
-					overriden = true;
-				}
-				else if (tag.Name == "\\fn") {
-					style.facename = tag.Params[0].Get(initial.facename);
-					overriden = true;
+			for (auto const& tag : static_cast<const AssDialogueBlockOverride&>(*block).Tags) {
+				switch (tag.Id) {
+					case AssTagId::R: {
+						auto reset = styles.find(tag.Params[0].Get(line->Style.get()));
+						style = reset != end(styles) ? reset->second : StyleInfo{};
+						overriden = false;
+						break;
+					}
+					case AssTagId::B:
+						style.bold = tag.Params[0].Get(initial.bold);
+						overriden = true;
+						break;
+					case AssTagId::I:
+						style.italic = tag.Params[0].Get(initial.italic);
+						overriden = true;
+						break;
+					case AssTagId::FN:
+						style.facename = tag.Params[0].Get(initial.facename);
+						overriden = true;
+						break;
+					default:
+						break;
 				}
 			}
 			break;
@@ -102,7 +113,7 @@ void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index) {
 			if (text.empty())
 				continue;
 
-			auto& usage = used_styles[style];
+			auto& usage = scan.used_styles[style];
 
 			if (overriden) {
 				auto& lines = usage.lines;
@@ -133,9 +144,6 @@ void FontCollector::ProcessDialogueLine(const AssDialogue *line, int index) {
 				U8_NEXT(&text[0], i, size, c);
 				chars.push_back(c);
 			}
-
-			sort(begin(chars), end(chars));
-			chars.erase(unique(chars.begin(), chars.end()), chars.end());
 			break;
 		}
 		case AssBlockType::DRAWING:
@@ -212,9 +220,66 @@ std::vector<agi::fs::path> FontCollector::GetFontPaths(const AssFile *file) {
 		used_styles[info].styles.push_back(style.name);
 	}
 
-	int index = 0;
+	// Lines are scanned independently of each other, so ranges of them can
+	// be done on separate threads and then merged in line order
+	std::vector<const AssDialogue *> lines;
 	for (auto const& diag : file->Events)
-		ProcessDialogueLine(&diag, ++index);
+		lines.push_back(&diag);
+
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+		lines.size() / min_lines_per_thread);
+	threads = std::max<size_t>(threads, 1);
+
+	std::vector<LineScan> scans(threads);
+	std::vector<std::exception_ptr> errors(threads);
+	auto scan_range = [&](size_t t) {
+		size_t end = lines.size() * (t + 1) / threads;
+		try {
+			for (size_t i = lines.size() * t / threads; i < end; ++i)
+				ProcessDialogueLine(lines[i], i + 1, scans[t]);
+			for (auto& style : scans[t].used_styles) {
+				auto& chars = style.second.chars;
+				sort(chars.begin(), chars.end());
+				chars.erase(unique(chars.begin(), chars.end()), chars.end());
+			}
+		}
+		catch (...) {
+			errors[t] = std::current_exception();
+		}
+	};
+
+	if (threads == 1)
+		scan_range(0);
+	else {
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+		for (size_t t = 0; t < threads; ++t)
+			workers.emplace_back(scan_range, t);
+		for (auto& worker : workers)
+			worker.join();
+	}
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+
+	for (auto& scan : scans) {
+		for (auto const& style : scan.missing_styles) {
+			status_callback(fmt_tl("Style '%s' does not exist\n", style), 2);
+			++missing;
+		}
+
+		for (auto& style : scan.used_styles) {
+			auto& usage = used_styles[style.first];
+			auto& scanned = style.second;
+			usage.lines.insert(usage.lines.end(), scanned.lines.begin(), scanned.lines.end());
+
+			std::vector<int> chars;
+			chars.reserve(usage.chars.size() + scanned.chars.size());
+			std::set_union(usage.chars.begin(), usage.chars.end(),
+				scanned.chars.begin(), scanned.chars.end(), back_inserter(chars));
+			usage.chars = std::move(chars);
+		}
+	}
 
 	status_callback(_("Searching for font files\n"), 0);
 	for (auto const& style : used_styles) ProcessChunk(style);
@@ -147,8 +147,18 @@ class FontCollector {
 	/// Number of fonts which were found, but did not contain all used glyphs
 	int missing_glyphs = 0;
 
+	/// Styles and characters used by a range of lines
+	struct LineScan {
+		std::map<StyleInfo, UsageData> used_styles;
+		/// Names of styles used by lines which don't exist, in line order
+		std::vector<std::string> missing_styles;
+	};
+
 	/// Gather all of the unique styles with text on a line
-	void ProcessDialogueLine(const AssDialogue *line, int index);
+	///
+	/// Characters are added to the scan unsorted and possibly duplicated. This
+	/// only reads the collector's state, so lines can be scanned concurrently.
+	void ProcessDialogueLine(const AssDialogue *line, int index, LineScan &scan) const;
 
 	/// Get the font for a single style
 	void ProcessChunk(std::pair<StyleInfo, UsageData> const& style);
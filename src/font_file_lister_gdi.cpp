@@ -17,11 +17,16 @@
 #include "font_file_lister.h"
 
 #include "compat.h"
+#include "options.h"
 
+#include <libaegisub/cajun/elements.h>
+#include <libaegisub/cajun/reader.h>
+#include <libaegisub/cajun/writer.h>
 #include <libaegisub/charset_conv_win.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/io.h>
 #include <libaegisub/log.h>
+#include <libaegisub/path.h>
 
 #include <ShlObj.h>
 #include <boost/scope_exit.hpp>
@@ -97,21 +102,94 @@ std::vector<agi::fs::path> get_installed_fonts() {
 
 using font_index = std::unordered_multimap<uint32_t, agi::fs::path>;
 
+/// Prefix hash of a font file, along with what the file looked like when it
+/// was hashed so that stale entries can be spotted
+struct cached_hash {
+	uint32_t hash;
+	json::Integer modified;
+	json::Integer size;
+};
+
+using hash_cache = std::unordered_map<std::string, cached_hash>;
+
+hash_cache load_hash_cache(agi::fs::path const& filename) {
+	hash_cache cache;
+	try {
+		json::UnknownElement root;
+		json::Reader::Read(root, *agi::io::Open(filename));
+		for (json::Object& entry : static_cast<json::Array&>(root)) {
+			std::string const& path = entry["path"];
+			json::Integer hash = entry["hash"];
+			cache[path] = cached_hash{(uint32_t)hash, entry["modified"], entry["size"]};
+		}
+	}
+	catch (agi::fs::FileSystemError const& e) {
+		LOG_D("font_lister/load_cache") << "Cannot load font index: " << e.GetMessage();
+	}
+	catch (json::Exception const& e) {
+		LOG_D("font_lister/load_cache") << "Cannot load font index: " << e.what();
+	}
+	return cache;
+}
+
+void save_hash_cache(agi::fs::path const& filename, hash_cache const& cache) {
+	json::Array root;
+	root.reserve(cache.size());
+	for (auto const& file : cache) {
+		json::Object entry;
+		entry["path"] = file.first;
+		entry["hash"] = (json::Integer)file.second.hash;
+		entry["modified"] = file.second.modified;
+		entry["size"] = file.second.size;
+		root.push_back(std::move(entry));
+	}
+
+	try {
+		agi::JsonWriter::Write(root, agi::io::Save(filename).Get());
+	}
+	catch (agi::fs::FileSystemError const& e) {
+		LOG_E("font_lister/save_cache") << "Cannot save font index: " << e.GetMessage();
+	}
+}
+
 font_index index_fonts(FontCollectorStatusCallback &cb) {
+	// Hashing means opening every installed font, which is very slow with
+	// large font directories, so the hashes are kept between runs and only
+	// redone for files which have changed since
+	auto cache_filename = config::path->Decode("?local/font_index.json");
+	auto old_cache = load_hash_cache(cache_filename);
+	hash_cache new_cache;
+	bool changed = false;
+
 	font_index hash_to_path;
 	auto fonts = get_installed_fonts();
 	std::unique_ptr<char[]> buffer(new char[1024]);
 	for (auto const& path : fonts) {
 		try {
+			json::Integer modified = agi::fs::ModifiedTime(path);
+			json::Integer size = agi::fs::Size(path);
+
+			auto cached = old_cache.find(path.string());
+			if (cached != old_cache.end() && cached->second.modified == modified && cached->second.size == size) {
+				hash_to_path.emplace(cached->second.hash, path);
+				new_cache.emplace(path.string(), cached->second);
+				continue;
+			}
+
 			auto stream = agi::io::Open(path, true);
 			stream->read(&buffer[0], 1024);
 			auto hash = murmur3(&buffer[0], stream->tellg());
 			hash_to_path.emplace(hash, path);
+			new_cache.emplace(path.string(), cached_hash{hash, modified, size});
+			changed = true;
 		}
 		catch (agi::Exception const& e) {
 			cb(to_wx(e.GetMessage() + "\n"), 3);
 		}
 	}
+
+	if (changed || new_cache.size() != old_cache.size())
+		save_hash_cache(cache_filename, new_cache);
 	return hash_to_path;
 }
 
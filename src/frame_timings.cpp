@@ -0,0 +1,64 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "frame_timings.h"
+
+#include <libaegisub/io.h>
+
+#include <algorithm>
+
+void FrameTimingLog::Add(FrameTimings const& timings) {
+	if (entries.size() < capacity) {
+		entries.push_back(timings);
+		return;
+	}
+	entries[next] = timings;
+	next = (next + 1) % capacity;
+}
+
+void FrameTimingLog::Summarize(size_t count, FrameTimings &average, FrameTimings &maximum) const {
+	average = maximum = FrameTimings();
+	count = std::min(count, entries.size());
+	if (!count) return;
+
+	// The newest entry is just before next, wrapping around to the end
+	for (size_t i = 0; i < count; ++i) {
+		auto const& t = entries[(next + entries.size() - 1 - i) % entries.size()];
+		average.decode += t.decode;
+		average.subtitles += t.subtitles;
+		average.blend += t.blend;
+		average.upload += t.upload;
+		maximum.decode = std::max(maximum.decode, t.decode);
+		maximum.subtitles = std::max(maximum.subtitles, t.subtitles);
+		maximum.blend = std::max(maximum.blend, t.blend);
+		maximum.upload = std::max(maximum.upload, t.upload);
+	}
+
+	average.decode /= count;
+	average.subtitles /= count;
+	average.blend /= count;
+	average.upload /= count;
+}
+
+void FrameTimingLog::WriteCSV(agi::fs::path const& filename) const {
+	agi::io::Save file(filename);
+	auto& out = file.Get();
+	out << "frame,decode,subtitles,blend,upload\n";
+	for (size_t i = 0; i < entries.size(); ++i) {
+		auto const& t = entries[(next + i) % entries.size()];
+		out << t.frame << ',' << t.decode << ',' << t.subtitles << ',' << t.blend << ',' << t.upload << '\n';
+	}
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/fs_fwd.h>
+
+#include <chrono>
+#include <vector>
+
+/// Milliseconds spent on each stage of getting a frame onto the screen
+struct FrameTimings {
+	/// Frame number, or -1 if unknown
+	int frame = -1;
+	/// Getting the frame from the video provider
+	double decode = 0;
+	/// Loading and rendering the subtitles
+	double subtitles = 0;
+	/// Copying or converting the frame and compositing the subtitles onto it
+	double blend = 0;
+	/// Uploading the frame to the video card
+	double upload = 0;
+};
+
+/// Measures the time since it was created or last restarted
+class StageTimer {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+	/// Milliseconds since the timer was started
+	double Elapsed() const {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	/// Get the elapsed time and start again
+	double Restart() {
+		auto now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double, std::milli>(now - start).count();
+		start = now;
+		return elapsed;
+	}
+};
+
+/// @class FrameTimingLog
+/// @brief Timings of the most recently displayed frames
+class FrameTimingLog {
+	std::vector<FrameTimings> entries;
+	/// Index in entries of the oldest entry once it's full
+	size_t next = 0;
+
+public:
+	/// Number of frames which are remembered
+	static const size_t capacity = 1000;
+
+	/// Record the timings of a frame which has been displayed
+	void Add(FrameTimings const& timings);
+
+	/// Number of frames currently in the log
+	size_t size() const { return entries.size(); }
+
+	/// @brief Get the average and maximum time of each stage
+	/// @param count Number of most recent frames to look at
+	/// @param[out] average Average time of each stage
+	/// @param[out] maximum Longest time of each stage
+	void Summarize(size_t count, FrameTimings &average, FrameTimings &maximum) const;
+
+	/// Write every frame in the log to a CSV file, oldest first
+	void WriteCSV(agi::fs::path const& filename) const;
+};
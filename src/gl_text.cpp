@@ -77,35 +77,60 @@ struct OpenGLTextGlyph {
 		dc.SetFont(font);
 		dc.GetTextExtent(str, &w, &h, &desc, &lead);
 	}
+};
 
-	void Draw(float x, float y) const {
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+/// @class OpenGLTextBatch
+/// @brief Glyph quads queued to be drawn together, one set per texture
+class OpenGLTextBatch {
+	struct Quads {
+		int tex;
+		std::vector<float> vertices;
+		std::vector<float> tex_coords;
+	};
+	std::vector<Quads> quads;
 
-		float tex_coords[] = {
-			x1, y1,
-			x1, y2,
-			x2, y2,
-			x2, y1
-		};
+public:
+	/// Queue the quad for drawing a glyph at the given position
+	void Add(OpenGLTextGlyph const& glyph, float x, float y) {
+		auto it = std::find_if(begin(quads), end(quads), [&](Quads const& q) { return q.tex == glyph.tex; });
+		if (it == end(quads)) {
+			quads.push_back(Quads{glyph.tex, {}, {}});
+			it = end(quads) - 1;
+		}
 
-		float vert_coords[] = {
+		it->tex_coords.insert(it->tex_coords.end(), {
+			glyph.x1, glyph.y1,
+			glyph.x1, glyph.y2,
+			glyph.x2, glyph.y2,
+			glyph.x2, glyph.y1
+		});
+		it->vertices.insert(it->vertices.end(), {
 			x, y,
-			x, y + h,
-			x + w, y + h,
-			x + w, y
-		};
-
-		glVertexPointer(2, GL_FLOAT, 0, vert_coords);
-		glTexCoordPointer(2, GL_FLOAT, 0, tex_coords);
-		glDrawArrays(GL_QUADS, 0, 4);
+			x, y + glyph.h,
+			x + glyph.w, y + glyph.h,
+			x + glyph.w, y
+		});
+	}
 
+	/// Draw everything queued, with one call per texture
+	void Draw() const {
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		for (auto const& q : quads) {
+			glBindTexture(GL_TEXTURE_2D, q.tex);
+			glVertexPointer(2, GL_FLOAT, 0, q.vertices.data());
+			glTexCoordPointer(2, GL_FLOAT, 0, q.tex_coords.data());
+			glDrawArrays(GL_QUADS, 0, q.vertices.size() / 2);
+		}
 		glDisableClientState(GL_VERTEX_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	}
 };
 
+/// Smallest size of a glyph texture, which fits all of the printable ASCII
+/// characters at the sizes used for labels
+const int min_texture_size = 256;
+
 /// @class OpenGLTextTexture
 /// @brief OpenGL texture which stores one or more glyphs as sprites
 class OpenGLTextTexture final : boost::noncopyable {
@@ -157,8 +182,8 @@ class OpenGLTextTexture final : boost::noncopyable {
 
 public:
 	OpenGLTextTexture(OpenGLTextGlyph &glyph)
-	: width(std::max(SmallestPowerOf2(glyph.w), 64))
-	, height(std::max(SmallestPowerOf2(glyph.h), 64))
+	: width(std::max(SmallestPowerOf2(glyph.w), min_texture_size))
+	, height(std::max(SmallestPowerOf2(glyph.h), min_texture_size))
 	{
 		width = height = std::max(width, height);
 
@@ -253,25 +278,29 @@ void OpenGLText::Print(const std::string &text, int x, int y) {
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Draw border
+	OpenGLTextBatch border;
+	DrawString(text, x-1, y, border);
+	DrawString(text, x+1, y, border);
+	DrawString(text, x, y-1, border);
+	DrawString(text, x, y+1, border);
 	glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-	DrawString(text, x-1, y);
-	DrawString(text, x+1, y);
-	DrawString(text, x, y-1);
-	DrawString(text, x, y+1);
+	border.Draw();
 
 	// Draw primary string
+	OpenGLTextBatch primary;
+	DrawString(text, x, y, primary);
 	glColor4f(r, g, b, a);
-	DrawString(text, x, y);
+	primary.Draw();
 
 	// Disable blend
 	glDisable(GL_TEXTURE_2D);
 	glDisable(GL_BLEND);
 }
 
-void OpenGLText::DrawString(const std::string &text, int x, int y) {
+void OpenGLText::DrawString(const std::string &text, int x, int y, OpenGLTextBatch &batch) {
 	for (char curChar : text) {
 		OpenGLTextGlyph const& glyph = GetGlyph(curChar);
-		glyph.Draw(x, y);
+		batch.Add(glyph, x, y);
 		x += glyph.w;
 	}
 }
@@ -288,7 +317,16 @@ void OpenGLText::GetExtent(std::string const& text, int &w, int &h) {
 
 OpenGLTextGlyph const& OpenGLText::GetGlyph(int i) {
 	auto res = glyphs.find(i);
-	return res != glyphs.end() ? res->second : CreateGlyph(i);
+	if (res != glyphs.end()) return res->second;
+
+	// Labels are nearly all digits and punctuation, so pack all of the
+	// printable ASCII characters together the first time any are needed
+	if (i >= ' ' && i <= '~' && textures.empty()) {
+		for (int chr = ' '; chr <= '~'; ++chr)
+			CreateGlyph(chr);
+		return glyphs.find(i)->second;
+	}
+	return CreateGlyph(i);
 }
 
 OpenGLTextGlyph const& OpenGLText::CreateGlyph(int n) {
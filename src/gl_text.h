@@ -36,6 +36,7 @@
 
 namespace {
 struct OpenGLTextGlyph;
+class OpenGLTextBatch;
 class OpenGLTextTexture;
 }
 
@@ -66,7 +67,8 @@ class OpenGLText {
 	/// @brief Create a new glyph
 	OpenGLTextGlyph const& CreateGlyph(int chr);
 
-	void DrawString(const std::string &text,int x,int y);
+	/// @brief Queue the glyphs of a string for drawing
+	void DrawString(const std::string &text, int x, int y, OpenGLTextBatch &batch);
 public:
 	/// @brief Get the currently active font
 	wxFont GetFont() const { return font; }
@@ -82,16 +82,34 @@ public:
 		data[i * dim + 1] = p.Y();
 	}
 
-	void Draw(GLenum mode, bool clear = true) {
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(dim, GL_FLOAT, 0, &data[0]);
-		glDrawArrays(mode, 0, data.size() / dim);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		if (clear)
-			data.clear();
+	const float *Data() const { return data.data(); }
+	size_t Count() const { return data.size() / dim; }
+};
+
+#ifdef __APPLE__
+#define GL_ENTRY(type, name) decltype(&::name) name = &::name
+#else
+#define GL_ENTRY(type, name) type name = reinterpret_cast<type>(glGetProc(#name))
+#endif
+
+/// Buffer object entry points, which may be missing before OpenGL 1.5
+struct BufferFunctions {
+	GL_ENTRY(PFNGLGENBUFFERSPROC, glGenBuffers);
+	GL_ENTRY(PFNGLDELETEBUFFERSPROC, glDeleteBuffers);
+	GL_ENTRY(PFNGLBINDBUFFERPROC, glBindBuffer);
+	GL_ENTRY(PFNGLBUFFERDATAPROC, glBufferData);
+	GL_ENTRY(PFNGLBUFFERSUBDATAPROC, glBufferSubData);
+
+	bool IsComplete() const {
+		return glGenBuffers && glDeleteBuffers && glBindBuffer && glBufferData && glBufferSubData;
 	}
 };
 
+/// Append a vertex in the batch format
+static void AddVertex(std::vector<float> &out, const float *point, float r, float g, float b, float a) {
+	out.insert(out.end(), {point[0], point[1], r, g, b, a});
+}
+
 OpenGLWrapper::OpenGLWrapper() {
 	line_r = line_g = line_b = line_a = 1.f;
 	fill_r = fill_g = fill_b = fill_a = 1.f;
@@ -101,11 +119,10 @@ OpenGLWrapper::OpenGLWrapper() {
 }
 
 void OpenGLWrapper::DrawLine(Vector2D p1, Vector2D p2) const {
-	SetModeLine();
 	VertexArray buf(2, 2);
 	buf.Set(0, p1);
 	buf.Set(1, p2);
-	buf.Draw(GL_LINES);
+	Submit(GL_LINES, buf.Data(), buf.Count(), false);
 }
 
 static inline Vector2D interp(Vector2D p1, Vector2D p2, float t) {
@@ -131,15 +148,11 @@ void OpenGLWrapper::DrawRectangle(Vector2D p1, Vector2D p2) const {
 	buf.Set(3, Vector2D(p1, p2));
 
 	// Fill
-	if (fill_a != 0.f) {
-		SetModeFill();
-		buf.Draw(GL_QUADS, false);
-	}
+	if (fill_a != 0.f)
+		Submit(GL_QUADS, buf.Data(), buf.Count(), true);
 	// Outline
-	if (line_a != 0.f) {
-		SetModeLine();
-		buf.Draw(GL_LINE_LOOP);
-	}
+	if (line_a != 0.f)
+		Submit(GL_LINE_LOOP, buf.Data(), buf.Count(), false);
 }
 
 void OpenGLWrapper::DrawTriangle(Vector2D p1, Vector2D p2, Vector2D p3) const {
@@ -149,15 +162,11 @@ void OpenGLWrapper::DrawTriangle(Vector2D p1, Vector2D p2, Vector2D p3) const {
 	buf.Set(2, p3);
 
 	// Fill
-	if (fill_a != 0.f) {
-		SetModeFill();
-		buf.Draw(GL_TRIANGLES, false);
-	}
+	if (fill_a != 0.f)
+		Submit(GL_TRIANGLES, buf.Data(), buf.Count(), true);
 	// Outline
-	if (line_a != 0.f) {
-		SetModeLine();
-		buf.Draw(GL_LINE_LOOP);
-	}
+	if (line_a != 0.f)
+		Submit(GL_LINE_LOOP, buf.Data(), buf.Count(), false);
 }
 
 void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, float arc_start, float arc_end) const {
@@ -184,8 +193,6 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 	Vector2D scale_outer = Vector2D(ar, 1) * r2;
 
 	if (fill_a != 0.f) {
-		SetModeFill();
-
 		// Annulus
 		if (r1 != r2) {
 			buf.SetSize(2, (steps + 1) * 2);
@@ -195,7 +202,7 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 				buf.Set(i * 2 + 1, center + offset * scale_outer);
 				cur_angle += step;
 			}
-			buf.Draw(GL_QUAD_STRIP);
+			Submit(GL_QUAD_STRIP, buf.Data(), buf.Count(), true);
 		}
 		// Circle
 		else {
@@ -204,7 +211,7 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 				buf.Set(i, center + Vector2D::FromAngle(cur_angle) * scale_inner);
 				cur_angle += step;
 			}
-			buf.Draw(GL_POLYGON);
+			Submit(GL_POLYGON, buf.Data(), buf.Count(), true);
 		}
 
 		cur_angle = arc_start;
@@ -216,12 +223,11 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 	steps++;
 	buf.SetSize(2, steps);
 
-	SetModeLine();
 	for (int i = 0; i < steps; i++) {
 		buf.Set(i, center + Vector2D::FromAngle(cur_angle) * scale_outer);
 		cur_angle += step;
 	}
-	buf.Draw(GL_LINE_STRIP);
+	Submit(GL_LINE_STRIP, buf.Data(), buf.Count(), false);
 
 	// Inner
 	if (r1 == r2) return;
@@ -232,7 +238,7 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 		buf.Set(i, center + Vector2D::FromAngle(cur_angle) * scale_inner);
 		cur_angle += step;
 	}
-	buf.Draw(GL_LINE_STRIP);
+	Submit(GL_LINE_STRIP, buf.Data(), buf.Count(), false);
 
 	if (!needs_end_caps) return;
 
@@ -241,7 +247,7 @@ void OpenGLWrapper::DrawRing(Vector2D center, float r1, float r2, float ar, floa
 	buf.Set(1, center + Vector2D::FromAngle(arc_start) * scale_outer);
 	buf.Set(2, center + Vector2D::FromAngle(arc_end) * scale_inner);
 	buf.Set(3, center + Vector2D::FromAngle(arc_end) * scale_outer);
-	buf.Draw(GL_LINES);
+	Submit(GL_LINES, buf.Data(), buf.Count(), false);
 }
 
 void OpenGLWrapper::SetLineColour(wxColour col, float alpha, int width) {
@@ -280,6 +286,7 @@ void OpenGLWrapper::SetModeFill() const {
 }
 
 void OpenGLWrapper::SetInvert() {
+	Flush();
 	glEnable(GL_COLOR_LOGIC_OP);
 	glLogicOp(GL_INVERT);
 
@@ -288,6 +295,7 @@ void OpenGLWrapper::SetInvert() {
 }
 
 void OpenGLWrapper::ClearInvert() {
+	Flush();
 	glDisable(GL_COLOR_LOGIC_OP);
 	smooth = true;
 }
@@ -302,6 +310,7 @@ void OpenGLWrapper::DrawLines(size_t dim, std::vector<float> const& lines) {
 }
 
 void OpenGLWrapper::DrawLines(size_t dim, std::vector<float> const& lines, size_t c_dim, std::vector<float> const& colors) {
+	Flush();
 	glShadeModel(GL_SMOOTH);
 	glEnableClientState(GL_COLOR_ARRAY);
 	glColorPointer(c_dim, GL_FLOAT, 0, &colors[0]);
@@ -311,6 +320,12 @@ void OpenGLWrapper::DrawLines(size_t dim, std::vector<float> const& lines, size_
 }
 
 void OpenGLWrapper::DrawLines(size_t dim, const float *lines, size_t n) {
+	if (batching && dim == 2) {
+		Submit(GL_LINES, lines, n, false);
+		return;
+	}
+
+	Flush();
 	SetModeLine();
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(dim, GL_FLOAT, 0, lines);
@@ -319,6 +334,12 @@ void OpenGLWrapper::DrawLines(size_t dim, const float *lines, size_t n) {
 }
 
 void OpenGLWrapper::DrawLineStrip(size_t dim, std::vector<float> const& lines) {
+	if (batching && dim == 2) {
+		Submit(GL_LINE_STRIP, lines.data(), lines.size() / 2, false);
+		return;
+	}
+
+	Flush();
 	SetModeLine();
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glVertexPointer(dim, GL_FLOAT, 0, &lines[0]);
@@ -339,6 +360,11 @@ static void APIENTRY glMultiDrawArraysFallback(GLenum mode, const GLint *first,
 void OpenGLWrapper::DrawMultiPolygon(std::vector<float> const& points, std::vector<int> &start, std::vector<int> &count, Vector2D video_pos, Vector2D video_size, bool invert) {
 	GL_EXT(PFNGLMULTIDRAWARRAYSPROC, glMultiDrawArrays);
 
+	// The stencil passes have to be drawn immediately
+	Flush();
+	bool was_batching = batching;
+	batching = false;
+
 	float real_line_a = line_a;
 	line_a = 0;
 
@@ -389,6 +415,7 @@ void OpenGLWrapper::DrawMultiPolygon(std::vector<float> const& points, std::vect
 	glMultiDrawArrays(GL_LINE_LOOP, &start[0], &count[0], start.size());
 
 	glDisableClientState(GL_VERTEX_ARRAY);
+	batching = was_batching;
 }
 
 void OpenGLWrapper::SetOrigin(Vector2D origin) {
@@ -423,6 +450,7 @@ void OpenGLWrapper::SetShear(float x, float y) {
 }
 
 void OpenGLWrapper::PrepareTransform() {
+	Flush();
 	if (!transform_pushed) {
 		glMatrixMode(GL_MODELVIEW);
 		glPushMatrix();
@@ -432,8 +460,146 @@ void OpenGLWrapper::PrepareTransform() {
 }
 
 void OpenGLWrapper::ResetTransform() {
+	Flush();
 	if (transform_pushed) {
 		glPopMatrix();
 		transform_pushed = false;
 	}
 }
+
+void OpenGLWrapper::Submit(unsigned mode, const float *points, size_t n, bool fill) const {
+	if (!n) return;
+
+	if (!batching) {
+		if (fill)
+			SetModeFill();
+		else
+			SetModeLine();
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(2, GL_FLOAT, 0, points);
+		glDrawArrays(mode, 0, n);
+		glDisableClientState(GL_VERTEX_ARRAY);
+		return;
+	}
+
+	if (!fill && !batch_lines.empty() && (batch_line_width != line_width || batch_smooth != smooth))
+		Flush();
+
+	// Everything is broken down into independent triangles and line segments
+	// so that a single draw call can cover all of them
+	auto p = [&](size_t i) { return points + 2 * i; };
+	if (fill) {
+		auto& out = batch_fill;
+		auto tri = [&](size_t a, size_t b, size_t c) {
+			AddVertex(out, p(a), fill_r, fill_g, fill_b, fill_a);
+			AddVertex(out, p(b), fill_r, fill_g, fill_b, fill_a);
+			AddVertex(out, p(c), fill_r, fill_g, fill_b, fill_a);
+		};
+		switch (mode) {
+			case GL_TRIANGLES:
+				for (size_t i = 0; i + 2 < n; i += 3) tri(i, i + 1, i + 2);
+				break;
+			case GL_QUADS:
+				for (size_t i = 0; i + 3 < n; i += 4) {
+					tri(i, i + 1, i + 2);
+					tri(i, i + 2, i + 3);
+				}
+				break;
+			case GL_QUAD_STRIP:
+				for (size_t i = 0; i + 3 < n; i += 2) {
+					tri(i, i + 1, i + 3);
+					tri(i, i + 3, i + 2);
+				}
+				break;
+			default: // GL_POLYGON and GL_TRIANGLE_FAN; only convex polygons are drawn
+				for (size_t i = 1; i + 1 < n; ++i) tri(0, i, i + 1);
+				break;
+		}
+	}
+	else {
+		auto& out = batch_lines;
+		auto line = [&](size_t a, size_t b) {
+			AddVertex(out, p(a), line_r, line_g, line_b, line_a);
+			AddVertex(out, p(b), line_r, line_g, line_b, line_a);
+		};
+		batch_line_width = line_width;
+		batch_smooth = smooth;
+		switch (mode) {
+			case GL_LINES:
+				for (size_t i = 0; i + 1 < n; i += 2) line(i, i + 1);
+				break;
+			case GL_LINE_LOOP:
+				line(n - 1, 0);
+				// fallthrough
+			default: // GL_LINE_STRIP
+				for (size_t i = 0; i + 1 < n; ++i) line(i, i + 1);
+				break;
+		}
+	}
+}
+
+void OpenGLWrapper::BeginBatch() {
+	batching = true;
+}
+
+void OpenGLWrapper::EndBatch() {
+	Flush();
+	batching = false;
+}
+
+void OpenGLWrapper::Flush() const {
+	if (batch_fill.empty() && batch_lines.empty()) return;
+
+	static BufferFunctions buffers;
+	const GLsizei stride = 6 * sizeof(float);
+	const size_t fill_size = batch_fill.size() * sizeof(float);
+	const size_t lines_size = batch_lines.size() * sizeof(float);
+
+	// Everything goes into one streaming buffer object when they're
+	// supported, and is drawn from client memory otherwise
+	GLuint buffer = 0;
+	const char *fill_data = reinterpret_cast<const char *>(batch_fill.data());
+	const char *lines_data = reinterpret_cast<const char *>(batch_lines.data());
+	if (buffers.IsComplete()) {
+		buffers.glGenBuffers(1, &buffer);
+		buffers.glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		buffers.glBufferData(GL_ARRAY_BUFFER, fill_size + lines_size, nullptr, GL_STREAM_DRAW);
+		buffers.glBufferSubData(GL_ARRAY_BUFFER, 0, fill_size, batch_fill.data());
+		buffers.glBufferSubData(GL_ARRAY_BUFFER, fill_size, lines_size, batch_lines.data());
+		fill_data = nullptr;
+		lines_data = reinterpret_cast<const char *>(fill_size);
+	}
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	if (!batch_fill.empty()) {
+		glVertexPointer(2, GL_FLOAT, stride, fill_data);
+		glColorPointer(4, GL_FLOAT, stride, fill_data + 2 * sizeof(float));
+		glDrawArrays(GL_TRIANGLES, 0, batch_fill.size() / 6);
+	}
+
+	if (!batch_lines.empty()) {
+		glLineWidth(batch_line_width);
+		if (batch_smooth)
+			glEnable(GL_LINE_SMOOTH);
+		else
+			glDisable(GL_LINE_SMOOTH);
+		glVertexPointer(2, GL_FLOAT, stride, lines_data);
+		glColorPointer(4, GL_FLOAT, stride, lines_data + 2 * sizeof(float));
+		glDrawArrays(GL_LINES, 0, batch_lines.size() / 6);
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if (buffer) {
+		buffers.glBindBuffer(GL_ARRAY_BUFFER, 0);
+		buffers.glDeleteBuffers(1, &buffer);
+	}
+
+	batch_fill.clear();
+	batch_lines.clear();
+}
@@ -35,6 +35,23 @@ class OpenGLWrapper {
 	bool transform_pushed;
 	void PrepareTransform();
 
+	/// Are primitives being queued rather than drawn immediately?
+	bool batching = false;
+	/// Queued filled triangles, as x, y, r, g, b, a for each vertex
+	mutable std::vector<float> batch_fill;
+	/// Queued line segments, in the same format as batch_fill
+	mutable std::vector<float> batch_lines;
+	/// Line width and smoothing of the queued lines
+	mutable int batch_line_width = 1;
+	mutable bool batch_smooth = true;
+
+	/// Draw or queue a primitive made of 2D points
+	/// @param mode OpenGL primitive type
+	/// @param points Coordinates of the points
+	/// @param n Number of points
+	/// @param fill Use the fill colour rather than the line colour
+	void Submit(unsigned mode, const float *points, size_t n, bool fill) const;
+
 public:
 	OpenGLWrapper();
 
@@ -52,6 +69,17 @@ public:
 	void SetShear(float x, float y);
 	void ResetTransform();
 
+	/// @brief Start queuing primitives instead of drawing them one at a time
+	///
+	/// Until EndBatch, everything drawn with the current transform is
+	/// collected and drawn with a few calls. Filled areas are drawn before
+	/// lines, so outlines always end up on top.
+	void BeginBatch();
+	/// Draw everything queued and go back to drawing primitives immediately
+	void EndBatch();
+	/// Draw everything queued so far
+	void Flush() const;
+
 	void DrawLine(Vector2D p1, Vector2D p2) const;
 	void DrawDashedLine(Vector2D p1, Vector2D p2, float dashLen) const;
 	void DrawEllipse(Vector2D center, Vector2D radius) const;
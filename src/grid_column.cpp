@@ -18,6 +18,7 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "ass_overlaps.h"
 #include "compat.h"
 #include "include/aegisub/context.h"
 #include "options.h"
@@ -25,8 +26,16 @@
 
 #include <libaegisub/character_count.h>
 
+#include <map>
+
 #include <wx/dc.h>
 
+namespace {
+/// Lines to keep formatted values for before starting over, which is
+/// several screens' worth even on very tall grids
+const size_t max_cached_cells = 10000;
+}
+
 void WidthHelper::Age() {
 	for (auto it = begin(widths), e = end(widths); it != e; ) {
 		if (it->second.age == age)
@@ -37,7 +46,7 @@ void WidthHelper::Age() {
 	++age;
 }
 
-int WidthHelper::operator()(boost::flyweight<std::string> const& str) {
+int WidthHelper::operator()(agi::StringFlyweight const& str) {
 	if (str.get().empty()) return 0;
 	auto it = widths.find(str);
 	if (it != end(widths)) {
@@ -76,6 +85,7 @@ int WidthHelper::operator()(const wchar_t *str) {
 }
 
 void GridColumn::UpdateWidth(const agi::Context *c, WidthHelper &helper) {
+	stale = !visible;
 	if (!visible) {
 		width = 0;
 		return;
@@ -86,11 +96,30 @@ void GridColumn::UpdateWidth(const agi::Context *c, WidthHelper &helper) {
 		width = 10 + std::max(width, helper(Header()));
 }
 
+void GridColumn::UpdateWidth(const agi::Context *c, WidthHelper &helper, GridLineChanges const& changes) {
+	if (stale || !visible) {
+		UpdateWidth(c, helper);
+		return;
+	}
+
+	width = UpdatedWidth(c, helper, changes);
+	if (width)
+		width = 10 + std::max(width, helper(Header()));
+}
+
 void GridColumn::Paint(wxDC &dc, int x, int y, const AssDialogue *d, const agi::Context *c) const {
-	wxString str = Value(d, c);
+	auto it = cells.find(d);
+	if (it == cells.end()) {
+		if (cells.size() > max_cached_cells)
+			cells.clear();
+		wxString str = Value(d, c);
+		int text_width = Centered() ? dc.GetTextExtent(str).GetWidth() : 0;
+		it = cells.emplace(d, Cell{std::move(str), text_width}).first;
+	}
+
 	if (Centered())
-		x += (width - 6 - dc.GetTextExtent(str).GetWidth()) / 2;
-	dc.DrawText(str, x + 4, y + 2);
+		x += (width - 6 - it->second.text_width) / 2;
+	dc.DrawText(it->second.text, x + 4, y + 2);
 }
 
 namespace {
@@ -115,17 +144,83 @@ struct GridColumnLineNumber final : GridColumn {
 	}
 };
 
-template<typename T>
-T max_value(T AssDialogueBase::*field, EntryList<AssDialogue> const& lines) {
-	T value = 0;
-	for (AssDialogue const& line : lines) {
-		if (line.*field > value)
-			value = line.*field;
+/// Largest of a per-line value, which can be kept up to date one line at a
+/// time rather than by rescanning the whole file
+class LineMax {
+	std::unordered_map<const AssDialogue *, int> values;
+	/// Number of lines with each value. Only a handful of distinct values
+	/// tend to exist, so this is much smaller than a multiset of them.
+	std::map<int, size_t> counts;
+
+	void Drop(int value) {
+		auto it = counts.find(value);
+		if (--it->second == 0)
+			counts.erase(it);
+	}
+
+public:
+	void Clear() {
+		values.clear();
+		counts.clear();
 	}
-	return value;
-}
 
-struct GridColumnLayer final : GridColumn {
+	void Set(const AssDialogue *line, int value) {
+		auto it = values.find(line);
+		if (it != values.end()) {
+			if (it->second == value) return;
+			Drop(it->second);
+			it->second = value;
+		}
+		else
+			values.emplace(line, value);
+		++counts[value];
+	}
+
+	void Erase(const AssDialogue *line) {
+		auto it = values.find(line);
+		if (it == values.end()) return;
+		Drop(it->second);
+		values.erase(it);
+	}
+
+	int Max() const { return counts.empty() ? 0 : counts.rbegin()->first; }
+};
+
+/// Column whose width is determined by the largest of some per-line value,
+/// so that edits only need to look at the lines which changed
+struct GridColumnMax : GridColumn {
+	mutable LineMax values;
+
+	/// Value of the line to take the largest of
+	virtual int LineValue(const AssDialogue *d, WidthHelper &helper) const = 0;
+	/// Width of the column given the largest value
+	virtual int MaxWidth(int max, const agi::Context *c, WidthHelper &helper) const = 0;
+	/// Whether the width currently depends on the values at all
+	virtual bool UsesValues() const { return true; }
+
+	int Width(const agi::Context *c, WidthHelper &helper) const override {
+		values.Clear();
+		if (UsesValues()) {
+			for (AssDialogue const& line : c->ass->Events)
+				values.Set(&line, LineValue(&line, helper));
+		}
+		return MaxWidth(values.Max(), c, helper);
+	}
+
+	int UpdatedWidth(const agi::Context *c, WidthHelper &helper, GridLineChanges const& changes) const override {
+		if (UsesValues()) {
+			// Removals come first as a removed line's address may have been
+			// reused for an added one
+			for (auto line : changes.removed)
+				values.Erase(line);
+			for (auto line : changes.changed)
+				values.Set(line, LineValue(line, helper));
+		}
+		return MaxWidth(values.Max(), c, helper);
+	}
+};
+
+struct GridColumnLayer final : GridColumnMax {
 	COLUMN_HEADER(_("L"))
 	COLUMN_DESCRIPTION(_("Layer"))
 	bool Centered() const override { return true; }
@@ -134,16 +229,21 @@ struct GridColumnLayer final : GridColumn {
 		return d->Layer ? wxString(std::to_wstring(d->Layer)) : wxString();
 	}
 
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
-		int max_layer = max_value(&AssDialogue::Layer, c->ass->Events);
+	int LineValue(const AssDialogue *d, WidthHelper &) const override {
+		return d->Layer;
+	}
+
+	int MaxWidth(int max_layer, const agi::Context *, WidthHelper &helper) const override {
 		return max_layer == 0 ? 0 : helper(std::to_wstring(max_layer));
 	}
 };
 
-struct GridColumnTime : GridColumn {
+struct GridColumnTime : GridColumnMax {
 	bool by_frame = false;
 
 	bool Centered() const override { return true; }
+	// Times are only as wide as their largest value when shown as frames
+	bool UsesValues() const override { return by_frame; }
 	void SetByFrame(bool by_frame) override { this->by_frame = by_frame; }
 };
 
@@ -157,10 +257,14 @@ struct GridColumnStartTime final : GridColumnTime {
 		return to_wx(d->Start.GetAssFormatted());
 	}
 
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
+	int LineValue(const AssDialogue *d, WidthHelper &) const override {
+		return d->Start;
+	}
+
+	int MaxWidth(int max, const agi::Context *c, WidthHelper &helper) const override {
 		if (!by_frame)
 			return helper(wxS("0:00:00.00"));
-		int frame = c->videoController->FrameAtTime(max_value(&AssDialogue::Start, c->ass->Events), agi::vfr::START);
+		int frame = c->videoController->FrameAtTime(max, agi::vfr::START);
 		return helper(std::to_wstring(frame));
 	}
 };
@@ -175,28 +279,35 @@ struct GridColumnEndTime final : GridColumnTime {
 		return to_wx(d->End.GetAssFormatted());
 	}
 
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
+	int LineValue(const AssDialogue *d, WidthHelper &) const override {
+		return d->End;
+	}
+
+	int MaxWidth(int max, const agi::Context *c, WidthHelper &helper) const override {
 		if (!by_frame)
 			return helper(wxS("0:00:00.00"));
-		int frame = c->videoController->FrameAtTime(max_value(&AssDialogue::End, c->ass->Events), agi::vfr::END);
+		int frame = c->videoController->FrameAtTime(max, agi::vfr::END);
 		return helper(std::to_wstring(frame));
 	}
 };
 
-template<typename T>
-int max_width(T AssDialogueBase::*field, EntryList<AssDialogue> const& lines, WidthHelper &helper) {
-	int w = 0;
-	for (AssDialogue const& line : lines) {
-		auto const& v = line.*field;
-		if (v.get().empty()) continue;
-		int width = helper(v);
-		if (width > w)
-			w = width;
-	}
-	return w;
-}
+/// Column as wide as the widest value of a string field
+struct GridColumnMaxWidth : GridColumnMax {
+	agi::StringFlyweight AssDialogueBase::*field;
+	GridColumnMaxWidth(agi::StringFlyweight AssDialogueBase::*field) : field(field) { }
+
+	int LineValue(const AssDialogue *d, WidthHelper &helper) const override {
+		return helper(d->*field);
+	}
+
+	int MaxWidth(int max, const agi::Context *, WidthHelper &) const override {
+		return max;
+	}
+};
+
+struct GridColumnStyle final : GridColumnMaxWidth {
+	GridColumnStyle() : GridColumnMaxWidth(&AssDialogue::Style) { }
 
-struct GridColumnStyle final : GridColumn {
 	COLUMN_HEADER(_("Style"))
 	COLUMN_DESCRIPTION(_("Style"))
 	bool Centered() const override { return false; }
@@ -204,13 +315,11 @@ struct GridColumnStyle final : GridColumn {
 	wxString Value(const AssDialogue *d, const agi::Context *c) const override {
 		return to_wx(d->Style);
 	}
-
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
-		return max_width(&AssDialogue::Style, c->ass->Events, helper);
-	}
 };
 
-struct GridColumnEffect final : GridColumn {
+struct GridColumnEffect final : GridColumnMaxWidth {
+	GridColumnEffect() : GridColumnMaxWidth(&AssDialogue::Effect) { }
+
 	COLUMN_HEADER(_("Effect"))
 	COLUMN_DESCRIPTION(_("Effect"))
 	bool Centered() const override { return false; }
@@ -218,13 +327,11 @@ struct GridColumnEffect final : GridColumn {
 	wxString Value(const AssDialogue *d, const agi::Context *) const override {
 		return to_wx(d->Effect);
 	}
-
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
-		return max_width(&AssDialogue::Effect, c->ass->Events, helper);
-	}
 };
 
-struct GridColumnActor final : GridColumn {
+struct GridColumnActor final : GridColumnMaxWidth {
+	GridColumnActor() : GridColumnMaxWidth(&AssDialogue::Actor) { }
+
 	COLUMN_HEADER(_("Actor"))
 	COLUMN_DESCRIPTION(_("Actor"))
 	bool Centered() const override { return false; }
@@ -232,13 +339,9 @@ struct GridColumnActor final : GridColumn {
 	wxString Value(const AssDialogue *d, const agi::Context *) const override {
 		return to_wx(d->Actor);
 	}
-
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
-		return max_width(&AssDialogue::Actor, c->ass->Events, helper);
-	}
 };
 
-struct GridColumnMargin : GridColumn {
+struct GridColumnMargin : GridColumnMax {
 	int index;
 	GridColumnMargin(int index) : index(index) { }
 
@@ -248,12 +351,11 @@ struct GridColumnMargin : GridColumn {
 		return d->Margin[index] ? wxString(std::to_wstring(d->Margin[index])) : wxString();
 	}
 
-	int Width(const agi::Context *c, WidthHelper &helper) const override {
-		int max = 0;
-		for (AssDialogue const& line : c->ass->Events) {
-			if (line.Margin[index] > max)
-				max = line.Margin[index];
-		}
+	int LineValue(const AssDialogue *d, WidthHelper &) const override {
+		return d->Margin[index];
+	}
+
+	int MaxWidth(int max, const agi::Context *, WidthHelper &helper) const override {
 		return max == 0 ? 0 : helper(std::to_wstring(max));
 	}
 };
@@ -283,6 +385,9 @@ wxColor blend(wxColor fg, wxColor bg, double alpha) {
 		wxColor::AlphaBlend(fg.Blue(), bg.Blue(), alpha));
 }
 
+/// Lines of text to remember counts for before starting over
+const size_t max_cached_counts = 100000;
+
 class GridColumnCPS final : public GridColumn {
 	const agi::OptionValue *ignore_whitespace = OPT_GET("Subtitle/Character Counter/Ignore Whitespace");
 	const agi::OptionValue *ignore_punctuation = OPT_GET("Subtitle/Character Counter/Ignore Punctuation");
@@ -290,6 +395,23 @@ class GridColumnCPS final : public GridColumn {
 	const agi::OptionValue *cps_error = OPT_GET("Subtitle/Character Counter/CPS Error Threshold");
 	const agi::OptionValue *bg_color = OPT_GET("Colour/Subtitle Grid/CPS Error");
 
+	/// Character counts by line text, for the ignore mask in counts_mask
+	mutable std::unordered_map<agi::StringFlyweight, size_t> counts;
+	mutable int counts_mask = -1;
+
+	size_t Count(agi::StringFlyweight const& text, int ignore) const {
+		// Lines with the same text share a flyweight, so this also spares
+		// recounting duplicated lines, and edited lines simply miss
+		if (ignore != counts_mask || counts.size() > max_cached_counts) {
+			counts.clear();
+			counts_mask = ignore;
+		}
+
+		auto it = counts.find(text);
+		if (it != counts.end()) return it->second;
+		return counts[text] = agi::CharacterCount(text, ignore);
+	}
+
 public:
 	COLUMN_HEADER(_("CPS"))
 	COLUMN_DESCRIPTION(_("Characters Per Second"))
@@ -302,9 +424,7 @@ public:
 
 	int CPS(const AssDialogue *d) const {
 		int duration = d->End - d->Start;
-		auto const& text = d->Text.get();
-
-		if (duration <= 100 || text.size() > static_cast<size_t>(duration))
+		if (duration <= 100 || d->Text.get().size() > static_cast<size_t>(duration))
 			return -1;
 
 		int ignore = agi::IGNORE_BLOCKS;
@@ -313,7 +433,7 @@ public:
 		if (ignore_punctuation->GetBool())
 			ignore |= agi::IGNORE_PUNCTUATION;
 
-		return agi::CharacterCount(text, ignore) * 1000 / duration;
+		return Count(d->Text, ignore) * 1000 / duration;
 	}
 
 	int Width(const agi::Context *c, WidthHelper &helper) const override {
@@ -344,6 +464,38 @@ public:
 	}
 };
 
+class GridColumnOverlap final : public GridColumn {
+	const agi::OptionValue *overlap_group = OPT_GET("Subtitle/Overlap Grouping");
+	const agi::OptionValue *bg_color = OPT_GET("Colour/Subtitle Grid/Overlap");
+
+public:
+	COLUMN_HEADER(_("Ovl"))
+	COLUMN_DESCRIPTION(_("Overlapping Lines"))
+	bool Centered() const override { return true; }
+	bool RefreshOnTimeChange() const override { return true; }
+
+	wxString Value(const AssDialogue *, const agi::Context *) const override {
+		return wxS("");
+	}
+
+	int Width(const agi::Context *, WidthHelper &helper) const override {
+		return helper(wxS("!"));
+	}
+
+	// Whether a line overlaps anything depends on the other lines, so this
+	// doesn't go through the cell cache either
+	void Paint(wxDC &dc, int x, int y, const AssDialogue *d, const agi::Context *c) const override {
+		if (!c->ass->IsOverlapping(d, static_cast<OverlapGroup>(overlap_group->GetInt())))
+			return;
+
+		wxSize ext = dc.GetTextExtent(wxS("!"));
+		dc.SetBrush(wxBrush(to_wx(bg_color->GetColor())));
+		dc.SetPen(*wxTRANSPARENT_PEN);
+		dc.DrawRectangle(x, y + 1, width, ext.GetHeight() + 3);
+		dc.DrawText(wxS("!"), x + (width + 2 - ext.GetWidth()) / 2, y + 2);
+	}
+};
+
 class GridColumnText final : public GridColumn {
 	const agi::OptionValue *override_mode;
 	wxString replace_char;
@@ -355,7 +507,7 @@ public:
 	: override_mode(OPT_GET("Subtitle/Grid/Hide Overrides"))
 	, replace_char(to_wx(OPT_GET("Subtitle/Grid/Hide Overrides Char")->GetString()))
 	, replace_char_connection(OPT_SUB("Subtitle/Grid/Hide Overrides Char",
-		[&](agi::OptionValue const& v) { replace_char = to_wx(v.GetString()); }))
+		[&](agi::OptionValue const& v) { replace_char = to_wx(v.GetString()); InvalidateAll(); }))
 	{
 	}
 
@@ -413,6 +565,7 @@ std::vector<std::unique_ptr<GridColumn>> GetGridColumns() {
 	ret.push_back(make<GridColumnStartTime>());
 	ret.push_back(make<GridColumnEndTime>());
 	ret.push_back(make<GridColumnCPS>());
+	ret.push_back(make<GridColumnOverlap>());
 	ret.push_back(make<GridColumnStyle>());
 	ret.push_back(make<GridColumnActor>());
 	ret.push_back(make<GridColumnEffect>());
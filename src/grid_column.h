@@ -16,14 +16,16 @@
 
 #include "flyweight_hash.h"
 
+#include <libaegisub/flyweight.h>
+
 #include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <wx/string.h>
 
 class AssDialogue;
 class wxDC;
-class wxString;
 namespace agi { struct Context; }
 
 class WidthHelper {
@@ -33,7 +35,7 @@ class WidthHelper {
 	};
 	int age = 0;
 	wxDC *dc = nullptr;
-	std::unordered_map<boost::flyweight<std::string>, Entry> widths;
+	std::unordered_map<agi::StringFlyweight, Entry> widths;
 #ifdef _WIN32
 	wxString scratch;
 #endif
@@ -42,19 +44,43 @@ public:
 	void SetDC(wxDC *dc) { this->dc = dc; }
 	void Age();
 
-	int operator()(boost::flyweight<std::string> const& str);
+	int operator()(agi::StringFlyweight const& str);
 	int operator()(std::string const& str);
 	int operator()(wxString const& str);
 	int operator()(const char *str);
 	int operator()(const wchar_t *str);
 };
 
+/// Lines which changed since the column widths were last updated
+struct GridLineChanges {
+	/// Lines which are no longer in the file
+	std::vector<const AssDialogue *> removed;
+	/// Lines which were added or may have had their fields changed
+	std::vector<const AssDialogue *> changed;
+};
+
 class GridColumn {
+	/// Formatted value of a line and its width in pixels, if centered
+	struct Cell {
+		wxString text;
+		int text_width;
+	};
+	/// Cells painted so far, so that repaints don't have to reformat them
+	mutable std::unordered_map<const AssDialogue *, Cell> cells;
+	/// Changes were skipped while hidden, so the width has to be recomputed
+	/// from scratch the next time it's updated
+	bool stale = true;
+
 protected:
 	int width = 0;
 	bool visible = true;
 
 	virtual int Width(const agi::Context *c, WidthHelper &helper) const = 0;
+	/// Width after only the given lines have changed since the last call;
+	/// columns which don't track per-line values just recompute it
+	virtual int UpdatedWidth(const agi::Context *c, WidthHelper &helper, GridLineChanges const&) const {
+		return Width(c, helper);
+	}
 	virtual wxString Value(const AssDialogue *d, const agi::Context *c) const = 0;
 
 public:
@@ -63,6 +89,9 @@ public:
 	virtual bool Centered() const { return false; }
 	virtual bool CanHide() const { return true; }
 	virtual bool RefreshOnTextChange() const { return false; }
+	/// Does the value of a line depend on the times of other lines, so that
+	/// the whole column has to be repainted when any line is retimed?
+	virtual bool RefreshOnTimeChange() const { return false; }
 
 	virtual wxString const& Header() const = 0;
 	virtual wxString const& Description() const = 0;
@@ -72,6 +101,13 @@ public:
 	bool Visible() const { return visible; }
 
 	virtual void UpdateWidth(const agi::Context *c, WidthHelper &helper);
+	/// Update the width after only the given lines were added, removed or changed
+	void UpdateWidth(const agi::Context *c, WidthHelper &helper, GridLineChanges const& changes);
+	/// Discard the cached value for a line which has changed
+	void Invalidate(const AssDialogue *line) { cells.erase(line); }
+	/// Discard all cached values, e.g. when lines were added or removed or
+	/// something the values are displayed relative to changed
+	void InvalidateAll() { cells.clear(); }
 	virtual void SetByFrame(bool /* by_frame */) { }
 	void SetVisible(bool new_value) { visible = new_value; }
 };
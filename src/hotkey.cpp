@@ -73,11 +73,14 @@ namespace {
 
 namespace hotkey {
 
+static uint32_t name_keycode(std::string const& name);
+
 agi::hotkey::Hotkey *inst = nullptr;
 void init() {
 	inst = new agi::hotkey::Hotkey(
 		config::path->Decode("?user/hotkey.json"),
 		GET_DEFAULT_CONFIG(default_hotkey));
+	inst->SetKeyCodeLookup(name_keycode);
 
 	auto migrations = OPT_GET("App/Hotkey Migrations")->GetListString();
 
@@ -128,95 +131,126 @@ void clear() {
 	delete inst;
 }
 
+/// Names of the keys which aren't printable characters
+const struct {
+	int code;
+	const char *name;
+} key_names[] = {
+	{WXK_BACK,            "Backspace"},
+	{WXK_TAB,             "Tab"},
+	{WXK_RETURN,          "Enter"},
+	{WXK_ESCAPE,          "Escape"},
+	{WXK_SPACE,           "Space"},
+	{WXK_DELETE,          "Delete"},
+	{WXK_SHIFT,           "Shift"},
+	{WXK_ALT,             "Alt"},
+	{WXK_CONTROL,         "Control"},
+	{WXK_PAUSE,           "Pause"},
+	{WXK_END,             "End"},
+	{WXK_HOME,            "Home"},
+	{WXK_LEFT,            "Left"},
+	{WXK_UP,              "Up"},
+	{WXK_RIGHT,           "Right"},
+	{WXK_DOWN,            "Down"},
+	{WXK_PRINT,           "Print"},
+	{WXK_INSERT,          "Insert"},
+	{WXK_NUMPAD0,         "KP_0"},
+	{WXK_NUMPAD1,         "KP_1"},
+	{WXK_NUMPAD2,         "KP_2"},
+	{WXK_NUMPAD3,         "KP_3"},
+	{WXK_NUMPAD4,         "KP_4"},
+	{WXK_NUMPAD5,         "KP_5"},
+	{WXK_NUMPAD6,         "KP_6"},
+	{WXK_NUMPAD7,         "KP_7"},
+	{WXK_NUMPAD8,         "KP_8"},
+	{WXK_NUMPAD9,         "KP_9"},
+	{WXK_MULTIPLY,        "Asterisk"},
+	{WXK_ADD,             "Plus"},
+	{WXK_SUBTRACT,        "Hyphen"},
+	{WXK_DECIMAL,         "Period"},
+	{WXK_DIVIDE,          "Slash"},
+	{WXK_F1,              "F1"},
+	{WXK_F2,              "F2"},
+	{WXK_F3,              "F3"},
+	{WXK_F4,              "F4"},
+	{WXK_F5,              "F5"},
+	{WXK_F6,              "F6"},
+	{WXK_F7,              "F7"},
+	{WXK_F8,              "F8"},
+	{WXK_F9,              "F9"},
+	{WXK_F10,             "F10"},
+	{WXK_F11,             "F11"},
+	{WXK_F12,             "F12"},
+	{WXK_F13,             "F13"},
+	{WXK_F14,             "F14"},
+	{WXK_F15,             "F15"},
+	{WXK_F16,             "F16"},
+	{WXK_F17,             "F17"},
+	{WXK_F18,             "F18"},
+	{WXK_F19,             "F19"},
+	{WXK_F20,             "F20"},
+	{WXK_F21,             "F21"},
+	{WXK_F22,             "F22"},
+	{WXK_F23,             "F23"},
+	{WXK_F24,             "F24"},
+	{WXK_NUMLOCK,         "Num_Lock"},
+	{WXK_SCROLL,          "Scroll_Lock"},
+	{WXK_PAGEUP,          "PageUp"},
+	{WXK_PAGEDOWN,        "PageDown"},
+	{WXK_NUMPAD_SPACE,    "KP_Space"},
+	{WXK_NUMPAD_TAB,      "KP_Tab"},
+	{WXK_NUMPAD_ENTER,    "KP_Enter"},
+	{WXK_NUMPAD_F1,       "KP_F1"},
+	{WXK_NUMPAD_F2,       "KP_F2"},
+	{WXK_NUMPAD_F3,       "KP_F3"},
+	{WXK_NUMPAD_F4,       "KP_F4"},
+	{WXK_NUMPAD_HOME,     "KP_Home"},
+	{WXK_NUMPAD_LEFT,     "KP_Left"},
+	{WXK_NUMPAD_UP,       "KP_Up"},
+	{WXK_NUMPAD_RIGHT,    "KP_Right"},
+	{WXK_NUMPAD_DOWN,     "KP_Down"},
+	{WXK_NUMPAD_PAGEUP,   "KP_PageUp"},
+	{WXK_NUMPAD_PAGEDOWN, "KP_PageDown"},
+	{WXK_NUMPAD_END,      "KP_End"},
+	{WXK_NUMPAD_BEGIN,    "KP_Begin"},
+	{WXK_NUMPAD_INSERT,   "KP_insert"},
+	{WXK_NUMPAD_DELETE,   "KP_Delete"},
+	{WXK_NUMPAD_EQUAL,    "KP_Equal"},
+	{WXK_NUMPAD_MULTIPLY, "KP_Multiply"},
+	{WXK_NUMPAD_ADD,      "KP_Add"},
+	{WXK_NUMPAD_SUBTRACT, "KP_Subtract"},
+	{WXK_NUMPAD_DECIMAL,  "KP_Decimal"},
+	{WXK_NUMPAD_DIVIDE,   "KP_Divide"},
+};
+
 static const char *keycode_name(int code) {
-	switch (code) {
-	case WXK_BACK:            return "Backspace";
-	case WXK_TAB:             return "Tab";
-	case WXK_RETURN:          return "Enter";
-	case WXK_ESCAPE:          return "Escape";
-	case WXK_SPACE:           return "Space";
-	case WXK_DELETE:          return "Delete";
-	case WXK_SHIFT:           return "Shift";
-	case WXK_ALT:             return "Alt";
-	case WXK_CONTROL:         return "Control";
-	case WXK_PAUSE:           return "Pause";
-	case WXK_END:             return "End";
-	case WXK_HOME:            return "Home";
-	case WXK_LEFT:            return "Left";
-	case WXK_UP:              return "Up";
-	case WXK_RIGHT:           return "Right";
-	case WXK_DOWN:            return "Down";
-	case WXK_PRINT:           return "Print";
-	case WXK_INSERT:          return "Insert";
-	case WXK_NUMPAD0:         return "KP_0";
-	case WXK_NUMPAD1:         return "KP_1";
-	case WXK_NUMPAD2:         return "KP_2";
-	case WXK_NUMPAD3:         return "KP_3";
-	case WXK_NUMPAD4:         return "KP_4";
-	case WXK_NUMPAD5:         return "KP_5";
-	case WXK_NUMPAD6:         return "KP_6";
-	case WXK_NUMPAD7:         return "KP_7";
-	case WXK_NUMPAD8:         return "KP_8";
-	case WXK_NUMPAD9:         return "KP_9";
-	case WXK_MULTIPLY:        return "Asterisk";
-	case WXK_ADD:             return "Plus";
-	case WXK_SUBTRACT:        return "Hyphen";
-	case WXK_DECIMAL:         return "Period";
-	case WXK_DIVIDE:          return "Slash";
-	case WXK_F1:              return "F1";
-	case WXK_F2:              return "F2";
-	case WXK_F3:              return "F3";
-	case WXK_F4:              return "F4";
-	case WXK_F5:              return "F5";
-	case WXK_F6:              return "F6";
-	case WXK_F7:              return "F7";
-	case WXK_F8:              return "F8";
-	case WXK_F9:              return "F9";
-	case WXK_F10:             return "F10";
-	case WXK_F11:             return "F11";
-	case WXK_F12:             return "F12";
-	case WXK_F13:             return "F13";
-	case WXK_F14:             return "F14";
-	case WXK_F15:             return "F15";
-	case WXK_F16:             return "F16";
-	case WXK_F17:             return "F17";
-	case WXK_F18:             return "F18";
-	case WXK_F19:             return "F19";
-	case WXK_F20:             return "F20";
-	case WXK_F21:             return "F21";
-	case WXK_F22:             return "F22";
-	case WXK_F23:             return "F23";
-	case WXK_F24:             return "F24";
-	case WXK_NUMLOCK:         return "Num_Lock";
-	case WXK_SCROLL:          return "Scroll_Lock";
-	case WXK_PAGEUP:          return "PageUp";
-	case WXK_PAGEDOWN:        return "PageDown";
-	case WXK_NUMPAD_SPACE:    return "KP_Space";
-	case WXK_NUMPAD_TAB:      return "KP_Tab";
-	case WXK_NUMPAD_ENTER:    return "KP_Enter";
-	case WXK_NUMPAD_F1:       return "KP_F1";
-	case WXK_NUMPAD_F2:       return "KP_F2";
-	case WXK_NUMPAD_F3:       return "KP_F3";
-	case WXK_NUMPAD_F4:       return "KP_F4";
-	case WXK_NUMPAD_HOME:     return "KP_Home";
-	case WXK_NUMPAD_LEFT:     return "KP_Left";
-	case WXK_NUMPAD_UP:       return "KP_Up";
-	case WXK_NUMPAD_RIGHT:    return "KP_Right";
-	case WXK_NUMPAD_DOWN:     return "KP_Down";
-	case WXK_NUMPAD_PAGEUP:   return "KP_PageUp";
-	case WXK_NUMPAD_PAGEDOWN: return "KP_PageDown";
-	case WXK_NUMPAD_END:      return "KP_End";
-	case WXK_NUMPAD_BEGIN:    return "KP_Begin";
-	case WXK_NUMPAD_INSERT:   return "KP_insert";
-	case WXK_NUMPAD_DELETE:   return "KP_Delete";
-	case WXK_NUMPAD_EQUAL:    return "KP_Equal";
-	case WXK_NUMPAD_MULTIPLY: return "KP_Multiply";
-	case WXK_NUMPAD_ADD:      return "KP_Add";
-	case WXK_NUMPAD_SUBTRACT: return "KP_Subtract";
-	case WXK_NUMPAD_DECIMAL:  return "KP_Decimal";
-	case WXK_NUMPAD_DIVIDE:   return "KP_Divide";
-	default: return "";
+	for (auto const& key : key_names) {
+		if (key.code == code) return key.name;
+	}
+	return "";
+}
+
+/// Get the wx key code for the name of a key, or 0 if it isn't one
+static uint32_t name_keycode(std::string const& name) {
+	if (name.size() == 1 && name[0] > 32 && name[0] < 127)
+		return name[0];
+	for (auto const& key : key_names) {
+		if (name == key.name) return key.code;
 	}
+	return 0;
+}
+
+/// Pack a keypress in the form agi::hotkey::Hotkey::Scan takes, or return 0
+/// if it isn't one which can have a hotkey
+static uint32_t pack_keypress(int key_code, int modifier) {
+	if (!(key_code > 32 && key_code < 127) && !*keycode_name(key_code))
+		return 0;
+
+	uint32_t combo = key_code;
+	if ((modifier & wxMOD_CMD) != 0) combo |= agi::hotkey::MOD_CTRL;
+	if ((modifier & wxMOD_ALT) != 0) combo |= agi::hotkey::MOD_ALT;
+	if ((modifier & wxMOD_SHIFT) != 0) combo |= agi::hotkey::MOD_SHIFT;
+	return combo;
 }
 
 std::string keypress_to_str(int key_code, int modifier) {
@@ -236,9 +270,10 @@ std::string keypress_to_str(int key_code, int modifier) {
 }
 
 static bool check(std::string const& context, agi::Context *c, int key_code, int modifier) {
-	std::string combo = keypress_to_str(key_code, modifier);
-	if (combo.empty()) return false;
+	uint32_t combo = pack_keypress(key_code, modifier);
+	if (!combo) return false;
 
+	// Copied as the command may change the hotkeys
 	std::string command = inst->Scan(context, combo, OPT_GET("Audio/Medusa Timing Hotkeys")->GetBool());
 	if (!command.empty()) {
 		cmd::call(command, c);
@@ -34,6 +34,7 @@
 
 #pragma once
 
+#include <libaegisub/audio/playback_stats.h>
 #include <libaegisub/exception.h>
 
 #include <cstdint>
@@ -45,8 +46,20 @@ namespace agi { class AudioProvider; }
 class wxWindow;
 
 class AudioPlayer {
+	friend struct AudioPlayerFactory;
+	/// Name of the factory which created this player
+	const char *name = "";
+
 protected:
 	agi::AudioProvider *provider;
+	/// Timing counters, which each player keeps up to date
+	agi::AudioPlaybackStats stats;
+
+	/// Number of frames players which read ahead with an AudioPlaybackFeed
+	/// should buffer
+	size_t GetReadAheadFrames() const;
+	/// Should the player ask for as small a device buffer as it can?
+	static bool IsLowLatency();
 
 public:
 	AudioPlayer(agi::AudioProvider *provider) : provider(provider) { }
@@ -57,10 +70,16 @@ public:
 	virtual bool IsPlaying()=0;
 
 	virtual void SetVolume(double volume)=0;
+	/// Fade in and out over this many frames at the ends of each range played.
+	/// Players which don't read through an AudioPlaybackFeed ignore this.
+	virtual void SetFade(int64_t frames) { }
 
 	virtual int64_t GetEndPosition()=0;
 	virtual int64_t GetCurrentPosition()=0;
 	virtual void SetEndPosition(int64_t pos)=0;
+
+	const char *GetName() const { return name; }
+	agi::AudioPlaybackStats const& GetStats() const { return stats; }
 };
 
 struct AudioPlayerFactory {
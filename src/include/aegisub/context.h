@@ -24,6 +24,7 @@ class AudioKaraoke;
 class DialogManager;
 class FrameMain;
 class Project;
+class SearchMatchIndex;
 class SearchReplaceEngine;
 class InitialLineState;
 class SelectionController;
@@ -51,6 +52,7 @@ struct Context {
 	std::unique_ptr<AudioController> audioController;
 	std::unique_ptr<InitialLineState> initialLineState;
 	std::unique_ptr<SearchReplaceEngine> search;
+	std::unique_ptr<SearchMatchIndex> searchMatches;
 	std::unique_ptr<Path> path;
 
 	// Things that should probably be in some sort of UI-context-model
@@ -38,18 +38,70 @@
 #include <string>
 #include <vector>
 
+class AssAttachment;
 class AssFile;
 struct VideoFrame;
 
 class SubtitlesProvider {
+	struct LoadedSections;
+
 	std::vector<char> buffer;
+	/// What was sent by the last full load, to tell which sections changed
+	std::unique_ptr<LoadedSections> loaded;
+
 	virtual void LoadSubtitles(const char *data, size_t len)=0;
 
+	/// Replace just the events of the most recently loaded file
+	/// @param data [Events] section to load
+	/// @return Whether the provider could; if not the whole file is reloaded
+	virtual bool LoadEvents(const char *data, size_t len) { return false; }
+
+	/// Replace the styles of the most recently loaded file, which is
+	/// followed by a LoadEvents call so that the events pick them up
+	/// @param data [V4+ Styles] section to load
+	/// @return Whether the provider could; if not the whole file is reloaded
+	virtual bool LoadStyles(const char *data, size_t len) { return false; }
+
+	/// Make the fonts attached to the file available to later loads, which
+	/// then leave out the [Fonts] section
+	/// @param fonts Font attachments of the file; called again when they change
+	/// @return Whether the provider could; if not the fonts are sent with the file
+	virtual bool LoadFonts(std::vector<AssAttachment> const& fonts) { return false; }
+
+protected:
+	/// Milliseconds the last draw spent compositing rather than rendering
+	double blend_time = 0;
+
 public:
-	virtual ~SubtitlesProvider() = default;
-	void LoadSubtitles(AssFile *subs, int time = -1);
+	SubtitlesProvider();
+	virtual ~SubtitlesProvider();
+	void LoadSubtitles(const AssFile *subs, int time = -1);
 	virtual void DrawSubtitles(VideoFrame &dst, double time)=0;
+
+	/// @brief Update a frame from the last draw to the subtitles at time
+	/// @param dst Copy of the frame passed to the last DrawSubtitles or
+	///            RedrawSubtitles call, with what was drawn still on it
+	/// @param clean The same frame without subtitles, or nullptr if they
+	///              were drawn onto a transparent frame
+	/// @return Whether the provider did so. If not, dst is unchanged and
+	///         has to be drawn from scratch.
+	virtual bool RedrawSubtitles(VideoFrame &dst, VideoFrame const* clean, double time) { return false; }
 	virtual void Reinitialize() { }
+
+	/// Make a font from outside of the subtitles, such as one attached to the
+	/// video, available to them
+	/// @param name File name of the font
+	/// @param data Contents of the font file, which needn't outlive the call
+	virtual void AddFont(std::string const& name, const char *data, size_t size) { }
+
+	/// Does DrawSubtitles also blend the alpha channel, so that it can draw
+	/// onto a transparent frame to be composited over the video later?
+	virtual bool CanDrawOverlay() const { return false; }
+
+	/// Milliseconds the last DrawSubtitles or RedrawSubtitles call spent
+	/// compositing the subtitles onto the frame, or 0 if the provider
+	/// doesn't draw them separately
+	double BlendTime() const { return blend_time; }
 };
 
 namespace agi { class BackgroundRunner; }
@@ -37,9 +37,11 @@
 #include <libaegisub/exception.h>
 #include <libaegisub/vfr.h>
 
+#include <memory>
 #include <string>
 
 struct VideoFrame;
+class VideoFramePool;
 
 class VideoProvider {
 public:
@@ -48,6 +50,21 @@ public:
 	/// Override this method to actually get frames
 	virtual void GetFrame(int n, VideoFrame &frame)=0;
 
+	/// @brief Get a frame which may be shared with other users of the provider
+	/// @param n Frame number
+	/// @param pool Pool to take the frame's buffer from if a new one is needed
+	///
+	/// The frame must not be modified. The default implementation decodes
+	/// into a recycled frame from pool, while caching providers can hand out
+	/// the frame they have stored without copying it.
+	virtual std::shared_ptr<const VideoFrame> GetSharedFrame(int n, VideoFramePool &pool);
+
+	/// @brief Decode a frame without keeping it in any cache
+	///
+	/// For frames which aren't going to be displayed, so that reading them
+	/// doesn't push more useful frames out of the cache.
+	virtual void GetFrameUncached(int n, VideoFrame &frame) { GetFrame(n, frame); }
+
 	/// Set the YCbCr matrix to the specified one
 	///
 	/// Providers are free to disregard this, and should if the requested
@@ -78,6 +95,12 @@ public:
 	/// @return Returns true if caching is desired, false otherwise.
 	virtual bool WantsCaching() const { return false; }
 
+	/// @brief Is every frame of the video the same?
+	///
+	/// Such providers should hand out one frame from GetSharedFrame, which
+	/// isn't worth caching copies of.
+	virtual bool HasStaticFrame() const { return false; }
+
 	/// Should the video properties in the script be set to this video's property if they already have values?
 	virtual bool ShouldSetVideoProperties() const { return true; }
 
@@ -39,6 +39,7 @@
 
 #include "auto4_base.h"
 #include "auto4_lua_factory.h"
+#include "batch.h"
 #include "compat.h"
 #include "crash_writer.h"
 #include "dialogs.h"
@@ -62,11 +63,15 @@
 #include <libaegisub/io.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
+#include <libaegisub/memory_budget.h>
 #include <libaegisub/path.h>
+#include <libaegisub/trace.h>
 #include <libaegisub/util.h>
 
 #include <boost/interprocess/streams/bufferstream.hpp>
 #include <boost/locale.hpp>
+#include <chrono>
+#include <iostream>
 #include <locale>
 #include <wx/clipbrd.h>
 #include <wx/msgdlg.h>
@@ -84,10 +89,30 @@ wxIMPLEMENT_APP(AegisubApp);
 
 static const char *LastStartupState = nullptr;
 
+namespace {
+using startup_clock = std::chrono::steady_clock;
+/// When the app was started, or near enough
+const startup_clock::time_point startup_time = startup_clock::now();
+/// When the current startup step started
+startup_clock::time_point startup_step_time = startup_time;
+
+long long ms_since(startup_clock::time_point time) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(startup_clock::now() - time).count();
+}
+
+/// Move on to the next startup step, logging how long the previous one took
+void StartupStep(const char *step) {
+	if (LastStartupState && agi::log::log)
+		LOG_I("main/init") << LastStartupState << ": " << ms_since(startup_step_time) << "ms";
+	LastStartupState = step;
+	startup_step_time = startup_clock::now();
+}
+}
+
 #ifdef WITH_STARTUPLOG
 #define StartupLog(a) MessageBox(0, L ## a, L"Aegisub startup log", 0)
 #else
-#define StartupLog(a) LastStartupState = a
+#define StartupLog(a) StartupStep(a)
 #endif
 
 void AegisubApp::OnAssertFailure(const wxChar *file, int line, const wxChar *func, const wxChar *cond, const wxChar *msg) {
@@ -107,6 +132,19 @@ wxDEFINE_EVENT(EVT_CALL_THUNK, ValueEvent<agi::dispatch::Thunk>);
 /// Message displayed when an exception has occurred.
 static wxString exception_message = "Oops, Aegisub has crashed!\n\nAn attempt has been made to save a copy of your file to:\n\n%s\n\nAegisub will now close.";
 
+bool AegisubApp::Initialize(int& argc, wxChar **argv) {
+	std::vector<std::string> args;
+	for (int i = 0; i < argc; ++i)
+		args.push_back(from_wx(argv[i]));
+
+	// The batch processor never opens a window, so it skips setting up the
+	// GUI toolkit and can run without a display
+	batch_mode = batch::IsBatchCommandLine(args);
+	if (batch_mode)
+		return wxAppConsole::Initialize(argc, argv);
+	return wxApp::Initialize(argc, argv);
+}
+
 /// @brief Gets called when application starts.
 /// @return bool
 bool AegisubApp::OnInit() {
@@ -209,7 +247,10 @@ bool AegisubApp::OnInit() {
 		config::opt->ConfigUser();
 	}
 	catch (agi::Exception const& err) {
-		wxMessageBox("Configuration file is invalid. Error reported:\n" + to_wx(err.GetMessage()), "Error");
+		if (batch_mode)
+			std::cerr << "Configuration file is invalid. Error reported:\n" << err.GetMessage() << "\n";
+		else
+			wxMessageBox("Configuration file is invalid. Error reported:\n" + to_wx(err.GetMessage()), "Error");
 	}
 
 #ifdef _WIN32
@@ -224,6 +265,21 @@ bool AegisubApp::OnInit() {
 	}
 #endif
 
+	// Messages less severe than the configured level aren't even formatted
+	auto set_log_level = [](agi::OptionValue const& opt) {
+		agi::log::log->SetMaxSeverity(static_cast<agi::log::Severity>(opt.GetInt()));
+	};
+	set_log_level(*OPT_GET("App/Log Level"));
+	OPT_SUB("App/Log Level", set_log_level);
+
+	// The audio, video and undo caches share one limit as well as their own
+	auto set_memory_budget = [](agi::OptionValue const& opt) {
+		agi::GlobalMemoryBudget().SetLimit((size_t)std::min<uint64_t>(uint64_t(std::max<int64_t>(opt.GetInt(), 0)) << 20, SIZE_MAX));
+		agi::GlobalMemoryBudget().Rebalance();
+	};
+	set_memory_budget(*OPT_GET("Limits/Memory Budget"));
+	OPT_SUB("Limits/Memory Budget", set_memory_budget);
+
 	// Init commands.
 	cmd::init_builtin_commands();
 
@@ -234,6 +290,7 @@ bool AegisubApp::OnInit() {
 	config::mru = new agi::MRUManager(config::path->Decode("?user/mru.json"), GET_DEFAULT_CONFIG(default_mru), config::opt);
 
 	agi::util::SetThreadName("AegiMain");
+	agi::trace::NameThread("Main");
 
 	StartupLog("Inside OnInit");
 	try {
@@ -275,12 +332,23 @@ bool AegisubApp::OnInit() {
 
 		exception_message = _("Oops, Aegisub has crashed!\n\nAn attempt has been made to save a copy of your file to:\n\n%s\n\nAegisub will now close.");
 
+		if (batch_mode) {
+			// Only the filters which don't need a project open can be used
+			StartupLog("Run batch processor");
+			AssExportFilterChain::Register(agi::make_unique<AssFixStylesFilter>());
+
+			std::vector<std::string> args;
+			for (auto const& arg : argv.GetArguments())
+				args.push_back(from_wx(arg));
+			batch_result = batch::Run(args);
+			return true;
+		}
+
 		// Load plugins
 		Automation4::ScriptFactory::Register(agi::make_unique<Automation4::LuaScriptFactory>());
 		libass::CacheFonts();
 
-		// Load Automation scripts
-		StartupLog("Load global Automation scripts");
+		StartupLog("Create global Automation script manager");
 		config::global_scripts = new Automation4::AutoloadScriptManager(OPT_GET("Path/Automation/Autoload")->GetString());
 
 		// Load export filters
@@ -295,6 +363,15 @@ bool AegisubApp::OnInit() {
 		StartupLog("Create main window");
 		NewProjectContext();
 
+		// Loading the autoload scripts can take a while with lots of them, so
+		// it waits until the window is up, and the automation menu fills in
+		// once they're loaded
+		agi::dispatch::Main().Async([] {
+			auto start = startup_clock::now();
+			config::global_scripts->Reload();
+			LOG_I("main/init") << "Loaded global Automation scripts: " << ms_since(start) << "ms";
+		});
+
 		// Version checker
 		StartupLog("Possibly perform automatic updates check");
 		if (OPT_GET("App/First Start")->GetBool()) {
@@ -302,12 +379,7 @@ bool AegisubApp::OnInit() {
 #ifdef WITH_UPDATE_CHECKER
 			int result = wxMessageBox(_("Do you want Aegisub to check for updates whenever it starts? You can still do it manually via the Help menu."),_("Check for updates?"), wxYES_NO | wxCENTER);
 			OPT_SET("App/Auto/Check For Updates")->SetBool(result == wxYES);
-			try {
-				config::opt->Flush();
-			}
-			catch (agi::fs::FileSystemError const& e) {
-				wxMessageBox(to_wx(e.GetMessage()), "Error saving config file", wxOK | wxICON_ERROR | wxCENTER);
-			}
+			config::opt->Flush();
 #endif
 		}
 
@@ -339,7 +411,11 @@ bool AegisubApp::OnInit() {
 	StartupLog("Clean old autosave files");
 	CleanCache(config::path->Decode(OPT_GET("Path/Auto/Save")->GetString()), "*.AUTOSAVE.ass", 100, 1000);
 
+	StartupLog("Clean old session snapshots");
+	CleanCache(config::path->Decode(OPT_GET("Path/Auto/Session Snapshot")->GetString()), "*.snapshot", 500, 1000);
+
 	StartupLog("Initialization complete");
+	LOG_I("main/init") << "Started up in " << ms_since(startup_time) << "ms";
 	return true;
 }
 
@@ -348,7 +424,7 @@ int AegisubApp::OnExit() {
 		delete frame;
 	frames.clear();
 
-	if (wxTheClipboard->Open()) {
+	if (!batch_mode && wxTheClipboard->Open()) {
 		wxTheClipboard->Flush();
 		wxTheClipboard->Close();
 	}
@@ -455,6 +531,9 @@ bool AegisubApp::OnExceptionInMainLoop() {
 #undef SHOW_EXCEPTION
 
 int AegisubApp::OnRun() {
+	if (batch_mode)
+		return batch_result;
+
 	std::string error;
 
 	try {
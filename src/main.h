@@ -43,6 +43,7 @@ namespace agi {
 class AegisubApp : public wxApp {
 	friend class FrameMain;
 
+	bool Initialize(int& argc, wxChar **argv) override;
 	bool OnInit() override;
 	int OnExit() override;
 	int OnRun() override;
@@ -58,6 +59,11 @@ class AegisubApp : public wxApp {
 	void OpenFiles(wxArrayStringsAdapter filenames);
 
 	std::vector<FrameMain *> frames;
+
+	/// Is this process a command line batch processor with no windows?
+	bool batch_mode = false;
+	/// Exit code of the batch processor
+	int batch_result = 0;
 public:
 	AegisubApp();
 	AegisubLocale locale;
@@ -44,14 +44,17 @@
 #include <libaegisub/ass/time.h>
 #include <libaegisub/file_mapping.h>
 #include <libaegisub/format.h>
+#include <libaegisub/fs.h>
 #include <libaegisub/scoped_ptr.h>
 
 #include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/range/irange.hpp>
 #include <boost/tokenizer.hpp>
 #include <iterator>
+#include <map>
 
 #include <wx/choicdlg.h> // Keep this last so wxUSE_CHOICEDLG is set.
 
@@ -82,12 +85,17 @@ struct MkvStdIO final : InputStream {
 	static int64_t Scan(InputStream *st, uint64_t start, unsigned signature) {
 		auto *self = static_cast<MkvStdIO*>(st);
 		try {
-			unsigned cmp = 0;
-			for (auto i : boost::irange(start, self->file.size())) {
-				int c = *self->file.read(i, 1);
-				cmp = ((cmp << 8) | c) & 0xffffffff;
-				if (cmp == signature)
-					return i - 4;
+			// Look at the file a chunk at a time rather than a byte at a time
+			const uint64_t chunk_size = 0x100000;
+			uint32_t cmp = 0;
+			for (uint64_t pos = start; pos < self->file.size(); pos += chunk_size) {
+				auto len = std::min(chunk_size, self->file.size() - pos);
+				auto data = reinterpret_cast<const unsigned char *>(self->file.read(pos, len));
+				for (uint64_t i = 0; i < len; ++i) {
+					cmp = (cmp << 8) | data[i];
+					if (cmp == signature)
+						return pos + i - 4;
+				}
 			}
 		}
 		catch (agi::Exception const& e) {
@@ -114,6 +122,16 @@ struct MkvStdIO final : InputStream {
 	}
 };
 
+/// Open a file for reading just the subtitles
+///
+/// The cues, attachments and tags all live elsewhere in the file and aren't
+/// needed to read the tracks or their frames, so avoid seeking around to
+/// parse them. This also skips scanning the end of the file for the real
+/// duration, which is only used for the progress bar.
+static MatroskaFile *open_for_subtitles(MkvStdIO *input, char *err, unsigned err_size) {
+	return mkv_OpenEx(input, 0, MKVF_AVOID_SEEKS, err, err_size);
+}
+
 static void read_subtitles(agi::ProgressSink *ps, MatroskaFile *file, MkvStdIO *input, bool srt, double totalTime, AssParser *parser) {
 	std::vector<std::pair<int, std::string>> subList;
 
@@ -170,12 +188,13 @@ static void read_subtitles(agi::ProgressSink *ps, MatroskaFile *file, MkvStdIO *
 	sort(begin(subList), end(subList));
 	for (auto order_value_pair : subList)
 		parser->AddLine(order_value_pair.second);
+	parser->Finish();
 }
 
 void MatroskaWrapper::GetSubtitles(agi::fs::path const& filename, AssFile *target) {
 	MkvStdIO input(filename);
 	char err[2048];
-	agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(mkv_Open(&input, err, sizeof(err)), mkv_Close);
+	agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(open_for_subtitles(&input, err, sizeof(err)), mkv_Close);
 	if (!file) throw MatroskaException(err);
 
 	// Get info
@@ -252,22 +271,130 @@ void MatroskaWrapper::GetSubtitles(agi::fs::path const& filename, AssFile *targe
 	progress.Run([&](agi::ProgressSink *ps) { read_subtitles(ps, file, &input, srt, totalTime, &parser); });
 }
 
+void MatroskaWrapper::GetKeyframesAndTimecodes(agi::fs::path const& filename, std::vector<int> &keyframes, std::vector<int> &timecodes) {
+	MkvStdIO input(filename);
+	char err[2048];
+	agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(mkv_Open(&input, err, sizeof(err)), mkv_Close);
+	if (!file) throw MatroskaException(err);
+
+	unsigned tracks = mkv_GetNumTracks(file);
+	unsigned track = 0;
+	while (track < tracks && mkv_GetTrackInfo(file, track)->Type != TT_VIDEO)
+		++track;
+	if (track == tracks)
+		throw MatroskaException("File has no video tracks.");
+
+	mkv_SetTrackMask(file, ~(1 << track));
+	auto segInfo = mkv_GetFileInfo(file);
+
+	// Blocks are stored in decoding order, so the frames have to be sorted
+	// into presentation order before they can be numbered
+	std::vector<std::pair<uint64_t, bool>> frames;
+	bool cancelled = false;
+	DialogProgress progress(nullptr, _("Parsing Matroska"), _("Reading keyframes and timecodes from Matroska file."));
+	progress.Run([&](agi::ProgressSink *ps) {
+		uint64_t startTime, endTime, filePos;
+		unsigned int rt, frameSize, frameFlags;
+		while (mkv_ReadFrame(file, 0, &rt, &startTime, &endTime, &filePos, &frameSize, &frameFlags) == 0) {
+			if ((cancelled = ps->IsCancelled())) return;
+			frames.emplace_back(startTime, !!(frameFlags & FRAME_KF));
+			ps->SetProgress(startTime / 1000000, segInfo->Duration / 1000000);
+		}
+	});
+	if (cancelled)
+		throw agi::UserCancelException("canceled");
+
+	std::stable_sort(begin(frames), end(frames), [](std::pair<uint64_t, bool> const& a, std::pair<uint64_t, bool> const& b) {
+		return a.first < b.first;
+	});
+
+	keyframes.clear();
+	timecodes.clear();
+	timecodes.reserve(frames.size());
+	for (size_t i = 0; i < frames.size(); ++i) {
+		if (frames[i].second)
+			keyframes.push_back(i);
+		timecodes.push_back(frames[i].first / 1000000);
+	}
+}
+
+static bool is_font(Attachment const& attachment) {
+	if (attachment.MimeType) {
+		std::string mime(attachment.MimeType);
+		if (boost::starts_with(mime, "font/") ||
+			mime == "application/x-truetype-font" || mime == "application/x-font-ttf" ||
+			mime == "application/x-font-otf" || mime == "application/vnd.ms-opentype" ||
+			mime == "application/font-sfnt")
+			return true;
+	}
+
+	// Plenty of muxers just use application/octet-stream
+	if (!attachment.Name) return false;
+	std::string name(attachment.Name);
+	return boost::iends_with(name, ".ttf") || boost::iends_with(name, ".otf") || boost::iends_with(name, ".ttc");
+}
+
+void MatroskaWrapper::GetFonts(agi::fs::path const& filename, std::function<void (std::string const&, const char *, size_t)> const& func) {
+	MkvStdIO input(filename);
+	char err[2048];
+	agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(mkv_Open(&input, err, sizeof(err)), mkv_Close);
+	if (!file) return;
+
+	Attachment *attachments;
+	unsigned count;
+	mkv_GetAttachments(file, &attachments, &count);
+	for (auto i : boost::irange(0u, count)) {
+		auto const& attachment = attachments[i];
+		if (!is_font(attachment) || !attachment.Length) continue;
+		if (attachment.Position + attachment.Length > input.file.size()) continue;
+		func(attachment.Name ? attachment.Name : "",
+			input.file.read(attachment.Position, attachment.Length),
+			static_cast<size_t>(attachment.Length));
+	}
+}
+
 bool MatroskaWrapper::HasSubtitles(agi::fs::path const& filename) {
+	// Opening a file to look at its tracks is slow on network drives, and
+	// this is checked every time a video is opened
+	struct cached_result {
+		time_t modified;
+		uintmax_t size;
+		bool has_subtitles;
+	};
+	static std::map<agi::fs::path, cached_result> cache;
+
+	time_t modified;
+	uintmax_t size;
+	try {
+		modified = agi::fs::ModifiedTime(filename);
+		size = agi::fs::Size(filename);
+	}
+	catch (agi::fs::FileSystemError const&) {
+		return false;
+	}
+
+	auto it = cache.find(filename);
+	if (it != cache.end() && it->second.modified == modified && it->second.size == size)
+		return it->second.has_subtitles;
+
+	bool has_subtitles = false;
 	char err[2048];
 	try {
 		MkvStdIO input(filename);
-		agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(mkv_Open(&input, err, sizeof(err)), mkv_Close);
-		if (!file) return false;
-
-		// Find tracks
-		auto tracks = mkv_GetNumTracks(file);
-		for (auto track : boost::irange(0u, tracks)) {
-			auto trackInfo = mkv_GetTrackInfo(file, track);
-
-			if (trackInfo->Type == 0x11 && !trackInfo->CompEnabled) {
-				std::string CodecID(trackInfo->CodecID);
-				if (CodecID == "S_TEXT/SSA" || CodecID == "S_TEXT/ASS" || CodecID == "S_TEXT/UTF8")
-					return true;
+		agi::scoped_holder<MatroskaFile*, decltype(&mkv_Close)> file(open_for_subtitles(&input, err, sizeof(err)), mkv_Close);
+		if (file) {
+			// Find tracks
+			auto tracks = mkv_GetNumTracks(file);
+			for (auto track : boost::irange(0u, tracks)) {
+				auto trackInfo = mkv_GetTrackInfo(file, track);
+
+				if (trackInfo->Type == 0x11 && !trackInfo->CompEnabled) {
+					std::string CodecID(trackInfo->CodecID);
+					if (CodecID == "S_TEXT/SSA" || CodecID == "S_TEXT/ASS" || CodecID == "S_TEXT/UTF8") {
+						has_subtitles = true;
+						break;
+					}
+				}
 			}
 		}
 	}
@@ -275,5 +402,6 @@ bool MatroskaWrapper::HasSubtitles(agi::fs::path const& filename) {
 		// We don't care about why we couldn't read subtitles here
 	}
 
-	return false;
+	cache[filename] = cached_result{modified, size, has_subtitles};
+	return has_subtitles;
 }
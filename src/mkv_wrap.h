@@ -22,6 +22,10 @@
 #include <libaegisub/exception.h>
 #include <libaegisub/fs_fwd.h>
 
+#include <functional>
+#include <string>
+#include <vector>
+
 DEFINE_EXCEPTION(MatroskaException, agi::Exception);
 
 class AssFile;
@@ -32,4 +36,16 @@ public:
 	static bool HasSubtitles(agi::fs::path const& filename);
 	/// Load subtitles from a matroska file
 	static void GetSubtitles(agi::fs::path const& filename, AssFile *target);
+	/// Read the keyframes and the frame start times in milliseconds of the
+	/// first video track in a matroska file
+	///
+	/// Only the block headers are read, so this is much faster than indexing
+	/// the file for decoding.
+	static void GetKeyframesAndTimecodes(agi::fs::path const& filename, std::vector<int> &keyframes, std::vector<int> &timecodes);
+	/// Call func with the name and contents of each font attached to a
+	/// matroska file, doing nothing if it isn't one
+	///
+	/// The contents point into a mapping of the file, so they're only valid
+	/// until func returns.
+	static void GetFonts(agi::fs::path const& filename, std::function<void (std::string const& name, const char *data, size_t size)> const& func);
 };
@@ -72,6 +72,8 @@ void General(wxTreebook *book, Preferences *parent) {
 	wxArrayString autoload_modes_arr(3, autoload_modes);
 	p->OptionChoice(general, _("Automatically load linked files"), autoload_modes_arr, "App/Auto/Load Linked Files");
 	p->OptionAdd(general, _("Undo Levels"), "Limits/Undo Levels", 2, 10000);
+	p->OptionAdd(general, _("Undo memory limit (MB)"), "Limits/Undo Memory", 16, 65536);
+	p->OptionAdd(general, _("Memory limit for all caches (MB, 0 for none)"), "Limits/Memory Budget", 0, 1048576);
 
 	auto recent = p->PageSizer(_("Recently Used Lists"));
 	p->OptionAdd(recent, _("Files"), "Limits/MRU", 0, 16);
@@ -132,6 +134,8 @@ void Audio(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(general, _("Auto-focus on mouse over"), "Audio/Auto/Focus");
 	p->OptionAdd(general, _("Play audio when stepping in video"), "Audio/Plays When Stepping Video");
 	p->OptionAdd(general, _("Left-click-drag moves end marker"), "Audio/Drag Timing");
+	p->OptionAdd(general, _("Snap markers to speech start and end"), "Audio/Snap/Silence");
+	p->OptionAdd(general, _("Play audio while dragging markers"), "Audio/Scrub/Enable");
 	p->OptionAdd(general, _("Default timing length (ms)"), "Timing/Default Duration", 0, 36000);
 	p->OptionAdd(general, _("Default lead-in length (ms)"), "Audio/Lead/IN", 0, 36000);
 	p->OptionAdd(general, _("Default lead-out length (ms)"), "Audio/Lead/OUT", 0, 36000);
@@ -139,6 +143,8 @@ void Audio(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(general, _("Marker drag-start sensitivity (px)"), "Audio/Start Drag Sensitivity", 1, 15);
 	p->OptionAdd(general, _("Line boundary thickness (px)"), "Audio/Line Boundaries Thickness", 1, 5);
 	p->OptionAdd(general, _("Maximum snap distance (px)"), "Audio/Snap/Distance", 0, 25);
+	p->OptionAdd(general, _("Silence threshold (dBFS)"), "Audio/Silence Threshold", -100, 0);
+	p->OptionAdd(general, _("Marker drag playback length (ms)"), "Audio/Scrub/Grain Length", 20, 500);
 
 	const wxString dtl_arr[] = { _("Don't show"), _("Show previous"), _("Show previous and next"), _("Show all") };
 	wxArrayString choice_dtl(4, dtl_arr);
@@ -168,6 +174,8 @@ void Video(wxTreebook *book, Preferences *parent) {
 	auto general = p->PageSizer(_("Options"));
 	p->OptionAdd(general, _("Show keyframes in slider"), "Video/Slider/Show Keyframes");
 	p->CellSkip(general);
+	p->OptionAdd(general, _("Preview seeks with thumbnails in slider"), "Video/Slider/Thumbnails");
+	p->CellSkip(general);
 	p->OptionAdd(general, _("Only show visual tools when mouse is over video"), "Tool/Visual/Autohide");
 	p->CellSkip(general);
 	p->OptionAdd(general, _("Seek video to line start on selection change"), "Video/Subtitle Sync");
@@ -210,6 +218,7 @@ void Interface(wxTreebook *book, Preferences *parent) {
 	p->CellSkip(edit_box);
 	p->OptionAdd(edit_box, _("Enable syntax highlighting"), "Subtitle/Highlight/Syntax");
 	p->OptionBrowse(edit_box, _("Dictionaries path"), "Path/Dictionary");
+	p->OptionAdd(edit_box, _("Delay before committing typed text (ms)"), "Subtitle/Edit Box/Commit Delay", 0, 5000);
 	p->OptionFont(edit_box, "Subtitle/Edit Box/");
 
 	auto character_count = p->PageSizer(_("Character Counter"));
@@ -223,6 +232,9 @@ void Interface(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(grid, _("Focus grid on click"), "Subtitle/Grid/Focus Allow");
 	p->OptionAdd(grid, _("Highlight visible subtitles"), "Subtitle/Grid/Highlight Subtitles in Frame");
 	p->OptionAdd(grid, _("Hide overrides symbol"), "Subtitle/Grid/Hide Overrides Char");
+	const wxString og_arr[] = { _("All lines"), _("Style"), _("Layer") };
+	wxArrayString og_choice(3, og_arr);
+	p->OptionChoice(grid, _("Find overlaps within"), og_choice, "Subtitle/Overlap Grouping");
 	p->OptionFont(grid, "Subtitle/Grid/");
 
 	auto tl_assistant = p->PageSizer(_("Translation Assistant"));
@@ -280,6 +292,7 @@ void Interface_Colours(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(grid, _("Selection background"), "Colour/Subtitle Grid/Background/Selection");
 	p->OptionAdd(grid, _("Collision foreground"), "Colour/Subtitle Grid/Collision");
 	p->OptionAdd(grid, _("In frame background"), "Colour/Subtitle Grid/Background/Inframe");
+	p->OptionAdd(grid, _("Search match background"), "Colour/Subtitle Grid/Background/Search Match");
 	p->OptionAdd(grid, _("Comment background"), "Colour/Subtitle Grid/Background/Comment");
 	p->OptionAdd(grid, _("Selected comment background"), "Colour/Subtitle Grid/Background/Selected Comment");
 	p->OptionAdd(grid, _("Header background"), "Colour/Subtitle Grid/Header");
@@ -287,6 +300,7 @@ void Interface_Colours(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(grid, _("Active Line Border"), "Colour/Subtitle Grid/Active Border");
 	p->OptionAdd(grid, _("Lines"), "Colour/Subtitle Grid/Lines");
 	p->OptionAdd(grid, _("CPS Error"), "Colour/Subtitle Grid/CPS Error");
+	p->OptionAdd(grid, _("Overlap"), "Colour/Subtitle Grid/Overlap");
 
 	auto visual_tools = p->PageSizer(_("Visual Typesetting Tools"));
 	p->OptionAdd(visual_tools, _("Primary Lines"), "Colour/Visual Tools/Lines Primary");
@@ -314,12 +328,18 @@ void Backup(wxTreebook *book, Preferences *parent) {
 		p->OptionAdd(save, _("Interval in seconds"), "App/Auto/Save Every Seconds", 1));
 	p->OptionBrowse(save, _("Path"), "Path/Auto/Save", cb, true);
 	p->OptionAdd(save, _("Autosave after every change"), "App/Auto/Save on Every Change");
+	p->OptionAdd(save, _("Only write changed lines (journal)"), "App/Auto/Save Journal");
 
 	auto backup = p->PageSizer(_("Automatic Backup"));
 	cb = p->OptionAdd(backup, _("Enable"), "App/Auto/Backup");
 	p->CellSkip(backup);
 	p->OptionBrowse(backup, _("Path"), "Path/Auto/Backup", cb, true);
 
+	auto snapshot = p->PageSizer(_("Session Snapshots"));
+	cb = p->OptionAdd(snapshot, _("Enable"), "App/Auto/Session Snapshot");
+	p->CellSkip(snapshot);
+	p->OptionBrowse(snapshot, _("Path"), "Path/Auto/Session Snapshot", cb, true);
+
 	p->SetSizerAndFit(p->sizer);
 }
 
@@ -356,6 +376,11 @@ void Advanced(wxTreebook *book, Preferences *parent) {
 	warning->Wrap(400);
 	general->Add(warning, 0, wxALL, 5);
 
+	auto logging = p->PageSizer(_("Logging"));
+	const wxString log_levels[] = { _("Exceptions"), _("Assertions"), _("Warnings"), _("Information"), _("Debug") };
+	wxArrayString log_levels_choice(5, log_levels);
+	p->OptionChoice(logging, _("Log verbosity"), log_levels_choice, "App/Log Level");
+
 	p->SetSizerAndFit(p->sizer);
 }
 
@@ -370,12 +395,19 @@ void Advanced_Audio(wxTreebook *book, Preferences *parent) {
 
 	wxArrayString apl_choice = to_wx(AudioPlayerFactory::GetClasses());
 	p->OptionChoice(expert, _("Audio player"), apl_choice, "Audio/Player");
+	p->OptionAdd(expert, _("Low latency playback"), "Player/Audio/Low Latency");
+	p->OptionAdd(expert, _("Playback read ahead (ms)"), "Player/Audio/Read Ahead", 100, 30000);
 
 	auto cache = p->PageSizer(_("Cache"));
 	const wxString ct_arr[3] = { _("None (NOT RECOMMENDED)"), _("RAM"), _("Hard Disk") };
 	wxArrayString ct_choice(3, ct_arr);
 	p->OptionChoice(cache, _("Cache type"), ct_choice, "Audio/Cache/Type");
 	p->OptionBrowse(cache, _("Path"), "Audio/Cache/HD/Location");
+	p->OptionAdd(cache, _("Compress and keep hard disk cache"), "Audio/Cache/HD/Compress");
+	p->OptionAdd(cache, _("Share cache with other instances"), "Audio/Cache/Share");
+	p->OptionAdd(cache, _("Hard disk cache max size (MB)"), "Audio/Cache/HD/Size", 16, 100000);
+	p->OptionAdd(cache, _("Hard disk cache max files"), "Audio/Cache/HD/Files", 1, 1000);
+	p->OptionAdd(cache, _("Decoder threads (0 = automatic)"), "Audio/Cache/Threads", 0, 64);
 
 	auto spectrum = p->PageSizer(_("Spectrum"));
 
@@ -384,6 +416,9 @@ void Advanced_Audio(wxTreebook *book, Preferences *parent) {
 	p->OptionChoice(spectrum, _("Quality"), sq_choice, "Audio/Renderer/Spectrum/Quality");
 
 	p->OptionAdd(spectrum, _("Cache memory max (MB)"), "Audio/Renderer/Spectrum/Memory Max", 2, 1024);
+	p->OptionAdd(spectrum, _("Keep spectrum cache on disk"), "Audio/Renderer/Spectrum/Disk Cache/Enable");
+	p->OptionAdd(spectrum, _("Disk cache max size (MB)"), "Audio/Renderer/Spectrum/Disk Cache/Size", 16, 100000);
+	p->OptionAdd(spectrum, _("Disk cache max files"), "Audio/Renderer/Spectrum/Disk Cache/Files", 1, 1000);
 
 #ifdef WITH_AVISYNTH
 	auto avisynth = p->PageSizer("Avisynth");
@@ -419,6 +454,11 @@ void Advanced_Audio(wxTreebook *book, Preferences *parent) {
 	p->OptionAdd(dsound, _("Buffer length"), "Player/Audio/DirectSound/Buffer Length", 1, 100);
 #endif
 
+#ifdef WITH_WASAPI
+	auto wasapi = p->PageSizer("WASAPI");
+	p->OptionAdd(wasapi, _("Exclusive mode"), "Player/Audio/WASAPI/Exclusive Mode");
+#endif
+
 	p->SetSizerAndFit(p->sizer);
 }
 
@@ -434,11 +474,20 @@ void Advanced_Video(wxTreebook *book, Preferences *parent) {
 	wxArrayString sp_choice = to_wx(SubtitlesProviderFactory::GetClasses());
 	p->OptionChoice(expert, _("Subtitles provider"), sp_choice, "Subtitle/Provider");
 
+	p->OptionAdd(expert, _("Frames to decode ahead"), "Provider/Video/Prefetch", 0, 64);
+	p->OptionAdd(expert, _("Subtitle renderers for playback"), "Provider/Video/Render Ahead Threads", 0, 16);
+
+	const wxString proxy_arr[] = { _("Full"), _("Half"), _("Quarter") };
+	wxArrayString proxy_choice(3, proxy_arr);
+	p->OptionChoice(expert, _("Decoding resolution"), proxy_choice, "Provider/Video/Proxy Resolution");
+
 #ifdef WITH_AVISYNTH
 	auto avisynth = p->PageSizer("Avisynth");
 	p->OptionAdd(avisynth, _("Allow pre-2.56a Avisynth"), "Provider/Avisynth/Allow Ancient");
 	p->CellSkip(avisynth);
 	p->OptionAdd(avisynth, _("Avisynth memory limit"), "Provider/Avisynth/Memory Max");
+	p->OptionAdd(avisynth, _("Prefetch threads (0 = off, -1 = automatic)"), "Provider/Avisynth/Prefetch Threads", -1, 64);
+	p->OptionAdd(avisynth, _("Convert YUV to RGB on the GPU"), "Provider/Avisynth/YUV Output");
 #endif
 
 #ifdef WITH_FFMS2
@@ -449,7 +498,17 @@ void Advanced_Video(wxTreebook *book, Preferences *parent) {
 	p->OptionChoice(ffms, _("Debug log verbosity"), log_levels_choice, "Provider/FFmpegSource/Log Level");
 
 	p->OptionAdd(ffms, _("Decoding threads"), "Provider/Video/FFmpegSource/Decoding Threads", -1);
-	p->OptionAdd(ffms, _("Enable unsafe seeking"), "Provider/Video/FFmpegSource/Unsafe Seeking");
+
+	const wxString seek_modes[] = { _("Linear without rewind"), _("Linear"), _("Normal"), _("Unsafe"), _("Aggressive") };
+	wxArrayString seek_modes_choice(5, seek_modes);
+	p->OptionChoice(ffms, _("Seek mode"), seek_modes_choice, "Provider/Video/FFmpegSource/Seek Mode");
+
+	p->OptionAdd(ffms, _("Separate decoder for seeking"), "Provider/Video/FFmpegSource/Seek Source");
+	p->OptionAdd(ffms, _("Convert YUV to RGB on the GPU"), "Provider/Video/FFmpegSource/YUV Output");
+
+	p->OptionBrowse(ffms, _("Index cache path"), "Provider/FFmpegSource/Cache/Location");
+	p->OptionAdd(ffms, _("Index cache max size (MB)"), "Provider/FFmpegSource/Cache/Size", 1, 100000);
+	p->OptionAdd(ffms, _("Index cache max files"), "Provider/FFmpegSource/Cache/Files", 0, 100000);
 #endif
 
 	p->SetSizerAndFit(p->sizer);
@@ -38,6 +38,7 @@
 #include "video_display.h"
 
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/file_mapping.h>
 #include <libaegisub/format_path.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/keyframe.h>
@@ -49,6 +50,12 @@
 #include <boost/filesystem/operations.hpp>
 #include <wx/msgdlg.h>
 
+namespace {
+bool is_matroska(agi::fs::path const& path) {
+	return agi::fs::HasExtension(path, "mkv") || agi::fs::HasExtension(path, "webm");
+}
+}
+
 Project::Project(agi::Context *c) : context(c) {
 	OPT_SUB("Audio/Cache/Type", &Project::ReloadAudio, this);
 	OPT_SUB("Audio/Provider", &Project::ReloadAudio, this);
@@ -56,7 +63,10 @@ Project::Project(agi::Context *c) : context(c) {
 	OPT_SUB("Provider/Avisynth/Allow Ancient", &Project::ReloadVideo, this);
 	OPT_SUB("Provider/Avisynth/Memory Max", &Project::ReloadVideo, this);
 	OPT_SUB("Provider/Video/FFmpegSource/Decoding Threads", &Project::ReloadVideo, this);
-	OPT_SUB("Provider/Video/FFmpegSource/Unsafe Seeking", &Project::ReloadVideo, this);
+	OPT_SUB("Provider/Video/FFmpegSource/Seek Mode", &Project::ReloadVideo, this);
+	OPT_SUB("Provider/Video/FFmpegSource/Seek Source", &Project::ReloadVideo, this);
+	OPT_SUB("Provider/Video/FFmpegSource/YUV Output", &Project::ReloadVideo, this);
+	OPT_SUB("Provider/Video/Proxy Resolution", &Project::ReloadVideo, this);
 	OPT_SUB("Subtitle/Provider", &Project::ReloadVideo, this);
 	OPT_SUB("Video/Provider", &Project::ReloadVideo, this);
 }
@@ -100,8 +110,16 @@ void Project::SetPath(agi::fs::path& var, const char *token, const char *mru, ag
 }
 
 bool Project::DoLoadSubtitles(agi::fs::path const& path, std::string encoding, ProjectProperties &properties) {
+	// Detecting the charset, trying the file as timecodes and keyframes and
+	// then parsing it all read the same mapping of the file
+	agi::shared_read_mapping shared_file(path);
+
+	// A file with an up to date snapshot was a subtitle file when the snapshot
+	// was written, so it doesn't need to be checked for being anything else
+	bool snapshot = encoding.empty() && context->subsController->HasSnapshot(path);
+
 	try {
-		if (encoding.empty())
+		if (encoding.empty() && !snapshot)
 			encoding = CharSetDetect::GetEncoding(path);
 	}
 	catch (agi::UserCancelException const&) {
@@ -113,7 +131,7 @@ bool Project::DoLoadSubtitles(agi::fs::path const& path, std::string encoding, P
 		return false;
 	}
 
-	if (encoding != "binary") {
+	if (encoding != "binary" && !snapshot) {
 		// Try loading as timecodes and keyframes first since we can't
 		// distinguish them based on filename alone, and just ignore failures
 		// rather than trying to differentiate between malformed timecodes
@@ -207,6 +225,19 @@ void Project::LoadUnloadFiles(ProjectProperties properties) {
 			return;
 	}
 
+	// Audio from a separate file is opened before the video so that the
+	// audio cache is filled in the background while the video is indexed
+	auto load_audio = [&] {
+		if (audio.empty())
+			CloseAudio();
+		else
+			DoLoadAudio(audio, false);
+	};
+	bool audio_changed = audio != audio_file;
+	bool audio_first = audio_changed && audio != video;
+	if (audio_first)
+		load_audio();
+
 	bool loaded_video = false;
 	if (video != video_file) {
 		if (video.empty())
@@ -227,11 +258,9 @@ void Project::LoadUnloadFiles(ProjectProperties properties) {
 	if (!timecodes.empty()) LoadTimecodes(timecodes);
 	if (!keyframes.empty()) LoadKeyframes(keyframes);
 
-	if (audio != audio_file) {
-		if (audio.empty())
-			CloseAudio();
-		else
-			DoLoadAudio(audio, false);
+	if (audio_changed) {
+		if (!audio_first)
+			load_audio();
 	}
 	else if (loaded_video && OPT_GET("Video/Open Audio")->GetBool() && audio_file != video_file && video_provider->HasAudio())
 		DoLoadAudio(video, true);
@@ -241,9 +270,15 @@ void Project::DoLoadAudio(agi::fs::path const& path, bool quiet) {
 	if (!progress)
 		progress = new DialogProgress(context->parent);
 
+	// Listeners may still be using the old provider until they've been told
+	// about the new one, so it has to outlive the announcement
+	std::unique_ptr<agi::AudioProvider> old_provider;
+
 	try {
 		try {
-			audio_provider = GetAudioProvider(path, *context->path, progress);
+			auto new_provider = GetAudioProvider(path, *context->path, progress);
+			old_provider = std::move(audio_provider);
+			audio_provider = std::move(new_provider);
 		}
 		catch (agi::UserCancelException const&) { return; }
 		catch (...) {
@@ -352,7 +387,13 @@ void Project::CloseVideo() {
 }
 
 void Project::DoLoadTimecodes(agi::fs::path const& path) {
-	timecodes = agi::vfr::Framerate(path);
+	if (is_matroska(path)) {
+		std::vector<int> mkv_keyframes, mkv_timecodes;
+		MatroskaWrapper::GetKeyframesAndTimecodes(path, mkv_keyframes, mkv_timecodes);
+		timecodes = agi::vfr::Framerate(mkv_timecodes);
+	}
+	else
+		timecodes = agi::vfr::Framerate(path);
 	SetPath(timecodes_file, "", "Timecodes", path);
 	AnnounceTimecodesModified(timecodes);
 }
@@ -369,6 +410,11 @@ void Project::LoadTimecodes(agi::fs::path path) {
 		ShowError("Failed to parse timecodes file: " + e.GetMessage());
 		config::mru->Remove("Timecodes", path);
 	}
+	catch (MatroskaException const& e) {
+		ShowError("Failed to read timecodes: " + e.GetMessage());
+		config::mru->Remove("Timecodes", path);
+	}
+	catch (agi::UserCancelException const&) { }
 }
 
 void Project::CloseTimecodes() {
@@ -378,7 +424,21 @@ void Project::CloseTimecodes() {
 }
 
 void Project::DoLoadKeyframes(agi::fs::path const& path) {
-	keyframes = agi::keyframe::Load(path);
+	if (is_matroska(path)) {
+		std::vector<int> mkv_keyframes, mkv_timecodes;
+		MatroskaWrapper::GetKeyframesAndTimecodes(path, mkv_keyframes, mkv_timecodes);
+		keyframes = std::move(mkv_keyframes);
+
+		// Without video the keyframes are only meaningful along with the
+		// frame times from the same file
+		if (!video_provider && timecodes_file.empty() && mkv_timecodes.size() > 1) {
+			timecodes = agi::vfr::Framerate(mkv_timecodes);
+			SetPath(timecodes_file, "", "Timecodes", path);
+			AnnounceTimecodesModified(timecodes);
+		}
+	}
+	else
+		keyframes = agi::keyframe::Load(path);
 	SetPath(keyframes_file, "", "Keyframes", path);
 	AnnounceKeyframesModified(keyframes);
 }
@@ -395,6 +455,11 @@ void Project::LoadKeyframes(agi::fs::path path) {
 		ShowError("Failed to parse keyframes file: " + e.GetMessage());
 		config::mru->Remove("Keyframes", path);
 	}
+	catch (MatroskaException const& e) {
+		ShowError("Failed to read keyframes: " + e.GetMessage());
+		config::mru->Remove("Keyframes", path);
+	}
+	catch (agi::UserCancelException const&) { }
 }
 
 void Project::CloseKeyframes() {
@@ -509,6 +574,12 @@ void Project::LoadList(std::vector<agi::fs::path> const& files) {
 			subs.clear();
 	}
 
+	// As in LoadUnloadFiles, start caching a separate audio file before
+	// indexing the video
+	bool audio_first = !audio.empty() && audio != video;
+	if (audio_first)
+		DoLoadAudio(audio, false);
+
 	if (!video.empty() && DoLoadVideo(video)) {
 		double dar = video_provider->GetDAR();
 		if (dar > 0)
@@ -526,8 +597,10 @@ void Project::LoadList(std::vector<agi::fs::path> const& files) {
 			LoadKeyframes(keyframes);
 	}
 
-	if (!audio.empty())
-		DoLoadAudio(audio, false);
+	if (!audio.empty()) {
+		if (!audio_first)
+			DoLoadAudio(audio, false);
+	}
 	else if (OPT_GET("Video/Open Audio")->GetBool() && audio_file != video_file)
 		DoLoadAudio(video_file, true);
 
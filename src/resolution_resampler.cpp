@@ -30,6 +30,8 @@
 #include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include <cmath>
+#include <exception>
+#include <thread>
 #include <wx/intl.h>
 
 enum {
@@ -64,6 +66,9 @@ std::vector<std::string> MatrixNames() {
 }
 
 namespace {
+	/// Lines per thread below which resampling isn't worth splitting up
+	const size_t min_lines_per_thread = 512;
+
 	std::string transform_drawing(std::string const& drawing, int shift_x, int shift_y, double scale_x, double scale_y) {
 		bool is_x = true;
 		std::string final;
@@ -105,7 +110,7 @@ namespace {
 		bool convert_colors;
 	};
 
-	void resample_tags(std::string const& name, AssOverrideParameter *cur, void *ud) {
+	void resample_tags(AssTagId, AssOverrideParameter *cur, void *ud) {
 		resample_state *state = static_cast<resample_state *>(ud);
 
 		double resizer = 1.0;
@@ -278,8 +283,42 @@ void ResampleResolution(AssFile *ass, ResampleSettings settings) {
 
 	for (auto& line : ass->Styles)
 		resample_style(&state, line);
+
+	// Each line is resampled independently of the others, so ranges of them
+	// can be done on separate threads
+	std::vector<AssDialogue *> lines;
 	for (auto& line : ass->Events)
-		resample_line(&state, line);
+		lines.push_back(&line);
+
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+		lines.size() / min_lines_per_thread);
+	threads = std::max<size_t>(threads, 1);
+
+	std::vector<std::exception_ptr> errors(threads);
+	auto resample_range = [&](size_t t) {
+		size_t end = lines.size() * (t + 1) / threads;
+		try {
+			for (size_t i = lines.size() * t / threads; i < end; ++i)
+				resample_line(&state, *lines[i]);
+		}
+		catch (...) {
+			errors[t] = std::current_exception();
+		}
+	};
+
+	if (threads == 1)
+		resample_range(0);
+	else {
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+		for (size_t t = 0; t < threads; ++t)
+			workers.emplace_back(resample_range, t);
+		for (auto& worker : workers)
+			worker.join();
+	}
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
 
 	ass->SetScriptInfo("PlayResX", std::to_string(settings.dest_x));
 	ass->SetScriptInfo("PlayResY", std::to_string(settings.dest_y));
@@ -0,0 +1,197 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "search_match_index.h"
+
+#include "ass_dialogue.h"
+#include "ass_file.h"
+#include "include/aegisub/context.h"
+
+#include <libaegisub/dispatch.h>
+
+#include <algorithm>
+
+namespace {
+typedef std::function<MatchState (const AssDialogue*, size_t)> matcher;
+
+size_t count_matches(matcher &matches, SearchReplaceSettings const& settings, const AssDialogue *line) {
+	if (settings.ignore_comments && line->Comment) return 0;
+
+	size_t count = 0;
+	size_t pos = 0;
+	while (MatchState ms = matches(line, pos)) {
+		++count;
+		// An empty match would just be found again at the same place
+		if (ms.end == ms.start) break;
+		pos = ms.end;
+	}
+	return count;
+}
+
+/// Would the two settings find the same matches in the whole file?
+bool same_search(SearchReplaceSettings const& a, SearchReplaceSettings const& b) {
+	return a.find == b.find && a.field == b.field && a.match_case == b.match_case
+		&& a.use_regex == b.use_regex && a.ignore_comments == b.ignore_comments
+		&& a.skip_tags == b.skip_tags && a.exact_match == b.exact_match;
+}
+
+/// Count the matches in a copy of a line, so that the matcher's normalization
+/// of the field doesn't modify the file outside of a commit
+size_t count_matches_in_copy(matcher &matches, SearchReplaceSettings const& settings, AssDialogueBase const& line) {
+	AssDialogue copy(line);
+	return count_matches(matches, settings, &copy);
+}
+}
+
+SearchMatchIndex::SearchMatchIndex(agi::Context *c)
+: c(c)
+, generation(std::make_shared<std::atomic<int>>(0))
+, commit_connection(c->ass->AddCommitListener(&SearchMatchIndex::OnCommit, this))
+{
+}
+
+SearchMatchIndex::~SearchMatchIndex() {
+	++*generation;
+}
+
+void SearchMatchIndex::Configure(SearchReplaceSettings const& new_settings) {
+	if (new_settings.find.empty()) {
+		Clear();
+		return;
+	}
+
+	if (matcher && same_search(settings, new_settings))
+		return;
+
+	auto new_matcher = SearchReplaceEngine::GetMatcher(new_settings);
+	settings = new_settings;
+	matcher = std::move(new_matcher);
+	Rebuild();
+}
+
+void SearchMatchIndex::Clear() {
+	++*generation;
+	matcher = nullptr;
+	hits.clear();
+	lines.clear();
+	total = 0;
+	building = false;
+	AnnounceChanged();
+}
+
+void SearchMatchIndex::Rebuild() {
+	int gen = ++*generation;
+	building = true;
+	AnnounceChanged();
+
+	auto copies = std::make_shared<std::vector<AssDialogueBase>>();
+	copies->reserve(c->ass->Events.size());
+	for (auto const& line : c->ass->Events)
+		copies->push_back(line);
+
+	auto matches = matcher;
+	auto search = settings;
+	std::weak_ptr<std::atomic<int>> weak_generation = generation;
+	agi::dispatch::Background().Async([=]() mutable {
+		auto results = std::make_shared<std::vector<std::pair<int, size_t>>>();
+		try {
+			for (auto const& line : *copies) {
+				// Newer search or edit made this one pointless
+				auto current = weak_generation.lock();
+				if (!current || *current != gen) return;
+
+				if (size_t count = count_matches_in_copy(matches, search, line))
+					results->emplace_back(line.Id, count);
+			}
+		}
+		catch (...) {
+			// Matching blew up (e.g. regex too complex); treat as no matches
+			results->clear();
+		}
+
+		agi::dispatch::Main().Async([=] {
+			auto current = weak_generation.lock();
+			if (!current || *current != gen) return;
+
+			hits.clear();
+			total = 0;
+			for (auto const& result : *results) {
+				hits[result.first] = result.second;
+				total += result.second;
+			}
+			building = false;
+			UpdateLines();
+			AnnounceChanged();
+		});
+	});
+}
+
+void SearchMatchIndex::UpdateLines() {
+	lines.clear();
+	if (hits.empty()) return;
+	for (auto& line : c->ass->Events) {
+		if (hits.count(line.Id))
+			lines.push_back(&line);
+	}
+}
+
+void SearchMatchIndex::OnCommit(int type, const AssDialogue *, AssCommitChanges const& changes) {
+	if (!matcher) return;
+	if (type != AssFile::COMMIT_NEW && !(type & (AssFile::COMMIT_DIAG_FULL | AssFile::COMMIT_DIAG_ADDREM | AssFile::COMMIT_ORDER)))
+		return;
+
+	if (building || type == AssFile::COMMIT_NEW || (type & AssFile::COMMIT_DIAG_ADDREM) || (!changes.known && (type & AssFile::COMMIT_DIAG_FULL))) {
+		Rebuild();
+		return;
+	}
+
+	bool membership_changed = !!(type & AssFile::COMMIT_ORDER);
+	for (auto line : changes.lines) {
+		size_t count = count_matches_in_copy(matcher, settings, *line);
+		auto it = hits.find(line->Id);
+		size_t old = it == hits.end() ? 0 : it->second;
+		total = total - old + count;
+		membership_changed |= !old != !count;
+		if (!count) {
+			if (it != hits.end()) hits.erase(it);
+		}
+		else
+			hits[line->Id] = count;
+	}
+
+	if (membership_changed)
+		UpdateLines();
+	AnnounceChanged();
+}
+
+size_t SearchMatchIndex::Matches(const AssDialogue *line) const {
+	if (!line || hits.empty()) return 0;
+	auto it = hits.find(line->Id);
+	return it == hits.end() ? 0 : it->second;
+}
+
+AssDialogue *SearchMatchIndex::Next(const AssDialogue *line, bool backwards) const {
+	if (lines.empty()) return nullptr;
+	if (!line) return backwards ? lines.back() : lines.front();
+
+	auto by_row = [](AssDialogue const* a, int row) { return a->Row < row; };
+	auto it = std::lower_bound(begin(lines), end(lines), line->Row, by_row);
+	if (backwards)
+		return it == begin(lines) ? lines.back() : *(it - 1);
+	if (it != end(lines) && *it == line)
+		++it;
+	return it == end(lines) ? lines.front() : *it;
+}
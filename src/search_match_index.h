@@ -0,0 +1,95 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include "search_replace_engine.h"
+
+#include <libaegisub/signal.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace agi { struct Context; }
+class AssDialogue;
+struct AssCommitChanges;
+
+/// @class SearchMatchIndex
+/// @brief Live count of the matches for a search in every line of the file
+///
+/// Configuring the index starts counting the matches on a background thread
+/// against a copy of the lines. Once that's done, commits which name the lines
+/// they changed are handled by recounting just those lines, and anything else
+/// starts a new background count.
+class SearchMatchIndex {
+	agi::Context *c;
+	SearchReplaceSettings settings;
+	std::function<MatchState (const AssDialogue*, size_t)> matcher;
+
+	/// Number of matches in each line which has any, by line Id
+	std::unordered_map<int, size_t> hits;
+	/// Lines with at least one match, in file order
+	std::vector<AssDialogue *> lines;
+	size_t total = 0;
+	bool building = false;
+
+	/// Bumped whenever a background count is started or the index is
+	/// cleared, so that counts which are no longer wanted are abandoned
+	std::shared_ptr<std::atomic<int>> generation;
+
+	agi::signal::Connection commit_connection;
+	agi::signal::Signal<> AnnounceChanged;
+
+	void Rebuild();
+	/// Rebuild lines from hits
+	void UpdateLines();
+	void OnCommit(int type, const AssDialogue *, AssCommitChanges const& changes);
+
+public:
+	SearchMatchIndex(agi::Context *c);
+	~SearchMatchIndex();
+
+	/// Start counting the matches for a new search
+	/// @throws anything GetMatcher throws for a bad search
+	///
+	/// The index is cleared if settings.find is empty. The limit_to setting is
+	/// ignored, as every line is counted.
+	void Configure(SearchReplaceSettings const& settings);
+
+	/// Stop tracking matches and clear the index
+	void Clear();
+
+	/// Is there a search which the index is tracking?
+	bool Active() const { return !!matcher; }
+	/// Are the counts still being worked out?
+	bool Building() const { return building; }
+
+	/// Total number of matches in the file
+	size_t TotalMatches() const { return total; }
+	/// Number of lines with at least one match
+	size_t MatchingLines() const { return lines.size(); }
+	/// Number of matches in a line
+	size_t Matches(const AssDialogue *line) const;
+
+	/// Get the closest matching line after or before line, wrapping around
+	/// at the end of the file, or nullptr if nothing matches
+	AssDialogue *Next(const AssDialogue *line, bool backwards) const;
+
+	DEFINE_SIGNAL_ADDERS(AnnounceChanged, AddChangeListener)
+};
@@ -27,12 +27,16 @@
 #include <libaegisub/util.h>
 
 #include <boost/locale/conversion.hpp>
+#include <numeric>
+#include <thread>
 
 #include <wx/msgdlg.h>
 
 namespace {
 static const size_t bad_pos = -1;
 static const MatchState bad_match{nullptr, 0, bad_pos};
+/// Fewest lines worth handing to a separate thread in ReplaceAll
+static const size_t min_lines_per_thread = 1024;
 
 auto get_dialogue_field(SearchReplaceSettings::Field field) -> decltype(&AssDialogueBase::Text) {
 	switch (field) {
@@ -55,7 +59,7 @@ std::string const& get_normalized(const AssDialogue *diag, decltype(&AssDialogue
 typedef std::function<MatchState (const AssDialogue*, size_t)> matcher;
 
 class noop_accessor {
-	boost::flyweight<std::string> AssDialogueBase::*field;
+	agi::StringFlyweight AssDialogueBase::*field;
 	size_t start = 0;
 
 public:
@@ -72,7 +76,7 @@ public:
 };
 
 class skip_tags_accessor {
-	boost::flyweight<std::string> AssDialogueBase::*field;
+	agi::StringFlyweight AssDialogueBase::*field;
 	agi::util::tagless_find_helper helper;
 
 public:
@@ -149,7 +153,31 @@ SearchReplaceEngine::SearchReplaceEngine(agi::Context *c)
 {
 }
 
-void SearchReplaceEngine::Replace(AssDialogue *diag, MatchState &ms) {
+size_t SearchReplaceEngine::ReplaceAll(AssDialogue *diag, std::function<MatchState (const AssDialogue*, size_t)> &matches) const {
+	if (settings.use_regex) {
+		MatchState ms = matches(diag, 0);
+		if (!ms) return 0;
+
+		auto& diag_field = diag->*get_dialogue_field(settings.field);
+		std::string const& text = diag_field.get();
+		size_t count = std::distance(
+			boost::u32regex_iterator<std::string::const_iterator>(begin(text), end(text), *ms.re),
+			boost::u32regex_iterator<std::string::const_iterator>());
+		diag_field = u32regex_replace(text, *ms.re, settings.replace_with);
+		return count;
+	}
+
+	size_t count = 0;
+	size_t pos = 0;
+	while (MatchState ms = matches(diag, pos)) {
+		++count;
+		Replace(diag, ms);
+		pos = ms.end;
+	}
+	return count;
+}
+
+void SearchReplaceEngine::Replace(AssDialogue *diag, MatchState &ms) const {
 	auto& diag_field = diag->*get_dialogue_field(settings.field);
 	auto text = diag_field.get();
 
@@ -238,36 +266,55 @@ bool SearchReplaceEngine::ReplaceAll() {
 	if (!initialized)
 		return false;
 
-	size_t count = 0;
-
+	// Compiled here so that a bad regex is reported before anything else
 	auto matches = GetMatcher(settings);
 
 	auto const& sel = context->selectionController->GetSelectedSet();
 	bool selection_only = settings.limit_to == SearchReplaceSettings::Limit::SELECTED;
 
+	std::vector<AssDialogue *> lines;
 	for (auto& diag : context->ass->Events) {
 		if (selection_only && !sel.count(&diag)) continue;
 		if (settings.ignore_comments && diag.Comment) continue;
+		lines.push_back(&diag);
+	}
 
-		if (settings.use_regex) {
-			if (MatchState ms = matches(&diag, 0)) {
-				auto& diag_field = diag.*get_dialogue_field(settings.field);
-				std::string const& text = diag_field.get();
-				count += std::distance(
-					boost::u32regex_iterator<std::string::const_iterator>(begin(text), end(text), *ms.re),
-					boost::u32regex_iterator<std::string::const_iterator>());
-				diag_field = u32regex_replace(text, *ms.re, settings.replace_with);
-			}
-			continue;
+	// Each line is matched and replaced independently of the others, so
+	// ranges of them can be done on separate threads, each with its own copy
+	// of the matcher since they carry state between calls
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+		lines.size() / min_lines_per_thread);
+	threads = std::max<size_t>(threads, 1);
+
+	std::vector<size_t> counts(threads);
+	std::vector<std::exception_ptr> errors(threads);
+	auto replace_range = [&](size_t t) {
+		auto range_matches = matches;
+		size_t end = lines.size() * (t + 1) / threads;
+		try {
+			for (size_t i = lines.size() * t / threads; i < end; ++i)
+				counts[t] += ReplaceAll(lines[i], range_matches);
 		}
-
-		size_t pos = 0;
-		while (MatchState ms = matches(&diag, pos)) {
-			++count;
-			Replace(&diag, ms);
-			pos = ms.end;
+		catch (...) {
+			errors[t] = std::current_exception();
 		}
+	};
+
+	if (threads == 1)
+		replace_range(0);
+	else {
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+		for (size_t t = 0; t < threads; ++t)
+			workers.emplace_back(replace_range, t);
+		for (auto& worker : workers)
+			worker.join();
 	}
+	for (auto& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
+
+	size_t count = std::accumulate(begin(counts), end(counts), size_t(0));
 
 	if (count > 0) {
 		context->ass->Commit(_("replace"), AssFile::COMMIT_DIAG_TEXT);
@@ -60,7 +60,9 @@ class SearchReplaceEngine {
 	SearchReplaceSettings settings;
 
 	bool FindReplace(bool replace);
-	void Replace(AssDialogue *line, MatchState &ms);
+	void Replace(AssDialogue *line, MatchState &ms) const;
+	/// Replace every match in one line, returning the number replaced
+	size_t ReplaceAll(AssDialogue *line, std::function<MatchState (const AssDialogue*, size_t)> &matches) const;
 
 public:
 	bool FindNext() { return FindReplace(false); }
@@ -0,0 +1,82 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "selection.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+typedef std::back_insert_iterator<std::vector<AssDialogue *>> out_iterator;
+}
+
+void Selection::Normalize() const {
+	if (sorted == lines.size()) return;
+
+	auto middle = lines.begin() + sorted;
+	std::sort(middle, lines.end());
+	std::inplace_merge(lines.begin(), middle, lines.end());
+	lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+	sorted = lines.size();
+}
+
+Selection::iterator Selection::find(const AssDialogue *line) const {
+	Normalize();
+	auto it = std::lower_bound(lines.cbegin(), lines.cend(), line);
+	return it != lines.cend() && *it == line ? it : lines.cend();
+}
+
+size_t Selection::erase(const AssDialogue *line) {
+	auto it = find(line);
+	if (it == lines.cend()) return 0;
+	lines.erase(it);
+	--sorted;
+	return 1;
+}
+
+bool Selection::operator==(Selection const& other) const {
+	Normalize();
+	other.Normalize();
+	return lines == other.lines;
+}
+
+template<typename Op>
+Selection Selection::Combine(Selection const& other, Op op) const {
+	Normalize();
+	other.Normalize();
+	Selection ret;
+	op(lines.cbegin(), lines.cend(), other.lines.cbegin(), other.lines.cend(), std::back_inserter(ret.lines));
+	ret.sorted = ret.lines.size();
+	return ret;
+}
+
+Selection Selection::Union(Selection const& other) const {
+	return Combine(other, [](iterator b1, iterator e1, iterator b2, iterator e2, out_iterator out) {
+		std::set_union(b1, e1, b2, e2, out);
+	});
+}
+
+Selection Selection::Intersection(Selection const& other) const {
+	return Combine(other, [](iterator b1, iterator e1, iterator b2, iterator e2, out_iterator out) {
+		std::set_intersection(b1, e1, b2, e2, out);
+	});
+}
+
+Selection Selection::Difference(Selection const& other) const {
+	return Combine(other, [](iterator b1, iterator e1, iterator b2, iterator e2, out_iterator out) {
+		std::set_difference(b1, e1, b2, e2, out);
+	});
+}
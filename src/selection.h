@@ -0,0 +1,80 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+class AssDialogue;
+
+/// @class Selection
+/// @brief A set of dialogue lines, stored as a sorted array of pointers
+///
+/// Lines may be inserted in any order and the array is only sorted the next
+/// time the set is read, so building a selection of n lines costs a single
+/// allocation and sort rather than one tree node per line. Iteration is in
+/// address order; use SelectionController::GetSortedSelection for file order.
+class Selection {
+	mutable std::vector<AssDialogue *> lines;
+	/// Number of leading entries of lines which are sorted and unique
+	mutable size_t sorted = 0;
+
+	/// Sort and deduplicate anything inserted since the last read
+	void Normalize() const;
+
+	template<typename Op>
+	Selection Combine(Selection const& other, Op op) const;
+
+public:
+	typedef AssDialogue *value_type;
+	typedef std::vector<AssDialogue *>::const_iterator iterator;
+	typedef iterator const_iterator;
+	typedef std::vector<AssDialogue *>::const_reverse_iterator reverse_iterator;
+
+	Selection() = default;
+	Selection(std::initializer_list<AssDialogue *> init) : lines(init) { }
+	template<typename Iterator>
+	Selection(Iterator first, Iterator last) : lines(first, last) { }
+
+	iterator begin() const { Normalize(); return lines.begin(); }
+	iterator end() const { Normalize(); return lines.end(); }
+	reverse_iterator rbegin() const { Normalize(); return lines.rbegin(); }
+	reverse_iterator rend() const { Normalize(); return lines.rend(); }
+	size_t size() const { Normalize(); return lines.size(); }
+	bool empty() const { return lines.empty(); }
+
+	iterator find(const AssDialogue *line) const;
+	size_t count(const AssDialogue *line) const { return find(line) != end(); }
+
+	void insert(AssDialogue *line) { lines.push_back(line); }
+	template<typename Iterator>
+	void insert(Iterator first, Iterator last) { lines.insert(lines.end(), first, last); }
+	size_t erase(const AssDialogue *line);
+	void clear() { lines.clear(); sorted = 0; }
+	void reserve(size_t n) { lines.reserve(n); }
+
+	bool operator==(Selection const& other) const;
+	bool operator!=(Selection const& other) const { return !(*this == other); }
+
+	/// Lines in either this set or other
+	Selection Union(Selection const& other) const;
+	/// Lines in both this set and other
+	Selection Intersection(Selection const& other) const;
+	/// Lines in this set but not in other
+	Selection Difference(Selection const& other) const;
+};
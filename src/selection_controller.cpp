@@ -25,9 +25,15 @@
 
 SelectionController::SelectionController(agi::Context *c) : context(c) { }
 
-void SelectionController::SetSelectedSet(Selection new_selection) {
+void SelectionController::ChangeSelection(Selection new_selection) {
+	auto added = new_selection.Difference(selection);
+	auto removed = selection.Difference(new_selection);
 	selection = std::move(new_selection);
-	AnnounceSelectedSetChanged();
+	AnnounceSelectedSetChanged(added, removed);
+}
+
+void SelectionController::SetSelectedSet(Selection new_selection) {
+	ChangeSelection(std::move(new_selection));
 }
 
 void SelectionController::SetActiveLine(AssDialogue *new_line) {
@@ -41,12 +47,11 @@ void SelectionController::SetActiveLine(AssDialogue *new_line) {
 
 void SelectionController::SetSelectionAndActive(Selection new_selection, AssDialogue *new_line) {
 	bool active_line_changed = new_line != active_line;
-	selection = std::move(new_selection);
 	active_line = new_line;
 	if (active_line)
 		context->ass->Properties.active_row = active_line->Row;
 
-	AnnounceSelectedSetChanged();
+	ChangeSelection(std::move(new_selection));
 	if (active_line_changed)
 		AnnounceActiveLineChanged(new_line);
 }
@@ -27,25 +27,27 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include "selection.h"
+
 #include <libaegisub/signal.h>
 
-#include <set>
 #include <vector>
 
-class AssDialogue;
-typedef std::set<AssDialogue *> Selection;
-
 namespace agi { struct Context; }
 
 class SelectionController {
 	agi::signal::Signal<AssDialogue *> AnnounceActiveLineChanged;
-	agi::signal::Signal<> AnnounceSelectedSetChanged;
+	/// Lines added to and removed from the selected set
+	agi::signal::Signal<Selection const&, Selection const&> AnnounceSelectedSetChanged;
 
 	agi::Context *context;
 
 	Selection selection; ///< Currently selected lines
 	AssDialogue *active_line = nullptr; ///< The currently active line or 0 if none
 
+	/// Replace the selected set and announce what changed
+	void ChangeSelection(Selection new_selection);
+
 public:
 	SelectionController(agi::Context *context);
 
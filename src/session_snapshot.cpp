@@ -0,0 +1,444 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file session_snapshot.cpp
+/// @brief Binary copies of parsed subtitle files
+/// @ingroup subs_storage
+
+#include "session_snapshot.h"
+
+#include "ass_attachment.h"
+#include "ass_dialogue.h"
+#include "ass_file.h"
+#include "ass_info.h"
+#include "ass_style.h"
+
+#include <libaegisub/exception.h>
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/format.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/io.h>
+#include <libaegisub/log.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+DEFINE_EXCEPTION(CorruptSnapshot, agi::InvalidInputException);
+
+const char magic[8] = {'A', 'G', 'I', 'S', 'N', 'A', 'P', '\0'};
+/// Incremented whenever the layout changes, which makes old snapshots invalid
+const uint32_t format_version = 1;
+/// Written in native byte order, so that snapshots from a machine with the
+/// other byte order are rejected
+const uint32_t byte_order = 0x01020304;
+
+class Writer {
+	std::string buffer;
+
+public:
+	template<typename T>
+	void Pod(T value) {
+		buffer.append(reinterpret_cast<const char *>(&value), sizeof value);
+	}
+
+	void String(std::string const& str) {
+		Pod<uint32_t>(str.size());
+		buffer += str;
+	}
+
+	std::string const& Data() const { return buffer; }
+};
+
+class Reader {
+	const char *pos;
+	const char *end;
+
+	void Need(size_t bytes) {
+		if (size_t(end - pos) < bytes)
+			throw CorruptSnapshot("Snapshot is truncated");
+	}
+
+public:
+	Reader(const char *data, size_t size) : pos(data), end(data + size) { }
+
+	template<typename T>
+	T Pod() {
+		Need(sizeof(T));
+		T value;
+		memcpy(&value, pos, sizeof value);
+		pos += sizeof value;
+		return value;
+	}
+
+	std::string String() {
+		auto size = Pod<uint32_t>();
+		Need(size);
+		std::string str(pos, size);
+		pos += size;
+		return str;
+	}
+
+	/// Read a count of items, each of which takes at least min_size bytes
+	size_t Count(size_t min_size) {
+		auto count = Pod<uint32_t>();
+		Need(count * min_size);
+		return count;
+	}
+
+	bool Done() const { return pos == end; }
+};
+
+/// FNV-1a, for a file name which is the same from one run to the next
+uint64_t hash(std::string const& str) {
+	uint64_t h = 14695981039346656037ull;
+	for (unsigned char c : str) {
+		h ^= c;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+void WriteHeader(Writer& out, session_snapshot::SourceStamp const& stamp) {
+	for (char c : magic)
+		out.Pod(c);
+	out.Pod(format_version);
+	out.Pod(byte_order);
+	out.Pod(stamp.size);
+	out.Pod(stamp.mtime);
+}
+
+/// Check that a snapshot is one this version can read, and get the stamp of
+/// the file it was taken from
+session_snapshot::SourceStamp ReadHeader(Reader& in) {
+	for (char c : magic) {
+		if (in.Pod<char>() != c)
+			throw CorruptSnapshot("Not a snapshot");
+	}
+	if (in.Pod<uint32_t>() != format_version || in.Pod<uint32_t>() != byte_order)
+		throw CorruptSnapshot("Snapshot is from a different version");
+
+	session_snapshot::SourceStamp stamp;
+	stamp.size = in.Pod<uint64_t>();
+	stamp.mtime = in.Pod<int64_t>();
+	return stamp;
+}
+
+bool operator==(session_snapshot::SourceStamp const& a, session_snapshot::SourceStamp const& b) {
+	return a.size == b.size && a.mtime == b.mtime;
+}
+
+void WriteColor(Writer& out, agi::Color color) {
+	out.Pod(color.r);
+	out.Pod(color.g);
+	out.Pod(color.b);
+	out.Pod(color.a);
+}
+
+agi::Color ReadColor(Reader& in) {
+	agi::Color color;
+	color.r = in.Pod<unsigned char>();
+	color.g = in.Pod<unsigned char>();
+	color.b = in.Pod<unsigned char>();
+	color.a = in.Pod<unsigned char>();
+	return color;
+}
+
+void WriteStyle(Writer& out, AssStyle const& style) {
+	out.String(style.name);
+	out.String(style.font);
+	out.Pod(style.fontsize);
+	WriteColor(out, style.primary);
+	WriteColor(out, style.secondary);
+	WriteColor(out, style.outline);
+	WriteColor(out, style.shadow);
+	out.Pod<uint8_t>(style.bold | style.italic << 1 | style.underline << 2 | style.strikeout << 3);
+	out.Pod(style.scalex);
+	out.Pod(style.scaley);
+	out.Pod(style.spacing);
+	out.Pod(style.angle);
+	out.Pod<int32_t>(style.borderstyle);
+	out.Pod(style.outline_w);
+	out.Pod(style.shadow_w);
+	out.Pod<int32_t>(style.alignment);
+	for (int margin : style.Margin)
+		out.Pod<int32_t>(margin);
+	out.Pod<int32_t>(style.encoding);
+}
+
+AssStyle *ReadStyle(Reader& in) {
+	auto style = new AssStyle;
+	style->name = in.String();
+	style->font = in.String();
+	style->fontsize = in.Pod<double>();
+	style->primary = ReadColor(in);
+	style->secondary = ReadColor(in);
+	style->outline = ReadColor(in);
+	style->shadow = ReadColor(in);
+	auto flags = in.Pod<uint8_t>();
+	style->bold = !!(flags & 1);
+	style->italic = !!(flags & 2);
+	style->underline = !!(flags & 4);
+	style->strikeout = !!(flags & 8);
+	style->scalex = in.Pod<double>();
+	style->scaley = in.Pod<double>();
+	style->spacing = in.Pod<double>();
+	style->angle = in.Pod<double>();
+	style->borderstyle = in.Pod<int32_t>();
+	style->outline_w = in.Pod<double>();
+	style->shadow_w = in.Pod<double>();
+	style->alignment = in.Pod<int32_t>();
+	for (int& margin : style->Margin)
+		margin = in.Pod<int32_t>();
+	style->encoding = in.Pod<int32_t>();
+	style->UpdateData();
+	return style;
+}
+
+void WriteProperties(Writer& out, ProjectProperties const& props) {
+	out.String(props.automation_scripts);
+	out.String(props.export_filters);
+	out.String(props.export_encoding);
+	out.String(props.style_storage);
+	out.String(props.audio_file);
+	out.String(props.video_file);
+	out.String(props.timecodes_file);
+	out.String(props.keyframes_file);
+	out.Pod<uint32_t>(props.automation_settings.size());
+	for (auto const& setting : props.automation_settings) {
+		out.String(setting.first);
+		out.String(setting.second);
+	}
+	out.Pod(props.video_zoom);
+	out.Pod(props.ar_value);
+	out.Pod<int32_t>(props.scroll_position);
+	out.Pod<int32_t>(props.active_row);
+	out.Pod<int32_t>(props.ar_mode);
+	out.Pod<int32_t>(props.video_position);
+}
+
+void ReadProperties(Reader& in, ProjectProperties& props) {
+	props.automation_scripts = in.String();
+	props.export_filters = in.String();
+	props.export_encoding = in.String();
+	props.style_storage = in.String();
+	props.audio_file = in.String();
+	props.video_file = in.String();
+	props.timecodes_file = in.String();
+	props.keyframes_file = in.String();
+	for (size_t count = in.Count(8); count; --count) {
+		auto key = in.String();
+		props.automation_settings[key] = in.String();
+	}
+	props.video_zoom = in.Pod<double>();
+	props.ar_value = in.Pod<double>();
+	props.scroll_position = in.Pod<int32_t>();
+	props.active_row = in.Pod<int32_t>();
+	props.ar_mode = in.Pod<int32_t>();
+	props.video_position = in.Pod<int32_t>();
+}
+
+/// Read everything after the header into file
+void ReadBody(Reader& in, AssFile& file) {
+	for (size_t count = in.Count(8); count; --count) {
+		auto key = in.String();
+		file.Info.emplace_back(key, in.String());
+	}
+
+	for (size_t count = in.Count(8); count; --count)
+		file.Styles.push_back(*ReadStyle(in));
+
+	// Style, actor and effect names repeat a lot, so each line refers to
+	// them by index, and each only has to be made into a flyweight once
+	std::vector<agi::StringFlyweight> pool;
+	for (size_t count = in.Count(4); count; --count)
+		pool.emplace_back(in.String());
+	auto pooled = [&] {
+		auto index = in.Pod<uint32_t>();
+		if (index >= pool.size())
+			throw CorruptSnapshot("Bad string index");
+		return pool[index];
+	};
+
+	for (size_t count = in.Count(36); count; --count) {
+		auto diag = new AssDialogue;
+		file.Events.push_back(*diag);
+		diag->Comment = !!in.Pod<uint8_t>();
+		diag->Layer = in.Pod<int32_t>();
+		diag->Start = in.Pod<int32_t>();
+		diag->End = in.Pod<int32_t>();
+		for (int& margin : diag->Margin)
+			margin = in.Pod<int32_t>();
+		diag->Style = pooled();
+		diag->Actor = pooled();
+		diag->Effect = pooled();
+		if (size_t ids = in.Count(4)) {
+			std::vector<uint32_t> extradata(ids);
+			for (auto& id : extradata)
+				id = in.Pod<uint32_t>();
+			diag->ExtradataIds = extradata;
+		}
+		diag->Text = in.String();
+	}
+
+	for (size_t count = in.Count(9); count; --count) {
+		auto group = static_cast<AssEntryGroup>(in.Pod<uint8_t>());
+		if (group != AssEntryGroup::FONT && group != AssEntryGroup::GRAPHIC)
+			throw CorruptSnapshot("Bad attachment group");
+
+		// The encoded data is the header line followed by the data lines,
+		// each ending in CRLF
+		auto data = in.String();
+		auto header_end = data.find("\r\n");
+		if (header_end == std::string::npos || header_end < 10 || data.size() < header_end + 4)
+			throw CorruptSnapshot("Bad attachment");
+		file.Attachments.emplace_back(data.substr(0, header_end), group);
+		file.Attachments.back().AddData(data.substr(header_end + 2, data.size() - header_end - 4));
+	}
+
+	for (size_t count = in.Count(12); count; --count) {
+		ExtradataEntry entry;
+		entry.id = in.Pod<uint32_t>();
+		entry.key = in.String();
+		entry.value = in.String();
+		file.Extradata.push_back(std::move(entry));
+	}
+	file.next_extradata_id = in.Pod<uint32_t>();
+
+	ReadProperties(in, file.Properties);
+
+	if (!in.Done())
+		throw CorruptSnapshot("Snapshot has trailing data");
+}
+}
+
+namespace session_snapshot {
+SourceStamp Stamp(agi::fs::path const& source) {
+	SourceStamp stamp;
+	stamp.size = agi::fs::Size(source);
+	stamp.mtime = agi::fs::ModifiedTime(source);
+	return stamp;
+}
+
+agi::fs::path PathFor(agi::fs::path const& directory, agi::fs::path const& source) {
+	auto absolute = boost::filesystem::absolute(source);
+	return directory/agi::format("%s.%016x.snapshot", source.filename().string(), hash(absolute.string()));
+}
+
+void Write(agi::fs::path const& path, SourceStamp const& stamp, AssFile const& file) {
+	Writer out;
+	WriteHeader(out, stamp);
+
+	out.Pod<uint32_t>(file.Info.size());
+	for (auto const& info : file.Info) {
+		out.String(info.Key());
+		out.String(info.Value());
+	}
+
+	out.Pod<uint32_t>(file.Styles.size());
+	for (auto const& style : file.Styles)
+		WriteStyle(out, style);
+
+	std::vector<std::string const*> pool;
+	std::unordered_map<std::string, uint32_t> pool_index;
+	auto intern = [&](agi::StringFlyweight const& str) {
+		auto it = pool_index.emplace(str.get(), pool.size());
+		if (it.second)
+			pool.push_back(&it.first->first);
+		return it.first->second;
+	};
+	for (auto const& line : file.Events) {
+		intern(line.Style);
+		intern(line.Actor);
+		intern(line.Effect);
+	}
+	out.Pod<uint32_t>(pool.size());
+	for (auto str : pool)
+		out.String(*str);
+
+	out.Pod<uint32_t>(file.Events.size());
+	for (auto const& line : file.Events) {
+		out.Pod<uint8_t>(line.Comment);
+		out.Pod<int32_t>(line.Layer);
+		out.Pod<int32_t>(line.Start);
+		out.Pod<int32_t>(line.End);
+		for (int margin : line.Margin)
+			out.Pod<int32_t>(margin);
+		out.Pod(pool_index[line.Style]);
+		out.Pod(pool_index[line.Actor]);
+		out.Pod(pool_index[line.Effect]);
+		auto const& ids = line.ExtradataIds.get();
+		out.Pod<uint32_t>(ids.size());
+		for (auto id : ids)
+			out.Pod(id);
+		out.String(line.Text);
+	}
+
+	out.Pod<uint32_t>(file.Attachments.size());
+	for (auto const& attachment : file.Attachments) {
+		out.Pod<uint8_t>(static_cast<uint8_t>(attachment.Group()));
+		out.String(attachment.GetEntryData());
+	}
+
+	out.Pod<uint32_t>(file.Extradata.size());
+	for (auto const& entry : file.Extradata) {
+		out.Pod(entry.id);
+		out.String(entry.key);
+		out.String(entry.value);
+	}
+	out.Pod(file.next_extradata_id);
+
+	WriteProperties(out, file.Properties);
+
+	agi::fs::CreateDirectory(path.parent_path());
+	auto const& data = out.Data();
+	agi::io::Save(path, true).Get().write(data.data(), data.size());
+}
+
+bool IsValid(agi::fs::path const& path, agi::fs::path const& source) {
+	try {
+		agi::read_file_mapping file(path);
+		auto header_size = sizeof magic + 2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+		if (file.size() < header_size)
+			return false;
+		Reader in(file.read(0, header_size), header_size);
+		return ReadHeader(in) == Stamp(source);
+	}
+	catch (agi::Exception const&) {
+		return false;
+	}
+}
+
+bool Read(agi::fs::path const& path, agi::fs::path const& source, AssFile& file) {
+	try {
+		agi::read_file_mapping mapping(path);
+		Reader in(mapping.read(), mapping.size());
+		if (!(ReadHeader(in) == Stamp(source)))
+			return false;
+
+		AssFile loaded;
+		ReadBody(in, loaded);
+		file.swap(loaded);
+		return true;
+	}
+	catch (agi::Exception const& e) {
+		LOG_W("session_snapshot") << "Not using snapshot " << path << ": " << e.GetMessage();
+		return false;
+	}
+}
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file session_snapshot.h
+/// @see session_snapshot.cpp
+/// @ingroup subs_storage
+
+#pragma once
+
+#include <libaegisub/fs_fwd.h>
+
+#include <cstdint>
+
+class AssFile;
+
+/// @brief Binary copies of parsed subtitle files for reopening them quickly
+///
+/// A snapshot holds everything which loading an ASS file produces, including
+/// the project properties, and is only used while the file it was taken from
+/// has the same size and modification time as it did then.
+namespace session_snapshot {
+	/// Size and modification time of a subtitles file
+	struct SourceStamp {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+	};
+
+	/// Get the size and modification time of a file
+	SourceStamp Stamp(agi::fs::path const& source);
+
+	/// Get the path of the snapshot of a subtitles file
+	/// @param directory Directory snapshots are kept in
+	/// @param source Subtitles file
+	agi::fs::path PathFor(agi::fs::path const& directory, agi::fs::path const& source);
+
+	/// Write a snapshot
+	/// @param path Snapshot file to write
+	/// @param stamp Stamp of the subtitles file when file was loaded from or
+	///              saved to it
+	/// @param file Parsed subtitles, including their project properties
+	void Write(agi::fs::path const& path, SourceStamp const& stamp, AssFile const& file);
+
+	/// Is there a snapshot at path which is still valid for source?
+	bool IsValid(agi::fs::path const& path, agi::fs::path const& source);
+
+	/// Load a snapshot if it is still valid for source
+	/// @param[out] file File to replace the contents of
+	/// @return Was a valid snapshot loaded? file is untouched if not.
+	bool Read(agi::fs::path const& path, agi::fs::path const& source, AssFile& file);
+}
@@ -19,6 +19,8 @@
 #include "options.h"
 
 #include <libaegisub/charset_conv.h>
+#include <libaegisub/dir_listing.h>
+#include <libaegisub/dispatch.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/io.h>
@@ -28,22 +30,55 @@
 #include <libaegisub/make_unique.h>
 
 #include <boost/range/algorithm.hpp>
+#include <unordered_set>
 
 #define HUNSPELL_STATIC
 #undef near
 #include <hunspell/hunspell.hxx>
 
+namespace {
+/// Number of check results to remember per dictionary
+const size_t max_cached_words = 50000;
+
+/// Load words from a custom dictionary
+std::set<std::string> read_user_dictionary(agi::fs::path const& path) {
+	std::set<std::string> words;
+	try {
+		auto stream = agi::io::Open(path);
+		copy_if(
+			++agi::line_iterator<std::string>(*stream), agi::line_iterator<std::string>(),
+			inserter(words, words.end()),
+			[](std::string const& str) { return !str.empty(); });
+	}
+	catch (agi::fs::FileNotFound const&) {
+		// Not an error; user dictionary just doesn't exist
+	}
+	return words;
+}
+}
+
 HunspellSpellChecker::HunspellSpellChecker()
-: lang_listener(OPT_SUB("Tool/Spell Checker/Language", &HunspellSpellChecker::OnLanguageChanged, this))
+: check_queue(agi::dispatch::Create())
+, lang_listener(OPT_SUB("Tool/Spell Checker/Language", &HunspellSpellChecker::OnLanguageChanged, this))
 , dict_path_listener(OPT_SUB("Path/Dictionary", &HunspellSpellChecker::OnPathChanged, this))
 {
 	OnLanguageChanged();
 }
 
 HunspellSpellChecker::~HunspellSpellChecker() {
+	// Queued checks bail out once this is cleared, so this doesn't have to
+	// wait for an entire file's worth of words
+	*alive = false;
+	check_queue->Sync([]{});
+}
+
+void HunspellSpellChecker::WaitForLoad(std::unique_lock<std::mutex>& guard) {
+	loaded.wait(guard, [&] { return pending_loads == 0; });
 }
 
 bool HunspellSpellChecker::CanAddWord(std::string const& word) {
+	std::unique_lock<std::mutex> guard(lock);
+	WaitForLoad(guard);
 	if (!hunspell) return false;
 	try {
 		conv->Convert(word);
@@ -55,59 +90,60 @@ bool HunspellSpellChecker::CanAddWord(std::string const& word) {
 }
 
 bool HunspellSpellChecker::CanRemoveWord(std::string const& word) {
+	std::unique_lock<std::mutex> guard(lock);
+	WaitForLoad(guard);
 	return !!customWords.count(word);
 }
 
 void HunspellSpellChecker::AddWord(std::string const& word) {
-	if (!hunspell) return;
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		WaitForLoad(guard);
+		if (!hunspell) return;
+
+		// Add it to the in-memory dictionary
+		hunspell->add(conv->Convert(word).c_str());
+		ClearCache();
 
-	// Add it to the in-memory dictionary
-	hunspell->add(conv->Convert(word).c_str());
+		if (!customWords.insert(word).second) return;
+	}
 
-	// Add the word
-	if (customWords.insert(word).second)
-		WriteUserDictionary();
+	WriteUserDictionary();
 }
 
 void HunspellSpellChecker::RemoveWord(std::string const& word) {
-	if (!hunspell) return;
-
-	// Remove it from the in-memory dictionary
-	hunspell->remove(conv->Convert(word).c_str());
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		WaitForLoad(guard);
+		if (!hunspell) return;
 
-	auto word_iter = customWords.find(word);
-	if (word_iter != customWords.end()) {
-		customWords.erase(word_iter);
+		// Remove it from the in-memory dictionary
+		hunspell->remove(conv->Convert(word).c_str());
+		ClearCache();
 
-		WriteUserDictionary();
+		if (!customWords.erase(word)) return;
 	}
-}
 
-void HunspellSpellChecker::ReadUserDictionary() {
-	customWords.clear();
-
-	// Read the old contents of the user's dictionary
-	try {
-		auto stream = agi::io::Open(userDicPath);
-		copy_if(
-			++agi::line_iterator<std::string>(*stream), agi::line_iterator<std::string>(),
-			inserter(customWords, customWords.end()),
-			[](std::string const& str) { return !str.empty(); });
-	}
-	catch (agi::fs::FileNotFound const&) {
-		// Not an error; user dictionary just doesn't exist
-	}
+	WriteUserDictionary();
 }
 
 void HunspellSpellChecker::WriteUserDictionary() {
+	agi::fs::path path;
+	std::set<std::string> words;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		path = userDicPath;
+		words = customWords;
+	}
+
 	// Ensure that the path exists
-	agi::fs::CreateDirectory(userDicPath.parent_path());
+	agi::fs::CreateDirectory(path.parent_path());
 
 	// Write the new dictionary
 	{
-		agi::io::Save writer(userDicPath);
-		writer.Get() << customWords.size() << "\n";
-		copy(customWords.begin(), customWords.end(), std::ostream_iterator<std::string>(writer.Get(), "\n"));
+		agi::io::Save writer(path);
+		writer.Get() << words.size() << "\n";
+		copy(words.begin(), words.end(), std::ostream_iterator<std::string>(writer.Get(), "\n"));
 	}
 
 	// Announce a language change so that any other spellcheckers reload the
@@ -117,18 +153,90 @@ void HunspellSpellChecker::WriteUserDictionary() {
 	lang_listener.Unblock();
 }
 
-bool HunspellSpellChecker::CheckWord(std::string const& word) {
-	if (!hunspell) return true;
+bool HunspellSpellChecker::FindCached(std::string const& word, bool& valid) {
+	auto it = cache_index.find(word);
+	if (it == cache_index.end()) return false;
+
+	cache.splice(cache.begin(), cache, it->second);
+	valid = it->second->second;
+	return true;
+}
+
+bool HunspellSpellChecker::CheckUncached(std::string const& word) {
+	bool valid;
 	try {
-		return hunspell->spell(conv->Convert(word).c_str()) == 1;
+		valid = hunspell->spell(conv->Convert(word).c_str()) == 1;
 	}
 	catch (agi::charset::ConvError const&) {
-		return false;
+		valid = false;
+	}
+
+	cache.emplace_front(word, valid);
+	cache_index[word] = cache.begin();
+	if (cache.size() > max_cached_words) {
+		cache_index.erase(cache.back().first);
+		cache.pop_back();
+	}
+	return valid;
+}
+
+void HunspellSpellChecker::ClearCache() {
+	cache.clear();
+	cache_index.clear();
+}
+
+bool HunspellSpellChecker::CheckWord(std::string const& word) {
+	std::unique_lock<std::mutex> guard(lock);
+	WaitForLoad(guard);
+	if (!hunspell) return true;
+
+	bool valid;
+	if (FindCached(word, valid)) return valid;
+	return CheckUncached(word);
+}
+
+bool HunspellSpellChecker::TryCheckWord(std::string const& word, bool& valid) {
+	std::lock_guard<std::mutex> guard(lock);
+	// Words checked while the dictionary is loading are queued behind it
+	if (pending_loads) return false;
+	if (!hunspell) {
+		valid = true;
+		return true;
 	}
+	return FindCached(word, valid);
+}
+
+void HunspellSpellChecker::CheckWordsAsync(std::vector<std::string> words, std::function<void()> on_done) {
+	// Drop duplicates while keeping the order, as callers put the words they
+	// want soonest first
+	std::unordered_set<std::string> seen;
+	words.erase(remove_if(begin(words), end(words),
+		[&](std::string const& word) { return !seen.insert(word).second; }),
+		end(words));
+
+	auto alive = this->alive;
+	check_queue->Async([=] {
+		for (auto const& word : words) {
+			if (!*alive) return;
+
+			// Lock per word so that checks from the main thread only ever
+			// have to wait for a single word
+			std::lock_guard<std::mutex> guard(lock);
+			bool valid;
+			if (hunspell && !FindCached(word, valid))
+				CheckUncached(word);
+		}
+
+		if (on_done) agi::dispatch::Main().Async([=] {
+			if (*alive) on_done();
+		});
+	});
 }
 
 std::vector<std::string> HunspellSpellChecker::GetSuggestions(std::string const& word) {
 	std::vector<std::string> suggestions;
+	std::unique_lock<std::mutex> guard(lock);
+	WaitForLoad(guard);
 	if (!hunspell) return suggestions;
 
 	char **results;
@@ -156,8 +264,9 @@ static std::vector<std::string> langs(const char *filter) {
 	auto data_path = config::path->Decode("?dictionary/");
 	auto user_path = config::path->Decode(OPT_GET("Path/Dictionary")->GetString());
 
-	agi::fs::DirectoryIterator(data_path, filter).GetAll(paths);
-	agi::fs::DirectoryIterator(user_path, filter).GetAll(paths);
+	paths = agi::fs::ListDirectory(data_path, filter);
+	auto user_paths = agi::fs::ListDirectory(user_path, filter);
+	paths.insert(paths.end(), user_paths.begin(), user_paths.end());
 
 	// Drop extensions
 	for (auto& fn : paths) fn.resize(fn.size() - 4);
@@ -181,44 +290,76 @@ static bool check_path(agi::fs::path const& path, std::string const& language, a
 }
 
 void HunspellSpellChecker::OnLanguageChanged() {
-	hunspell.reset();
-
 	auto language = OPT_GET("Tool/Spell Checker/Language")->GetString();
-	if (language.empty()) return;
-
-	agi::fs::path aff, dic;
-	auto path = config::path->Decode(OPT_GET("Path/Dictionary")->GetString() + "/");
-	if (!check_path(path, language, aff, dic)) {
-		path = config::path->Decode("?dictionary/");
-		if (!check_path(path, language, aff, dic))
-			return;
-	}
 
-	LOG_I("dictionary/file") << dic;
+	agi::fs::path aff, dic, user_dic;
+	bool found = false;
+	if (!language.empty()) {
+		auto path = config::path->Decode(OPT_GET("Path/Dictionary")->GetString() + "/");
+		found = check_path(path, language, aff, dic)
+			|| check_path(config::path->Decode("?dictionary/"), language, aff, dic);
+		user_dic = config::path->Decode("?user/dictionaries")/agi::format("user_%s.dic", language);
+	}
 
+	std::lock_guard<std::mutex> guard(lock);
+	hunspell.reset();
+	customWords.clear();
+	ClearCache();
+	userDicPath = user_dic;
+	int generation = ++dictionary_generation;
+	if (!found) return;
+
+	// Loading a dictionary takes long enough to hold up startup noticeably,
+	// so it's done on the check queue, and anything which needs an answer
+	// before it's done waits for it
+	++pending_loads;
+	auto alive = this->alive;
+	check_queue->Async([=] {
+		if (!*alive) return;
+
+		LOG_I("dictionary/file") << dic;
+
+		std::unique_ptr<Hunspell> new_hunspell;
+		std::unique_ptr<agi::charset::IconvWrapper> new_conv, new_rconv;
+		std::set<std::string> words;
+		try {
 #ifdef _WIN32
-	// The prefix makes hunspell assume the paths are UTF-8 and use _wfopen
-	hunspell = agi::make_unique<Hunspell>(("\\\\?\\" + aff.string()).c_str(), ("\\\\?\\" + dic.string()).c_str());
+			// The prefix makes hunspell assume the paths are UTF-8 and use _wfopen
+			new_hunspell = agi::make_unique<Hunspell>(("\\\\?\\" + aff.string()).c_str(), ("\\\\?\\" + dic.string()).c_str());
 #else
-	hunspell = agi::make_unique<Hunspell>(aff.string().c_str(), dic.string().c_str());
+			new_hunspell = agi::make_unique<Hunspell>(aff.string().c_str(), dic.string().c_str());
 #endif
-	if (!hunspell) return;
-
-	conv = agi::make_unique<agi::charset::IconvWrapper>("utf-8", hunspell->get_dic_encoding());
-	rconv = agi::make_unique<agi::charset::IconvWrapper>(hunspell->get_dic_encoding(), "utf-8");
-
-	userDicPath = config::path->Decode("?user/dictionaries")/agi::format("user_%s.dic", language);
-	ReadUserDictionary();
-
-	for (auto const& word : customWords) {
-		try {
-			hunspell->add(conv->Convert(word).c_str());
+			new_conv = agi::make_unique<agi::charset::IconvWrapper>("utf-8", new_hunspell->get_dic_encoding());
+			new_rconv = agi::make_unique<agi::charset::IconvWrapper>(new_hunspell->get_dic_encoding(), "utf-8");
+
+			words = read_user_dictionary(user_dic);
+			for (auto const& word : words) {
+				try {
+					new_hunspell->add(new_conv->Convert(word).c_str());
+				}
+				catch (agi::charset::ConvError const&) {
+					// Normally this shouldn't happen, but some versions of Aegisub
+					// wrote words in the wrong charset
+				}
+			}
 		}
-		catch (agi::charset::ConvError const&) {
-			// Normally this shouldn't happen, but some versions of Aegisub
-			// wrote words in the wrong charset
+		catch (agi::Exception const& e) {
+			LOG_E("dictionary/file") << e.GetMessage();
+			new_hunspell.reset();
+			words.clear();
 		}
-	}
+
+		std::lock_guard<std::mutex> guard(lock);
+		if (generation == dictionary_generation) {
+			hunspell = std::move(new_hunspell);
+			conv = std::move(new_conv);
+			rconv = std::move(new_rconv);
+			customWords = std::move(words);
+			ClearCache();
+		}
+		--pending_loads;
+		loaded.notify_all();
+	});
 }
 
 void HunspellSpellChecker::OnPathChanged() {
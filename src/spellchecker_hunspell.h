@@ -25,11 +25,19 @@
 #include <libaegisub/fs_fwd.h>
 #include <libaegisub/signal.h>
 
+#include <atomic>
 #include <boost/filesystem/path.hpp>
+#include <condition_variable>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 
-namespace agi { namespace charset { class IconvWrapper; } }
+namespace agi {
+	namespace charset { class IconvWrapper; }
+	namespace dispatch { class Queue; }
+}
 class Hunspell;
 
 /// @brief Hunspell-based spell checker implementation
@@ -50,6 +58,44 @@ class HunspellSpellChecker final : public agi::SpellChecker {
 	/// Words in the custom user dictionary
 	std::set<std::string> customWords;
 
+	/// Previously checked words, most recently used first
+	std::list<std::pair<std::string, bool>> cache;
+	/// Index into cache by word
+	std::unordered_map<std::string, decltype(cache)::iterator> cache_index;
+
+	/// Protects hunspell, conv, the custom words and the cache from the
+	/// background checker and loader
+	std::mutex lock;
+
+	/// Dictionaries queued to be loaded but not yet installed
+	int pending_loads = 0;
+	/// Incremented on each language change, so that a dictionary which
+	/// finishes loading after the language changed again is discarded
+	int dictionary_generation = 0;
+	/// Signalled each time a queued dictionary is installed
+	std::condition_variable loaded;
+
+	/// Wait for any queued dictionary loads to finish
+	/// Must be called with lock held
+	void WaitForLoad(std::unique_lock<std::mutex>& guard);
+
+	/// Queue which words typed or prefetched are checked on
+	std::unique_ptr<agi::dispatch::Queue> check_queue;
+
+	/// Expires when this is destroyed so that pending completion callbacks
+	/// know not to run
+	std::shared_ptr<std::atomic<bool>> alive = std::make_shared<std::atomic<bool>>(true);
+
+	/// Look up a word in the cache, marking it as recently used
+	/// Must be called with lock held
+	bool FindCached(std::string const& word, bool& valid);
+	/// Check a word with hunspell and cache the result
+	/// Must be called with lock held
+	bool CheckUncached(std::string const& word);
+	/// Forget all cached results
+	/// Must be called with lock held
+	void ClearCache();
+
 	/// Dictionary language change connection
 	agi::signal::Connection lang_listener;
 	/// Dictionary language change handler
@@ -60,8 +106,6 @@ class HunspellSpellChecker final : public agi::SpellChecker {
 	/// Dictionary path change handler
 	void OnPathChanged();
 
-	/// Load words from custom dictionary
-	void ReadUserDictionary();
 	/// Save words to custom dictionary
 	void WriteUserDictionary();
 
@@ -74,6 +118,8 @@ public:
 	bool CanAddWord(std::string const& word) override;
 	bool CanRemoveWord(std::string const& word) override;
 	bool CheckWord(std::string const& word) override;
+	bool TryCheckWord(std::string const& word, bool& valid) override;
+	void CheckWordsAsync(std::vector<std::string> words, std::function<void()> on_done) override;
 	std::vector<std::string> GetSuggestions(std::string const& word) override;
 	std::vector<std::string> GetLanguageList() override;
 };
@@ -36,9 +36,10 @@
 
 #include "visual_tool.h"
 
-#include <libaegisub/split.h>
-#include <libaegisub/util.h>
+#include <libaegisub/ass/dialogue_parser.h>
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 
 Spline::Spline(const VisualToolBase &tl)
@@ -59,98 +60,163 @@ void Spline::SetScale(int new_scale) {
 	scale = 1 << (raw_scale - 1);
 }
 
-std::string Spline::EncodeToAss() const {
-	std::string result;
-	result.reserve(size() * 10);
-	char last = 0;
+namespace {
+void append_int(std::string &str, int value) {
+	char buf[16];
+	char *end = buf + sizeof buf, *pos = end;
+	unsigned int n = value < 0 ? 0u - unsigned(value) : unsigned(value);
+	do {
+		*--pos = char('0' + n % 10);
+		n /= 10;
+	} while (n);
+	if (value < 0)
+		*--pos = '-';
+	str.append(pos, end);
+}
 
-	for (auto const& pt : *this) {
-		switch (pt.type) {
-			case SplineCurve::POINT:
-				if (last != 'm') {
-					result += "m ";
-					last = 'm';
-				}
-				result += ToScript(pt.p1).DStr(' ');
-				break;
+/// Number of coordinates written for each type of curve
+int coord_count(SplineCurve::CurveType type) {
+	return type == SplineCurve::BICUBIC ? 6 : 2;
+}
 
-			case SplineCurve::LINE:
-				if (last != 'l') {
-					result += "l ";
-					last = 'l';
-				}
-				result += ToScript(pt.p2).DStr(' ');
-				break;
+/// Command letter for each type of curve
+char command_for(SplineCurve::CurveType type) {
+	switch (type) {
+		case SplineCurve::POINT: return 'm';
+		case SplineCurve::LINE: return 'l';
+		default: return 'b';
+	}
+}
+
+/// Append the text for a curve, including the command if it's a different
+/// type from the previous one
+void append_curve(std::string &str, int const *coords, SplineCurve::CurveType type, SplineCurve::CurveType const *prev) {
+	if (!prev || *prev != type) {
+		str += command_for(type);
+		str += ' ';
+	}
+	for (int i = 0; i < coord_count(type); ++i) {
+		append_int(str, coords[i]);
+		str += ' ';
+	}
+}
+}
 
+std::string Spline::EncodeToAss() const {
+	new_curves.clear();
+	new_curves.reserve(size());
+	for (auto const& pt : *this) {
+		EncodedCurve curve{pt.type, {0}, 0, 0};
+		auto add = [&](int i, Vector2D p) {
+			p = ToScript(p);
+			curve.coords[i] = (int)p.X();
+			curve.coords[i + 1] = (int)p.Y();
+		};
+		switch (pt.type) {
+			case SplineCurve::POINT: add(0, pt.p1); break;
+			case SplineCurve::LINE:  add(0, pt.p2); break;
 			case SplineCurve::BICUBIC:
-				if (last != 'b') {
-					result += "b ";
-					last = 'b';
-				}
-				result += ToScript(pt.p2).DStr(' ') + " ";
-				result += ToScript(pt.p3).DStr(' ') + " ";
-				result += ToScript(pt.p4).DStr(' ');
+				add(0, pt.p2);
+				add(2, pt.p3);
+				add(4, pt.p4);
 				break;
+			default: continue;
+		}
+		new_curves.push_back(curve);
+	}
 
-			default: break;
+	// Which command each curve needs depends on the curve before it, so if
+	// any types changed just re-encode everything
+	bool same_types = new_curves.size() == encoded_curves.size()
+		&& std::equal(new_curves.begin(), new_curves.end(), encoded_curves.begin(),
+			[](EncodedCurve const& a, EncodedCurve const& b) { return a.type == b.type; });
+
+	if (!same_types) {
+		encoded.clear();
+		encoded.reserve(new_curves.size() * 10);
+		for (size_t i = 0; i < new_curves.size(); ++i) {
+			auto& curve = new_curves[i];
+			curve.offset = encoded.size();
+			append_curve(encoded, curve.coords, curve.type, i ? &new_curves[i - 1].type : nullptr);
+			curve.length = encoded.size() - curve.offset;
 		}
-		result += " ";
+		encoded_curves.swap(new_curves);
+		return encoded;
 	}
-	return result;
+
+	// Rewrite just the curves whose coordinates changed
+	std::string segment;
+	ptrdiff_t shift = 0;
+	for (size_t i = 0; i < encoded_curves.size(); ++i) {
+		auto& old_curve = encoded_curves[i];
+		old_curve.offset += shift;
+		auto const& new_curve = new_curves[i];
+		if (std::equal(std::begin(new_curve.coords), std::end(new_curve.coords), std::begin(old_curve.coords)))
+			continue;
+
+		segment.clear();
+		append_curve(segment, new_curve.coords, new_curve.type, i ? &encoded_curves[i - 1].type : nullptr);
+		encoded.replace(old_curve.offset, old_curve.length, segment);
+		shift += ptrdiff_t(segment.size()) - ptrdiff_t(old_curve.length);
+		std::copy(std::begin(new_curve.coords), std::end(new_curve.coords), std::begin(old_curve.coords));
+		old_curve.length = segment.size();
+	}
+	return encoded;
 }
 
 void Spline::DecodeFromAss(std::string const& str) {
 	// Clear current
 	clear();
-	std::vector<float> stack;
+	double stack[6];
+	size_t stack_size = 0;
 
 	// Prepare
 	char command = 'm';
 	Vector2D pt{0, 0};
 
-	// Tokenize the string
-	for (auto token : agi::Split(str, ' ')) {
-		double n;
-		if (agi::util::try_parse(agi::str(token), &n)) {
-			stack.push_back(n);
+	const char *pos = str.data(), *end = str.data() + str.size();
+	agi::ass::DrawingToken token;
+	while (agi::ass::NextDrawingToken(pos, end, token)) {
+		if (token.command) {
+			command = token.command;
+			stack_size = 0;
+			continue;
+		}
+
+		if (stack_size < 6)
+			stack[stack_size++] = float(token.value);
 
-			// Move
-			if (stack.size() == 2 && command == 'm') {
-				pt = FromScript(Vector2D(stack[0], stack[1]));
-				stack.clear();
+		// Move
+		if (stack_size == 2 && command == 'm') {
+			pt = FromScript(Vector2D(stack[0], stack[1]));
+			stack_size = 0;
 
-				push_back(pt);
-			}
+			push_back(pt);
+		}
 
-			// Line
-			if (stack.size() == 2 && command == 'l') {
-				if (empty()) push_back(pt);
+		// Line
+		if (stack_size == 2 && command == 'l') {
+			if (empty()) push_back(pt);
 
-				SplineCurve curve(pt, FromScript(Vector2D(stack[0], stack[1])));
-				push_back(curve);
+			SplineCurve curve(pt, FromScript(Vector2D(stack[0], stack[1])));
+			push_back(curve);
 
-				pt = curve.p2;
-				stack.clear();
-			}
+			pt = curve.p2;
+			stack_size = 0;
+		}
 
-			// Bicubic
-			else if (stack.size() == 6 && command == 'b') {
-				if (empty()) push_back(pt);
+		// Bicubic
+		else if (stack_size == 6 && command == 'b') {
+			if (empty()) push_back(pt);
 
-				SplineCurve curve(pt,
-					FromScript(Vector2D(stack[0], stack[1])),
-					FromScript(Vector2D(stack[2], stack[3])),
-					FromScript(Vector2D(stack[4], stack[5])));
-				push_back(curve);
+			SplineCurve curve(pt,
+				FromScript(Vector2D(stack[0], stack[1])),
+				FromScript(Vector2D(stack[2], stack[3])),
+				FromScript(Vector2D(stack[4], stack[5])));
+			push_back(curve);
 
-				pt = curve.p4;
-				stack.clear();
-			}
-		}
-		// Got something else
-		else if (token.size() == 1) {
-			command = token[0];
-			stack.clear();
+			pt = curve.p4;
+			stack_size = 0;
 		}
 	}
 }
@@ -41,6 +41,22 @@ class Spline final : private std::vector<SplineCurve> {
 	int scale = 0;
 	int raw_scale = 0;
 
+	/// A curve as it was last encoded
+	struct EncodedCurve {
+		SplineCurve::CurveType type;
+		/// Script coordinates of the points written for the curve
+		int coords[6];
+		/// Position and length of the curve's text in encoded
+		size_t offset;
+		size_t length;
+	};
+	/// Result of the last EncodeToAss and the curves it was made from, so
+	/// that moving a point only has to rewrite the curves it changed
+	mutable std::vector<EncodedCurve> encoded_curves;
+	mutable std::string encoded;
+	/// Scratch space for EncodeToAss
+	mutable std::vector<EncodedCurve> new_curves;
+
 	/// Video coordinates -> Script coordinates
 	Vector2D ToScript(Vector2D vec) const;
 
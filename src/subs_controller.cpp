@@ -20,7 +20,10 @@
 #include "ass_dialogue.h"
 #include "ass_file.h"
 #include "ass_info.h"
+#include "ass_snapshot.h"
 #include "ass_style.h"
+#include "autosave_journal.h"
+#include "charset_detect.h"
 #include "compat.h"
 #include "command/command.h"
 #include "format.h"
@@ -29,13 +32,19 @@
 #include "options.h"
 #include "project.h"
 #include "selection_controller.h"
+#include "session_snapshot.h"
 #include "subtitle_format.h"
 #include "text_selection_controller.h"
 
 #include <libaegisub/dispatch.h>
+#include <libaegisub/file_mapping.h>
 #include <libaegisub/format_path.h>
 #include <libaegisub/fs.h>
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
+#include <libaegisub/perf.h>
+#include <libaegisub/trace.h>
 #include <libaegisub/util.h>
 
 #include <wx/msgdlg.h>
@@ -54,66 +63,45 @@ struct SubsController::UndoInfo {
 	wxString undo_description;
 	int commit_id;
 
-	std::vector<std::pair<std::string, std::string>> script_info;
-	std::vector<AssStyle> styles;
-	std::vector<AssDialogueBase> events;
-	std::vector<AssAttachment> attachments;
-	std::vector<ExtradataEntry> extradata;
+	/// Contents of the file, sharing unchanged lines with the previous entry
+	AssFileSnapshot snapshot;
+	/// Estimated bytes used by snapshot which aren't shared with the entry
+	/// before this one
+	size_t memory = 0;
 
 	mutable std::vector<int> selection;
 	int active_line_id = 0;
 	int pos = 0, sel_start = 0, sel_end = 0;
 
-	UndoInfo(const agi::Context *c, wxString const& d, int commit_id)
+	UndoInfo(const agi::Context *c, wxString const& d, int commit_id, AssFileSnapshot snapshot)
 	: undo_description(d)
 	, commit_id(commit_id)
-	, attachments(c->ass->Attachments)
-	, extradata(c->ass->Extradata)
+	, snapshot(std::move(snapshot))
 	{
-		script_info.reserve(c->ass->Info.size());
-		for (auto const& info : c->ass->Info)
-			script_info.emplace_back(info.Key(), info.Value());
-
-		styles.reserve(c->ass->Styles.size());
-		styles.assign(c->ass->Styles.begin(), c->ass->Styles.end());
-
-		events.reserve(c->ass->Events.size());
-		events.assign(c->ass->Events.begin(), c->ass->Events.end());
-
 		UpdateActiveLine(c);
 		UpdateSelection(c);
 		UpdateTextSelection(c);
 	}
 
 	void Apply(agi::Context *c) const {
-		// Keep old dialogue lines alive until after the commit is complete
-		// since a bunch of stuff holds references to them
+		// Keep old dialogue lines and styles alive until after the commit is
+		// complete since a bunch of stuff holds references to them
 		AssFile old;
 		old.Events.swap(c->ass->Events);
-		c->ass->Info.clear();
-		c->ass->Attachments.clear();
-		c->ass->Styles.clear();
-		c->ass->Extradata.clear();
+		old.Styles.swap(c->ass->Styles);
+		snapshot.Restore(*c->ass);
 
 		sort(begin(selection), end(selection));
 
 		AssDialogue *active_line = nullptr;
 		Selection new_sel;
 
-		for (auto const& info : script_info)
-			c->ass->Info.push_back(*new AssInfo(info.first, info.second));
-		for (auto const& style : styles)
-			c->ass->Styles.push_back(*new AssStyle(style));
-		c->ass->Attachments = attachments;
-		for (auto const& event : events) {
-			auto copy = new AssDialogue(event);
-			c->ass->Events.push_back(*copy);
-			if (copy->Id == active_line_id)
-				active_line = copy;
-			if (binary_search(begin(selection), end(selection), copy->Id))
-				new_sel.insert(copy);
+		for (auto& line : c->ass->Events) {
+			if (line.Id == active_line_id)
+				active_line = &line;
+			if (binary_search(begin(selection), end(selection), line.Id))
+				new_sel.insert(&line);
 		}
-		c->ass->Extradata = extradata;
 
 		c->ass->Commit("", AssFile::COMMIT_NEW);
 		c->selectionController->SetSelectionAndActive(std::move(new_sel), active_line);
@@ -143,20 +131,41 @@ struct SubsController::UndoInfo {
 	}
 };
 
+struct SubsController::PendingSave {
+	agi::fs::path filename;
+	/// Commit which the snapshot being written was taken at
+	int commit_id;
+	/// Set by the save queue once the file has been written or has failed
+	std::atomic<bool> done{false};
+	/// Why writing the file failed, if it did
+	wxString error;
+};
+
 SubsController::SubsController(agi::Context *context)
 : context(context)
 , undo_connection(context->ass->AddUndoManager(&SubsController::OnCommit, this))
 , text_selection_connection(context->textSelectionController->AddSelectionListener(&SubsController::OnTextSelectionChanged, this))
-, autosave_queue(agi::dispatch::Create())
+, autosave_queue(agi::make_unique<agi::dispatch::CoalescingQueue>(agi::dispatch::Priority::Background))
+, save_queue(agi::dispatch::Create(agi::dispatch::Priority::Interactive))
 {
 	autosave_timer_changed(&autosave_timer);
 	OPT_SUB("App/Auto/Save", [=] { autosave_timer_changed(&autosave_timer); });
 	OPT_SUB("App/Auto/Save Every Seconds", [=] { autosave_timer_changed(&autosave_timer); });
+	OPT_SUB("Path/Auto/Save", [=] { journal.reset(); });
 	autosave_timer.Bind(wxEVT_TIMER, [=](wxTimerEvent&) { AutoSave(); });
+
+	// Losing undo history is more noticeable than having to decode audio or
+	// video again, so the undo stack is shrunk after the other caches. A
+	// lower allowance takes effect at the next commit.
+	budget_registration = agi::GlobalMemoryBudget().Register("undo stack", 1, 2,
+		[=] { return undo_memory.load(); },
+		[=](size_t limit) { undo_allowance = limit; });
 }
 
 SubsController::~SubsController() {
-	// Make sure there are no autosaves in progress
+	// Make sure there are no saves or autosaves in progress
+	save_token.Cancel();
+	save_queue->Sync([]{ });
 	autosave_queue->Sync([]{ });
 }
 
@@ -166,9 +175,19 @@ void SubsController::SetSelectionController(SelectionController *selection_contr
 }
 
 ProjectProperties SubsController::Load(agi::fs::path const& filename, std::string charset) {
+	WaitForSaves();
 	AssFile temp;
 
-	SubtitleFormat::GetReader(filename, charset)->ReadFile(&temp, filename, context->project->Timecodes(), charset);
+	// A snapshot's contents are exactly what parsing the file would give, so
+	// it can be used in place of parsing whenever the file hasn't changed
+	auto snapshot = SnapshotPath(filename);
+	bool from_snapshot = charset.empty() && !snapshot.empty() && session_snapshot::Read(snapshot, filename, temp);
+	if (!from_snapshot) {
+		agi::shared_read_mapping shared_file(filename);
+		if (charset.empty())
+			charset = CharSetDetect::GetEncoding(filename);
+		SubtitleFormat::GetReader(filename, charset)->ReadFile(&temp, filename, context->project->Timecodes(), charset);
+	}
 
 	context->ass->swap(temp);
 	auto props = context->ass->Properties;
@@ -181,6 +200,9 @@ ProjectProperties SubsController::Load(agi::fs::path const& filename, std::strin
 	autosaved_commit_id = saved_commit_id = commit_id + 1;
 	context->ass->Commit("", AssFile::COMMIT_NEW);
 
+	if (!from_snapshot && !snapshot.empty())
+		WriteSnapshot(filename);
+
 	// Save backup of file
 	if (CanSave() && OPT_GET("App/Auto/Backup")->GetBool()) {
 		auto path_str = OPT_GET("Path/Auto/Backup")->GetString();
@@ -198,6 +220,9 @@ ProjectProperties SubsController::Load(agi::fs::path const& filename, std::strin
 }
 
 void SubsController::Save(agi::fs::path const& filename, std::string const& encoding) {
+	WaitForSaves();
+	context->ass->FlushPendingCommits();
+
 	const SubtitleFormat *writer = SubtitleFormat::GetWriter(filename);
 	if (!writer)
 		throw agi::InvalidInputException("Unknown file type.");
@@ -214,6 +239,8 @@ void SubsController::Save(agi::fs::path const& filename, std::string const& enco
 		context->ass->CleanExtradata();
 		writer->WriteFile(context->ass.get(), filename, 0, encoding);
 		FileSave();
+		if (!SnapshotPath(filename).empty())
+			WriteSnapshot(filename);
 	}
 	catch (...) {
 		autosaved_commit_id = old_autosaved_commit_id;
@@ -224,11 +251,92 @@ void SubsController::Save(agi::fs::path const& filename, std::string const& enco
 	SetFileName(filename);
 }
 
+void SubsController::SaveInBackground(agi::fs::path const& filename, std::string const& encoding) {
+	if (!agi::fs::HasExtension(filename, "ass")) {
+		Save(filename, encoding);
+		return;
+	}
+
+	context->ass->FlushPendingCommits();
+
+	const SubtitleFormat *writer = SubtitleFormat::GetWriter(filename);
+	if (!writer)
+		throw agi::InvalidInputException("Unknown file type.");
+
+	agi::trace::Scope scope("save snapshot", "save");
+
+	// Have to set this now for the sake of things that want to save paths
+	// relative to the script in the header
+	this->filename = filename;
+	context->path->SetToken("?script", filename.parent_path());
+	context->ass->CleanExtradata();
+
+	// Only the lines changed since the last undo point are copied here, and
+	// the file is put back together on the save queue
+	auto snapshot = std::make_shared<AssFileSnapshot>(*context->ass, undo_stack.empty() ? nullptr : &undo_stack.back().snapshot);
+	auto properties = context->ass->Properties;
+
+	auto save = std::make_shared<PendingSave>();
+	save->filename = filename;
+	save->commit_id = commit_id;
+	pending_saves.push_back(save);
+
+	context->frame->StatusTimeout(fmt_tl("Saving \"%s\"...", filename.filename()));
+
+	auto token = save_token;
+	save_queue->Async([=] {
+		agi::trace::Scope scope("save write", "save");
+		try {
+			AssFile subs;
+			snapshot->Restore(subs);
+			subs.Properties = properties;
+			writer->WriteFile(&subs, filename, 0, encoding);
+		}
+		catch (agi::Exception const& err) {
+			save->error = to_wx(err.GetMessage());
+		}
+		catch (...) {
+			save->error = "Unknown error";
+		}
+		save->done = true;
+
+		agi::dispatch::Main().Async([=] { FinishSaves(); }, token);
+	});
+}
+
+void SubsController::FinishSaves() {
+	while (!pending_saves.empty() && pending_saves.front()->done) {
+		auto save = pending_saves.front();
+		pending_saves.pop_front();
+
+		if (!save->error.empty()) {
+			wxMessageBox(save->error, "Error", wxOK | wxICON_ERROR | wxCENTER, context->parent);
+			continue;
+		}
+
+		// Edits made while the file was being written are still unsaved
+		autosaved_commit_id = saved_commit_id = save->commit_id;
+		context->frame->StatusTimeout(fmt_tl("Saved \"%s\".", save->filename.filename()));
+		FileSave();
+		if (commit_id == save->commit_id && !SnapshotPath(save->filename).empty())
+			WriteSnapshot(save->filename);
+		SetFileName(save->filename);
+	}
+}
+
+void SubsController::WaitForSaves() {
+	if (pending_saves.empty()) return;
+	save_queue->Sync([]{ });
+	FinishSaves();
+}
+
 void SubsController::Close() {
+	WaitForSaves();
 	undo_stack.clear();
 	redo_stack.clear();
 	autosaved_commit_id = saved_commit_id = commit_id + 1;
 	filename.clear();
+	journal.reset();
 	AssFile blank;
 	blank.swap(*context->ass);
 	context->ass->LoadDefault(true, OPT_GET("Subtitle Format/ASS/Default Style Catalog")->GetString());
@@ -236,7 +344,9 @@ void SubsController::Close() {
 	FileOpen(filename);
 }
 
-int SubsController::TryToClose(bool allow_cancel) const {
+int SubsController::TryToClose(bool allow_cancel) {
+	context->ass->FlushPendingCommits();
+
 	if (!IsModified())
 		return wxYES;
 
@@ -246,6 +356,7 @@ int SubsController::TryToClose(bool allow_cancel) const {
 	int result = wxMessageBox(fmt_tl("Do you want to save changes to %s?", Filename()), _("Unsaved changes"), flags, context->parent);
 	if (result == wxYES) {
 		cmd::call("subtitle/save", context);
+		WaitForSaves();
 		// If it fails saving, return cancel anyway
 		return IsModified() ? wxCANCEL : wxYES;
 	}
@@ -256,6 +367,8 @@ void SubsController::AutoSave() {
 	if (commit_id == autosaved_commit_id)
 		return;
 
+	agi::trace::Scope scope("autosave snapshot", "autosave");
+
 	auto directory = context->path->Decode(OPT_GET("Path/Auto/Save")->GetString());
 	if (directory.empty())
 		directory = filename.parent_path();
@@ -266,16 +379,37 @@ void SubsController::AutoSave() {
 
 	autosaved_commit_id = commit_id;
 	auto frame = context->frame;
-	auto subs_copy = new AssFile(*context->ass);
-	autosave_queue->Async([subs_copy, name, directory, frame] {
-		wxString msg;
-		std::unique_ptr<AssFile> subs(subs_copy);
+	// Only the lines changed since the last undo point are copied here, and
+	// the file is put back together on the autosave thread
+	auto snapshot = std::make_shared<AssFileSnapshot>(*context->ass, undo_stack.empty() ? nullptr : &undo_stack.back().snapshot);
+
+	std::shared_ptr<AutosaveJournal> journal;
+	if (OPT_GET("App/Auto/Save Journal")->GetBool()) {
+		if (!this->journal)
+			this->journal = std::make_shared<AutosaveJournal>(directory, name.string());
+		journal = this->journal;
+	}
+	else
+		this->journal.reset();
 
+	// An autosave which hasn't started by the time of the next one is
+	// dropped, as the journal diffs against whatever it last wrote
+	autosave_queue->Async(0, [snapshot, journal, name, directory, frame] {
+		agi::trace::Scope scope("autosave write", "autosave");
+		wxString msg;
 		try {
-			agi::fs::CreateDirectory(directory);
-			auto path = directory /  agi::format("%s.%s.AUTOSAVE.ass", name.string(),
-			                                     agi::util::strftime("%Y-%m-%d-%H-%M-%S"));
-			SubtitleFormat::GetWriter(path)->WriteFile(subs.get(), path, 0);
+			agi::fs::path path;
+			if (journal)
+				path = journal->Write(snapshot);
+			else {
+				auto subs = agi::make_unique<AssFile>();
+				snapshot->Restore(*subs);
+
+				agi::fs::CreateDirectory(directory);
+				path = directory /  agi::format("%s.%s.AUTOSAVE.ass", name.string(),
+				                                agi::util::strftime("%Y-%m-%d-%H-%M-%S"));
+				SubtitleFormat::GetWriter(path)->WriteFile(subs.get(), path, 0);
+			}
 			msg = fmt_tl("File backup saved as \"%s\".", path);
 		}
 		catch (const agi::Exception& err) {
@@ -291,6 +425,51 @@ void SubsController::AutoSave() {
 	});
 }
 
+agi::fs::path SubsController::SnapshotPath(agi::fs::path const& file) const {
+	// Only ASS files are read back exactly as they were written, so for other
+	// formats the in-memory file after saving isn't what opening it gives
+	if (!OPT_GET("App/Auto/Session Snapshot")->GetBool() || !agi::fs::HasExtension(file, "ass"))
+		return agi::fs::path();
+	auto directory = context->path->Decode(OPT_GET("Path/Auto/Session Snapshot")->GetString());
+	return session_snapshot::PathFor(directory, file);
+}
+
+bool SubsController::HasSnapshot(agi::fs::path const& file) const {
+	auto snapshot = SnapshotPath(file);
+	return !snapshot.empty() && session_snapshot::IsValid(snapshot, file);
+}
+
+void SubsController::WriteSnapshot(agi::fs::path const& file) {
+	agi::trace::Scope scope("session snapshot", "autosave");
+
+	// The file's stamp has to be taken now, as it may be modified again
+	// before the snapshot is written
+	session_snapshot::SourceStamp stamp;
+	try {
+		stamp = session_snapshot::Stamp(file);
+	}
+	catch (agi::fs::FileSystemError const& e) {
+		LOG_W("session_snapshot") << e.GetMessage();
+		return;
+	}
+
+	auto path = SnapshotPath(file);
+	auto snapshot = std::make_shared<AssFileSnapshot>(*context->ass, undo_stack.empty() ? nullptr : &undo_stack.back().snapshot);
+	auto props = context->ass->Properties;
+	autosave_queue->Async(1, [=] {
+		agi::trace::Scope scope("session snapshot write", "autosave");
+		try {
+			AssFile subs;
+			snapshot->Restore(subs);
+			subs.Properties = props;
+			session_snapshot::Write(path, stamp, subs);
+		}
+		catch (agi::Exception const& e) {
+			LOG_E("session_snapshot") << "Writing " << path << " failed: " << e.GetMessage();
+		}
+	});
+}
+
 bool SubsController::CanSave() const {
 	try {
 		return SubtitleFormat::GetWriter(filename)->CanSave(context->ass.get());
@@ -302,6 +481,7 @@ bool SubsController::CanSave() const {
 
 void SubsController::SetFileName(agi::fs::path const& path) {
 	filename = path;
+	journal.reset();
 	context->path->SetToken("?script", path.parent_path());
 	config::mru->Add("Subtitle", path);
 	OPT_SET("Path/Last/Subtitles")->SetString(filename.parent_path().string());
@@ -311,22 +491,21 @@ void SubsController::OnCommit(AssFileCommit c) {
 	if (c.message.empty() && !undo_stack.empty()) return;
 
 	commit_id = next_commit_id++;
+	// Entry being replaced by this commit, kept until the new one has shared
+	// its unchanged lines
+	boost::container::list<UndoInfo> replaced;
+
 	// Allow coalescing only if it's the last change and the file has not been
 	// saved since the last change
 	if (commit_id == *c.commit_id+1 && redo_stack.empty() && saved_commit_id+1 != commit_id) {
 		// If only one line changed just modify it instead of copying the file
-		if (c.single_line && c.single_line->Group() == AssEntryGroup::DIALOGUE) {
-			for (auto& diag : undo_stack.back().events) {
-				if (diag.Id == c.single_line->Id) {
-					diag = *c.single_line;
-					break;
-				}
-			}
+		if (c.single_line && c.single_line->Group() == AssEntryGroup::DIALOGUE
+			&& undo_stack.back().snapshot.SetEvent(*c.single_line)) {
 			*c.commit_id = commit_id;
 			return;
 		}
 
-		undo_stack.pop_back();
+		replaced.splice(replaced.end(), undo_stack, std::prev(undo_stack.end()));
 	}
 
 	// Make sure the file has at least one style and one dialogue line
@@ -339,12 +518,54 @@ void SubsController::OnCommit(AssFileCommit c) {
 
 	redo_stack.clear();
 
-	undo_stack.emplace_back(context, c.message, commit_id);
+	auto const& previous = replaced.empty() ? undo_stack : replaced;
+	if (previous.empty())
+		undo_stack.emplace_back(context, c.message, commit_id, AssFileSnapshot(*context->ass));
+	else if (c.single_line && c.single_line->Group() == AssEntryGroup::DIALOGUE && c.type != AssFile::COMMIT_NEW
+		&& !(c.type & (AssFile::COMMIT_DIAG_ADDREM | AssFile::COMMIT_ORDER))) {
+		// Only one existing line changed, so there's no need to compare all
+		// of the others with the previous snapshot
+		auto const& prev = previous.back().snapshot;
+		undo_stack.emplace_back(context, c.message, commit_id, AssFileSnapshot(*context->ass, prev, *c.single_line));
+	}
+	else if (c.lines && !(c.type & ~AssFile::COMMIT_DIAG_FULL)) {
+		// Likewise for a known set of existing lines
+		auto const& prev = previous.back().snapshot;
+		undo_stack.emplace_back(context, c.message, commit_id, AssFileSnapshot(*context->ass, prev, *c.lines));
+	}
+	else
+		undo_stack.emplace_back(context, c.message, commit_id, AssFileSnapshot(*context->ass, &previous.back().snapshot));
 
+	auto& entry = undo_stack.back();
+	entry.memory = entry.snapshot.MemoryUsage(undo_stack.size() > 1 ? &std::prev(undo_stack.end(), 2)->snapshot : nullptr);
+
+	// Drop the oldest entries when there are too many or they use too much
+	// memory, but always keep enough to undo the latest change
 	int depth = std::max<int>(OPT_GET("Limits/Undo Levels")->GetInt(), 2);
-	while ((int)undo_stack.size() > depth)
+	size_t budget = size_t(std::max<int64_t>(OPT_GET("Limits/Undo Memory")->GetInt(), 16)) << 20;
+	budget = std::min(budget, undo_allowance.load());
+	size_t used = 0;
+	for (auto const& info : undo_stack)
+		used += info.memory;
+	while (undo_stack.size() > 2 && ((int)undo_stack.size() > depth || used > budget)) {
+		used -= undo_stack.front().memory;
 		undo_stack.pop_front();
 
+		// Everything the new oldest entry shared with the removed one is now
+		// only held by it
+		auto& front = undo_stack.front();
+		used -= front.memory;
+		front.memory = front.snapshot.MemoryUsage(nullptr);
+		used += front.memory;
+	}
+
+	static auto& undo_entries = agi::perf::GetGauge("undo/entries");
+	static auto& undo_bytes = agi::perf::GetGauge("undo/bytes");
+	undo_entries.Set(undo_stack.size());
+	undo_bytes.Set(used);
+	undo_memory = used;
+	agi::GlobalMemoryBudget().Rebalance();
+
 	if (undo_stack.size() > 1 && OPT_GET("App/Auto/Save on Every Change")->GetBool() && !filename.empty() && CanSave())
 		Save(filename);
 
@@ -367,6 +588,7 @@ void SubsController::OnTextSelectionChanged() {
 }
 
 void SubsController::Undo() {
+	context->ass->FlushPendingCommits();
 	if (undo_stack.size() <= 1) return;
 	redo_stack.splice(redo_stack.end(), undo_stack, std::prev(undo_stack.end()));
 
@@ -378,6 +600,7 @@ void SubsController::Undo() {
 }
 
 void SubsController::Redo() {
+	context->ass->FlushPendingCommits();
 	if (redo_stack.empty()) return;
 	undo_stack.splice(undo_stack.end(), redo_stack, std::prev(redo_stack.end()));
 
@@ -14,18 +14,21 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <libaegisub/dispatch.h>
 #include <libaegisub/fs_fwd.h>
+#include <libaegisub/memory_budget.h>
 #include <libaegisub/signal.h>
 
+#include <atomic>
 #include <boost/container/list.hpp>
+#include <cstdint>
 #include <boost/filesystem/path.hpp>
+#include <deque>
 #include <wx/timer.h>
 
+class AutosaveJournal;
 class SelectionController;
 namespace agi {
-	namespace dispatch {
-		class Queue;
-	}
 	struct Context;
 }
 struct AssFileCommit;
@@ -57,7 +60,29 @@ class SubsController {
 	wxTimer autosave_timer;
 
 	/// Queue which autosaves are performed on
-	std::unique_ptr<agi::dispatch::Queue> autosave_queue;
+	std::unique_ptr<agi::dispatch::CoalescingQueue> autosave_queue;
+
+	/// Journal which autosaves are appended to, if journaling is enabled
+	std::shared_ptr<AutosaveJournal> journal;
+
+	struct PendingSave;
+	/// Queue which background saves are written on
+	std::unique_ptr<agi::dispatch::Queue> save_queue;
+	/// Background saves which haven't been finished on the main thread yet,
+	/// in the order they were started
+	std::deque<std::shared_ptr<PendingSave>> pending_saves;
+	/// Cancelled on destruction so that saves finishing later don't touch
+	/// the controller
+	agi::dispatch::CancellationToken save_token;
+
+	/// Update the saved state for each background save which has finished
+	void FinishSaves();
+
+	/// Bytes used by the undo stack, as reported to the memory budget
+	std::atomic<size_t> undo_memory{0};
+	/// Most the undo stack may use according to the memory budget
+	std::atomic<size_t> undo_allowance{SIZE_MAX};
+	agi::MemoryBudget::Registration budget_registration;
 
 	/// A new file has been opened (filename)
 	agi::signal::Signal<agi::fs::path> FileOpen;
@@ -73,6 +98,11 @@ class SubsController {
 	/// Autosave the file if there have been any chances since the last autosave
 	void AutoSave();
 
+	/// Path of the session snapshot for file, or empty if it shouldn't have one
+	agi::fs::path SnapshotPath(agi::fs::path const& file) const;
+	/// Write a session snapshot of the current state of the file in the background
+	void WriteSnapshot(agi::fs::path const& file);
+
 	void OnCommit(AssFileCommit c);
 	void OnActiveLineChanged();
 	void OnSelectionChanged();
@@ -99,18 +129,35 @@ public:
 	/// @param charset Character set of file
 	ProjectProperties Load(agi::fs::path const& file, std::string charset);
 
+	/// Is there an up to date session snapshot which Load can use for file?
+	bool HasSnapshot(agi::fs::path const& file) const;
+
 	/// @brief Save to a file
 	/// @param file Path to save to
 	/// @param encoding Encoding to use, or empty to let the writer decide (which usually means "App/Save Charset")
 	void Save(agi::fs::path const& file, std::string const& encoding="");
 
+	/// Save to a file in the background
+	///
+	/// The file is written from a snapshot taken now, so editing can go on
+	/// while it's written. The file counts as saved once the write is done,
+	/// and then only if nothing has been changed since the snapshot. Formats
+	/// other than ASS may need to ask the user things while writing, so they
+	/// are saved right away as with Save().
+	/// @param file Path to save to
+	/// @param encoding Encoding to use, or empty to let the writer decide
+	void SaveInBackground(agi::fs::path const& file, std::string const& encoding="");
+
+	/// Wait for any background saves to finish, reporting their results
+	void WaitForSaves();
+
 	/// Close the currently open file (i.e. open a new blank file)
 	void Close();
 
 	/// If there are unsaved changes, asl the user if they want to save them
 	/// @param allow_cancel Let the user cancel the closing
 	/// @return wxYES, wxNO or wxCANCEL (note: all three are true in a boolean context)
-	int TryToClose(bool allow_cancel = true) const;
+	int TryToClose(bool allow_cancel = true);
 
 	/// Can the file be saved in its current format?
 	bool CanSave() const;
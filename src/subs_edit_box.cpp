@@ -109,6 +109,7 @@ SubsEditBox::SubsEditBox(wxWindow *parent, agi::Context *context)
 , c(context)
 , retina_helper(agi::make_unique<RetinaHelper>(parent))
 , undo_timer(GetEventHandler())
+, text_commit_timer(GetEventHandler())
 {
 	using std::bind;
 
@@ -221,6 +222,7 @@ SubsEditBox::SubsEditBox(wxWindow *parent, agi::Context *context)
 	SetSizerAndFit(main_sizer);
 
 	edit_ctrl->Bind(wxEVT_STC_MODIFIED, &SubsEditBox::OnChange, this);
+	edit_ctrl->Bind(wxEVT_KILL_FOCUS, [=](wxFocusEvent &evt) { CommitPendingText(); evt.Skip(); });
 	edit_ctrl->SetModEventMask(wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT | wxSTC_STARTACTION);
 
 	Bind(wxEVT_TEXT, &SubsEditBox::OnLayerEnter, this, layer->GetId());
@@ -229,7 +231,8 @@ SubsEditBox::SubsEditBox(wxWindow *parent, agi::Context *context)
 
 	Bind(wxEVT_CHAR_HOOK, &SubsEditBox::OnKeyDown, this);
 	Bind(wxEVT_SIZE, &SubsEditBox::OnSize, this);
-	Bind(wxEVT_TIMER, [=](wxTimerEvent&) { commit_id = -1; });
+	Bind(wxEVT_TIMER, [=](wxTimerEvent&) { commit_id = -1; }, undo_timer.GetId());
+	Bind(wxEVT_TIMER, [=](wxTimerEvent&) { CommitPendingText(); }, text_commit_timer.GetId());
 
 	wxSizeEvent evt;
 	OnSize(evt);
@@ -240,6 +243,7 @@ SubsEditBox::SubsEditBox(wxWindow *parent, agi::Context *context)
 		context->selectionController->AddActiveLineListener(&SubsEditBox::OnActiveLineChanged, this),
 		context->selectionController->AddSelectionListener(&SubsEditBox::OnSelectedSetChanged, this),
 		context->initialLineState->AddChangeListener(&SubsEditBox::OnLineInitialTextChanged, this),
+		context->ass->AddFlushListener(&SubsEditBox::CommitPendingText, this),
 	 });
 
 	context->textSelectionController->SetControl(edit_ctrl);
@@ -315,6 +319,14 @@ void SubsEditBox::OnCommit(int type) {
 
 	initial_times.clear();
 
+	// Something committed without flushing first, which took the pending
+	// text along with it, and the lines may no longer exist
+	if (!pending_text_lines.empty()) {
+		pending_text_lines.clear();
+		text_commit_timer.Stop();
+		commit_id = -1;
+	}
+
 	if (type == AssFile::COMMIT_NEW || type & AssFile::COMMIT_STYLES) {
 		wxString style = style_box->GetValue();
 		style_box->Clear();
@@ -370,10 +382,10 @@ void SubsEditBox::UpdateFields(int type, bool repopulate_lists) {
 	}
 }
 
-void SubsEditBox::PopulateList(wxComboBox *combo, boost::flyweight<std::string> AssDialogue::*field) {
+void SubsEditBox::PopulateList(wxComboBox *combo, agi::StringFlyweight AssDialogue::*field) {
 	wxEventBlocker blocker(this);
 
-	std::unordered_set<boost::flyweight<std::string>> values;
+	std::unordered_set<agi::StringFlyweight> values;
 	for (auto const& line : c->ass->Events) {
 		auto const& value = line.*field;
 		if (!value.get().empty())
@@ -399,6 +411,7 @@ void SubsEditBox::PopulateList(wxComboBox *combo, boost::flyweight<std::string>
 }
 
 void SubsEditBox::OnActiveLineChanged(AssDialogue *new_line) {
+	CommitPendingText();
 	wxEventBlocker blocker(this);
 	line = new_line;
 	commit_id = -1;
@@ -407,6 +420,7 @@ void SubsEditBox::OnActiveLineChanged(AssDialogue *new_line) {
 }
 
 void SubsEditBox::OnSelectedSetChanged() {
+	CommitPendingText();
 	initial_times.clear();
 }
 
@@ -436,16 +450,20 @@ void SubsEditBox::OnKeyDown(wxKeyEvent &event) {
 
 void SubsEditBox::OnChange(wxStyledTextEvent &event) {
 	if (line && edit_ctrl->GetTextRaw().data() != line->Text.get()) {
-		if (event.GetModificationType() & wxSTC_STARTACTION)
+		if (event.GetModificationType() & wxSTC_STARTACTION) {
+			// The text typed before this is its own undo step
+			CommitPendingText();
 			commit_id = -1;
-		CommitText(_("modify text"));
+		}
+		QueueTextCommit();
 		UpdateCharacterCount(line->Text);
 	}
 }
 
-void SubsEditBox::Commit(wxString const& desc, int type, bool amend, AssDialogue *line) {
+void SubsEditBox::Commit(wxString const& desc, int type, bool amend, std::vector<AssDialogue *> const& lines) {
+	CommitPendingText();
 	file_changed_slot.Block();
-	commit_id = c->ass->Commit(desc, type, (amend && desc == last_commit_type) ? commit_id : -1, line);
+	commit_id = c->ass->Commit(desc, type, lines, (amend && desc == last_commit_type) ? commit_id : -1);
 	file_changed_slot.Unblock();
 	last_commit_type = desc;
 	last_time_commit_type = -1;
@@ -457,7 +475,7 @@ template<class setter>
 void SubsEditBox::SetSelectedRows(setter set, wxString const& desc, int type, bool amend) {
 	auto const& sel = c->selectionController->GetSelectedSet();
 	for_each(sel.begin(), sel.end(), set);
-	Commit(desc, type, amend, sel.size() == 1 ? *sel.begin() : nullptr);
+	Commit(desc, type, amend, std::vector<AssDialogue *>(sel.begin(), sel.end()));
 }
 
 template<class T>
@@ -467,16 +485,38 @@ void SubsEditBox::SetSelectedRows(T AssDialogueBase::*field, T value, wxString c
 
 template<class T>
 void SubsEditBox::SetSelectedRows(T AssDialogueBase::*field, wxString const& value, wxString const& desc, int type, bool amend) {
-	boost::flyweight<std::string> conv_value(from_wx(value));
+	agi::StringFlyweight conv_value(from_wx(value));
 	SetSelectedRows([&](AssDialogue *d) { d->*field = conv_value; }, desc, type, amend);
 }
 
-void SubsEditBox::CommitText(wxString const& desc) {
+void SubsEditBox::QueueTextCommit() {
 	auto data = edit_ctrl->GetTextRaw();
-	SetSelectedRows(&AssDialogue::Text, boost::flyweight<std::string>(data.data(), data.length()), desc, AssFile::COMMIT_DIAG_TEXT, true);
+	agi::StringFlyweight text(data.data(), data.length());
+	auto const& sel = c->selectionController->GetSelectedSet();
+	for (auto d : sel)
+		d->Text = text;
+	pending_text_lines.assign(sel.begin(), sel.end());
+
+	// Every commit re-renders the video, repaints the grid and so on, so
+	// rather than doing so per keystroke wait for a pause in typing
+	int delay = OPT_GET("Subtitle/Edit Box/Commit Delay")->GetInt();
+	if (delay > 0)
+		text_commit_timer.Start(delay, wxTIMER_ONE_SHOT);
+	else
+		CommitPendingText();
+}
+
+void SubsEditBox::CommitPendingText() {
+	if (pending_text_lines.empty()) return;
+	text_commit_timer.Stop();
+
+	std::vector<AssDialogue *> lines;
+	lines.swap(pending_text_lines);
+	Commit(_("modify text"), AssFile::COMMIT_DIAG_TEXT, true, lines);
 }
 
 void SubsEditBox::CommitTimes(TimeField field) {
+	CommitPendingText();
 	auto const& sel = c->selectionController->GetSelectedSet();
 	for (AssDialogue *d : sel) {
 		if (!initial_times.count(d))
@@ -516,7 +556,7 @@ void SubsEditBox::CommitTimes(TimeField field) {
 
 	last_time_commit_type = field;
 	file_changed_slot.Block();
-	commit_id = c->ass->Commit(_("modify times"), AssFile::COMMIT_DIAG_TIME, commit_id, sel.size() == 1 ? *sel.begin() : nullptr);
+	commit_id = c->ass->Commit(_("modify times"), AssFile::COMMIT_DIAG_TIME, std::vector<AssDialogue *>(sel.begin(), sel.end()), commit_id);
 	file_changed_slot.Unblock();
 }
 
@@ -625,7 +665,12 @@ void SubsEditBox::UpdateCharacterCount(std::string const& text) {
 		ignore |= agi::IGNORE_WHITESPACE;
 	if (OPT_GET("Subtitle/Character Counter/Ignore Punctuation")->GetBool())
 		ignore |= agi::IGNORE_PUNCTUATION;
-	size_t length = agi::MaxLineLength(text, ignore);
+	if (ignore != counted_mask || text != counted_text) {
+		counted_length = agi::MaxLineLength(text, ignore);
+		counted_text = text;
+		counted_mask = ignore;
+	}
+	size_t length = counted_length;
 	char_count->SetValue(std::to_wstring(length));
 	size_t limit = (size_t)OPT_GET("Subtitle/Character Limit")->GetInt();
 	if (limit && length > limit)
@@ -29,13 +29,13 @@
 
 #include <array>
 #include <boost/container/map.hpp>
-#include <boost/flyweight/flyweight_fwd.hpp>
 #include <vector>
 
 #include <wx/combobox.h>
 #include <wx/panel.h>
 #include <wx/timer.h>
 
+#include <libaegisub/flyweight.h>
 #include <libaegisub/signal.h>
 
 namespace agi { namespace vfr { class Framerate; } }
@@ -99,6 +99,13 @@ class SubsEditBox final : public wxPanel {
 	wxTextCtrl *char_count;
 	wxCheckBox *split_box;
 
+	/// Text, ignore mask and result of the last character count, as the
+	/// count box is refreshed whenever the line is reloaded, often with
+	/// unchanged text
+	std::string counted_text;
+	int counted_mask = -1;
+	size_t counted_length = 0;
+
 	wxSizer *top_sizer;
 	wxSizer *middle_right_sizer;
 	wxSizer *middle_left_sizer;
@@ -110,10 +117,12 @@ class SubsEditBox final : public wxPanel {
 	/// @brief Update times of selected lines
 	/// @param field Field which changed
 	void CommitTimes(TimeField field);
-	/// @brief Commits the current edit box contents
-	/// @param desc Undo description to use
-	void CommitText(wxString const& desc);
-	void Commit(wxString const& desc, int type, bool amend, AssDialogue *line);
+	/// @brief Apply the current edit box contents to the selected lines,
+	///        committing them once typing pauses
+	void QueueTextCommit();
+	/// Commit the text applied by QueueTextCommit, if it hasn't been yet
+	void CommitPendingText();
+	void Commit(wxString const& desc, int type, bool amend, std::vector<AssDialogue *> const& lines);
 
 	/// Last commit ID for undo coalescing
 	int commit_id = -1;
@@ -127,6 +136,13 @@ class SubsEditBox final : public wxPanel {
 	/// Timer to stop coalescing changes after a break with no edits
 	wxTimer undo_timer;
 
+	/// Lines which have been given the edit box's text but not committed, so
+	/// that a burst of typing results in a single commit notification
+	std::vector<AssDialogue *> pending_text_lines;
+
+	/// Timer to commit pending text once typing pauses
+	wxTimer text_commit_timer;
+
 	/// The start and end times of the selected lines without changes made to
 	/// avoid negative durations, so that they can be restored if future changes
 	/// eliminate the negative durations
@@ -185,7 +201,7 @@ class SubsEditBox final : public wxPanel {
 	void UpdateFields(int type, bool repopulate_lists);
 
 	/// Regenerate a dropdown list with the unique values of a dialogue field
-	void PopulateList(wxComboBox *combo, boost::flyweight<std::string> AssDialogue::*field);
+	void PopulateList(wxComboBox *combo, agi::StringFlyweight AssDialogue::*field);
 
 	/// @brief Enable or disable frame timing mode
 	void UpdateFrameTiming(agi::vfr::Framerate const& fps);
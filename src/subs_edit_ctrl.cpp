@@ -47,6 +47,7 @@
 #include <libaegisub/make_unique.h>
 #include <libaegisub/spellchecker.h>
 
+#include <algorithm>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <functional>
@@ -60,6 +61,16 @@
 // It should be above 100 (at least 242) and probably not more than 1000
 #define LANGS_MAX 1000
 
+namespace {
+void start_styling(wxStyledTextCtrl *ctrl, int pos) {
+#if wxCHECK_VERSION(3, 1, 0)
+	ctrl->StartStyling(pos);
+#else
+	ctrl->StartStyling(pos, 255);
+#endif
+}
+}
+
 /// Event ids
 enum {
 	EDIT_MENU_SPLIT_PRESERVE = 1400,
@@ -259,37 +270,92 @@ void SubsTextEditCtrl::UpdateStyle() {
 	AssDialogue *diag = context ? context->selectionController->GetActiveLine() : nullptr;
 	bool template_line = diag && diag->Comment && boost::istarts_with(diag->Effect.get(), "template");
 
-	tokenized_line = agi::ass::TokenizeDialogueBody(line_text, template_line);
+	if (template_line != lexed_template) {
+		lexed_text.clear();
+		lexed_line.clear();
+		lexed_template = template_line;
+	}
+	auto relexed = agi::ass::RetokenizeDialogueBody(lexed_text, line_text, lexed_line, template_line);
+	lexed_text = line_text;
+
+	tokenized_line = lexed_line;
 	agi::ass::SplitWords(line_text, tokenized_line);
+	calltip_index = agi::IndexCalltips(tokenized_line);
 
 	cursor_pos = -1;
 	UpdateCallTip();
 
-	#if wxCHECK_VERSION(3, 1, 0)
-	StartStyling(0);
-	#else
-	StartStyling(0,255);
-	#endif
-
 	if (!OPT_GET("Subtitle/Highlight/Syntax")->GetBool()) {
+		start_styling(this, 0);
 		SetStyling(line_text.size(), 0);
+		styled_line.clear();
 		return;
 	}
 
-	if (line_text.empty()) return;
+	if (line_text.empty()) {
+		styled_line.clear();
+		return;
+	}
+
+	std::vector<std::string> unchecked;
+	auto styles = agi::ass::SyntaxHighlight(line_text, tokenized_line, spellchecker.get(), &unchecked);
+
+	// Only the relexed part of the line and whatever the styles changed for
+	// need to be restyled, as the rest of the control's styling moves along
+	// with the text when it's edited
+	size_t start = 0, end = line_text.size();
+	if (!styled_line.empty()) {
+		size_t same_prefix = 0;
+		for (size_t i = 0; i < styles.size() && i < styled_line.size(); ++i) {
+			if (styles[i].type != styled_line[i].type) break;
+			same_prefix += std::min(styles[i].length, styled_line[i].length);
+			if (styles[i].length != styled_line[i].length) break;
+		}
+
+		size_t same_suffix = 0;
+		for (size_t i = 1; i <= styles.size() && i <= styled_line.size(); ++i) {
+			auto const& cur = styles[styles.size() - i];
+			auto const& prev = styled_line[styled_line.size() - i];
+			if (cur.type != prev.type) break;
+			same_suffix += std::min(cur.length, prev.length);
+			if (cur.length != prev.length) break;
+		}
+
+		start = std::min(relexed.first, same_prefix);
+		end = std::max(relexed.second, line_text.size() - std::min(same_suffix, line_text.size()));
+	}
 
 	SetIndicatorCurrent(0);
+	start_styling(this, start);
 	size_t pos = 0;
-	for (auto const& style_range : agi::ass::SyntaxHighlight(line_text, tokenized_line, spellchecker.get())) {
+	for (auto const& style_range : styles) {
+		size_t range_start = std::max(pos, start);
+		size_t range_end = std::min(pos + style_range.length, end);
+		pos += style_range.length;
+		if (range_start >= range_end) continue;
+
+		size_t len = range_end - range_start;
 		if (style_range.type == agi::ass::SyntaxStyle::SPELLING) {
-			SetStyling(style_range.length, agi::ass::SyntaxStyle::NORMAL);
-			IndicatorFillRange(pos, style_range.length);
+			SetStyling(len, agi::ass::SyntaxStyle::NORMAL);
+			IndicatorFillRange(range_start, len);
 		}
 		else {
-			SetStyling(style_range.length, style_range.type);
-			IndicatorClearRange(pos, style_range.length);
+			SetStyling(len, style_range.type);
+			IndicatorClearRange(range_start, len);
 		}
-		pos += style_range.length;
+	}
+	// Everything after the restyled range is already up to date
+	start_styling(this, line_text.size());
+	styled_line = std::move(styles);
+
+	// Words which haven't been seen before are checked in the background
+	// rather than making typing wait on the dictionary, and the squiggles
+	// get filled in once they're done
+	if (!unchecked.empty()) {
+		auto text = line_text;
+		spellchecker->CheckWordsAsync(std::move(unchecked), [=] {
+			if (text == line_text) UpdateStyle();
+		});
 	}
 }
 
@@ -300,7 +366,7 @@ void SubsTextEditCtrl::UpdateCallTip() {
 	if (pos == cursor_pos) return;
 	cursor_pos = pos;
 
-	agi::Calltip new_calltip = agi::GetCalltip(tokenized_line, line_text, pos);
+	agi::Calltip new_calltip = agi::GetCalltip(tokenized_line, calltip_index, line_text, pos);
 
 	if (!new_calltip.text) {
 		CallTipCancel();
@@ -316,6 +382,11 @@ void SubsTextEditCtrl::UpdateCallTip() {
 	CallTipSetHighlight(new_calltip.highlight_start, new_calltip.highlight_end);
 }
 
+void SubsTextEditCtrl::SetTextRaw(const char *text) {
+	styled_line.clear();
+	wxStyledTextCtrl::SetTextRaw(text);
+}
+
 void SubsTextEditCtrl::SetTextTo(std::string const& text) {
 	osx::ime::invalidate(this);
 	SetEvtHandlerEnabled(false);
@@ -27,6 +27,8 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <libaegisub/calltip_provider.h>
+
 #include <memory>
 #include <string>
 #include <vector>
@@ -80,6 +82,22 @@ class SubsTextEditCtrl final : public wxStyledTextCtrl {
 	/// Tokenized version of line_text
 	std::vector<agi::ass::DialogueToken> tokenized_line;
 
+	/// Calltip lookup index for tokenized_line
+	agi::CalltipIndex calltip_index;
+
+	/// Text which lexed_line was lexed from, which is usually the previous
+	/// version of line_text
+	std::string lexed_text;
+	/// Lexer output for lexed_text, before splitting out words, so that
+	/// edits only need to relex the part of the line around them
+	std::vector<agi::ass::DialogueToken> lexed_line;
+	/// Was lexed_line lexed as a karaoke template?
+	bool lexed_template = false;
+
+	/// Syntax styles currently applied to the control's text, used to
+	/// restyle only what changed. Empty when the whole line needs styling.
+	std::vector<agi::ass::DialogueToken> styled_line;
+
 	void OnContextMenu(wxContextMenuEvent &);
 	void OnDoubleClick(wxStyledTextEvent&);
 	void OnUseSuggestion(wxCommandEvent &event);
@@ -114,6 +132,8 @@ public:
 	~SubsTextEditCtrl();
 
 	void SetTextTo(std::string const& text);
+	/// Replace the text, which also discards all of its styling
+	void SetTextRaw(const char *text);
 	void Paste() override;
 
 	std::pair<int, int> GetBoundsOfWordAtPosition(int pos);
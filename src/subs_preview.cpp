@@ -96,31 +96,49 @@ void SubtitlesPreview::SetText(std::string const& text) {
 void SubtitlesPreview::SetColour(agi::Color col) {
 	if (col != back_color) {
 		back_color = col;
-		vid = agi::make_unique<DummyVideoProvider>(0.0, 10, bmp->GetWidth(), bmp->GetHeight(), back_color, true);
+		UpdateBackground();
 		UpdateBitmap();
 	}
 }
 
+void SubtitlesPreview::UpdateBackground() {
+	background = agi::make_unique<VideoFrame>();
+	DummyVideoProvider(0.0, 10, bmp->GetWidth(), bmp->GetHeight(), back_color, true).GetFrame(0, *background);
+	// What was drawn onto the old background can't be updated
+	frame.reset();
+}
+
 void SubtitlesPreview::UpdateBitmap() {
-	if (!vid) return;
+	dirty = true;
+	Refresh(false);
+}
 
-	VideoFrame frame;
-	vid->GetFrame(0, frame);
+void SubtitlesPreview::RenderBitmap() {
+	dirty = false;
+	if (!background) return;
 
+	// Only the parts of the subtitles which changed since the last render
+	// need to be drawn again, on top of the unchanged background
 	if (provider) {
 		try {
 			provider->LoadSubtitles(sub_file.get());
-			provider->DrawSubtitles(frame, 0.1);
+			if (!frame || !provider->RedrawSubtitles(*frame, background.get(), 0.1)) {
+				frame = agi::make_unique<VideoFrame>(*background);
+				provider->DrawSubtitles(*frame, 0.1);
+			}
+		}
+		catch (...) {
+			frame.reset();
 		}
-		catch (...) { }
 	}
 
 	// Convert frame to bitmap
-	*bmp = static_cast<wxBitmap>(GetImage(frame));
-	Refresh();
+	*bmp = static_cast<wxBitmap>(GetImage(frame ? *frame : *background));
 }
 
 void SubtitlesPreview::OnPaint(wxPaintEvent &) {
+	if (dirty)
+		RenderBitmap();
 	wxPaintDC(this).DrawBitmap(*bmp, 0, 0);
 }
 
@@ -131,7 +149,7 @@ void SubtitlesPreview::OnSize(wxSizeEvent &evt) {
 	int h = evt.GetSize().GetHeight();
 
 	bmp = agi::make_unique<wxBitmap>(w, h, -1);
-	vid = agi::make_unique<DummyVideoProvider>(0.0, 10, w, h, back_color, true);
+	UpdateBackground();
 	try {
 		if (!progress)
 			progress = agi::make_unique<DialogProgress>(this);
@@ -40,7 +40,7 @@ class AssFile;
 class AssStyle;
 class DialogProgress;
 class SubtitlesProvider;
-class VideoProvider;
+struct VideoFrame;
 
 /// Preview window to show a short string with a given ass style
 class SubtitlesPreview final : public wxWindow {
@@ -50,8 +50,12 @@ class SubtitlesPreview final : public wxWindow {
 	std::unique_ptr<wxBitmap> bmp;
 	/// The currently display style
 	AssStyle* style;
-	/// Video provider to render into
-	std::unique_ptr<VideoProvider> vid;
+	/// The dummy video frame for the current size and background color
+	std::unique_ptr<VideoFrame> background;
+	/// The background with the subtitles last drawn onto it
+	std::unique_ptr<VideoFrame> frame;
+	/// Whether the bitmap needs to be regenerated before it's next painted
+	bool dirty = true;
 	/// Current background color
 	agi::Color back_color;
 	/// Subtitle file containing the style and displayed line
@@ -61,8 +65,13 @@ class SubtitlesPreview final : public wxWindow {
 
 	std::unique_ptr<DialogProgress> progress;
 
-	/// Regenerate the bitmap
+	/// Regenerate the dummy video frame
+	void UpdateBackground();
+	/// Regenerate the bitmap when it's next painted, so that several changes
+	/// made at once only render once
 	void UpdateBitmap();
+	/// Draw the subtitles and convert the frame to the bitmap
+	void RenderBitmap();
 	/// Resize event handler
 	void OnSize(wxSizeEvent &event);
 	/// Paint event handler
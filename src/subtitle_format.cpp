@@ -83,9 +83,14 @@ bool SubtitleFormat::CanSave(const AssFile *subs) const {
 	if (!subs->Attachments.empty())
 		return false;
 
-	auto def = boost::flyweight<std::string>("Default");
+	auto def = agi::StringFlyweight("Default");
+	std::string stripped;
 	for (auto const& line : subs->Events) {
-		if (line.Style != def || line.GetStrippedText() != line.Text)
+		if (line.Style != def)
+			return false;
+		stripped.clear();
+		line.AppendStrippedText(stripped);
+		if (stripped != line.Text)
 			return false;
 	}
 
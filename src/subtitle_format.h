@@ -115,6 +115,19 @@ public:
 		WriteFile(src, filename, fps, encoding);
 	}
 
+	/// Does writing this format ask the user for anything?
+	///
+	/// Formats which do have to be written on the GUI thread when exporting
+	/// several files at once, while the others are written in the background.
+	virtual bool NeedsUserInput() const { return false; }
+
+	/// Might reading a file in this format ask the user for anything?
+	/// @param fps Frame rate which will be passed to ReadFile
+	///
+	/// The command line batch processor has no way to show dialogs, so it
+	/// refuses to read files for which this is true.
+	virtual bool NeedsUserInputToRead(agi::vfr::Framerate const& fps) const { return false; }
+
 	/// Get the wildcards for a save or load dialog
 	/// @param mode 0: load 1: save
 	static std::string GetWildcards(int mode);
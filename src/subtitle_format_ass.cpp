@@ -31,6 +31,10 @@
 #include <libaegisub/ass/uuencode.h>
 #include <libaegisub/fs.h>
 
+#include <atomic>
+#include <exception>
+#include <thread>
+
 DEFINE_EXCEPTION(AssParseError, SubtitleFormatParseError);
 
 void AssSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
@@ -40,6 +44,7 @@ void AssSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename,
 	AssParser parser(target, version);
 	while (file.HasMoreLines())
 		parser.AddLine(file.ReadLineFromFile());
+	parser.Finish();
 }
 
 #ifdef _WIN32
@@ -57,9 +62,55 @@ const char *format(AssEntryGroup group) {
 	return nullptr;
 }
 
+/// Number of lines serialized together into one block of text
+const size_t lines_per_block = 2048;
+
+/// Serialize lines into blocks of text, each line followed by a line break,
+/// using as many threads as are useful
+std::vector<std::string> serialize(std::vector<const AssDialogue *> const& lines) {
+	std::vector<std::string> blocks((lines.size() + lines_per_block - 1) / lines_per_block);
+	std::atomic<size_t> next_block{0};
+	std::exception_ptr error;
+	std::atomic<bool> failed{false};
+
+	auto worker = [&] {
+		try {
+			for (size_t i; !failed && (i = next_block++) < blocks.size(); ) {
+				size_t end = std::min(lines.size(), (i + 1) * lines_per_block);
+				auto& block = blocks[i];
+				for (size_t j = i * lines_per_block; j < end; ++j) {
+					block += lines[j]->GetEntryData();
+					block += LINEBREAK;
+				}
+			}
+		}
+		catch (...) {
+			if (!failed.exchange(true))
+				error = std::current_exception();
+		}
+	};
+
+	size_t threads = std::min<size_t>(std::thread::hardware_concurrency(), blocks.size());
+	if (threads < 2)
+		worker();
+	else {
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < threads; ++i)
+			workers.emplace_back(worker);
+		for (auto& thread : workers)
+			thread.join();
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+	return blocks;
+}
+
 struct Writer {
 	TextFileWriter file;
 	AssEntryGroup group = AssEntryGroup::INFO;
+	/// Reused for each line so that serializing them doesn't allocate
+	std::string line_data;
 
 	Writer(agi::fs::path const& filename, std::string const& encoding)
 	: file(filename, encoding)
@@ -69,22 +120,52 @@ struct Writer {
 		file.WriteLineToFile("; http://www.aegisub.org/");
 	}
 
+	void StartGroup(AssEntry const& line) {
+		if (line.Group() == group) return;
+
+		// Add a blank line between each group
+		file.WriteLineToFile("");
+
+		file.WriteLineToFile(line.GroupHeader());
+		if (const char *str = format(line.Group()))
+			file.WriteLineToFile(str, false);
+
+		group = line.Group();
+	}
+
+	// Styles and attachments keep their serialized form around, so only the
+	// info lines have to be built
+	void WriteEntry(AssInfo const& line) {
+		line_data.clear();
+		line.AppendEntryData(line_data);
+		file.WriteLineToFile(line_data);
+	}
+
+	template<typename T>
+	void WriteEntry(T const& line) {
+		file.WriteLineToFile(line.GetEntryData());
+	}
+
 	template<typename T>
 	void Write(T const& list) {
 		for (auto const& line : list) {
-			if (line.Group() != group) {
-				// Add a blank line between each group
-				file.WriteLineToFile("");
+			StartGroup(line);
+			WriteEntry(line);
+		}
+	}
 
-				file.WriteLineToFile(line.GroupHeader());
-				if (const char *str = format(line.Group()))
-					file.WriteLineToFile(str, false);
+	void Write(EntryList<AssDialogue> const& events) {
+		if (events.empty()) return;
 
-				group = line.Group();
-			}
+		// Serializing lines is most of the time spent saving large files, so
+		// do it in parallel and then convert and write big blocks at a time
+		std::vector<const AssDialogue *> lines;
+		for (auto const& line : events)
+			lines.push_back(&line);
 
-			file.WriteLineToFile(line.GetEntryData());
-		}
+		StartGroup(events.front());
+		for (auto const& block : serialize(lines))
+			file.WriteLineToFile(block, false);
 	}
 
 	void Write(ProjectProperties const& properties) {
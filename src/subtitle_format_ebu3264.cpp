@@ -119,14 +119,24 @@ namespace
 		{
 			for (auto const& t : ob->Tags)
 			{
-				if (t.Name == "\\u")
-					underline = t.Params[0].Get<bool>(style_underline);
-				else if (t.Name == "\\i")
-					italic = t.Params[0].Get<bool>(style_italic);
-				else if (t.Name == "\\an")
-					align = t.Params[0].Get<int>(align);
-				else if (t.Name == "\\a" && !t.Params[0].omitted)
-					align = AssStyle::SsaToAss(t.Params[0].Get<int>());
+				switch (t.Id)
+				{
+					case AssTagId::U:
+						underline = t.Params[0].Get<bool>(style_underline);
+						break;
+					case AssTagId::I:
+						italic = t.Params[0].Get<bool>(style_italic);
+						break;
+					case AssTagId::AN:
+						align = t.Params[0].Get<int>(align);
+						break;
+					case AssTagId::A:
+						if (!t.Params[0].omitted)
+							align = AssStyle::SsaToAss(t.Params[0].Get<int>());
+						break;
+					default:
+						break;
+				}
 			}
 		}
 
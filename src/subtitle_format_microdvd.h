@@ -34,6 +34,8 @@
 
 #include "subtitle_format.h"
 
+#include <libaegisub/vfr.h>
+
 class MicroDVDSubtitleFormat final : public SubtitleFormat {
 public:
 	MicroDVDSubtitleFormat();
@@ -43,6 +45,9 @@ public:
 
 	bool CanReadFile(agi::fs::path const& filename, std::string const& encoding) const override;
 	void ReadFile(AssFile *target, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& forceEncoding) const override;
+	/// Files which don't start with their frame rate need one from somewhere
+	bool NeedsUserInputToRead(agi::vfr::Framerate const& fps) const override { return !fps.IsLoaded(); }
 
 	void WriteFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const override;
+	bool NeedsUserInput() const override { return true; }
 };
@@ -454,19 +454,21 @@ bool SRTSubtitleFormat::CanSave(const AssFile *file) const {
 	if (!file->Attachments.empty())
 		return false;
 
-	auto def = boost::flyweight<std::string>("Default");
+	auto def = agi::StringFlyweight("Default");
 	for (auto const& line : file->Events) {
 		if (line.Style != def)
 			return false;
 
-		auto blocks = line.ParseTags();
-		for (auto ovr : blocks | agi::of_type<AssDialogueBlockOverride>()) {
+		auto blocks = line.ParsedTags();
+		for (auto ovr : *blocks | agi::of_type<AssDialogueBlockOverride>()) {
 			// Verify that all overrides used are supported
 			for (auto const& tag : ovr->Tags) {
-				if (tag.Name.size() != 2)
-					return false;
-				if (!strchr("bisu", tag.Name[1]))
-					return false;
+				switch (tag.Id) {
+					case AssTagId::B: case AssTagId::I: case AssTagId::S: case AssTagId::U:
+						break;
+					default:
+						return false;
+				}
 			}
 		}
 	}
@@ -475,23 +477,23 @@ bool SRTSubtitleFormat::CanSave(const AssFile *file) const {
 }
 
 std::string SRTSubtitleFormat::ConvertTags(const AssDialogue *diag) const {
-	struct tag_state { char tag; bool value; };
+	struct tag_state { AssTagId id; char tag; bool value; };
 	tag_state tag_states[] = {
-		{'b', false},
-		{'i', false},
-		{'s', false},
-		{'u', false}
+		{AssTagId::B, 'b', false},
+		{AssTagId::I, 'i', false},
+		{AssTagId::S, 's', false},
+		{AssTagId::U, 'u', false}
 	};
 
 	std::string final;
-	for (auto& block : diag->ParseTags()) {
+	for (auto& block : *diag->ParsedTags()) {
 		switch (block->GetType()) {
 		case AssBlockType::OVERRIDE:
-			for (auto const& tag : static_cast<AssDialogueBlockOverride&>(*block).Tags) {
-				if (!tag.IsValid() || tag.Name.size() != 2)
+			for (auto const& tag : static_cast<const AssDialogueBlockOverride&>(*block).Tags) {
+				if (!tag.IsValid())
 					continue;
 				for (auto& state : tag_states) {
-					if (state.tag != tag.Name[1]) continue;
+					if (state.id != tag.Id) continue;
 
 					bool temp = tag.Params[0].Get(false);
 					if (temp && !state.value)
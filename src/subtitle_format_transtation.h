@@ -39,4 +39,5 @@ public:
 	TranStationSubtitleFormat();
 	std::vector<std::string> GetWriteWildcards() const override;
 	void WriteFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const override;
+	bool NeedsUserInput() const override { return true; }
 };
@@ -40,11 +40,229 @@
 #include "options.h"
 
 #include <libaegisub/ass/time.h>
+#include <libaegisub/charset_conv.h>
+#include <libaegisub/file_mapping.h>
 
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <algorithm>
+#include <cstring>
 #include <wx/xml/xml.h>
 
 DEFINE_EXCEPTION(TTXTParseError, SubtitleFormatParseError);
 
+namespace {
+/// @brief Pull parser for the parts of XML which TTXT files use
+///
+/// TTXT files have one element per line, so rather than building a document
+/// tree of the whole file this reads the elements one at a time straight
+/// out of the mapped file.
+class XmlScanner {
+	const char *pos;
+	const char *end;
+
+	[[noreturn]] static void Fail() {
+		throw TTXTParseError("Failed loading TTXT XML file.");
+	}
+
+	/// Skip past the next occurrence of str
+	void SkipPast(const char *str) {
+		size_t len = strlen(str);
+		for (; end - pos >= (ptrdiff_t)len; ++pos) {
+			if (!memcmp(pos, str, len)) {
+				pos += len;
+				return;
+			}
+		}
+		Fail();
+	}
+
+	static bool IsSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+public:
+	struct Token {
+		enum Type { START, END, TEXT, CDATA, DONE } type = DONE;
+		/// Element name for START and END, or the undecoded text for TEXT and CDATA
+		const char *begin = nullptr;
+		const char *end = nullptr;
+		/// Undecoded attributes of START
+		const char *attr_begin = nullptr;
+		const char *attr_end = nullptr;
+		/// Is a START element self closing?
+		bool empty = false;
+
+		bool Is(const char *name) const {
+			return (size_t)(end - begin) == strlen(name) && !memcmp(begin, name, end - begin);
+		}
+
+		bool IsWhitespace() const {
+			return std::all_of(begin, end, IsSpace);
+		}
+
+		std::string Text() const {
+			return type == CDATA ? std::string(begin, end) : Decode(begin, end);
+		}
+
+		/// Get the decoded value of an attribute of a START token
+		std::string Attribute(const char *name, std::string const& def) const {
+			size_t name_len = strlen(name);
+			for (const char *p = attr_begin; p != attr_end; ) {
+				while (p != attr_end && IsSpace(*p)) ++p;
+				const char *name_begin = p;
+				while (p != attr_end && *p != '=' && !IsSpace(*p)) ++p;
+				const char *name_end = p;
+				while (p != attr_end && IsSpace(*p)) ++p;
+				if (p == attr_end || *p != '=') break;
+				++p;
+				while (p != attr_end && IsSpace(*p)) ++p;
+				if (p == attr_end || (*p != '"' && *p != '\'')) Fail();
+				char quote = *p++;
+				const char *value_begin = p;
+				while (p != attr_end && *p != quote) ++p;
+				if (p == attr_end) Fail();
+				const char *value_end = p++;
+
+				if ((size_t)(name_end - name_begin) == name_len && !memcmp(name_begin, name, name_len))
+					return Decode(value_begin, value_end);
+			}
+			return def;
+		}
+	};
+
+	XmlScanner(const char *begin, const char *end) : pos(begin), end(end) {
+		if (end - pos >= 3 && !memcmp(pos, "\xEF\xBB\xBF", 3))
+			pos += 3;
+	}
+
+	/// Replace the entity and character references in some text
+	static std::string Decode(const char *begin, const char *end) {
+		std::string ret;
+		ret.reserve(end - begin);
+		while (begin != end) {
+			auto amp = static_cast<const char *>(memchr(begin, '&', end - begin));
+			if (!amp) amp = end;
+			ret.append(begin, amp);
+			if (amp == end) break;
+
+			auto semi = static_cast<const char *>(memchr(amp, ';', end - amp));
+			if (!semi) Fail();
+			std::string entity(amp + 1, semi);
+			begin = semi + 1;
+
+			if (entity == "amp") ret += '&';
+			else if (entity == "lt") ret += '<';
+			else if (entity == "gt") ret += '>';
+			else if (entity == "quot") ret += '"';
+			else if (entity == "apos") ret += '\'';
+			else if (entity.size() > 1 && entity[0] == '#') {
+				char *parse_end;
+				unsigned long c = entity[1] == 'x'
+					? strtoul(entity.c_str() + 2, &parse_end, 16)
+					: strtoul(entity.c_str() + 1, &parse_end, 10);
+				if (*parse_end || c == 0 || c > 0x10FFFF) Fail();
+				// Encode the code point as UTF-8
+				if (c < 0x80)
+					ret += (char)c;
+				else if (c < 0x800) {
+					ret += (char)(0xC0 | (c >> 6));
+					ret += (char)(0x80 | (c & 0x3F));
+				}
+				else if (c < 0x10000) {
+					ret += (char)(0xE0 | (c >> 12));
+					ret += (char)(0x80 | ((c >> 6) & 0x3F));
+					ret += (char)(0x80 | (c & 0x3F));
+				}
+				else {
+					ret += (char)(0xF0 | (c >> 18));
+					ret += (char)(0x80 | ((c >> 12) & 0x3F));
+					ret += (char)(0x80 | ((c >> 6) & 0x3F));
+					ret += (char)(0x80 | (c & 0x3F));
+				}
+			}
+			else
+				Fail();
+		}
+		return ret;
+	}
+
+	/// Read the next element tag or piece of text, skipping comments,
+	/// processing instructions and doctype declarations
+	Token Next() {
+		Token tok;
+		while (pos != end) {
+			if (*pos != '<') {
+				tok.type = Token::TEXT;
+				tok.begin = pos;
+				pos = static_cast<const char *>(memchr(pos, '<', end - pos));
+				if (!pos) pos = end;
+				tok.end = pos;
+				return tok;
+			}
+
+			if (end - pos >= 4 && !memcmp(pos, "<!--", 4)) {
+				pos += 4;
+				SkipPast("-->");
+				continue;
+			}
+			if (end - pos >= 9 && !memcmp(pos, "<![CDATA[", 9)) {
+				tok.type = Token::CDATA;
+				tok.begin = pos += 9;
+				SkipPast("]]>");
+				tok.end = pos - 3;
+				return tok;
+			}
+			if (end - pos >= 2 && (pos[1] == '?' || pos[1] == '!')) {
+				if (pos[1] == '?') {
+					SkipPast("?>");
+					continue;
+				}
+				// Doctype declarations may have an internal subset in brackets
+				for (++pos; pos != end && *pos != '>'; ) {
+					if (*pos++ == '[') SkipPast("]");
+				}
+				if (pos == end) Fail();
+				++pos;
+				continue;
+			}
+
+			++pos;
+			tok.type = Token::START;
+			if (pos != end && *pos == '/') {
+				tok.type = Token::END;
+				++pos;
+			}
+			tok.begin = pos;
+			while (pos != end && *pos != '>' && *pos != '/' && !IsSpace(*pos)) ++pos;
+			tok.end = pos;
+			if (tok.begin == tok.end) Fail();
+
+			// Find the end of the tag, skipping over quoted attribute values
+			tok.attr_begin = pos;
+			char quote = 0;
+			for (; pos != end; ++pos) {
+				if (quote) {
+					if (*pos == quote) quote = 0;
+				}
+				else if (*pos == '"' || *pos == '\'')
+					quote = *pos;
+				else if (*pos == '>')
+					break;
+			}
+			if (pos == end) Fail();
+			tok.attr_end = pos++;
+			if (tok.attr_end != tok.attr_begin && tok.attr_end[-1] == '/') {
+				tok.empty = true;
+				--tok.attr_end;
+			}
+			return tok;
+		}
+		return tok;
+	}
+};
+}
+
 TTXTSubtitleFormat::TTXTSubtitleFormat()
 : SubtitleFormat("MPEG-4 Streaming Text")
 {
@@ -61,38 +279,82 @@ std::vector<std::string> TTXTSubtitleFormat::GetWriteWildcards() const {
 void TTXTSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
 	target->LoadDefault(false, OPT_GET("Subtitle Format/TTXT/Default Style Catalog")->GetString());
 
-	// Load XML document
-	wxXmlDocument doc;
-	if (!doc.Load(filename.wstring())) throw TTXTParseError("Failed loading TTXT XML file.");
+	auto file = agi::open_read_mapping(filename);
+	const char *data = file->size() ? file->read() : "";
+	size_t size = file->size();
+
+	// The scanner only understands UTF-8, so anything else is converted first
+	std::string converted;
+	auto charset = boost::to_lower_copy(encoding);
+	if (!charset.empty() && charset != "utf-8" && charset != "ascii" && charset != "us-ascii") {
+		converted = agi::charset::IconvWrapper(charset.c_str(), "utf-8").Convert(data, size);
+		data = converted.data();
+		size = converted.size();
+	}
+
+	XmlScanner xml(data, data + size);
+	using Token = XmlScanner::Token;
 
 	// Check root node name
-	if (doc.GetRoot()->GetName() != "TextStream") throw TTXTParseError("Invalid TTXT file.");
+	Token tok;
+	do tok = xml.Next(); while (tok.type == Token::TEXT && tok.IsWhitespace());
+	if (tok.type != Token::START || !tok.Is("TextStream")) throw TTXTParseError("Invalid TTXT file.");
 
 	// Check version
-	wxString verStr = doc.GetRoot()->GetAttribute("version", "");
+	std::string verStr = tok.Attribute("version", "");
 	int version = -1;
 	if (verStr == "1.0")
 		version = 0;
 	else if (verStr == "1.1")
 		version = 1;
 	else
-		throw TTXTParseError("Unknown TTXT version: " + from_wx(verStr));
+		throw TTXTParseError("Unknown TTXT version: " + verStr);
 
-	// Get children
+	// Read the children of the root, each line being added as soon as it's read
 	AssDialogue *diag = nullptr;
 	int lines = 0;
-	for (wxXmlNode *child = doc.GetRoot()->GetChildren(); child; child = child->GetNext()) {
+	for (int depth = tok.empty ? 0 : 1; depth > 0; ) {
+		tok = xml.Next();
+		if (tok.type == Token::DONE) throw TTXTParseError("Failed loading TTXT XML file.");
+		if (tok.type == Token::END) {
+			--depth;
+			continue;
+		}
+		if (tok.type != Token::START) continue;
+
 		// Line
-		if (child->GetName() == "TextSample") {
-			if ((diag = ProcessLine(child, diag, version))) {
+		if (depth == 1 && tok.Is("TextSample")) {
+			std::string sample_time = tok.Attribute("sampleTime", "00:00:00.000");
+			std::string text;
+			if (version == 0)
+				text = tok.Attribute("text", "");
+
+			// Like wxXmlNode::GetNodeContent, the content is the first piece
+			// of text directly inside the element which isn't just whitespace
+			if (!tok.empty) {
+				bool found = false;
+				for (int inner = 1; inner > 0; ) {
+					auto child = xml.Next();
+					if (child.type == Token::DONE) throw TTXTParseError("Failed loading TTXT XML file.");
+					if (child.type == Token::START && !child.empty) ++inner;
+					else if (child.type == Token::END) --inner;
+					else if (inner == 1 && !found && version == 1) {
+						if (child.type == Token::CDATA || (child.type == Token::TEXT && !child.IsWhitespace())) {
+							text = child.Text();
+							found = true;
+						}
+					}
+				}
+			}
+
+			if ((diag = ProcessLine(sample_time, std::move(text), diag, version))) {
 				lines++;
 				target->Events.push_back(*diag);
 			}
 		}
-		// Header
-		else if (child->GetName() == "TextStreamHeader") {
-			ProcessHeader(child);
-		}
+		// Everything else, including the header, is skipped
+		else if (!tok.empty)
+			++depth;
 	}
 
 	// No lines?
@@ -100,22 +362,14 @@ void TTXTSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename
 		target->Events.push_back(*new AssDialogue);
 }
 
-AssDialogue *TTXTSubtitleFormat::ProcessLine(wxXmlNode *node, AssDialogue *prev, int version) const {
+AssDialogue *TTXTSubtitleFormat::ProcessLine(std::string const& sample_time, std::string text, AssDialogue *prev, int version) const {
 	// Get time
-	wxString sampleTime = node->GetAttribute("sampleTime", "00:00:00.000");
-	agi::Time time(from_wx(sampleTime));
+	agi::Time time(sample_time);
 
 	// Set end time of last line
 	if (prev)
 		prev->End = time;
 
-	// Get text
-	wxString text;
-	if (version == 0)
-		text = node->GetAttribute("text", "");
-	else
-		text = node->GetNodeContent();
-
 	// Create line
 	if (text.empty()) return nullptr;
 
@@ -126,7 +380,7 @@ AssDialogue *TTXTSubtitleFormat::ProcessLine(wxXmlNode *node, AssDialogue *prev,
 
 	// Process text for 1.0
 	if (version == 0) {
-		wxString finalText;
+		std::string finalText;
 		finalText.reserve(text.size());
 		bool in = false;
 		bool first = true;
@@ -138,23 +392,19 @@ AssDialogue *TTXTSubtitleFormat::ProcessLine(wxXmlNode *node, AssDialogue *prev,
 			}
 			else if (in) finalText += chr;
 		}
-		diag->Text = from_wx(finalText);
+		diag->Text = finalText;
 	}
 
 	// Process text for 1.1
 	else {
-		text.Replace("\r", "");
-		text.Replace("\n", "\\N");
-		diag->Text = from_wx(text);
+		boost::replace_all(text, "\r", "");
+		boost::replace_all(text, "\n", "\\N");
+		diag->Text = text;
 	}
 
 	return diag;
 }
 
-void TTXTSubtitleFormat::ProcessHeader(wxXmlNode *node) const {
-	// TODO
-}
-
 void TTXTSubtitleFormat::WriteFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
 	// Convert to TTXT
 	AssFile copy(*src);
@@ -38,8 +38,7 @@ class AssDialogue;
 class wxXmlNode;
 
 class TTXTSubtitleFormat final : public SubtitleFormat {
-	AssDialogue *ProcessLine(wxXmlNode *node, AssDialogue *prev, int version) const;
-	void ProcessHeader(wxXmlNode *node) const;
+	AssDialogue *ProcessLine(std::string const& sample_time, std::string text, AssDialogue *prev, int version) const;
 
 	void WriteHeader(wxXmlNode *root) const;
 	void WriteLine(wxXmlNode *root, const AssDialogue *prev, const AssDialogue *line) const;
@@ -36,14 +36,25 @@
 
 #include "ass_dialogue.h"
 #include "ass_file.h"
+#include "dialog_progress.h"
 #include "dialogs.h"
 #include "options.h"
 #include "text_file_reader.h"
 #include "text_file_writer.h"
 #include "version.h"
 
+#include <libaegisub/exception.h>
+
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <exception>
+
+namespace {
+/// Number of lines read between progress updates
+const size_t import_batch_size = 1000;
+/// Files smaller than this many bytes are imported without a progress dialog
+const uint64_t progress_threshold = 8 * 1024 * 1024;
+}
 
 TXTSubtitleFormat::TXTSubtitleFormat()
 : SubtitleFormat("Plain-Text")
@@ -73,50 +84,93 @@ void TXTSubtitleFormat::ReadFile(AssFile *target, agi::fs::path const& filename,
 	std::string actor;
 	std::string separator = OPT_GET("Tool/Import/Text/Actor Separator")->GetString();
 	std::string comment = OPT_GET("Tool/Import/Text/Comment Starter")->GetString();
+	bool include_blank = OPT_GET("Tool/Import/Text/Include Blank")->GetBool();
 
 	// Parse file
-	while (file.HasMoreLines()) {
-		std::string value = file.ReadLineFromFile();
-		if (value.empty() && !OPT_GET("Tool/Import/Text/Include Blank")->GetBool()) continue;
-
-		// Check if this isn't a timecodes file
-		if (boost::starts_with(value, "# timecode"))
-			throw SubtitleFormatParseError("File is a timecode file, cannot load as subtitles.");
-
-		// Read comment data
-		bool isComment = false;
-		if (!comment.empty() && boost::starts_with(value, comment)) {
-			isComment = true;
-			value.erase(0, comment.size());
-		}
+	auto parse = [&](agi::ProgressSink *ps) {
+		// Lines are collected into a batch which is appended to the file
+		// each time progress is reported
+		EntryList<AssDialogue> batch;
+		size_t batch_lines = 0;
+		auto flush = [&] {
+			target->Events.splice(target->Events.end(), batch);
+			batch_lines = 0;
+			if (ps) {
+				if (ps->IsCancelled()) throw agi::UserCancelException("Text import cancelled");
+				ps->SetProgress(file.Position(), file.Size());
+			}
+		};
+
+		while (file.HasMoreLines()) {
+			std::string value = file.ReadLineFromFile();
+			if (value.empty() && !include_blank) continue;
+
+			// Check if this isn't a timecodes file
+			if (boost::starts_with(value, "# timecode"))
+				throw SubtitleFormatParseError("File is a timecode file, cannot load as subtitles.");
+
+			// Read comment data
+			bool isComment = false;
+			if (!comment.empty() && boost::starts_with(value, comment)) {
+				isComment = true;
+				value.erase(0, comment.size());
+			}
 
-		// Read actor data
-		if (!isComment && !separator.empty() && !value.empty()) {
-			if (value[0] != ' ' && value[0] != '\t') {
-				size_t pos = value.find(separator);
-				if (pos != std::string::npos) {
-					actor = value.substr(0, pos);
-					boost::trim(actor);
-					value.erase(0, pos + 1);
+			// Read actor data
+			if (!isComment && !separator.empty() && !value.empty()) {
+				if (value[0] != ' ' && value[0] != '\t') {
+					size_t pos = value.find(separator);
+					if (pos != std::string::npos) {
+						actor = value.substr(0, pos);
+						boost::trim(actor);
+						value.erase(0, pos + 1);
+					}
 				}
 			}
-		}
 
-		// Trim spaces at start
-		boost::trim_left(value);
+			// Trim spaces at start
+			boost::trim_left(value);
 
-		if (value.empty())
-			isComment = true;
+			if (value.empty())
+				isComment = true;
 
-		// Sets line up
-		auto line = new AssDialogue;
-		line->Actor = isComment ? std::string() : actor;
-		line->Comment = isComment;
-		line->Text = value;
-		line->End = 0;
+			// Sets line up
+			auto line = new AssDialogue;
+			line->Actor = isComment ? std::string() : actor;
+			line->Comment = isComment;
+			line->Text = value;
+			line->End = 0;
+
+			batch.push_back(*line);
+			if (++batch_lines == import_batch_size)
+				flush();
+		}
+		flush();
+	};
 
-		target->Events.push_back(*line);
+	// Small files load faster than the progress dialog can be shown
+	if (file.Size() < progress_threshold) {
+		parse(nullptr);
+		return;
 	}
+
+	// DialogProgress only logs errors thrown by the task, so carry them
+	// over to this thread to report them like any other parse error
+	std::exception_ptr error;
+	DialogProgress progress(nullptr, _("Importing"), _("Reading plain text file."));
+	progress.Run([&](agi::ProgressSink *ps) {
+		try {
+			parse(ps);
+		}
+		catch (agi::UserCancelException const&) {
+			throw;
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+	});
+	if (error)
+		std::rethrow_exception(error);
 }
 
 void TXTSubtitleFormat::WriteFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const {
@@ -139,8 +193,9 @@ void TXTSubtitleFormat::WriteFile(const AssFile *src, agi::fs::path const& filen
 	file.WriteLineToFile(std::string("# Exported by Aegisub ") + GetAegisubShortVersionString());
 
 	// Write the file
+	std::string out_line;
 	for (auto const& dia : src->Events) {
-		std::string out_line;
+		out_line.clear();
 
 		if (dia.Comment)
 			out_line = "# ";
@@ -148,10 +203,13 @@ void TXTSubtitleFormat::WriteFile(const AssFile *src, agi::fs::path const& filen
 		if (write_actors)
 			out_line += dia.Actor.get() + ": ";
 
-		std::string out_text = strip_formatting ? dia.GetStrippedText() : dia.Text;
-		out_line += out_text;
+		size_t text_start = out_line.size();
+		if (strip_formatting)
+			dia.AppendStrippedText(out_line);
+		else
+			out_line += dia.Text.get();
 
-		if (!out_text.empty())
+		if (out_line.size() != text_start)
 			file.WriteLineToFile(out_line);
 	}
 }
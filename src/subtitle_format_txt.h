@@ -45,5 +45,6 @@ public:
 
 	bool CanWriteFile(agi::fs::path const& filename) const override;
 	void ReadFile(AssFile *target, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& forceEncoding) const override;
+	bool NeedsUserInputToRead(agi::vfr::Framerate const&) const override { return true; }
 	void WriteFile(const AssFile *src, agi::fs::path const& filename, agi::vfr::Framerate const& fps, std::string const& encoding) const override;
 };
@@ -26,6 +26,8 @@
 #include "subtitles_provider_csri.h"
 #include "subtitles_provider_libass.h"
 
+#include <libaegisub/make_unique.h>
+
 namespace {
 	struct factory {
 		std::string name;
@@ -68,8 +70,45 @@ std::unique_ptr<SubtitlesProvider> SubtitlesProviderFactory::GetProvider(agi::Ba
 	throw error;
 }
 
-void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
-	buffer.clear();
+struct SubtitlesProvider::LoadedSections {
+	/// Script Info section
+	std::string info;
+	/// Styles section
+	std::string styles;
+	/// Font attachments, kept alive so that their data can be compared by address
+	std::vector<AssAttachment> fonts;
+	/// Did the provider take the fonts, so that they aren't sent with the file?
+	bool fonts_loaded = false;
+
+	bool SameFonts(AssFile const& subs) const {
+		auto it = fonts.begin();
+		for (auto const& attachment : subs.Attachments) {
+			if (attachment.Group() != AssEntryGroup::FONT) continue;
+			if (it == fonts.end()) return false;
+			auto const& old_data = it->GetEntryData();
+			auto const& new_data = attachment.GetEntryData();
+			if (&old_data != &new_data && old_data != new_data) return false;
+			++it;
+		}
+		return it == fonts.end();
+	}
+};
+
+SubtitlesProvider::SubtitlesProvider() = default;
+SubtitlesProvider::~SubtitlesProvider() = default;
+
+void SubtitlesProvider::LoadSubtitles(const AssFile *subs, int time) {
+	std::string info = "\xEF\xBB\xBF[Script Info]\n";
+	for (auto const& line : subs->Info) {
+		line.AppendEntryData(info);
+		info += '\n';
+	}
+
+	std::string styles = "[V4+ Styles]\n";
+	for (auto const& line : subs->Styles) {
+		line.AppendEntryData(styles);
+		styles += '\n';
+	}
 
 	auto push_header = [&](const char *str) {
 		buffer.insert(buffer.end(), str, str + strlen(str));
@@ -78,31 +117,75 @@ void SubtitlesProvider::LoadSubtitles(AssFile *subs, int time) {
 		buffer.insert(buffer.end(), &str[0], &str[0] + str.size());
 		buffer.push_back('\n');
 	};
-
-	push_header("\xEF\xBB\xBF[Script Info]\n");
-	for (auto const& line : subs->Info)
+	// Lines keep their serialized form from the previous load (or save) if
+	// they haven't changed since, so only the edited ones are rebuilt
+	auto push_event = [&](AssDialogue const& line) {
 		push_line(line.GetEntryData());
+	};
+	auto push_events = [&] {
+		push_header("[Events]\n");
+		if (time < 0) {
+			for (auto const& line : subs->Events) {
+				if (!line.Comment)
+					push_event(line);
+			}
+		}
+		else {
+			for (auto line : subs->EventsAt(time)) {
+				if (!line->Comment)
+					push_event(*line);
+			}
+		}
+	};
 
-	push_header("[V4+ Styles]\n");
-	for (auto const& line : subs->Styles)
-		push_line(line.GetEntryData());
+	// Most commits only touch the events, in which case the provider can
+	// keep everything else from the last load rather than reparsing the
+	// styles and decoding every embedded font again. Style edits can
+	// usually be applied to the loaded file as well.
+	buffer.clear();
+	bool same_fonts = loaded && loaded->SameFonts(*subs);
+	if (same_fonts && loaded->info == info) {
+		bool same_styles = loaded->styles == styles;
+		if (!same_styles && LoadStyles(&styles[0], styles.size())) {
+			loaded->styles = styles;
+			same_styles = true;
+		}
+		if (same_styles) {
+			push_events();
+			if (LoadEvents(&buffer[0], buffer.size()))
+				return;
+			buffer.clear();
+		}
+	}
 
-	if (!subs->Attachments.empty()) {
-		// TODO: some scripts may have a lot of attachments, 
-		// so ideally we'd want to write only those actually used on the requested video frame,
-		// but this would require some pre-parsing of the attached font files with FreeType,
-		// which isn't probably trivial.
-		push_header("[Fonts]\n");
-		for (auto const& attachment : subs->Attachments)
+	if (!loaded)
+		loaded = agi::make_unique<LoadedSections>();
+
+	// Decoding the fonts is by far the slowest part of loading a script with
+	// a lot of them, so the provider is given them once rather than having
+	// them in the file every time it's reloaded
+	if (!same_fonts) {
+		loaded->fonts.clear();
+		for (auto const& attachment : subs->Attachments) {
 			if (attachment.Group() == AssEntryGroup::FONT)
-				push_line(attachment.GetEntryData());
+				loaded->fonts.push_back(attachment);
+		}
+		loaded->fonts_loaded = LoadFonts(loaded->fonts);
 	}
 
-	push_header("[Events]\n");
-	for (auto const& line : subs->Events) {
-		if (!line.Comment && (time < 0 || !(line.Start > time || line.End <= time)))
-			push_line(line.GetEntryData());
+	buffer.assign(info.begin(), info.end());
+	buffer.insert(buffer.end(), styles.begin(), styles.end());
+
+	if (!loaded->fonts_loaded && !loaded->fonts.empty()) {
+		push_header("[Fonts]\n");
+		for (auto const& font : loaded->fonts)
+			push_line(font.GetEntryData());
 	}
 
+	push_events();
+
+	loaded->info.clear();
 	LoadSubtitles(&buffer[0], buffer.size());
+	loaded->info = std::move(info);
+	loaded->styles = std::move(styles);
 }
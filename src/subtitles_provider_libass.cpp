@@ -34,25 +34,30 @@
 
 #include "subtitles_provider_libass.h"
 
+#include "ass_attachment.h"
+
 #include "compat.h"
+#include "frame_timings.h"
 #include "include/aegisub/subtitles_provider.h"
 #include "video_frame.h"
 
 #include <libaegisub/background_runner.h>
+#include <libaegisub/blend.h>
 #include <libaegisub/dispatch.h>
 #include <libaegisub/exception.h>
 #include <libaegisub/log.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/util.h>
 
+#include <algorithm>
 #include <atomic>
-#if BOOST_VERSION >= 106900
-#include <boost/gil.hpp>
-#else
-#include <boost/gil/gil_all.hpp>
-#endif
+#include <cstring>
+#include <iterator>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <tuple>
+#include <vector>
 
 #include <wx/intl.h>
 #include <wx/thread.h>
@@ -65,6 +70,27 @@ namespace {
 std::unique_ptr<agi::dispatch::Queue> cache_queue;
 ASS_Library *library;
 
+/// Styles a track can collect from in-place style edits before it's reloaded
+const int max_appended_styles = 1024;
+
+/// Fonts added to the library, by name, size and a hash of the contents.
+/// The library can't remove fonts, and would keep another copy of a font
+/// each time a file using it was loaded.
+std::set<std::tuple<std::string, size_t, uint64_t>> added_fonts;
+std::mutex added_fonts_mutex;
+
+void add_font(std::string const& name, const char *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; ++i)
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+
+	std::lock_guard<std::mutex> lock(added_fonts_mutex);
+	if (!added_fonts.emplace(name, size, hash).second) return;
+	// Renderers pick up fonts added to the library at their next frame
+	ass_add_font(library, const_cast<char *>(name.c_str()),
+		const_cast<char *>(data), (int)size);
+}
+
 void msg_callback(int level, const char *fmt, va_list args, void *) {
 	if (level >= 7) return;
 	char buf[1024];
@@ -88,14 +114,98 @@ struct cache_thread_shared {
 	~cache_thread_shared() { if (renderer) ass_renderer_done(renderer); }
 };
 
+/// Area of a frame, in pixels
+struct Rect {
+	int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+
+	bool Empty() const { return x1 >= x2 || y1 >= y2; }
+
+	void Add(Rect const& r) {
+		if (r.Empty()) return;
+		if (Empty()) { *this = r; return; }
+		x1 = std::min(x1, r.x1);
+		y1 = std::min(y1, r.y1);
+		x2 = std::max(x2, r.x2);
+		y2 = std::max(y2, r.y2);
+	}
+
+	Rect Intersect(Rect const& r) const {
+		Rect ret;
+		ret.x1 = std::max(x1, r.x1);
+		ret.y1 = std::max(y1, r.y1);
+		ret.x2 = std::min(x2, r.x2);
+		ret.y2 = std::min(y2, r.y2);
+		return ret;
+	}
+};
+
+/// What an ASS_Image drew, to tell which images changed between renders
+///
+/// The bitmaps come from libass's caches, where a freed bitmap's memory can
+/// be reused for a different one, so they're identified by their contents
+/// rather than their address.
+struct DrawnImage {
+	Rect area;
+	uint32_t color;
+	uint64_t hash;
+
+	DrawnImage(ASS_Image const& img)
+	: color(img.color)
+	, hash(img.w)
+	{
+		area.x1 = img.dst_x;
+		area.y1 = img.dst_y;
+		area.x2 = img.dst_x + img.w;
+		area.y2 = img.dst_y + img.h;
+
+		for (int y = 0; y < img.h; ++y) {
+			const unsigned char *row = img.bitmap + y * img.stride;
+			int x = 0;
+			for (; x + 8 <= img.w; x += 8) {
+				uint64_t word;
+				memcpy(&word, row + x, 8);
+				hash = (hash ^ word) * 0x100000001b3ULL;
+			}
+			for (; x < img.w; ++x)
+				hash = (hash ^ row[x]) * 0x100000001b3ULL;
+		}
+	}
+
+	std::tuple<int, int, int, int, uint32_t, uint64_t> Key() const {
+		return std::make_tuple(area.x1, area.y1, area.x2, area.y2, color, hash);
+	}
+	bool operator<(DrawnImage const& other) const { return Key() < other.Key(); }
+};
+
 class LibassSubtitlesProvider final : public SubtitlesProvider {
 	agi::BackgroundRunner *br;
 	std::shared_ptr<cache_thread_shared> shared;
 	ASS_Track* ass_track = nullptr;
 
+	/// Images drawn by the last render, sorted
+	std::vector<DrawnImage> drawn;
+	/// Size of the frame drawn onto by the last render, or 0 if there wasn't one
+	int drawn_width = 0;
+	int drawn_height = 0;
+
+	/// Fonts given to AddFont before the renderer was set up, as the library's
+	/// fonts can't be added to while a renderer is loading them
+	std::vector<std::pair<std::string, std::vector<char>>> pending_fonts;
+
+	/// Blend the part of an image inside clip onto the frame
+	static void Blend(VideoFrame &frame, ASS_Image const& img, Rect const& clip);
+
+	void AddPendingFonts() {
+		for (auto const& font : pending_fonts)
+			add_font(font.first, font.second.data(), font.second.size());
+		pending_fonts.clear();
+	}
+
 	ASS_Renderer *renderer() {
-		if (shared->ready)
+		if (shared->ready) {
+			AddPendingFonts();
 			return shared->renderer;
+		}
 
 		auto block = [&] {
 			if (shared->ready)
@@ -116,6 +226,8 @@ class LibassSubtitlesProvider final : public SubtitlesProvider {
 			block();
 		else
 			agi::dispatch::Main().Sync(block);
+		if (shared->ready)
+			AddPendingFonts();
 		return shared->renderer;
 	}
 
@@ -129,13 +241,51 @@ public:
 		if (!ass_track) throw agi::InternalError("libass failed to load subtitles.");
 	}
 
+	bool LoadEvents(const char *data, size_t len) override {
+		if (!ass_track) return false;
+		// The track keeps its styles and fonts, and the renderer its caches
+		// of the glyphs and bitmaps for them
+		ass_flush_events(ass_track);
+		ass_process_data(ass_track, const_cast<char *>(data), (int)len);
+		return true;
+	}
+
+	bool LoadStyles(const char *data, size_t len) override {
+		// Styles can't be removed from a track, so the new ones are added
+		// after the old ones, which libass looks names up from the end of.
+		// Each edit adds all of them again, so eventually start over.
+		if (!ass_track || ass_track->n_styles > max_appended_styles) return false;
+		ass_process_codec_private(ass_track, const_cast<char *>(data), (int)len);
+		return true;
+	}
+
+	bool LoadFonts(std::vector<AssAttachment> const& fonts) override {
+		for (auto const& font : fonts) {
+			auto const& data = font.GetData();
+			AddFont(font.GetFileName(), data.data(), data.size());
+		}
+		return true;
+	}
+
+	void AddFont(std::string const& name, const char *data, size_t size) override {
+		if (shared->ready)
+			add_font(name, data, size);
+		else
+			pending_fonts.emplace_back(name, std::vector<char>(data, data + size));
+	}
+
 	void DrawSubtitles(VideoFrame &dst, double time) override;
+	bool RedrawSubtitles(VideoFrame &dst, VideoFrame const* clean, double time) override;
+	bool CanDrawOverlay() const override { return true; }
 
 	void Reinitialize() override {
 		// No need to reinit if we're not even done with the initial init
 		if (!shared->ready)
 			return;
 
+		// The new renderer has nothing to compare its first render against
+		drawn_width = drawn_height = 0;
+
 		ass_renderer_done(shared->renderer);
 		shared->renderer = ass_renderer_init(library);
 		ass_set_font_scale(shared->renderer, 1.);
@@ -168,41 +318,102 @@ LibassSubtitlesProvider::~LibassSubtitlesProvider() {
 #define _b(c) (((c)>>8)&0xFF)
 #define _a(c) ((c)&0xFF)
 
+void LibassSubtitlesProvider::Blend(VideoFrame &frame, ASS_Image const& img, Rect const& clip) {
+	Rect area;
+	area.x1 = img.dst_x;
+	area.y1 = img.dst_y;
+	area.x2 = img.dst_x + img.w;
+	area.y2 = img.dst_y + img.h;
+	area = area.Intersect(clip);
+	if (area.Empty()) return;
+
+	const ptrdiff_t stride = frame.flipped ? -(ptrdiff_t)frame.pitch : frame.pitch;
+	unsigned char *origin = frame.data.data() + (frame.flipped ? (frame.height - 1) * frame.pitch : 0);
+
+	unsigned int opacity = 255 - ((unsigned int)_a(img.color));
+	uint32_t color = (_r(img.color) << 16) | (_g(img.color) << 8) | _b(img.color);
+
+	agi::BlendMask(origin + area.y1 * stride + area.x1 * 4, stride,
+		img.bitmap + (area.y1 - img.dst_y) * img.stride + (area.x1 - img.dst_x), img.stride,
+		area.x2 - area.x1, area.y2 - area.y1, color, opacity);
+}
+
 void LibassSubtitlesProvider::DrawSubtitles(VideoFrame &frame,double time) {
 	ass_set_frame_size(renderer(), frame.width, frame.height);
+	// Reduced resolution frames still have to be laid out like the full video
+	ass_set_storage_size(renderer(),
+		frame.full_width ? frame.full_width : frame.width,
+		frame.full_height ? frame.full_height : frame.height);
 
 	ASS_Image* img = ass_render_frame(renderer(), ass_track, int(time * 1000), nullptr);
 
 	// libass actually returns several alpha-masked monochrome images.
 	// Here, we loop through their linked list, get the colour of the current, and blend into the frame.
-	// This is repeated for all of them.
-
-	using namespace boost::gil;
-	auto dst = interleaved_view(frame.width, frame.height, (bgra8_pixel_t*)frame.data.data(), frame.width * 4);
-	if (frame.flipped)
-		dst = flipped_up_down_view(dst);
-
+	// This is repeated for all of them. Alpha is blended the same way, so
+	// drawing onto a transparent frame gives a premultiplied overlay.
+	Rect full;
+	full.x2 = frame.width;
+	full.y2 = frame.height;
+
+	StageTimer timer;
+	drawn.clear();
 	for (; img; img = img->next) {
-		unsigned int opacity = 255 - ((unsigned int)_a(img->color));
-		unsigned int r = (unsigned int)_r(img->color);
-		unsigned int g = (unsigned int)_g(img->color);
-		unsigned int b = (unsigned int)_b(img->color);
-
-		auto srcview = interleaved_view(img->w, img->h, (gray8_pixel_t*)img->bitmap, img->stride);
-		auto dstview = subimage_view(dst, img->dst_x, img->dst_y, img->w, img->h);
-
-		transform_pixels(dstview, srcview, dstview, [=](const bgra8_pixel_t frame, const gray8_pixel_t src) -> bgra8_pixel_t {
-			unsigned int k = ((unsigned)src) * opacity / 255;
-			unsigned int ck = 255 - k;
-
-			bgra8_pixel_t ret;
-			ret[0] = (k * b + ck * frame[0]) / 255;
-			ret[1] = (k * g + ck * frame[1]) / 255;
-			ret[2] = (k * r + ck * frame[2]) / 255;
-			ret[3] = 0;
-			return ret;
-		});
+		Blend(frame, *img, full);
+		drawn.emplace_back(*img);
+	}
+	blend_time = timer.Elapsed();
+	sort(begin(drawn), end(drawn));
+	drawn_width = frame.width;
+	drawn_height = frame.height;
+}
+
+bool LibassSubtitlesProvider::RedrawSubtitles(VideoFrame &frame, VideoFrame const* clean, double time) {
+	if (!drawn_width || frame.width != drawn_width || frame.height != drawn_height)
+		return false;
+
+	int changed = 0;
+	blend_time = 0;
+	ASS_Image* images = ass_render_frame(renderer(), ass_track, int(time * 1000), &changed);
+	if (!changed) return true;
+
+	std::vector<DrawnImage> now;
+	for (auto img = images; img; img = img->next)
+		now.emplace_back(*img);
+	sort(begin(now), end(now));
+
+	// Everything under an image which appeared, disappeared or changed has
+	// to be drawn again. Images which are the same in both renders overlap
+	// this area only as much as they have to be blended onto it again.
+	std::vector<DrawnImage> difference;
+	set_symmetric_difference(begin(drawn), end(drawn), begin(now), end(now), back_inserter(difference));
+	drawn = std::move(now);
+
+	Rect dirty;
+	for (auto const& image : difference)
+		dirty.Add(image.area);
+	Rect full;
+	full.x2 = frame.width;
+	full.y2 = frame.height;
+	dirty = dirty.Intersect(full);
+	if (dirty.Empty()) return true;
+
+	// Put back the video under the changed area, then blend every image
+	// which touches it in the same order as a full draw
+	StageTimer timer;
+	const size_t row_bytes = (dirty.x2 - dirty.x1) * 4;
+	for (int y = dirty.y1; y < dirty.y2; ++y) {
+		size_t row = frame.flipped ? frame.height - 1 - y : y;
+		unsigned char *dst = frame.data.data() + row * frame.pitch + dirty.x1 * 4;
+		if (clean)
+			memcpy(dst, clean->data.data() + row * clean->pitch + dirty.x1 * 4, row_bytes);
+		else
+			memset(dst, 0, row_bytes);
 	}
+
+	for (auto img = images; img; img = img->next)
+		Blend(frame, *img, dirty);
+	blend_time = timer.Elapsed();
+	return true;
 }
 }
 
@@ -19,27 +19,66 @@
 #include <libaegisub/file_mapping.h>
 #include <libaegisub/make_unique.h>
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <cstring>
 
 TextFileReader::TextFileReader(agi::fs::path const& filename, std::string encoding, bool trim)
-: file(agi::make_unique<agi::read_file_mapping>(filename))
-, stream(agi::make_unique<boost::interprocess::ibufferstream>(file->read(), file->size()))
+: file(agi::open_read_mapping(filename))
 , trim(trim)
-, iter(agi::line_iterator<std::string>(*stream, encoding))
 {
+	boost::to_lower(encoding);
+	if (encoding == "utf-8" || encoding == "ascii" || encoding == "us-ascii") {
+		// No conversion is needed, so just find the line breaks in the
+		// mapped file rather than going through a stream
+		static const char empty = 0;
+		direct = true;
+		pos = file->size() ? file->read() : &empty;
+		end = pos + file->size();
+		return;
+	}
+
+	stream = agi::make_unique<boost::interprocess::ibufferstream>(file->read(), file->size());
+	iter = agi::line_iterator<std::string>(*stream, encoding);
 }
 
 TextFileReader::~TextFileReader() {
 }
 
 std::string TextFileReader::ReadLineFromFile() {
-	std::string str = *iter;
-	++iter;
+	std::string str;
+	if (direct) {
+		// Matches line_iterator: every LF ends a line, so a file ending in a
+		// line break has a final empty line
+		auto line_end = static_cast<const char *>(memchr(pos, '\n', end - pos));
+		auto next = line_end ? line_end + 1 : nullptr;
+		if (!line_end)
+			line_end = end;
+		if (line_end != pos && line_end[-1] == '\r')
+			--line_end;
+		str.assign(pos, line_end);
+		pos = next;
+	}
+	else {
+		str = *iter;
+		++iter;
+	}
 	if (trim)
 		boost::trim(str);
 	if (boost::starts_with(str, "\xEF\xBB\xBF"))
 		str.erase(0, 3);
 	return str;
 }
+
+uint64_t TextFileReader::Size() const {
+	return file->size();
+}
+
+uint64_t TextFileReader::Position() const {
+	if (direct)
+		return pos ? file->size() - (end - pos) : file->size();
+	auto cur = stream->tellg();
+	return cur < 0 ? file->size() : static_cast<uint64_t>(cur);
+}
@@ -14,6 +14,7 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -26,11 +27,19 @@ namespace agi { class read_file_mapping; }
 /// @class TextFileReader
 /// @brief A line-based text file reader
 class TextFileReader {
-	std::unique_ptr<agi::read_file_mapping> file;
+	std::shared_ptr<agi::read_file_mapping> file;
 	std::unique_ptr<std::istream> stream;
 	bool trim;
 	agi::line_iterator<std::string> iter;
 
+	/// Is the file UTF-8 and being read directly from the mapping rather
+	/// than through iter?
+	bool direct = false;
+	/// Start of the next line when direct, or nullptr after the last one
+	const char *pos = nullptr;
+	/// End of the file when direct
+	const char *end = nullptr;
+
 public:
 	/// @brief Constructor
 	/// @param filename File to open
@@ -44,5 +53,10 @@ public:
 	/// @return The line, possibly trimmed
 	std::string ReadLineFromFile();
 	/// @brief Check if there are any more lines to read
-	bool HasMoreLines() const { return iter != agi::line_iterator<std::string>(); }
+	bool HasMoreLines() const { return direct ? pos != nullptr : iter != agi::line_iterator<std::string>(); }
+
+	/// Size of the file in bytes
+	uint64_t Size() const;
+	/// Approximate number of bytes of the file read so far, for progress reporting
+	uint64_t Position() const;
 };
@@ -23,6 +23,7 @@
 
 #include "options.h"
 
+#include <libaegisub/dir_listing.h>
 #include <libaegisub/dispatch.h>
 #include <libaegisub/format.h>
 #include <libaegisub/fs.h>
@@ -57,8 +58,9 @@ static std::vector<std::string> langs(const char *ext) {
 	auto user_path = config::path->Decode(OPT_GET("Path/Dictionary")->GetString());
 
 	auto filter = std::string("th_*.") + ext;
-	agi::fs::DirectoryIterator(data_path, filter).GetAll(paths);
-	agi::fs::DirectoryIterator(user_path, filter).GetAll(paths);
+	paths = agi::fs::ListDirectory(data_path, filter);
+	auto user_paths = agi::fs::ListDirectory(user_path, filter);
+	paths.insert(paths.end(), user_paths.begin(), user_paths.end());
 
 	// Drop extensions and the th_ prefix
 	for (auto& fn : paths) fn = fn.substr(3, fn.size() - filter.size() + 1);
@@ -98,12 +100,16 @@ void Thesaurus::OnLanguageChanged() {
 
 	LOG_I("thesaurus/file") << "Using thesaurus: " << dat;
 
+	// Binary index built from the idx file the first time it's used, so
+	// that later loads just map it
+	auto cache = config::path->Decode("?local/thesaurus")/agi::format("th_%s.idx.bin", language);
+
 	if (cancel_load) *cancel_load = true;
 	cancel_load = new bool{false};
 	auto cancel = cancel_load; // Needed to avoid capturing via `this`
 	agi::dispatch::Background().Async([=]{
 		try {
-			auto thes = agi::make_unique<agi::Thesaurus>(dat, idx);
+			auto thes = agi::make_unique<agi::Thesaurus>(dat, idx, cache);
 			agi::dispatch::Main().Sync([&thes, cancel, this]{
 				if (!*cancel) {
 					impl = std::move(thes);
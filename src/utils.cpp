@@ -98,6 +98,7 @@ int SmallestPowerOf2(int x) {
 #ifndef __WXMAC__
 void RestartAegisub() {
 	config::opt->Flush();
+	config::opt->WaitForFlush();
 
 #if defined(__WXMSW__)
 	wxExecute("\"" + wxStandardPaths::Get().GetExecutablePath() + "\"");
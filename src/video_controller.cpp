@@ -42,9 +42,16 @@
 #include "utils.h"
 
 #include <libaegisub/ass/time.h>
+#include <libaegisub/log.h>
 
+#include <climits>
 #include <wx/log.h>
 
+namespace {
+/// Number of lines after the current one for PrefetchLinesAfter to decode
+const size_t prefetch_lines = 3;
+}
+
 VideoController::VideoController(agi::Context *c)
 : context(c)
 , playAudioOnStep(OPT_GET("Audio/Plays When Stepping Video"))
@@ -56,16 +63,19 @@ VideoController::VideoController(agi::Context *c)
 {
 	Bind(EVT_VIDEO_ERROR, &VideoController::OnVideoError, this);
 	Bind(EVT_SUBTITLES_ERROR, &VideoController::OnSubtitlesError, this);
+	Bind(EVT_FRAME_READY, &VideoController::OnFrameReady, this);
 	playback.Bind(wxEVT_TIMER, &VideoController::OnPlayTimer, this);
 }
 
 void VideoController::OnNewVideoProvider(AsyncVideoProvider *new_provider) {
+	// The old provider may already be gone, so it can't be told to stop
+	provider = nullptr;
 	Stop();
 	provider = new_provider;
 	color_matrix = provider ? provider->GetColorSpace() : "";
 }
 
-void VideoController::OnSubtitlesCommit(int type, const AssDialogue *changed) {
+void VideoController::OnSubtitlesCommit(int type, const AssDialogue *, AssCommitChanges const& changes) {
 	if (!provider) return;
 
 	if ((type & AssFile::COMMIT_SCRIPTINFO) || type == AssFile::COMMIT_NEW) {
@@ -76,10 +86,15 @@ void VideoController::OnSubtitlesCommit(int type, const AssDialogue *changed) {
 		}
 	}
 
-	if (!changed)
+	if (!changes.known)
 		provider->LoadSubtitles(context->ass.get());
-	else
-		provider->UpdateSubtitles(context->ass.get(), changed);
+	else if (!changes.lines.empty())
+		provider->UpdateSubtitles(context->ass.get(), changes.lines);
+}
+
+void VideoController::PreviewLines(std::vector<const AssDialogue *> const& lines) {
+	if (provider && !lines.empty())
+		provider->UpdateSubtitles(context->ass.get(), lines);
 }
 
 void VideoController::OnActiveLineChanged(AssDialogue *line) {
@@ -143,9 +158,9 @@ void VideoController::Play() {
 	end_frame = provider->GetFrameCount() - 1;
 
 	context->audioController->PlayToEnd(start_ms);
+	provider->RenderAhead(frame_n + 1, end_frame - 1, context->project->Timecodes());
 
-	playback_start_time = std::chrono::steady_clock::now();
-	playback.Start(10);
+	StartPlayback();
 }
 
 void VideoController::PlayLine() {
@@ -162,32 +177,95 @@ void VideoController::PlayLine() {
 	end_frame = FrameAtTime(context->selectionController->GetActiveLine()->End, agi::vfr::END) + 1;
 
 	JumpToFrame(startFrame);
+	if (provider)
+		provider->RenderAhead(startFrame + 1, end_frame - 1, context->project->Timecodes());
+
+	StartPlayback();
+}
+
+void VideoController::PrefetchLinesAfter(AssDialogue *line) {
+	if (!line) return;
+	auto it = context->ass->iterator_to(*line);
+	if (it == context->ass->Events.end()) return;
+
+	std::vector<int> starts;
+	int begin = INT_MAX, end = INT_MIN;
+	for (++it; it != context->ass->Events.end() && starts.size() < prefetch_lines; ++it) {
+		starts.push_back(it->Start);
+		begin = std::min<int>(begin, it->Start);
+		end = std::max<int>(end, it->End);
+	}
+	if (starts.empty()) return;
+
+	// The audio is decoded onwards from the first gap in the range, so the
+	// whole span is one request
+	context->audioController->PrefetchRange(TimeRange(begin, std::max(begin, end)));
+	if (provider)
+		provider->PrefetchFrames(context->project->Timecodes().FramesAtTimes(starts, agi::vfr::START));
+}
 
+void VideoController::StartPlayback() {
+	dropped_frames = 0;
+	late_frames = 0;
+	frame_latency = 0.;
 	playback_start_time = std::chrono::steady_clock::now();
 	playback.Start(10);
 }
 
+int VideoController::PlaybackPosition() const {
+	if (context->audioController->IsPlaying())
+		return context->audioController->GetPlaybackPosition();
+
+	using namespace std::chrono;
+	return start_ms + duration_cast<milliseconds>(steady_clock::now() - playback_start_time).count();
+}
+
 void VideoController::Stop() {
 	if (IsPlaying()) {
 		playback.Stop();
 		context->audioController->Stop();
+		if (provider)
+			provider->StopRenderAhead();
+
+		if (dropped_frames || late_frames)
+			LOG_I("video/playback") << "dropped " << dropped_frames << " frames, " << late_frames << " shown late";
 	}
 }
 
 void VideoController::OnPlayTimer(wxTimerEvent &) {
-	using namespace std::chrono;
-	int next_frame = FrameAtTime(start_ms + duration_cast<milliseconds>(steady_clock::now() - playback_start_time).count());
-	if (next_frame == frame_n) return;
+	// Ask for the frame which will be due by the time it's ready, so that
+	// slow frames turn into skipped frames rather than video lagging behind
+	int now = PlaybackPosition();
+	int next_frame = FrameAtTime(now + (int)frame_latency);
+	if (next_frame <= frame_n) return;
 
 	if (next_frame >= end_frame)
 		Stop();
 	else {
+		dropped_frames += next_frame - frame_n - 1;
 		frame_n = next_frame;
+		request_time = std::chrono::steady_clock::now();
 		RequestFrame();
 		Seek(frame_n);
 	}
 }
 
+void VideoController::OnFrameReady(FrameReadyEvent &evt) {
+	evt.Skip();
+	if (!IsPlaying()) return;
+
+	int shown = FrameAtTime((int)evt.time);
+	if (FrameAtTime(PlaybackPosition()) > shown)
+		++late_frames;
+
+	// Only the latest request has a meaningful time to measure from
+	if (shown == frame_n) {
+		using namespace std::chrono;
+		double latency = duration_cast<milliseconds>(steady_clock::now() - request_time).count();
+		frame_latency = mid(0., frame_latency * .8 + latency * .2, 250.);
+	}
+}
+
 double VideoController::GetARFromType(AspectRatio type) const {
 	switch (type) {
 		case AspectRatio::Default:    return (double)provider->GetWidth()/provider->GetHeight();
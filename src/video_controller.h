@@ -32,11 +32,14 @@
 
 #include <chrono>
 #include <set>
+#include <vector>
 
 #include <wx/timer.h>
 
+struct AssCommitChanges;
 class AssDialogue;
 class AsyncVideoProvider;
+struct FrameReadyEvent;
 struct SubtitlesProviderErrorEvent;
 struct VideoProviderErrorEvent;
 
@@ -83,6 +86,19 @@ class VideoController final : public wxEvtHandler {
 	/// The last frame to play if video is currently playing
 	int end_frame = 0;
 
+	/// Frames skipped over during the current playback to keep up with the clock
+	int dropped_frames = 0;
+
+	/// Frames during the current playback which were ready only after the
+	/// next frame should already have been shown
+	int late_frames = 0;
+
+	/// When the last frame was requested during playback
+	std::chrono::steady_clock::time_point request_time;
+
+	/// Running estimate of how long it takes a requested frame to be ready, in ms
+	double frame_latency = 0.;
+
 	/// The frame number which was last requested from the video provider,
 	/// which may not be the same thing as the currently displayed frame
 	int frame_n = 0;
@@ -100,11 +116,19 @@ class VideoController final : public wxEvtHandler {
 	std::vector<agi::signal::Connection> connections;
 
 	void OnPlayTimer(wxTimerEvent &event);
+	void OnFrameReady(FrameReadyEvent &event);
+
+	/// Start the playback timer
+	void StartPlayback();
+
+	/// Get the current playback position in milliseconds, from the audio if
+	/// it's playing so that the video follows it
+	int PlaybackPosition() const;
 
 	void OnVideoError(VideoProviderErrorEvent const& err);
 	void OnSubtitlesError(SubtitlesProviderErrorEvent const& err);
 
-	void OnSubtitlesCommit(int type, const AssDialogue *changed);
+	void OnSubtitlesCommit(int type, const AssDialogue *changed, AssCommitChanges const& changes);
 	void OnNewVideoProvider(AsyncVideoProvider *provider);
 	void OnActiveLineChanged(AssDialogue *line);
 
@@ -119,6 +143,12 @@ public:
 	/// Get the current frame number
 	int GetFrameN() const { return frame_n; }
 
+	/// Get the number of frames skipped during the current or last playback
+	int GetDroppedFrames() const { return dropped_frames; }
+
+	/// Get the number of frames shown late during the current or last playback
+	int GetLateFrames() const { return late_frames; }
+
 	/// Get the actual aspect ratio from a predefined AR type
 	double GetARFromType(AspectRatio type) const;
 
@@ -151,9 +181,22 @@ public:
 	void PrevFrame();
 	/// Seek to the beginning of the current line, then play to the end of it
 	void PlayLine();
+	/// @brief Get ready to seek to and play the lines after a line
+	/// @param line Line which the user is currently on
+	///
+	/// Decodes the start frames and the audio of the next few lines in the
+	/// background, for stepping through the file a line at a time.
+	void PrefetchLinesAfter(AssDialogue *line);
 	/// Stop playing
 	void Stop();
 
+	/// @brief Show uncommitted changes to some lines in the video
+	/// @param lines Existing lines which have been changed
+	///
+	/// The changes aren't announced to anything else, so they have to be
+	/// committed normally once they're done.
+	void PreviewLines(std::vector<const AssDialogue *> const& lines);
+
 	DEFINE_SIGNAL_ADDERS(Seek, AddSeekListener)
 	DEFINE_SIGNAL_ADDERS(ARChange, AddARChangeListener)
 
@@ -39,6 +39,7 @@
 #include "command/command.h"
 #include "compat.h"
 #include "format.h"
+#include "gl_text.h"
 #include "include/aegisub/context.h"
 #include "include/aegisub/hotkey.h"
 #include "include/aegisub/menu.h"
@@ -78,6 +79,15 @@ public:
 
 #define E(cmd) cmd; if (GLenum err = glGetError()) throw OpenGlException(#cmd, err)
 
+namespace {
+/// The context and renderer used by every open display. All of the canvases
+/// have the same pixel format, so they can draw with the same context and
+/// the same textures, and a frame is uploaded once no matter how many
+/// displays show it.
+std::weak_ptr<wxGLContext> shared_context;
+std::weak_ptr<VideoOutGL> shared_video_out;
+}
+
 VideoDisplay::VideoDisplay(wxToolBar *toolbar, bool freeSize, wxComboBox *zoomBox, wxWindow *parent, agi::Context *c)
 : wxGLCanvas(parent, -1, attribList)
 , autohideTools(OPT_GET("Tool/Visual/Autohide"))
@@ -139,15 +149,22 @@ bool VideoDisplay::InitContext() {
 	if (GetClientSize() == wxSize(0, 0))
 		return false;
 
-	if (!glContext)
-		glContext = agi::make_unique<wxGLContext>(this);
+	if (!glContext) {
+		glContext = shared_context.lock();
+		if (!glContext)
+			shared_context = glContext = std::make_shared<wxGLContext>(this);
+	}
 
 	SetCurrent(*glContext);
 	return true;
 }
 
 void VideoDisplay::UploadFrameData(FrameReadyEvent &evt) {
+	// The video controller also looks at frames to keep track of playback
+	evt.Skip();
 	pending_frame = evt.frame;
+	pending_overlay = evt.overlay;
+	pending_timings = evt.timings;
 	Render();
 }
 
@@ -155,16 +172,23 @@ void VideoDisplay::Render() try {
 	if (!con->project->VideoProvider() || !InitContext() || (!videoOut && !pending_frame))
 		return;
 
-	if (!videoOut)
-		videoOut = agi::make_unique<VideoOutGL>();
+	if (!videoOut) {
+		videoOut = shared_video_out.lock();
+		if (!videoOut)
+			shared_video_out = videoOut = std::make_shared<VideoOutGL>();
+	}
 
 	if (!tool)
 		cmd::call("video/tool/cross", con);
 
 	try {
 		if (pending_frame) {
-			videoOut->UploadFrameData(*pending_frame);
+			StageTimer timer;
+			videoOut->UploadFrameData(pending_frame, pending_overlay);
+			pending_timings.upload = timer.Elapsed();
+			frame_timings.Add(pending_timings);
 			pending_frame.reset();
+			pending_overlay.reset();
 		}
 	}
 	catch (const VideoOutInitException& err) {
@@ -214,7 +238,10 @@ void VideoDisplay::Render() try {
 	}
 
 	if ((mouse_pos || !autohideTools->GetBool()) && tool)
-		tool->Draw();
+		tool->DrawBatched();
+
+	if (OPT_GET("Video/Show Timings")->GetBool())
+		DrawTimings();
 
 	SwapBuffers();
 }
@@ -264,6 +291,36 @@ void VideoDisplay::DrawOverscanMask(float horizontal_percent, float vertical_per
 	gl.DrawMultiPolygon(points, vstart, vcount, Vector2D(viewport_left, viewport_top), Vector2D(viewport_width, viewport_height), true);
 }
 
+void VideoDisplay::DrawTimings() {
+	// Roughly the last second of playback
+	const size_t window = 30;
+
+	if (!timing_text)
+		timing_text = agi::make_unique<OpenGLText>();
+	timing_text->SetFont("Verdana", 10, false, false);
+	timing_text->SetColour(agi::Color(255, 255, 255, 255));
+
+	FrameTimings average, maximum;
+	frame_timings.Summarize(window, average, maximum);
+
+	const std::pair<const char *, double FrameTimings::*> stages[] = {
+		{"decode", &FrameTimings::decode},
+		{"subtitles", &FrameTimings::subtitles},
+		{"blend", &FrameTimings::blend},
+		{"upload", &FrameTimings::upload},
+	};
+
+	int x = viewport_left / scale_factor + 4;
+	int y = viewport_top / scale_factor + 4;
+	for (auto const& stage : stages) {
+		auto line = agi::format("%s: %.1f ms avg, %.1f ms max", stage.first, average.*stage.second, maximum.*stage.second);
+		int w, h;
+		timing_text->GetExtent(line, w, h);
+		timing_text->Print(line, x, y);
+		y += h;
+	}
+}
+
 void VideoDisplay::PositionVideo() {
 	auto provider = con->project->VideoProvider();
 	if (!provider || !IsShownOnScreen()) return;
@@ -300,7 +357,10 @@ void VideoDisplay::PositionVideo() {
 		tool->SetDisplayArea(viewport_left / scale_factor, viewport_top / scale_factor,
 		                     viewport_width / scale_factor, viewport_height / scale_factor);
 
-	Render();
+	// The frame is already on the card and only its placement has changed,
+	// so just redraw, once for however many changes happen before the next
+	// paint (a zoom repositions both before and after the resize it causes)
+	Refresh(false);
 }
 
 void VideoDisplay::UpdateSize() {
@@ -445,4 +505,5 @@ void VideoDisplay::Unload() {
 	tool.reset();
 	glContext.reset();
 	pending_frame.reset();
+	pending_overlay.reset();
 }
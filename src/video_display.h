@@ -34,6 +34,7 @@
 
 #include <libaegisub/signal.h>
 
+#include "frame_timings.h"
 #include "vector2d.h"
 
 #include <memory>
@@ -42,6 +43,7 @@
 #include <wx/glcanvas.h>
 
 // Prototypes
+class OpenGLText;
 class RetinaHelper;
 class VideoController;
 class VideoOutGL;
@@ -87,16 +89,16 @@ class VideoDisplay final : public wxGLCanvas {
 	/// The current zoom level, where 1.0 = 100%
 	double zoomValue;
 
-	/// The video renderer
-	std::unique_ptr<VideoOutGL> videoOut;
+	/// The video renderer, shared with all other displays
+	std::shared_ptr<VideoOutGL> videoOut;
 
 	/// The active visual typesetting tool
 	std::unique_ptr<VisualToolBase> tool;
 	/// The toolbar used by individual typesetting tools
 	wxToolBar* toolBar;
 
-	/// The OpenGL context for this display
-	std::unique_ptr<wxGLContext> glContext;
+	/// The OpenGL context for this display, shared with all other displays
+	std::shared_ptr<wxGLContext> glContext;
 
 	/// The dropdown box for selecting zoom levels
 	wxComboBox *zoomBox;
@@ -105,7 +107,16 @@ class VideoDisplay final : public wxGLCanvas {
 	bool freeSize;
 
 	/// Frame which will replace the currently visible frame on the next render
-	std::shared_ptr<VideoFrame> pending_frame;
+	std::shared_ptr<const VideoFrame> pending_frame;
+	/// Subtitles to composite over pending_frame, if they weren't drawn onto it
+	std::shared_ptr<const VideoFrame> pending_overlay;
+	/// How long it took to produce pending_frame
+	FrameTimings pending_timings;
+
+	/// Timings of the frames which have been displayed
+	FrameTimingLog frame_timings;
+	/// Text renderer for the timing overlay, created when first needed
+	std::unique_ptr<OpenGLText> timing_text;
 
 	std::unique_ptr<RetinaHelper> retina_helper;
 	int scale_factor;
@@ -116,6 +127,9 @@ class VideoDisplay final : public wxGLCanvas {
 	/// @param vertical_percent The percent of the video reserved vertically
 	void DrawOverscanMask(float horizontal_percent, float vertical_percent) const;
 
+	/// Draw the recent frame timings in the corner of the video
+	void DrawTimings();
+
 	/// Upload the image for the current frame to the video card
 	void UploadFrameData(FrameReadyEvent&);
 
@@ -167,6 +181,9 @@ public:
 
 	bool ToolIsType(std::type_info const& type) const;
 
+	/// Get the timings of the most recently displayed frames
+	FrameTimingLog const& GetFrameTimings() const { return frame_timings; }
+
 	/// Discard all OpenGL state
 	void Unload();
 };
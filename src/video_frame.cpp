@@ -16,6 +16,8 @@
 
 #include "video_frame.h"
 
+#include <boost/algorithm/string/predicate.hpp>
+
 #if BOOST_VERSION >= 106900
 #include <boost/gil.hpp>
 #else
@@ -40,6 +42,12 @@ namespace {
 wxImage GetImage(VideoFrame const& frame) {
 	using namespace boost::gil;
 
+	if (frame.yuv) {
+		VideoFrame converted;
+		ConvertToBGRA(frame, nullptr, converted);
+		return GetImage(converted);
+	}
+
 	wxImage img(frame.width, frame.height);
 	auto src = interleaved_view(frame.width, frame.height, (bgra8_pixel_t*)frame.data.data(), frame.pitch);
 	auto dst = interleaved_view(frame.width, frame.height, (rgb8_pixel_t*)img.GetData(), 3 * frame.width);
@@ -48,3 +56,106 @@ wxImage GetImage(VideoFrame const& frame) {
 	copy_and_convert_pixels(src, dst, color_converter());
 	return img;
 }
+
+void SetYUVMatrix(VideoFrame &frame, std::string const& matrix) {
+	frame.full_range = boost::starts_with(matrix, "PC.");
+
+	if (boost::ends_with(matrix, ".709")) {
+		frame.kr = 0.2126f;
+		frame.kb = 0.0722f;
+	}
+	else if (boost::ends_with(matrix, ".FCC")) {
+		frame.kr = 0.30f;
+		frame.kb = 0.11f;
+	}
+	else if (boost::ends_with(matrix, ".240M")) {
+		frame.kr = 0.212f;
+		frame.kb = 0.087f;
+	}
+	else {
+		frame.kr = 0.299f;
+		frame.kb = 0.114f;
+	}
+}
+
+void GetYUVToRGB(VideoFrame const& frame, float matrix[9], float offset[3]) {
+	const float kr = frame.kr, kb = frame.kb, kg = 1.f - kr - kb;
+
+	// TV range puts luma in [16, 235] and chroma in [16, 240]
+	const float luma_scale = frame.full_range ? 1.f : 255.f / 219.f;
+	const float chroma_scale = frame.full_range ? 1.f : 255.f / 224.f;
+	offset[0] = frame.full_range ? 0.f : 16.f / 255.f;
+	offset[1] = offset[2] = 128.f / 255.f;
+
+	const float m[9] = {
+		1.f, 0.f,                       2.f * (1.f - kr),
+		1.f, -2.f * kb * (1.f - kb) / kg, -2.f * kr * (1.f - kr) / kg,
+		1.f, 2.f * (1.f - kb),          0.f,
+	};
+	for (int i = 0; i < 9; ++i)
+		matrix[i] = m[i] * (i % 3 == 0 ? luma_scale : chroma_scale);
+}
+
+void ConvertToBGRA(VideoFrame const& src, VideoFrame const* overlay, VideoFrame &dst) {
+	float m[9], offset[3];
+	GetYUVToRGB(src, m, offset);
+
+	dst.data.resize(src.width * src.height * 4);
+	dst.width = src.width;
+	dst.height = src.height;
+	dst.pitch = src.width * 4;
+	dst.flipped = src.flipped;
+	dst.yuv = false;
+	dst.full_width = src.full_width;
+	dst.full_height = src.full_height;
+
+	auto clamp = [](float v) -> unsigned char {
+		return v <= 0.f ? 0 : v >= 1.f ? 255 : (unsigned char)(v * 255.f + .5f);
+	};
+
+	const unsigned char *u_plane = src.data.data() + src.pitch * src.height;
+	const unsigned char *v_plane = u_plane + src.chroma_pitch * ((src.height + 1) / 2);
+	for (size_t y = 0; y < src.height; ++y) {
+		const unsigned char *y_row = src.data.data() + y * src.pitch;
+		const unsigned char *u_row = u_plane + (y / 2) * src.chroma_pitch;
+		const unsigned char *v_row = v_plane + (y / 2) * src.chroma_pitch;
+		const unsigned char *o = overlay ? overlay->data.data() + y * overlay->pitch : nullptr;
+		unsigned char *out = dst.data.data() + y * dst.pitch;
+
+		for (size_t x = 0; x < src.width; ++x, out += 4) {
+			float yy = y_row[x] / 255.f - offset[0];
+			float u = u_row[x / 2] / 255.f - offset[1];
+			float v = v_row[x / 2] / 255.f - offset[2];
+			out[0] = clamp(m[6] * yy + m[7] * u + m[8] * v);
+			out[1] = clamp(m[3] * yy + m[4] * u + m[5] * v);
+			out[2] = clamp(m[0] * yy + m[1] * u + m[2] * v);
+			out[3] = 255;
+
+			if (o) {
+				unsigned int inv = 255 - o[3];
+				for (int ch = 0; ch < 3; ++ch)
+					out[ch] = (unsigned char)(o[ch] + out[ch] * inv / 255);
+				o += 4;
+			}
+		}
+	}
+}
+
+std::shared_ptr<VideoFrame> VideoFramePool::Get(size_t size) {
+	// Prefer a free frame which is already big enough, but grow a smaller
+	// one rather than adding another frame to the pool
+	std::shared_ptr<VideoFrame> frame;
+	for (auto const& candidate : frames) {
+		if (candidate.use_count() != 1) continue;
+		frame = candidate;
+		if (frame->data.capacity() >= size) break;
+	}
+
+	if (!frame) {
+		frame = std::make_shared<VideoFrame>();
+		frames.push_back(frame);
+	}
+
+	frame->data.reserve(size);
+	return frame;
+}
@@ -14,6 +14,10 @@
 //
 // Aegisub Project http://www.aegisub.org/
 
+#pragma once
+
+#include <memory>
+#include <string>
 #include <vector>
 
 class wxImage;
@@ -24,6 +28,61 @@ struct VideoFrame {
 	size_t height;
 	size_t pitch;
 	bool flipped;
+
+	/// @brief Is the data planar 8-bit 4:2:0 YUV rather than BGRA?
+	///
+	/// YUV frames hold the Y plane with pitch bytes per row, followed by the
+	/// U and V planes with chroma_pitch bytes per row and half the height,
+	/// rounded up.
+	bool yuv = false;
+	/// Bytes per row of the chroma planes of YUV frames
+	size_t chroma_pitch = 0;
+	/// Red luma coefficient of YUV frames
+	float kr = 0.299f;
+	/// Blue luma coefficient of YUV frames
+	float kb = 0.114f;
+	/// Do YUV frames use the full range of values rather than TV range?
+	bool full_range = false;
+	/// Size of the video when the frame was decoded at reduced resolution,
+	/// or 0 if it is full size
+	size_t full_width = 0;
+	size_t full_height = 0;
 };
 
 wxImage GetImage(VideoFrame const& frame);
+
+/// @brief Set the conversion used for a YUV frame
+/// @param frame Frame to update
+/// @param matrix Colour matrix name, as returned by VideoProvider::GetColorSpace
+void SetYUVMatrix(VideoFrame &frame, std::string const& matrix);
+
+/// @brief Get the conversion from a YUV frame's samples to RGB
+/// @param frame YUV frame
+/// @param[out] matrix Row-major 3x3 matrix to multiply YUV by, after subtracting offset
+/// @param[out] offset Value to subtract from each YUV sample, with samples in [0, 1]
+void GetYUVToRGB(VideoFrame const& frame, float matrix[9], float offset[3]);
+
+/// @brief Convert a YUV frame to BGRA
+/// @param src YUV frame to convert
+/// @param overlay BGRA frame with premultiplied alpha to composite over the
+///                result, or nullptr
+/// @param[out] dst Frame to write to
+void ConvertToBGRA(VideoFrame const& src, VideoFrame const* overlay, VideoFrame &dst);
+
+/// @class VideoFramePool
+/// @brief Recycles frame buffers so that decoding doesn't allocate
+///
+/// A frame is free again once the pool holds the only reference to it, so
+/// frames can be passed around by shared_ptr without any handshake. All
+/// calls to Get must be made from the same thread.
+class VideoFramePool {
+	std::vector<std::shared_ptr<VideoFrame>> frames;
+
+public:
+	/// @brief Get a frame which nothing else refers to
+	/// @param size Size in bytes of the frame data which will be written to it
+	///
+	/// The frame's data has at least size bytes of capacity, so filling it
+	/// doesn't allocate once the pool has frames of the video's resolution.
+	std::shared_ptr<VideoFrame> Get(size_t size);
+};
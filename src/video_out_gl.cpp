@@ -20,15 +20,33 @@
 ///
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <utility>
 
 #include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
 
 // These must be included before local headers.
 #ifdef HAVE_OPENGL_GL_H
 #include <OpenGL/gl.h>
+#include <OpenGL/glext.h>
 #else
 #include <GL/gl.h>
+#include "gl/glext.h"
+#endif
+
+#ifdef __WIN32__
+#define glGetProc(a) wglGetProcAddress(a)
+#elif !defined(__APPLE__)
+#include <GL/glx.h>
+#define glGetProc(a) glXGetProcAddress((const GLubyte *)(a))
+#endif
+
+#ifdef __APPLE__
+#define GL_ENTRY(type, name) decltype(&::name) name = &::name
+#else
+#define GL_ENTRY(type, name) type name = reinterpret_cast<type>(glGetProc(#name))
 #endif
 
 #include "video_out_gl.h"
@@ -56,11 +74,138 @@ BOOST_NOINLINE void throw_error(GLenum err, const char *msg) {
 /// @brief Structure tracking all precomputable information about a subtexture
 struct VideoOutGL::TextureInfo {
 	GLuint textureID = 0;
+	/// U and V textures when displaying YUV frames
+	GLuint chromaID[2] = {0, 0};
+	/// Subtitle overlay texture when displaying YUV frames
+	GLuint overlayID = 0;
 	int dataOffset = 0;
+	int sourceX = 0;
+	int sourceY = 0;
 	int sourceH = 0;
 	int sourceW = 0;
 };
 
+/// Number of pixel buffer objects to cycle through
+static const size_t pixelBufferCount = 2;
+
+/// @brief Pixel buffer objects used to upload frames without stalling
+///
+/// Uploading from a PBO lets glTexSubImage2D return once the frame has been
+/// copied into driver memory, with the actual transfer to the texture
+/// overlapping with whatever comes next. Buffer objects aren't in OpenGL
+/// 1.1, so the entry points are looked up at runtime.
+struct VideoOutGL::PixelBuffers {
+	GL_ENTRY(PFNGLGENBUFFERSPROC, glGenBuffers);
+	GL_ENTRY(PFNGLDELETEBUFFERSPROC, glDeleteBuffers);
+	GL_ENTRY(PFNGLBINDBUFFERPROC, glBindBuffer);
+	GL_ENTRY(PFNGLBUFFERDATAPROC, glBufferData);
+	GL_ENTRY(PFNGLMAPBUFFERPROC, glMapBuffer);
+	GL_ENTRY(PFNGLUNMAPBUFFERPROC, glUnmapBuffer);
+
+	/// Buffer object ids
+	GLuint ids[pixelBufferCount] = {};
+	/// Index of the buffer to use for the next frame
+	size_t next = 0;
+
+	/// Were all of the entry points found?
+	bool IsComplete() const {
+		return glGenBuffers && glDeleteBuffers && glBindBuffer && glBufferData && glMapBuffer && glUnmapBuffer;
+	}
+};
+
+/// Fragment shader converting YUV to RGB and compositing the subtitles over it
+static const char *yuvShaderSource =
+	"uniform sampler2D y_plane, u_plane, v_plane, overlay;\n"
+	"uniform mat3 matrix;\n"
+	"uniform vec3 offset;\n"
+	"uniform bool has_overlay;\n"
+	"void main() {\n"
+	"	vec2 pos = gl_TexCoord[0].st;\n"
+	"	vec3 yuv = vec3(texture2D(y_plane, pos).r, texture2D(u_plane, pos).r, texture2D(v_plane, pos).r);\n"
+	"	vec3 rgb = matrix * (yuv - offset);\n"
+	"	if (has_overlay) {\n"
+	"		vec4 subs = texture2D(overlay, pos);\n"
+	"		rgb = subs.rgb + (1.0 - subs.a) * rgb;\n"
+	"	}\n"
+	"	gl_FragColor = vec4(rgb, 1.0);\n"
+	"}\n";
+
+/// @brief Shader program for displaying YUV frames
+///
+/// Each tile of the grid gets the Y plane on texture unit 0, U and V on 1
+/// and 2 and the subtitle overlay on 3, all with the same texture
+/// coordinates as the chroma textures are exactly half the size.
+struct VideoOutGL::YUVProgram {
+	GL_ENTRY(PFNGLACTIVETEXTUREPROC, glActiveTexture);
+	GL_ENTRY(PFNGLCREATESHADERPROC, glCreateShader);
+	GL_ENTRY(PFNGLSHADERSOURCEPROC, glShaderSource);
+	GL_ENTRY(PFNGLCOMPILESHADERPROC, glCompileShader);
+	GL_ENTRY(PFNGLGETSHADERIVPROC, glGetShaderiv);
+	GL_ENTRY(PFNGLDELETESHADERPROC, glDeleteShader);
+	GL_ENTRY(PFNGLCREATEPROGRAMPROC, glCreateProgram);
+	GL_ENTRY(PFNGLATTACHSHADERPROC, glAttachShader);
+	GL_ENTRY(PFNGLLINKPROGRAMPROC, glLinkProgram);
+	GL_ENTRY(PFNGLGETPROGRAMIVPROC, glGetProgramiv);
+	GL_ENTRY(PFNGLDELETEPROGRAMPROC, glDeleteProgram);
+	GL_ENTRY(PFNGLUSEPROGRAMPROC, glUseProgram);
+	GL_ENTRY(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation);
+	GL_ENTRY(PFNGLUNIFORM1IPROC, glUniform1i);
+	GL_ENTRY(PFNGLUNIFORM3FVPROC, glUniform3fv);
+	GL_ENTRY(PFNGLUNIFORMMATRIX3FVPROC, glUniformMatrix3fv);
+
+	GLuint program = 0;
+	GLint matrix = -1;
+	GLint offset = -1;
+	GLint hasOverlay = -1;
+
+	/// Were all of the entry points found?
+	bool IsComplete() const {
+		return glActiveTexture && glCreateShader && glShaderSource && glCompileShader
+			&& glGetShaderiv && glDeleteShader && glCreateProgram && glAttachShader
+			&& glLinkProgram && glGetProgramiv && glDeleteProgram && glUseProgram
+			&& glGetUniformLocation && glUniform1i && glUniform3fv && glUniformMatrix3fv;
+	}
+
+	/// Compile and link the program
+	/// @return Whether it worked
+	bool Build() {
+		GLint status = 0;
+		GLuint shader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(shader, 1, &yuvShaderSource, nullptr);
+		glCompileShader(shader);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status) {
+			program = glCreateProgram();
+			glAttachShader(program, shader);
+			glLinkProgram(program);
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+		}
+		// Flagged for deletion once the program goes away
+		glDeleteShader(shader);
+
+		if (status) {
+			matrix = glGetUniformLocation(program, "matrix");
+			offset = glGetUniformLocation(program, "offset");
+			hasOverlay = glGetUniformLocation(program, "has_overlay");
+
+			glUseProgram(program);
+			glUniform1i(glGetUniformLocation(program, "y_plane"), 0);
+			glUniform1i(glGetUniformLocation(program, "u_plane"), 1);
+			glUniform1i(glGetUniformLocation(program, "v_plane"), 2);
+			glUniform1i(glGetUniformLocation(program, "overlay"), 3);
+			glUseProgram(0);
+		}
+
+		bool ok = status && !glGetError();
+		if (!ok && program) {
+			glDeleteProgram(program);
+			program = 0;
+		}
+		while (glGetError()) { }
+		return ok;
+	}
+};
+
 /// @brief Test if a texture can be created
 /// @param width The width of the texture
 /// @param height The height of the texture
@@ -93,13 +238,38 @@ void VideoOutGL::DetectOpenGLCapabilities() {
 
 	// Test for rectangular texture support
 	supportsRectangularTextures = TestTexture(maxTextureSize, maxTextureSize >> 1, internalFormat);
+
+	int major = 0, minor = 0;
+	if (auto version = reinterpret_cast<const char *>(glGetString(GL_VERSION)))
+		sscanf(version, "%d.%d", &major, &minor);
+
+	// Shaders are core in OpenGL 2.0, and without them YUV frames are
+	// converted to RGB on the CPU before uploading
+	if (major >= 2) {
+		auto program = agi::make_unique<YUVProgram>();
+		if (program->IsComplete() && program->Build())
+			yuvProgram = std::move(program);
+	}
+	LOG_I("video/out/gl") << "YUV conversion " << (yuvProgram ? "on the GPU" : "on the CPU");
+
+	// Pixel buffer objects are core in OpenGL 2.1. Anything older, such as
+	// the OpenGL 1.1 emulation used over RDP, uploads from client memory.
+	if (major > 2 || (major == 2 && minor >= 1)) {
+		auto buffers = agi::make_unique<PixelBuffers>();
+		if (buffers->IsComplete()) {
+			buffers->glGenBuffers(pixelBufferCount, buffers->ids);
+			if (!glGetError())
+				pixelBuffers = std::move(buffers);
+		}
+	}
+	LOG_I("video/out/gl") << "Pixel buffer object uploads " << (pixelBuffers ? "enabled" : "not supported");
 }
 
 /// @brief If needed, create the grid of textures for displaying frames of the given format
 /// @param width The frame's width
 /// @param height The frame's height
-/// @param format The frame's format
-/// @param bpp The frame's bytes per pixel
+/// @param format The frame's format, with GL_LUMINANCE meaning planar YUV
+/// @param bpp The frame's bytes per pixel, or of the Y plane for YUV
 void VideoOutGL::InitTextures(int width, int height, GLenum format, int bpp, bool flipped) {
 	using namespace std;
 
@@ -125,7 +295,9 @@ void VideoOutGL::InitTextures(int width, int height, GLenum format, int bpp, boo
 	textureRows  = (int)ceil(double(height) / textureArea);
 	textureCols  = (int)ceil(double(width) / textureArea);
 	textureCount = textureRows * textureCols;
-	textureIdList.resize(textureCount);
+	// YUV frames need chroma and overlay textures for each tile as well
+	const bool yuv = format == GL_LUMINANCE;
+	textureIdList.resize(yuv ? textureCount * 4 : textureCount);
 	textureList.resize(textureCount);
 	CHECK_INIT_ERROR(glGenTextures(textureIdList.size(), &textureIdList[0]));
 	vector<pair<int, int>> textureSizes;
@@ -188,6 +360,8 @@ void VideoOutGL::InitTextures(int width, int height, GLenum format, int bpp, boo
 			// Width and height of the area read from the frame data
 			int sourceX = col * textureArea;
 			int sourceY = row * textureArea;
+			ti.sourceX  = sourceX;
+			ti.sourceY  = sourceY;
 			ti.sourceW  = std::min(frameWidth  - sourceX, maxTextureSize);
 			ti.sourceH  = std::min(frameHeight - sourceY, maxTextureSize);
 
@@ -216,9 +390,24 @@ void VideoOutGL::InitTextures(int width, int height, GLenum format, int bpp, boo
 			float right  = col == lastCol ? 1.0f : 1.0f - 1.0f / textureWidth;
 
 			// Store the stuff needed later
-			ti.textureID = textureIdList[row * textureCols + col];
+			int i = row * textureCols + col;
+			ti.textureID = textureIdList[i];
 			textureSizes.push_back(make_pair(textureWidth, textureHeight));
 
+			if (yuv) {
+				auto activeTexture = yuvProgram->glActiveTexture;
+				ti.chromaID[0] = textureIdList[textureCount + i];
+				ti.chromaID[1] = textureIdList[textureCount * 2 + i];
+				ti.overlayID = textureIdList[textureCount * 3 + i];
+				CHECK_ERROR(activeTexture(GL_TEXTURE1));
+				CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.chromaID[0]));
+				CHECK_ERROR(activeTexture(GL_TEXTURE2));
+				CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.chromaID[1]));
+				CHECK_ERROR(activeTexture(GL_TEXTURE3));
+				CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.overlayID));
+				CHECK_ERROR(activeTexture(GL_TEXTURE0));
+			}
+
 			CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.textureID));
 			CHECK_ERROR(glColor4f(1.0f, 1.0f, 1.0f, 1.0f));
 
@@ -239,43 +428,194 @@ void VideoOutGL::InitTextures(int width, int height, GLenum format, int bpp, boo
 
 	// Create the textures outside of the display list as there's no need to
 	// remake them on every frame
-	for (int i = 0; i < textureCount; ++i) {
-		LOG_I("video/out/gl") << "Using texture size: " << textureSizes[i].first << "x" << textureSizes[i].second;
-		CHECK_INIT_ERROR(glBindTexture(GL_TEXTURE_2D, textureIdList[i]));
-		CHECK_INIT_ERROR(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, textureSizes[i].first, textureSizes[i].second, 0, format, GL_UNSIGNED_BYTE, nullptr));
+	auto createTexture = [&](GLuint id, int w, int h, GLint texFormat, GLenum dataFormat) {
+		CHECK_INIT_ERROR(glBindTexture(GL_TEXTURE_2D, id));
+		CHECK_INIT_ERROR(glTexImage2D(GL_TEXTURE_2D, 0, texFormat, w, h, 0, dataFormat, GL_UNSIGNED_BYTE, nullptr));
 		CHECK_INIT_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 		CHECK_INIT_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 		CHECK_INIT_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP));
 		CHECK_INIT_ERROR(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP));
+	};
+
+	for (int i = 0; i < textureCount; ++i) {
+		int w = textureSizes[i].first, h = textureSizes[i].second;
+		LOG_I("video/out/gl") << "Using texture size: " << w << "x" << h;
+		if (!yuv) {
+			createTexture(textureIdList[i], w, h, internalFormat, format);
+			continue;
+		}
+
+		auto const& ti = textureList[i];
+		createTexture(ti.textureID, w, h, GL_LUMINANCE8, GL_LUMINANCE);
+		createTexture(ti.chromaID[0], std::max(w / 2, 1), std::max(h / 2, 1), GL_LUMINANCE8, GL_LUMINANCE);
+		createTexture(ti.chromaID[1], std::max(w / 2, 1), std::max(h / 2, 1), GL_LUMINANCE8, GL_LUMINANCE);
+		createTexture(ti.overlayID, w, h, internalFormat, GL_BGRA_EXT);
+	}
+}
+
+void VideoOutGL::UploadFrameData(std::shared_ptr<const VideoFrame> const& frame, std::shared_ptr<const VideoFrame> const& overlay) {
+	if (frame == uploadedFrame) {
+		if (overlay == uploadedOverlay) return;
+		if (frame->yuv && yuvProgram) {
+			UploadOverlay(overlay.get());
+			uploadedOverlay = overlay;
+			return;
+		}
 	}
+
+	uploadedFrame.reset();
+	uploadedOverlay.reset();
+	UploadFrameData(*frame, overlay.get());
+	uploadedFrame = frame;
+	uploadedOverlay = overlay;
 }
 
-void VideoOutGL::UploadFrameData(VideoFrame const& frame) {
+void VideoOutGL::UploadOverlay(VideoFrame const* overlay) {
+	if (overlay) {
+		CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, overlay->pitch / 4));
+		for (auto& ti : textureList) {
+			CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.overlayID));
+			CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ti.sourceW, ti.sourceH,
+				GL_BGRA_EXT, GL_UNSIGNED_BYTE, overlay->data.data() + ti.sourceY * overlay->pitch + ti.sourceX * 4));
+		}
+		CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+	}
+
+	auto& yp = *yuvProgram;
+	CHECK_ERROR(yp.glUseProgram(yp.program));
+	CHECK_ERROR(yp.glUniform1i(yp.hasOverlay, overlay != nullptr));
+	CHECK_ERROR(yp.glUseProgram(0));
+}
+
+void VideoOutGL::UploadFrameData(VideoFrame const& frame, VideoFrame const* overlay) {
 	if (frame.height == 0 || frame.width == 0) return;
 
-	InitTextures(frame.width, frame.height, GL_BGRA_EXT, 4, frame.flipped);
+	DetectOpenGLCapabilities();
+
+	// Without shaders YUV frames have to be converted here instead
+	if (frame.yuv && !yuvProgram) {
+		if (!convertedFrame)
+			convertedFrame = agi::make_unique<VideoFrame>();
+		ConvertToBGRA(frame, overlay, *convertedFrame);
+		return UploadFrameData(*convertedFrame);
+	}
+
+	if (frame.yuv)
+		InitTextures(frame.width, frame.height, GL_LUMINANCE, 1, frame.flipped);
+	else {
+		InitTextures(frame.width, frame.height, GL_BGRA_EXT, 4, frame.flipped);
+
+		// Set the row length, needed to be able to upload partial rows
+		CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.pitch / 4));
+	}
+
+	// Copy the frame into the next pixel buffer if possible, in which case
+	// the texture uploads read from offsets into the buffer
+	const unsigned char *source = frame.data.data();
+	const unsigned char *overlaySource = overlay ? overlay->data.data() : nullptr;
+	if (pixelBuffers) {
+		auto& pb = *pixelBuffers;
+		CHECK_ERROR(pb.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pb.ids[pb.next]));
+		pb.next = (pb.next + 1) % pixelBufferCount;
+
+		// Respecifying the storage lets the driver hand out fresh memory
+		// rather than waiting for the last upload from this buffer to finish
+		size_t size = frame.data.size() + (overlay ? overlay->data.size() : 0);
+		CHECK_ERROR(pb.glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW));
+		if (auto dst = static_cast<unsigned char *>(pb.glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY))) {
+			memcpy(dst, frame.data.data(), frame.data.size());
+			if (overlay)
+				memcpy(dst + frame.data.size(), overlay->data.data(), overlay->data.size());
+			if (pb.glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+				source = nullptr;
+				if (overlay)
+					overlaySource = source + frame.data.size();
+			}
+		}
+
+		// Mapping can fail, in which case this frame uploads the old way
+		if (source)
+			CHECK_ERROR(pb.glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+	}
 
-	// Set the row length, needed to be able to upload partial rows
-	CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.pitch / 4));
+	if (frame.yuv) {
+		// Plane rows are only byte aligned
+		CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
-	for (auto& ti : textureList) {
-		CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.textureID));
-		CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ti.sourceW,
-			ti.sourceH, GL_BGRA_EXT, GL_UNSIGNED_BYTE, &frame.data[ti.dataOffset]));
+		const size_t chromaOffset = frame.pitch * frame.height;
+		const size_t chromaSize = frame.chroma_pitch * ((frame.height + 1) / 2);
+		const int chromaWidth = (frame.width + 1) / 2;
+		const int chromaHeight = (frame.height + 1) / 2;
+
+		for (auto& ti : textureList) {
+			CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.pitch));
+			CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.textureID));
+			CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ti.sourceW, ti.sourceH,
+				GL_LUMINANCE, GL_UNSIGNED_BYTE, source + ti.sourceY * frame.pitch + ti.sourceX));
+
+			int x = ti.sourceX / 2, y = ti.sourceY / 2;
+			int w = std::min((ti.sourceW + 1) / 2, chromaWidth - x);
+			int h = std::min((ti.sourceH + 1) / 2, chromaHeight - y);
+			size_t offset = chromaOffset + y * frame.chroma_pitch + x;
+			CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, frame.chroma_pitch));
+			for (int plane = 0; plane < 2; ++plane) {
+				CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.chromaID[plane]));
+				CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h,
+					GL_LUMINANCE, GL_UNSIGNED_BYTE, source + offset + plane * chromaSize));
+			}
+
+			if (overlay) {
+				CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, overlay->pitch / 4));
+				CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.overlayID));
+				CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ti.sourceW, ti.sourceH,
+					GL_BGRA_EXT, GL_UNSIGNED_BYTE, overlaySource + ti.sourceY * overlay->pitch + ti.sourceX * 4));
+			}
+		}
+
+		CHECK_ERROR(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+
+		float matrix[9], offset[3];
+		GetYUVToRGB(frame, matrix, offset);
+		auto& yp = *yuvProgram;
+		CHECK_ERROR(yp.glUseProgram(yp.program));
+		CHECK_ERROR(yp.glUniformMatrix3fv(yp.matrix, 1, GL_TRUE, matrix));
+		CHECK_ERROR(yp.glUniform3fv(yp.offset, 1, offset));
+		CHECK_ERROR(yp.glUniform1i(yp.hasOverlay, overlay != nullptr));
+		CHECK_ERROR(yp.glUseProgram(0));
+	}
+	else {
+		for (auto& ti : textureList) {
+			CHECK_ERROR(glBindTexture(GL_TEXTURE_2D, ti.textureID));
+			CHECK_ERROR(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ti.sourceW,
+				ti.sourceH, GL_BGRA_EXT, GL_UNSIGNED_BYTE, source + ti.dataOffset));
+		}
 	}
 
+	if (pixelBuffers && !source)
+		CHECK_ERROR(pixelBuffers->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
+
 	CHECK_ERROR(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
 }
 
 void VideoOutGL::Render(int dx1, int dy1, int dx2, int dy2) {
 	CHECK_ERROR(glViewport(dx1, dy1, dx2, dy2));
-	CHECK_ERROR(glCallList(dl));
+	if (frameFormat == GL_LUMINANCE && yuvProgram) {
+		CHECK_ERROR(yuvProgram->glUseProgram(yuvProgram->program));
+		CHECK_ERROR(glCallList(dl));
+		CHECK_ERROR(yuvProgram->glUseProgram(0));
+	}
+	else
+		CHECK_ERROR(glCallList(dl));
 	CHECK_ERROR(glMatrixMode(GL_MODELVIEW));
 	CHECK_ERROR(glLoadIdentity());
 
 }
 
 VideoOutGL::~VideoOutGL() {
+	if (pixelBuffers)
+		pixelBuffers->glDeleteBuffers(pixelBufferCount, pixelBuffers->ids);
+	if (yuvProgram)
+		yuvProgram->glDeleteProgram(yuvProgram->program);
 	if (textureIdList.size() > 0) {
 		glDeleteTextures(textureIdList.size(), &textureIdList[0]);
 		glDeleteLists(dl, 1);
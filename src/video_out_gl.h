@@ -21,6 +21,7 @@
 
 #include <libaegisub/exception.h>
 
+#include <memory>
 #include <vector>
 
 struct VideoFrame;
@@ -29,6 +30,8 @@ struct VideoFrame;
 /// @brief OpenGL based video renderer
 class VideoOutGL {
 	struct TextureInfo;
+	struct PixelBuffers;
+	struct YUVProgram;
 
 	/// The maximum texture size supported by the user's graphics card
 	int maxTextureSize = 0;
@@ -57,16 +60,41 @@ class VideoOutGL {
 	int textureRows = 0;
 	/// The number of columns of textures
 	int textureCols = 0;
+	/// Pixel buffer objects to upload frames through, if supported
+	std::unique_ptr<PixelBuffers> pixelBuffers;
+	/// Shader which converts YUV frames to RGB, if supported
+	std::unique_ptr<YUVProgram> yuvProgram;
+	/// Scratch frame for converting YUV frames when shaders aren't available
+	std::unique_ptr<VideoFrame> convertedFrame;
+	/// The frame whose planes are in the textures, kept so that its address
+	/// can't be reused by a different frame
+	std::shared_ptr<const VideoFrame> uploadedFrame;
+	/// The subtitles in the overlay textures
+	std::shared_ptr<const VideoFrame> uploadedOverlay;
 
 	void DetectOpenGLCapabilities();
 	void InitTextures(int width, int height, GLenum format, int bpp, bool flipped);
+	/// Replace just the subtitles drawn over the uploaded YUV frame
+	void UploadOverlay(VideoFrame const* overlay);
 
 	VideoOutGL(const VideoOutGL &) = delete;
 	VideoOutGL& operator=(const VideoOutGL&) = delete;
 public:
 	/// @brief Set the frame to be displayed when Render() is called
 	/// @param frame The frame to be displayed
-	void UploadFrameData(VideoFrame const& frame);
+	/// @param overlay Premultiplied BGRA subtitles to draw over a YUV frame, if any
+	void UploadFrameData(VideoFrame const& frame, VideoFrame const* overlay = nullptr);
+
+	/// @brief Set the frame to be displayed when Render() is called
+	/// @param frame The frame to be displayed
+	/// @param overlay Premultiplied BGRA subtitles to draw over a YUV frame, if any
+	///
+	/// Frames are shared between everything which asks the provider for the
+	/// same frame number, so when only the subtitles over a YUV frame have
+	/// changed this is the same frame object and only the overlay is uploaded.
+	/// Displays sharing a renderer all pass in the same frame and overlay,
+	/// which are only uploaded by the first of them.
+	void UploadFrameData(std::shared_ptr<const VideoFrame> const& frame, std::shared_ptr<const VideoFrame> const& overlay);
 
 	/// @brief Render a frame
 	/// @param x Bottom left x coordinate
@@ -41,7 +41,10 @@
 #include <libaegisub/make_unique.h>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <algorithm>
+#include <cstring>
 #include <mutex>
+#include <thread>
 
 #ifdef _WIN32
 #include <vfw.h>
@@ -62,6 +65,7 @@ class AvisynthVideoProvider: public VideoProvider {
 	std::string colorspace;
 	std::string real_colorspace;
 	bool has_audio = false;
+	bool output_yuv = false; ///< Are frames output as YUV for the display to convert?
 
 	AVSValue source_clip;
 	PClip RGB32Video;
@@ -187,8 +191,16 @@ void AvisynthVideoProvider::Init(std::string const& colormatrix) {
 	auto script = source_clip;
 	vi = script.AsClip()->GetVideoInfo();
 	has_audio = vi.HasAudio();
+	output_yuv = false;
 	if (vi.IsRGB())
 		real_colorspace = colorspace = "None";
+	else if (vi.IsYV12() && OPT_GET("Provider/Avisynth/YUV Output")->GetBool()) {
+		// The display can convert 4:2:0 itself, so the planes are handed
+		// over as they are rather than converted by Avisynth first
+		output_yuv = true;
+		real_colorspace = vi.width > 1024 || vi.height >= 600 ? "TV.709" : "TV.601";
+		colorspace = colormatrix == "TV.601" ? "TV.601" : "TV.709";
+	}
 	else {
 		/// @todo maybe read ColorMatrix hints for d2v files?
 		AVSValue args[2] = { script, "Rec709" };
@@ -206,6 +218,23 @@ void AvisynthVideoProvider::Init(std::string const& colormatrix) {
 	}
 
 	RGB32Video = avs.GetEnv()->Invoke("Cache", script).AsClip();
+
+	// Avisynth+ can run the filter chain on several threads, working ahead
+	// of sequential requests such as playback
+	int threads = OPT_GET("Provider/Avisynth/Prefetch Threads")->GetInt();
+	if (threads < 0)
+		threads = std::max<int>(1, std::thread::hardware_concurrency());
+	if (threads > 0 && avs.GetEnv()->FunctionExists("Prefetch")) {
+		try {
+			AVSValue args[2] = { RGB32Video, threads };
+			RGB32Video = avs.GetEnv()->Invoke("Prefetch", AVSValue(args, 2)).AsClip();
+		}
+		catch (AvisynthError const& err) {
+			// Most likely the script already calls Prefetch itself
+			LOG_I("avisynth/video") << "Not prefetching: " << err.msg;
+		}
+	}
+
 	vi = RGB32Video->GetVideoInfo();
 	fps = (double)vi.fps_numerator / vi.fps_denominator;
 }
@@ -312,8 +341,42 @@ void AvisynthVideoProvider::GetFrame(int n, VideoFrame &out) {
 	std::lock_guard<std::mutex> lock(avs.GetMutex());
 
 	auto frame = RGB32Video->GetFrame(n, avs.GetEnv());
+	if (output_yuv) {
+		size_t pitch = frame->GetPitch(PLANAR_Y);
+		size_t chroma_pitch = frame->GetPitch(PLANAR_U);
+		size_t luma_size = pitch * vi.height;
+		size_t chroma_rows = (vi.height + 1) / 2;
+		size_t chroma_size = chroma_pitch * chroma_rows;
+		out.data.resize(luma_size + 2 * chroma_size);
+
+		// The planes keep Avisynth's pitch, so each one is a single copy
+		// unless the V plane is laid out differently from the U plane
+		unsigned char *dst = out.data.data();
+		memcpy(dst, frame->GetReadPtr(PLANAR_Y), luma_size);
+		memcpy(dst + luma_size, frame->GetReadPtr(PLANAR_U), chroma_size);
+		dst += luma_size + chroma_size;
+		size_t v_pitch = frame->GetPitch(PLANAR_V);
+		if (v_pitch == chroma_pitch)
+			memcpy(dst, frame->GetReadPtr(PLANAR_V), chroma_size);
+		else {
+			size_t row = std::min(chroma_pitch, v_pitch);
+			for (size_t y = 0; y < chroma_rows; ++y)
+				memcpy(dst + y * chroma_pitch, frame->GetReadPtr(PLANAR_V) + y * v_pitch, row);
+		}
+
+		out.flipped = false;
+		out.width = vi.width;
+		out.height = vi.height;
+		out.pitch = pitch;
+		out.chroma_pitch = chroma_pitch;
+		out.yuv = true;
+		SetYUVMatrix(out, colorspace);
+		return;
+	}
+
 	auto ptr = frame->GetReadPtr();
 	out.data.assign(ptr, ptr + frame->GetPitch() * frame->GetHeight());
+	out.yuv = false;
 	out.flipped = true;
 	out.height = frame->GetHeight();
 	out.width = frame->GetRowSize() / 4;
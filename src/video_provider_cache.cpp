@@ -20,19 +20,22 @@
 #include "video_frame.h"
 
 #include <libaegisub/make_unique.h>
+#include <libaegisub/memory_budget.h>
+#include <libaegisub/perf.h>
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 
 namespace {
+agi::perf::Counter& cache_hits = agi::perf::GetCounter("video/frame cache/hits");
+agi::perf::Counter& cache_misses = agi::perf::GetCounter("video/frame cache/misses");
+agi::perf::Gauge& cache_bytes = agi::perf::GetGauge("video/frame cache/bytes");
+
 /// A video frame and its frame number
 struct CachedFrame {
-	VideoFrame frame;
+	std::shared_ptr<VideoFrame> frame;
 	int frame_number;
-
-	CachedFrame(VideoFrame const& frame, int frame_number)
-	: frame(frame), frame_number(frame_number) { }
-
-	CachedFrame(CachedFrame const&) = delete;
 };
 
 /// @class VideoProviderCache
@@ -50,13 +53,50 @@ class VideoProviderCache final : public VideoProvider {
 	/// Cache of video frames with the most recently used ones at the front
 	std::list<CachedFrame> cache;
 
+	/// Position of each frame in the cache list, or cache.end() if it isn't cached
+	///
+	/// Indexed directly by frame number, so that looking up a frame never
+	/// has to allocate or hash anything
+	std::vector<std::list<CachedFrame>::iterator> index;
+
+	/// Total size in bytes of the frames in the cache
+	std::atomic<size_t> cache_size{0};
+
+	/// Most the cache may hold according to the memory budget
+	std::atomic<size_t> budget_limit{SIZE_MAX};
+	agi::MemoryBudget::Registration budget_registration;
+
+	void Clear() {
+		cache.clear();
+		index.assign(index.size(), cache.end());
+		cache_bytes.Add(-(int64_t)cache_size);
+		cache_size = 0;
+	}
+
+	/// Get a frame from the cache, decoding it first if needed
+	std::shared_ptr<VideoFrame> Fetch(int n);
+
 public:
-	VideoProviderCache(std::unique_ptr<VideoProvider> master) : master(std::move(master)) { }
+	VideoProviderCache(std::unique_ptr<VideoProvider> master)
+	: master(std::move(master))
+	, index(this->master->GetFrameCount(), cache.end())
+	{
+		// Frames can be decoded again, so they're the first thing to go
+		budget_registration = agi::GlobalMemoryBudget().Register("video frame cache", 1, 0,
+			[=] { return cache_size.load(); },
+			[=](size_t limit) { budget_limit = limit; });
+	}
+
+	~VideoProviderCache() {
+		cache_bytes.Add(-(int64_t)cache_size);
+	}
 
 	void GetFrame(int n, VideoFrame &frame) override;
+	std::shared_ptr<const VideoFrame> GetSharedFrame(int n, VideoFramePool &pool) override;
+	void GetFrameUncached(int n, VideoFrame &frame) override { master->GetFrame(n, frame); }
 
 	void SetColorSpace(std::string const& m) override {
-		cache.clear();
+		Clear();
 		return master->SetColorSpace(m);
 	}
 
@@ -72,33 +112,80 @@ public:
 	std::string GetRealColorSpace() const override { return master->GetRealColorSpace(); }
 	bool ShouldSetVideoProperties() const override { return master->ShouldSetVideoProperties(); }
 	bool HasAudio() const override                 { return master->HasAudio(); }
+	bool WantsCaching() const override             { return master->WantsCaching(); }
+	bool HasStaticFrame() const override           { return master->HasStaticFrame(); }
 };
 
 void VideoProviderCache::GetFrame(int n, VideoFrame &out) {
-	size_t total_size = 0;
+	out = *Fetch(n);
+}
 
-	for (auto cur = cache.begin(); cur != cache.end(); ++cur) {
-		if (cur->frame_number == n) {
-			cache.splice(cache.begin(), cache, cur); // Move to front
-			out = cache.front().frame;
-			return;
-		}
+std::shared_ptr<const VideoFrame> VideoProviderCache::GetSharedFrame(int n, VideoFramePool &) {
+	return Fetch(n);
+}
 
-		total_size += cur->frame.data.size();
+std::shared_ptr<VideoFrame> VideoProviderCache::Fetch(int n) {
+	if (n < 0 || (size_t)n >= index.size()) {
+		auto frame = std::make_shared<VideoFrame>();
+		master->GetFrame(n, *frame);
+		return frame;
 	}
 
-	master->GetFrame(n, out);
+	auto it = index[n];
+	if (it != cache.end()) {
+		cache_hits.Add();
+		cache.splice(cache.begin(), cache, it); // Move to front
+		return it->frame;
+	}
+	cache_misses.Add();
+
+	// Drop what no longer fits after the memory budget has shrunk the cache,
+	// keeping one entry to recycle
+	size_t limit = std::min(max_cache_size, budget_limit.load());
+	while (cache.size() > 1 && cache_size > limit) {
+		auto& last = cache.back();
+		index[last.frame_number] = cache.end();
+		cache_size -= last.frame->data.size();
+		cache_bytes.Add(-(int64_t)last.frame->data.size());
+		cache.pop_back();
+	}
 
-	if (total_size >= max_cache_size) {
-		cache.splice(cache.begin(), cache, --cache.end()); // Move last to front
-		cache.front().frame_number = n;
-		cache.front().frame = out;
+	// Once full, the least recently used entry is recycled for the new
+	// frame, along with its buffer if nothing outside the cache still has it.
+	// The cache holds on to its frames, so they aren't taken from a pool.
+	if (cache_size >= limit && !cache.empty()) {
+		auto last = --cache.end();
+		index[last->frame_number] = cache.end();
+		cache_size -= last->frame->data.size();
+		cache_bytes.Add(-(int64_t)last->frame->data.size());
+		if (last->frame.use_count() != 1)
+			last->frame = std::make_shared<VideoFrame>();
+		cache.splice(cache.begin(), cache, last); // Move last to front
 	}
 	else
-		cache.emplace_front(out, n);
+		cache.push_front(CachedFrame{std::make_shared<VideoFrame>(), n});
+
+	auto& entry = cache.front();
+	entry.frame_number = n;
+	try {
+		master->GetFrame(n, *entry.frame);
+	}
+	catch (...) {
+		cache.pop_front();
+		throw;
+	}
+
+	index[n] = cache.begin();
+	cache_size += entry.frame->data.size();
+	cache_bytes.Add(entry.frame->data.size());
+	agi::GlobalMemoryBudget().Rebalance();
+	return entry.frame;
 }
 }
 
 std::unique_ptr<VideoProvider> CreateCacheVideoProvider(std::unique_ptr<VideoProvider> parent) {
+	// Every frame would be a copy of the one the provider already has
+	if (parent->HasStaticFrame())
+		return parent;
 	return agi::make_unique<VideoProviderCache>(std::move(parent));
 }
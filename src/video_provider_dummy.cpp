@@ -57,6 +57,12 @@ DummyVideoProvider::DummyVideoProvider(double fps, int frames, int width, int he
 , width(width)
 , height(height)
 {
+	auto image = std::make_shared<VideoFrame>();
+	image->width = width;
+	image->height = height;
+	image->pitch = width * 4;
+	image->flipped = false;
+	auto& data = image->data;
 	data.resize(width * height * 4);
 
 	auto red = colour.r;
@@ -89,18 +95,16 @@ DummyVideoProvider::DummyVideoProvider(double fps, int frames, int width, int he
 	else {
 		fill_pixels(dst, colors[0]);
 	}
+
+	frame = std::move(image);
 }
 
 std::string DummyVideoProvider::MakeFilename(double fps, int frames, int width, int height, agi::Color colour, bool pattern) {
 	return agi::format("?dummy:%f:%d:%d:%d:%d:%d:%d:%s", fps, frames, width, height, (int)colour.r, (int)colour.g, (int)colour.b, (pattern ? "c" : ""));
 }
 
-void DummyVideoProvider::GetFrame(int, VideoFrame &frame) {
-	frame.data    = data;
-	frame.width   = width;
-	frame.height  = height;
-	frame.pitch   = width * 4;
-	frame.flipped = false;
+void DummyVideoProvider::GetFrame(int, VideoFrame &out) {
+	out = *frame;
 }
 
 namespace agi { class BackgroundRunner; }
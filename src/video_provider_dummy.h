@@ -47,8 +47,8 @@ class DummyVideoProvider final : public VideoProvider {
 	int width;               ///< Width in pixels
 	int height;              ///< Height in pixels
 
-	/// The data for the image returned for all frames
-	std::vector<unsigned char> data;
+	/// The image returned for all frames, shared by everything showing it
+	std::shared_ptr<const VideoFrame> frame;
 
 public:
 	/// Create a dummy video from separate parameters
@@ -65,6 +65,7 @@ public:
 	static std::string MakeFilename(double fps, int frames, int width, int height, agi::Color colour, bool pattern);
 
 	void GetFrame(int n, VideoFrame &frame) override;
+	std::shared_ptr<const VideoFrame> GetSharedFrame(int, VideoFramePool &) override { return frame; }
 	void SetColorSpace(std::string const&) override { }
 
 	int GetFrameCount()             const override { return framecount; }
@@ -76,4 +77,5 @@ public:
 	std::string GetColorSpace()     const override { return "None"; }
 	std::string GetDecoderName()    const override { return "Dummy Video Provider"; }
 	bool ShouldSetVideoProperties() const override { return false; }
+	bool HasStaticFrame() const override           { return true; }
 };
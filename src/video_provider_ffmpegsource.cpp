@@ -43,6 +43,10 @@
 #include <libaegisub/fs.h>
 #include <libaegisub/make_unique.h>
 
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
 namespace {
 typedef enum AGI_ColorSpaces {
 	AGI_CS_RGB = 0,
@@ -66,10 +70,17 @@ typedef enum AGI_ColorSpaces {
 class FFmpegSourceVideoProvider final : public VideoProvider, FFmpegSourceProvider {
 	/// video source object
 	agi::scoped_holder<FFMS_VideoSource*, void (FFMS_CC*)(FFMS_VideoSource*)> VideoSource;
+	/// Optional second source for random access, so that seeking around
+	/// doesn't throw away the decoder state of sequential playback
+	agi::scoped_holder<FFMS_VideoSource*, void (FFMS_CC*)(FFMS_VideoSource*)> SeekSource;
+	int LastFrame = -1;             ///< Last frame requested
+	bool OutputYUV = false;         ///< Are frames output as YUV for the display to convert?
 	const FFMS_VideoProperties *VideoInfo = nullptr; ///< video properties
 
-	int Width = -1;                 ///< width in pixels
-	int Height = -1;                ///< height in pixels
+	int Width = -1;                 ///< width in pixels of decoded frames
+	int Height = -1;                ///< height in pixels of decoded frames
+	int FullWidth = -1;             ///< width in pixels of the video
+	int FullHeight = -1;            ///< height in pixels of the video
 	int CS = -1;                    ///< Reported colorspace of first frame
 	int CR = -1;                    ///< Reported colorrange of first frame
 	double DAR;                     ///< display aspect ratio
@@ -83,6 +94,7 @@ class FFmpegSourceVideoProvider final : public VideoProvider, FFmpegSourceProvid
 	bool has_audio = false;
 
 	void LoadVideo(agi::fs::path const& filename, std::string const& colormatrix);
+	void SetFullSize(VideoFrame &out) const;
 
 public:
 	FFmpegSourceVideoProvider(agi::fs::path const& filename, std::string const& colormatrix, agi::BackgroundRunner *br);
@@ -92,12 +104,16 @@ public:
 	void SetColorSpace(std::string const& matrix) override {
 #if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (1 << 8) | 0)
 		if (matrix == ColorSpace) return;
+		int NewCS;
 		if (matrix == RealColorSpace)
-			FFMS_SetInputFormatV(VideoSource, CS, CR, FFMS_GetPixFmt(""), nullptr);
+			NewCS = CS;
 		else if (matrix == "TV.601")
-			FFMS_SetInputFormatV(VideoSource, AGI_CS_BT470BG, CR, FFMS_GetPixFmt(""), nullptr);
+			NewCS = AGI_CS_BT470BG;
 		else
 			return;
+		FFMS_SetInputFormatV(VideoSource, NewCS, CR, FFMS_GetPixFmt(""), nullptr);
+		if (SeekSource)
+			FFMS_SetInputFormatV(SeekSource, NewCS, CR, FFMS_GetPixFmt(""), nullptr);
 		ColorSpace = matrix;
 #endif
 	}
@@ -105,12 +121,12 @@ public:
 	int GetFrameCount() const override             { return VideoInfo->NumFrames; }
 
 #if FFMS_VERSION >= ((2 << 24) | (24 << 16) | (0 << 8) | 0)
-	int GetWidth() const override  { return (VideoInfo->Rotation % 180 == 90 || VideoInfo->Rotation % 180 == -90) ? Height : Width; }
-	int GetHeight() const override { return (VideoInfo->Rotation % 180 == 90 || VideoInfo->Rotation % 180 == -90) ? Width : Height; }
+	int GetWidth() const override  { return (VideoInfo->Rotation % 180 == 90 || VideoInfo->Rotation % 180 == -90) ? FullHeight : FullWidth; }
+	int GetHeight() const override { return (VideoInfo->Rotation % 180 == 90 || VideoInfo->Rotation % 180 == -90) ? FullWidth : FullHeight; }
 	double GetDAR() const override { return (VideoInfo->Rotation % 180 == 90 || VideoInfo->Rotation % 180 == -90) ? 1 / DAR : DAR; }
 #else
-	int GetWidth() const override                  { return Width; }
-	int GetHeight() const override                 { return Height; }
+	int GetWidth() const override                  { return FullWidth; }
+	int GetHeight() const override                 { return FullHeight; }
 	double GetDAR() const override                 { return DAR; }
 #endif
 
@@ -123,6 +139,10 @@ public:
 	bool HasAudio() const override                 { return has_audio; }
 };
 
+/// Largest jump forward which is still decoded by the playback source
+/// rather than the seek source
+const int sequential_distance = 16;
+
 std::string colormatrix_description(int cs, int cr) {
 	// Assuming TV for unspecified
 	std::string str = cr == FFMS_CR_JPEG ? "PC" : "TV";
@@ -147,6 +167,7 @@ std::string colormatrix_description(int cs, int cr) {
 FFmpegSourceVideoProvider::FFmpegSourceVideoProvider(agi::fs::path const& filename, std::string const& colormatrix, agi::BackgroundRunner *br) try
 : FFmpegSourceProvider(br)
 , VideoSource(nullptr, FFMS_DestroyVideoSource)
+, SeekSource(nullptr, FFMS_DestroyVideoSource)
 {
 	ErrInfo.Buffer		= FFMSErrMsg;
 	ErrInfo.BufferSize	= sizeof(FFMSErrMsg);
@@ -186,17 +207,13 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	auto CacheName = GetCacheFilename(filename);
 
 	// try to read index
-	agi::scoped_holder<FFMS_Index*, void (FFMS_CC*)(FFMS_Index*)>
-		Index(FFMS_ReadIndex(CacheName.string().c_str(), &ErrInfo), FFMS_DestroyIndex);
-
-	if (Index && FFMS_IndexBelongsToFile(Index, filename.string().c_str(), &ErrInfo))
-		Index = nullptr;
+	auto Index = ReadCachedIndex(filename, CacheName);
 
 	// time to examine the index and check if the track we want is indexed
 	// technically this isn't really needed since all video tracks should always be indexed,
 	// but a bit of sanity checking never hurt anyone
 	if (Index && TrackNumber >= 0) {
-		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index, TrackNumber);
+		FFMS_Track *TempTrackData = FFMS_GetTrackFromIndex(Index.get(), TrackNumber);
 		if (FFMS_GetNumFrames(TempTrackData) <= 0)
 			Index = nullptr;
 	}
@@ -221,30 +238,30 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	// track number still not set?
 	if (TrackNumber < 0) {
 		// just grab the first track
-		TrackNumber = FFMS_GetFirstIndexedTrackOfType(Index, FFMS_TYPE_VIDEO, &ErrInfo);
+		TrackNumber = FFMS_GetFirstIndexedTrackOfType(Index.get(), FFMS_TYPE_VIDEO, &ErrInfo);
 		if (TrackNumber < 0)
 			throw VideoNotSupported(std::string("Couldn't find any video tracks: ") + ErrInfo.Buffer);
 	}
 
 	// Check if there's an audio track
-	has_audio = FFMS_GetFirstTrackOfType(Index, FFMS_TYPE_AUDIO, nullptr) != -1;
+	has_audio = FFMS_GetFirstTrackOfType(Index.get(), FFMS_TYPE_AUDIO, nullptr) != -1;
 
 	// set thread count
 	int Threads = OPT_GET("Provider/Video/FFmpegSource/Decoding Threads")->GetInt();
+	if (Threads < 1)
+		Threads = std::max<int>(1, std::thread::hardware_concurrency());
 #if FFMS_VERSION < ((2 << 24) | (30 << 16) | (0 << 8) | 0)
-	if (FFMS_GetVersion() < ((2 << 24) | (17 << 16) | (2 << 8) | 1) && FFMS_GetSourceType(Index) == FFMS_SOURCE_LAVF)
+	if (FFMS_GetVersion() < ((2 << 24) | (17 << 16) | (2 << 8) | 1) && FFMS_GetSourceType(Index.get()) == FFMS_SOURCE_LAVF)
 		Threads = 1;
 #endif
 
-	// set seekmode
-	// TODO: give this its own option?
-	int SeekMode;
-	if (OPT_GET("Provider/Video/FFmpegSource/Unsafe Seeking")->GetBool())
-		SeekMode = FFMS_SEEK_UNSAFE;
-	else
-		SeekMode = FFMS_SEEK_NORMAL;
+	// set seekmode; the option is the index into the choices shown in the
+	// preferences, which start at FFMS_SEEK_LINEAR_NO_RW
+	int SeekMode = mid<int>(FFMS_SEEK_LINEAR_NO_RW,
+		FFMS_SEEK_LINEAR_NO_RW + OPT_GET("Provider/Video/FFmpegSource/Seek Mode")->GetInt(),
+		FFMS_SEEK_AGGRESSIVE);
 
-	VideoSource = FFMS_CreateVideoSource(filename.string().c_str(), TrackNumber, Index, Threads, SeekMode, &ErrInfo);
+	VideoSource = FFMS_CreateVideoSource(filename.string().c_str(), TrackNumber, Index.get(), Threads, SeekMode, &ErrInfo);
 	if (!VideoSource)
 		throw VideoOpenError(std::string("Failed to open video track: ") + ErrInfo.Buffer);
 
@@ -281,10 +298,40 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 	}
 #endif
 
-	const int TargetFormat[] = { FFMS_GetPixFmt("bgra"), -1 };
+	// The display can convert YUV itself, except for RGB video and video
+	// which has to be flipped or rotated first
+	OutputYUV = OPT_GET("Provider/Video/FFmpegSource/YUV Output")->GetBool() && CS != AGI_CS_RGB;
+#if FFMS_VERSION >= ((2 << 24) | (24 << 16) | (0 << 8) | 0)
+	OutputYUV = OutputYUV && VideoInfo->Rotation % 360 == 0;
+#endif
+#if FFMS_VERSION >= ((2 << 24) | (31 << 16) | (0 << 8) | 0)
+	OutputYUV = OutputYUV && VideoInfo->Flip == 0;
+#endif
+
+	// Very large video can be decoded at reduced resolution to keep seeking
+	// fast; everything outside of the provider still sees the full size
+	FullWidth = Width;
+	FullHeight = Height;
+	int divisor = 1 << mid<int64_t>(0, OPT_GET("Provider/Video/Proxy Resolution")->GetInt(), 2);
+	Width = std::max(1, Width / divisor);
+	Height = std::max(1, Height / divisor);
+
+	const int TargetFormat[] = { FFMS_GetPixFmt(OutputYUV ? "yuv420p" : "bgra"), -1 };
 	if (FFMS_SetOutputFormatV2(VideoSource, TargetFormat, Width, Height, FFMS_RESIZER_BICUBIC, &ErrInfo))
 		throw VideoOpenError(std::string("Failed to set output format: ") + ErrInfo.Buffer);
 
+	if (OPT_GET("Provider/Video/FFmpegSource/Seek Source")->GetBool()) {
+		SeekSource = FFMS_CreateVideoSource(filename.string().c_str(), TrackNumber, Index.get(), Threads, SeekMode, &ErrInfo);
+		if (!SeekSource)
+			throw VideoOpenError(std::string("Failed to open video track: ") + ErrInfo.Buffer);
+#if FFMS_VERSION >= ((2 << 24) | (17 << 16) | (1 << 8) | 0)
+		if (CS != VideoCS && FFMS_SetInputFormatV(SeekSource, CS, CR, FFMS_GetPixFmt(""), &ErrInfo))
+			throw VideoOpenError(std::string("Failed to set input format: ") + ErrInfo.Buffer);
+#endif
+		if (FFMS_SetOutputFormatV2(SeekSource, TargetFormat, Width, Height, FFMS_RESIZER_BICUBIC, &ErrInfo))
+			throw VideoOpenError(std::string("Failed to set output format: ") + ErrInfo.Buffer);
+	}
+
 	// get frame info data
 	FFMS_Track *FrameData = FFMS_GetTrackFromVideo(VideoSource);
 	if (FrameData == nullptr)
@@ -317,11 +364,46 @@ void FFmpegSourceVideoProvider::LoadVideo(agi::fs::path const& filename, std::st
 void FFmpegSourceVideoProvider::GetFrame(int n, VideoFrame &out) {
 	n = mid(0, n, GetFrameCount() - 1);
 
-	auto frame = FFMS_GetFrame(VideoSource, n, &ErrInfo);
+	// Playback and stepping forwards ask for the frames just after the last
+	// one, which the playback source can decode without seeking. Anything
+	// else goes to the seek source, if there is one, so scrubbing around
+	// doesn't make playback start over from a keyframe.
+	FFMS_VideoSource *Source = VideoSource;
+	if (SeekSource && !(n > LastFrame && n - LastFrame <= sequential_distance))
+		Source = SeekSource;
+	LastFrame = n;
+
+	auto frame = FFMS_GetFrame(Source, n, &ErrInfo);
 	if (!frame)
 		throw VideoDecodeError(std::string("Failed to retrieve frame: ") +  ErrInfo.Buffer);
 
+	if (OutputYUV) {
+		size_t luma_size = frame->Linesize[0] * Height;
+		size_t chroma_rows = (Height + 1) / 2;
+		size_t chroma_size = frame->Linesize[1] * chroma_rows;
+		out.data.resize(luma_size + 2 * chroma_size);
+
+		unsigned char *dst = out.data.data();
+		memcpy(dst, frame->Data[0], luma_size);
+		memcpy(dst + luma_size, frame->Data[1], chroma_size);
+		dst += luma_size + chroma_size;
+		size_t row = std::min(frame->Linesize[1], frame->Linesize[2]);
+		for (size_t y = 0; y < chroma_rows; ++y)
+			memcpy(dst + y * frame->Linesize[1], frame->Data[2] + y * frame->Linesize[2], row);
+
+		out.flipped = false;
+		out.width = Width;
+		out.height = Height;
+		out.pitch = frame->Linesize[0];
+		out.chroma_pitch = frame->Linesize[1];
+		out.yuv = true;
+		SetYUVMatrix(out, ColorSpace);
+		SetFullSize(out);
+		return;
+	}
+
 	out.data.assign(frame->Data[0], frame->Data[0] + frame->Linesize[0] * Height);
+	out.yuv = false;
 	out.flipped = false;
 	out.width = Width;
 	out.height = Height;
@@ -374,6 +456,17 @@ void FFmpegSourceVideoProvider::GetFrame(int n, VideoFrame &out) {
 		out.pitch = 4 * Height;
 	}
 #endif
+	SetFullSize(out);
+}
+
+void FFmpegSourceVideoProvider::SetFullSize(VideoFrame &out) const {
+	if (Width == FullWidth && Height == FullHeight) {
+		out.full_width = out.full_height = 0;
+		return;
+	}
+	bool rotated = out.width != (size_t)Width;
+	out.full_width = rotated ? FullHeight : FullWidth;
+	out.full_height = rotated ? FullWidth : FullHeight;
 }
 }
 
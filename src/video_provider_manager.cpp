@@ -19,6 +19,7 @@
 #include "factory_manager.h"
 #include "include/aegisub/video_provider.h"
 #include "options.h"
+#include "video_frame.h"
 
 #include <libaegisub/fs.h>
 #include <libaegisub/log.h>
@@ -102,3 +103,9 @@ std::unique_ptr<VideoProvider> VideoProviderFactory::GetProvider(agi::fs::path c
 	if (!supported) throw VideoNotSupported(msg);
 	throw VideoOpenError(msg);
 }
+
+std::shared_ptr<const VideoFrame> VideoProvider::GetSharedFrame(int n, VideoFramePool &pool) {
+	auto frame = pool.Get((size_t)GetWidth() * GetHeight() * 4);
+	GetFrame(n, *frame);
+	return frame;
+}
@@ -44,6 +44,7 @@
 #include <libaegisub/ycbcr_conv.h>
 
 #include <boost/algorithm/string/case_conv.hpp>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -134,10 +135,18 @@ class YUV4MPEGVideoProvider final : public VideoProvider {
 	/// each frame header can be found
 	std::vector<uint64_t> seek_table;
 
+	/// Position of the first frame header
+	uint64_t first_frame = 0;
+	/// The first frame's header, if every frame is assumed to have the same
+	/// header so that frames can be found without a seek table
+	std::string frame_header;
+
 	void ParseFileHeader(const std::vector<std::string>& tags);
 	Y4M_FrameFlags ParseFrameHeader(const std::vector<std::string>& tags);
 	std::vector<std::string> ReadHeader(uint64_t &startpos);
 	int IndexFile(uint64_t pos);
+	bool GuessFrameStride(uint64_t pos);
+	uint64_t FramePosition(int n);
 
 public:
 	YUV4MPEGVideoProvider(agi::fs::path const& filename);
@@ -193,11 +202,59 @@ YUV4MPEGVideoProvider::YUV4MPEGVideoProvider(agi::fs::path const& filename)
 	}
 	frame_sz	= luma_sz + chroma_sz*2;
 
-	num_frames = IndexFile(pos);
-	if (num_frames <= 0 || seek_table.empty())
+	first_frame = pos;
+	if (!GuessFrameStride(pos))
+		num_frames = IndexFile(pos);
+	if (num_frames <= 0 || (seek_table.empty() && frame_header.empty()))
 		throw VideoOpenError("Unable to determine file length");
 }
 
+/// @brief Try to find the frames without reading every frame header
+/// @param pos Position of the first frame header
+/// @return Could the number of frames be determined?
+///
+/// Nearly every file has a plain FRAME header before every frame, in which
+/// case the frames are at fixed intervals and indexing would just page in the
+/// entire file. GetFrame checks each header it reads and falls back to the
+/// seek table if the guess turns out to be wrong.
+bool YUV4MPEGVideoProvider::GuessFrameStride(uint64_t pos) {
+	uint64_t frame_pos = pos;
+	auto tags = ReadHeader(frame_pos);
+	if (tags.size() != 1 || tags.front() != "FRAME")
+		return false;
+
+	uint64_t stride = frame_pos - pos + frame_sz;
+	if ((file.size() - pos) % stride)
+		return false;
+
+	uint64_t frames = (file.size() - pos) / stride;
+	if (frames > (uint64_t)std::numeric_limits<int>::max())
+		return false;
+
+	frame_header.assign(file.read(pos, frame_pos - pos), frame_pos - pos);
+	num_frames = (int)frames;
+	return true;
+}
+
+/// @brief Get the position of a frame's data, indexing the file if needed
+uint64_t YUV4MPEGVideoProvider::FramePosition(int n) {
+	if (!frame_header.empty()) {
+		uint64_t pos = first_frame + (frame_header.size() + frame_sz) * n;
+		if (!memcmp(file.read(pos, frame_header.size()), frame_header.data(), frame_header.size()))
+			return pos + frame_header.size();
+
+		LOG_I("provider/video/yuv4mpeg") << "frame " << n << " has an unexpected header; indexing file";
+		frame_header.clear();
+		int frames = IndexFile(first_frame);
+		if (frames != num_frames)
+			LOG_W("provider/video/yuv4mpeg") << "found " << frames << " frames rather than " << num_frames;
+	}
+
+	if (seek_table.empty())
+		throw VideoDecodeError("Unable to find frame in file");
+	return seek_table[std::min<size_t>(n, seek_table.size() - 1)];
+}
+
 /// @brief Read a frame or file header at a given file position
 /// @param startpos		The byte offset at where to start reading
 /// @return				A list of parameters
@@ -390,9 +447,24 @@ int YUV4MPEGVideoProvider::IndexFile(uint64_t pos) {
 void YUV4MPEGVideoProvider::GetFrame(int n, VideoFrame &frame) {
 	n = mid(0, n, num_frames - 1);
 
-	int uv_width = w / 2;
+	auto src_y = reinterpret_cast<const unsigned char *>(file.read(FramePosition(n), luma_sz + chroma_sz * 2));
 
-	auto src_y = reinterpret_cast<const unsigned char *>(file.read(seek_table[n], luma_sz + chroma_sz * 2));
+	frame.flipped = false;
+	frame.width = w;
+	frame.height = h;
+
+	// The planes are already laid out the way the display wants YUV frames,
+	// so they can be copied straight out of the mapping
+	if (w % 2 == 0 && h % 2 == 0) {
+		frame.data.assign(src_y, src_y + frame_sz);
+		frame.pitch = w;
+		frame.chroma_pitch = w / 2;
+		frame.yuv = true;
+		SetYUVMatrix(frame, "TV.601");
+		return;
+	}
+
+	int uv_width = w / 2;
 	auto src_u = src_y + luma_sz;
 	auto src_v = src_u + chroma_sz;
 	frame.data.resize(w * h * 4);
@@ -419,10 +491,8 @@ void YUV4MPEGVideoProvider::GetFrame(int n, VideoFrame &frame) {
 		}
 	}
 
-	frame.flipped = false;
-	frame.width = w;
-	frame.height = h;
 	frame.pitch = w * 4;
+	frame.yuv = false;
 }
 }
 
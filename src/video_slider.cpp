@@ -43,10 +43,34 @@
 #include "project.h"
 #include "utils.h"
 #include "video_controller.h"
+#include "video_frame.h"
+#include "video_thumbnails.h"
 
 #include <wx/dcbuffer.h>
+#include <wx/dcclient.h>
+#include <wx/popupwin.h>
 #include <wx/settings.h>
 
+class VideoSlider::Preview final : public wxPopupWindow {
+	wxBitmap bitmap;
+
+	void OnPaint(wxPaintEvent &) {
+		wxPaintDC dc(this);
+		dc.DrawBitmap(bitmap, 0, 0);
+	}
+
+public:
+	Preview(wxWindow *parent) : wxPopupWindow(parent) {
+		Bind(wxEVT_PAINT, &Preview::OnPaint, this);
+	}
+
+	void SetBitmap(wxBitmap const& new_bitmap) {
+		bitmap = new_bitmap;
+		SetClientSize(bitmap.GetWidth(), bitmap.GetHeight());
+		Refresh(false);
+	}
+};
+
 VideoSlider::VideoSlider (wxWindow* parent, agi::Context *c)
 : wxWindow(parent, -1, wxDefaultPosition, wxDefaultSize, wxWANTS_CHARS | wxFULL_REPAINT_ON_RESIZE)
 , c(c)
@@ -74,12 +98,37 @@ void VideoSlider::SetValue(int value) {
 }
 
 void VideoSlider::VideoOpened(AsyncVideoProvider *provider) {
+	HidePreview();
+	seek_pending = false;
+	thumbnails = provider ? provider->GetThumbnails() : nullptr;
 	if (provider) {
 		max = provider->GetFrameCount() - 1;
 		Refresh(false);
 	}
 }
 
+bool VideoSlider::ShowPreview(int x, int frame) {
+	VideoFrame thumbnail;
+	if (!thumbnails || !thumbnails->Get(frame, thumbnail)) {
+		HidePreview();
+		return false;
+	}
+
+	if (!preview)
+		preview = new Preview(this);
+	preview->SetBitmap(wxBitmap(GetImage(thumbnail)));
+
+	int w = preview->GetSize().GetWidth(), h = preview->GetSize().GetHeight();
+	preview->Move(ClientToScreen(wxPoint(x - w / 2, -h - 2)));
+	preview->Show();
+	return true;
+}
+
+void VideoSlider::HidePreview() {
+	if (preview)
+		preview->Hide();
+}
+
 void VideoSlider::KeyframesChanged(std::vector<int> const& newKeyframes) {
 	keyframes = newKeyframes;
 	Refresh(false);
@@ -110,6 +159,9 @@ BEGIN_EVENT_TABLE(VideoSlider, wxWindow)
 END_EVENT_TABLE()
 
 void VideoSlider::OnMouse(wxMouseEvent &event) {
+	if (event.Leaving())
+		HidePreview();
+
 	bool had_focus = HasFocus();
 	if (event.ButtonDown())
 		SetFocus();
@@ -142,6 +194,18 @@ void VideoSlider::OnMouse(wxMouseEvent &event) {
 			SetValue(go);
 		}
 
+		// While dragging, only the preview follows the mouse if there is one,
+		// and the video seeks once the button is released
+		if (event.Dragging() && ShowPreview(x, val)) {
+			seek_pending = true;
+			return;
+		}
+
+		seek_pending = false;
+		c->videoController->JumpToFrame(val);
+	}
+	else if (event.LeftUp() && seek_pending) {
+		seek_pending = false;
 		c->videoController->JumpToFrame(val);
 	}
 	else if (event.GetWheelRotation() != 0 && ForwardMouseWheelEvent(this, event)) {
@@ -156,6 +220,8 @@ void VideoSlider::OnMouse(wxMouseEvent &event) {
 			c->videoController->JumpToFrame(val);
 		}
 	}
+	else if (event.Moving())
+		ShowPreview(event.GetX(), GetValueAtX(event.GetX()));
 }
 
 void VideoSlider::OnCharHook(wxKeyEvent &event) {
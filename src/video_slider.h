@@ -29,6 +29,7 @@
 
 #include <libaegisub/signal.h>
 
+#include <memory>
 #include <vector>
 #include <wx/window.h>
 
@@ -36,6 +37,7 @@ namespace agi { struct Context; }
 
 class VideoController;
 class AsyncVideoProvider;
+class VideoThumbnails;
 
 /// @class VideoSlider
 /// @brief Slider for displaying and adjusting the video position
@@ -47,6 +49,19 @@ class VideoSlider: public wxWindow {
 	int val = 0; ///< Current frame number
 	int max = 1; ///< Last frame number
 
+	class Preview;
+	/// Thumbnails of the video for previewing seeks, if available
+	std::shared_ptr<VideoThumbnails> thumbnails;
+	/// Popup showing the thumbnail of the frame under the mouse
+	Preview *preview = nullptr;
+	/// Has the slider been dragged without seeking the video yet?
+	bool seek_pending = false;
+
+	/// @brief Show the thumbnail for a frame above the given x coordinate
+	/// @return Was there a thumbnail to show?
+	bool ShowPreview(int x, int frame);
+	void HidePreview();
+
 	/// Get the frame number for the given x coordinate
 	int GetValueAtX(int x);
 	/// Get the x-coordinate for a frame number
@@ -0,0 +1,152 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include "video_thumbnails.h"
+
+#include "video_frame.h"
+
+#include <libaegisub/fs.h>
+
+#include <algorithm>
+#include <boost/filesystem/operations.hpp>
+#include <cstring>
+
+std::vector<int> VideoThumbnails::ChooseFrames(std::vector<int> const& keyframes, int frame_count) {
+	std::vector<int> frames;
+	if (frame_count <= 0) return frames;
+
+	if (!keyframes.empty() && keyframes.size() <= max_thumbnails) {
+		for (int frame : keyframes) {
+			if (frame >= 0 && frame < frame_count)
+				frames.push_back(frame);
+		}
+		return frames;
+	}
+
+	// Space the frames evenly, but still move each back to the keyframe
+	// before it if there are keyframes
+	size_t count = std::min<size_t>(max_thumbnails, frame_count);
+	for (size_t i = 0; i < count; ++i) {
+		int frame = static_cast<int>((int64_t)i * frame_count / count);
+		auto it = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+		if (it != keyframes.begin())
+			frame = *--it;
+		if (frames.empty() || frames.back() < frame)
+			frames.push_back(frame);
+	}
+	return frames;
+}
+
+VideoThumbnails::VideoThumbnails(std::vector<int> frames, int video_width, int video_height, agi::fs::path const& dir)
+: frames(std::move(frames))
+, width(thumbnail_width)
+, height(video_width > 0 ? std::max<size_t>(1, (size_t)video_height * thumbnail_width / video_width) : thumbnail_width * 9 / 16)
+, file(boost::filesystem::unique_path(dir / "thumbnails-%%%%-%%%%-%%%%.tmp"), std::max<size_t>(this->frames.size(), 1) * width * height * 4)
+, ready(new std::atomic<bool>[this->frames.size()])
+{
+	for (size_t i = 0; i < this->frames.size(); ++i)
+		ready[i] = false;
+}
+
+std::vector<size_t> VideoThumbnails::BuildOrder() const {
+	std::vector<size_t> order;
+	order.reserve(frames.size());
+	std::vector<bool> added(frames.size());
+
+	size_t step = 1;
+	while (step * 2 < frames.size())
+		step *= 2;
+	for (; step > 0; step /= 2) {
+		for (size_t i = 0; i < frames.size(); i += step) {
+			if (!added[i]) {
+				added[i] = true;
+				order.push_back(i);
+			}
+		}
+	}
+	return order;
+}
+
+void VideoThumbnails::Store(size_t i, VideoFrame const& frame) {
+	if (i >= frames.size() || !frame.width || !frame.height) return;
+
+	VideoFrame converted;
+	VideoFrame const* src = &frame;
+	if (frame.yuv) {
+		ConvertToBGRA(frame, nullptr, converted);
+		src = &converted;
+	}
+
+	// Average each box of source pixels which maps to a thumbnail pixel
+	std::vector<unsigned char> thumbnail(width * height * 4);
+	auto dst = thumbnail.data();
+	for (size_t y = 0; y < height; ++y) {
+		size_t y0 = y * src->height / height;
+		size_t y1 = std::max(y0 + 1, (y + 1) * src->height / height);
+		for (size_t x = 0; x < width; ++x) {
+			size_t x0 = x * src->width / width;
+			size_t x1 = std::max(x0 + 1, (x + 1) * src->width / width);
+
+			uint32_t sum[4] = {0, 0, 0, 0};
+			for (size_t sy = y0; sy < y1; ++sy) {
+				size_t row = src->flipped ? src->height - 1 - sy : sy;
+				auto px = &src->data[row * src->pitch + x0 * 4];
+				for (size_t sx = x0; sx < x1; ++sx, px += 4) {
+					sum[0] += px[0];
+					sum[1] += px[1];
+					sum[2] += px[2];
+					sum[3] += px[3];
+				}
+			}
+
+			uint32_t n = (uint32_t)((y1 - y0) * (x1 - x0));
+			for (int c = 0; c < 4; ++c)
+				*dst++ = (unsigned char)(sum[c] / n);
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	memcpy(file.write(i * thumbnail.size(), thumbnail.size()), thumbnail.data(), thumbnail.size());
+	ready[i] = true;
+}
+
+bool VideoThumbnails::Get(int frame, VideoFrame &out) {
+	if (frames.empty()) return false;
+
+	size_t i = std::upper_bound(frames.begin(), frames.end(), frame) - frames.begin();
+	if (i > 0) --i;
+
+	size_t found = frames.size();
+	for (size_t d = 0; d < frames.size() && found == frames.size(); ++d) {
+		if (i >= d && ready[i - d])
+			found = i - d;
+		else if (i + d < frames.size() && ready[i + d])
+			found = i + d;
+	}
+	if (found == frames.size()) return false;
+
+	size_t size = width * height * 4;
+	out.width = width;
+	out.height = height;
+	out.pitch = width * 4;
+	out.flipped = false;
+	out.yuv = false;
+
+	std::lock_guard<std::mutex> guard(lock);
+	auto data = file.read(found * size, size);
+	out.data.assign(data, data + size);
+	return true;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#pragma once
+
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/fs_fwd.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct VideoFrame;
+
+/// @class VideoThumbnails
+/// @brief Small copies of frames spread through a video, for previewing seeks
+///
+/// The thumbnails are written to a memory-mapped temporary file as the video
+/// worker decodes them, so a long video's worth doesn't stay in memory.
+/// They are read from the UI thread while still being built.
+class VideoThumbnails {
+	/// Frame number of each thumbnail, in order
+	std::vector<int> frames;
+	/// Size of each thumbnail in pixels
+	size_t width, height;
+
+	/// Thumbnail data, as BGRA with no padding
+	agi::temp_file_mapping file;
+	/// Which thumbnails have been stored
+	std::unique_ptr<std::atomic<bool>[]> ready;
+	/// The mapping's read and write windows aren't thread-safe
+	std::mutex lock;
+
+public:
+	/// Width in pixels of each thumbnail
+	static const size_t thumbnail_width = 160;
+	/// Most thumbnails to build for a single video
+	static const size_t max_thumbnails = 1000;
+
+	/// @brief Pick the frames to make thumbnails of
+	/// @param keyframes Keyframes of the video, if known
+	/// @param frame_count Number of frames in the video
+	///
+	/// Keyframes are the cheapest frames to decode, so they're used when
+	/// there aren't too many, and otherwise evenly spaced frames.
+	static std::vector<int> ChooseFrames(std::vector<int> const& keyframes, int frame_count);
+
+	/// @param frames Frames to make thumbnails of, in order
+	/// @param video_width Width of the video
+	/// @param video_height Height of the video
+	/// @param dir Directory to put the temporary file in
+	VideoThumbnails(std::vector<int> frames, int video_width, int video_height, agi::fs::path const& dir);
+
+	/// Number of thumbnails
+	size_t size() const { return frames.size(); }
+	/// Frame number of the ith thumbnail
+	int Frame(size_t i) const { return frames[i]; }
+
+	/// @brief Order to build the thumbnails in
+	///
+	/// Starts with thumbnails spread evenly over the whole video and then
+	/// fills in between them, so that every part of the video gets a rough
+	/// preview early on.
+	std::vector<size_t> BuildOrder() const;
+
+	/// Scale a frame down and store it as the ith thumbnail
+	void Store(size_t i, VideoFrame const& frame);
+
+	/// @brief Get the thumbnail closest to a frame
+	/// @param frame Frame number
+	/// @param[out] out BGRA frame to write the thumbnail to
+	/// @return Was there a thumbnail to get?
+	///
+	/// The thumbnail of the last chosen frame at or before the frame is used
+	/// if it's been built, and otherwise the nearest one which has.
+	bool Get(int frame, VideoFrame &out);
+};
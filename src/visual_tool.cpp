@@ -62,6 +62,9 @@ VisualToolBase::VisualToolBase(VideoDisplay *parent, agi::Context *context)
 void VisualToolBase::OnCommit(int type) {
 	holding = false;
 	dragging = false;
+	// Anything previewed went into this commit's undo state, and the lines
+	// may not exist any more
+	changed_lines.clear();
 
 	if (type == AssFile::COMMIT_NEW || type & AssFile::COMMIT_SCRIPTINFO) {
 		int script_w, script_h;
@@ -84,6 +87,7 @@ void VisualToolBase::OnSeek(int new_frame) {
 
 	AssDialogue *new_line = GetActiveDialogueLine();
 	if (new_line != active_line) {
+		CommitPreviewed();
 		dragging = false;
 		active_line = new_line;
 		OnLineChanged();
@@ -91,6 +95,7 @@ void VisualToolBase::OnSeek(int new_frame) {
 }
 
 void VisualToolBase::OnMouseCaptureLost(wxMouseCaptureLostEvent &) {
+	CommitPreviewed();
 	holding = false;
 	dragging = false;
 }
@@ -99,6 +104,7 @@ void VisualToolBase::OnActiveLineChanged(AssDialogue *new_line) {
 	if (!IsDisplayed(new_line))
 		new_line = nullptr;
 
+	CommitPreviewed();
 	holding = false;
 	dragging = false;
 	if (new_line != active_line) {
@@ -121,10 +127,27 @@ void VisualToolBase::Commit(wxString message) {
 	if (message.empty())
 		message = _("visual typesetting");
 
-	commit_id = c->ass->Commit(message, AssFile::COMMIT_DIAG_TEXT, commit_id);
+	if (changed_lines.empty())
+		commit_id = c->ass->Commit(message, AssFile::COMMIT_DIAG_TEXT, commit_id);
+	else {
+		std::vector<AssDialogue *> lines(changed_lines.begin(), changed_lines.end());
+		changed_lines.clear();
+		commit_id = c->ass->Commit(message, AssFile::COMMIT_DIAG_TEXT, lines, commit_id);
+	}
 	file_changed_connection.Unblock();
 }
 
+void VisualToolBase::PreviewChanges() {
+	c->videoController->PreviewLines(std::vector<const AssDialogue *>(changed_lines.begin(), changed_lines.end()));
+}
+
+void VisualToolBase::CommitPreviewed() {
+	// Not the virtual Commit, as the lines already have the changes and
+	// tools' own state may no longer match them
+	if (!changed_lines.empty())
+		VisualToolBase::Commit();
+}
+
 AssDialogue* VisualToolBase::GetActiveDialogueLine() {
 	AssDialogue *diag = c->selectionController->GetActiveLine();
 	if (IsDisplayed(diag))
@@ -132,6 +155,12 @@ AssDialogue* VisualToolBase::GetActiveDialogueLine() {
 	return nullptr;
 }
 
+void VisualToolBase::DrawBatched() {
+	gl.BeginBatch();
+	Draw();
+	gl.EndBatch();
+}
+
 void VisualToolBase::SetDisplayArea(int x, int y, int w, int h) {
 	if (x == video_pos.X() && y == video_pos.Y() && w == video_res.X() && h == video_res.Y()) return;
 
@@ -193,11 +222,13 @@ void VisualTool<FeatureType>::OnMouseEvent(wxMouseEvent &event) {
 				sel->UpdateDrag(mouse_pos - drag_start, shift_down);
 			for (auto sel : sel_features)
 				UpdateDrag(sel);
-			Commit();
+			PreviewChanges();
 		}
 		// end drag
 		else {
 			dragging = false;
+			if (!changed_lines.empty())
+				Commit();
 
 			// mouse didn't move, fiddle with selection
 			if (active_feature && !active_feature->HasMoved()) {
@@ -224,7 +255,10 @@ void VisualTool<FeatureType>::OnMouseEvent(wxMouseEvent &event) {
 		}
 
 		UpdateHold();
-		Commit();
+		if (holding)
+			PreviewChanges();
+		else
+			Commit();
 
 	}
 	else if (left_click) {
@@ -330,10 +364,10 @@ void VisualTool<FeatureType>::RemoveSelection(FeatureType *feat) {
 typedef const std::vector<AssOverrideParameter> * param_vec;
 
 // Find a tag's parameters in a line or return nullptr if it's not found
-static param_vec find_tag(std::vector<std::unique_ptr<AssDialogueBlock>>& blocks, std::string const& tag_name) {
+static param_vec find_tag(AssDialogueBlockList const& blocks, AssTagId id) {
 	for (auto ovr : blocks | agi::of_type<AssDialogueBlockOverride>()) {
 		for (auto const& tag : ovr->Tags) {
-			if (tag.Name == tag_name)
+			if (tag.Id == id)
 				return &tag.Params;
 		}
 	}
@@ -353,10 +387,10 @@ static Vector2D vec_or_bad(param_vec tag, size_t x_idx, size_t y_idx) {
 }
 
 Vector2D VisualToolBase::GetLinePosition(AssDialogue *diag) {
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
-	if (Vector2D ret = vec_or_bad(find_tag(blocks, "\\pos"), 0, 1)) return ret;
-	if (Vector2D ret = vec_or_bad(find_tag(blocks, "\\move"), 0, 1)) return ret;
+	if (Vector2D ret = vec_or_bad(find_tag(*blocks, AssTagId::POS), 0, 1)) return ret;
+	if (Vector2D ret = vec_or_bad(find_tag(*blocks, AssTagId::MOVE), 0, 1)) return ret;
 
 	// Get default position
 	auto margin = diag->Margin;
@@ -372,9 +406,9 @@ Vector2D VisualToolBase::GetLinePosition(AssDialogue *diag) {
 
 	param_vec align_tag;
 	int ovr_align = 0;
-	if ((align_tag = find_tag(blocks, "\\an")))
+	if ((align_tag = find_tag(*blocks, AssTagId::AN)))
 		ovr_align = (*align_tag)[0].Get<int>(ovr_align);
-	else if ((align_tag = find_tag(blocks, "\\a")))
+	else if ((align_tag = find_tag(*blocks, AssTagId::A)))
 		ovr_align = AssStyle::SsaToAss((*align_tag)[0].Get<int>(2));
 
 	if (ovr_align > 0 && ovr_align <= 9)
@@ -404,14 +438,14 @@ Vector2D VisualToolBase::GetLinePosition(AssDialogue *diag) {
 }
 
 Vector2D VisualToolBase::GetLineOrigin(AssDialogue *diag) {
-	auto blocks = diag->ParseTags();
-	return vec_or_bad(find_tag(blocks, "\\org"), 0, 1);
+	auto blocks = diag->ParsedTags();
+	return vec_or_bad(find_tag(*blocks, AssTagId::ORG), 0, 1);
 }
 
 bool VisualToolBase::GetLineMove(AssDialogue *diag, Vector2D &p1, Vector2D &p2, int &t1, int &t2) {
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
-	param_vec tag = find_tag(blocks, "\\move");
+	param_vec tag = find_tag(*blocks, AssTagId::MOVE);
 	if (!tag)
 		return false;
 
@@ -430,26 +464,26 @@ void VisualToolBase::GetLineRotation(AssDialogue *diag, float &rx, float &ry, fl
 	if (AssStyle *style = c->ass->GetStyle(diag->Style))
 		rz = style->angle;
 
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
-	if (param_vec tag = find_tag(blocks, "\\frx"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FRX))
 		rx = tag->front().Get(rx);
-	if (param_vec tag = find_tag(blocks, "\\fry"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FRY))
 		ry = tag->front().Get(ry);
-	if (param_vec tag = find_tag(blocks, "\\frz"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FRZ))
 		rz = tag->front().Get(rz);
-	else if ((tag = find_tag(blocks, "\\fr")))
+	else if ((tag = find_tag(*blocks, AssTagId::FR)))
 		rz = tag->front().Get(rz);
 }
 
 void VisualToolBase::GetLineShear(AssDialogue *diag, float& fax, float& fay) {
 	fax = fay = 0.f;
 
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
-	if (param_vec tag = find_tag(blocks, "\\fax"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FAX))
 		fax = tag->front().Get(fax);
-	if (param_vec tag = find_tag(blocks, "\\fay"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FAY))
 		fay = tag->front().Get(fay);
 }
 
@@ -461,11 +495,11 @@ void VisualToolBase::GetLineScale(AssDialogue *diag, Vector2D &scale) {
 		y = style->scaley;
 	}
 
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
-	if (param_vec tag = find_tag(blocks, "\\fscx"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FSCX))
 		x = tag->front().Get(x);
-	if (param_vec tag = find_tag(blocks, "\\fscy"))
+	if (param_vec tag = find_tag(*blocks, AssTagId::FSCY))
 		y = tag->front().Get(y);
 
 	scale = Vector2D(x, y);
@@ -474,12 +508,12 @@ void VisualToolBase::GetLineScale(AssDialogue *diag, Vector2D &scale) {
 void VisualToolBase::GetLineClip(AssDialogue *diag, Vector2D &p1, Vector2D &p2, bool &inverse) {
 	inverse = false;
 
-	auto blocks = diag->ParseTags();
-	param_vec tag = find_tag(blocks, "\\iclip");
+	auto blocks = diag->ParsedTags();
+	param_vec tag = find_tag(*blocks, AssTagId::ICLIP);
 	if (tag)
 		inverse = true;
 	else
-		tag = find_tag(blocks, "\\clip");
+		tag = find_tag(*blocks, AssTagId::CLIP);
 
 	if (tag && tag->size() == 4) {
 		p1 = vec_or_bad(tag, 0, 1);
@@ -492,16 +526,16 @@ void VisualToolBase::GetLineClip(AssDialogue *diag, Vector2D &p1, Vector2D &p2,
 }
 
 std::string VisualToolBase::GetLineVectorClip(AssDialogue *diag, int &scale, bool &inverse) {
-	auto blocks = diag->ParseTags();
+	auto blocks = diag->ParsedTags();
 
 	scale = 1;
 	inverse = false;
 
-	param_vec tag = find_tag(blocks, "\\iclip");
+	param_vec tag = find_tag(*blocks, AssTagId::ICLIP);
 	if (tag)
 		inverse = true;
 	else
-		tag = find_tag(blocks, "\\clip");
+		tag = find_tag(*blocks, AssTagId::CLIP);
 
 	if (tag && tag->size() == 4) {
 		return agi::format("m %d %d l %d %d %d %d %d %d"
@@ -526,13 +560,17 @@ void VisualToolBase::SetSelectedOverride(std::string const& tag, std::string con
 void VisualToolBase::SetOverride(AssDialogue* line, std::string const& tag, std::string const& value) {
 	if (!line) return;
 
-	std::string removeTag;
-	if (tag == "\\1c") removeTag = "\\c";
-	else if (tag == "\\frz") removeTag = "\\fr";
-	else if (tag == "\\pos") removeTag = "\\move";
-	else if (tag == "\\move") removeTag = "\\pos";
-	else if (tag == "\\clip") removeTag = "\\iclip";
-	else if (tag == "\\iclip") removeTag = "\\clip";
+	auto id = AssOverrideTag::IdFromName(tag);
+	auto remove_id = AssTagId::UNKNOWN;
+	switch (id) {
+		case AssTagId::COLOR1: remove_id = AssTagId::COLOR;  break;
+		case AssTagId::FRZ:    remove_id = AssTagId::FR;     break;
+		case AssTagId::POS:    remove_id = AssTagId::MOVE;   break;
+		case AssTagId::MOVE:   remove_id = AssTagId::POS;    break;
+		case AssTagId::CLIP:   remove_id = AssTagId::ICLIP;  break;
+		case AssTagId::ICLIP:  remove_id = AssTagId::CLIP;   break;
+		default: break;
+	}
 
 	// Get block at start
 	auto blocks = line->ParseTags();
@@ -542,8 +580,8 @@ void VisualToolBase::SetOverride(AssDialogue* line, std::string const& tag, std:
 		auto ovr = static_cast<AssDialogueBlockOverride*>(block);
 		// Remove old of same
 		for (size_t i = 0; i < ovr->Tags.size(); i++) {
-			std::string const& name = ovr->Tags[i].Name;
-			if (tag == name || removeTag == name) {
+			auto tag_id = ovr->Tags[i].Id;
+			if (tag_id != AssTagId::UNKNOWN && (tag_id == id || tag_id == remove_id)) {
 				ovr->Tags.erase(ovr->Tags.begin() + i);
 				i--;
 			}
@@ -554,6 +592,7 @@ void VisualToolBase::SetOverride(AssDialogue* line, std::string const& tag, std:
 	}
 	else
 		line->Text = "{" + tag + value + "}" + line->Text.get();
+	changed_lines.insert(line);
 }
 
 // If only export worked
@@ -113,10 +113,18 @@ protected:
 
 	agi::signal::Connection file_changed_connection;
 	int commit_id = -1; ///< Last used commit id for coalescing
+	/// Lines changed by SetOverride since the last commit
+	std::set<AssDialogue *> changed_lines;
 
 	/// @brief Commit the current file state
 	/// @param message Description of changes for undo
 	virtual void Commit(wxString message = wxString());
+	/// Show the changes made so far in a drag or hold on the video without
+	/// committing them, so that only the changed lines are re-rendered and
+	/// nothing else has to update until the mouse is released
+	virtual void PreviewChanges();
+	/// Commit changes which have only been previewed, if there are any
+	void CommitPreviewed();
 	bool IsDisplayed(AssDialogue *line) const;
 
 	/// Get the line's position if it's set, or it's default based on style if not
@@ -144,6 +152,8 @@ public:
 	// Stuff called by VideoDisplay
 	virtual void OnMouseEvent(wxMouseEvent &event)=0;
 	virtual void Draw()=0;
+	/// Draw the tool with all of its primitives batched together
+	void DrawBatched();
 	virtual void SetDisplayArea(int x, int y, int w, int h);
 	virtual void SetToolbar(wxToolBar *) { }
 	virtual ~VisualToolBase() = default;
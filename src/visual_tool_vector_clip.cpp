@@ -239,6 +239,11 @@ void VisualToolVectorClip::Commit(wxString message) {
 	VisualToolBase::Commit(message);
 }
 
+void VisualToolVectorClip::PreviewChanges() {
+	Save();
+	VisualToolBase::PreviewChanges();
+}
+
 void VisualToolVectorClip::UpdateDrag(Feature *feature) {
 	spline.MovePoint(spline.begin() + feature->idx, feature->point, feature->pos);
 }
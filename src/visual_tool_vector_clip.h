@@ -44,6 +44,7 @@ class VisualToolVectorClip final : public VisualTool<VisualToolVectorClipDraggab
 
 	void Save();
 	void Commit(wxString message="") override;
+	void PreviewChanges() override;
 
 	void MakeFeature(size_t idx);
 	void MakeFeatures();
@@ -0,0 +1,74 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/audio/provider.h>
+#include <libaegisub/make_unique.h>
+
+#include <thread>
+#include <vector>
+
+namespace {
+/// Ten minutes of synthetic 48 kHz stereo float audio, which has to go
+/// through the conversion provider before anything can use it
+struct SyntheticAudioProvider final : agi::AudioProvider {
+	SyntheticAudioProvider() {
+		channels = 2;
+		sample_rate = 48000;
+		num_samples = 10 * 60 * 48000;
+		decoded_samples = num_samples;
+		bytes_per_sample = sizeof(float);
+		float_samples = true;
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto out = static_cast<float *>(buf);
+		for (int64_t i = start; i < start + count; ++i) {
+			*out++ = (i % 480) / 480.f - 0.5f;
+			*out++ = (i % 320) / 320.f - 0.5f;
+		}
+	}
+};
+
+void read_all(bench::State& state, agi::AudioProvider const& provider) {
+	const int64_t chunk = 1 << 16;
+	std::vector<char> buffer(chunk * provider.GetBytesPerSample() * provider.GetChannels());
+	state.SetBytesPerIteration(provider.GetNumSamples() * provider.GetBytesPerSample() * provider.GetChannels());
+	while (state.Run()) {
+		for (int64_t start = 0; start < provider.GetNumSamples(); start += chunk)
+			provider.GetAudio(buffer.data(), start, chunk);
+		bench::Escape(buffer.data());
+	}
+}
+}
+
+BENCHMARK(lagi_audio, convert_float_stereo) {
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<SyntheticAudioProvider>());
+	read_all(state, *provider);
+}
+
+BENCHMARK(lagi_audio, ram_cache_read) {
+	auto provider = agi::CreateRAMAudioProvider(
+		agi::CreateConvertAudioProvider(agi::make_unique<SyntheticAudioProvider>()));
+	// Wait for the cache to fill so that only reads from it are measured
+	std::vector<char> buffer(provider->GetBytesPerSample());
+	provider->GetAudio(buffer.data(), provider->GetNumSamples() - 1, 1);
+	while (provider->GetDecodedSamples() < provider->GetNumSamples())
+		std::this_thread::yield();
+	read_all(state, *provider);
+}
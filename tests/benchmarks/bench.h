@@ -0,0 +1,90 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file bench.h
+/// @brief Minimal harness for timing libaegisub hot paths
+///
+/// Each benchmark does its setup and then repeats the code being measured
+/// for as long as State::Run() returns true; only the time spent in that
+/// loop is counted:
+///
+///     BENCHMARK(lagi_time, parse) {
+///         std::string str = "0:01:23.45";
+///         while (state.Run())
+///             bench::Escape(agi::Time(str));
+///     }
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace bench {
+class State {
+	using clock = std::chrono::steady_clock;
+
+	size_t remaining;
+	bool started = false;
+	clock::time_point start;
+	clock::time_point end;
+	int64_t bytes = 0;
+
+public:
+	explicit State(size_t iterations) : remaining(iterations) { }
+
+	/// Should the benchmark run another iteration?
+	bool Run() {
+		if (!started) {
+			started = true;
+			start = clock::now();
+		}
+		if (remaining == 0) {
+			end = clock::now();
+			return false;
+		}
+		--remaining;
+		return true;
+	}
+
+	/// Set how many bytes of input each iteration processes, so that the
+	/// throughput can be reported
+	void SetBytesPerIteration(int64_t count) { bytes = count; }
+	int64_t BytesPerIteration() const { return bytes; }
+
+	clock::duration Elapsed() const { return end - start; }
+};
+
+/// Make the compiler assume that the value is used, so that the code
+/// computing it isn't optimized away
+void Escape(const void *value);
+template<typename T>
+void Escape(T const& value) { Escape(static_cast<const void *>(&value)); }
+
+using Function = void (*)(State &);
+
+/// Adds a benchmark to the list run by main(); use BENCHMARK rather than
+/// creating these directly
+struct Registration {
+	Registration(const char *name, Function func);
+};
+}
+
+#define BENCHMARK(group, name) \
+	static void bench_##group##_##name(bench::State &state); \
+	static bench::Registration bench_registration_##group##_##name(#group "." #name, bench_##group##_##name); \
+	static void bench_##group##_##name(bench::State &state)
@@ -0,0 +1,46 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/ass/dialogue_parser.h>
+
+namespace {
+const std::string line =
+	"{\\k20}Ka{\\k15}ra{\\k30}o{\\k25}ke {\\1c&H00FF00&\\t(0,500,\\fscx120)}line"
+	"\\Nwith a {\\i1}break{\\i0} and {\\pos(320,240)\\an8}several tags";
+}
+
+BENCHMARK(lagi_dialogue_lexer, tokenize) {
+	state.SetBytesPerIteration(line.size());
+	while (state.Run()) {
+		auto tokens = agi::ass::TokenizeDialogueBody(line);
+		bench::Escape(tokens.data());
+	}
+}
+
+BENCHMARK(lagi_dialogue_lexer, retokenize_after_typing) {
+	auto edited = line;
+	edited.insert(edited.size() - 4, "x");
+	auto tokens = agi::ass::TokenizeDialogueBody(line);
+	bool toggle = false;
+	while (state.Run()) {
+		toggle = !toggle;
+		agi::ass::RetokenizeDialogueBody(toggle ? line : edited, toggle ? edited : line, tokens);
+		bench::Escape(tokens.data());
+	}
+}
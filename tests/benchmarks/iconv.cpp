@@ -0,0 +1,75 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/charset_conv.h>
+
+#include <string>
+
+namespace {
+std::string make_text() {
+	std::string text;
+	while (text.size() < 1 << 20)
+		text += "Dialogue: 0,0:00:01.00,0:00:02.00,Default,,0,0,0,,日本語のテキストと English text\n";
+	return text;
+}
+}
+
+BENCHMARK(lagi_iconv, utf8_to_utf16_1mb) {
+	auto text = make_text();
+	agi::charset::IconvWrapper conv("utf-8", "utf-16le");
+	std::string out;
+	state.SetBytesPerIteration(text.size());
+	while (state.Run()) {
+		conv.Convert(text, out);
+		bench::Escape(out.data());
+	}
+}
+
+BENCHMARK(lagi_iconv, utf8_to_utf8_1mb) {
+	auto text = make_text();
+	agi::charset::IconvWrapper conv("utf-8", "utf-8");
+	std::string out;
+	state.SetBytesPerIteration(text.size());
+	while (state.Run()) {
+		conv.Convert(text, out);
+		bench::Escape(out.data());
+	}
+}
+
+BENCHMARK(lagi_iconv, utf16_to_utf8_1mb) {
+	auto text = agi::charset::IconvWrapper("utf-8", "utf-16le").Convert(make_text());
+	agi::charset::IconvWrapper conv("utf-16le", "utf-8");
+	std::string out;
+	state.SetBytesPerIteration(text.size());
+	while (state.Run()) {
+		conv.Convert(text, out);
+		bench::Escape(out.data());
+	}
+}
+
+BENCHMARK(lagi_iconv, utf8_to_shift_jis_1mb) {
+	auto text = make_text();
+	agi::charset::IconvWrapper conv("utf-8", "shift_jis");
+	std::string out;
+	state.SetBytesPerIteration(text.size());
+	while (state.Run()) {
+		conv.Convert(text, out);
+		bench::Escape(out.data());
+	}
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/karaoke_matcher.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+const std::vector<std::string> syllables{
+	"ki", "mi", "no", "na", "ma", "e", "wo", "yo", "bu", "ko", "e", "ga",
+	"ki", "ko", "e", "ta", "ki", "ga", "shi", "ta", "a", "no", "hi", "no",
+	"yu", "u", "ga", "ta", "o", "mo", "i", "da", "su", "byo", "u", "shi", "n"
+};
+const std::string kanji = "君の名前を呼ぶ声が聞こえた気がしたあの日の夕方思い出す秒針";
+}
+
+BENCHMARK(lagi_karaoke_matcher, match_line) {
+	while (state.Run()) {
+		auto groups = agi::auto_match_karaoke_line(syllables, kanji);
+		bench::Escape(groups.data());
+	}
+}
+
+BENCHMARK(lagi_karaoke_matcher, match_syllable_by_syllable) {
+	while (state.Run()) {
+		std::vector<std::string> src = syllables;
+		std::string dst = kanji;
+		while (!src.empty()) {
+			auto match = agi::auto_match_karaoke(src, dst);
+			src.erase(src.begin(), src.begin() + std::max<size_t>(match.source_length, 1));
+			dst.erase(0, std::min(dst.size(), match.destination_length));
+		}
+		bench::Escape(dst);
+	}
+}
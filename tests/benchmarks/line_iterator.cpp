@@ -0,0 +1,56 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/charset_conv.h>
+#include <libaegisub/line_iterator.h>
+
+#include <sstream>
+#include <string>
+
+namespace {
+std::string make_file(size_t lines) {
+	std::string file;
+	for (size_t i = 0; i < lines; ++i)
+		file += "Dialogue: 0,0:00:01.00,0:00:02.00,Default,,0,0,0,,Some {\\i1}text{\\i0} here\r\n";
+	return file;
+}
+
+template<typename Func>
+void read_lines(bench::State& state, std::string const& encoding, std::string const& data, Func&& func) {
+	state.SetBytesPerIteration(data.size());
+	while (state.Run()) {
+		std::istringstream stream(data);
+		size_t count = 0;
+		for (auto const& line : agi::line_iterator<std::string>(stream, encoding)) {
+			func(line);
+			++count;
+		}
+		bench::Escape(count);
+	}
+}
+}
+
+BENCHMARK(lagi_line_iterator, utf8_10000_lines) {
+	read_lines(state, "utf-8", make_file(10000), [](std::string const& line) { bench::Escape(line.data()); });
+}
+
+BENCHMARK(lagi_line_iterator, utf16_10000_lines) {
+	auto data = agi::charset::IconvWrapper("utf-8", "utf-16le").Convert(make_file(10000));
+	read_lines(state, "utf-16le", data, [](std::string const& line) { bench::Escape(line.data()); });
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/cajun/elements.h>
+#include <libaegisub/cajun/writer.h>
+#include <libaegisub/dispatch.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/json.h>
+#include <libaegisub/log.h>
+
+#include <algorithm>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/locale/generator.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+struct Benchmark {
+	const char *name;
+	bench::Function func;
+};
+
+std::vector<Benchmark>& registry() {
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+struct Result {
+	size_t iterations;
+	int64_t ns_per_iteration;
+	int64_t bytes_per_iteration;
+};
+
+int64_t run_once(bench::Function func, size_t iterations, int64_t& bytes) {
+	bench::State state(iterations);
+	func(state);
+	bytes = state.BytesPerIteration();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(state.Elapsed()).count();
+}
+
+/// Time a benchmark, picking an iteration count which makes each sample take
+/// about sample_ns and reporting the median of several samples
+Result measure(bench::Function func, int64_t sample_ns) {
+	const int samples = 5;
+	int64_t bytes;
+
+	size_t iterations = 1;
+	int64_t elapsed = run_once(func, iterations, bytes);
+	while (elapsed < sample_ns / 10 && iterations < (1u << 30)) {
+		iterations *= 10;
+		elapsed = run_once(func, iterations, bytes);
+	}
+	if (elapsed < sample_ns)
+		iterations = std::max<size_t>(1, iterations * sample_ns / std::max<int64_t>(elapsed, 1));
+
+	std::vector<int64_t> times;
+	for (int i = 0; i < samples; ++i)
+		times.push_back(run_once(func, iterations, bytes) / iterations);
+	std::nth_element(times.begin(), times.begin() + samples / 2, times.end());
+
+	return Result{iterations, std::max<int64_t>(times[samples / 2], 1), bytes};
+}
+
+std::map<std::string, int64_t> read_baseline(std::string const& path) {
+	std::map<std::string, int64_t> baseline;
+	boost::filesystem::ifstream stream(path);
+	if (!stream)
+		throw std::runtime_error("Could not open baseline " + path);
+
+	auto root = agi::json_util::parse(stream);
+	json::Array const& benchmarks = static_cast<json::Object const&>(root).at("benchmarks");
+	for (json::Object const& benchmark : benchmarks) {
+		json::String const& name = benchmark.at("name");
+		json::Integer const& ns = benchmark.at("ns_per_iteration");
+		baseline[name] = ns;
+	}
+	return baseline;
+}
+
+const char *arg_value(const char *arg, const char *name) {
+	size_t len = strlen(name);
+	if (strncmp(arg, name, len) == 0 && arg[len] == '=')
+		return arg + len + 1;
+	return nullptr;
+}
+
+void usage() {
+	std::cerr <<
+		"Usage: bench [--filter=SUBSTRING] [--baseline=FILE] [--threshold=PERCENT] [--sample-ms=MS]\n"
+		"\n"
+		"Runs the benchmarks and writes the results to stdout as JSON. With a\n"
+		"baseline (such as benchmarks/baseline.json, which is itself the output of a\n"
+		"previous run), benchmarks more than PERCENT (default 25) slower than\n"
+		"their baseline are listed as regressions and the exit status is 1.\n";
+}
+}
+
+namespace bench {
+void Escape(const void *) { }
+
+Registration::Registration(const char *name, Function func) {
+	registry().push_back(Benchmark{name, func});
+}
+}
+
+int main(int argc, char **argv) {
+	std::string filter;
+	std::string baseline_path;
+	int64_t threshold = 25;
+	int64_t sample_ms = 50;
+
+	for (int i = 1; i < argc; ++i) {
+		if (auto value = arg_value(argv[i], "--filter"))
+			filter = value;
+		else if (auto value = arg_value(argv[i], "--baseline"))
+			baseline_path = value;
+		else if (auto value = arg_value(argv[i], "--threshold"))
+			threshold = atoi(value);
+		else if (auto value = arg_value(argv[i], "--sample-ms"))
+			sample_ms = std::max(1, atoi(value));
+		else {
+			usage();
+			return 2;
+		}
+	}
+
+	agi::dispatch::Init([](agi::dispatch::Thunk) { });
+	std::locale::global(boost::locale::generator().generate(""));
+	agi::log::log = new agi::log::LogSink;
+
+	std::map<std::string, int64_t> baseline;
+	if (!baseline_path.empty()) {
+		try {
+			baseline = read_baseline(baseline_path);
+		}
+		catch (std::exception const& e) {
+			std::cerr << e.what() << "\n";
+			return 2;
+		}
+	}
+
+	auto& benchmarks = registry();
+	sort(begin(benchmarks), end(benchmarks), [](Benchmark const& a, Benchmark const& b) {
+		return strcmp(a.name, b.name) < 0;
+	});
+
+	json::Array results;
+	json::Array regressions;
+	for (auto const& benchmark : benchmarks) {
+		if (!strstr(benchmark.name, filter.c_str())) continue;
+
+		std::cerr << benchmark.name << "... " << std::flush;
+		auto result = measure(benchmark.func, sample_ms * 1000000);
+		std::cerr << result.ns_per_iteration << " ns\n";
+
+		json::Object obj;
+		obj["name"] = std::string(benchmark.name);
+		obj["iterations"] = static_cast<int64_t>(result.iterations);
+		obj["ns_per_iteration"] = result.ns_per_iteration;
+		if (result.bytes_per_iteration)
+			obj["bytes_per_second"] = result.bytes_per_iteration * 1000000000 / result.ns_per_iteration;
+
+		auto it = baseline.find(benchmark.name);
+		if (it != end(baseline)) {
+			int64_t change = (result.ns_per_iteration - it->second) * 100 / it->second;
+			obj["baseline_ns_per_iteration"] = it->second;
+			obj["change_percent"] = change;
+			if (change > threshold)
+				regressions.push_back(std::string(benchmark.name));
+		}
+
+		results.push_back(std::move(obj));
+	}
+
+	bool regressed = !regressions.empty();
+	json::Object root;
+	root["benchmarks"] = std::move(results);
+	if (!baseline.empty())
+		root["regressions"] = std::move(regressions);
+	agi::JsonWriter::Write(root, std::cout);
+	std::cout << "\n";
+
+	delete agi::log::log;
+
+	return regressed ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+// Benchmarks for the parts of the video and audio rendering paths which are
+// in libaegisub: blending libass's coverage masks onto a frame, and
+// summarising audio peaks for the waveform at different zoom levels.
+
+#include "bench.h"
+
+#include <libaegisub/audio/provider.h>
+#include <libaegisub/blend.h>
+#include <libaegisub/make_unique.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+/// One image as libass produces them: an 8-bit coverage mask placed on the
+/// frame in a single colour
+struct MaskImage {
+	int x, y, w, h;
+	uint32_t color;
+	unsigned int opacity;
+	std::vector<uint8_t> mask;
+};
+
+/// An antialiased ring, which has about the same mix of empty, partial and
+/// full coverage as a glyph
+std::vector<uint8_t> make_glyph(int w, int h, int thickness) {
+	std::vector<uint8_t> mask(w * h);
+	int cx = w / 2, cy = h / 2;
+	int outer = std::min(cx, cy) - 1;
+	int inner = outer - thickness;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			int dx = x - cx, dy = y - cy;
+			int d2 = dx * dx + dy * dy;
+			int coverage = 0;
+			if (d2 <= outer * outer && d2 >= inner * inner)
+				coverage = 255;
+			else if (d2 <= (outer + 1) * (outer + 1) && d2 >= (inner - 1) * (inner - 1))
+				coverage = 128;
+			mask[y * w + x] = coverage;
+		}
+	}
+	return mask;
+}
+
+/// Two lines of typeset text on a 1080p frame: a shadow, border and fill
+/// image for each of 40 glyphs, plus a mostly empty full-width clip box
+std::vector<MaskImage> typeset_fixture() {
+	std::vector<MaskImage> images;
+	for (int line = 0; line < 2; ++line) {
+		for (int glyph = 0; glyph < 20; ++glyph) {
+			int x = 300 + glyph * 64;
+			int y = 820 + line * 110;
+			images.push_back(MaskImage{x + 4, y + 4, 64, 80, 0x000000, 128, make_glyph(64, 80, 14)});
+			images.push_back(MaskImage{x, y, 64, 80, 0x202020, 255, make_glyph(64, 80, 14)});
+			images.push_back(MaskImage{x + 3, y + 3, 58, 74, 0xFFFFFF, 255, make_glyph(58, 74, 8)});
+		}
+	}
+
+	MaskImage box{0, 100, 1920, 200, 0x3050F0, 160, std::vector<uint8_t>(1920 * 200)};
+	for (int y = 90; y < 110; ++y)
+		std::fill_n(&box.mask[y * 1920 + 200], 1520, 255);
+	images.push_back(std::move(box));
+	return images;
+}
+
+/// Ten minutes of dummy noise, so that the RAM cache doesn't need the
+/// dummy provider's full two and a half hours
+struct TenMinutes final : agi::AudioProviderWrapper {
+	TenMinutes() : AudioProviderWrapper(agi::CreateDummyAudioProvider("dummy-audio:noise?", nullptr)) {
+		decoded_samples = num_samples = 10 * 60 * sample_rate;
+	}
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		source->GetAudio(buf, start, count);
+	}
+};
+
+std::unique_ptr<agi::AudioProvider> const& cached_noise() {
+	static std::unique_ptr<agi::AudioProvider> provider;
+	if (!provider) {
+		provider = agi::CreateRAMAudioProvider(agi::make_unique<TenMinutes>());
+		while (provider->GetDecodedSamples() < provider->GetNumSamples())
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return provider;
+}
+
+/// Summarise one screen width of audio at the given number of samples per
+/// pixel, as the waveform renderer does for each column
+void waveform_screen(bench::State& state, int64_t samples_per_pixel) {
+	auto const& provider = cached_noise();
+	const int width = 1920;
+	int64_t span = samples_per_pixel * width;
+	int64_t start = 0;
+	while (state.Run()) {
+		if (start + span > provider->GetNumSamples())
+			start = 0;
+		for (int x = 0; x < width; ++x) {
+			auto peak = provider->GetPeaks(start + x * samples_per_pixel, samples_per_pixel);
+			bench::Escape(peak);
+		}
+		start += span / 3;
+	}
+}
+}
+
+BENCHMARK(lagi_render, blend_typeset_1080p_frame) {
+	auto images = typeset_fixture();
+	const int width = 1920, height = 1080;
+	std::vector<uint8_t> frame(width * height * 4);
+	while (state.Run()) {
+		for (auto const& img : images)
+			agi::BlendMask(&frame[(img.y * width + img.x) * 4], width * 4,
+				img.mask.data(), img.w, img.w, img.h, img.color, img.opacity);
+		bench::Escape(frame.data());
+	}
+}
+
+BENCHMARK(lagi_render, waveform_zoom_64) { waveform_screen(state, 64); }
+BENCHMARK(lagi_render, waveform_zoom_441) { waveform_screen(state, 441); }
+BENCHMARK(lagi_render, waveform_zoom_4410) { waveform_screen(state, 4410); }
+BENCHMARK(lagi_render, waveform_zoom_11025) { waveform_screen(state, 11025); }
@@ -0,0 +1,183 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+// These exercise the same work as loading, saving, snapshotting and sorting
+// a script in the application (line reading, field splitting, time parsing
+// and override tag tokenizing), using only libaegisub so that they can run
+// without wxWidgets.
+
+#include "bench.h"
+
+#include <script_generator.h>
+
+#include <libaegisub/ass/dialogue_parser.h>
+#include <libaegisub/ass/time.h>
+#include <libaegisub/line_iterator.h>
+
+#include <algorithm>
+#include <array>
+#include <boost/algorithm/string/predicate.hpp>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+struct Event {
+	bool comment;
+	int layer;
+	agi::Time start;
+	agi::Time end;
+	std::string style;
+	std::string actor;
+	std::array<int, 3> margin;
+	std::string effect;
+	std::string text;
+	std::vector<agi::ass::DialogueToken> tokens;
+};
+
+std::string next_field(std::string const& line, size_t& pos) {
+	size_t comma = line.find(',', pos);
+	auto field = line.substr(pos, comma - pos);
+	pos = comma == std::string::npos ? line.size() : comma + 1;
+	return field;
+}
+
+std::vector<Event> load(std::string const& data, bool karaoke_templater) {
+	std::vector<Event> events;
+	std::istringstream stream(data);
+	for (auto const& line : agi::line_iterator<std::string>(stream)) {
+		bool comment = boost::starts_with(line, "Comment: ");
+		if (!comment && !boost::starts_with(line, "Dialogue: ")) continue;
+
+		events.emplace_back();
+		auto& event = events.back();
+		size_t pos = comment ? 9 : 10;
+		event.comment = comment;
+		event.layer = atoi(next_field(line, pos).c_str());
+		event.start = agi::Time(next_field(line, pos));
+		event.end = agi::Time(next_field(line, pos));
+		event.style = next_field(line, pos);
+		event.actor = next_field(line, pos);
+		for (auto& margin : event.margin)
+			margin = atoi(next_field(line, pos).c_str());
+		event.effect = next_field(line, pos);
+		event.text = line.substr(pos);
+		event.tokens = agi::ass::TokenizeDialogueBody(event.text, karaoke_templater);
+	}
+	return events;
+}
+
+std::string save(std::vector<Event> const& events) {
+	std::string out;
+	for (auto const& event : events) {
+		out += event.comment ? "Comment: " : "Dialogue: ";
+		out += std::to_string(event.layer);
+		out += ',';
+		event.start.AppendAssFormatted(out);
+		out += ',';
+		event.end.AppendAssFormatted(out);
+		out += ',';
+		out += event.style;
+		out += ',';
+		out += event.actor;
+		for (int margin : event.margin) {
+			out += ',';
+			out += std::to_string(margin);
+		}
+		out += ',';
+		out += event.effect;
+		out += ',';
+		out += event.text;
+		out += '\n';
+	}
+	return out;
+}
+
+/// Generating and loading the larger scripts takes a while, and each
+/// benchmark function is called several times, so only do it once
+std::string const& script(size_t lines, util::ScriptKind kind) {
+	static std::map<std::pair<size_t, util::ScriptKind>, std::string> scripts;
+	auto& data = scripts[std::make_pair(lines, kind)];
+	if (data.empty())
+		data = util::generate_script(lines, kind);
+	return data;
+}
+
+std::vector<Event> const& loaded(size_t lines, util::ScriptKind kind) {
+	static std::map<std::pair<size_t, util::ScriptKind>, std::vector<Event>> events;
+	auto& loaded = events[std::make_pair(lines, kind)];
+	if (loaded.empty())
+		loaded = load(script(lines, kind), false);
+	return loaded;
+}
+
+void bench_load(bench::State& state, size_t lines, util::ScriptKind kind) {
+	auto const& data = script(lines, kind);
+	state.SetBytesPerIteration(data.size());
+	while (state.Run()) {
+		auto events = load(data, kind == util::ScriptKind::Karaoke);
+		bench::Escape(events.data());
+	}
+}
+
+void bench_save(bench::State& state, size_t lines, util::ScriptKind kind) {
+	auto const& events = loaded(lines, kind);
+	while (state.Run()) {
+		auto data = save(events);
+		bench::Escape(data.data());
+	}
+}
+
+/// Undo keeps a full copy of the events for each commit
+void bench_snapshot(bench::State& state, size_t lines, util::ScriptKind kind) {
+	auto const& events = loaded(lines, kind);
+	while (state.Run()) {
+		auto copy = events;
+		bench::Escape(copy.data());
+	}
+}
+
+/// The grid sorts pointers to the lines rather than the lines themselves
+void bench_sort(bench::State& state, size_t lines, util::ScriptKind kind) {
+	auto const& events = loaded(lines, kind);
+	std::vector<const Event *> unsorted;
+	for (auto const& event : events)
+		unsorted.push_back(&event);
+
+	while (state.Run()) {
+		auto sorted = unsorted;
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Event *a, const Event *b) {
+			return a->start < b->start;
+		});
+		bench::Escape(sorted.data());
+	}
+}
+}
+
+#define SCRIPT_BENCHMARKS(size, lines) \
+	BENCHMARK(lagi_script, load_tagged_##size) { bench_load(state, lines, util::ScriptKind::HeavyTags); } \
+	BENCHMARK(lagi_script, load_karaoke_##size) { bench_load(state, lines, util::ScriptKind::Karaoke); } \
+	BENCHMARK(lagi_script, save_tagged_##size) { bench_save(state, lines, util::ScriptKind::HeavyTags); } \
+	BENCHMARK(lagi_script, save_karaoke_##size) { bench_save(state, lines, util::ScriptKind::Karaoke); } \
+	BENCHMARK(lagi_script, snapshot_tagged_##size) { bench_snapshot(state, lines, util::ScriptKind::HeavyTags); } \
+	BENCHMARK(lagi_script, sort_tagged_##size) { bench_sort(state, lines, util::ScriptKind::HeavyTags); }
+
+SCRIPT_BENCHMARKS(10k, 10000)
+SCRIPT_BENCHMARKS(50k, 50000)
+SCRIPT_BENCHMARKS(200k, 200000)
@@ -0,0 +1,51 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/ass/time.h>
+
+#include <string>
+#include <vector>
+
+BENCHMARK(lagi_time, parse_1000) {
+	std::vector<std::string> strings;
+	for (int i = 0; i < 1000; ++i)
+		strings.push_back(agi::Time(i * 3217).GetAssFormatted());
+
+	while (state.Run()) {
+		for (auto const& str : strings)
+			bench::Escape(agi::Time(str));
+	}
+}
+
+BENCHMARK(lagi_time, format_1000) {
+	while (state.Run()) {
+		for (int i = 0; i < 1000; ++i)
+			bench::Escape(agi::Time(i * 3217).GetAssFormatted());
+	}
+}
+
+BENCHMARK(lagi_time, append_1000) {
+	std::string str;
+	while (state.Run()) {
+		str.clear();
+		for (int i = 0; i < 1000; ++i)
+			agi::Time(i * 3217).AppendAssFormatted(str);
+		bench::Escape(str.data());
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include "bench.h"
+
+#include <libaegisub/vfr.h>
+
+#include <vector>
+
+namespace {
+const int frame_count = 200000;
+
+/// Two hours of video alternating between 24 and 30 fps every 1000 frames
+agi::vfr::Framerate make_vfr() {
+	std::vector<int> timecodes;
+	double time = 0;
+	for (int i = 0; i < frame_count; ++i) {
+		timecodes.push_back(static_cast<int>(time));
+		time += (i / 1000) % 2 ? 1001.0 / 30 : 1001.0 / 24;
+	}
+	return agi::vfr::Framerate(timecodes);
+}
+}
+
+BENCHMARK(lagi_vfr, frame_at_time_1000) {
+	auto fps = make_vfr();
+	int last = fps.TimeAtFrame(frame_count - 1);
+	while (state.Run()) {
+		for (int i = 0; i < 1000; ++i)
+			bench::Escape(fps.FrameAtTime(last / 1000 * i, agi::vfr::START));
+	}
+}
+
+BENCHMARK(lagi_vfr, time_at_frame_1000) {
+	auto fps = make_vfr();
+	int last = frame_count - 1;
+	while (state.Run()) {
+		for (int i = 0; i < 1000; ++i)
+			bench::Escape(fps.TimeAtFrame(last / 1000 * i, agi::vfr::END));
+	}
+}
+
+BENCHMARK(lagi_vfr, frames_at_times_batch_10000) {
+	auto fps = make_vfr();
+	int last = fps.TimeAtFrame(frame_count - 1);
+	std::vector<int> times;
+	for (int i = 0; i < 10000; ++i)
+		times.push_back(last / 10000 * i);
+	while (state.Run()) {
+		auto frames = fps.FramesAtTimes(times, agi::vfr::START);
+		bench::Escape(frames.data());
+	}
+}
+
+BENCHMARK(lagi_vfr, from_timecodes) {
+	std::vector<int> timecodes;
+	for (int i = 0; i < frame_count; ++i)
+		timecodes.push_back(i * 1001 / 24);
+	while (state.Run())
+		bench::Escape(agi::vfr::Framerate(timecodes));
+}
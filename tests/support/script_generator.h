@@ -0,0 +1,182 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+/// @file script_generator.h
+/// @brief Deterministic generator for large synthetic ASS scripts
+///
+/// Header-only so that both the tests and the benchmarks can use it without
+/// sharing object files between targets.
+
+#pragma once
+
+#include <libaegisub/ass/time.h>
+
+#include <cstdint>
+#include <string>
+
+namespace util {
+enum class ScriptKind {
+	/// Typesetting-heavy lines with positioning, colours, transforms,
+	/// fades and vector clips
+	HeavyTags,
+	/// A handful of karaoke templates followed by \k-timed lines
+	Karaoke
+};
+
+namespace detail {
+/// Small LCG so that scripts are identical on every platform and standard
+/// library, unlike rand() or <random>'s distributions
+class script_rng {
+	uint32_t state;
+public:
+	explicit script_rng(uint32_t seed) : state(seed * 2654435761u + 1) { }
+	uint32_t next() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+	int range(int lo, int hi) { return lo + static_cast<int>(next() % static_cast<uint32_t>(hi - lo + 1)); }
+};
+
+inline void append_hex_colour(std::string& out, script_rng& rng) {
+	static const char digits[] = "0123456789ABCDEF";
+	out += "&H";
+	for (int i = 0; i < 6; ++i)
+		out += digits[rng.range(0, 15)];
+	out += '&';
+}
+
+inline void append_heavy_text(std::string& out, script_rng& rng) {
+	out += "{\\an";
+	out += std::to_string(rng.range(1, 9));
+	out += "\\pos(";
+	out += std::to_string(rng.range(0, 1920));
+	out += ',';
+	out += std::to_string(rng.range(0, 1080));
+	out += ")\\fad(";
+	out += std::to_string(rng.range(0, 300));
+	out += ',';
+	out += std::to_string(rng.range(0, 300));
+	out += ")\\1c";
+	append_hex_colour(out, rng);
+	out += "\\3c";
+	append_hex_colour(out, rng);
+	out += "\\t(0,";
+	out += std::to_string(rng.range(100, 2000));
+	out += ",\\fscx";
+	out += std::to_string(rng.range(80, 150));
+	out += "\\frz";
+	out += std::to_string(rng.range(-45, 45));
+	out += ')';
+	if (rng.range(0, 3) == 0) {
+		out += "\\clip(m ";
+		for (int i = 0; i < 4; ++i) {
+			out += std::to_string(rng.range(0, 1920));
+			out += ' ';
+			out += std::to_string(rng.range(0, 1080));
+			out += i == 0 ? " l " : " ";
+		}
+		out.pop_back();
+		out += ')';
+	}
+	out += "}Sign text ";
+	out += std::to_string(rng.range(0, 99999));
+	out += "{\\i1}italic{\\i0}\\Nsecond line";
+}
+
+inline void append_karaoke_text(std::string& out, script_rng& rng) {
+	static const char *syllables[] = {"ka", "ra", "o", "ke", "ki", "mi", "no", "na", "ma", "e", "wo", "yo", "bu"};
+	int count = rng.range(4, 16);
+	for (int i = 0; i < count; ++i) {
+		out += "{\\k";
+		out += std::to_string(rng.range(5, 60));
+		out += '}';
+		out += syllables[rng.range(0, 12)];
+		if (rng.range(0, 4) == 0)
+			out += ' ';
+	}
+}
+}
+
+/// Generate an ASS script with the given number of events
+///
+/// The same arguments always give the same script. Start times are
+/// scattered rather than sorted, so the script is also usable for sorting.
+/// @param lines Number of Dialogue/Comment lines in the [Events] section
+/// @param kind What the lines look like
+/// @param seed Seed for the generator
+inline std::string generate_script(size_t lines, ScriptKind kind, uint32_t seed = 1) {
+	detail::script_rng rng(seed);
+	std::string out;
+	out.reserve(lines * (kind == ScriptKind::HeavyTags ? 220 : 180));
+
+	out +=
+		"[Script Info]\n"
+		"; Synthetic script generated for tests and benchmarks\n"
+		"ScriptType: v4.00+\n"
+		"PlayResX: 1920\n"
+		"PlayResY: 1080\n"
+		"WrapStyle: 0\n"
+		"\n"
+		"[V4+ Styles]\n"
+		"Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, Alignment, MarginL, MarginR, MarginV, Encoding\n"
+		"Style: Default,Arial,60,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,3,1,2,40,40,40,1\n"
+		"Style: Sign,Arial,48,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,-1,0,0,0,100,100,0,0,1,2,0,5,10,10,10,1\n"
+		"Style: Kara,Arial,54,&H00FFFFFF,&H000000FF,&H00000000,&H00000000,0,0,0,0,100,100,0,0,1,2,1,8,40,40,30,1\n"
+		"\n"
+		"[Events]\n"
+		"Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n";
+
+	size_t i = 0;
+	if (kind == ScriptKind::Karaoke) {
+		static const char *templates[] = {
+			"Comment: 0,0:00:00.00,0:00:00.00,Kara,,0,0,0,code once,function fx(x) return x * 2 end\n",
+			"Comment: 0,0:00:00.00,0:00:00.00,Kara,,0,0,0,template syl,{\\r\\an5\\pos($scenter,$smiddle)\\t($sstart,$send,\\1c&H00FFFF&)}\n",
+			"Comment: 1,0:00:00.00,0:00:00.00,Kara,,0,0,0,template line,{\\fad(150,150)\\blur2}\n",
+			"Comment: 0,0:00:00.00,0:00:00.00,Kara,,0,0,0,template syl noblank,{\\an5\\move($scenter,$smiddle,!$scenter+fx(10)!,$smiddle,$sstart,$send)}\n",
+		};
+		for (auto tmpl : templates) {
+			if (i == lines) break;
+			out += tmpl;
+			++i;
+		}
+	}
+
+	const int duration = 24 * 60 * 1000;
+	for (; i < lines; ++i) {
+		int start = rng.range(0, duration);
+		int end = start + rng.range(500, 6000);
+		out += kind == ScriptKind::Karaoke && rng.range(0, 10) == 0 ? "Comment: " : "Dialogue: ";
+		out += std::to_string(rng.range(0, 2));
+		out += ',';
+		out += agi::Time(start).GetAssFormatted();
+		out += ',';
+		out += agi::Time(end).GetAssFormatted();
+		if (kind == ScriptKind::HeavyTags) {
+			out += rng.range(0, 2) ? ",Sign,," : ",Default,Actor,";
+			out += "0,0,0,,";
+			detail::append_heavy_text(out, rng);
+		}
+		else {
+			out += ",Kara,,0,0,0,karaoke,";
+			detail::append_karaoke_text(out, rng);
+		}
+		out += '\n';
+	}
+
+	return out;
+}
+}
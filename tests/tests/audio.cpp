@@ -16,7 +16,12 @@
 
 #include <main.h>
 
+#include <libaegisub/audio/energy_envelope.h>
+#include <libaegisub/audio/peak_index.h>
+#include <libaegisub/audio/playback_feed.h>
+#include <libaegisub/audio/playback_stats.h>
 #include <libaegisub/audio/provider.h>
+#include <libaegisub/background_runner.h>
 #include <libaegisub/fs.h>
 #include <libaegisub/make_unique.h>
 #include <libaegisub/path.h>
@@ -24,6 +29,8 @@
 
 #include <boost/filesystem/fstream.hpp>
 
+#include <cmath>
+
 namespace bfs = boost::filesystem;
 
 TEST(lagi_audio, dummy_blank) {
@@ -72,6 +79,12 @@ struct TestAudioProvider : agi::AudioProvider {
 		for (int64_t end = start + count; start < end; ++start)
 			*out++ = (Sample)(start + bias);
 	}
+
+	std::unique_ptr<agi::AudioProvider> Reopen() const override {
+		auto copy = agi::make_unique<TestAudioProvider>(num_samples / 48000, sample_rate);
+		copy->bias = bias;
+		return std::unique_ptr<agi::AudioProvider>(std::move(copy));
+	}
 };
 
 TEST(lagi_audio, before_sample_zero) {
@@ -170,6 +183,45 @@ TEST(lagi_audio, save_audio_clip_out_of_audio_range) {
 	agi::fs::Remove(path);
 }
 
+namespace {
+struct TestProgressSink final : agi::ProgressSink {
+	std::vector<int64_t> progress;
+	size_t cancel_after = SIZE_MAX;
+
+	void SetIndeterminate() override { }
+	void SetTitle(std::string const&) override { }
+	void SetMessage(std::string const&) override { }
+	void SetProgress(int64_t cur, int64_t max) override {
+		EXPECT_LE(cur, max);
+		progress.push_back(cur);
+	}
+	void Log(std::string const&) override { }
+	bool IsCancelled() override { return progress.size() >= cancel_after; }
+};
+}
+
+TEST(lagi_audio, save_audio_clip_progress) {
+	const auto path = agi::Path().Decode("?temp/save_clip");
+	agi::fs::Remove(path);
+
+	const auto provider = agi::CreateDummyAudioProvider("dummy-audio:noise?", nullptr);
+
+	TestProgressSink ps;
+	agi::SaveAudioClip(*provider, path, 0, 10 * 1000, &ps);
+	ASSERT_LT(1u, ps.progress.size());
+	EXPECT_EQ(0, ps.progress.front());
+	EXPECT_TRUE(std::is_sorted(ps.progress.begin(), ps.progress.end()));
+	EXPECT_TRUE(agi::fs::FileExists(path));
+	agi::fs::Remove(path);
+
+	// Cancelling part way leaves nothing behind
+	TestProgressSink cancel;
+	cancel.cancel_after = 3;
+	agi::SaveAudioClip(*provider, path, 0, 10 * 1000, &cancel);
+	EXPECT_EQ(3u, cancel.progress.size());
+	EXPECT_FALSE(agi::fs::FileExists(path));
+}
+
 TEST(lagi_audio, get_with_volume) {
 	TestAudioProvider<> provider;
 	uint16_t buff[4];
@@ -228,6 +280,773 @@ TEST(lagi_audio, hd_cache) {
 		ASSERT_EQ(static_cast<uint16_t>((1 << 22) - 256 + i), buff[i]);
 }
 
+TEST(lagi_audio, decode_schedule_in_order) {
+	std::atomic<int64_t> decoded{0};
+	agi::AudioDecodeSchedule schedule(1000, 100, decoded);
+	size_t chunk = schedule.Next();
+	for (size_t i = 0; i < 10; ++i) {
+		ASSERT_EQ(i, chunk);
+		EXPECT_FALSE(schedule.IsDecoded(i * 100, 1));
+		chunk = schedule.Next(chunk);
+		EXPECT_EQ((int64_t)(i + 1) * 100, decoded);
+		EXPECT_TRUE(schedule.IsDecoded(0, (i + 1) * 100));
+	}
+	EXPECT_EQ(agi::AudioDecodeSchedule::npos, chunk);
+}
+
+TEST(lagi_audio, decode_schedule_request) {
+	std::atomic<int64_t> decoded{0};
+	agi::AudioDecodeSchedule schedule(1050, 100, decoded);
+	size_t chunk = schedule.Next();
+
+	schedule.Request(750, 10);
+	chunk = schedule.Next(chunk);
+	ASSERT_EQ(7u, chunk);
+	EXPECT_EQ(100, decoded);
+
+	chunk = schedule.Next(chunk);
+	EXPECT_TRUE(schedule.IsDecoded(700, 100));
+	EXPECT_FALSE(schedule.IsDecoded(600, 200));
+
+	// Already decoded, so this shouldn't move anything
+	schedule.Request(700, 100);
+
+	// Carries on from the requested point to the end, then fills the gap
+	ASSERT_EQ(8u, chunk);
+	for (size_t expected : {9, 10, 1, 2, 3, 4, 5, 6}) {
+		chunk = schedule.Next(chunk);
+		ASSERT_EQ(expected, chunk);
+	}
+	EXPECT_EQ(agi::AudioDecodeSchedule::npos, schedule.Next(chunk));
+	EXPECT_TRUE(schedule.IsDecoded(0, 1050));
+	EXPECT_EQ(1050, decoded);
+}
+
+TEST(lagi_audio, decode_schedule_several_decoders) {
+	std::atomic<int64_t> decoded{0};
+	agi::AudioDecodeSchedule schedule(1000, 100, decoded);
+
+	// Each new decoder splits the largest gap with the one working on it
+	size_t a = schedule.Next(), b = schedule.Next(), c = schedule.Next();
+	EXPECT_EQ(0u, a);
+	EXPECT_EQ(5u, b);
+	EXPECT_EQ(3u, c);
+
+	// and then they carry on from where they started
+	a = schedule.Next(a);
+	b = schedule.Next(b);
+	c = schedule.Next(c);
+	EXPECT_EQ(1u, a);
+	EXPECT_EQ(6u, b);
+	EXPECT_EQ(4u, c);
+
+	// until they catch up with someone else
+	a = schedule.Next(schedule.Next(a));
+	EXPECT_EQ(8u, a);
+
+	std::vector<int> handed_out(10);
+	handed_out[0] = handed_out[1] = handed_out[2] = handed_out[3] = handed_out[5] = 1;
+	for (size_t *chunk : {&a, &b, &c}) {
+		while (*chunk != agi::AudioDecodeSchedule::npos) {
+			++handed_out[*chunk];
+			*chunk = schedule.Next(*chunk);
+		}
+	}
+	for (int count : handed_out)
+		EXPECT_EQ(1, count);
+	EXPECT_EQ(1000, decoded);
+}
+
+TEST(lagi_audio, peak_index_out_of_order) {
+	using agi::AudioPeakIndex;
+	const int64_t block = AudioPeakIndex::BlockSize();
+	std::vector<int16_t> samples(block * 3 + 1000);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)((i * 7919) % 65536 - 32768);
+
+	AudioPeakIndex index(samples.size());
+	index.Add(&samples[block * 3], block * 3, 1000);
+	index.Add(&samples[block], block, block);
+	EXPECT_TRUE(index.IsIndexed(block, block));
+	EXPECT_TRUE(index.IsIndexed(block * 3, 1000));
+	EXPECT_FALSE(index.IsIndexed(0, block * 2));
+	EXPECT_FALSE(index.IsIndexed(block * 2, 1));
+
+	agi::AudioPeak expected;
+	agi::AccumulatePeak(expected, &samples[block + 256], block - 512);
+	auto actual = index.Summarize(block + 256, block * 2 - 256);
+	EXPECT_EQ(expected.min, actual.min);
+	EXPECT_EQ(expected.max, actual.max);
+	EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+	EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+}
+
+TEST(lagi_audio, hd_cache_decodes_requested_range_first) {
+	// A source which only makes progress when let, so that what has been
+	// decoded at each point is known
+	struct SlowAudioProvider : TestAudioProvider<int16_t> {
+		mutable std::atomic<int> allowed{1};
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			while (allowed <= 0) agi::util::sleep_for(0);
+			--allowed;
+			TestAudioProvider<int16_t>::FillBuffer(buf, start, count);
+		}
+	};
+
+	auto source = agi::make_unique<SlowAudioProvider>();
+	auto slow = source.get();
+	auto provider = agi::CreateHDAudioProvider(std::move(source), agi::Path().Decode("?temp"));
+	while (!provider->IsDecoded(0, 65536)) agi::util::sleep_for(0);
+
+	// Not decoded yet, so this reads silence but moves decoding there
+	const int64_t far = (1 << 22) - 256;
+	uint16_t buff[512];
+	provider->GetAudio(buff, far, 512);
+	EXPECT_EQ(0, buff[0]);
+	EXPECT_FALSE(provider->IsDecoded(far, 512));
+
+	// The decoder may already have started on the chunk after the first,
+	// and the read straddles two chunks
+	slow->allowed = 3;
+	while (!provider->IsDecoded(far, 512)) agi::util::sleep_for(0);
+	EXPECT_FALSE(provider->IsDecoded(65536 * 2, 65536));
+	EXPECT_GE(65536 * 2, provider->GetDecodedSamples());
+
+	provider->GetAudio(buff, far, 512);
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>(far + i), buff[i]);
+
+	// Peaks for a range which is only partly decoded use what there is
+	TestAudioProvider<int16_t> uncached;
+	auto expected = uncached.GetPeaks(far - 256, 768);
+	auto actual = provider->GetPeaks(far, 512);
+	EXPECT_EQ(expected.max, actual.max);
+
+	slow->allowed = 1 << 30;
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	EXPECT_TRUE(provider->IsDecoded(0, provider->GetNumSamples()));
+}
+
+TEST(lagi_audio, ram_cache_several_decoders) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), 4);
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<uint16_t> buff(provider->GetNumSamples());
+	provider->GetAudio(buff.data(), 0, buff.size());
+	for (size_t i = 0; i < buff.size(); ++i)
+		ASSERT_EQ(static_cast<uint16_t>(i), buff[i]);
+
+	TestAudioProvider<int16_t> uncached;
+	auto expected = uncached.GetPeaks(1000, 3000000);
+	auto actual = provider->GetPeaks(1000, 3000000);
+	EXPECT_EQ(expected.min, actual.min);
+	EXPECT_EQ(expected.max, actual.max);
+	EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+	EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+}
+
+TEST(lagi_audio, hd_cache_several_decoders) {
+	auto provider = agi::CreateHDAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), agi::Path().Decode("?temp"), 4);
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<uint16_t> buff(provider->GetNumSamples());
+	provider->GetAudio(buff.data(), 0, buff.size());
+	for (size_t i = 0; i < buff.size(); ++i)
+		ASSERT_EQ(static_cast<uint16_t>(i), buff[i]);
+}
+
+TEST(lagi_audio, shared_cache) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_shared.pcmcache";
+	agi::fs::Remove(path);
+
+	auto provider = agi::CreateSharedAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), path, 4);
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<uint16_t> buff(provider->GetNumSamples());
+	provider->GetAudio(buff.data(), 0, buff.size());
+	for (size_t i = 0; i < buff.size(); ++i)
+		ASSERT_EQ(static_cast<uint16_t>(i), buff[i]);
+
+	// The cache is published once the last chunk is written, which can be
+	// just after the decoded sample count catches up
+	for (int i = 0; i < 1000 && !agi::fs::FileExists(path); ++i) agi::util::sleep_for(1);
+	ASSERT_TRUE(agi::fs::FileExists(path));
+	provider.reset();
+	EXPECT_TRUE(agi::fs::FileExists(path));
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, shared_cache_is_attached_to) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_shared.pcmcache";
+	agi::fs::Remove(path);
+
+	auto first = agi::CreateSharedAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), path);
+	while (first->GetDecodedSamples() != first->GetNumSamples()) agi::util::sleep_for(0);
+	for (int i = 0; i < 1000 && !agi::fs::FileExists(path); ++i) agi::util::sleep_for(1);
+
+	// Different samples with the same format, so that reading the first
+	// instance's samples shows that the second didn't decode anything
+	auto source = agi::make_unique<TestAudioProvider<int16_t>>();
+	source->bias = 5;
+	auto second = agi::CreateSharedAudioProvider(std::move(source), path);
+	ASSERT_EQ(second->GetNumSamples(), second->GetDecodedSamples());
+
+	uint16_t buff[512];
+	second->GetAudio(buff, 100000, 512);
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>(100000 + i), buff[i]);
+
+	TestAudioProvider<int16_t> uncached;
+	auto expected = uncached.GetPeaks(1000, 1000000);
+	auto actual = second->GetPeaks(1000, 1000000);
+	EXPECT_EQ(expected.min, actual.min);
+	EXPECT_EQ(expected.max, actual.max);
+	EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+	EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+
+	first.reset();
+	second.reset();
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, shared_cache_ignores_other_formats) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_shared.pcmcache";
+	agi::fs::Remove(path);
+
+	{
+		auto provider = agi::CreateSharedAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), path);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	}
+
+	auto source = agi::make_unique<TestAudioProvider<int16_t>>(60);
+	source->bias = 5;
+	auto provider = agi::CreateSharedAudioProvider(std::move(source), path);
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	uint16_t buff[512];
+	provider->GetAudio(buff, 100000, 512);
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>(100005 + i), buff[i]);
+
+	provider.reset();
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, convert_reopen) {
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<TestAudioProvider<uint8_t>>());
+	auto copy = provider->Reopen();
+	ASSERT_TRUE(!!copy);
+	EXPECT_EQ(provider->GetSampleRate(), copy->GetSampleRate());
+	EXPECT_EQ(provider->GetBytesPerSample(), copy->GetBytesPerSample());
+
+	int16_t expected[256], actual[256];
+	provider->GetAudio(expected, 1000, 256);
+	copy->GetAudio(actual, 1000, 256);
+	for (size_t i = 0; i < 256; ++i)
+		ASSERT_EQ(expected[i], actual[i]);
+
+	EXPECT_FALSE(agi::CreateDummyAudioProvider("dummy-audio:silence?", nullptr)->Reopen());
+}
+
+namespace {
+void ExpectVisitMatchesGetAudio(agi::AudioProvider const& provider, int64_t start, int64_t count) {
+	std::vector<int16_t> expected(count), actual;
+	provider.GetAudio(expected.data(), start, count);
+	provider.VisitAudio(start, count, [&](const void *samples, int64_t n) {
+		auto data = static_cast<const int16_t *>(samples);
+		actual.insert(actual.end(), data, data + n);
+	});
+	ASSERT_EQ(expected.size(), actual.size());
+	for (size_t i = 0; i < expected.size(); ++i)
+		ASSERT_EQ(expected[i], actual[i]);
+}
+}
+
+TEST(lagi_audio, visit_audio) {
+	TestAudioProvider<int16_t> uncached;
+	auto ram = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>());
+	auto hd = agi::CreateHDAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), agi::Path().Decode("?temp"));
+	while (ram->GetDecodedSamples() != ram->GetNumSamples()) agi::util::sleep_for(0);
+	while (hd->GetDecodedSamples() != hd->GetNumSamples()) agi::util::sleep_for(0);
+
+	// Straddling the start, cache blocks, decoded chunks and the end
+	const int64_t num_samples = uncached.GetNumSamples();
+	const int64_t ranges[][2] = {{-100, 300}, {(1 << 21) - 1000, 5000}, {65536 - 10, 200000}, {num_samples - 100, 300}, {num_samples + 10, 10}};
+	for (auto const& range : ranges) {
+		SCOPED_TRACE(range[0]);
+		ExpectVisitMatchesGetAudio(uncached, range[0], range[1]);
+		ExpectVisitMatchesGetAudio(*ram, range[0], range[1]);
+		ExpectVisitMatchesGetAudio(*hd, range[0], range[1]);
+	}
+}
+
+TEST(lagi_audio, visit_audio_does_not_copy_from_ram_cache) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	std::vector<const void *> first, second;
+	provider->VisitAudio(1000, 100000, [&](const void *samples, int64_t) { first.push_back(samples); });
+	provider->VisitAudio(1000, 100000, [&](const void *samples, int64_t) { second.push_back(samples); });
+	ASSERT_EQ(1u, first.size());
+	EXPECT_EQ(first, second);
+}
+
+TEST(lagi_audio, visit_audio_before_decoding) {
+	struct StalledAudioProvider : TestAudioProvider<int16_t> {
+		mutable std::atomic<bool> go{false};
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			while (!go) agi::util::sleep_for(0);
+			TestAudioProvider<int16_t>::FillBuffer(buf, start, count);
+		}
+	};
+
+	auto source = agi::make_unique<StalledAudioProvider>();
+	auto stalled = source.get();
+	auto provider = agi::CreateRAMAudioProvider(std::move(source));
+
+	int64_t total = 0;
+	provider->VisitAudio(100, 1000, [&](const void *samples, int64_t n) {
+		auto data = static_cast<const int16_t *>(samples);
+		for (int64_t i = 0; i < n; ++i)
+			ASSERT_EQ(0, data[i]);
+		total += n;
+	});
+	EXPECT_EQ(1000, total);
+
+	stalled->go = true;
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	ExpectVisitMatchesGetAudio(*provider, 100, 1000);
+}
+
+TEST(lagi_audio, ring_buffer_wraps) {
+	agi::AudioRingBuffer ring(5, sizeof(int16_t));
+	int16_t next_write = 0, next_read = 0;
+
+	for (int round = 0; round < 20; ++round) {
+		size_t frames;
+		auto dest = reinterpret_cast<int16_t *>(ring.WritePointer(frames));
+		ASSERT_LE(frames, 5u - ring.Available());
+		frames = std::min<size_t>(frames, round % 3 + 1);
+		for (size_t i = 0; i < frames; ++i)
+			dest[i] = next_write++;
+		ring.CommitWrite(frames);
+
+		int16_t out[5];
+		size_t read = ring.Read(out, round % 2 + 1);
+		for (size_t i = 0; i < read; ++i)
+			ASSERT_EQ(next_read++, out[i]);
+	}
+
+	ring.Clear();
+	EXPECT_EQ(0u, ring.Available());
+	int16_t out;
+	EXPECT_EQ(0u, ring.Read(&out, 1));
+}
+
+TEST(lagi_audio, playback_feed_matches_provider) {
+	TestAudioProvider<int16_t> provider;
+	agi::AudioPlaybackFeed feed(&provider, 1000);
+
+	feed.Start(100, 50100);
+	std::vector<int16_t> played;
+	while (!feed.AtEnd()) {
+		feed.WaitForPrefill(300, std::chrono::milliseconds(1000));
+		int16_t buff[300];
+		size_t read = feed.Read(buff, 300);
+		played.insert(played.end(), buff, buff + read);
+		EXPECT_EQ(100 + (int64_t)played.size(), feed.GetReadPosition());
+	}
+
+	ASSERT_EQ(50000u, played.size());
+	for (size_t i = 0; i < played.size(); ++i)
+		ASSERT_EQ((int16_t)(i + 100), played[i]);
+}
+
+TEST(lagi_audio, playback_feed_restart_and_end) {
+	TestAudioProvider<int16_t> provider;
+	agi::AudioPlaybackFeed feed(&provider, 1000);
+
+	int16_t buff[500];
+	feed.Start(0, 10000);
+	ASSERT_TRUE(feed.WaitForPrefill(500, std::chrono::milliseconds(1000)));
+	ASSERT_EQ(500u, feed.Read(buff, 500));
+	EXPECT_EQ(499, buff[499]);
+
+	// Restarting throws away what was read ahead
+	feed.Start(5000, 10000);
+	ASSERT_TRUE(feed.WaitForPrefill(10, std::chrono::milliseconds(1000)));
+	ASSERT_LE(10u, feed.Read(buff, 10));
+	EXPECT_EQ(5000, buff[0]);
+
+	// Moving the end in stops reading there even if more was read ahead
+	feed.SetEndPosition(5015);
+	ASSERT_TRUE(feed.WaitForPrefill(500, std::chrono::milliseconds(1000)));
+	EXPECT_EQ(5u, feed.Read(buff, 500));
+	EXPECT_EQ(5010, buff[0]);
+	EXPECT_TRUE(feed.AtEnd());
+
+	// And moving it back out carries on from where it got to
+	feed.SetEndPosition(6000);
+	ASSERT_TRUE(feed.WaitForPrefill(10, std::chrono::milliseconds(1000)));
+	ASSERT_LE(1u, feed.Read(buff, 10));
+	EXPECT_EQ(5015, buff[0]);
+
+	feed.Stop();
+	EXPECT_TRUE(feed.AtEnd());
+	EXPECT_EQ(0u, feed.Read(buff, 10));
+}
+
+TEST(lagi_audio, playback_feed_volume) {
+	TestAudioProvider<int16_t> provider;
+	agi::AudioPlaybackFeed feed(&provider, 1000);
+
+	feed.Start(0, 1000);
+	feed.SetVolume(2.0);
+	ASSERT_TRUE(feed.WaitForPrefill(100, std::chrono::milliseconds(1000)));
+	int16_t buff[100];
+	ASSERT_EQ(100u, feed.Read(buff, 100));
+	for (int i = 0; i < 100; ++i)
+		ASSERT_EQ(i * 2, buff[i]);
+}
+
+TEST(lagi_audio, playback_feed_fade) {
+	TestAudioProvider<int16_t> provider;
+	agi::AudioPlaybackFeed feed(&provider, 1000);
+
+	feed.SetFade(100);
+	feed.Start(1000, 1400);
+	ASSERT_TRUE(feed.WaitForPrefill(400, std::chrono::milliseconds(1000)));
+	int16_t buff[400];
+	ASSERT_EQ(400u, feed.Read(buff, 400));
+
+	// Silent at both ends, untouched in the middle and ramping in between
+	EXPECT_EQ(0, buff[0]);
+	EXPECT_EQ(1050 / 2, buff[50]);
+	for (int i = 100; i <= 300; ++i)
+		ASSERT_EQ(1000 + i, buff[i]);
+	EXPECT_EQ((1350 * 50 + 50) / 100, buff[350]);
+	EXPECT_GT(100, buff[399]);
+
+	// Turning it off leaves everything as read
+	feed.SetFade(0);
+	feed.Start(1000, 1100);
+	ASSERT_TRUE(feed.WaitForPrefill(100, std::chrono::milliseconds(1000)));
+	ASSERT_EQ(100u, feed.Read(buff, 100));
+	EXPECT_EQ(1000, buff[0]);
+}
+
+TEST(lagi_audio, playback_stats) {
+	agi::AudioPlaybackStats stats;
+	auto totals = stats.Get();
+	EXPECT_EQ(0, totals.start_latency.count);
+	EXPECT_EQ(0, totals.callback.Average().count());
+
+	// Only the first write after each start counts towards the latency
+	stats.AudioWritten();
+	stats.PlayStarted();
+	agi::util::sleep_for(5);
+	stats.AudioWritten();
+	stats.AudioWritten();
+
+	auto start = agi::AudioPlaybackStats::Now();
+	stats.AddCallback(start - std::chrono::milliseconds(3));
+	stats.AddCallback(start - std::chrono::milliseconds(1));
+	stats.AddUnderrun();
+
+	totals = stats.Get();
+	EXPECT_EQ(1, totals.start_latency.count);
+	EXPECT_LE(5000, totals.start_latency.max.count());
+	EXPECT_EQ(2, totals.callback.count);
+	EXPECT_LE(3000, totals.callback.max.count());
+	EXPECT_LE(2000, totals.callback.Average().count());
+	EXPECT_EQ(0, totals.provider_read.count);
+	EXPECT_EQ(1, totals.underruns);
+	EXPECT_NE(std::string::npos, stats.Summary().find("1 underruns"));
+}
+
+TEST(lagi_audio, playback_feed_stats) {
+	TestAudioProvider<int16_t> provider;
+	agi::AudioPlaybackStats stats;
+	agi::AudioPlaybackFeed feed(&provider, 1000, &stats);
+
+	feed.Start(0, 10000);
+	ASSERT_TRUE(feed.WaitForPrefill(1000, std::chrono::milliseconds(1000)));
+	EXPECT_LT(0, stats.Get().provider_read.count);
+
+	// Asking for more than has been read ahead is an underrun, but running
+	// into the end isn't
+	int16_t buff[2000];
+	EXPECT_EQ(1000u, feed.Read(buff, 2000));
+	EXPECT_EQ(1, stats.Get().underruns);
+
+	feed.SetEndPosition(1500);
+	ASSERT_TRUE(feed.WaitForPrefill(500, std::chrono::milliseconds(1000)));
+	EXPECT_EQ(500u, feed.Read(buff, 2000));
+	EXPECT_EQ(1, stats.Get().underruns);
+}
+
+TEST(lagi_audio, compressed_hd_cache) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_compressed.audiocache";
+	agi::fs::Remove(path);
+
+	{
+		auto provider = agi::CreateCompressedHDAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), path);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+		uint16_t buff[512];
+		provider->GetAudio(buff, (1 << 22) - 256, 512);
+		for (size_t i = 0; i < 512; ++i)
+			ASSERT_EQ(static_cast<uint16_t>((1 << 22) - 256 + i), buff[i]);
+
+		TestAudioProvider<int16_t> uncached;
+		auto expected = uncached.GetPeaks(1000, 1000000);
+		auto actual = provider->GetPeaks(1000, 1000000);
+		EXPECT_EQ(expected.min, actual.min);
+		EXPECT_EQ(expected.max, actual.max);
+		EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+		EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+	}
+
+	EXPECT_GT(90u * 48000 * 2, agi::fs::Size(path));
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, compressed_hd_cache_is_reused) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_compressed.audiocache";
+	agi::fs::Remove(path);
+
+	{
+		auto provider = agi::CreateCompressedHDAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>(), path);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	}
+
+	// Different samples with the same format, so that reading the cached ones
+	// back shows that the source wasn't decoded again
+	auto source = agi::make_unique<TestAudioProvider<int16_t>>();
+	source->bias = 5;
+	auto provider = agi::CreateCompressedHDAudioProvider(std::move(source), path);
+	ASSERT_EQ(provider->GetNumSamples(), provider->GetDecodedSamples());
+
+	uint16_t buff[512];
+	provider->GetAudio(buff, 100000, 512);
+	for (size_t i = 0; i < 512; ++i)
+		ASSERT_EQ(static_cast<uint16_t>(100000 + i), buff[i]);
+
+	provider.reset();
+	agi::fs::Remove(path);
+}
+
+namespace {
+struct NoiseAudioProvider : agi::AudioProvider {
+	NoiseAudioProvider() {
+		channels = 1;
+		num_samples = 10 * 48000 + 123;
+		decoded_samples = num_samples;
+		sample_rate = 48000;
+		bytes_per_sample = 2;
+		float_samples = false;
+	}
+
+	static int16_t Sample(int64_t i) {
+		uint32_t x = static_cast<uint32_t>(i) * 2654435761u;
+		x ^= x >> 15;
+		// Mostly loud noise, with quiet stretches that compress well
+		return static_cast<int16_t>((i / 10000) % 2 ? x : x % 64);
+	}
+
+	void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+		auto out = static_cast<int16_t *>(buf);
+		for (int64_t i = 0; i < count; ++i)
+			out[i] = Sample(start + i);
+	}
+};
+}
+
+TEST(lagi_audio, compressed_hd_cache_noise) {
+	auto path = agi::Path().Decode("?temp") / "lagi_audio_compressed.audiocache";
+	agi::fs::Remove(path);
+
+	{
+		auto provider = agi::CreateCompressedHDAudioProvider(agi::make_unique<NoiseAudioProvider>(), path);
+		while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+		std::vector<int16_t> buff(provider->GetNumSamples());
+		provider->GetAudio(buff.data(), 0, buff.size());
+		for (size_t i = 0; i < buff.size(); ++i)
+			ASSERT_EQ(NoiseAudioProvider::Sample(i), buff[i]);
+	}
+
+	agi::fs::Remove(path);
+}
+
+TEST(lagi_audio, accumulate_peak) {
+	std::vector<int16_t> samples(200003);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)((i * 7919) % 65536 - 32768);
+	samples[1234] = SHRT_MAX;
+	samples[4321] = SHRT_MIN;
+
+	// Odd offsets and lengths exercise the unaligned head and scalar tail
+	for (size_t offset : {0, 1, 7}) {
+		for (size_t count : {0, 5, 8, 1000, 65536 + 3, 200003 - 7}) {
+			SCOPED_TRACE(offset);
+			SCOPED_TRACE(count);
+
+			int peak_min = 0, peak_max = 0;
+			int64_t neg_sum = 0, pos_sum = 0;
+			for (size_t i = offset; i < offset + count; ++i) {
+				if (samples[i] > 0) {
+					peak_max = std::max<int>(peak_max, samples[i]);
+					pos_sum += samples[i];
+				}
+				else {
+					peak_min = std::min<int>(peak_min, samples[i]);
+					neg_sum += samples[i];
+				}
+			}
+
+			agi::AudioPeak peak;
+			agi::AccumulatePeak(peak, &samples[offset], count);
+			EXPECT_EQ(peak_min, peak.min);
+			EXPECT_EQ(peak_max, peak.max);
+			EXPECT_EQ(neg_sum, peak.neg_sum);
+			EXPECT_EQ(pos_sum, peak.pos_sum);
+		}
+	}
+}
+
+TEST(lagi_audio, peak_index_matches_raw_scan) {
+	using agi::AudioPeakIndex;
+	std::vector<int16_t> samples(AudioPeakIndex::BlockSize() * 3 + 1000);
+	for (size_t i = 0; i < samples.size(); ++i)
+		samples[i] = (int16_t)((i * 7919) % 65536 - 32768);
+
+	AudioPeakIndex index(samples.size());
+	for (int64_t i = 0; i < (int64_t)samples.size(); i += AudioPeakIndex::BlockSize())
+		index.Add(&samples[i], i, AudioPeakIndex::BlockSize());
+	EXPECT_TRUE(index.IsIndexed(0, samples.size()));
+
+	const int64_t starts[] = {0, 256, 4096 * 3 + 512, 65536 - 256};
+	const int64_t lengths[] = {256, 4096, 65536 * 2 + 768, 65536 * 3 - 512};
+	for (int64_t start : starts) {
+		for (int64_t length : lengths) {
+			int64_t end = std::min<int64_t>(start + length, samples.size() / 256 * 256);
+			SCOPED_TRACE(start);
+			SCOPED_TRACE(end);
+
+			agi::AudioPeak expected;
+			agi::AccumulatePeak(expected, &samples[start], end - start);
+			auto actual = index.Summarize(start, end);
+			EXPECT_EQ(expected.min, actual.min);
+			EXPECT_EQ(expected.max, actual.max);
+			EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+			EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+		}
+	}
+}
+
+TEST(lagi_audio, cache_get_peaks) {
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+
+	TestAudioProvider<int16_t> uncached;
+	const int64_t starts[] = {-100, 0, 1000, (1 << 22) - 300};
+	const int64_t counts[] = {10, 300, 70000, 1000000};
+	for (int64_t start : starts) {
+		for (int64_t count : counts) {
+			SCOPED_TRACE(start);
+			SCOPED_TRACE(count);
+			auto expected = uncached.GetPeaks(start, count);
+			auto actual = provider->GetPeaks(start, count);
+			EXPECT_EQ(expected.min, actual.min);
+			EXPECT_EQ(expected.max, actual.max);
+			EXPECT_EQ(expected.neg_sum, actual.neg_sum);
+			EXPECT_EQ(expected.pos_sum, actual.pos_sum);
+		}
+	}
+}
+
+TEST(lagi_audio, energy_envelope_edges) {
+	using agi::AudioEnergyEnvelope;
+	AudioEnergyEnvelope envelope(512 * 300 + 100, 48000);
+	const int64_t bin = envelope.BinSize();
+	ASSERT_EQ(512, bin);
+	ASSERT_EQ(301u, envelope.Size());
+
+	// Runs of silence and of a square wave of varying loudness
+	std::vector<int16_t> samples(512 * 300 + 100);
+	std::vector<bool> loud(envelope.Size());
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < envelope.Size(); ++i) {
+		seed = seed * 1103515245 + 12345;
+		loud[i] = i > 0 && (seed >> 16) % 4 ? loud[i - 1] : !(i > 0 && loud[i - 1]);
+		int16_t amplitude = loud[i] ? (int16_t)(1000 + (seed >> 8) % 20000) : (int16_t)((seed >> 8) % 50);
+		for (int64_t j = i * bin; j < std::min<int64_t>((i + 1) * bin, samples.size()); ++j)
+			samples[j] = j % 2 ? amplitude : -amplitude;
+	}
+
+	// Nothing is found before anything has been added
+	const uint16_t threshold = AudioEnergyEnvelope::LevelFromDecibels(-40);
+	EXPECT_EQ(328, threshold);
+	EXPECT_EQ(AudioEnergyEnvelope::unknown, envelope.GetLevel(0));
+	EXPECT_EQ(-1, envelope.FindEdge(10000, 100000, threshold, true));
+
+	envelope.Add(samples.data(), 0, samples.size());
+	for (size_t i = 0; i < envelope.Size(); ++i)
+		ASSERT_EQ(loud[i], envelope.GetLevel(i * bin) >= threshold) << i;
+
+	auto brute_force = [&](int64_t sample, int64_t distance, bool rising) {
+		int64_t best = -1;
+		for (size_t b = 1; b < envelope.Size(); ++b) {
+			if (loud[b - 1] == rising || loud[b] != rising) continue;
+			int64_t pos = b * bin;
+			if (std::abs(pos - sample) > distance) continue;
+			if (best < 0 || std::abs(pos - sample) < std::abs(best - sample))
+				best = pos;
+		}
+		return best;
+	};
+
+	for (int64_t sample = -1000; sample < (int64_t)samples.size() + 1000; sample += 97) {
+		for (int64_t distance : {0, 100, 511, 1500, 5000, 40000}) {
+			SCOPED_TRACE(sample);
+			SCOPED_TRACE(distance);
+			ASSERT_EQ(brute_force(sample, distance, true), envelope.FindEdge(sample, distance, threshold, true));
+			ASSERT_EQ(brute_force(sample, distance, false), envelope.FindEdge(sample, distance, threshold, false));
+		}
+	}
+}
+
+TEST(lagi_audio, energy_envelope_ignores_undecoded) {
+	agi::AudioEnergyEnvelope envelope(4096 * 4, 48000);
+	std::vector<int16_t> samples(4096, 10000);
+	std::fill(samples.begin(), samples.begin() + 2048, 0);
+	envelope.Add(samples.data(), 4096, 4096);
+
+	auto threshold = agi::AudioEnergyEnvelope::LevelFromDecibels(-30);
+	EXPECT_EQ(4096 + 2048, envelope.FindEdge(4096, 4096, threshold, true));
+	// The only falling edges are into audio which hasn't been decoded
+	EXPECT_EQ(-1, envelope.FindEdge(4096, 8192, threshold, false));
+}
+
+TEST(lagi_audio, cache_energy_envelope) {
+	TestAudioProvider<int16_t> uncached;
+	EXPECT_EQ(nullptr, uncached.GetEnergyEnvelope());
+
+	auto provider = agi::CreateRAMAudioProvider(agi::make_unique<TestAudioProvider<int16_t>>());
+	while (provider->GetDecodedSamples() != provider->GetNumSamples()) agi::util::sleep_for(0);
+	auto envelope = provider->GetEnergyEnvelope();
+	ASSERT_NE(nullptr, envelope);
+	ASSERT_EQ((size_t)((provider->GetNumSamples() + envelope->BinSize() - 1) / envelope->BinSize()), envelope->Size());
+
+	std::vector<int16_t> samples(envelope->BinSize());
+	provider->GetAudio(samples.data(), envelope->BinSize() * 100, samples.size());
+	double sum = 0;
+	for (auto sample : samples)
+		sum += (double)sample * sample;
+	EXPECT_NEAR(std::sqrt(sum / samples.size()), envelope->GetLevel(envelope->BinSize() * 100), 1);
+}
+
 TEST(lagi_audio, convert_8bit) {
 	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<TestAudioProvider<uint8_t>>());
 
@@ -358,6 +1177,100 @@ TEST(lagi_audio, double_conversion) {
 		ASSERT_EQ(i + SHRT_MIN, samples[i]);
 }
 
+TEST(lagi_audio, float_stereo_conversion_clamps) {
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 2;
+			num_samples = 48000;
+			decoded_samples = num_samples;
+			sample_rate = 48000;
+			bytes_per_sample = sizeof(float);
+			float_samples = true;
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			static const float values[] = {0.f, 0.5f, -0.5f, 1.f, -1.f, 2.f, -2.f, NAN, 1e30f, -1e30f, 0.25f};
+			auto out = static_cast<float *>(buf);
+			for (int64_t end = start + count; start < end; ++start) {
+				*out++ = values[start % 11];
+				*out++ = values[start % 7];
+			}
+		}
+	};
+
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>());
+	EXPECT_EQ(1, provider->GetChannels());
+	EXPECT_FALSE(provider->AreSamplesFloat());
+
+	static const int expected_values[] = {0, 16383, -16384, 32767, -32768, 32767, -32768, 0, 32767, -32768, 8191};
+	int16_t samples[999];
+	provider->GetAudio(samples, 3, 999);
+	for (int i = 0; i < 999; ++i)
+		ASSERT_EQ((expected_values[(i + 3) % 11] + expected_values[(i + 3) % 7]) / 2, samples[i]) << i;
+}
+
+TEST(lagi_audio, convert_multichannel_low_rate) {
+	// 24-bit, three channels at 11025 Hz, which needs every stage of conversion
+	struct AudioProvider : agi::AudioProvider {
+		AudioProvider() {
+			channels = 3;
+			num_samples = 11025;
+			decoded_samples = num_samples;
+			sample_rate = 11025;
+			bytes_per_sample = 3;
+			float_samples = false;
+		}
+
+		static int Sample(int64_t frame, int channel) {
+			return (int)((frame * 7919 + channel * 104729) % (1 << 24)) - (1 << 23);
+		}
+
+		void FillBuffer(void *buf, int64_t start, int64_t count) const override {
+			auto out = static_cast<uint8_t *>(buf);
+			for (int64_t end = start + count; start < end; ++start) {
+				for (int c = 0; c < 3; ++c) {
+					auto sample = (uint32_t)Sample(start, c);
+					*out++ = (uint8_t)sample;
+					*out++ = (uint8_t)(sample >> 8);
+					*out++ = (uint8_t)(sample >> 16);
+				}
+			}
+		}
+	};
+
+	auto provider = agi::CreateConvertAudioProvider(agi::make_unique<AudioProvider>());
+	EXPECT_EQ(44100, provider->GetSampleRate());
+	EXPECT_EQ(11025 * 4, provider->GetNumSamples());
+
+	// Reference built one stage at a time
+	std::vector<int16_t> mono(11025 + 1);
+	for (int64_t i = 0; i < 11025; ++i) {
+		int sum = 0;
+		for (int c = 0; c < 3; ++c)
+			sum += (int16_t)(AudioProvider::Sample(i, c) >> 8);
+		mono[i] = (int16_t)(sum / 3);
+	}
+	for (int level = 0; level < 2; ++level) {
+		std::vector<int16_t> doubled(mono.size() * 2);
+		for (size_t i = 0; i + 1 < doubled.size(); ++i)
+			doubled[i] = i & 1 ? (int16_t)((mono[i / 2] + mono[i / 2 + 1]) / 2) : mono[i / 2];
+		mono.swap(doubled);
+	}
+
+	for (int64_t start : {0, 1, 2, 3, 5, 1000, 44095}) {
+		SCOPED_TRACE(start);
+		int16_t samples[5];
+		provider->GetAudio(samples, start, 5);
+		for (int i = 0; i < 5; ++i)
+			ASSERT_EQ(mono[start + i], samples[i]);
+	}
+
+	std::vector<int16_t> all(11025 * 4);
+	provider->GetAudio(all.data(), 0, all.size());
+	for (size_t i = 0; i < all.size(); ++i)
+		ASSERT_EQ(mono[i], all[i]) << i;
+}
+
 TEST(lagi_audio, pcm_simple) {
 	auto path = agi::Path().Decode("?temp/pcm_simple");
 	{
@@ -525,6 +1438,32 @@ TEST(lagi_audio, wave64_simple) {
 	agi::fs::Remove(path);
 }
 
+#define RF64_FILE \
+	"RF64\xff\xff\xff\xff" "WAVE"               /* size is in ds64 */ \
+	"ds64\x1c\0\0\0"                            /* ds64 chunk header */ \
+	"\x4e\0\0\0\0\0\0\0" "\6\0\0\0\0\0\0\0" /* riff and data sizes */ \
+	"\3\0\0\0\0\0\0\0" "\0\0\0\0"           /* sample count, table length */ \
+	FMT_VALID                                  \
+	"data\xff\xff\xff\xff" "\1\0\2\0\3\0"      /* data in ds64 */
+
+TEST(lagi_audio, rf64_simple) {
+	auto path = agi::Path().Decode("?temp/rf64_valid");
+	WRITE(RF64_FILE);
+
+	{
+		auto provider = agi::CreatePCMAudioProvider(path, nullptr);
+		ASSERT_EQ(3, provider->GetNumSamples());
+
+		uint16_t samples[3];
+		provider->GetAudio(samples, 0, 3);
+		EXPECT_EQ(1, samples[0]);
+		EXPECT_EQ(2, samples[1]);
+		EXPECT_EQ(3, samples[2]);
+	}
+
+	agi::fs::Remove(path);
+}
+
 TEST(lagi_audio, wave64_truncated) {
 	auto path = agi::Path().Decode("?temp/w64_truncated");
 
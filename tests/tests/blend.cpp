@@ -0,0 +1,77 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/blend.h>
+
+#include <main.h>
+
+#include <vector>
+
+namespace {
+uint8_t Reference(unsigned int dst, unsigned int color, unsigned int mask, unsigned int opacity) {
+	unsigned int k = mask * opacity / 255;
+	return (k * color + (255 - k) * dst) / 255;
+}
+}
+
+TEST(lagi_blend, matches_integer_division) {
+	// Every mask value against every opacity, over destinations which cover
+	// each channel value, with the row width not a multiple of the vector size
+	const int width = 257;
+	std::vector<uint8_t> mask(width), dst(width * 4), orig(width * 4);
+	for (int i = 0; i < width; ++i) mask[i] = i;
+	for (int i = 0; i < width * 4; ++i) orig[i] = i * 7;
+
+	for (unsigned int opacity = 0; opacity < 256; ++opacity) {
+		dst = orig;
+		agi::BlendMask(dst.data(), 0, mask.data(), 0, width, 1, 0x8040C0, opacity);
+		for (int i = 0; i < width; ++i) {
+			ASSERT_EQ(Reference(orig[i * 4 + 0], 0xC0, mask[i], opacity), dst[i * 4 + 0]);
+			ASSERT_EQ(Reference(orig[i * 4 + 1], 0x40, mask[i], opacity), dst[i * 4 + 1]);
+			ASSERT_EQ(Reference(orig[i * 4 + 2], 0x80, mask[i], opacity), dst[i * 4 + 2]);
+			ASSERT_EQ(Reference(orig[i * 4 + 3], 0xFF, mask[i], opacity), dst[i * 4 + 3]);
+		}
+	}
+}
+
+TEST(lagi_blend, transparent_onto_empty_is_premultiplied) {
+	uint8_t dst[4] = {0, 0, 0, 0};
+	uint8_t mask = 255;
+	agi::BlendMask(dst, 0, &mask, 0, 1, 1, 0xFF0000, 128);
+	EXPECT_EQ(0, dst[0]);
+	EXPECT_EQ(0, dst[1]);
+	EXPECT_EQ(128, dst[2]);
+	EXPECT_EQ(128, dst[3]);
+}
+
+TEST(lagi_blend, strides) {
+	// Two rows of a 16 pixel mask drawn bottom-up into a wider frame
+	const int width = 16, frame_width = 20;
+	std::vector<uint8_t> mask(width * 2 + 5, 0);
+	std::vector<uint8_t> frame(frame_width * 4 * 2, 10);
+	mask[3] = 255;
+	mask[width + 5 + 12] = 255;
+
+	agi::BlendMask(frame.data() + frame_width * 4, -frame_width * 4, mask.data(), width + 5, width, 2, 0xFFFFFF, 255);
+
+	for (int y = 0; y < 2; ++y) {
+		for (int x = 0; x < frame_width; ++x) {
+			bool covered = (y == 1 && x == 3) || (y == 0 && x == 12);
+			for (int c = 0; c < 4; ++c)
+				ASSERT_EQ(covered ? 255 : 10, frame[(y * frame_width + x) * 4 + c]) << x << "," << y;
+		}
+	}
+}
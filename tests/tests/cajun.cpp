@@ -178,6 +178,34 @@ TEST(lagi_cajun, Read) {
 	EXPECT_NO_THROW(static_cast<json::Null>(obj["Null"]));
 }
 
+struct event_logger final : json::Reader::Handler {
+	std::string log;
+
+	void ObjectBegin() override { log += "{"; }
+	void Member(std::string const& name) override { log += name + ":"; }
+	void ObjectEnd() override { log += "}"; }
+	void ArrayBegin() override { log += "["; }
+	void ArrayEnd() override { log += "]"; }
+	void Value(json::Integer number) override { log += "i" + std::to_string(number) + ","; }
+	void Value(json::Double number) override { log += "d" + std::to_string(number) + ","; }
+	void Value(json::String&& string) override { log += "s" + string + ","; }
+	void Value(json::Boolean boolean) override { log += boolean ? "true," : "false,"; }
+	void Value(json::Null) override { log += "null,"; }
+};
+
+TEST(lagi_cajun, ReadHandler) {
+	event_logger logger;
+	std::istringstream doc("{\"a\" : [1, 2.5, \"str\"], \"b\" : {\"c\" : true, \"d\" : null}, \"e\" : {}}");
+	ASSERT_NO_THROW(json::Reader::Read(logger, doc));
+	EXPECT_EQ("{a:[i1,d2.500000,sstr,]b:{c:true,d:null,}e:{}}", logger.log);
+
+	std::istringstream nested_dupe_names("{\"a\" : {\"a\" : 1}, \"b\" : {\"a\" : 2}}");
+	EXPECT_NO_THROW(json::Reader::Read(logger, nested_dupe_names));
+
+	std::istringstream dupe_after_nested("{\"a\" : {\"b\" : 1}, \"a\" : 2}");
+	EXPECT_THROW(json::Reader::Read(logger, dupe_after_nested), json::Exception);
+}
+
 TEST(lagi_cajun, Write) {
 	json::Object obj;
 	obj["Boolean"] = true;
@@ -76,3 +76,20 @@ TEST(lagi_calltip, unknown_tag) {
 	expect_tip("{\\foo(100,100,100)}hello", 3, bad_tip);
 	expect_tip("{\\toolong(100,100,100)}hello", 3, bad_tip);
 }
+
+TEST(lagi_calltip, reused_index) {
+	std::string line = "{\\pos(1,2)\\t(0,500,\\c&HFF&)}text{comment}{\\fad(10,20)\\clip(1,m 0 0 l 5 5)}more";
+	auto tokenized_line = agi::ass::TokenizeDialogueBody(line, false);
+	auto index = agi::IndexCalltips(tokenized_line);
+
+	for (size_t pos = 0; pos <= line.size() + 1; ++pos) {
+		auto expected = agi::GetCalltip(tokenized_line, line, pos);
+		auto actual = agi::GetCalltip(tokenized_line, index, line, pos);
+		EXPECT_EQ(expected.text, actual.text) << pos;
+		EXPECT_EQ(expected.tag_position, actual.tag_position) << pos;
+		EXPECT_EQ(expected.highlight_start, actual.highlight_start) << pos;
+		EXPECT_EQ(expected.highlight_end, actual.highlight_end) << pos;
+	}
+
+	expect_tip(line.c_str(), 9, Calltip{"\\pos(X,Y)", 7, 8, 2});
+}
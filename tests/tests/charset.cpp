@@ -0,0 +1,61 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/charset.h>
+#include <libaegisub/io.h>
+
+#include <string>
+
+namespace {
+void write_file(const char *path, std::string const& data) {
+	agi::io::Save file(path, true);
+	file.Get().write(data.data(), data.size());
+}
+}
+
+TEST(lagi_charset, magic_bytes) {
+	write_file("data/charset", "\xef\xbb\xbf" "abc");
+	EXPECT_EQ("utf-8", agi::charset::Detect("data/charset"));
+	write_file("data/charset", std::string("\xff\xfe" "a\0b\0", 6));
+	EXPECT_EQ("utf-16le", agi::charset::Detect("data/charset"));
+	write_file("data/charset", std::string("\xfe\xff\0a\0b", 6));
+	EXPECT_EQ("utf-16be", agi::charset::Detect("data/charset"));
+}
+
+TEST(lagi_charset, utf8_without_bom) {
+	write_file("data/charset", "");
+	EXPECT_EQ("utf-8", agi::charset::Detect("data/charset"));
+	write_file("data/charset", "[Script Info]\r\nTitle: plain ascii\r\n");
+	EXPECT_EQ("utf-8", agi::charset::Detect("data/charset"));
+	write_file("data/charset", "Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e \xf0\x9f\x98\x80 \xc3\xa9\n");
+	EXPECT_EQ("utf-8", agi::charset::Detect("data/charset"));
+
+	// Multibyte characters split across the sampled chunks
+	std::string big;
+	while (big.size() < 1024 * 1024)
+		big += "Dialogue: 0,0:00:00.00,0:00:05.00,Default,,0,0,0,,\xe3\x81\x82\xe3\x81\x84\n";
+	write_file("data/charset", big);
+	EXPECT_EQ("utf-8", agi::charset::Detect("data/charset"));
+}
+
+TEST(lagi_charset, binary) {
+	write_file("data/charset", "\x1a\x45\xdf\xa3 matroska");
+	EXPECT_EQ("binary", agi::charset::Detect("data/charset"));
+	write_file("data/charset", std::string(1000, '\0') + "text");
+	EXPECT_EQ("binary", agi::charset::Detect("data/charset"));
+}
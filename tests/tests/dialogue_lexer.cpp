@@ -17,6 +17,8 @@
 #include <main.h>
 #include <util.h>
 
+#include <random>
+
 class lagi_dialogue_lexer : public libagi {
 };
 
@@ -359,3 +361,78 @@ TEST(lagi_dialogue_lexer, templater_expression) {
 		expect_tok(ARG, 1u);
 	);
 }
+
+TEST(lagi_dialogue_lexer, retokenize_matches_full) {
+	static const char chars[] = "{}\\()!,$ abNnhpr01";
+	std::mt19937 rng(1234);
+	auto random_char = [&] { return chars[rng() % (sizeof chars - 1)]; };
+
+	for (int line = 0; line < 200; ++line) {
+		std::string text;
+		for (int i = rng() % 40; i > 0; --i) text += random_char();
+		auto tokens = TokenizeDialogueBody(text);
+
+		for (int edit = 0; edit < 50; ++edit) {
+			std::string edited = text;
+			size_t pos = edited.empty() ? 0 : rng() % edited.size();
+			if (rng() % 2 && !edited.empty())
+				edited.erase(pos, 1 + rng() % 3);
+			else
+				edited.insert(pos, 1 + rng() % 3, random_char());
+
+			auto range = RetokenizeDialogueBody(text, edited, tokens);
+			auto expected = TokenizeDialogueBody(edited);
+			ASSERT_EQ(expected.size(), tokens.size()) << text << " -> " << edited;
+			for (size_t i = 0; i < tokens.size(); ++i) {
+				EXPECT_EQ(expected[i].type, tokens[i].type) << text << " -> " << edited;
+				EXPECT_EQ(expected[i].length, tokens[i].length) << text << " -> " << edited;
+			}
+			EXPECT_LE(range.first, range.second);
+			EXPECT_LE(range.second, edited.size());
+			text = edited;
+		}
+	}
+}
+
+TEST(lagi_dialogue_lexer, retokenize_range) {
+	std::string text = "{\\b1}abc{\\i1}def";
+	auto tokens = TokenizeDialogueBody(text);
+
+	auto range = RetokenizeDialogueBody(text, "{\\b1}abcd{\\i1}def", tokens);
+	EXPECT_EQ(5u, range.first);
+	EXPECT_EQ(14u, range.second);
+
+	text = "{\\b1}abcd{\\i1}def";
+	range = RetokenizeDialogueBody(text, text, tokens);
+	EXPECT_EQ(range.first, range.second);
+}
+
+TEST(lagi_dialogue_lexer, drawing_tokens) {
+	std::string str = "m 0 0  l 10.5 -2 abc 1e2 b";
+	const char *pos = str.data(), *end = str.data() + str.size();
+	DrawingToken token;
+
+	auto expect_command = [&](char command) {
+		ASSERT_TRUE(NextDrawingToken(pos, end, token));
+		EXPECT_EQ(command, token.command);
+	};
+	auto expect_value = [&](double value) {
+		ASSERT_TRUE(NextDrawingToken(pos, end, token));
+		EXPECT_EQ(0, token.command);
+		EXPECT_DOUBLE_EQ(value, token.value);
+	};
+
+	expect_command('m');
+	expect_value(0);
+	expect_value(0);
+	expect_command('l');
+	expect_value(10.5);
+	expect_value(-2);
+	expect_value(100);
+	expect_command('b');
+	EXPECT_FALSE(NextDrawingToken(pos, end, token));
+
+	std::string blank = "   ";
+	pos = blank.data();
+	EXPECT_FALSE(NextDrawingToken(pos, blank.data() + blank.size(), token));
+}
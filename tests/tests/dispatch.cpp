@@ -0,0 +1,147 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/dispatch.h>
+
+#include <atomic>
+#include <numeric>
+#include <thread>
+
+using namespace agi::dispatch;
+
+TEST(lagi_dispatch, serial_queue_runs_in_order) {
+	auto queue = Create();
+	std::vector<int> order;
+	for (int i = 0; i < 100; ++i)
+		queue->Async([&, i] { order.push_back(i); });
+	queue->Sync([] { });
+
+	std::vector<int> expected(100);
+	std::iota(expected.begin(), expected.end(), 0);
+	EXPECT_EQ(expected, order);
+}
+
+TEST(lagi_dispatch, serial_queue_outlives_handle) {
+	std::atomic<int> ran{0};
+	{
+		auto queue = Create(Priority::Background);
+		for (int i = 0; i < 10; ++i)
+			queue->Async([&] { ++ran; });
+	}
+	while (ran != 10) std::this_thread::yield();
+	EXPECT_EQ(10, ran);
+}
+
+TEST(lagi_dispatch, background_priorities) {
+	std::atomic<int> ran{0};
+	for (auto priority : {Priority::UI, Priority::Interactive, Priority::Background})
+		Background(priority).Sync([&] { ++ran; });
+	EXPECT_EQ(3, ran);
+}
+
+TEST(lagi_dispatch, parallel_for_covers_range) {
+	std::vector<std::atomic<int>> hits(10000);
+	ParallelFor(0, hits.size(), 16, [&](size_t begin, size_t end) {
+		EXPECT_LT(begin, end);
+		for (size_t i = begin; i < end; ++i)
+			++hits[i];
+	});
+	for (auto& hit : hits)
+		EXPECT_EQ(1, hit);
+}
+
+TEST(lagi_dispatch, parallel_for_small_ranges) {
+	int calls = 0;
+	ParallelFor(5, 5, 1, [&](size_t, size_t) { ++calls; });
+	EXPECT_EQ(0, calls);
+	ParallelFor(0, 10, 100, [&](size_t begin, size_t end) {
+		EXPECT_EQ(0u, begin);
+		EXPECT_EQ(10u, end);
+		++calls;
+	});
+	EXPECT_EQ(1, calls);
+}
+
+TEST(lagi_dispatch, parallel_for_rethrows) {
+	EXPECT_THROW(ParallelFor(0, 1000, 1, [](size_t begin, size_t) {
+		if (begin == 0) throw std::runtime_error("chunk failed");
+	}), std::runtime_error);
+}
+
+TEST(lagi_dispatch, nested_parallel_for) {
+	std::atomic<size_t> total{0};
+	ParallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			ParallelFor(0, 100, 1, [&](size_t b, size_t e) { total += e - b; });
+		}
+	});
+	EXPECT_EQ(6400u, total);
+}
+
+TEST(lagi_dispatch, parallel_reduce) {
+	auto sum = ParallelReduce(0, 100001, 10, (uint64_t)0,
+		[](size_t begin, size_t end) {
+			uint64_t sum = 0;
+			for (size_t i = begin; i < end; ++i) sum += i;
+			return sum;
+		},
+		[](uint64_t a, uint64_t b) { return a + b; });
+	EXPECT_EQ(5000050000u, sum);
+
+	// Results are combined in order
+	auto str = ParallelReduce(0, 20, 1, std::string(),
+		[](size_t begin, size_t end) {
+			std::string s;
+			for (size_t i = begin; i < end; ++i) s += (char)('a' + i);
+			return s;
+		},
+		[](std::string a, std::string const& b) { return a + b; });
+	EXPECT_EQ("abcdefghijklmnopqrst", str);
+}
+
+TEST(lagi_dispatch, cancelled_thunks_do_not_run) {
+	auto queue = Create();
+	bool ran = false;
+	CancellationToken token;
+	token.Cancel();
+	queue->Async([&] { ran = true; }, token);
+	queue->Sync([] { });
+	EXPECT_FALSE(ran);
+
+	CancellationToken live;
+	queue->Async([&] { ran = true; }, live);
+	queue->Sync([] { });
+	EXPECT_TRUE(ran);
+}
+
+TEST(lagi_dispatch, coalescing_queue_keeps_latest) {
+	CoalescingQueue queue;
+	std::atomic<bool> release{false};
+	queue.Async([&] { while (!release) std::this_thread::yield(); });
+
+	std::vector<int> ran;
+	for (int i = 0; i < 10; ++i)
+		queue.Async(1, [&, i] { ran.push_back(i); });
+	queue.Async(2, [&] { ran.push_back(100); });
+	queue.Async([&] { ran.push_back(200); });
+
+	release = true;
+	queue.Sync([] { });
+	EXPECT_EQ((std::vector<int>{9, 100, 200}), ran);
+}
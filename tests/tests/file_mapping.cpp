@@ -0,0 +1,112 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <main.h>
+
+#include <libaegisub/file_mapping.h>
+#include <libaegisub/fs.h>
+#include <libaegisub/io.h>
+
+TEST(lagi_file_mapping, persistent_survives_close) {
+	agi::fs::Remove("data/persistent_mapping");
+
+	{
+		agi::persistent_file_mapping file("data/persistent_mapping");
+		EXPECT_EQ(0u, file.size());
+		file.resize(10);
+		memcpy(file.write(0, 10), "0123456789", 10);
+	}
+
+	{
+		agi::persistent_file_mapping file("data/persistent_mapping");
+		ASSERT_EQ(10u, file.size());
+		EXPECT_EQ(0, memcmp(file.read(0, 10), "0123456789", 10));
+
+		file.resize(20);
+		EXPECT_EQ(0, memcmp(file.read(0, 10), "0123456789", 10));
+		memcpy(file.write(10, 10), "abcdefghij", 10);
+	}
+
+	agi::read_file_mapping file("data/persistent_mapping");
+	ASSERT_EQ(20u, file.size());
+	EXPECT_EQ(0, memcmp(file.read(), "0123456789abcdefghij", 20));
+}
+
+TEST(lagi_file_mapping, windowed_reads) {
+	const size_t mb = 0x100000;
+	{
+		std::vector<char> data(mb * 3 + 100);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = static_cast<char>(i / 4096 + i);
+		agi::io::Save file("data/windowed_mapping", true);
+		file.Get().write(data.data(), data.size());
+	}
+
+	auto check = [](const char *ptr, uint64_t offset, uint64_t length) {
+		for (uint64_t i = 0; i < length; ++i) {
+			if (ptr[i] != static_cast<char>((offset + i) / 4096 + offset + i))
+				return false;
+		}
+		return true;
+	};
+
+	agi::windowed_file_mapping file("data/windowed_mapping", mb, 2);
+	ASSERT_EQ(mb * 3 + 100, file.size());
+	EXPECT_EQ(mb, file.window());
+
+	// Within a window, then past its middle so the next one is prefetched
+	EXPECT_TRUE(check(file.read(10, 100), 10, 100));
+	EXPECT_TRUE(check(file.read(mb - 100, 100), mb - 100, 100));
+
+	// Across a boundary, which needs a bigger window
+	EXPECT_TRUE(check(file.read(mb * 2 - 50, 100), mb * 2 - 50, 100));
+
+	// The short window at the end of the file
+	EXPECT_TRUE(check(file.read(mb * 3, 100), mb * 3, 100));
+
+	// Going backwards after the early windows have been evicted
+	EXPECT_TRUE(check(file.read(0, mb), 0, mb));
+	EXPECT_TRUE(check(file.read(5, mb * 3 + 95), 5, mb * 3 + 95));
+
+	EXPECT_THROW(file.read(mb * 3, 101), agi::InternalError);
+}
+
+TEST(lagi_file_mapping, shared_read_mapping) {
+	{
+		agi::io::Save file("data/shared_mapping", true);
+		file.Get() << "shared";
+	}
+
+	// Without a scope every open gets its own mapping
+	EXPECT_NE(agi::open_read_mapping("data/shared_mapping"), agi::open_read_mapping("data/shared_mapping"));
+
+	std::shared_ptr<agi::read_file_mapping> first;
+	{
+		agi::shared_read_mapping scope("data/shared_mapping");
+		first = agi::open_read_mapping("data/shared_mapping");
+		EXPECT_EQ(first, agi::open_read_mapping("data/shared_mapping"));
+
+		{
+			agi::shared_read_mapping nested("data/shared_mapping");
+			EXPECT_EQ(first, agi::open_read_mapping("data/shared_mapping"));
+		}
+
+		ASSERT_EQ(6u, first->size());
+		EXPECT_EQ(0, memcmp(first->read(), "shared", 6));
+	}
+
+	EXPECT_NE(first, agi::open_read_mapping("data/shared_mapping"));
+}
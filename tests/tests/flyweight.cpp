@@ -0,0 +1,82 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/flyweight.h>
+
+#include <thread>
+#include <vector>
+
+using agi::StringFlyweight;
+
+TEST(lagi_flyweight, equal_values_share_storage) {
+	StringFlyweight a("abc"), b(std::string("abc")), c("abd");
+	EXPECT_EQ(&a.get(), &b.get());
+	EXPECT_NE(&a.get(), &c.get());
+	EXPECT_TRUE(a == b);
+	EXPECT_FALSE(a == c);
+	EXPECT_EQ("abc", a.get());
+}
+
+TEST(lagi_flyweight, copies_keep_value_alive) {
+	StringFlyweight copy;
+	{
+		StringFlyweight original("only here");
+		copy = original;
+	}
+	EXPECT_EQ("only here", copy.get());
+	StringFlyweight again("only here");
+	EXPECT_EQ(&copy.get(), &again.get());
+}
+
+TEST(lagi_flyweight, released_values_are_reinserted) {
+	std::string first;
+	{
+		StringFlyweight a("released value");
+		first = a.get();
+	}
+	StringFlyweight b("released value");
+	EXPECT_EQ(first, b.get());
+}
+
+TEST(lagi_flyweight, concurrent_insert_and_release) {
+	const int thread_count = 8;
+	const int values = 200;
+	std::vector<std::thread> threads;
+	std::vector<std::vector<StringFlyweight>> kept(thread_count);
+	for (int t = 0; t < thread_count; ++t) {
+		threads.emplace_back([&, t] {
+			for (int round = 0; round < 50; ++round) {
+				std::vector<StringFlyweight> strings;
+				for (int i = 0; i < values; ++i)
+					strings.emplace_back(std::to_string(i));
+				auto copies = strings;
+				if (round == 0)
+					kept[t] = std::move(copies);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	for (int i = 0; i < values; ++i) {
+		StringFlyweight expected(std::to_string(i));
+		for (auto const& strings : kept)
+			ASSERT_EQ(&expected.get(), &strings[i].get());
+	}
+}
@@ -17,8 +17,11 @@
 #include <main.h>
 #include <util.h>
 
+#include <libaegisub/dir_listing.h>
 #include <libaegisub/fs.h>
 
+#include <boost/filesystem/operations.hpp>
+
 using namespace agi::fs;
 
 TEST(lagi_fs, exists) {
@@ -195,3 +198,36 @@ TEST(lagi_fs, dir_iterator_all_filtered_out) {
 	ASSERT_NO_THROW(DirectoryIterator("data/dir_iterator", "*.c").GetAll(files));
 	EXPECT_TRUE(files.empty());
 }
+
+TEST(lagi_fs, list_directory_bad_directory) {
+	EXPECT_TRUE(ListDirectory("data/nonexistent", "*.*").empty());
+}
+
+TEST(lagi_fs, list_directory_matches_dir_iterator) {
+	auto files = ListDirectory("data/dir_iterator", "*.a");
+	sort(begin(files), end(files));
+	ASSERT_EQ(2u, files.size());
+	EXPECT_STREQ("1.a", files[0].c_str());
+	EXPECT_STREQ("2.a", files[1].c_str());
+}
+
+TEST(lagi_fs, list_directory_reused_until_modified) {
+	ClearDirectoryListings();
+	boost::filesystem::remove_all("data/dir_listing");
+	CreateDirectory("data/dir_listing");
+	Touch("data/dir_listing/1.a");
+
+	// Listings of directories modified in the last couple of seconds aren't
+	// cached, so pretend this one is older
+	auto old_time = time(nullptr) - 100;
+	boost::filesystem::last_write_time("data/dir_listing", old_time);
+	EXPECT_EQ(1u, ListDirectory("data/dir_listing", "*.a").size());
+
+	Touch("data/dir_listing/2.a");
+	boost::filesystem::last_write_time("data/dir_listing", old_time);
+	EXPECT_EQ(1u, ListDirectory("data/dir_listing", "*.a").size());
+	EXPECT_EQ(0u, ListDirectory("data/dir_listing", "*.b").size());
+
+	boost::filesystem::last_write_time("data/dir_listing", old_time + 1);
+	EXPECT_EQ(2u, ListDirectory("data/dir_listing", "*.a").size());
+}
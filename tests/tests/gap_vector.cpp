@@ -0,0 +1,97 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <libaegisub/gap_vector.h>
+
+#include <main.h>
+
+using agi::gap_vector;
+
+namespace {
+std::vector<int> iota_vector(int count) {
+	std::vector<int> ret;
+	for (int i = 0; i < count; ++i) ret.push_back(i);
+	return ret;
+}
+}
+
+TEST(lagi_gap_vector, construct_from_vector) {
+	gap_vector<int> v(iota_vector(10));
+	ASSERT_EQ(10u, v.size());
+	for (int i = 0; i < 10; ++i)
+		EXPECT_EQ(i, v[i]);
+	EXPECT_EQ(iota_vector(10), v.to_vector());
+}
+
+TEST(lagi_gap_vector, insert) {
+	gap_vector<int> v;
+	EXPECT_TRUE(v.empty());
+
+	v.push_back(1);
+	v.push_back(3);
+	v.insert(0, 0);
+	v.insert(2, 2);
+	EXPECT_EQ(iota_vector(4), v.to_vector());
+}
+
+TEST(lagi_gap_vector, insert_range) {
+	gap_vector<int> v(iota_vector(3));
+	std::vector<int> more{10, 11, 12};
+	v.insert(1, more.begin(), more.end());
+	EXPECT_EQ((std::vector<int>{0, 10, 11, 12, 1, 2}), v.to_vector());
+}
+
+TEST(lagi_gap_vector, erase) {
+	gap_vector<int> v(iota_vector(10));
+	v.erase(8);
+	v.erase(0, 3);
+	v.erase(2);
+	EXPECT_EQ((std::vector<int>{3, 4, 6, 7, 9}), v.to_vector());
+
+	v.erase(3, 3);
+	EXPECT_EQ(5u, v.size());
+}
+
+TEST(lagi_gap_vector, scattered_edits_match_vector) {
+	gap_vector<int> v(iota_vector(100));
+	std::vector<int> expected = iota_vector(100);
+
+	for (int i = 0; i < 500; ++i) {
+		size_t pos = (i * 37) % (expected.size() + 1);
+		if (i % 3 == 0 && pos < expected.size()) {
+			v.erase(pos);
+			expected.erase(expected.begin() + pos);
+		}
+		else {
+			v.insert(pos, -i);
+			expected.insert(expected.begin() + pos, -i);
+		}
+	}
+
+	ASSERT_EQ(expected.size(), v.size());
+	for (size_t i = 0; i < expected.size(); ++i)
+		EXPECT_EQ(expected[i], v[i]);
+}
+
+TEST(lagi_gap_vector, release) {
+	gap_vector<int> v(iota_vector(10));
+	v.erase(2, 5);
+	v.insert(2, 4);
+	auto vec = v.release();
+	EXPECT_EQ((std::vector<int>{0, 1, 4, 5, 6, 7, 8, 9}), vec);
+	EXPECT_TRUE(v.empty());
+}
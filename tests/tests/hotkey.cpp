@@ -42,6 +42,13 @@ TEST(lagi_hotkey, empty_default) {
 	EXPECT_THROW(Hotkey("", ""), std::exception);
 }
 
+TEST(lagi_hotkey, malformed_default) {
+	EXPECT_THROW(Hotkey("", "{\"Always\":[]}"), std::exception);
+	EXPECT_THROW(Hotkey("", "{\"Always\":{\"cmd1\":\"Ctrl-C\"}}"), std::exception);
+	EXPECT_THROW(Hotkey("", "{\"Always\":{\"cmd1\":[{\"modifiers\":\"Ctrl\", \"key\":\"C\"}]}}"), std::exception);
+	EXPECT_NO_THROW(Hotkey("", "{\"Always\":{\"cmd1\":[\"Ctrl-C\", 5, {\"key\":\"C\"}]}}"));
+}
+
 TEST(lagi_hotkey, scan) {
 	Hotkey h("", simple_valid);
 
@@ -96,6 +103,42 @@ TEST(lagi_hotkey, scan) {
 	EXPECT_STREQ("", h.Scan("Nonexistent", "C", true).c_str());
 }
 
+static uint32_t test_key_code(std::string const& name) {
+	if (name.size() == 1) return (unsigned char)name[0];
+	if (name == "F1") return 1000;
+	return 0;
+}
+
+TEST(lagi_hotkey, scan_packed_matches_scan) {
+	Hotkey h("", R"raw({
+		"Always":{"cmd1":["Ctrl-C", "F1"], "cmd4":["Ctrl-C"]},
+		"Default":{"cmd1":["Alt-C"], "cmd2":["Ctrl-C", "Ctrl-Alt-Shift--"]},
+		"Other":{"cmd1":["Shift-C"], "cmd3":["Q", "Shift-Ctrl-Q", "Ctrl-Unknown"]}
+	})raw");
+
+	EXPECT_STREQ("", h.Scan("Default", MOD_CTRL | 'C', false).c_str());
+	h.SetKeyCodeLookup(test_key_code);
+
+	const char *combos[] = {"Ctrl-C", "Alt-C", "Shift-C", "Q", "C", "F1", "Ctrl-Alt-Shift--"};
+	for (auto str : combos) {
+		uint32_t packed = 0;
+		std::string key = str;
+		if (!key.compare(0, 5, "Ctrl-")) { packed |= MOD_CTRL; key.erase(0, 5); }
+		if (!key.compare(0, 4, "Alt-")) { packed |= MOD_ALT; key.erase(0, 4); }
+		if (!key.compare(0, 6, "Shift-")) { packed |= MOD_SHIFT; key.erase(0, 6); }
+		packed |= test_key_code(key);
+
+		for (auto context : {"Always", "Default", "Other", "Nonexistent"}) {
+			for (bool always : {false, true})
+				EXPECT_EQ(h.Scan(context, str, always), h.Scan(context, packed, always)) << str << " " << context << " " << always;
+		}
+	}
+
+	// Combos which can't come from a keypress never match
+	EXPECT_STREQ("", h.Scan("Other", MOD_SHIFT | MOD_CTRL | 'Q', false).c_str());
+	EXPECT_STREQ("", h.Scan("Other", MOD_CTRL, false).c_str());
+}
+
 TEST(lagi_hotkey, get_hotkey) {
 	Hotkey h("", simple_valid);
 
@@ -178,6 +221,12 @@ TEST(lagi_hotkey, set_hotkey_map) {
 
 		EXPECT_STREQ("cmd1", h.Scan("Always", "C", false).c_str());
 		EXPECT_STREQ("cmd2", h.Scan("Default", "Shift-C", false).c_str());
+
+		h.SetKeyCodeLookup(test_key_code);
+		h.SetHotkeyMap(Hotkey::HotkeyMap());
+		EXPECT_STREQ("", h.Scan("Always", 'C', false).c_str());
+		h.SetHotkeyMap(hm);
+		EXPECT_STREQ("cmd2", h.Scan("Default", MOD_SHIFT | 'C', false).c_str());
 	}
 
 	EXPECT_EQ(2, Hotkey("data/hotkey_tmp", "{}").GetHotkeyMap().size());
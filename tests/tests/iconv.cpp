@@ -146,6 +146,85 @@ TEST(lagi_iconv, Roundtrip) {
 	}
 }
 
+namespace {
+/// Text with runs of ASCII long enough for the block conversions and
+/// characters of each UTF-8 length
+const std::string unicode_text =
+	"\xEF\xBB\xBF" "Jackdaws love my big sphinx of quartz, "
+	"caf\xC3\xA9 \xE2\x98\x83 \xF0\x9F\x98\x80 \xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E "
+	"and some more plain text to finish it off";
+
+/// Convert with iconv directly, skipping IconvWrapper's own converters
+std::string iconv_convert(const char *from, const char *to, std::string const& str) {
+	Iconv cd(from, to);
+	std::string out(str.size() * 4, '\0');
+	const char *src = str.data();
+	size_t src_len = str.size();
+	char *dst = &out[0];
+	size_t dst_len = out.size();
+	EXPECT_NE((size_t)-1, cd(&src, &src_len, &dst, &dst_len));
+	out.resize(out.size() - dst_len);
+	return out;
+}
+}
+
+TEST(lagi_iconv, UnicodeMatchesIconv) {
+	auto utf16 = iconv_convert("UTF-8", "UTF-16LE", unicode_text);
+	EXPECT_EQ(utf16, IconvWrapper("UTF-8", "UTF-16LE").Convert(unicode_text));
+	EXPECT_EQ(unicode_text, IconvWrapper("UTF-16LE", "UTF-8").Convert(utf16));
+	EXPECT_EQ(unicode_text, IconvWrapper("Unicode (UTF-8)", "utf-8").Convert(unicode_text));
+}
+
+TEST(lagi_iconv, UnicodeSmallBuffer) {
+	// Every conversion has to stop on a character boundary
+	IconvWrapper conv("UTF-8", "UTF-16LE");
+	auto expected = conv.Convert(unicode_text);
+	for (size_t size = 4; size < 40; ++size) {
+		std::string out;
+		const char *src = unicode_text.data();
+		size_t src_len = unicode_text.size();
+		while (src_len) {
+			std::vector<char> buff(size);
+			char *dst = buff.data();
+			size_t dst_len = size;
+			size_t res = conv.Convert(&src, &src_len, &dst, &dst_len);
+			ASSERT_TRUE(res == 0 || errno == E2BIG);
+			ASSERT_NE(size, dst_len);
+			out.append(buff.data(), dst);
+		}
+		EXPECT_EQ(expected, out);
+	}
+}
+
+TEST(lagi_iconv, UnicodeBadInput) {
+	// Whatever iconv does with bad input, it does the same after valid text
+	// is converted without it
+	auto check = [](const char *from, const char *to, std::string const& prefix, std::string const& bad) {
+		IconvWrapper conv(from, to, false);
+		std::string expected, actual;
+		bool expected_throws = false, actual_throws = false;
+		try { expected = conv.Convert(prefix) + conv.Convert(bad); }
+		catch (BadInput const&) { expected_throws = true; }
+		try { actual = conv.Convert(prefix + bad); }
+		catch (BadInput const&) { actual_throws = true; }
+		EXPECT_EQ(expected_throws, actual_throws);
+		if (!expected_throws) {
+			EXPECT_EQ(expected, actual);
+		}
+	};
+
+	std::string prefix = "Jackdaws love my big sphinx of quartz";
+	for (const char *bad : {"\xFF", "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x98"}) {
+		check("UTF-8", "UTF-8", prefix, bad);
+		check("UTF-8", "UTF-16LE", prefix, bad);
+	}
+
+	auto prefix16 = IconvWrapper("UTF-8", "UTF-16LE").Convert(prefix);
+	check("UTF-16LE", "UTF-8", prefix16, std::string("\x00\xDC", 2));
+	check("UTF-16LE", "UTF-8", prefix16, std::string("\x00\xD8\x41\x00", 4));
+	check("UTF-16LE", "UTF-8", prefix16, std::string("\x41", 1));
+}
+
 TEST(lagi_iconv, Iso6937) {
 	ASSERT_NO_THROW(IconvWrapper("UTF-8", "ISO-6937-2"));
 	IconvWrapper subst("UTF-8", "ISO-6937-2");
@@ -195,3 +195,40 @@ TEST(lagi_karaoke_matcher, lookahead_is_case_insensitive) {
 	EXPECT_EQ((karaoke_match_result{1, 3}),
 	          auto_match_karaoke({"Oh... ", "Nan", "ka ", "ta", "ri", "nai"}, "Oh…なんか足りない"));
 }
+
+using agi::auto_match_karaoke_line;
+using results = std::vector<karaoke_match_result>;
+
+TEST(lagi_karaoke_matcher, line_empty_src_gives_no_groups) {
+	EXPECT_TRUE(auto_match_karaoke_line({}, "").empty());
+	EXPECT_TRUE(auto_match_karaoke_line({}, "abc").empty());
+}
+
+TEST(lagi_karaoke_matcher, line_empty_dest_gives_one_group) {
+	EXPECT_EQ((results{{2, 0}}), auto_match_karaoke_line({"a", "b"}, ""));
+}
+
+TEST(lagi_karaoke_matcher, line_kana_are_matched_individually) {
+	EXPECT_EQ((results{{1, 1}, {1, 1}, {1, 1}}), auto_match_karaoke_line({"ro", "ma", "ji"}, "ろまじ"));
+	EXPECT_EQ((results{{1, 2}, {1, 1}}), auto_match_karaoke_line({"kya", "e"}, "きゃえ"));
+}
+
+TEST(lagi_karaoke_matcher, line_kanji_take_syllables_between_kana) {
+	EXPECT_EQ((results{{2, 1}, {1, 1}}), auto_match_karaoke_line({"Bo", "ku", "wa"}, "僕は"));
+	EXPECT_EQ((results{{1, 1}, {2, 2}}), auto_match_karaoke_line({"shi", "tta", ""}, "知った"));
+	EXPECT_EQ((results{{2, 1}, {1, 1}, {1, 1}}), auto_match_karaoke_line({"ki", "mi", "ga", "su"}, "君がす"));
+}
+
+TEST(lagi_karaoke_matcher, line_groups_cover_everything) {
+	std::vector<std::string> src{"Oh... ", "Nan", "ka ", "ta", "ri", "nai"};
+	std::string dst = "Oh…なんか足りない";
+	auto groups = auto_match_karaoke_line(src, dst);
+	size_t syllables = 0, characters = 0;
+	for (auto const& group : groups) {
+		syllables += group.source_length;
+		characters += group.destination_length;
+	}
+	EXPECT_EQ(src.size(), syllables);
+	EXPECT_EQ(10u, characters);
+	EXPECT_EQ((results{{1, 3}, {1, 2}, {1, 1}, {1, 1}, {1, 1}, {1, 2}}), groups);
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/log.h>
+#include <libaegisub/make_unique.h>
+
+#include <thread>
+
+using namespace agi::log;
+
+namespace {
+SinkMessage make_message(std::string text) {
+	SinkMessage sm;
+	sm.message = std::move(text);
+	sm.time = 0;
+	sm.section = "test";
+	sm.file = __FILE__;
+	sm.func = __FUNCTION__;
+	sm.severity = Debug;
+	sm.line = __LINE__;
+	return sm;
+}
+
+struct CollectingEmitter final : Emitter {
+	std::vector<std::string>& messages;
+	CollectingEmitter(std::vector<std::string>& messages) : messages(messages) { }
+	void log(SinkMessage const& sm) override { messages.push_back(sm.message); }
+};
+}
+
+TEST(lagi_log, filtered_messages_are_not_formatted) {
+	bool formatted = false;
+	agi::log::log->SetMaxSeverity(Warning);
+
+	LOG_D("test") << (formatted = true);
+	EXPECT_FALSE(formatted);
+	LOG_I("test") << (formatted = true);
+	EXPECT_FALSE(formatted);
+	LOG_W("test") << (formatted = true);
+	EXPECT_TRUE(formatted);
+
+	agi::log::log->SetMaxSeverity(Debug);
+	formatted = false;
+	LOG_D("test") << (formatted = true);
+	EXPECT_TRUE(formatted);
+}
+
+TEST(lagi_log, history_is_bounded) {
+	LogSink sink;
+	for (int i = 0; i < 300; ++i)
+		sink.Log(make_message(std::to_string(i)));
+
+	auto messages = sink.GetMessages();
+	ASSERT_EQ(250u, messages.size());
+	EXPECT_EQ("50", messages.front().message);
+	EXPECT_EQ("299", messages.back().message);
+}
+
+TEST(lagi_log, messages_from_each_thread_stay_in_order) {
+	std::vector<std::string> emitted;
+	LogSink sink;
+	sink.Subscribe(agi::make_unique<CollectingEmitter>(emitted));
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&, t] {
+			for (int i = 0; i < 1000; ++i)
+				sink.Log(make_message(std::to_string(t) + " " + std::to_string(i)));
+		});
+	}
+	for (auto& thread : threads) thread.join();
+
+	// GetMessages waits for everything logged before it to be emitted
+	sink.GetMessages();
+	ASSERT_EQ(4000u, emitted.size());
+
+	int next[4] = {0};
+	for (auto const& msg : emitted) {
+		int t = msg[0] - '0';
+		EXPECT_EQ(std::to_string(t) + " " + std::to_string(next[t]), msg);
+		++next[t];
+	}
+}
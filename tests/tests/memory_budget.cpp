@@ -0,0 +1,119 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/memory_budget.h>
+
+#include <cstdint>
+
+using agi::MemoryBudget;
+
+namespace {
+/// A cache which shrinks the moment it's told to
+struct FakeCache {
+	size_t size;
+	size_t allowance = SIZE_MAX;
+
+	FakeCache(size_t size) : size(size) { }
+
+	MemoryBudget::Registration Register(MemoryBudget& budget, double weight, int priority) {
+		return budget.Register("fake", weight, priority,
+			[=] { return size; },
+			[=](size_t limit) { allowance = limit; size = std::min(size, limit); });
+	}
+};
+}
+
+TEST(lagi_memory_budget, no_limit_means_no_eviction) {
+	MemoryBudget budget;
+	FakeCache cache(1000);
+	auto reg = cache.Register(budget, 1, 0);
+	budget.Rebalance();
+	EXPECT_EQ(SIZE_MAX, cache.allowance);
+	EXPECT_EQ(1000, cache.size);
+}
+
+TEST(lagi_memory_budget, under_limit_shares_the_headroom) {
+	MemoryBudget budget;
+	budget.SetLimit(1000);
+	FakeCache a(100), b(100);
+	auto ra = a.Register(budget, 3, 0);
+	auto rb = b.Register(budget, 1, 0);
+	budget.Rebalance();
+	EXPECT_EQ(100 + 600, a.allowance);
+	EXPECT_EQ(100 + 200, b.allowance);
+	EXPECT_EQ(100, a.size);
+}
+
+TEST(lagi_memory_budget, lowest_priority_shrinks_first) {
+	MemoryBudget budget;
+	budget.SetLimit(1500);
+	FakeCache low(800), high(800), idle(0);
+	auto rl = low.Register(budget, 1, 0);
+	auto rh = high.Register(budget, 1, 1);
+	auto ri = idle.Register(budget, 1, 2);
+	budget.Rebalance();
+
+	// Both are over their share of 500, but the idle cache leaves enough
+	// room that only the low priority one has to give anything up
+	EXPECT_EQ(700, low.size);
+	EXPECT_EQ(800, high.size);
+	EXPECT_EQ(0, idle.size);
+}
+
+TEST(lagi_memory_budget, caches_under_their_share_are_left_alone) {
+	MemoryBudget budget;
+	budget.SetLimit(1000);
+	FakeCache small(100), big(2000);
+	auto rs = small.Register(budget, 1, 0);
+	auto rb = big.Register(budget, 1, 1);
+	budget.Rebalance();
+	EXPECT_EQ(100, small.size);
+	EXPECT_EQ(900, big.size);
+}
+
+TEST(lagi_memory_budget, fixed_caches_take_room_from_the_others) {
+	MemoryBudget budget;
+	budget.SetLimit(1000);
+	FakeCache cache(800);
+	auto reg = cache.Register(budget, 1, 0);
+	auto fixed = budget.Register("fixed", 1, 0, [] { return size_t(700); }, nullptr);
+	budget.Rebalance();
+	EXPECT_EQ(300, cache.size);
+
+	fixed.Release();
+	budget.Rebalance();
+	EXPECT_EQ(1000, cache.allowance);
+}
+
+TEST(lagi_memory_budget, released_caches_are_not_called) {
+	MemoryBudget budget;
+	budget.SetLimit(10);
+	int calls = 0;
+	auto reg = budget.Register("cache", 1, 0, [] { return size_t(100); }, [&](size_t) { ++calls; });
+	budget.Rebalance();
+	EXPECT_EQ(1, calls);
+
+	MemoryBudget::Registration moved(std::move(reg));
+	budget.Rebalance();
+	EXPECT_EQ(2, calls);
+
+	moved = MemoryBudget::Registration();
+	budget.Rebalance();
+	EXPECT_EQ(2, calls);
+}
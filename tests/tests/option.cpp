@@ -84,6 +84,15 @@ TEST_F(lagi_option, flush_no_skip) {
 	EXPECT_FALSE(util::compare("data/options/string.json", "data/options/tmp"));
 }
 
+TEST_F(lagi_option, wait_for_flush) {
+	agi::fs::Copy("data/options/string.json", "data/options/tmp");
+	agi::Options opt("data/options/tmp", default_opt, agi::Options::FLUSH_SKIP);
+	ASSERT_NO_THROW(opt.Get("Valid")->SetString(""));
+	opt.Flush();
+	opt.WaitForFlush();
+	EXPECT_FALSE(util::compare("data/options/string.json", "data/options/tmp"));
+}
+
 TEST_F(lagi_option, existent_but_invalid_file_uses_default) {
 	agi::Options opt("data/options/null.json", default_opt, agi::Options::FLUSH_SKIP);
 	EXPECT_NO_THROW(opt.Get("Valid")->GetString());
@@ -193,6 +202,13 @@ TEST_F(lagi_option, malformed_arrays) {
 	EXPECT_THROW(agi::Options("", "{ \"arr\" : [ { \"double\" : 5.0, \"int\" : 5 } ] }"), agi::Exception);
 }
 
+TEST_F(lagi_option, mistyped_array_values) {
+	EXPECT_THROW(agi::Options("", "{ \"arr\" : [ { \"int\" : \"5\" } ] }"), agi::Exception);
+	EXPECT_THROW(agi::Options("", "{ \"arr\" : [ { \"string\" : [] } ] }"), agi::Exception);
+	EXPECT_THROW(agi::Options("", "{ \"arr\" : [ 5 ] }"), agi::Exception);
+	EXPECT_THROW(agi::Options("", "{ \"arr\" : [ [ { \"int\" : 5 } ] ] }"), agi::Exception);
+}
+
 TEST_F(lagi_option, int_vs_double) {
 	agi::Options opt("", "{ \"int\" : 5, \"double\" : 5.0 }", agi::Options::FLUSH_SKIP);
 	EXPECT_NO_THROW(opt.Get("int")->GetInt());
@@ -0,0 +1,104 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/perf.h>
+
+#include <algorithm>
+
+using namespace agi::perf;
+
+TEST(lagi_perf, lookup_returns_the_same_metric) {
+	EXPECT_EQ(&GetCounter("test/lookup"), &GetCounter("test/lookup"));
+	EXPECT_NE(&GetCounter("test/lookup"), &GetCounter("test/lookup2"));
+}
+
+TEST(lagi_perf, counter_adds) {
+	auto& counter = GetCounter("test/counter");
+	int64_t start = counter.Get();
+	counter.Add();
+	counter.Add(5);
+	EXPECT_EQ(start + 6, counter.Get());
+}
+
+TEST(lagi_perf, gauge_sets_and_adds) {
+	auto& gauge = GetGauge("test/gauge");
+	gauge.Set(10);
+	gauge.Add(-3);
+	EXPECT_EQ(7, gauge.Get());
+}
+
+TEST(lagi_perf, histogram_percentiles_bound_values) {
+	Histogram h;
+	EXPECT_EQ(0, h.Percentile(.5));
+
+	for (int i = 1; i <= 100; ++i)
+		h.Record(i);
+	EXPECT_EQ(100, h.Count());
+	EXPECT_EQ(5050, h.Sum());
+
+	// Within a factor of two, and never below the true value
+	EXPECT_GE(h.Percentile(.5), 50);
+	EXPECT_LT(h.Percentile(.5), 100);
+	EXPECT_GE(h.Percentile(.99), 99);
+	EXPECT_LT(h.Percentile(.99), 200);
+}
+
+TEST(lagi_perf, histogram_handles_zero_and_huge_values) {
+	Histogram h;
+	h.Record(0);
+	h.Record(-5);
+	EXPECT_EQ(0, h.Percentile(1));
+	h.Record(INT64_MAX);
+	EXPECT_GT(h.Percentile(1), 0);
+}
+
+TEST(lagi_perf, snapshot_is_sorted_and_has_every_metric) {
+	GetCounter("test/snapshot/b").Add(2);
+	GetGauge("test/snapshot/a").Set(3);
+	GetHistogram("test/snapshot/c").Record(10);
+
+	auto samples = Snapshot();
+	EXPECT_TRUE(std::is_sorted(begin(samples), end(samples), [](Sample const& a, Sample const& b) {
+		return a.name < b.name;
+	}));
+
+	auto find = [&](const char *name) -> Sample const * {
+		for (auto const& sample : samples) {
+			if (sample.name == name) return &sample;
+		}
+		return nullptr;
+	};
+
+	auto a = find("test/snapshot/a");
+	ASSERT_NE(nullptr, a);
+	EXPECT_EQ(Sample::Type::Gauge, a->type);
+	EXPECT_EQ(3, a->value);
+
+	auto b = find("test/snapshot/b");
+	ASSERT_NE(nullptr, b);
+	EXPECT_EQ(Sample::Type::Counter, b->type);
+	EXPECT_EQ(2, b->value);
+
+	auto c = find("test/snapshot/c");
+	ASSERT_NE(nullptr, c);
+	EXPECT_EQ(Sample::Type::Histogram, c->type);
+	EXPECT_EQ(1, c->value);
+	EXPECT_EQ(10, c->sum);
+	EXPECT_EQ(15, c->p50);
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+#include <script_generator.h>
+
+#include <libaegisub/ass/dialogue_parser.h>
+#include <libaegisub/split.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+using util::generate_script;
+using util::ScriptKind;
+
+namespace {
+size_t count_events(std::string const& script) {
+	size_t count = 0;
+	for (auto const& line : agi::Split(script, '\n')) {
+		if (boost::starts_with(line, "Dialogue: ") || boost::starts_with(line, "Comment: "))
+			++count;
+	}
+	return count;
+}
+}
+
+TEST(lagi_script_generator, is_deterministic) {
+	EXPECT_EQ(generate_script(500, ScriptKind::HeavyTags), generate_script(500, ScriptKind::HeavyTags));
+	EXPECT_EQ(generate_script(500, ScriptKind::Karaoke, 7), generate_script(500, ScriptKind::Karaoke, 7));
+	EXPECT_NE(generate_script(500, ScriptKind::Karaoke, 7), generate_script(500, ScriptKind::Karaoke, 8));
+}
+
+TEST(lagi_script_generator, has_requested_number_of_events) {
+	EXPECT_EQ(0u, count_events(generate_script(0, ScriptKind::HeavyTags)));
+	EXPECT_EQ(2u, count_events(generate_script(2, ScriptKind::Karaoke)));
+	EXPECT_EQ(1000u, count_events(generate_script(1000, ScriptKind::HeavyTags)));
+	EXPECT_EQ(1000u, count_events(generate_script(1000, ScriptKind::Karaoke)));
+}
+
+TEST(lagi_script_generator, karaoke_lines_have_k_tags) {
+	auto script = generate_script(100, ScriptKind::Karaoke);
+	size_t karaoke = 0;
+	for (auto const& range : agi::Split(script, '\n')) {
+		auto line = agi::str(range);
+		if (!boost::starts_with(line, "Dialogue: ")) continue;
+		++karaoke;
+
+		auto text = line.substr(line.find(",karaoke,") + 9);
+		size_t k_tags = 0, pos = 0;
+		for (auto const& token : agi::ass::TokenizeDialogueBody(text)) {
+			if (token.type == agi::ass::DialogueTokenType::TAG_NAME && text.compare(pos, token.length, "k") == 0)
+				++k_tags;
+			pos += token.length;
+		}
+		EXPECT_GT(k_tags, 3u) << line;
+	}
+	EXPECT_GT(karaoke, 80u);
+}
@@ -16,6 +16,9 @@
 
 #include <main.h>
 
+#include <array>
+#include <vector>
+
 using namespace agi::signal;
 
 TEST(lagi_signal, basic) {
@@ -90,3 +93,71 @@ TEST(lagi_signal, one_arg) {
 	s(20);
 	EXPECT_EQ(30, x);
 }
+
+TEST(lagi_signal, leading_args_member) {
+	struct Listener {
+		int one = 0, two = 0;
+		void One(int a) { one += a; }
+		void Two(int a, int b) { two += a * b; }
+	} l;
+
+	Signal<int, int, int> s;
+	Connection c1 = s.Connect(&Listener::One, &l);
+	Connection c2 = s.Connect(&Listener::Two, &l);
+	s(2, 3, 4);
+	EXPECT_EQ(2, l.one);
+	EXPECT_EQ(6, l.two);
+}
+
+TEST(lagi_signal, disconnect_during_emission) {
+	Signal<> s;
+	int x = 0, y = 0;
+
+	Connection c1, c2;
+	c1 = s.Connect([&] { ++x; c1.Disconnect(); c2.Disconnect(); });
+	c2 = s.Connect([&] { ++y; c1.Disconnect(); c2.Disconnect(); });
+	s();
+	EXPECT_EQ(1, x + y);
+	s();
+	EXPECT_EQ(1, x + y);
+}
+
+TEST(lagi_signal, connect_during_emission) {
+	Signal<> s;
+	int x = 0;
+	std::vector<Connection> added;
+
+	Connection c = s.Connect([&] {
+		added.push_back(s.Connect([&] { ++x; }));
+	});
+	s();
+	EXPECT_EQ(0, x);
+	s();
+	EXPECT_EQ(1, x);
+}
+
+TEST(lagi_signal, large_slot) {
+	Signal<int> s;
+	std::array<int, 64> big;
+	big.fill(1);
+	int x = 0;
+
+	Connection c = s.Connect([&x, big](int v) { x += v * big[63]; });
+	s(5);
+	EXPECT_EQ(5, x);
+	c.Disconnect();
+	s(5);
+	EXPECT_EQ(5, x);
+}
+
+TEST(lagi_signal, recursive_emission) {
+	Signal<int> s;
+	int x = 0;
+
+	Connection c = s.Connect([&](int depth) {
+		++x;
+		if (depth > 0) s(depth - 1);
+	});
+	s(3);
+	EXPECT_EQ(4, x);
+}
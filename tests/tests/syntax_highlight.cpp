@@ -27,6 +27,15 @@ class MockSpellChecker : public agi::SpellChecker {
 	bool CheckWord(std::string const& word) override { return word != "incorrect"; }
 };
 
+/// Spell checker which only knows the results for words it's been told about
+class PartialSpellChecker final : public MockSpellChecker {
+	bool TryCheckWord(std::string const& word, bool& valid) override {
+		if (word == "unknown") return false;
+		valid = word != "incorrect";
+		return true;
+	}
+};
+
 using namespace agi::ass;
 namespace dt = DialogueTokenType;
 namespace ss = SyntaxStyle;
@@ -65,6 +74,21 @@ TEST(lagi_syntax, empty) {
 	} \
 } while(false)
 
+TEST(lagi_syntax, spellcheck_unchecked) {
+	PartialSpellChecker spellchecker;
+	std::string str = "incorrect unknown correct unknown";
+	std::vector<DialogueToken> tok = TokenizeDialogueBody(str);
+	SplitWords(str, tok);
+
+	std::vector<std::string> unchecked;
+	auto styles = SyntaxHighlight(str, tok, &spellchecker, &unchecked);
+	ASSERT_EQ(2u, styles.size());
+	EXPECT_EQ(ss::SPELLING, styles[0].type);
+	EXPECT_EQ(9u, styles[0].length);
+	EXPECT_EQ(ss::NORMAL, styles[1].type);
+	EXPECT_EQ(std::vector<std::string>({"unknown", "unknown"}), unchecked);
+}
+
 TEST(lagi_syntax, spellcheck) {
 	tok_str("correct incorrect correct", false,
 		expect_style(ss::NORMAL, 8u);
@@ -146,3 +146,41 @@ TEST_F(lagi_thes, unindexed_word) {
 	ASSERT_NO_THROW(entries = thes.Lookup("Unindexed Word"));
 	EXPECT_EQ(0, entries.size());
 }
+
+TEST_F(lagi_thes, binary_index) {
+	std::string cache_path = "data/thes_cache/thes.bidx";
+	agi::fs::Remove(cache_path);
+
+	std::vector<agi::Thesaurus::Entry> entries;
+	{
+		agi::Thesaurus thes(dat_path, idx_path, cache_path);
+		ASSERT_NO_THROW(entries = thes.Lookup("Word 2"));
+		EXPECT_EQ(2, entries.size());
+	}
+	ASSERT_TRUE(agi::fs::FileExists(cache_path));
+
+	agi::Thesaurus thes(dat_path, idx_path, cache_path);
+	ASSERT_NO_THROW(entries = thes.Lookup("Word 1"));
+	ASSERT_EQ(1, entries.size());
+	EXPECT_STREQ("(noun) Word 1", entries[0].first.c_str());
+	ASSERT_NO_THROW(entries = thes.Lookup("Word 3"));
+	EXPECT_EQ(1, entries.size());
+	ASSERT_NO_THROW(entries = thes.Lookup("Word"));
+	EXPECT_EQ(0, entries.size());
+	ASSERT_NO_THROW(entries = thes.Lookup("Out of range"));
+	EXPECT_EQ(0, entries.size());
+}
+
+TEST_F(lagi_thes, binary_index_corrupt) {
+	std::string cache_path = "data/thes_cache/corrupt.bidx";
+	agi::fs::CreateDirectory("data/thes_cache");
+	{
+		std::ofstream cache(cache_path.c_str(), std::ios_base::binary);
+		cache << "not an index";
+	}
+
+	agi::Thesaurus thes(dat_path, idx_path, cache_path);
+	std::vector<agi::Thesaurus::Entry> entries;
+	ASSERT_NO_THROW(entries = thes.Lookup("Word 2"));
+	EXPECT_EQ(2, entries.size());
+}
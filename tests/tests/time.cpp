@@ -38,6 +38,13 @@ TEST(lagi_time, ms_formatting) {
 	EXPECT_STREQ("1:23:45.678", Time((((1 * 60) + 23) * 60 + 45) * 1000 + 678).GetAssFormatted(true).c_str());
 }
 
+TEST(lagi_time, append_formatting) {
+	std::string str = "x";
+	Time((((1 * 60) + 23) * 60 + 45) * 1000 + 678).AppendAssFormatted(str);
+	Time(5).AppendAssFormatted(str, true);
+	EXPECT_EQ("x1:23:45.680:00:00.005", str);
+}
+
 TEST(lagi_time, well_formed_ass_time_parse) {
 	EXPECT_STREQ("1:23:45.67", Time("1:23:45.67").GetAssFormatted().c_str());
 }
@@ -62,6 +69,20 @@ TEST(lagi_time, extra_garbage_is_ignored) {
 	EXPECT_STREQ("1:23:45.67", Time("1a:b2c3d:e4f5g.!6&7").GetAssFormatted().c_str());
 }
 
+TEST(lagi_time, fixed_layouts_match_general_parsing) {
+	// A leading space keeps the text out of the fixed layout parser
+	for (int t = 0; t < 10 * 60 * 60 * 1000; t += 7919) {
+		Time time(t);
+		for (auto const& str : {time.GetAssFormatted(), time.GetAssFormatted(true), time.GetSrtFormatted()}) {
+			EXPECT_EQ(Time(" " + str).GetAssFormatted(true), Time(str).GetAssFormatted(true)) << str;
+		}
+	}
+
+	for (const char *str : {"1:83:99.99", "9:59:59.999", "12:34:56.78", "1:23:45,6x", "1:23.45:67", "1:2a:45.67", "a1:23:45.67", "1:23:45:678"}) {
+		EXPECT_EQ(Time(std::string(" ") + str).GetAssFormatted(true), Time(str).GetAssFormatted(true)) << str;
+	}
+}
+
 TEST(lagi_time, srt_time) {
 	EXPECT_STREQ("1:23:45.678", Time("1:23:45,678").GetAssFormatted(true).c_str());
 	EXPECT_STREQ("01:23:45,678", Time("1:23:45,678").GetSrtFormatted().c_str());
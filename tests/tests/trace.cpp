@@ -0,0 +1,102 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+
+#include <main.h>
+
+#include <libaegisub/cajun/elements.h>
+#include <libaegisub/json.h>
+#include <libaegisub/trace.h>
+
+#include <sstream>
+#include <thread>
+
+namespace {
+json::Array events() {
+	std::stringstream ss;
+	agi::trace::Write(ss);
+	json::UnknownElement root = agi::json_util::parse(ss);
+	json::Object& obj = root;
+	json::Array& array = obj["traceEvents"];
+	return std::move(array);
+}
+
+size_t count(json::Array const& array, std::string const& name) {
+	size_t n = 0;
+	for (json::Object const& event : array) {
+		auto it = event.find("name");
+		if (it != event.end() && static_cast<std::string const&>(it->second) == name)
+			++n;
+	}
+	return n;
+}
+}
+
+TEST(lagi_trace, disabled_records_nothing) {
+	agi::trace::SetEnabled(true);
+	agi::trace::SetEnabled(false);
+	{ agi::trace::Scope scope("disabled", "test"); }
+	EXPECT_EQ(0, count(events(), "disabled"));
+}
+
+TEST(lagi_trace, scopes_become_complete_events) {
+	agi::trace::SetEnabled(true);
+	{ agi::trace::Scope scope("outer", "test"); agi::trace::Scope inner("inner", "test"); }
+	std::thread([] {
+		agi::trace::NameThread("helper");
+		agi::trace::Scope scope("on \"thread\"", "test");
+	}).join();
+	agi::trace::SetEnabled(false);
+
+	auto array = events();
+	EXPECT_EQ(1, count(array, "outer"));
+	EXPECT_EQ(1, count(array, "inner"));
+	EXPECT_EQ(1, count(array, "on \"thread\""));
+
+	int64_t main_tid = -1, helper_tid = -1, named_tid = -2;
+	for (json::Object const& event : array) {
+		std::string const& name = event.find("name")->second;
+		if (name == "outer") {
+			EXPECT_EQ("X", static_cast<std::string const&>(event.find("ph")->second));
+			EXPECT_EQ("test", static_cast<std::string const&>(event.find("cat")->second));
+			EXPECT_GE(static_cast<int64_t>(event.find("dur")->second), 0);
+			main_tid = event.find("tid")->second;
+		}
+		else if (name == "on \"thread\"")
+			helper_tid = event.find("tid")->second;
+		else if (name == "thread_name") {
+			json::Object const& args = event.find("args")->second;
+			if (static_cast<std::string const&>(args.find("name")->second) == "helper")
+				named_tid = event.find("tid")->second;
+		}
+	}
+	EXPECT_NE(main_tid, helper_tid);
+	EXPECT_EQ(helper_tid, named_tid);
+}
+
+TEST(lagi_trace, ring_buffer_keeps_the_newest_events) {
+	agi::trace::SetEnabled(true);
+	{ agi::trace::Scope scope("oldest", "test"); }
+	for (int i = 0; i < 70000; ++i)
+		agi::trace::Scope scope("filler", "test");
+	{ agi::trace::Scope scope("newest", "test"); }
+	agi::trace::SetEnabled(false);
+
+	auto array = events();
+	EXPECT_EQ(0, count(array, "oldest"));
+	EXPECT_EQ(1, count(array, "newest"));
+	EXPECT_LT(count(array, "filler"), 70000u);
+}
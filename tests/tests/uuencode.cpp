@@ -55,3 +55,41 @@ TEST(lagi_uuencode, random_blobs_roundtrip) {
 		data.push_back(rand());
 	}
 }
+
+TEST(lagi_uuencode, long_blobs_wrap_lines) {
+	std::vector<char> data;
+
+	for (size_t len : {59, 60, 61, 62, 63, 119, 120, 121, 1000, 100000}) {
+		data.resize(len);
+		for (auto& c : data) c = rand();
+
+		auto encoded = UUEncode(data.data(), data.data() + data.size());
+		EXPECT_EQ(data, UUDecode(encoded.data(), encoded.data() + encoded.size()));
+
+		// Every line but the last is exactly 80 characters
+		size_t line_start = 0;
+		for (size_t pos = encoded.find("\r\n"); pos != std::string::npos; pos = encoded.find("\r\n", line_start)) {
+			EXPECT_EQ(80u, pos - line_start);
+			line_start = pos + 2;
+		}
+		EXPECT_GT(encoded.size() - line_start, 0u);
+		EXPECT_LE(encoded.size() - line_start, 80u);
+
+		auto unwrapped = UUEncode(data.data(), data.data() + data.size(), false);
+		EXPECT_EQ(boost::replace_all_copy(encoded, "\r\n", ""), unwrapped);
+	}
+}
+
+TEST(lagi_uuencode, decode_ignores_line_breaks_anywhere) {
+	std::vector<char> data(1000);
+	for (auto& c : data) c = rand();
+	auto encoded = UUEncode(data.data(), data.data() + data.size(), false);
+
+	std::string broken;
+	for (size_t i = 0; i < encoded.size(); ++i) {
+		broken += encoded[i];
+		if (i % 7 == 3) broken += "\r\n";
+		if (i % 11 == 5) broken += '\n';
+	}
+	EXPECT_EQ(data, UUDecode(broken.data(), broken.data() + broken.size()));
+}
@@ -767,3 +767,35 @@ TEST(lagi_vfr, from_smpte_ntsc_nodrop) {
 		++f;
 	}
 }
+
+TEST(lagi_vfr, batch_matches_single) {
+	std::vector<Framerate> rates;
+	rates.emplace_back(30000, 1001);
+	rates.emplace_back(std::initializer_list<int>{0, 10, 11, 50, 51, 52, 100, 1000, 1001});
+	ASSERT_NO_THROW(rates.emplace_back("data/vfr/in/v1_mode5.txt"));
+
+	std::vector<int> times, frames;
+	for (int i = -1500; i < 3000; ++i)
+		times.push_back(i);
+	// Also check times which jump around rather than increasing
+	for (int i = 0; i < 3000; ++i)
+		times.push_back((i * 7919) % 4500 - 1500);
+	for (int i = -50; i < 150; ++i)
+		frames.push_back(i);
+	for (int i = 0; i < 200; ++i)
+		frames.push_back((i * 131) % 200 - 50);
+
+	for (auto const& fps : rates) {
+		for (auto type : {EXACT, START, END}) {
+			auto batch_frames = fps.FramesAtTimes(times, type);
+			ASSERT_EQ(times.size(), batch_frames.size());
+			for (size_t i = 0; i < times.size(); ++i)
+				ASSERT_EQ(fps.FrameAtTime(times[i], type), batch_frames[i]) << times[i];
+
+			auto batch_times = fps.TimesAtFrames(frames, type);
+			ASSERT_EQ(frames.size(), batch_times.size());
+			for (size_t i = 0; i < frames.size(); ++i)
+				ASSERT_EQ(fps.TimeAtFrame(frames[i], type), batch_times[i]) << frames[i];
+		}
+	}
+}
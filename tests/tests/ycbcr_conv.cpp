@@ -0,0 +1,94 @@
+// Copyright (c) 2026, Aegisub contributors
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+//
+// Aegisub Project http://www.aegisub.org/
+
+#include <libaegisub/ycbcr_conv.h>
+
+#include <main.h>
+
+#include <cstdlib>
+#include <vector>
+
+using agi::ycbcr_converter;
+using agi::ycbcr_matrix;
+using agi::ycbcr_range;
+
+class lagi_ycbcr : public libagi { };
+
+TEST(lagi_ycbcr, table_matches_math) {
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::tv, ycbcr_matrix::bt709, ycbcr_range::tv);
+
+	int differences = 0;
+	for (int r = 0; r < 256; r += 3) {
+		for (int g = 0; g < 256; g += 5) {
+			for (int b = 0; b < 256; b += 7) {
+				auto expected = conv.rgb_to_rgb(std::array<uint8_t, 3>{{(uint8_t)r, (uint8_t)g, (uint8_t)b}});
+				auto actual = conv.rgb_to_rgb(agi::Color(r, g, b));
+				ASSERT_GE(1, std::abs(expected[0] - actual.r));
+				ASSERT_GE(1, std::abs(expected[1] - actual.g));
+				ASSERT_GE(1, std::abs(expected[2] - actual.b));
+				differences += expected[0] != actual.r || expected[1] != actual.g || expected[2] != actual.b;
+			}
+		}
+	}
+	EXPECT_GT(10, differences);
+}
+
+TEST(lagi_ycbcr, rgb_to_rgb_keeps_alpha) {
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::tv, ycbcr_matrix::bt709, ycbcr_range::tv);
+	EXPECT_EQ(123, conv.rgb_to_rgb(agi::Color(10, 20, 30, 123)).a);
+}
+
+TEST(lagi_ycbcr, same_matrix_is_identity) {
+	ycbcr_converter conv(ycbcr_matrix::bt709, ycbcr_range::pc, ycbcr_matrix::bt709, ycbcr_range::pc);
+	for (int v = 0; v < 256; v += 15) {
+		agi::Color c(v, 255 - v, v / 2);
+		EXPECT_EQ(c, conv.rgb_to_rgb(c));
+	}
+}
+
+TEST(lagi_ycbcr, batch_matches_single) {
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::tv, ycbcr_matrix::bt709, ycbcr_range::pc);
+	std::vector<agi::Color> colors;
+	for (int i = 0; i < 100; ++i)
+		colors.emplace_back(i * 2, 255 - i, i * 37 % 256, i);
+
+	auto converted = colors;
+	conv.rgb_to_rgb(converted.data(), converted.size());
+	for (size_t i = 0; i < colors.size(); ++i)
+		EXPECT_EQ(conv.rgb_to_rgb(colors[i]), converted[i]);
+}
+
+TEST(lagi_ycbcr, ycbcr_to_bgra) {
+	ycbcr_converter conv(ycbcr_matrix::bt601, ycbcr_range::tv);
+
+	const uint8_t y[] = {16, 235, 100, 200, 50};
+	const uint8_t cb[] = {128, 90, 240};
+	const uint8_t cr[] = {128, 200, 16};
+	uint8_t bgra[sizeof(y) * 4];
+	conv.ycbcr_to_bgra(y, cb, cr, bgra, sizeof(y));
+
+	for (size_t i = 0; i < sizeof(y); ++i) {
+		auto rgb = conv.ycbcr_to_rgb({{y[i], cb[i / 2], cr[i / 2]}});
+		EXPECT_GE(1, std::abs(rgb[2] - bgra[i * 4 + 0]));
+		EXPECT_GE(1, std::abs(rgb[1] - bgra[i * 4 + 1]));
+		EXPECT_GE(1, std::abs(rgb[0] - bgra[i * 4 + 2]));
+		EXPECT_EQ(0, bgra[i * 4 + 3]);
+	}
+
+	// Black and white are exact
+	EXPECT_EQ(0, bgra[0]);
+	EXPECT_EQ(255, bgra[5]);
+}